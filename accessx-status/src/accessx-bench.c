@@ -0,0 +1,75 @@
+/* Measures the AltGraph glyph of the accessx status applet offscreen.
+ *
+ * The glyph is laid out and rendered over an icon base the size of the
+ * icons of the applet, as every time the AltGraph indicator is shown
+ * or the panel changes.
+ *
+ * Built on request only: make -C accessx-status/src accessx-bench
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "common/applet-bench.h"
+
+#include "applet.h"
+
+/* ICON_PADDING of applet.c */
+#define BENCH_ICON_PADDING 4
+
+typedef struct
+{
+    GtkWidget *widget;
+    GdkPixbuf *base;
+    GdkRGBA    fg;
+} BenchGlyph;
+
+static void
+bench_glyph_render (gint     frame,
+                    gpointer data)
+{
+    BenchGlyph *bench = data;
+    GdkPixbuf *glyph_pixbuf;
+
+    glyph_pixbuf = accessx_status_applet_get_glyph_pixbuf (bench->widget, bench->base,
+                                                           &bench->fg, "æ");
+    g_object_unref (glyph_pixbuf);
+}
+
+static void
+bench_glyph (gint panel_size)
+{
+    BenchGlyph bench;
+    gint size;
+    gchar *label;
+
+    /* the font of the panel, at the scale of the screen */
+    bench.widget = g_object_ref_sink (gtk_label_new (NULL));
+    size = (panel_size - BENCH_ICON_PADDING) * gtk_widget_get_scale_factor (bench.widget);
+    bench.base = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+    gdk_pixbuf_fill (bench.base, 0);
+    gdk_rgba_parse (&bench.fg, "black");
+
+    label = g_strdup_printf ("panel %d", panel_size);
+    applet_bench_call ("accessx:get_glyph_pixbuf", label, NULL, bench_glyph_render, &bench);
+
+    g_free (label);
+    g_object_unref (bench.base);
+    g_object_unref (bench.widget);
+}
+
+int
+main (int argc, char *argv [])
+{
+    if (!applet_bench_init (&argc, &argv, "- measure the accessx status glyph offscreen", NULL))
+        return EXIT_FAILURE;
+
+    /* a typical panel, and the largest */
+    bench_glyph (24);
+    bench_glyph (128);
+
+    return EXIT_SUCCESS;
+}
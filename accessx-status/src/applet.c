@@ -36,6 +36,7 @@
 #define XK_XKB_KEYS
 
 #include <X11/keysymdef.h>
+#include "common/applet-probe.h"
 #include "applet.h"
 
 static int xkb_base_event_type = 0;
@@ -54,20 +55,40 @@ typedef enum {
     modifier_n
 } E_modifiers;
 
+typedef enum {
+    modifier_state_Locked = 0,
+    modifier_state_Latched,
+    modifier_state_None,
+    modifier_state_n
+} E_modifier_states;
+
 typedef struct {
     unsigned int mask;
     GtkWidget* indicator;
-    gchar *icon_name;
+    gchar *icon_names[modifier_state_n];
+    /* the images of the states, made once per size, scale and theme */
+    cairo_surface_t *surfaces[modifier_state_n];
+    /* modifier_state_n until the indicator shows one */
+    E_modifier_states shown_state;
 } ModifierStruct;
 
+#define MODIFIER_ICONS(icon) {icon ## _LOCKED, icon ## _LATCHED, icon}
+
 static ModifierStruct modifiers[modifier_n] = {
-    [modifier_Shift] = {ShiftMask, NULL, SHIFT_KEY_ICON},
-    [modifier_Control] = {ControlMask, NULL, CONTROL_KEY_ICON},
-    [modifier_Mod1] = {Mod1Mask, NULL, ALT_KEY_ICON},
-    [modifier_Mod2] = {Mod2Mask, NULL, META_KEY_ICON},
-    [modifier_Mod3] = {Mod3Mask, NULL, HYPER_KEY_ICON},
-    [modifier_Mod4] = {Mod4Mask, NULL, SUPER_KEY_ICON},
-    [modifier_Mod5] = {Mod5Mask, NULL, ALTGRAPH_KEY_ICON}
+    [modifier_Shift] = {ShiftMask, NULL, MODIFIER_ICONS (SHIFT_KEY_ICON)},
+    [modifier_Control] = {ControlMask, NULL, MODIFIER_ICONS (CONTROL_KEY_ICON)},
+    [modifier_Mod1] = {Mod1Mask, NULL, MODIFIER_ICONS (ALT_KEY_ICON)},
+    [modifier_Mod2] = {Mod2Mask, NULL, MODIFIER_ICONS (META_KEY_ICON)},
+    [modifier_Mod3] = {Mod3Mask, NULL, MODIFIER_ICONS (HYPER_KEY_ICON)},
+    [modifier_Mod4] = {Mod4Mask, NULL, MODIFIER_ICONS (SUPER_KEY_ICON)},
+    [modifier_Mod5] = {Mod5Mask, NULL, MODIFIER_ICONS (ALTGRAPH_KEY_ICON)}
+};
+
+/* the states the AltGraph image is drawn in */
+static const GtkStateFlags modifier_state_flags[modifier_state_n] = {
+    [modifier_state_Locked] = GTK_STATE_FLAG_SELECTED,
+    [modifier_state_Latched] = GTK_STATE_FLAG_NORMAL,
+    [modifier_state_None] = GTK_STATE_FLAG_INSENSITIVE
 };
 
 typedef struct {
@@ -302,6 +323,7 @@ static void
 accessx_status_applet_init_modifiers (AccessxStatusApplet* sapplet)
 {
     unsigned int hyper_mask, super_mask, alt_gr_mask;
+    gint i;
 
     unsigned int alt_mask = XkbKeysymToModifiers (sapplet->xkb_display, XK_Alt_L);
     unsigned int meta_mask = XkbKeysymToModifiers (sapplet->xkb_display, XK_Meta_L);
@@ -360,6 +382,11 @@ accessx_status_applet_init_modifiers (AccessxStatusApplet* sapplet)
     modifiers[modifier_Mod3].indicator = sapplet->hyper_indicator;
     modifiers[modifier_Mod4].indicator = sapplet->super_indicator;
     modifiers[modifier_Mod5].indicator = sapplet->alt_graph_indicator;
+
+    for (i = 0; i < modifier_n; ++i)
+    {
+        modifiers[i].shown_state = modifier_state_n;
+    }
 }
 
 static gboolean
@@ -398,19 +425,20 @@ timer_reset_bouncekeys_image (AccessxStatusApplet* sapplet)
     return G_SOURCE_REMOVE;
 }
 
-static GdkPixbuf*
+GdkPixbuf*
 accessx_status_applet_get_glyph_pixbuf (GtkWidget* widget,
                                         GdkPixbuf* base,
                                         GdkRGBA*   fg,
                                         gchar*     glyphstring)
 {
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "accessx:get_glyph_pixbuf");
     GdkPixbuf* glyph_pixbuf;
     cairo_surface_t *surface;
     PangoLayout* layout;
     PangoRectangle ink, logic;
     PangoContext* pango_context;
     PangoFontDescription* font_description;
-    static gint font_size = 0;
     gint w = gdk_pixbuf_get_width (base);
     gint h = gdk_pixbuf_get_height (base);
     gint icon_scale = 2;
@@ -421,12 +449,14 @@ accessx_status_applet_get_glyph_pixbuf (GtkWidget* widget,
 
     pango_context = gtk_widget_get_pango_context (widget);
 
-    font_description = pango_context_get_font_description (pango_context);
-    if (font_size == 0)
-        font_size = pango_font_description_get_size (font_description);
-    pango_font_description_set_size (font_description, font_size * icon_scale);
+    /* a copy, the context is the widget's */
+    font_description = pango_font_description_copy (pango_context_get_font_description (pango_context));
+    pango_font_description_set_size (font_description,
+                                     pango_font_description_get_size (font_description) * icon_scale);
 
     layout = pango_layout_new (pango_context);
+    pango_layout_set_font_description (layout, font_description);
+    pango_font_description_free (font_description);
     pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
     pango_layout_set_text (layout, glyphstring, -1);
 
@@ -443,6 +473,8 @@ accessx_status_applet_get_glyph_pixbuf (GtkWidget* widget,
     g_object_unref (layout);
     glyph_pixbuf = gdk_pixbuf_get_from_surface (surface, 0, 0, w, h);
     cairo_surface_destroy (surface);
+
+    applet_probe_end (probe, start);
     return glyph_pixbuf;
 }
 
@@ -810,93 +842,68 @@ accessx_status_applet_mousekeys_image (AccessxStatusApplet* sapplet,
     return surface;
 }
 
-static void
-accessx_status_applet_set_state_icon (AccessxStatusApplet* sapplet,
-                                      ModifierStruct*      modifier,
-                                      GtkStateFlags        state)
+static cairo_surface_t*
+accessx_status_applet_modifier_surface (AccessxStatusApplet* sapplet,
+                                        ModifierStruct*      modifier,
+                                        E_modifier_states    state)
 {
-    cairo_surface_t* surface = NULL;
-    GtkIconTheme *icon_theme;
-    gint icon_size, icon_scale;
-    gchar *icon_name = NULL;
-
-    switch (modifier->mask)
+    if (modifier->surfaces[state] == NULL)
     {
-        case ShiftMask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = SHIFT_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = SHIFT_KEY_ICON_LATCHED;
-            else
-                icon_name = SHIFT_KEY_ICON;
-            break;
-
-        case ControlMask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = CONTROL_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = CONTROL_KEY_ICON_LATCHED;
-            else
-                icon_name = CONTROL_KEY_ICON;
-            break;
-
-        case Mod1Mask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = ALT_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = ALT_KEY_ICON_LATCHED;
-            else
-                icon_name = ALT_KEY_ICON;
-            break;
-
-        case Mod2Mask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = META_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = META_KEY_ICON_LATCHED;
-            else
-                icon_name = META_KEY_ICON;
-            break;
+        if (modifier->mask == Mod5Mask)
+        {
+            modifier->surfaces[state] = accessx_status_applet_altgraph_image (sapplet,
+                                                                              modifier_state_flags[state]);
+        }
+        else
+        {
+            GtkIconTheme *icon_theme = gtk_icon_theme_get_default ();
+            gint icon_size = mate_panel_applet_get_size (sapplet->applet) - ICON_PADDING;
+            gint icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (sapplet->applet));
+
+            modifier->surfaces[state] = gtk_icon_theme_load_surface (icon_theme,
+                                                                     modifier->icon_names[state],
+                                                                     icon_size,
+                                                                     icon_scale,
+                                                                     NULL, 0, NULL);
+        }
+    }
 
-        case Mod3Mask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = HYPER_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = HYPER_KEY_ICON_LATCHED;
-            else
-                icon_name = HYPER_KEY_ICON;
-            break;
+    return modifier->surfaces[state];
+}
 
-        case Mod4Mask:
-            if (state == GTK_STATE_FLAG_SELECTED)
-                icon_name = SUPER_KEY_ICON_LOCKED;
-            else if (state == GTK_STATE_FLAG_NORMAL)
-                icon_name = SUPER_KEY_ICON_LATCHED;
-            else
-                icon_name = SUPER_KEY_ICON;
-            break;
+/* The images are made again for the new size, scale, theme or font */
+static void
+accessx_status_applet_clear_modifier_surfaces (void)
+{
+    gint i, j;
 
-        case Mod5Mask:
-            surface = accessx_status_applet_altgraph_image (sapplet, state);
-            break;
+    for (i = 0; i < modifier_n; ++i)
+    {
+        for (j = 0; j < modifier_state_n; ++j)
+        {
+            g_clear_pointer (&modifiers[i].surfaces[j], cairo_surface_destroy);
+        }
+        modifiers[i].shown_state = modifier_state_n;
     }
+}
 
-    if (surface == NULL && icon_name != NULL)
+static void
+accessx_status_applet_set_state_icon (AccessxStatusApplet* sapplet,
+                                      ModifierStruct*      modifier,
+                                      E_modifier_states    state)
+{
+    cairo_surface_t* surface;
+
+    if (modifier->shown_state == state)
     {
-        icon_theme = gtk_icon_theme_get_default ();
-        icon_size = mate_panel_applet_get_size (sapplet->applet) - ICON_PADDING;
-        icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (sapplet->applet));
-        surface = gtk_icon_theme_load_surface (icon_theme,
-                                               icon_name,
-                                               icon_size,
-                                               icon_scale,
-                                               NULL, 0, NULL);
+        return;
     }
 
+    surface = accessx_status_applet_modifier_surface (sapplet, modifier, state);
     if (surface != NULL)
     {
         gtk_image_set_from_surface (GTK_IMAGE (modifier->indicator), surface);
-        cairo_surface_destroy (surface);
+        modifier->shown_state = state;
     }
 }
 
@@ -936,21 +943,21 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
                     gtk_widget_set_sensitive (modifiers[i].indicator, TRUE);
                     accessx_status_applet_set_state_icon (sapplet,
                                                           &modifiers[i],
-                                                          GTK_STATE_FLAG_SELECTED);
+                                                          modifier_state_Locked);
                 }
                 else if (latched_mods & modifiers[i].mask)
                 {
                     gtk_widget_set_sensitive (modifiers[i].indicator, TRUE);
                     accessx_status_applet_set_state_icon (sapplet,
                                                           &modifiers[i],
-                                                          GTK_STATE_FLAG_NORMAL);
+                                                          modifier_state_Latched);
                 }
                 else
                 {
                     gtk_widget_set_sensitive (modifiers[i].indicator, FALSE);
                     accessx_status_applet_set_state_icon (sapplet,
                                                           &modifiers[i],
-                                                          GTK_STATE_FLAG_INSENSITIVE);
+                                                          modifier_state_None);
                 }
             }
         }
@@ -984,10 +991,20 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
     {
         /* Update the visibility of widgets in the box */
         /* XkbMouseKeysMask | XkbStickyKeysMask | XkbSlowKeysMask | XkbBounceKeysMask */
+        unsigned int enabled_ctrls;
+
         XkbGetControls (GDK_WINDOW_XDISPLAY (window), XkbAllControlsMask, sapplet->xkb);
+        enabled_ctrls = sapplet->xkb->ctrls->enabled_ctrls &
+            (XkbMouseKeysMask | XkbStickyKeysMask | XkbSlowKeysMask | XkbBounceKeysMask);
 
-        if (!(sapplet->xkb->ctrls->enabled_ctrls &
-            (XkbMouseKeysMask | XkbStickyKeysMask | XkbSlowKeysMask | XkbBounceKeysMask)))
+        if (sapplet->ctrls_shown && enabled_ctrls == sapplet->shown_ctrls)
+        {
+            return;
+        }
+        sapplet->ctrls_shown = TRUE;
+        sapplet->shown_ctrls = enabled_ctrls;
+
+        if (!enabled_ctrls)
         {
             gtk_widget_show (sapplet->idlefoo);
         }
@@ -996,7 +1013,7 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
             gtk_widget_hide (sapplet->idlefoo);
         }
 
-        if (sapplet->xkb->ctrls->enabled_ctrls & XkbMouseKeysMask)
+        if (enabled_ctrls & XkbMouseKeysMask)
         {
             gtk_widget_show (sapplet->mousefoo);
         }
@@ -1005,7 +1022,7 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
             gtk_widget_hide (sapplet->mousefoo);
         }
 
-        if (sapplet->xkb->ctrls->enabled_ctrls & XkbStickyKeysMask)
+        if (enabled_ctrls & XkbStickyKeysMask)
         {
             gtk_widget_show (sapplet->stickyfoo);
         }
@@ -1014,7 +1031,7 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
             gtk_widget_hide (sapplet->stickyfoo);
         }
 
-        if (sapplet->xkb->ctrls->enabled_ctrls & XkbSlowKeysMask)
+        if (enabled_ctrls & XkbSlowKeysMask)
         {
             gtk_widget_show (sapplet->slowfoo);
         }
@@ -1023,7 +1040,7 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
             gtk_widget_hide (sapplet->slowfoo);
         }
 
-        if (sapplet->xkb->ctrls->enabled_ctrls & XkbBounceKeysMask)
+        if (enabled_ctrls & XkbBounceKeysMask)
         {
             gtk_widget_show (sapplet->bouncefoo);
         }
@@ -1036,6 +1053,79 @@ accessx_status_applet_update (AccessxStatusApplet*    sapplet,
     return;
 }
 
+static gboolean
+accessx_status_applet_update_pending (AccessxStatusApplet* sapplet)
+{
+    int pending = sapplet->pending_notify;
+
+    sapplet->update_id = 0;
+    sapplet->pending_notify = 0;
+
+    if (pending & ACCESSX_STATUS_MODIFIERS)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_MODIFIERS, &sapplet->modifiers_event);
+    }
+
+    if (pending & ACCESSX_STATUS_SLOWKEYS)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_SLOWKEYS, &sapplet->slowkeys_event);
+    }
+
+    if (pending & ACCESSX_STATUS_BOUNCEKEYS)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_BOUNCEKEYS, &sapplet->bouncekeys_event);
+    }
+
+    if (pending & ACCESSX_STATUS_MOUSEKEYS)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_MOUSEKEYS, &sapplet->mousekeys_event);
+    }
+
+    if (pending & ACCESSX_STATUS_ENABLED)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_ENABLED, NULL);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+/* A burst of events, as from typing with sticky keys, is shown by one
+ * update once the events are handled, before the next frame is drawn */
+static void
+accessx_status_applet_queue_update (AccessxStatusApplet*    sapplet,
+                                    AccessxStatusNotifyType notify_type,
+                                    XkbEvent*               event)
+{
+    if (notify_type & ACCESSX_STATUS_MODIFIERS)
+    {
+        sapplet->modifiers_event = *event;
+    }
+
+    if (notify_type & ACCESSX_STATUS_SLOWKEYS)
+    {
+        sapplet->slowkeys_event = *event;
+    }
+
+    if (notify_type & ACCESSX_STATUS_BOUNCEKEYS)
+    {
+        sapplet->bouncekeys_event = *event;
+    }
+
+    if (notify_type & ACCESSX_STATUS_MOUSEKEYS)
+    {
+        sapplet->mousekeys_event = *event;
+    }
+
+    sapplet->pending_notify |= notify_type;
+
+    if (sapplet->pending_notify && sapplet->update_id == 0)
+    {
+        sapplet->update_id = g_idle_add_full (GDK_PRIORITY_REDRAW - 1,
+                                              (GSourceFunc) accessx_status_applet_update_pending,
+                                              sapplet, NULL);
+    }
+}
+
 static void
 accessx_status_applet_notify_xkb_ax (AccessxStatusApplet*   sapplet,
                                      XkbAccessXNotifyEvent* event)
@@ -1060,9 +1150,9 @@ accessx_status_applet_notify_xkb_ax (AccessxStatusApplet*   sapplet,
             break;
     }
 
-    accessx_status_applet_update (sapplet,
-                                  notify_mask,
-                                  (XkbEvent*) event);
+    accessx_status_applet_queue_update (sapplet,
+                                        notify_mask,
+                                        (XkbEvent*) event);
 }
 
 static void
@@ -1081,9 +1171,9 @@ accessx_status_applet_notify_xkb_state (AccessxStatusApplet* sapplet,
         notify_mask |= ACCESSX_STATUS_MODIFIERS;
     }
 
-    accessx_status_applet_update (sapplet,
-                                  notify_mask,
-                                  (XkbEvent*) event);
+    accessx_status_applet_queue_update (sapplet,
+                                        notify_mask,
+                                        (XkbEvent*) event);
 }
 
 static void
@@ -1097,14 +1187,14 @@ accessx_status_applet_notify_xkb_device (AccessxStatusApplet*           sapplet,
             gtk_widget_set_sensitive (sapplet->alt_graph_indicator, TRUE);
             accessx_status_applet_set_state_icon (sapplet,
                                                   &modifiers[modifier_Mod5],
-                                                  GTK_STATE_FLAG_NORMAL);
+                                                  modifier_state_Latched);
         }
         else
         {
             gtk_widget_set_sensitive (sapplet->alt_graph_indicator, FALSE);
             accessx_status_applet_set_state_icon (sapplet,
                                                   &modifiers[modifier_Mod5],
-                                                  GTK_STATE_FLAG_INSENSITIVE);
+                                                  modifier_state_None);
         }
     }
 }
@@ -1130,7 +1220,7 @@ accessx_status_applet_notify_xkb_controls (AccessxStatusApplet*    sapplet,
 
     if (notify_mask)
     {
-        accessx_status_applet_update (sapplet, notify_mask, (XkbEvent*) event);
+        accessx_status_applet_queue_update (sapplet, notify_mask, (XkbEvent*) event);
     }
 }
 
@@ -1236,6 +1326,8 @@ accessx_status_applet_layout_box (AccessxStatusApplet* sapplet,
     gtk_container_add (GTK_CONTAINER (sapplet->applet), box);
     sapplet->stickyfoo = stickyfoo;
     sapplet->box = box;
+    /* the new box of the sticky keys is not shown yet */
+    sapplet->ctrls_shown = FALSE;
 
     atko = gtk_widget_get_accessible (sapplet->box);
     atk_object_set_name (atko, _("AccessX Status"));
@@ -1455,6 +1547,15 @@ accessx_status_applet_destroy (GtkWidget* widget,
 
     gdk_window_remove_filter (NULL, accessx_status_xkb_filter, sapplet);
 
+    if (sapplet->update_id != 0)
+    {
+        g_source_remove (sapplet->update_id);
+        sapplet->update_id = 0;
+    }
+
+    g_signal_handlers_disconnect_by_data (gtk_icon_theme_get_default (), sapplet);
+    accessx_status_applet_clear_modifier_surfaces ();
+
     if (sapplet->xkb)
     {
         XkbFreeKeyboard (sapplet->xkb, 0, True);
@@ -1502,6 +1603,7 @@ accessx_status_applet_resize (GtkWidget* widget,
     GtkIconTheme *icon_theme = gtk_icon_theme_get_default ();
     gint icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (sapplet->applet));
 
+    accessx_status_applet_clear_modifier_surfaces ();
     accessx_status_applet_update (sapplet, ACCESSX_STATUS_ALL, NULL);
 
     surface = accessx_status_applet_slowkeys_image (sapplet, NULL);
@@ -1525,6 +1627,18 @@ accessx_status_applet_resize (GtkWidget* widget,
     cairo_surface_destroy (surface);
 }
 
+/* the scale factor, the icon theme or the font changed */
+static void
+accessx_status_applet_style_changed (AccessxStatusApplet* sapplet)
+{
+    accessx_status_applet_clear_modifier_surfaces ();
+
+    if (sapplet->initialized)
+    {
+        accessx_status_applet_update (sapplet, ACCESSX_STATUS_MODIFIERS, NULL);
+    }
+}
+
 static gboolean
 button_press_cb (GtkWidget*           widget,
                  GdkEventButton*      event,
@@ -1648,6 +1762,18 @@ accessx_status_applet_fill (MatePanelApplet* applet)
                       G_CALLBACK (key_press_cb),
                       sapplet);
 
+    g_signal_connect_swapped (sapplet->applet, "style-updated",
+                              G_CALLBACK (accessx_status_applet_style_changed),
+                              sapplet);
+
+    g_signal_connect_swapped (sapplet->applet, "notify::scale-factor",
+                              G_CALLBACK (accessx_status_applet_style_changed),
+                              sapplet);
+
+    g_signal_connect_swapped (gtk_icon_theme_get_default (), "changed",
+                              G_CALLBACK (accessx_status_applet_style_changed),
+                              sapplet);
+
     action_group = gtk_action_group_new ("Accessx Applet Actions");
     gtk_action_group_set_translation_domain (action_group, GETTEXT_PACKAGE);
     gtk_action_group_add_actions (action_group,
@@ -102,6 +102,16 @@ typedef struct {
     XkbDescRec* xkb;
     Display* xkb_display;
     AccessxStatusErrorType error_type;
+    /* the XKB events since the last update, the latest of each kind */
+    guint update_id;
+    int pending_notify;
+    XkbEvent modifiers_event;
+    XkbEvent slowkeys_event;
+    XkbEvent bouncekeys_event;
+    XkbEvent mousekeys_event;
+    /* the controls the indicators were last shown for */
+    gboolean ctrls_shown;
+    unsigned int shown_ctrls;
 } AccessxStatusApplet;
 
 typedef enum {
@@ -113,4 +123,11 @@ typedef enum {
     ACCESSX_STATUS_ALL = 0xFFFF
 } AccessxStatusNotifyType;
 
+/* The glyph over the icon base, in the font of widget at twice its size;
+ * also for accessx-bench */
+G_GNUC_INTERNAL GdkPixbuf* accessx_status_applet_get_glyph_pixbuf (GtkWidget* widget,
+                                                                   GdkPixbuf* base,
+                                                                   GdkRGBA*   fg,
+                                                                   gchar*     glyphstring);
+
 #endif
@@ -34,6 +34,7 @@
 #include <glib.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -42,28 +43,44 @@
 #include <errno.h>
 #include <unistd.h>
 #include <dirent.h>
+#include "common/sampler-file.h"
 #include "acpi-linux.h"
 
-static GHashTable*
-read_file (const char* file, char* buf, size_t bufsize)
+/* A key wanted from a /proc/acpi file, and where its value was found */
+typedef struct
 {
-    GHashTable* hash = NULL;
+    const char *key;
+    const char *value;
+} acpi_field;
+
+/* Reads file into buf and looks up the fields in one pass, without
+ * allocating.  Keys are matched ignoring case, since acpi 20020214
+ * switched to lower-case proc entries.  The values point into buf with
+ * the surrounding white space cut off, and are NULL for the keys that
+ * are not in the file. */
+static gboolean
+read_fields (const char *file, char *buf, size_t bufsize,
+             acpi_field *fields, int n_fields)
+{
+    int fd, i;
+    ssize_t len;
+    char *line, *end;
 
-    int fd, len, i;
-    char* key;
-    char* value;
-    gboolean reading_key;
+    for (i = 0; i < n_fields; i++)
+        fields[i].value = NULL;
 
-    fd = open (file, O_RDONLY);
+    /* through the samplers, so that captures of them include the battery */
+    fd = sampler_open (file);
 
     if (fd == -1)
     {
-        return hash;
+        return FALSE;
     }
 
-    len = read (fd, buf, bufsize);
+    len = sampler_pread (&fd, buf, bufsize);
 
-    close (fd);
+    if (fd >= 0)
+        close (fd);
 
     if (len < 0)
     {
@@ -72,82 +89,50 @@ read_file (const char* file, char* buf, size_t bufsize)
             g_message ("Error reading %s: %s", file, g_strerror (errno));
         }
 
-        return hash;
+        return FALSE;
     }
 
-    hash = g_hash_table_new (g_str_hash, g_str_equal);
+    buf[len] = '\0';
 
-    for (i = 0, value = key = buf, reading_key = TRUE; i < len; i++)
+    for (line = buf; line < buf + len; line = end + 1)
     {
-        if (buf[i] == ':' && reading_key)
-        {
-            reading_key = FALSE;
-            buf[i] = '\0';
-            value = buf + i + 1;
-        }
-        else if (buf[i] == '\n')
-        {
-            reading_key = TRUE;
-            buf[i] = '\0';
-            /* g_message ("Read: %s => %s\n", key, value); */
-            g_hash_table_insert (hash, key, g_strstrip (value));
-            key = buf + i + 1;
-        }
-        else if (reading_key)
-        {
-            /* in acpi 20020214 it switched to lower-case proc
-             * entries.  fixing this up here simplifies the
-             * code.
-             */
-            buf[i] = g_ascii_tolower (buf[i]);
-        }
-    }
-
-    return hash;
-}
-
-#if 0
-static gboolean
-read_bool (GHashTable *hash, const char *key)
-{
-    char *s;
-
-    g_return_val_if_fail (hash, FALSE);
-    g_return_val_if_fail (key, FALSE);
-
-    s = g_hash_table_lookup (hash, key);
-    return s && (*s == 'y');
-}
-#endif
+        char *colon, *value;
+        size_t key_len;
 
-static long
-read_long (GHashTable *hash, const char *key)
-{
-    char* s;
+        end = strchr (line, '\n');
+        if (!end)
+            end = buf + len;
+        *end = '\0';
 
-    g_return_val_if_fail (hash, 0);
-    g_return_val_if_fail (key, 0);
+        colon = strchr (line, ':');
+        if (!colon)
+            continue;
+        key_len = colon - line;
 
-    s = g_hash_table_lookup (hash, key);
-    return s ? strtol (s, NULL, 10) : 0;
-}
+        for (i = 0; i < n_fields; i++)
+        {
+            if (!fields[i].value &&
+                strlen (fields[i].key) == key_len &&
+                g_ascii_strncasecmp (line, fields[i].key, key_len) == 0)
+                break;
+        }
 
-static gulong
-read_ulong (GHashTable *hash, const char *key)
-{
-  char *s;
+        if (i == n_fields)
+            continue;
 
-    g_return_val_if_fail (hash, 0);
-    g_return_val_if_fail (key, 0);
+        for (value = colon + 1; g_ascii_isspace (*value); value++);
+        for (colon = end; colon > value && g_ascii_isspace (colon[-1]); colon--);
+        *colon = '\0';
+        fields[i].value = value;
+    }
 
-    s = g_hash_table_lookup (hash, key);
-    return s ? strtoul (s, NULL, 10) : 0;
+    return TRUE;
 }
 
-static const char *
-read_string (GHashTable *hash, const char *key)
+static long
+field_long (const acpi_field *field)
 {
-    return g_hash_table_lookup (hash, key);
+    return field->value ? strtol (field->value, NULL, 10) : 0;
 }
 
 /* Reads the current status of the AC adapter and stores the
@@ -155,11 +140,11 @@ read_string (GHashTable *hash, const char *key)
 static gboolean
 update_ac_info (struct acpi_info * acpiinfo)
 {
-    gchar *ac_state = NULL;
+    char ac_state[PATH_MAX];
     DIR * procdir;
     struct dirent * procdirentry;
     char buf[BUFSIZ];
-    GHashTable *hash;
+    acpi_field field = { acpiinfo->ac_state_state, NULL };
     gboolean have_adaptor = FALSE;
 
     acpiinfo->ac_online = FALSE;
@@ -173,20 +158,13 @@ update_ac_info (struct acpi_info * acpiinfo)
         if (procdirentry->d_name[0]!='.')
         {
             have_adaptor = TRUE;
-            ac_state = g_strconcat ("/proc/acpi/ac_adapter/",
-                                    procdirentry->d_name,
-                                    "/",
-                                    acpiinfo->ac_state_state,
-                                    NULL);
-            hash = read_file (ac_state, buf, sizeof (buf));
-            if (hash && !acpiinfo->ac_online)
-            {
-                const char *s;
-                s = read_string (hash, acpiinfo->ac_state_state);
-                acpiinfo->ac_online = s ? (strcmp (s, "on-line") == 0) : 0;
-                g_hash_table_destroy (hash);
-           }
-           g_free (ac_state);
+            if (acpiinfo->ac_online)
+                continue;
+
+            g_snprintf (ac_state, sizeof (ac_state), "/proc/acpi/ac_adapter/%s/%s",
+                        procdirentry->d_name, acpiinfo->ac_state_state);
+            if (read_fields (ac_state, buf, sizeof (buf), &field, 1))
+                acpiinfo->ac_online = field.value ? (strcmp (field.value, "on-line") == 0) : 0;
         }
     }
 
@@ -206,15 +184,22 @@ update_ac_info (struct acpi_info * acpiinfo)
 static gboolean
 update_battery_info (struct acpi_info* acpiinfo)
 {
-    gchar* batt_info = NULL;
-    GHashTable* hash;
+    char batt_info[PATH_MAX];
     DIR* procdir;
     struct dirent* procdirentry;
     char buf[BUFSIZ];
+    acpi_field fields[] = {
+        { "last full capacity", NULL },
+        { "design capacity warning", NULL },
+        { "design capacity low", NULL },
+        { "design capacity", NULL },
+        { "cycle count", NULL }
+    };
 
     acpiinfo->max_capacity = 0;
     acpiinfo->low_capacity = 0;
     acpiinfo->critical_capacity = 0;
+    acpiinfo->n_batteries = 0;
 
     procdir = opendir ("/proc/acpi/battery/");
 
@@ -227,18 +212,29 @@ update_battery_info (struct acpi_info* acpiinfo)
     {
         if (procdirentry->d_name[0] != '.')
         {
-            batt_info = g_strconcat ("/proc/acpi/battery/", procdirentry->d_name, "/info", NULL);
-            hash = read_file (batt_info, buf, sizeof (buf));
+            g_snprintf (batt_info, sizeof (batt_info), "/proc/acpi/battery/%s/info",
+                        procdirentry->d_name);
 
-            if (hash)
+            if (read_fields (batt_info, buf, sizeof (buf), fields, G_N_ELEMENTS (fields)))
             {
-                acpiinfo->max_capacity += read_long (hash, "last full capacity");
-                acpiinfo->low_capacity += read_long (hash, "design capacity warning");
-                acpiinfo->critical_capacity += read_long (hash, "design capacity low");
+                acpiinfo->max_capacity += field_long (&fields[0]);
+                acpiinfo->low_capacity += field_long (&fields[1]);
+                acpiinfo->critical_capacity += field_long (&fields[2]);
 
-                g_hash_table_destroy (hash);
+                if (acpiinfo->n_batteries < ACPI_BATTERY_MAX)
+                {
+                    struct acpi_battery *battery = &acpiinfo->batteries[acpiinfo->n_batteries++];
+
+                    g_strlcpy (battery->name, procdirentry->d_name, sizeof (battery->name));
+                    battery->full_capacity = field_long (&fields[0]);
+                    battery->design_capacity = field_long (&fields[3]);
+                    battery->cycle_count = fields[4].value ? field_long (&fields[4]) : -1;
+                    if (battery->cycle_count == 0)
+                        battery->cycle_count = -1;
+                    battery->energy = fields[0].value && strstr (fields[0].value, "mWh");
+                    battery->present = FALSE;
+                }
             }
-            g_free (batt_info);
         }
     }
 
@@ -255,9 +251,9 @@ update_battery_info (struct acpi_info* acpiinfo)
 gboolean
 acpi_linux_init (struct acpi_info * acpiinfo)
 {
-    GHashTable *hash;
     char buf[BUFSIZ];
     gchar *pbuf;
+    acpi_field field = { "version", NULL };
     gulong acpi_ver;
     int fd;
 
@@ -266,9 +262,8 @@ acpi_linux_init (struct acpi_info * acpiinfo)
     if (g_file_get_contents ("/sys/module/acpi/parameters/acpica_version", &pbuf, NULL, NULL)) {
         acpi_ver = strtoul (pbuf, NULL, 10);
         g_free (pbuf);
-    } else if ((hash = read_file ("/proc/acpi/info", buf, sizeof (buf)))) {
-        acpi_ver = read_ulong (hash, "version");
-        g_hash_table_destroy (hash);
+    } else if (read_fields ("/proc/acpi/info", buf, sizeof (buf), &field, 1)) {
+        acpi_ver = field.value ? strtoul (field.value, NULL, 10) : 0;
     } else
         return FALSE;
 
@@ -397,11 +392,16 @@ acpi_linux_read (struct apm_info *apminfo, struct acpi_info * acpiinfo)
     guint32 remain;
     guint32 rate;
     gboolean charging;
-    GHashTable *hash;
-    gchar* batt_state = NULL;
+    char batt_state[PATH_MAX];
     DIR * procdir;
     struct dirent * procdirentry;
     char buf[BUFSIZ];
+    int i;
+    acpi_field fields[] = {
+        { acpiinfo->charging_state, NULL },
+        { "remaining capacity", NULL },
+        { "present rate", NULL }
+    };
 
     g_assert (acpiinfo);
 
@@ -418,6 +418,9 @@ acpi_linux_read (struct apm_info *apminfo, struct acpi_info * acpiinfo)
     remain = 0;
     rate = 0;
 
+    for (i = 0; i < acpiinfo->n_batteries; i++)
+        acpiinfo->batteries[i].present = FALSE;
+
     procdir=opendir ("/proc/acpi/battery/");
     if (!procdir)
         return FALSE;
@@ -429,25 +432,32 @@ acpi_linux_read (struct apm_info *apminfo, struct acpi_info * acpiinfo)
     {
         if (procdirentry->d_name[0]!='.')
         {
-            batt_state = g_strconcat ("/proc/acpi/battery/",
-                                      procdirentry->d_name,
-                                      "/",
-                                      acpiinfo->batt_state_state,
-                                      NULL);
-            hash = read_file (batt_state, buf, sizeof (buf));
-            if (hash)
+            g_snprintf (batt_state, sizeof (batt_state), "/proc/acpi/battery/%s/%s",
+                        procdirentry->d_name, acpiinfo->batt_state_state);
+            if (read_fields (batt_state, buf, sizeof (buf), fields, G_N_ELEMENTS (fields)))
             {
-                const char *s;
-                if (!charging)
+                gboolean battery_charging;
+
+                battery_charging = fields[0].value && strcmp (fields[0].value, "charging") == 0;
+                charging = charging || battery_charging;
+                remain += field_long (&fields[1]);
+                rate += field_long (&fields[2]);
+
+                /* kept for the breakdown, by the name of the info read */
+                for (i = 0; i < acpiinfo->n_batteries; i++)
                 {
-                    s = read_string (hash, acpiinfo->charging_state);
-                    charging = s ? (strcmp (s, "charging") == 0) : 0;
+                    struct acpi_battery *battery = &acpiinfo->batteries[i];
+
+                    if (strcmp (battery->name, procdirentry->d_name) == 0)
+                    {
+                        battery->present = TRUE;
+                        battery->charging = battery_charging;
+                        battery->remain = field_long (&fields[1]);
+                        battery->rate = field_long (&fields[2]);
+                        break;
+                    }
                 }
-                remain += read_long (hash, "remaining capacity");
-                rate += read_long (hash, "present rate");
-                g_hash_table_destroy (hash);
             }
-            g_free (batt_state);
         }
     }
     closedir (procdir);
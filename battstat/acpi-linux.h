@@ -21,6 +21,22 @@
 #ifndef __ACPI_LINUX_H__
 #define __ACPI_LINUX_H__
 
+#define ACPI_BATTERY_MAX 8
+
+struct acpi_battery {
+    char      name[32];
+    /* from the info file, read on battery events */
+    int       full_capacity;
+    int       design_capacity;
+    int       cycle_count;    /* -1 when unknown */
+    gboolean  energy;         /* the capacities are in mWh, not mAh */
+    /* of the last read */
+    gboolean  present;
+    gboolean  charging;
+    int       remain;
+    int       rate;
+};
+
 struct acpi_info {
     const char *ac_state_state, *batt_state_state, *charging_state;
     gboolean  ac_online;
@@ -29,6 +45,8 @@ struct acpi_info {
     int       low_capacity;
     int       critical_capacity;
     GIOChannel  * channel;
+    struct acpi_battery batteries[ACPI_BATTERY_MAX];
+    int       n_batteries;
 };
 
 gboolean acpi_linux_read (struct apm_info *apminfo, struct acpi_info * acpiinfo);
@@ -0,0 +1,130 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "battstat-estimator.h"
+
+/* the time constant of the average */
+#define ESTIMATOR_TAU (5 * 60 * G_USEC_PER_SEC)
+
+/* a draw further than this many average deviations away is an outlier */
+#define ESTIMATOR_OUTLIER_FACTOR 3.0
+
+/* the deviation taken at least, relative to the average, so that a
+ * steady draw does not make every small change an outlier */
+#define ESTIMATOR_MIN_DEVIATION 0.05
+
+/* how many outliers in a row make the new level of the draw */
+#define ESTIMATOR_SHIFT 3
+
+void
+battstat_estimator_reset (BattstatEstimator *estimator)
+{
+    memset (estimator, 0, sizeof (BattstatEstimator));
+}
+
+/* Starts the average over from the last n draws */
+static void
+estimator_restart (BattstatEstimator *estimator,
+                   int                n,
+                   gint64             now)
+{
+    double sum = 0, distance = 0;
+    int i;
+
+    for (i = 1; i <= n; i++)
+        sum += estimator->draws[(estimator->next - i + BATTSTAT_ESTIMATOR_SAMPLES) %
+                                BATTSTAT_ESTIMATOR_SAMPLES];
+    estimator->average = sum / n;
+
+    for (i = 1; i <= n; i++)
+        distance += fabs (estimator->draws[(estimator->next - i + BATTSTAT_ESTIMATOR_SAMPLES) %
+                                           BATTSTAT_ESTIMATOR_SAMPLES] - estimator->average);
+    estimator->deviation = distance / n;
+
+    estimator->rejected = 0;
+    estimator->time = now;
+}
+
+void
+battstat_estimator_add (BattstatEstimator *estimator,
+                        int                percent,
+                        int                minutes)
+{
+    gint64 now = g_get_monotonic_time ();
+    double draw, distance, alpha;
+
+    if (percent <= 0 || minutes <= 0)
+        return;
+
+    draw = percent * 60.0 / minutes;
+
+    estimator->draws[estimator->next] = draw;
+    estimator->next = (estimator->next + 1) % BATTSTAT_ESTIMATOR_SAMPLES;
+    estimator->n_draws = MIN (estimator->n_draws + 1, BATTSTAT_ESTIMATOR_SAMPLES);
+
+    if (estimator->average <= 0)
+    {
+        estimator_restart (estimator, 1, now);
+        return;
+    }
+
+    distance = fabs (draw - estimator->average);
+
+    if (distance > ESTIMATOR_OUTLIER_FACTOR *
+                   MAX (estimator->deviation, ESTIMATOR_MIN_DEVIATION * estimator->average))
+    {
+        /* the load changed for good */
+        if (++estimator->rejected >= ESTIMATOR_SHIFT)
+            estimator_restart (estimator, ESTIMATOR_SHIFT, now);
+        return;
+    }
+
+    /* readings closer together weigh less each */
+    alpha = 1.0 - exp (-(double) (now - estimator->time) / ESTIMATOR_TAU);
+    estimator->average += alpha * (draw - estimator->average);
+    estimator->deviation += alpha * (distance - estimator->deviation);
+    estimator->rejected = 0;
+    estimator->time = now;
+}
+
+int
+battstat_estimator_get_minutes (BattstatEstimator *estimator,
+                                int                percent,
+                                double            *confidence)
+{
+    double spread;
+
+    if (estimator->average <= 0 || percent <= 0)
+    {
+        *confidence = 0;
+        return -1;
+    }
+
+    spread = estimator->deviation / estimator->average;
+    *confidence = (double) estimator->n_draws / BATTSTAT_ESTIMATOR_SAMPLES *
+                  (1.0 - MIN (spread, 1.0));
+
+    return (int) floor (percent * 60.0 / estimator->average + 0.5);
+}
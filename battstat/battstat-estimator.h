@@ -0,0 +1,60 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _battstat_estimator_h_
+#define _battstat_estimator_h_
+
+#include <glib.h>
+
+/* Smooths the time left on battery.
+ *
+ * The backends compute the minutes left from the rate of discharge at
+ * the moment, which jumps with the load.  Every reading gives a draw, in
+ * percent of the full battery per hour, that goes into an exponentially
+ * weighted moving average with a time constant of a few minutes.  Draws
+ * far from the average are left out, unless several in a row agree, as
+ * when the load changed for good.  The last draws are kept in a small
+ * ring for this.  A sample costs a few floating point operations.
+ */
+
+#define BATTSTAT_ESTIMATOR_SAMPLES 16
+
+typedef struct
+{
+  double draws[BATTSTAT_ESTIMATOR_SAMPLES];
+  int    n_draws;
+  int    next;
+  int    rejected;   /* draws left out in a row */
+  double average;    /* of the draws taken in, 0 without any */
+  double deviation;  /* average distance of these to the average */
+  gint64 time;       /* of the last draw taken in */
+} BattstatEstimator;
+
+void battstat_estimator_reset (BattstatEstimator *estimator);
+void battstat_estimator_add (BattstatEstimator *estimator,
+                             int                percent,
+                             int                minutes);
+
+/* Returns the smoothed minutes left with percent left, -1 without an
+ * estimate.  confidence is set between 0, for nothing to go by, and 1,
+ * for a full ring of draws that agree. */
+int battstat_estimator_get_minutes (BattstatEstimator *estimator,
+                                    int                percent,
+                                    double            *confidence);
+
+#endif /* _battstat_estimator_h_ */
@@ -0,0 +1,239 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "battstat-history.h"
+
+#define HISTORY_MAGIC   0x42534849 /* "BSHI" */
+#define HISTORY_VERSION 1
+
+/* seconds between two records of the same status */
+#define HISTORY_INTERVAL 60
+
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  guint32 records;
+  guint32 record_size;
+} HistoryHeader;
+
+struct _BattstatHistory
+{
+  int            fd;
+  gboolean       writable;
+  gsize          size;
+  HistoryHeader *header;
+  const BattstatHistoryRecord *records;
+  guint          next;    /* the slot written next, holding the oldest record */
+  gint64         last_time;
+  guint8         last_flags;
+};
+
+static gboolean
+history_header_is_valid (const HistoryHeader *header)
+{
+  return header->magic == HISTORY_MAGIC &&
+         header->version == HISTORY_VERSION &&
+         header->records == BATTSTAT_HISTORY_RECORDS &&
+         header->record_size == sizeof (BattstatHistoryRecord);
+}
+
+/* The slot after the newest record */
+static guint
+history_find_next (BattstatHistory *history)
+{
+  gint64 newest = 0;
+  guint i, next = 0;
+
+  for (i = 0; i < BATTSTAT_HISTORY_RECORDS; i++)
+  {
+    if (history->records[i].time > newest)
+    {
+      newest = history->records[i].time;
+      next = (i + 1) % BATTSTAT_HISTORY_RECORDS;
+    }
+  }
+
+  return next;
+}
+
+BattstatHistory *
+battstat_history_open (gboolean writable)
+{
+  BattstatHistory *history;
+  HistoryHeader header;
+  gchar *dir, *path;
+  struct stat st;
+  gpointer mapping;
+
+  history = g_new0 (BattstatHistory, 1);
+  history->fd = -1;
+  history->size = sizeof (HistoryHeader) +
+                  BATTSTAT_HISTORY_RECORDS * sizeof (BattstatHistoryRecord);
+
+  dir = g_build_filename (g_get_user_data_dir (), "mate-battstat", NULL);
+  path = g_build_filename (dir, "history", NULL);
+
+  if (writable)
+  {
+    g_mkdir_with_parents (dir, 0700);
+    history->fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  }
+  else
+    history->fd = open (path, O_RDONLY | O_CLOEXEC);
+
+  if (history->fd < 0)
+  {
+    if (writable || errno != ENOENT)
+      g_debug ("Failed to open %s: %s", path, g_strerror (errno));
+    goto out;
+  }
+
+  /* another applet may be keeping the history already */
+  history->writable = writable && flock (history->fd, LOCK_EX | LOCK_NB) == 0;
+
+  if (fstat (history->fd, &st) < 0)
+    goto fail;
+
+  if ((gsize) st.st_size != history->size ||
+      pread (history->fd, &header, sizeof (header), 0) != sizeof (header) ||
+      !history_header_is_valid (&header))
+  {
+    if (!history->writable)
+      goto fail;
+
+    /* a file of another layout starts over, zeroed */
+    header.magic = HISTORY_MAGIC;
+    header.version = HISTORY_VERSION;
+    header.records = BATTSTAT_HISTORY_RECORDS;
+    header.record_size = sizeof (BattstatHistoryRecord);
+    if (ftruncate (history->fd, 0) < 0 ||
+        ftruncate (history->fd, (off_t) history->size) < 0 ||
+        pwrite (history->fd, &header, sizeof (header), 0) != sizeof (header))
+      goto fail;
+  }
+
+  mapping = mmap (NULL, history->size, PROT_READ, MAP_SHARED, history->fd, 0);
+  if (mapping == MAP_FAILED)
+    goto fail;
+
+  history->header = mapping;
+  history->records = (const BattstatHistoryRecord *) (history->header + 1);
+  history->next = history_find_next (history);
+  goto out;
+
+fail:
+  g_debug ("Failed to map %s: %s", path, g_strerror (errno));
+  close (history->fd);
+  history->fd = -1;
+  history->writable = FALSE;
+
+out:
+  g_free (path);
+  g_free (dir);
+
+  return history;
+}
+
+void
+battstat_history_close (BattstatHistory *history)
+{
+  if (!history)
+    return;
+
+  if (history->header)
+    munmap (history->header, history->size);
+
+  /* closing the file also drops the lock */
+  if (history->fd >= 0)
+    close (history->fd);
+
+  g_free (history);
+}
+
+void
+battstat_history_add (BattstatHistory     *history,
+                      const BatteryStatus *status)
+{
+  BattstatHistoryRecord record;
+  gint64 now;
+  off_t offset;
+
+  if (!history->writable || !status->present)
+    return;
+
+  memset (&record, 0, sizeof (record));
+  if (status->on_ac_power == POWER_STATUS_ON)
+    record.flags |= BATTSTAT_HISTORY_ON_AC;
+  if (status->charging == POWER_STATUS_ON)
+    record.flags |= BATTSTAT_HISTORY_CHARGING;
+
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  if (history->last_time &&
+      record.flags == history->last_flags &&
+      now - history->last_time < HISTORY_INTERVAL &&
+      now >= history->last_time)
+    return;
+
+  record.time = now;
+  record.energy = (guint32) (status->energy * 1000 + 0.5);
+  record.energy_full = (guint32) (status->energy_full * 1000 + 0.5);
+  record.power = (guint32) (status->energy_rate * 1000 + 0.5);
+  record.percent = (guint8) CLAMP (status->percent, 0, 100);
+
+  offset = sizeof (HistoryHeader) + (off_t) history->next * sizeof (record);
+  if (pwrite (history->fd, &record, sizeof (record), offset) != sizeof (record))
+  {
+    g_debug ("Failed to write the battery history: %s", g_strerror (errno));
+    return;
+  }
+
+  history->next = (history->next + 1) % BATTSTAT_HISTORY_RECORDS;
+  history->last_time = now;
+  history->last_flags = record.flags;
+}
+
+const BattstatHistoryRecord *
+battstat_history_get_records (BattstatHistory *history,
+                              guint           *first)
+{
+  if (!history->records)
+    return NULL;
+
+  /* a reader does not know where the writer is */
+  if (!history->writable)
+    history->next = history_find_next (history);
+
+  *first = history->next;
+
+  return history->records;
+}
@@ -0,0 +1,69 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _battstat_history_h_
+#define _battstat_history_h_
+
+#include <glib.h>
+
+#include "battstat.h"
+
+/* A ring file of the battery status, in the user data directory.
+ *
+ * The records have a fixed size and are written each with a single
+ * pwrite into their slot, so the file is never rewritten.  Readers map
+ * the file and see the new records as they are written.  Only one
+ * process, the first to lock the file, writes it.
+ */
+
+#define BATTSTAT_HISTORY_RECORDS (60 * 24 * 28) /* four weeks of minutes */
+
+enum
+{
+  BATTSTAT_HISTORY_ON_AC    = 1 << 0,
+  BATTSTAT_HISTORY_CHARGING = 1 << 1
+};
+
+typedef struct
+{
+  gint64  time;        /* seconds since the epoch, 0 for an empty slot */
+  guint32 energy;      /* mWh, 0 when unknown */
+  guint32 energy_full; /* mWh */
+  guint32 power;       /* mW */
+  guint8  percent;
+  guint8  flags;
+  guint16 reserved;
+} BattstatHistoryRecord;
+
+typedef struct _BattstatHistory BattstatHistory;
+
+/* Never returns NULL, a history that can not be opened stays empty */
+BattstatHistory *battstat_history_open (gboolean writable);
+void battstat_history_close (BattstatHistory *history);
+
+/* Records the status once a minute, and right away when it changes
+ * between charging, discharging and on AC. */
+void battstat_history_add (BattstatHistory     *history,
+                           const BatteryStatus *status);
+
+/* Returns the slots of the file, BATTSTAT_HISTORY_RECORDS of them or
+ * NULL.  They are in the order of a ring with the oldest at *first. */
+const BattstatHistoryRecord *battstat_history_get_records (BattstatHistory *history,
+                                                           guint           *first);
+
+#endif /* _battstat_history_h_ */
@@ -45,6 +45,10 @@
 #include <gio/gio.h>
 
 #include "battstat-preferences.h"
+#include "battstat-history.h"
+
+/* records further apart than this are drawn with a gap between them */
+#define HISTORY_GAP (10 * 60)
 
 enum {
   PROP_0,
@@ -64,6 +68,11 @@ struct _BattstatPreferences
   GtkWidget *hbox_ptr;
   GtkWidget *combo_ptr;
   GtkWidget *spin_ptr;
+  GtkWidget *history_toggle;
+  GtkWidget *history_area;
+
+  /* the mapped history file, while it is shown */
+  BattstatHistory *history;
 
   ProgressData *battstat;
 };
@@ -154,6 +163,111 @@ full_toggled (GtkToggleButton *button,
   dialog->battstat->fullbattnot = gtk_toggle_button_get_active (button);
 }
 
+static void
+history_toggled (GtkToggleButton *button,
+                 gpointer         data)
+{
+  BattstatPreferences *dialog = data;
+
+  battstat_set_history (dialog->battstat, gtk_toggle_button_get_active (button));
+  gtk_widget_queue_draw (dialog->history_area);
+}
+
+static void
+history_draw_line (cairo_t                     *cr,
+                   const BattstatHistoryRecord *records,
+                   guint                        first,
+                   gint64                       start,
+                   gint64                       end,
+                   int                          width,
+                   int                          height,
+                   guint32                      energy_max)
+{
+  gint64 last = 0;
+  guint i;
+
+  for (i = 0; i < BATTSTAT_HISTORY_RECORDS; i++) {
+    const BattstatHistoryRecord *record = &records[(first + i) % BATTSTAT_HISTORY_RECORDS];
+    double x, y;
+
+    if (record->time < start || record->time > end)
+      continue;
+
+    if (energy_max) {
+      if (!record->energy_full)
+        continue;
+      y = height - (double) record->energy_full / energy_max * height;
+    } else
+      y = height - record->percent / 100.0 * height;
+
+    x = (double) (record->time - start) / MAX (end - start, 1) * width;
+
+    if (!last || record->time - last > HISTORY_GAP)
+      cairo_move_to (cr, x, y);
+    else
+      cairo_line_to (cr, x, y);
+    last = record->time;
+  }
+
+  cairo_stroke (cr);
+}
+
+/* Draws the charge over all the history kept, and the full capacity
+ * relative to the largest one, to show how the battery wears out. */
+static gboolean
+history_draw (GtkWidget *widget,
+              cairo_t   *cr,
+              gpointer   data)
+{
+  BattstatPreferences *dialog = data;
+  const BattstatHistoryRecord *records;
+  GdkRGBA color;
+  guint first, i;
+  gint64 start = 0, end = 0;
+  guint32 energy_max = 0;
+  int width, height;
+
+  /* the file may have been created since */
+  if (!dialog->history || !battstat_history_get_records (dialog->history, &first)) {
+    battstat_history_close (dialog->history);
+    dialog->history = battstat_history_open (FALSE);
+  }
+
+  records = battstat_history_get_records (dialog->history, &first);
+  if (!records)
+    return FALSE;
+
+  for (i = 0; i < BATTSTAT_HISTORY_RECORDS; i++) {
+    if (!records[i].time)
+      continue;
+    start = start ? MIN (start, records[i].time) : records[i].time;
+    end = MAX (end, records[i].time);
+    energy_max = MAX (energy_max, records[i].energy_full);
+  }
+
+  if (!start)
+    return FALSE;
+
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+
+  gtk_style_context_get_color (gtk_widget_get_style_context (widget),
+                               gtk_widget_get_state_flags (widget), &color);
+  gdk_cairo_set_source_rgba (cr, &color);
+  cairo_set_line_width (cr, 1.0);
+
+  history_draw_line (cr, records, first, start, end, width, height, 0);
+
+  if (energy_max) {
+    static const double dash[] = { 4.0, 2.0 };
+
+    cairo_set_dash (cr, dash, G_N_ELEMENTS (dash), 0);
+    history_draw_line (cr, records, first, start, end, width, height, energy_max);
+  }
+
+  return FALSE;
+}
+
 static void
 response_cb (GtkDialog *dialog,
              gint       id,
@@ -258,6 +372,16 @@ battstat_preferences_get_property (GObject    *object,
   }
 }
 
+static void
+battstat_preferences_finalize (GObject *object)
+{
+  BattstatPreferences *dialog = BATTSTAT_PREFERENCES (object);
+
+  battstat_history_close (dialog->history);
+
+  G_OBJECT_CLASS (battstat_preferences_parent_class)->finalize (object);
+}
+
 static void
 battstat_preferences_init (BattstatPreferences *dialog)
 {
@@ -270,6 +394,10 @@ battstat_preferences_init (BattstatPreferences *dialog)
   g_object_bind_property (dialog->lowbatt_toggle, "active",
                           dialog->hbox_ptr, "sensitive",
                           G_BINDING_DEFAULT);
+
+  g_object_bind_property (dialog->history_toggle, "active",
+                          dialog->history_area, "sensitive",
+                          G_BINDING_SYNC_CREATE);
 }
 
 static GObject*
@@ -294,6 +422,10 @@ battstat_preferences_constructor (GType                  type,
                    self->full_toggle, "active",
                    G_SETTINGS_BIND_DEFAULT);
 
+  g_settings_bind (self->battstat->settings, "history",
+                   self->history_toggle, "active",
+                   G_SETTINGS_BIND_DEFAULT);
+
   return object;
 }
 
@@ -314,6 +446,7 @@ battstat_preferences_class_init (BattstatPreferencesClass *klass)
   object_class->set_property = battstat_preferences_set_property;
   object_class->get_property = battstat_preferences_get_property;
   object_class->constructor  = battstat_preferences_constructor;
+  object_class->finalize     = battstat_preferences_finalize;
 
   g_object_class_install_property (object_class,
                                    PROP_PROGRESS_DATA,
@@ -334,6 +467,8 @@ battstat_preferences_class_init (BattstatPreferencesClass *klass)
   gtk_widget_class_bind_template_child (widget_class, BattstatPreferences, hbox_ptr);
   gtk_widget_class_bind_template_child (widget_class, BattstatPreferences, combo_ptr);
   gtk_widget_class_bind_template_child (widget_class, BattstatPreferences, spin_ptr);
+  gtk_widget_class_bind_template_child (widget_class, BattstatPreferences, history_toggle);
+  gtk_widget_class_bind_template_child (widget_class, BattstatPreferences, history_area);
 
   gtk_widget_class_bind_template_callback (widget_class, lowbatt_toggled);
   gtk_widget_class_bind_template_callback (widget_class, combo_ptr_cb);
@@ -341,4 +476,6 @@ battstat_preferences_class_init (BattstatPreferencesClass *klass)
   gtk_widget_class_bind_template_callback (widget_class, full_toggled);
   gtk_widget_class_bind_template_callback (widget_class, show_text_toggled);
   gtk_widget_class_bind_template_callback (widget_class, response_cb);
+  gtk_widget_class_bind_template_callback (widget_class, history_toggled);
+  gtk_widget_class_bind_template_callback (widget_class, history_draw);
 }
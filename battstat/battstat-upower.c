@@ -33,12 +33,44 @@
 static UpClient *upc;
 static void (*status_updated_callback) (void);
 
-/* status_updated_callback () can not be called directly because at the time of
- * the device-remove signal, the device is not actually removed from the list
- * of devices known to the up_client object (see libupower-glib/up-client.c in
- * upower). Waiting for the next idle timer works around this issue and has has
- * the additionaly benefit of possibly running status_updated_callback only
- * once when several events happen very soon after each other.
+/* The batteries and UPSes known to upc.  Their properties are copied
+ * here as they change and those of the batteries added up in totals, so
+ * that reading the status needs no D-Bus round-trip.
+ */
+typedef struct
+{
+  UpDevice *device;
+  gulong    notify_id;
+  int       kind;
+  gchar    *name;
+  int       state;
+  double    percentage;
+  double    energy;
+  double    energy_full;
+  double    energy_full_design;
+  double    energy_rate;
+  gint64    time_to_full;
+  gint64    time_to_empty;
+  int       charge_cycles;
+} UpowerBattery;
+
+static GPtrArray *batteries;
+
+/* charge-cycles is only there from upower 0.99.14 on */
+static gboolean have_charge_cycles;
+
+static struct
+{
+  double energy;
+  double energy_full;
+  double energy_rate;
+  int    batteries;
+  int    charging;
+  int    discharging;
+} totals;
+
+/* status_updated_callback () is run from the next idle, so that it runs
+ * only once when several events happen very soon after each other.
  */
 static gboolean status_update_scheduled;
 
@@ -61,13 +93,128 @@ schedule_status_callback (void)
   g_idle_add (update_status_idle, NULL);
 }
 
+static void
+battery_account (UpowerBattery *battery, int sign)
+{
+  /* a UPS is listed, but not added to the charge of the system */
+  if (battery->kind != UP_DEVICE_KIND_BATTERY)
+    return;
+
+  totals.energy += sign * battery->energy;
+  totals.energy_full += sign * battery->energy_full;
+  totals.energy_rate += sign * battery->energy_rate;
+
+  if (battery->state == UP_DEVICE_STATE_CHARGING)
+    totals.charging += sign;
+  if (battery->state == UP_DEVICE_STATE_DISCHARGING)
+    totals.discharging += sign;
+}
+
+/* The properties come from the cache of the device proxy */
+static void
+battery_read (UpowerBattery *battery)
+{
+  battery_account (battery, -1);
+
+  g_object_get (battery->device,
+    "state", &battery->state,
+    "percentage", &battery->percentage,
+    "energy", &battery->energy,
+    "energy-full", &battery->energy_full,
+    "energy-full-design", &battery->energy_full_design,
+    "energy-rate", &battery->energy_rate,
+    "time-to-full", &battery->time_to_full,
+    "time-to-empty", &battery->time_to_empty,
+    NULL);
+
+  if (have_charge_cycles)
+    g_object_get (battery->device, "charge-cycles", &battery->charge_cycles, NULL);
+  else
+    battery->charge_cycles = -1;
+
+  battery_account (battery, 1);
+}
+
+static void
+battery_notify_cb (UpDevice *device, GParamSpec *pspec, UpowerBattery *battery)
+{
+  battery_read (battery);
+  schedule_status_callback ();
+}
+
+static void
+battery_free (UpowerBattery *battery)
+{
+  battery_account (battery, -1);
+  if (battery->kind == UP_DEVICE_KIND_BATTERY)
+    totals.batteries--;
+  g_signal_handler_disconnect (battery->device, battery->notify_id);
+  g_object_unref (battery->device);
+  g_free (battery->name);
+  g_free (battery);
+}
+
+static void
+add_device (UpDevice *device)
+{
+  UpowerBattery *battery;
+  gchar *model, *native_path;
+  int type;
+
+  g_object_get (device, "kind", &type, NULL);
+
+  /* Only count batteries here, and list the UPSes along with them */
+  if (type != UP_DEVICE_KIND_BATTERY && type != UP_DEVICE_KIND_UPS)
+    return;
+
+  if (batteries->len == 0)
+    have_charge_cycles = g_object_class_find_property (G_OBJECT_GET_CLASS (device),
+                                                       "charge-cycles") != NULL;
+
+  battery = g_new0 (UpowerBattery, 1);
+  battery->device = g_object_ref (device);
+  battery->kind = type;
+  if (type == UP_DEVICE_KIND_BATTERY)
+    totals.batteries++;
+
+  /* the model does not change, it is read only here */
+  g_object_get (device, "model", &model, "native-path", &native_path, NULL);
+  if (model != NULL && *model != '\0')
+    battery->name = g_steal_pointer (&model);
+  else if (native_path != NULL && *native_path != '\0')
+    battery->name = g_path_get_basename (native_path);
+  else
+    battery->name = g_strdup (up_device_kind_to_string (type));
+  g_free (model);
+  g_free (native_path);
+  battery->notify_id = g_signal_connect (device, "notify",
+                                         G_CALLBACK (battery_notify_cb), battery);
+  battery_read (battery);
+
+  g_ptr_array_add (batteries, battery);
+}
+
 static void
 device_cb (UpClient *client, UpDevice *device, gpointer user_data) {
+  add_device (device);
   schedule_status_callback ();
 }
 
 static void
 device_removed_cb (UpClient *client, const gchar *object_path, gpointer user_data) {
+  guint i;
+
+  for (i = 0; i < batteries->len; i++)
+  {
+    UpowerBattery *battery = g_ptr_array_index (batteries, i);
+
+    if (g_strcmp0 (up_device_get_object_path (battery->device), object_path) == 0)
+    {
+      g_ptr_array_remove_index (batteries, i);
+      break;
+    }
+  }
+
   schedule_status_callback ();
 }
 
@@ -85,10 +232,15 @@ battstat_upower_initialise (void (*callback) (void))
     goto error_out;
 
   GPtrArray *devices;
+  guint i;
   devices = up_client_get_devices2 (upc);
   if (!devices) {
     goto error_shutdownclient;
   }
+
+  batteries = g_ptr_array_new_with_free_func ((GDestroyNotify) battery_free);
+  for (i = 0; i < devices->len; i++)
+    add_device (g_ptr_array_index (devices, i));
   g_ptr_array_unref (devices);
 
   g_signal_connect_after (upc, "device-added", G_CALLBACK (device_cb), NULL);
@@ -109,7 +261,10 @@ battstat_upower_cleanup (void)
 {
   if (upc == NULL)
     return;
-  
+
+  g_ptr_array_unref (batteries);
+  batteries = NULL;
+
   g_object_unref (upc);
   upc = NULL;
 }
@@ -131,9 +286,6 @@ battstat_upower_cleanup (void)
 void
 battstat_upower_get_battery_info (BatteryStatus *status)
 {
-
-  GPtrArray *devices = up_client_get_devices2 (upc);
-
   /* The calculation to get overall percentage power remaining is as follows:
    *
    *    Sum (Current charges) / Sum (Full Capacities)
@@ -142,10 +294,12 @@ battstat_upower_get_battery_info (BatteryStatus *status)
    * doesn't deal with the case that one battery might have a larger
    * capacity than the other.
    *
-   * In order to do this calculation, we need to keep a running total of
-   * current charge and full capacities.
+   * The running totals of current charge and full capacities, and the
+   * total (dis)charge rate of the system, are kept in totals.
    */
-  double current_charge_total = 0, full_capacity_total = 0;
+  double current_charge_total = totals.energy;
+  double full_capacity_total = totals.energy_full;
+  double rate_total = totals.energy_rate;
 
   /* Record the time remaining as reported by upower.  This is used in the event
    * that the system has exactly one battery (since, then, upower is capable
@@ -153,72 +307,50 @@ battstat_upower_get_battery_info (BatteryStatus *status)
    */
   gint64 remaining_time = 0;
 
-  /* The total (dis)charge rate of the system is the sum of the rates of
-   * the individual batteries.
-   */
-  double rate_total = 0;
-
   /* We need to know if we should report the composite battery as present
    * at all.  The logic is that if at least one actual battery is installed
    * then the composite battery will be reported to exist.
    */
-  int present = 0;
+  int present = totals.batteries;
 
   /* We need to know if we are on AC power or not.  Eventually, we can look
    * at the AC adaptor upower devices to determine that.  For now, we assume that
    * if any battery is discharging then we must not be on AC power.  Else, by
    * default, we must be on AC.
    */
-  int on_ac_power = 1;
+  int on_ac_power = totals.discharging == 0;
 
   /* Finally, we consider the composite battery to be "charging" if at least
    * one of the actual batteries in the system is charging.
    */
-  int charging = 0;
-
-  /* For each physical battery bay... */
-  int i;
-  for (i = 0; i < devices->len; i++)
-  {
-    UpDevice *upd = g_ptr_array_index (devices, i);
-
-    int type, state;
-    double current_charge, full_capacity, rate;
-    gint64 time_to_full, time_to_empty;
-
-    g_object_get (upd,
-      "kind", &type,
-      "state", &state,
-      "energy", &current_charge,
-      "energy-full", &full_capacity,
-      "energy-rate", &rate,
-      "time-to-full", &time_to_full,
-      "time-to-empty", &time_to_empty,
-      NULL);
-
-    /* Only count batteries here */
+  int charging = totals.charging > 0;
 
-    if (type != UP_DEVICE_KIND_BATTERY)
-      continue;
+  guint i;
 
-    /* At least one battery present -> composite battery is present. */
-    present++;
-
-    /* At least one battery charging -> composite battery is charging. */
-    if (state == UP_DEVICE_STATE_CHARGING)
-      charging = 1;
-
-    /* At least one battery is discharging -> we're not on AC. */
-    if (state == UP_DEVICE_STATE_DISCHARGING)
-      on_ac_power = 0;
+  for (i = 0; present == 1 && i < batteries->len; i++)
+  {
+    UpowerBattery *battery = g_ptr_array_index (batteries, i);
 
-    /* Sum the totals for current charge, design capacity, (dis)charge rate. */
-    current_charge_total += current_charge;
-    full_capacity_total += full_capacity;
-    rate_total += rate;
+    if (battery->kind == UP_DEVICE_KIND_BATTERY)
+      remaining_time = (battery->state == UP_DEVICE_STATE_DISCHARGING ?
+                        battery->time_to_empty : battery->time_to_full);
+  }
 
-    /* Record remaining time too, incase this is the only battery. */
-    remaining_time = (state == UP_DEVICE_STATE_DISCHARGING ? time_to_empty : time_to_full);
+  /* The breakdown comes from the same cached properties as the totals */
+  status->n_devices = MIN (batteries->len, BATTERY_DEVICES_MAX);
+  for (i = 0; i < status->n_devices; i++)
+  {
+    UpowerBattery *battery = g_ptr_array_index (batteries, i);
+    BatteryDevice *device = &status->devices[i];
+
+    g_strlcpy (device->name, battery->name, sizeof (device->name));
+    device->charging = battery->state == UP_DEVICE_STATE_CHARGING;
+    device->percent = battery->percentage + 0.5;
+    device->energy_rate = battery->energy_rate;
+    device->health = battery->energy_full_design > 0 ?
+                     battery->energy_full / battery->energy_full_design * 100.0 : 0;
+    /* drivers that do not count the cycles mostly say 0 */
+    device->cycle_count = battery->charge_cycles > 0 ? battery->charge_cycles : -1;
   }
 
   if (!present || full_capacity_total <= 0 || (charging && !on_ac_power))
@@ -233,7 +365,6 @@ battstat_upower_get_battery_info (BatteryStatus *status)
     status->on_ac_power = TRUE;
     status->charging = FALSE;
 
-    g_ptr_array_unref (devices);
     return;
   }
 
@@ -300,8 +431,10 @@ battstat_upower_get_battery_info (BatteryStatus *status)
   /* These are simple and well-explained above. */
   status->charging = charging;
   status->on_ac_power = on_ac_power;
-  
-  g_ptr_array_unref (devices);
+
+  status->energy = current_charge_total;
+  status->energy_full = full_capacity_total;
+  status->energy_rate = rate_total;
 }
 
 void
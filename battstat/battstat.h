@@ -29,6 +29,8 @@
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
 
+#include "battstat-estimator.h"
+
 #define DEBUG 0
 
 #define PROGLEN 33.0
@@ -56,6 +58,20 @@ typedef enum
   STATUS_PIXMAP_NUM
 } StatusPixmapIndex;
 
+typedef enum
+{
+  STATUS_ICON_CAUTION,
+  STATUS_ICON_CAUTION_CHARGING,
+  STATUS_ICON_LOW,
+  STATUS_ICON_LOW_CHARGING,
+  STATUS_ICON_GOOD,
+  STATUS_ICON_GOOD_CHARGING,
+  STATUS_ICON_FULL_CHARGING,
+  STATUS_ICON_FULL_CHARGED,
+  STATUS_ICON_FULL,
+  STATUS_ICON_NUM
+} StatusIcon;
+
 typedef enum
 {
   POWER_STATUS_OFF = 0,
@@ -63,6 +79,21 @@ typedef enum
   POWER_STATUS_UNKNOWN
 } PowerStatus;
 
+/* The most batteries listed one by one in the tooltip */
+#define BATTERY_DEVICES_MAX 8
+
+/* One of the batteries added up in a BatteryStatus */
+typedef struct
+{
+  gchar       name[32];
+  PowerStatus charging;
+  gint        percent;
+  /* 0 when the backend does not tell */
+  gdouble     energy_rate; /* W */
+  gdouble     health;      /* full capacity in percent of the design one */
+  gint        cycle_count; /* -1 when the backend does not tell */
+} BatteryDevice;
+
 typedef struct
 {
   PowerStatus on_ac_power;
@@ -70,6 +101,13 @@ typedef struct
   gboolean    present;
   gint        minutes;
   gint        percent;
+  /* 0 when the backend does not tell */
+  gdouble     energy;      /* Wh */
+  gdouble     energy_full; /* Wh */
+  gdouble     energy_rate; /* W */
+  /* the same read one battery at a time, 0 when the backend can not */
+  guint         n_devices;
+  BatteryDevice devices[BATTERY_DEVICES_MAX];
 } BatteryStatus;
 
 typedef enum
@@ -139,6 +177,21 @@ typedef struct _ProgressData {
   int timeout_id;
   int timeout;
 
+  /* the smoothed time left on battery */
+  BattstatEstimator estimator;
+
+  /* the status icons rendered at icons_size and icons_scale, again when
+     these or the icon theme change */
+  cairo_surface_t *icons[STATUS_ICON_NUM];
+  gint icons_size;
+  gint icons_scale;
+  gint shown_icon; /* -1 for none */
+  GtkIconTheme *icon_theme;
+  gulong theme_changed_id;
+
+  /* the battery history being kept, NULL if it is not */
+  struct _BattstatHistory *history;
+
   /* last_* for the benefit of the check_for_updates function */
   guint             last_batt_life;
   StatusPixmapIndex last_pixmap_index;
@@ -152,12 +205,21 @@ typedef struct _ProgressData {
 void reconfigure_layout (ProgressData *battstat);
 void battstat_show_help (ProgressData *battstat, const char *section);
 void prop_cb (GtkAction *, ProgressData *);
+void battstat_set_history (ProgressData *battstat, gboolean enabled);
 
 /* power-management.c */
+typedef enum
+{
+  PM_EVENTS_NONE, /* every change has to be polled */
+  PM_EVENTS_AC,   /* the AC adapter and battery events are reported */
+  PM_EVENTS_ALL   /* every change of the status is reported */
+} PowerManagementEvents;
+
 const char *power_management_getinfo (BatteryStatus *status);
 const char *power_management_initialise (void (*callback) (void));
 void power_management_cleanup (void);
 
 gboolean power_management_using_upower (void);
+PowerManagementEvents power_management_get_events (void);
 
 #endif /* _battstat_h_ */
@@ -44,11 +44,22 @@
 #include <libnotify/notify.h>
 #endif
 
+#include "common/applet-probe.h"
+
 #include "battstat.h"
 #include "battstat-preferences.h"
+#include "battstat-history.h"
 
 #define BATTSTAT_SCHEMA "org.mate.panel.applet.battstat"
 
+/* bounds of the poll interval, in seconds */
+#define POLL_MIN 2
+#define POLL_MAX 60
+#define POLL_MAX_NO_EVENTS 10
+
+/* below this the time left of the backend is shown as it is */
+#define ESTIMATE_MIN_CONFIDENCE 0.25
+
 static gboolean check_for_updates (gpointer data);
 
 static void about_cb (GtkAction *, ProgressData *);
@@ -74,7 +85,6 @@ static const GtkActionEntry battstat_menu_actions [] = {
  * If they are event driven then we know this the first time we
  * receive an event.
  */
-static gboolean event_driven = FALSE;
 static GSList *instances;
 
 static void
@@ -83,19 +93,7 @@ status_change_callback (void)
     GSList *instance;
 
     for (instance = instances; instance; instance = instance->next)
-    {
-        ProgressData *battstat = instance->data;
-
-        if (battstat->timeout_id)
-        {
-            g_source_remove (battstat->timeout_id);
-            battstat->timeout_id = 0;
-        }
-
-        check_for_updates (battstat);
-    }
-
-    event_driven = TRUE;
+        check_for_updates (instance->data);
 }
 
 /* The following two functions keep track of how many instances of the applet
@@ -481,6 +479,37 @@ battery_low_dialog (ProgressData  *battery,
     gtk_widget_show_all (battery->battery_low_dialog);
 }
 
+/* Append a line for each of the batteries that make up info, when there
+   is more than one of them.
+ */
+static void
+append_devices (GString       *text,
+                BatteryStatus *info)
+{
+    guint i;
+
+    if (info->n_devices < 2)
+        return;
+
+    for (i = 0; i < info->n_devices; i++)
+    {
+        BatteryDevice *device = &info->devices[i];
+
+        g_string_append_printf (text, "\n%s: %d%%", device->name, device->percent);
+        if (device->charging == POWER_STATUS_ON)
+            g_string_append_printf (text, ", %s", _("charging"));
+        if (device->energy_rate > 0)
+            g_string_append_printf (text, _(", %.1f W"), device->energy_rate);
+        if (device->health > 0)
+            g_string_append_printf (text, _(", %.0f%% health"), device->health);
+        if (device->cycle_count >= 0)
+            g_string_append_printf (text,
+                                    ngettext (", %d cycle", ", %d cycles",
+                                              device->cycle_count),
+                                    device->cycle_count);
+    }
+}
+
 /* Update the text of the tooltip from the provided info.
  */
 static void
@@ -490,6 +519,7 @@ update_tooltip (ProgressData  *battstat,
     gchar *powerstring;
     gchar *remaining;
     gchar *tiptext;
+    GString *text;
 
     if (info->present)
     {
@@ -513,7 +543,10 @@ update_tooltip (ProgressData  *battstat,
                                        _("Battery status unknown"));
     }
 
-    gtk_widget_set_tooltip_text (battstat->applet, tiptext);
+    text = g_string_new (tiptext);
+    append_devices (text, info);
+    gtk_widget_set_tooltip_text (battstat->applet, text->str);
+    g_string_free (text, TRUE);
     g_free (tiptext);
 }
 
@@ -546,6 +579,88 @@ update_percent_label (ProgressData  *battstat,
     g_free (new_label);
 }
 
+static const gchar *status_icon_names[STATUS_ICON_NUM] = {
+    "battery-caution",
+    "battery-caution-charging",
+    "battery-low",
+    "battery-low-charging",
+    "battery-good",
+    "battery-good-charging",
+    "battery-full-charging",
+    "battery-full-charged",
+    "battery-full"
+};
+
+static void
+free_status_icons (ProgressData *battstat)
+{
+    int i;
+
+    for (i = 0; i < STATUS_ICON_NUM; i++)
+    {
+        if (battstat->icons[i])
+        {
+            cairo_surface_destroy (battstat->icons[i]);
+            battstat->icons[i] = NULL;
+        }
+    }
+
+    battstat->icons_size = -1;
+    battstat->shown_icon = -1;
+}
+
+static void
+icon_theme_changed (GtkIconTheme *theme,
+                    ProgressData *battstat)
+{
+    free_status_icons (battstat);
+    check_for_updates (battstat);
+}
+
+static void
+scale_factor_changed (GObject      *object,
+                      GParamSpec   *pspec,
+                      ProgressData *battstat)
+{
+    check_for_updates (battstat);
+}
+
+/* Renders all the status icons at once, so that a change of the status
+   only swaps surfaces.
+ */
+static void
+render_status_icons (ProgressData *battstat,
+                     gint          icon_size,
+                     gint          icon_scale)
+{
+    GtkIconTheme *theme;
+    int i;
+
+    theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (battstat->applet)));
+
+    if (theme != battstat->icon_theme)
+    {
+        if (battstat->theme_changed_id)
+            g_signal_handler_disconnect (battstat->icon_theme, battstat->theme_changed_id);
+
+        battstat->icon_theme = theme;
+        battstat->theme_changed_id = g_signal_connect (theme, "changed",
+                                                       G_CALLBACK (icon_theme_changed),
+                                                       battstat);
+    }
+
+    free_status_icons (battstat);
+
+    for (i = 0; i < STATUS_ICON_NUM; i++)
+        battstat->icons[i] = gtk_icon_theme_load_surface (theme, status_icon_names[i],
+                                                          icon_size,
+                                                          icon_scale,
+                                                          NULL, 0, NULL);
+
+    battstat->icons_size = icon_size;
+    battstat->icons_scale = icon_scale;
+}
+
 /* Determine what status icon we ought to be displaying and change the
    status icon to display it if it is different from what we are currently
    showing.
@@ -554,10 +669,8 @@ static void
 possibly_update_status_icon (ProgressData  *battstat,
                              BatteryStatus *info )
 {
-    GtkIconTheme *theme;
-    cairo_surface_t *surface;
     gint icon_size, icon_scale;
-    gchar *icon_name;
+    StatusIcon icon;
     int batt_life;
 
     batt_life = !battstat->red_value_is_time ? info->percent : info->minutes;
@@ -565,87 +678,151 @@ possibly_update_status_icon (ProgressData  *battstat,
     if (batt_life <= battstat->red_val)
     {
         if (info->charging)
-            icon_name = "battery-caution-charging";
+            icon = STATUS_ICON_CAUTION_CHARGING;
         else
-            icon_name = "battery-caution";
+            icon = STATUS_ICON_CAUTION;
     }
     else if (batt_life <= battstat->orange_val)
     {
         if (info->charging)
-            icon_name = "battery-low-charging";
+            icon = STATUS_ICON_LOW_CHARGING;
         else
-            icon_name = "battery-low";
+            icon = STATUS_ICON_LOW;
     }
     else if (batt_life <= battstat->yellow_val)
     {
         if (info->charging)
-            icon_name = "battery-good-charging";
+            icon = STATUS_ICON_GOOD_CHARGING;
         else
-            icon_name = "battery-good";
+            icon = STATUS_ICON_GOOD;
     }
     else if (info->on_ac_power)
     {
         if (info->charging)
-            icon_name = "battery-full-charging";
+            icon = STATUS_ICON_FULL_CHARGING;
         else
-            icon_name = "battery-full-charged";
+            icon = STATUS_ICON_FULL_CHARGED;
     }
     else
     {
-        icon_name = "battery-full";
+        icon = STATUS_ICON_FULL;
     }
 
-    theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (battstat->applet)));
-
     icon_size = mate_panel_applet_get_size (MATE_PANEL_APPLET (battstat->applet));
     icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (battstat->applet));
 
-    surface = gtk_icon_theme_load_surface (theme, icon_name,
-                                           icon_size,
-                                           icon_scale,
-                                           NULL, 0, NULL);
+    if (icon_size != battstat->icons_size || icon_scale != battstat->icons_scale)
+        render_status_icons (battstat, icon_size, icon_scale);
+
+    if ((gint) icon == battstat->shown_icon)
+        return;
 
     gtk_image_set_from_surface (GTK_IMAGE (battstat->status),
-                                surface);
-    cairo_surface_destroy (surface);
+                                battstat->icons[icon]);
+    battstat->shown_icon = icon;
+}
+
+/* How many seconds to wait before polling again, 0 for not at all.
+   The backends report what they can as events, for the rest the poll
+   comes about when the percentage should have moved by one, and often
+   enough not to miss the red value.
+ */
+static int
+get_poll_interval (ProgressData  *battstat,
+                   BatteryStatus *info)
+{
+    PowerManagementEvents events = power_management_get_events ();
+    gint64 seconds, to_red;
+    int max, left;
+
+    if (events == PM_EVENTS_ALL)
+        return 0;
+
+    /* without events, plugging or unplugging the AC adapter is noticed
+       only by polling */
+    max = events == PM_EVENTS_AC ? POLL_MAX : POLL_MAX_NO_EVENTS;
+
+    if (info->on_ac_power && !info->charging)
+        return max;
+
+    if (!info->present || info->minutes <= 0)
+        return POLL_MIN;
+
+    /* the minutes left until empty or until full, over the percents left */
+    left = info->charging ? 100 - info->percent : info->percent;
+    seconds = (gint64) info->minutes * 60 / MAX (left, 1);
+
+    if (!info->charging)
+    {
+        if (battstat->red_value_is_time)
+            to_red = ((gint64) info->minutes - (gint) battstat->red_val) * 60;
+        else
+            to_red = ((gint64) info->percent - (gint) battstat->red_val) *
+                     info->minutes * 60 / MAX (info->percent, 1);
+
+        if (to_red > 0)
+            seconds = MIN (seconds, to_red / 2);
+    }
+
+    return (int) CLAMP (seconds, POLL_MIN, max);
 }
 
-/* Gets called as a gtk_timeout once per second.  Checks for updates and
-   makes any changes as appropriate.
+/* Gets called as a timeout and on the events of the backend.  Checks for
+   updates and makes any changes as appropriate.
  */
 static gboolean
 check_for_updates (gpointer data)
 {
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "battstat:check_for_updates");
     ProgressData *battstat = data;
     BatteryStatus info;
     const char *err;
+    int timeout;
 
     if (DEBUG) g_print ("check_for_updates ()\n");
 
     if ((err = power_management_getinfo (&info)))
         battstat_error_dialog (battstat->applet, err);
 
-    if (!event_driven)
+    if (battstat->history)
+        battstat_history_add (battstat->history, &info);
+
+    /* The backends count the minutes from the draw of the moment, that
+       jumps with the load.  On battery, show the smoothed draw instead. */
+    if (info.present && !info.on_ac_power && !info.charging)
     {
-        int timeout;
+        double confidence;
+        int minutes;
+
+        battstat_estimator_add (&battstat->estimator, info.percent, info.minutes);
+        minutes = battstat_estimator_get_minutes (&battstat->estimator,
+                                                  info.percent, &confidence);
 
-      /* if on AC and not event driven scale back the polls to once every 10 */
-      if (info.on_ac_power)
-          timeout = 10;
-      else
-          timeout = 2;
+        if (DEBUG) g_print ("estimate: %d minutes, confidence %.2f\n",
+                            minutes, confidence);
 
-      if (timeout != battstat->timeout)
-      {
-          battstat->timeout = timeout;
+        if (minutes > 0 && confidence >= ESTIMATE_MIN_CONFIDENCE)
+            info.minutes = minutes;
+    }
+    else
+        battstat_estimator_reset (&battstat->estimator);
 
-          if (battstat->timeout_id)
-              g_source_remove (battstat->timeout_id);
+    timeout = get_poll_interval (battstat, &info);
+    if (timeout != battstat->timeout)
+    {
+        battstat->timeout = timeout;
+
+        if (battstat->timeout_id)
+        {
+            g_source_remove (battstat->timeout_id);
+            battstat->timeout_id = 0;
+        }
 
-          battstat->timeout_id = g_timeout_add_seconds (battstat->timeout,
-                                                        check_for_updates,
-                                                        battstat);
-      }
+        if (timeout > 0)
+            battstat->timeout_id = g_timeout_add_seconds (battstat->timeout,
+                                                          check_for_updates,
+                                                          battstat);
     }
 
     possibly_update_status_icon (battstat, &info);
@@ -700,7 +877,9 @@ check_for_updates (gpointer data)
     if (info.on_ac_power != battstat->last_acline_status ||
         info.percent != battstat->last_batt_life ||
         info.minutes != battstat->last_minutes ||
-        info.charging != battstat->last_charging)
+        info.charging != battstat->last_charging ||
+        /* the batteries one by one change while the totals do not */
+        info.n_devices > 1)
     {
         /* Update the tooltip */
         update_tooltip (battstat, &info);
@@ -731,6 +910,8 @@ check_for_updates (gpointer data)
     battstat->last_acline_status = info.on_ac_power;
     battstat->last_present = info.present;
 
+    applet_probe_end (probe, start);
+
     return TRUE;
 }
 
@@ -753,6 +934,12 @@ destroy_applet (GtkWidget    *widget,
     if (battstat->timeout_id)
         g_source_remove (battstat->timeout_id);
 
+    battstat_set_history (battstat, FALSE);
+
+    if (battstat->theme_changed_id)
+        g_signal_handler_disconnect (battstat->icon_theme, battstat->theme_changed_id);
+    free_status_icons (battstat);
+
     g_object_unref (G_OBJECT (battstat->status));
     g_object_unref (G_OBJECT (battstat->percent));
     g_object_unref (battstat->settings);
@@ -945,6 +1132,27 @@ load_preferences (ProgressData *battstat)
     battstat->fullbattnot = g_settings_get_boolean (settings, "full-battery-notification");
     battstat->beep = g_settings_get_boolean (settings, "beep");
     battstat->showtext = g_settings_get_int (settings, "show-text");
+
+    battstat_set_history (battstat, g_settings_get_boolean (settings, "history"));
+}
+
+/* Starts or stops keeping the battery history.  With several applets
+   keeping it, the first one writes it.
+ */
+void
+battstat_set_history (ProgressData *battstat,
+                      gboolean      enabled)
+{
+    if (enabled == (battstat->history != NULL))
+        return;
+
+    if (enabled)
+        battstat->history = battstat_history_open (TRUE);
+    else
+    {
+        battstat_history_close (battstat->history);
+        battstat->history = NULL;
+    }
 }
 
 /* Convenience function to attach a child widget to a GtkGrid in the
@@ -1101,6 +1309,10 @@ create_layout (ProgressData *battstat)
                       G_CALLBACK (size_allocate),
                       battstat);
 
+    g_signal_connect (battstat->applet, "notify::scale-factor",
+                      G_CALLBACK (scale_factor_changed),
+                      battstat);
+
     return FALSE;
 }
 
@@ -1154,6 +1366,8 @@ battstat_applet_fill (MatePanelApplet *applet)
     battstat->battery_low_label = NULL;
     battstat->timeout = -1;
     battstat->timeout_id = 0;
+    battstat->icons_size = -1;
+    battstat->shown_icon = -1;
 
     /* The first received size_allocate event will cause a reconfigure. */
     battstat->height = -1;
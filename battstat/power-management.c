@@ -63,6 +63,8 @@
 
 static const char *apm_readinfo (BatteryStatus *status);
 static gboolean pm_initialised = FALSE;
+static PowerManagementEvents pm_events = PM_EVENTS_NONE;
+static void (*status_callback) (void);
 #ifdef HAVE_UPOWER
 static gboolean using_upower = FALSE;
 #endif
@@ -283,27 +285,94 @@ apm_readinfo (BatteryStatus *status)
 
 #include <apm.h>
 #include "acpi-linux.h"
+#include "power-supply-linux.h"
 
+static struct power_supply_info psinfo;
+static gboolean using_power_supply;
+static int psupplywatch;
 static struct acpi_info acpiinfo;
 static gboolean using_acpi;
-static int acpi_count;
 static int acpiwatch;
 static struct apm_info apminfo;
 
+static gboolean power_supply_callback (GIOChannel * chan, GIOCondition cond, gpointer data)
+{
+  if (cond & (G_IO_ERR | G_IO_HUP)) {
+    /* keep reading the supplies found so far, by polling */
+    psupplywatch = 0;
+    pm_events = PM_EVENTS_NONE;
+    return FALSE;
+  }
+
+  if (power_supply_process_event (&psinfo) && status_callback)
+    status_callback ();
+  return TRUE;
+}
+
 static gboolean acpi_callback (GIOChannel * chan, GIOCondition cond, gpointer data)
 {
   if (cond & (G_IO_ERR | G_IO_HUP)) {
     acpi_linux_cleanup (&acpiinfo);
     apminfo.battery_percentage = -1;
+    acpiwatch = 0;
+    pm_events = PM_EVENTS_NONE;
     return FALSE;
   }
   
-  if (acpi_process_event (&acpiinfo)) {
-    acpi_linux_read (&apminfo, &acpiinfo);
+  if (acpi_process_event (&acpiinfo) && status_callback) {
+    status_callback ();
   }
   return TRUE;
 }
 
+/* The breakdown by battery, out of the read that made the totals */
+static void
+power_supply_devices (BatteryStatus *status)
+{
+  int i;
+
+  for (i = 0; i < psinfo.n_batteries && status->n_devices < BATTERY_DEVICES_MAX; i++)
+  {
+    struct power_supply_battery *battery = &psinfo.batteries[i];
+    BatteryDevice *device;
+
+    if (battery->percent < 0)
+      continue;
+
+    device = &status->devices[status->n_devices++];
+    g_strlcpy (device->name, battery->name, sizeof (device->name));
+    device->charging = battery->charging;
+    device->percent = battery->percent;
+    device->energy_rate = battery->rate / 1e6;
+    device->health = battery->health;
+    device->cycle_count = battery->cycle_count;
+  }
+}
+
+static void
+acpi_devices (BatteryStatus *status)
+{
+  int i;
+
+  for (i = 0; i < acpiinfo.n_batteries && status->n_devices < BATTERY_DEVICES_MAX; i++)
+  {
+    struct acpi_battery *battery = &acpiinfo.batteries[i];
+    BatteryDevice *device;
+
+    if (!battery->present || battery->full_capacity <= 0)
+      continue;
+
+    device = &status->devices[status->n_devices++];
+    g_strlcpy (device->name, battery->name, sizeof (device->name));
+    device->charging = battery->charging;
+    device->percent = MIN (battery->remain, battery->full_capacity) * 100 / battery->full_capacity;
+    device->energy_rate = battery->energy ? battery->rate / 1e3 : 0;
+    device->health = battery->design_capacity > 0 ?
+                     battery->full_capacity * 100.0 / battery->design_capacity : 0;
+    device->cycle_count = battery->cycle_count;
+  }
+}
+
 static const char *
 apm_readinfo (BatteryStatus *status)
 {
@@ -313,17 +382,23 @@ apm_readinfo (BatteryStatus *status)
   */
   if (DEBUG) g_print ("apm_readinfo () (Linux)\n");
 
+  /* The power_supply attributes are kept open, so reading them at every
+   * call costs only a few preads. */
+  if (using_power_supply) {
+    power_supply_linux_read (&apminfo, &psinfo);
+    status->energy = psinfo.energy_now / 1e6;
+    status->energy_full = psinfo.energy_full / 1e6;
+    status->energy_rate = psinfo.energy_rate / 1e6;
+    power_supply_devices (status);
+  }
   /* ACPI support added by Lennart Poettering <lennart@poettering.de> 10/27/2001
    * Updated by David Moore <dcm@acm.org> 5/29/2003 to poll less and
    *   use ACPI events. */
-  if (using_acpi && acpiinfo.event_fd >= 0) {
-    if (acpi_count <= 0) {
-      /* Only call this one out of 30 calls to apm_readinfo () (every 30 seconds)
-       * since reading the ACPI system takes CPU cycles. */
-      acpi_count=30;
-      acpi_linux_read (&apminfo, &acpiinfo);
-    }
-    acpi_count--;
+  else if (using_acpi && acpiinfo.event_fd >= 0) {
+    /* The applet polls only as often as the status can change, and
+     * right away on ACPI events. */
+    acpi_linux_read (&apminfo, &acpiinfo);
+    acpi_devices (status);
   }
   /* If we lost the file descriptor with ACPI events, try to get it back. */
   else if (using_acpi) {
@@ -331,7 +406,9 @@ apm_readinfo (BatteryStatus *status)
           acpiwatch = g_io_add_watch (acpiinfo.channel,
               G_IO_IN | G_IO_ERR | G_IO_HUP,
               acpi_callback, NULL);
+          pm_events = PM_EVENTS_AC;
           acpi_linux_read (&apminfo, &acpiinfo);
+          acpi_devices (status);
       }
   }
   else
@@ -381,6 +458,11 @@ power_management_getinfo (BatteryStatus *status)
 {
   const char *retval;
 
+  status->energy = 0;
+  status->energy_full = 0;
+  status->energy_rate = 0;
+  status->n_devices = 0;
+
   if (!pm_initialised)
   {
     status->on_ac_power = TRUE;
@@ -444,6 +526,7 @@ power_management_initialise (void (*callback) (void))
   {
     pm_initialised = TRUE;
     using_upower = TRUE;
+    pm_events = PM_EVENTS_ALL;
     return NULL;
   }
   else
@@ -451,11 +534,26 @@ power_management_initialise (void (*callback) (void))
     g_free (err);
 #endif /* HAVE_UPOWER */
 
+  status_callback = callback;
+  pm_events = PM_EVENTS_NONE;
+
 #ifdef __linux__
 
+  if (power_supply_linux_init (&psinfo)) {
+    using_power_supply = TRUE;
+    if (psinfo.event_fd >= 0) {
+      psupplywatch = g_io_add_watch (psinfo.channel,
+          G_IO_IN | G_IO_ERR | G_IO_HUP,
+          power_supply_callback, NULL);
+      pm_events = PM_EVENTS_AC;
+    }
+    pm_initialised = TRUE;
+
+    return NULL;
+  }
+
   if (acpi_linux_init (&acpiinfo)) {
     using_acpi = TRUE;
-    acpi_count = 0;
   }
   else
     using_acpi = FALSE;
@@ -465,7 +563,6 @@ power_management_initialise (void (*callback) (void))
   if (!using_acpi && (apm_exists () == 1) &&
           (stat ("/proc/acpi", &statbuf) == 0)) {
     using_acpi = TRUE;
-    acpi_count = 0;
     return ERR_ACPID;
   }
 
@@ -474,6 +571,7 @@ power_management_initialise (void (*callback) (void))
     acpiwatch = g_io_add_watch (acpiinfo.channel,
         G_IO_IN | G_IO_ERR | G_IO_HUP,
         acpi_callback, NULL);
+    pm_events = PM_EVENTS_AC;
   }
 #elif defined(__FreeBSD__) || defined(__FreeBSD_kernel__)
   if (acpi_freebsd_init (&acpiinfo)) {
@@ -505,7 +603,19 @@ power_management_cleanup (void)
   }
 #endif
 
+  status_callback = NULL;
+  pm_events = PM_EVENTS_NONE;
+
 #ifdef __linux__
+  if (using_power_supply)
+  {
+    if (psupplywatch != 0)
+      g_source_remove (psupplywatch);
+    psupplywatch = 0;
+    power_supply_linux_cleanup (&psinfo);
+    using_power_supply = FALSE;
+  }
+
   if (using_acpi)
   {
     if (acpiwatch != 0)
@@ -532,3 +642,8 @@ power_management_using_upower (void)
 #endif
 }
 
+PowerManagementEvents
+power_management_get_events (void)
+{
+  return pm_events;
+}
@@ -0,0 +1,464 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Battery read-out functions for the power_supply class of Linux >= 2.6.24
+ */
+
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#ifdef __linux__
+
+#include <apm.h>
+#include <glib.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "common/sampler-file.h"
+
+#include "power-supply-linux.h"
+
+#define POWER_SUPPLY_DIR "/sys/class/power_supply"
+
+/* the size of the buffer the kernel builds a uevent in */
+#define UEVENT_BUFFER_SIZE 2048
+
+static int
+open_attribute (const char *supply, const char *name)
+{
+    char path[256];
+
+    g_snprintf (path, sizeof (path), POWER_SUPPLY_DIR "/%s/%s", supply, name);
+
+    return sampler_open (path);
+}
+
+/* Reads a whole attribute from its start, without the trailing newline */
+static gboolean
+read_attribute (int fd, char *buf, size_t bufsize)
+{
+    ssize_t len;
+
+    if (fd < 0)
+        return FALSE;
+
+    do {
+        len = pread (fd, buf, bufsize - 1, 0);
+    } while (len < 0 && errno == EINTR);
+
+    /* a battery that was taken out fails with ENODEV */
+    if (len <= 0)
+        return FALSE;
+
+    if (buf[len - 1] == '\n')
+        len--;
+    buf[len] = '\0';
+
+    return TRUE;
+}
+
+static gint64
+read_attribute_long (int fd)
+{
+    char buf[32];
+
+    if (!read_attribute (fd, buf, sizeof (buf)))
+        return -1;
+
+    return g_ascii_strtoll (buf, NULL, 10);
+}
+
+static void
+close_fd (int *fd)
+{
+    if (*fd >= 0)
+        close (*fd);
+    *fd = -1;
+}
+
+static void
+close_supplies (struct power_supply_info *info)
+{
+    int i;
+
+    for (i = 0; i < info->n_batteries; i++)
+    {
+        struct power_supply_battery *battery = &info->batteries[i];
+
+        close_fd (&battery->status_fd);
+        close_fd (&battery->now_fd);
+        close_fd (&battery->full_fd);
+        close_fd (&battery->rate_fd);
+        close_fd (&battery->capacity_fd);
+    }
+
+    for (i = 0; i < info->n_mains; i++)
+        close_fd (&info->mains_fd[i]);
+
+    info->n_batteries = 0;
+    info->n_mains = 0;
+}
+
+/* The design capacity and the cycle count hardly change, so they are not
+ * read at every poll. */
+static void
+read_battery_details (struct power_supply_battery *battery)
+{
+    int fd;
+
+    fd = open_attribute (battery->name, battery->energy ? "energy_full_design"
+                                                        : "charge_full_design");
+    battery->full_design = read_attribute_long (fd);
+    if (fd >= 0)
+        close (fd);
+
+    /* drivers that do not count the cycles mostly say 0 */
+    fd = open_attribute (battery->name, "cycle_count");
+    battery->cycle_count = read_attribute_long (fd);
+    if (battery->cycle_count == 0)
+        battery->cycle_count = -1;
+    if (fd >= 0)
+        close (fd);
+}
+
+static void
+add_battery (struct power_supply_info *info, const char *supply)
+{
+    struct power_supply_battery *battery;
+    char buf[32];
+    int fd;
+
+    /* the batteries of mice and keyboards do not power the system */
+    fd = open_attribute (supply, "scope");
+    if (fd >= 0)
+    {
+        gboolean device = read_attribute (fd, buf, sizeof (buf)) &&
+                          strcmp (buf, "Device") == 0;
+
+        close (fd);
+        if (device)
+            return;
+    }
+
+    if (info->n_batteries == POWER_SUPPLY_MAX)
+        return;
+
+    battery = &info->batteries[info->n_batteries++];
+    g_strlcpy (battery->name, supply, sizeof (battery->name));
+    battery->status_fd = open_attribute (supply, "status");
+    battery->capacity_fd = open_attribute (supply, "capacity");
+
+    /* batteries report either energy in µWh or charge in µAh */
+    battery->now_fd = open_attribute (supply, "energy_now");
+    battery->energy = battery->now_fd >= 0;
+    if (battery->energy)
+    {
+        battery->full_fd = open_attribute (supply, "energy_full");
+        battery->rate_fd = open_attribute (supply, "power_now");
+    }
+    else
+    {
+        battery->now_fd = open_attribute (supply, "charge_now");
+        battery->full_fd = open_attribute (supply, "charge_full");
+        battery->rate_fd = open_attribute (supply, "current_now");
+    }
+
+    read_battery_details (battery);
+}
+
+/* Looks up the batteries and AC adapters again, returns FALSE if the
+ * power_supply class is not there at all. */
+static gboolean
+scan_supplies (struct power_supply_info *info)
+{
+    DIR *dir;
+    struct dirent *entry;
+
+    close_supplies (info);
+    info->rescan = FALSE;
+
+    dir = opendir (POWER_SUPPLY_DIR);
+    if (!dir)
+        return FALSE;
+
+    while ((entry = readdir (dir)))
+    {
+        char type[32];
+        gboolean have_type;
+        int fd;
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        fd = open_attribute (entry->d_name, "type");
+        if (fd < 0)
+            continue;
+        have_type = read_attribute (fd, type, sizeof (type));
+        close (fd);
+
+        if (!have_type)
+            continue;
+
+        if (strcmp (type, "Battery") == 0)
+            add_battery (info, entry->d_name);
+        else if ((strcmp (type, "Mains") == 0 || strcmp (type, "USB") == 0) &&
+                 info->n_mains < POWER_SUPPLY_MAX)
+        {
+            fd = open_attribute (entry->d_name, "online");
+            if (fd >= 0)
+                info->mains_fd[info->n_mains++] = fd;
+        }
+    }
+
+    closedir (dir);
+
+    if (getenv ("BATTSTAT_DEBUG"))
+        g_message ("Found %d batteries and %d AC adapters",
+                   info->n_batteries, info->n_mains);
+
+    return TRUE;
+}
+
+/* Looks up the power supplies and opens a socket for the kernel uevents
+ * telling when they change. */
+gboolean
+power_supply_linux_init (struct power_supply_info *info)
+{
+    struct sockaddr_nl addr;
+    int fd;
+
+    g_assert (info);
+
+    info->n_batteries = 0;
+    info->n_mains = 0;
+    info->reread_details = FALSE;
+    info->event_fd = -1;
+    info->channel = NULL;
+
+    if (!scan_supplies (info))
+        return FALSE;
+
+    /* without uevents the supplies found now are all there is */
+    fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                 NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+        return TRUE;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; /* the events of the kernel, not udev's */
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0)
+    {
+        close (fd);
+        return TRUE;
+    }
+
+    info->event_fd = fd;
+    info->channel = g_io_channel_unix_new (fd);
+
+    return TRUE;
+}
+
+/* Cleans up the power supplies */
+void
+power_supply_linux_cleanup (struct power_supply_info *info)
+{
+    g_assert (info);
+
+    close_supplies (info);
+
+    if (info->event_fd >= 0) {
+        g_io_channel_unref (info->channel);
+        close (info->event_fd);
+        info->event_fd = -1;
+        info->channel = NULL;
+    }
+}
+
+/* Reads the pending uevents.  A power supply that was added or removed
+ * has the supplies looked up again by the next read.  Returns TRUE if
+ * any of the events was about a power supply. */
+gboolean
+power_supply_process_event (struct power_supply_info *info)
+{
+    char buf[UEVENT_BUFFER_SIZE];
+    gboolean result = FALSE;
+    ssize_t len;
+
+    while ((len = recv (info->event_fd, buf, sizeof (buf) - 1, 0)) > 0 ||
+           (len < 0 && errno == EINTR))
+    {
+        gboolean power_supply = FALSE;
+        gboolean hotplug = FALSE;
+        char *s;
+
+        if (len < 0)
+            continue;
+
+        /* "action@devpath" then NUL separated KEY=value pairs */
+        buf[len] = '\0';
+        for (s = buf; s < buf + len; s += strlen (s) + 1)
+        {
+            if (strcmp (s, "SUBSYSTEM=power_supply") == 0)
+                power_supply = TRUE;
+            else if (strcmp (s, "ACTION=add") == 0 ||
+                     strcmp (s, "ACTION=remove") == 0)
+                hotplug = TRUE;
+        }
+
+        if (power_supply)
+        {
+            result = TRUE;
+            info->reread_details = TRUE;
+            if (hotplug)
+                info->rescan = TRUE;
+        }
+    }
+
+    return result;
+}
+
+/*
+ * Fills out a classic apm_info structure with the data of the power
+ * supplies in /sys/class/power_supply
+ */
+gboolean
+power_supply_linux_read (struct apm_info *apminfo, struct power_supply_info *info)
+{
+    gint64 remain = 0;
+    gint64 capacity = 0;
+    gint64 rate = 0;
+    gint64 percent_sum = 0;
+    int n_percent = 0;
+    gboolean charging = FALSE;
+    gboolean discharging = FALSE;
+    gboolean ac_online = FALSE;
+    int i;
+
+    g_assert (apminfo);
+    g_assert (info);
+
+    if (info->rescan)
+        scan_supplies (info);
+    else if (info->reread_details)
+    {
+        for (i = 0; i < info->n_batteries; i++)
+            read_battery_details (&info->batteries[i]);
+    }
+    info->reread_details = FALSE;
+
+    info->energy_now = 0;
+    info->energy_full = 0;
+    info->energy_rate = 0;
+
+    for (i = 0; i < info->n_mains; i++)
+    {
+        if (read_attribute_long (info->mains_fd[i]) == 1)
+            ac_online = TRUE;
+    }
+
+    for (i = 0; i < info->n_batteries; i++)
+    {
+        struct power_supply_battery *battery = &info->batteries[i];
+        char status[32];
+        gint64 now, full, percent;
+
+        now = read_attribute_long (battery->now_fd);
+        full = read_attribute_long (battery->full_fd);
+
+        battery->percent = -1;
+        battery->charging = FALSE;
+        battery->rate = 0;
+        battery->health = 0;
+
+        if (now >= 0 && full > 0)
+        {
+            gint64 battery_rate = 0;
+
+            battery->percent = (int) (MIN (now, full) * 100 / full);
+            if (battery->full_design > 0)
+                battery->health = (int) (full * 100 / battery->full_design);
+
+            remain += MIN (now, full);
+            capacity += full;
+            /* some drivers report a negative current while discharging,
+             * -1 is a failed read */
+            if ((battery_rate = read_attribute_long (battery->rate_fd)) != -1)
+                rate += ABS (battery_rate);
+            else
+                battery_rate = 0;
+
+            if (battery->energy)
+            {
+                info->energy_now += MIN (now, full);
+                info->energy_full += full;
+                info->energy_rate += ABS (battery_rate);
+                battery->rate = ABS (battery_rate);
+            }
+        }
+        else if ((percent = read_attribute_long (battery->capacity_fd)) >= 0)
+        {
+            battery->percent = (int) MIN (percent, 100);
+            percent_sum += battery->percent;
+            n_percent++;
+        }
+        else
+            /* not present */
+            continue;
+
+        if (read_attribute (battery->status_fd, status, sizeof (status)))
+        {
+            if (strcmp (status, "Charging") == 0)
+                charging = battery->charging = TRUE;
+            else if (strcmp (status, "Discharging") == 0)
+                discharging = TRUE;
+        }
+    }
+
+    /* Without AC adaptors we're probably on a desktop, unless a battery
+     * says otherwise. */
+    apminfo->ac_line_status = (info->n_mains ? ac_online : !discharging) ? 1 : 0;
+    apminfo->battery_status = charging ? 3 : 0;
+    if (capacity > 0)
+        apminfo->battery_percentage = (int) (remain * 100 / capacity);
+    else if (n_percent > 0)
+        apminfo->battery_percentage = (int) (percent_sum / n_percent);
+    else
+        apminfo->battery_percentage = -1;
+    apminfo->battery_flags = charging ? 0x8 : 0;
+    if (capacity > 0 && rate && !charging)
+        apminfo->battery_time = (int) (remain / (float) rate * 60);
+    else if (capacity > 0 && rate && charging)
+        apminfo->battery_time = (int) ((capacity - remain) / (float) rate * 60);
+    else
+        apminfo->battery_time = -1;
+
+    return TRUE;
+}
+
+#endif /* __linux__ */
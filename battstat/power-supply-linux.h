@@ -0,0 +1,69 @@
+/* battstat        A MATE battery meter for laptops.
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __POWER_SUPPLY_LINUX_H__
+#define __POWER_SUPPLY_LINUX_H__
+
+/* Batteries and AC adapters of /sys/class/power_supply.
+ *
+ * The supplies are looked up once and their attribute files kept open,
+ * so a read is a few preads with no allocation.  A kernel uevent socket
+ * tells when supplies come and go, and they are looked up again. */
+
+#define POWER_SUPPLY_MAX 8
+
+struct power_supply_battery {
+    char name[32];
+    int status_fd;
+    int now_fd;       /* energy_now or charge_now, -1 without */
+    int full_fd;      /* energy_full or charge_full */
+    int rate_fd;      /* power_now or current_now */
+    int capacity_fd;  /* percentage, when now and full are missing */
+    gboolean energy;  /* now_fd is energy_now */
+    /* read when the battery is found and on its uevents */
+    gint64   full_design;
+    int      cycle_count;
+    /* of the last read, percent is -1 when the battery is not there */
+    int      percent;
+    gboolean charging;
+    gint64   rate;        /* µW, 0 for the batteries that count charge */
+    int      health;      /* percent, 0 when unknown */
+};
+
+struct power_supply_info {
+    struct power_supply_battery batteries[POWER_SUPPLY_MAX];
+    int           n_batteries;
+    int           mains_fd[POWER_SUPPLY_MAX];
+    int           n_mains;
+    gboolean      rescan;
+    gboolean      reread_details;
+    /* the totals of the last read in µWh and µW, without the batteries
+     * that count charge */
+    gint64        energy_now;
+    gint64        energy_full;
+    gint64        energy_rate;
+    int           event_fd;
+    GIOChannel  * channel;
+};
+
+gboolean power_supply_linux_init (struct power_supply_info *info);
+gboolean power_supply_linux_read (struct apm_info *apminfo, struct power_supply_info *info);
+gboolean power_supply_process_event (struct power_supply_info *info);
+void power_supply_linux_cleanup (struct power_supply_info *info);
+
+#endif /* __POWER_SUPPLY_LINUX_H__ */
@@ -0,0 +1,155 @@
+/* charpick-glyphs.c -- the drawn glyphs, shared by the applets */
+
+#include <config.h>
+#include <gtk/gtk.h>
+#include "charpick-glyphs.h"
+
+/* the unused glyph sets kept for when their style comes back */
+#define UNUSED_SETS_MAX 2
+
+struct _CharpickGlyphs {
+    gchar       *key;
+    gint         refs;
+    gint         scale;
+    GdkRGBA      color;
+    PangoLayout *layout;
+    GHashTable  *glyphs;   /* unichar -> CharpickGlyph */
+};
+
+/* key -> CharpickGlyphs */
+static GHashTable *glyph_sets = NULL;
+/* the unused glyph sets, the latest first */
+static GList *unused_sets = NULL;
+
+static void
+glyph_free (CharpickGlyph *glyph)
+{
+    if (glyph->surface)
+        cairo_surface_destroy (glyph->surface);
+    g_free (glyph);
+}
+
+static void
+glyph_set_free (CharpickGlyphs *glyphs)
+{
+    g_hash_table_destroy (glyphs->glyphs);
+    g_object_unref (glyphs->layout);
+    g_free (glyphs->key);
+    g_free (glyphs);
+}
+
+static gchar *
+style_key (GtkWidget       *widget,
+           const GdkRGBA   *color)
+{
+    PangoContext *context = gtk_widget_get_pango_context (widget);
+    gchar *font, *rgba, *key;
+
+    font = pango_font_description_to_string (pango_context_get_font_description (context));
+    rgba = gdk_rgba_to_string (color);
+    key = g_strdup_printf ("%s|%s|%d|%g", font, rgba,
+                           gtk_widget_get_scale_factor (widget),
+                           pango_cairo_context_get_resolution (context));
+    g_free (rgba);
+    g_free (font);
+
+    return key;
+}
+
+CharpickGlyphs *
+charpick_glyphs_get (GtkWidget       *widget,
+                     GtkStyleContext *context)
+{
+    CharpickGlyphs *glyphs;
+    GdkRGBA color;
+    gchar *key;
+
+    if (!glyph_sets)
+        glyph_sets = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                            (GDestroyNotify) glyph_set_free);
+
+    gtk_style_context_get_color (context, gtk_style_context_get_state (context), &color);
+    key = style_key (widget, &color);
+
+    glyphs = g_hash_table_lookup (glyph_sets, key);
+    if (glyphs) {
+        g_free (key);
+        if (glyphs->refs++ == 0)
+            unused_sets = g_list_remove (unused_sets, glyphs);
+        return glyphs;
+    }
+
+    glyphs = g_new0 (CharpickGlyphs, 1);
+    glyphs->key = key;
+    glyphs->refs = 1;
+    glyphs->scale = gtk_widget_get_scale_factor (widget);
+    glyphs->color = color;
+    /* a context of its own, as the set outlives the widget */
+    glyphs->layout = pango_layout_new (gtk_widget_create_pango_context (widget));
+    g_object_unref (pango_layout_get_context (glyphs->layout));
+    glyphs->glyphs = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) glyph_free);
+    g_hash_table_insert (glyph_sets, glyphs->key, glyphs);
+
+    return glyphs;
+}
+
+void
+charpick_glyphs_release (CharpickGlyphs *glyphs)
+{
+    if (--glyphs->refs > 0)
+        return;
+
+    unused_sets = g_list_prepend (unused_sets, glyphs);
+    while (g_list_length (unused_sets) > UNUSED_SETS_MAX) {
+        GList *oldest = g_list_last (unused_sets);
+        CharpickGlyphs *old = oldest->data;
+
+        unused_sets = g_list_delete_link (unused_sets, oldest);
+        g_hash_table_remove (glyph_sets, old->key);
+    }
+}
+
+const CharpickGlyph *
+charpick_glyphs_lookup (CharpickGlyphs *glyphs,
+                        gunichar        unichar)
+{
+    CharpickGlyph *glyph;
+    PangoRectangle ink;
+    gchar text[7];
+    cairo_t *cr;
+
+    glyph = g_hash_table_lookup (glyphs->glyphs, GUINT_TO_POINTER (unichar));
+    if (glyph)
+        return glyph;
+
+    glyph = g_new0 (CharpickGlyph, 1);
+    g_hash_table_insert (glyphs->glyphs, GUINT_TO_POINTER (unichar), glyph);
+
+    text[g_unichar_to_utf8 (unichar, text)] = '\0';
+    pango_layout_set_text (glyphs->layout, text, -1);
+    pango_layout_get_pixel_extents (glyphs->layout, &ink, &glyph->logical);
+
+    if (ink.width <= 0 || ink.height <= 0)
+        return glyph;
+
+    /* accents may be drawn outside of the logical extents */
+    glyph->area.x = MIN (ink.x, glyph->logical.x);
+    glyph->area.y = MIN (ink.y, glyph->logical.y);
+    glyph->area.width = MAX (ink.x + ink.width, glyph->logical.x + glyph->logical.width)
+                        - glyph->area.x;
+    glyph->area.height = MAX (ink.y + ink.height, glyph->logical.y + glyph->logical.height)
+                         - glyph->area.y;
+
+    glyph->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                 glyph->area.width * glyphs->scale,
+                                                 glyph->area.height * glyphs->scale);
+    cairo_surface_set_device_scale (glyph->surface, glyphs->scale, glyphs->scale);
+
+    cr = cairo_create (glyph->surface);
+    gdk_cairo_set_source_rgba (cr, &glyphs->color);
+    cairo_move_to (cr, -glyph->area.x, -glyph->area.y);
+    pango_cairo_show_layout (cr, glyphs->layout);
+    cairo_destroy (cr);
+
+    return glyph;
+}
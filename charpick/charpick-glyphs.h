@@ -0,0 +1,30 @@
+/* charpick-glyphs.h -- the drawn glyphs, shared by the applets */
+
+#ifndef __CHARPICK_GLYPHS_H__
+#define __CHARPICK_GLYPHS_H__
+
+#include <gtk/gtk.h>
+
+/* The glyphs are drawn once per font, color and scale factor, and kept
+ * as long as a grid with that style is alive, so a palette switch or
+ * another applet of the process only paints the surfaces. The glyph
+ * sets no grid uses any more are kept for a few style changes. */
+
+typedef struct {
+    cairo_surface_t *surface;  /* at the scale factor, NULL when blank */
+    PangoRectangle   logical;  /* of the character, from its origin */
+    PangoRectangle   area;     /* of the surface, from the same origin */
+} CharpickGlyph;
+
+typedef struct _CharpickGlyphs CharpickGlyphs;
+
+/* The glyphs in the font and scale of widget, and the color of
+ * context in its current state */
+CharpickGlyphs *charpick_glyphs_get (GtkWidget       *widget,
+                                     GtkStyleContext *context);
+void charpick_glyphs_release (CharpickGlyphs *glyphs);
+
+const CharpickGlyph *charpick_glyphs_lookup (CharpickGlyphs *glyphs,
+                                             gunichar        unichar);
+
+#endif /* __CHARPICK_GLYPHS_H__ */
@@ -0,0 +1,772 @@
+/* charpick-grid.c -- the characters of a palette, as one widget */
+
+#include <config.h>
+#include <glib/gi18n.h>
+#include <gtk/gtk.h>
+#ifdef HAVE_GUCHARMAP
+#include <gucharmap/gucharmap.h>
+#endif
+#include "charpick-grid.h"
+#include "charpick-glyphs.h"
+
+/* the space beside a glyph, where a button had its border */
+#define CELL_PADDING 2
+
+struct _CharpickGrid
+{
+    GtkWidget        parent;
+
+    gunichar        *chars;
+    glong            n_chars;
+    GtkOrientation   orientation;
+    gint             panel_size;
+
+    /* measured once the widget has a style, 0 before */
+    gint             cell_width;
+    gint             cell_height;
+    gint             columns;
+    gint             rows;
+
+    gint             active;
+    gint             pressed;
+    gint             prelight;
+    gint             focus;
+
+    /* the cells are styled as flat buttons inside the grid */
+    GtkStyleContext *cell_context;
+    CharpickGlyphs  *glyph_set;    /* in the state of the widget */
+    const CharpickGlyph **glyphs;
+    /* GtkStateFlags -> CharpickGlyphs, for the checked and hovered cells */
+    GHashTable      *state_sets;
+};
+
+enum {
+    CHARACTER_ACTIVATED,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (CharpickGrid, charpick_grid, GTK_TYPE_WIDGET)
+
+static GtkStyleContext *get_cell_context (CharpickGrid *grid);
+
+/* The state of the cells that are neither checked nor hovered */
+static GtkStateFlags
+get_widget_state (CharpickGrid *grid)
+{
+    return gtk_widget_get_state_flags (GTK_WIDGET (grid)) &
+           (GTK_STATE_FLAG_INSENSITIVE | GTK_STATE_FLAG_BACKDROP);
+}
+
+/* The palette changed, the glyph set is kept */
+static void
+clear_glyphs (CharpickGrid *grid)
+{
+    g_clear_pointer (&grid->glyphs, g_free);
+    grid->cell_width = 0;
+}
+
+/* The style changed */
+static void
+release_glyphs (CharpickGrid *grid)
+{
+    clear_glyphs (grid);
+    g_clear_pointer (&grid->glyph_set, charpick_glyphs_release);
+    g_hash_table_remove_all (grid->state_sets);
+}
+
+static void
+ensure_glyphs (CharpickGrid *grid)
+{
+    glong i;
+
+    if (grid->glyphs)
+        return;
+
+    if (!grid->glyph_set) {
+        GtkStyleContext *context = get_cell_context (grid);
+
+        gtk_style_context_set_state (context, get_widget_state (grid));
+        grid->glyph_set = charpick_glyphs_get (GTK_WIDGET (grid), context);
+        gtk_style_context_set_state (context, GTK_STATE_FLAG_NORMAL);
+    }
+
+    grid->glyphs = g_new (const CharpickGlyph *, grid->n_chars);
+    for (i = 0; i < grid->n_chars; i++)
+        grid->glyphs[i] = charpick_glyphs_lookup (grid->glyph_set, grid->chars[i]);
+}
+
+static void
+measure_cells (CharpickGrid *grid)
+{
+    gint width = 1, height = 1;
+    glong i;
+
+    if (grid->cell_width > 0)
+        return;
+
+    ensure_glyphs (grid);
+    for (i = 0; i < grid->n_chars; i++) {
+        width = MAX (width, grid->glyphs[i]->logical.width);
+        height = MAX (height, grid->glyphs[i]->logical.height);
+    }
+
+    grid->cell_width = width + 2 * CELL_PADDING;
+    grid->cell_height = height;
+}
+
+/* Fills as many lines as fit across the panel, evenly */
+static void
+update_cells (CharpickGrid *grid)
+{
+    gint lines, per_line;
+
+    measure_cells (grid);
+
+    if (grid->n_chars == 0) {
+        grid->columns = grid->rows = 0;
+        return;
+    }
+
+    if (grid->orientation == GTK_ORIENTATION_HORIZONTAL)
+        lines = grid->panel_size / grid->cell_height;
+    else
+        lines = grid->panel_size / grid->cell_width;
+    lines = CLAMP (lines, 1, grid->n_chars);
+
+    per_line = (grid->n_chars + lines - 1) / lines;
+    lines = (grid->n_chars + per_line - 1) / per_line;
+
+    if (grid->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        grid->columns = per_line;
+        grid->rows = lines;
+    } else {
+        grid->columns = lines;
+        grid->rows = per_line;
+    }
+}
+
+/* The characters follow each other along the lines */
+static gint
+cell_index (CharpickGrid *grid,
+            gint          column,
+            gint          row)
+{
+    if (grid->orientation == GTK_ORIENTATION_HORIZONTAL)
+        return row * grid->columns + column;
+    else
+        return column * grid->rows + row;
+}
+
+static void
+cell_position (CharpickGrid *grid,
+               gint          index,
+               gint         *column,
+               gint         *row)
+{
+    if (grid->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        *column = index % grid->columns;
+        *row = index / grid->columns;
+    } else {
+        *column = index / grid->rows;
+        *row = index % grid->rows;
+    }
+}
+
+/* The cells share the allocation, as the buttons in homogeneous boxes
+ * did */
+static void
+cell_rectangle (CharpickGrid *grid,
+                gint          index,
+                GdkRectangle *rect)
+{
+    gint width = gtk_widget_get_allocated_width (GTK_WIDGET (grid));
+    gint height = gtk_widget_get_allocated_height (GTK_WIDGET (grid));
+    gint column, row;
+
+    cell_position (grid, index, &column, &row);
+
+    rect->x = width * column / grid->columns;
+    rect->y = height * row / grid->rows;
+    rect->width = width * (column + 1) / grid->columns - rect->x;
+    rect->height = height * (row + 1) / grid->rows - rect->y;
+}
+
+static gint
+cell_at (CharpickGrid *grid,
+         gdouble       x,
+         gdouble       y)
+{
+    gint width = gtk_widget_get_allocated_width (GTK_WIDGET (grid));
+    gint height = gtk_widget_get_allocated_height (GTK_WIDGET (grid));
+    gint column, row, index;
+
+    if (grid->columns == 0 || x < 0 || y < 0 || x >= width || y >= height)
+        return -1;
+
+    column = CLAMP ((gint) (x * grid->columns / width), 0, grid->columns - 1);
+    row = CLAMP ((gint) (y * grid->rows / height), 0, grid->rows - 1);
+    index = cell_index (grid, column, row);
+
+    return index < grid->n_chars ? index : -1;
+}
+
+static void
+queue_draw_cell (CharpickGrid *grid,
+                 gint          index)
+{
+    GdkRectangle rect;
+
+    /* not laid out yet, it is all drawn then */
+    if (index < 0 || index >= grid->n_chars || grid->columns == 0)
+        return;
+
+    cell_rectangle (grid, index, &rect);
+    gtk_widget_queue_draw_area (GTK_WIDGET (grid),
+                                rect.x, rect.y, rect.width, rect.height);
+}
+
+static GtkStyleContext *
+get_cell_context (CharpickGrid *grid)
+{
+    GtkWidget *widget = GTK_WIDGET (grid);
+    GtkWidgetPath *path;
+
+    if (grid->cell_context)
+        return grid->cell_context;
+
+    path = gtk_widget_path_copy (gtk_widget_get_path (widget));
+    gtk_widget_path_append_type (path, GTK_TYPE_TOGGLE_BUTTON);
+    gtk_widget_path_iter_set_object_name (path, -1, "button");
+    gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_FLAT);
+
+    grid->cell_context = gtk_style_context_new ();
+    gtk_style_context_set_path (grid->cell_context, path);
+    gtk_style_context_set_parent (grid->cell_context,
+                                  gtk_widget_get_style_context (widget));
+    gtk_style_context_set_screen (grid->cell_context,
+                                  gtk_widget_get_screen (widget));
+    gtk_widget_path_free (path);
+
+    return grid->cell_context;
+}
+
+static void
+update_accessible (CharpickGrid *grid)
+{
+    AtkObject *accessible;
+    gchar text[7];
+    gchar *description;
+
+    accessible = gtk_widget_get_accessible (GTK_WIDGET (grid));
+    if (grid->focus < 0 || !GTK_IS_ACCESSIBLE (accessible))
+        return;
+
+    text[g_unichar_to_utf8 (grid->chars[grid->focus], text)] = '\0';
+    description = g_strdup_printf (_("insert special character %s"), text);
+    atk_object_set_description (accessible, description);
+    g_free (description);
+}
+
+static void
+set_focus (CharpickGrid *grid,
+           gint          index)
+{
+    if (grid->focus == index)
+        return;
+
+    queue_draw_cell (grid, grid->focus);
+    grid->focus = index;
+    queue_draw_cell (grid, grid->focus);
+    update_accessible (grid);
+}
+
+static void
+set_prelight (CharpickGrid *grid,
+              gint          index)
+{
+    if (grid->prelight == index)
+        return;
+
+    queue_draw_cell (grid, grid->prelight);
+    grid->prelight = index;
+    queue_draw_cell (grid, grid->prelight);
+}
+
+static void
+toggle_cell (CharpickGrid *grid,
+             gint          index)
+{
+    if (index == grid->active) {
+        charpick_grid_set_active (grid, -1);
+        return;
+    }
+
+    charpick_grid_set_active (grid, index);
+    g_signal_emit (grid, signals[CHARACTER_ACTIVATED], 0, grid->chars[index]);
+}
+
+static void
+charpick_grid_get_preferred_width (GtkWidget *widget,
+                                   gint      *minimum,
+                                   gint      *natural)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    update_cells (grid);
+    *minimum = *natural = grid->columns * grid->cell_width;
+}
+
+static void
+charpick_grid_get_preferred_height (GtkWidget *widget,
+                                    gint      *minimum,
+                                    gint      *natural)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    update_cells (grid);
+    *minimum = *natural = grid->rows * grid->cell_height;
+}
+
+static void
+charpick_grid_realize (GtkWidget *widget)
+{
+    GtkAllocation allocation;
+    GdkWindowAttr attributes;
+    GdkWindow *window;
+
+    gtk_widget_set_realized (widget, TRUE);
+    gtk_widget_get_allocation (widget, &allocation);
+
+    attributes.window_type = GDK_WINDOW_CHILD;
+    attributes.x = allocation.x;
+    attributes.y = allocation.y;
+    attributes.width = allocation.width;
+    attributes.height = allocation.height;
+    attributes.wclass = GDK_INPUT_OUTPUT;
+    attributes.visual = gtk_widget_get_visual (widget);
+    attributes.event_mask = gtk_widget_get_events (widget) |
+                            GDK_BUTTON_PRESS_MASK |
+                            GDK_BUTTON_RELEASE_MASK |
+                            GDK_POINTER_MOTION_MASK |
+                            GDK_ENTER_NOTIFY_MASK |
+                            GDK_LEAVE_NOTIFY_MASK;
+
+    window = gdk_window_new (gtk_widget_get_parent_window (widget), &attributes,
+                             GDK_WA_X | GDK_WA_Y | GDK_WA_VISUAL);
+    gtk_widget_set_window (widget, window);
+    gtk_widget_register_window (widget, window);
+}
+
+static void
+charpick_grid_size_allocate (GtkWidget     *widget,
+                             GtkAllocation *allocation)
+{
+    gtk_widget_set_allocation (widget, allocation);
+    update_cells (CHARPICK_GRID (widget));
+
+    if (gtk_widget_get_realized (widget))
+        gdk_window_move_resize (gtk_widget_get_window (widget),
+                                allocation->x, allocation->y,
+                                allocation->width, allocation->height);
+}
+
+/* The glyph of cell i in state, context being in that state */
+static const CharpickGlyph *
+lookup_state_glyph (CharpickGrid    *grid,
+                    GtkStyleContext *context,
+                    GtkStateFlags    state,
+                    glong            i)
+{
+    CharpickGlyphs *glyph_set;
+
+    glyph_set = g_hash_table_lookup (grid->state_sets, GUINT_TO_POINTER (state));
+    if (!glyph_set) {
+        /* the set of the widget again, if the state keeps its color */
+        glyph_set = charpick_glyphs_get (GTK_WIDGET (grid), context);
+        g_hash_table_insert (grid->state_sets, GUINT_TO_POINTER (state), glyph_set);
+    }
+
+    return charpick_glyphs_lookup (glyph_set, grid->chars[i]);
+}
+
+static gboolean
+charpick_grid_draw (GtkWidget *widget,
+                    cairo_t   *cr)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+    GtkStyleContext *context;
+    GtkStateFlags widget_state;
+    GdkRectangle clip;
+    gboolean clipped;
+    glong i;
+
+    if (grid->columns == 0)
+        return FALSE;
+
+    context = get_cell_context (grid);
+    ensure_glyphs (grid);
+    clipped = gdk_cairo_get_clip_rectangle (cr, &clip);
+    widget_state = get_widget_state (grid);
+
+    for (i = 0; i < grid->n_chars; i++) {
+        GtkStateFlags state = widget_state;
+        const CharpickGlyph *glyph;
+        GdkRectangle rect;
+        gint x, y;
+
+        cell_rectangle (grid, i, &rect);
+        if (clipped && !gdk_rectangle_intersect (&clip, &rect, NULL))
+            continue;
+
+        if (i == grid->active)
+            state |= GTK_STATE_FLAG_CHECKED;
+        if (i == grid->prelight) {
+            state |= GTK_STATE_FLAG_PRELIGHT;
+            if (i == grid->pressed)
+                state |= GTK_STATE_FLAG_ACTIVE;
+        }
+
+        gtk_style_context_set_state (context, state);
+        gtk_render_background (context, cr, rect.x, rect.y, rect.width, rect.height);
+        gtk_render_frame (context, cr, rect.x, rect.y, rect.width, rect.height);
+
+        if (state == widget_state)
+            glyph = grid->glyphs[i];
+        else
+            glyph = lookup_state_glyph (grid, context, state, i);
+        if (glyph->surface) {
+            /* the origin of the glyph, centered in the cell */
+            x = rect.x + (rect.width - glyph->logical.width) / 2 - glyph->logical.x;
+            y = rect.y + (rect.height - glyph->logical.height) / 2 - glyph->logical.y;
+            cairo_set_source_surface (cr, glyph->surface,
+                                      x + glyph->area.x, y + glyph->area.y);
+            cairo_paint (cr);
+        }
+
+        if (i == grid->focus && gtk_widget_has_visible_focus (widget))
+            gtk_render_focus (context, cr, rect.x, rect.y, rect.width, rect.height);
+    }
+
+    gtk_style_context_set_state (context, GTK_STATE_FLAG_NORMAL);
+
+    return FALSE;
+}
+
+static gboolean
+charpick_grid_button_press_event (GtkWidget      *widget,
+                                  GdkEventButton *event)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    /* the other buttons are for the applet */
+    if (event->button != 1)
+        return FALSE;
+
+    if (event->type != GDK_BUTTON_PRESS)
+        return TRUE;
+
+    grid->pressed = cell_at (grid, event->x, event->y);
+    queue_draw_cell (grid, grid->pressed);
+
+    if (grid->pressed >= 0) {
+        gtk_widget_grab_focus (widget);
+        set_focus (grid, grid->pressed);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+charpick_grid_button_release_event (GtkWidget      *widget,
+                                    GdkEventButton *event)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+    gint pressed;
+
+    if (event->button != 1)
+        return FALSE;
+
+    pressed = grid->pressed;
+    grid->pressed = -1;
+    queue_draw_cell (grid, pressed);
+
+    if (pressed >= 0 && cell_at (grid, event->x, event->y) == pressed)
+        toggle_cell (grid, pressed);
+
+    return TRUE;
+}
+
+static gboolean
+charpick_grid_motion_notify_event (GtkWidget      *widget,
+                                   GdkEventMotion *event)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    set_prelight (grid, cell_at (grid, event->x, event->y));
+
+    return FALSE;
+}
+
+static gboolean
+charpick_grid_leave_notify_event (GtkWidget        *widget,
+                                  GdkEventCrossing *event)
+{
+    set_prelight (CHARPICK_GRID (widget), -1);
+
+    return FALSE;
+}
+
+static gboolean
+charpick_grid_key_press_event (GtkWidget   *widget,
+                               GdkEventKey *event)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+    gint column, row, index;
+
+    if (grid->columns == 0)
+        return FALSE;
+
+    index = MAX (grid->focus, 0);
+    cell_position (grid, index, &column, &row);
+
+    switch (event->keyval) {
+        case GDK_KEY_space:
+        case GDK_KEY_Return:
+        case GDK_KEY_KP_Enter:
+            toggle_cell (grid, index);
+            return TRUE;
+        case GDK_KEY_Left:
+        case GDK_KEY_KP_Left:
+            column--;
+            break;
+        case GDK_KEY_Right:
+        case GDK_KEY_KP_Right:
+            column++;
+            break;
+        case GDK_KEY_Up:
+        case GDK_KEY_KP_Up:
+            row--;
+            break;
+        case GDK_KEY_Down:
+        case GDK_KEY_KP_Down:
+            row++;
+            break;
+        default:
+            return GTK_WIDGET_CLASS (charpick_grid_parent_class)->key_press_event (widget, event);
+    }
+
+    column = CLAMP (column, 0, grid->columns - 1);
+    row = CLAMP (row, 0, grid->rows - 1);
+    /* the last line may be short */
+    set_focus (grid, MIN (cell_index (grid, column, row), grid->n_chars - 1));
+
+    return TRUE;
+}
+
+static gboolean
+charpick_grid_focus_in_event (GtkWidget     *widget,
+                              GdkEventFocus *event)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    if (grid->focus < 0 && grid->n_chars > 0)
+        set_focus (grid, MAX (grid->active, 0));
+    queue_draw_cell (grid, grid->focus);
+
+    return GTK_WIDGET_CLASS (charpick_grid_parent_class)->focus_in_event (widget, event);
+}
+
+static gboolean
+charpick_grid_focus_out_event (GtkWidget     *widget,
+                               GdkEventFocus *event)
+{
+    queue_draw_cell (CHARPICK_GRID (widget), CHARPICK_GRID (widget)->focus);
+
+    return GTK_WIDGET_CLASS (charpick_grid_parent_class)->focus_out_event (widget, event);
+}
+
+static gboolean
+charpick_grid_query_tooltip (GtkWidget  *widget,
+                             gint        x,
+                             gint        y,
+                             gboolean    keyboard_mode,
+                             GtkTooltip *tooltip)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+    GdkRectangle rect;
+    gchar *name;
+    gint index;
+
+    index = keyboard_mode ? grid->focus : cell_at (grid, x, y);
+    if (index < 0 || grid->columns == 0)
+        return FALSE;
+
+#ifdef HAVE_GUCHARMAP
+    /* TRANSLATOR: This sentance reads something like 'Insert "PILCROW SIGN"'
+     *             hopefully, the name of the unicode character has already
+     *             been translated.
+     */
+    name = g_strdup_printf (_("Insert \"%s\""),
+                            gucharmap_get_unicode_name (grid->chars[index]));
+#else
+    name = g_strdup (_("Insert special character"));
+#endif
+
+    gtk_tooltip_set_text (tooltip, name);
+    g_free (name);
+
+    cell_rectangle (grid, index, &rect);
+    gtk_tooltip_set_tip_area (tooltip, &rect);
+
+    return TRUE;
+}
+
+static void
+charpick_grid_style_updated (GtkWidget *widget)
+{
+    CharpickGrid *grid = CHARPICK_GRID (widget);
+
+    GTK_WIDGET_CLASS (charpick_grid_parent_class)->style_updated (widget);
+
+    /* the font or the colors may have changed */
+    release_glyphs (grid);
+    g_clear_object (&grid->cell_context);
+    gtk_widget_queue_resize (widget);
+}
+
+static void
+scale_factor_cb (CharpickGrid *grid,
+                 GParamSpec   *pspec,
+                 gpointer      data)
+{
+    /* the glyphs are drawn at the scale factor */
+    release_glyphs (grid);
+    gtk_widget_queue_resize (GTK_WIDGET (grid));
+}
+
+static void
+charpick_grid_finalize (GObject *object)
+{
+    CharpickGrid *grid = CHARPICK_GRID (object);
+
+    g_free (grid->chars);
+    release_glyphs (grid);
+    g_hash_table_destroy (grid->state_sets);
+    g_clear_object (&grid->cell_context);
+
+    G_OBJECT_CLASS (charpick_grid_parent_class)->finalize (object);
+}
+
+static void
+charpick_grid_init (CharpickGrid *grid)
+{
+    gtk_widget_set_has_window (GTK_WIDGET (grid), TRUE);
+    gtk_widget_set_can_focus (GTK_WIDGET (grid), TRUE);
+    gtk_widget_set_has_tooltip (GTK_WIDGET (grid), TRUE);
+
+    grid->orientation = GTK_ORIENTATION_HORIZONTAL;
+    grid->active = -1;
+    grid->pressed = -1;
+    grid->prelight = -1;
+    grid->focus = -1;
+    grid->state_sets = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify) charpick_glyphs_release);
+
+    g_signal_connect (grid, "notify::scale-factor",
+                      G_CALLBACK (scale_factor_cb), NULL);
+}
+
+static void
+charpick_grid_class_init (CharpickGridClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    object_class->finalize = charpick_grid_finalize;
+
+    widget_class->get_preferred_width = charpick_grid_get_preferred_width;
+    widget_class->get_preferred_height = charpick_grid_get_preferred_height;
+    widget_class->realize = charpick_grid_realize;
+    widget_class->size_allocate = charpick_grid_size_allocate;
+    widget_class->draw = charpick_grid_draw;
+    widget_class->button_press_event = charpick_grid_button_press_event;
+    widget_class->button_release_event = charpick_grid_button_release_event;
+    widget_class->motion_notify_event = charpick_grid_motion_notify_event;
+    widget_class->leave_notify_event = charpick_grid_leave_notify_event;
+    widget_class->key_press_event = charpick_grid_key_press_event;
+    widget_class->focus_in_event = charpick_grid_focus_in_event;
+    widget_class->focus_out_event = charpick_grid_focus_out_event;
+    widget_class->query_tooltip = charpick_grid_query_tooltip;
+    widget_class->style_updated = charpick_grid_style_updated;
+
+    signals[CHARACTER_ACTIVATED] =
+        g_signal_new ("character-activated",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 1, G_TYPE_UINT);
+
+    gtk_widget_class_set_css_name (widget_class, "charpick-grid");
+}
+
+GtkWidget *
+charpick_grid_new (void)
+{
+    return g_object_new (CHARPICK_TYPE_GRID, NULL);
+}
+
+void
+charpick_grid_set_chars (CharpickGrid *grid,
+                         const gchar  *chars)
+{
+    g_free (grid->chars);
+    grid->chars = g_utf8_to_ucs4_fast (chars, -1, &grid->n_chars);
+
+    grid->active = -1;
+    grid->pressed = -1;
+    grid->prelight = -1;
+    grid->focus = -1;
+    clear_glyphs (grid);
+
+    gtk_widget_queue_resize (GTK_WIDGET (grid));
+}
+
+void
+charpick_grid_set_layout (CharpickGrid   *grid,
+                          GtkOrientation  orientation,
+                          gint            panel_size)
+{
+    if (grid->orientation == orientation && grid->panel_size == panel_size)
+        return;
+
+    grid->orientation = orientation;
+    grid->panel_size = panel_size;
+
+    gtk_widget_queue_resize (GTK_WIDGET (grid));
+}
+
+gint
+charpick_grid_get_active (CharpickGrid *grid)
+{
+    return grid->active;
+}
+
+void
+charpick_grid_set_active (CharpickGrid *grid,
+                          gint          index)
+{
+    if (index >= grid->n_chars)
+        index = -1;
+
+    if (grid->active == index)
+        return;
+
+    queue_draw_cell (grid, grid->active);
+    grid->active = index;
+    queue_draw_cell (grid, grid->active);
+
+    if (index >= 0)
+        set_focus (grid, index);
+}
@@ -0,0 +1,36 @@
+/* charpick-grid.h -- the characters of a palette, as one widget */
+
+#ifndef __CHARPICK_GRID_H__
+#define __CHARPICK_GRID_H__
+
+#include <gtk/gtk.h>
+
+/* The characters are laid out in as many lines as fit across the panel
+ * and drawn as flat toggle buttons, from the glyphs of charpick-glyphs.h,
+ * shared by the grids of the same style. Clicks are hit-tested by the grid,
+ * so a palette of any size is a single widget, and a new panel size
+ * only lays the cells out again.
+ *
+ * "character-activated" is emitted with the character when a cell is
+ * toggled on. Clicking the active cell again toggles it off. */
+
+#define CHARPICK_TYPE_GRID charpick_grid_get_type ()
+G_DECLARE_FINAL_TYPE (CharpickGrid, charpick_grid,
+                      CHARPICK, GRID, GtkWidget)
+
+GtkWidget *charpick_grid_new (void);
+
+void charpick_grid_set_chars (CharpickGrid *grid,
+                              const gchar  *chars);
+
+/* the lines go along orientation, as many as fit in panel_size */
+void charpick_grid_set_layout (CharpickGrid   *grid,
+                               GtkOrientation  orientation,
+                               gint            panel_size);
+
+/* the index of the active character, -1 for none */
+gint charpick_grid_get_active (CharpickGrid *grid);
+void charpick_grid_set_active (CharpickGrid *grid,
+                               gint          index);
+
+#endif /* __CHARPICK_GRID_H__ */
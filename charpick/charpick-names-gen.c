@@ -0,0 +1,199 @@
+/* charpick-names-gen.c -- writes the index of the Unicode character names
+ * read by charpick-names.c, from the names gucharmap knows.
+ *
+ * usage: charpick-names-gen FILE
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gucharmap/gucharmap.h>
+#include "charpick-names.h"
+
+typedef struct {
+    gunichar  codepoint;
+    gchar    *name;
+} Name;
+
+static gint
+compare_names (gconstpointer a,
+               gconstpointer b)
+{
+    const Name *name_a = a;
+    const Name *name_b = b;
+    gint result = strcmp (name_a->name, name_b->name);
+
+    if (result == 0)
+        result = name_a->codepoint < name_b->codepoint ? -1 : 1;
+
+    return result;
+}
+
+static gint
+compare_keys (gconstpointer a,
+              gconstpointer b)
+{
+    guint32 key_a = GPOINTER_TO_UINT (*(gconstpointer *) a);
+    guint32 key_b = GPOINTER_TO_UINT (*(gconstpointer *) b);
+
+    return key_a < key_b ? -1 : key_a > key_b;
+}
+
+/* Names made up of a prefix and the code point, as of the CJK
+ * ideographs, only tell the code point again */
+static gboolean
+is_wanted (gunichar     codepoint,
+           const gchar *name)
+{
+    gchar suffix[16];
+
+    switch (g_unichar_type (codepoint)) {
+        case G_UNICODE_UNASSIGNED:
+        case G_UNICODE_PRIVATE_USE:
+        case G_UNICODE_SURROGATE:
+            return FALSE;
+        default:
+            break;
+    }
+
+    if (!name || name[0] == '\0' || name[0] == '<')
+        return FALSE;
+
+    g_snprintf (suffix, sizeof (suffix), "-%04X", codepoint);
+
+    return !g_str_has_suffix (name, suffix);
+}
+
+static void
+append_u32 (GByteArray *data,
+            guint32     value)
+{
+    g_byte_array_append (data, (const guint8 *) &value, sizeof (value));
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+    CharpickNamesHeader header;
+    GArray *names;
+    GHashTable *trigrams;
+    GList *keys, *l;
+    GByteArray *data, *strings;
+    GPtrArray *sorted_keys;
+    GError *error = NULL;
+    guint32 n_postings = 0;
+    gunichar codepoint;
+    guint i;
+
+    if (argc != 2) {
+        g_printerr ("usage: %s FILE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    names = g_array_new (FALSE, FALSE, sizeof (Name));
+    for (codepoint = 0; codepoint <= 0x10FFFF; codepoint++) {
+        const gchar *unicode_name = gucharmap_get_unicode_name (codepoint);
+        Name name;
+
+        /* the made up names are in a static buffer */
+        if (is_wanted (codepoint, unicode_name)) {
+            name.codepoint = codepoint;
+            name.name = g_strdup (unicode_name);
+            g_array_append_val (names, name);
+        }
+    }
+    g_array_sort (names, compare_names);
+
+    /* the sorted lists of the names each trigram is in */
+    trigrams = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+    for (i = 0; i < names->len; i++) {
+        const gchar *name = g_array_index (names, Name, i).name;
+        gsize j, length = strlen (name);
+
+        for (j = 0; j + 3 <= length; j++) {
+            gpointer key = GUINT_TO_POINTER (CHARPICK_NAMES_TRIGRAM (name + j));
+            GArray *postings = g_hash_table_lookup (trigrams, key);
+
+            if (!postings) {
+                postings = g_array_new (FALSE, FALSE, sizeof (guint32));
+                g_hash_table_insert (trigrams, key, postings);
+            }
+            if (postings->len == 0 ||
+                g_array_index (postings, guint32, postings->len - 1) != i) {
+                guint32 index = i;
+
+                g_array_append_val (postings, index);
+                n_postings++;
+            }
+        }
+    }
+
+    sorted_keys = g_ptr_array_new ();
+    keys = g_hash_table_get_keys (trigrams);
+    for (l = keys; l; l = l->next)
+        g_ptr_array_add (sorted_keys, l->data);
+    g_list_free (keys);
+    g_ptr_array_sort (sorted_keys, compare_keys);
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, CHARPICK_NAMES_MAGIC, sizeof (header.magic));
+    header.n_names = names->len;
+    header.n_trigrams = sorted_keys->len;
+    header.names_offset = sizeof (header);
+    header.trigrams_offset = header.names_offset + names->len * sizeof (CharpickNameEntry);
+    header.postings_offset = header.trigrams_offset + sorted_keys->len * sizeof (CharpickNameTrigram);
+    header.strings_offset = header.postings_offset + n_postings * sizeof (guint32);
+
+    data = g_byte_array_new ();
+    g_byte_array_append (data, (const guint8 *) &header, sizeof (header));
+
+    strings = g_byte_array_new ();
+    for (i = 0; i < names->len; i++) {
+        const Name *name = &g_array_index (names, Name, i);
+
+        append_u32 (data, name->codepoint);
+        append_u32 (data, strings->len);
+        g_byte_array_append (strings, (const guint8 *) name->name, strlen (name->name) + 1);
+    }
+
+    n_postings = 0;
+    for (i = 0; i < sorted_keys->len; i++) {
+        GArray *postings = g_hash_table_lookup (trigrams, sorted_keys->pdata[i]);
+
+        append_u32 (data, GPOINTER_TO_UINT (sorted_keys->pdata[i]));
+        append_u32 (data, n_postings);
+        append_u32 (data, postings->len);
+        n_postings += postings->len;
+    }
+
+    for (i = 0; i < sorted_keys->len; i++) {
+        GArray *postings = g_hash_table_lookup (trigrams, sorted_keys->pdata[i]);
+
+        g_byte_array_append (data, (const guint8 *) postings->data,
+                             postings->len * sizeof (guint32));
+    }
+
+    g_assert (data->len == header.strings_offset);
+    g_byte_array_append (data, strings->data, strings->len);
+
+    /* the whole size is only known now */
+    ((CharpickNamesHeader *) data->data)->size = data->len;
+
+    if (!g_file_set_contents (argv[1], (const gchar *) data->data, data->len, &error)) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+
+    g_byte_array_unref (strings);
+    g_byte_array_unref (data);
+    g_ptr_array_unref (sorted_keys);
+    g_hash_table_destroy (trigrams);
+    for (i = 0; i < names->len; i++)
+        g_free (g_array_index (names, Name, i).name);
+    g_array_unref (names);
+
+    return EXIT_SUCCESS;
+}
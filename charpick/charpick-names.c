@@ -0,0 +1,239 @@
+/* charpick-names.c -- the index of the Unicode character names */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include "charpick-names.h"
+
+struct _CharpickNames {
+    GMappedFile               *file;
+    const CharpickNameEntry   *entries;
+    const CharpickNameTrigram *trigrams;
+    const guint32             *postings;
+    const gchar               *strings;
+    guint32                    n_names;
+    guint32                    n_trigrams;
+};
+
+static gboolean
+table_fits (const CharpickNamesHeader *header,
+            guint32                    offset,
+            guint32                    count,
+            gsize                      size)
+{
+    return offset <= header->size && count <= (header->size - offset) / size;
+}
+
+/* Checked once, so the searches can trust the offsets */
+static gboolean
+offsets_valid (const CharpickNames *names,
+               gsize                n_postings,
+               gsize                strings_size)
+{
+    guint32 i;
+
+    for (i = 0; i < names->n_trigrams; i++) {
+        if (names->trigrams[i].first > n_postings ||
+            names->trigrams[i].count > n_postings - names->trigrams[i].first)
+            return FALSE;
+    }
+
+    for (i = 0; i < names->n_names; i++) {
+        if (names->entries[i].name >= strings_size)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static CharpickNames *
+names_open (const gchar *path)
+{
+    const CharpickNamesHeader *header;
+    CharpickNames *names;
+    GMappedFile *file;
+    const gchar *data;
+    gsize size;
+    GError *error = NULL;
+
+    file = g_mapped_file_new (path, FALSE, &error);
+    if (!file) {
+        g_debug ("no character names: %s", error->message);
+        g_error_free (error);
+        return NULL;
+    }
+
+    data = g_mapped_file_get_contents (file);
+    size = g_mapped_file_get_length (file);
+    header = (const CharpickNamesHeader *) data;
+
+    /* the strings end the file, so a NUL there ends them all */
+    if (size < sizeof (*header) ||
+        memcmp (header->magic, CHARPICK_NAMES_MAGIC, sizeof (header->magic)) != 0 ||
+        header->size != size || data[size - 1] != '\0' ||
+        !table_fits (header, header->names_offset, header->n_names, sizeof (CharpickNameEntry)) ||
+        !table_fits (header, header->trigrams_offset, header->n_trigrams, sizeof (CharpickNameTrigram)) ||
+        header->postings_offset > header->strings_offset ||
+        header->strings_offset >= size ||
+        (header->names_offset | header->trigrams_offset | header->postings_offset) % 4 != 0) {
+        g_warning ("%s is not an index of character names", path);
+        g_mapped_file_unref (file);
+        return NULL;
+    }
+
+    names = g_new0 (CharpickNames, 1);
+    names->file = file;
+    names->entries = (const CharpickNameEntry *) (data + header->names_offset);
+    names->trigrams = (const CharpickNameTrigram *) (data + header->trigrams_offset);
+    names->postings = (const guint32 *) (data + header->postings_offset);
+    names->strings = data + header->strings_offset;
+    names->n_names = header->n_names;
+    names->n_trigrams = header->n_trigrams;
+
+    if (!offsets_valid (names,
+                        (header->strings_offset - header->postings_offset) / sizeof (guint32),
+                        size - header->strings_offset)) {
+        g_warning ("%s is not an index of character names", path);
+        g_mapped_file_unref (file);
+        g_free (names);
+        return NULL;
+    }
+
+    return names;
+}
+
+CharpickNames *
+charpick_names_get (void)
+{
+    static CharpickNames *names = NULL;
+    static gboolean tried = FALSE;
+
+    if (!tried) {
+        names = names_open (CHARPICK_NAMES_INDEX);
+        tried = TRUE;
+    }
+
+    return names;
+}
+
+static const gchar *
+entry_name (CharpickNames *names,
+            guint32        index)
+{
+    return names->strings + names->entries[index].name;
+}
+
+static const CharpickNameTrigram *
+find_trigram (CharpickNames *names,
+              guint32        key)
+{
+    guint32 low = 0, high = names->n_trigrams;
+
+    while (low < high) {
+        guint32 middle = low + (high - low) / 2;
+
+        if (names->trigrams[middle].key < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low < names->n_trigrams && names->trigrams[low].key == key)
+        return &names->trigrams[low];
+
+    return NULL;
+}
+
+guint
+charpick_names_search (CharpickNames     *names,
+                       const gchar       *query,
+                       CharpickNameMatch *matches,
+                       guint              max)
+{
+    const CharpickNameTrigram *rarest = NULL;
+    guint32 low, high, i;
+    gsize length;
+    gchar *key;
+    guint n = 0;
+
+    key = g_ascii_strup (query, -1);
+    g_strstrip (key);
+    length = strlen (key);
+    if (length == 0 || max == 0) {
+        g_free (key);
+        return 0;
+    }
+
+    /* the names starting with the query are next to each other */
+    low = 0;
+    high = names->n_names;
+    while (low < high) {
+        guint32 middle = low + (high - low) / 2;
+
+        if (strcmp (entry_name (names, middle), key) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    for (i = low; i < names->n_names && n < max; i++) {
+        if (strncmp (entry_name (names, i), key, length) != 0)
+            break;
+        matches[n].codepoint = names->entries[i].codepoint;
+        matches[n].name = entry_name (names, i);
+        n++;
+    }
+
+    /* a query shorter than a trigram has none to narrow the names down,
+     * so they are all looked at */
+    if (length < 3) {
+        for (i = 0; i < names->n_names && n < max; i++) {
+            const gchar *name = entry_name (names, i);
+
+            if (strncmp (name, key, length) == 0 || !strstr (name, key))
+                continue;
+
+            matches[n].codepoint = names->entries[i].codepoint;
+            matches[n].name = name;
+            n++;
+        }
+
+        g_free (key);
+
+        return n;
+    }
+
+    /* the others have all the trigrams of the query, so only the names
+     * with the rarest one are looked at */
+    for (i = 0; i + 3 <= length; i++) {
+        const CharpickNameTrigram *trigram;
+
+        trigram = find_trigram (names, CHARPICK_NAMES_TRIGRAM (key + i));
+        if (!trigram) {
+            rarest = NULL;
+            break;
+        }
+        if (!rarest || trigram->count < rarest->count)
+            rarest = trigram;
+    }
+
+    for (i = 0; rarest && i < rarest->count && n < max; i++) {
+        guint32 index = names->postings[rarest->first + i];
+        const gchar *name;
+
+        if (index >= names->n_names)
+            continue;
+
+        name = entry_name (names, index);
+        /* those were found by the prefix */
+        if (strncmp (name, key, length) == 0 || !strstr (name, key))
+            continue;
+
+        matches[n].codepoint = names->entries[index].codepoint;
+        matches[n].name = name;
+        n++;
+    }
+
+    g_free (key);
+
+    return n;
+}
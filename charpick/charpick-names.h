@@ -0,0 +1,65 @@
+/* charpick-names.h -- the index of the Unicode character names */
+
+#ifndef __CHARPICK_NAMES_H__
+#define __CHARPICK_NAMES_H__
+
+#include <glib.h>
+
+/* The names are written at build time by charpick-names-gen into one
+ * file, mapped read-only by the first search and shared by the applets
+ * of the process:
+ *
+ *   a header
+ *   the names, sorted, for the prefix searches by bisection
+ *   the trigrams of the names, sorted, each with the sorted list of the
+ *   names it is in, for the substring searches
+ *   the name strings
+ *
+ * The numbers are 32 bit in the byte order of the build. The names are
+ * upper case ASCII, as Unicode names are. */
+
+#define CHARPICK_NAMES_MAGIC "CPNAMES1"
+
+typedef struct {
+    gchar   magic[8];
+    guint32 n_names;
+    guint32 n_trigrams;
+    guint32 names_offset;     /* CharpickNameEntry [n_names] */
+    guint32 trigrams_offset;  /* CharpickNameTrigram [n_trigrams] */
+    guint32 postings_offset;  /* guint32, indices of names */
+    guint32 strings_offset;
+    guint32 size;
+} CharpickNamesHeader;
+
+typedef struct {
+    guint32 codepoint;
+    guint32 name;             /* from strings_offset */
+} CharpickNameEntry;
+
+typedef struct {
+    guint32 key;              /* the three bytes, the first one highest */
+    guint32 first;            /* the first posting */
+    guint32 count;
+} CharpickNameTrigram;
+
+#define CHARPICK_NAMES_TRIGRAM(s) \
+    (((guint32) (guchar) (s)[0] << 16) | ((guint32) (guchar) (s)[1] << 8) | (guchar) (s)[2])
+
+typedef struct {
+    gunichar     codepoint;
+    const gchar *name;        /* in the mapped index */
+} CharpickNameMatch;
+
+typedef struct _CharpickNames CharpickNames;
+
+/* Maps the index, once per process. Returns NULL if it can't be read. */
+CharpickNames *charpick_names_get (void);
+
+/* Fills matches with up to max names containing query, the names
+ * starting with it first. Returns how many were found. */
+guint charpick_names_search (CharpickNames     *names,
+                             const gchar       *query,
+                             CharpickNameMatch *matches,
+                             guint              max);
+
+#endif /* __CHARPICK_NAMES_H__ */
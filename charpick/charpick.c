@@ -7,10 +7,8 @@
 #include <string.h>
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
-#ifdef HAVE_GUCHARMAP
-#include <gucharmap/gucharmap.h>
-#endif
 #include "charpick.h"
+#include "charpick-grid.h"
 
 /* The comment for each char list has the html entity names of the chars */
 /* All gunicar codes should end in 0 */
@@ -131,7 +129,7 @@ charpick_selection_handler (GtkWidget        *widget,
     return;
 }
 
-/* untoggles the active toggle_button when we lose the selection */
+/* untoggles the active character when we lose the selection */
 static gint
 selection_clear_cb (GtkWidget         *widget,
                     GdkEventSelection *event,
@@ -139,44 +137,36 @@ selection_clear_cb (GtkWidget         *widget,
 {
     charpick_data *curr_data = data;
 
-    if (curr_data->last_toggle_button)
-        gtk_toggle_button_set_active (curr_data->last_toggle_button, FALSE);
+    if (curr_data->grid)
+        charpick_grid_set_active (CHARPICK_GRID (curr_data->grid), -1);
 
-    curr_data->last_toggle_button = NULL;
     return TRUE;
 }
 
-static gint
-toggle_button_toggled_cb (GtkToggleButton *button,
-                          gpointer         data)
+/* makes the character the one to paste */
+void
+select_unichar (charpick_data *curr_data,
+                gunichar       unichar)
 {
-    charpick_data *curr_data = data;
-    gint button_index;
-    gboolean toggled;
+    curr_data->selected_unichar = unichar;
+    /* set this? widget as the selection owner */
+    gtk_selection_owner_set (curr_data->invisible,
+                             GDK_SELECTION_PRIMARY,
+                             GDK_CURRENT_TIME);
+    gtk_selection_owner_set (curr_data->invisible,
+                             GDK_SELECTION_CLIPBOARD,
+                             GDK_CURRENT_TIME);
+}
 
-    button_index = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (button), "index"));
-    toggled = gtk_toggle_button_get_active (button);
+static void
+character_activated_cb (CharpickGrid *grid,
+                        guint         unichar,
+                        gpointer      data)
+{
+    charpick_data *curr_data = data;
 
-    if (toggled)
-    {
-        gunichar unichar;
-        if (curr_data->last_toggle_button && (button != curr_data->last_toggle_button))
-            gtk_toggle_button_set_active (curr_data->last_toggle_button, FALSE);
-
-        curr_data->last_toggle_button = button;
-        gtk_widget_grab_focus (curr_data->applet);
-        unichar = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (button), "unichar"));
-        curr_data->selected_unichar = unichar;
-        /* set this? widget as the selection owner */
-        gtk_selection_owner_set (curr_data->invisible,
-                                 GDK_SELECTION_PRIMARY,
-                                 GDK_CURRENT_TIME);
-        gtk_selection_owner_set (curr_data->invisible,
-                                 GDK_SELECTION_CLIPBOARD,
-                                 GDK_CURRENT_TIME);
-        curr_data->last_index = button_index;
-    }
-    return TRUE;
+    select_unichar (curr_data, unichar);
+    curr_data->last_index = charpick_grid_get_active (grid);
 }
 
 /* This is a hack around the fact that gtk+ doesn't
@@ -263,7 +253,6 @@ key_press_event (GtkWidget   *widget,
     else
       p_curr_data->charlist = "hello";
     p_curr_data->last_index = NO_LAST_INDEX;
-    p_curr_data->last_toggle_button = NULL;
     build_table (p_curr_data);
 #endif
   return FALSE;
@@ -378,21 +367,14 @@ static inline void force_no_button_padding (GtkWidget *widget)
     gtk_widget_set_name (widget, "charpick-applet-button");
 }
 
-/* creates table of buttons, sets up their callbacks, and packs the table in
-   the event box */
+/* creates the palette button and the grid of characters, and packs them in
+   the applet */
 
 void
 build_table (charpick_data *p_curr_data)
 {
-    GtkWidget *box, *button_box, **row_box;
+    GtkWidget *box;
     GtkWidget *button, *arrow;
-    gint i = 0, len = g_utf8_strlen (p_curr_data->charlist, -1);
-    GtkWidget **toggle_button;
-    gchar *charlist;
-    gint max_width=1, max_height=1;
-    gint size_ratio;
-
-    toggle_button = g_new (GtkWidget *, len);
 
     if (p_curr_data->box)
         gtk_widget_destroy (p_curr_data->box);
@@ -447,126 +429,22 @@ build_table (charpick_data *p_curr_data)
                           p_curr_data->applet);
     }
 
-    charlist = p_curr_data->charlist;
-    for (i = 0; i < len; i++) {
-        gchar label[7];
-        GtkRequisition req;
-        gchar *atk_desc;
-        gchar *name;
-        g_utf8_strncpy (label, charlist, 1);
-        charlist = g_utf8_next_char (charlist);
-
-#ifdef HAVE_GUCHARMAP
-        /* TRANSLATOR: This sentance reads something like 'Insert "PILCROW SIGN"'
-         *             hopefully, the name of the unicode character has already
-         *             been translated.
-         */
-        name = g_strdup_printf (_("Insert \"%s\""),
-                                gucharmap_get_unicode_name (g_utf8_get_char (label)));
-#else
-        name = g_strdup (_("Insert special character"));
-#endif
-
-        toggle_button[i] = gtk_toggle_button_new_with_label (label);
-        atk_desc =  g_strdup_printf (_("insert special character %s"), label);
-
-        set_atk_name_description (toggle_button[i], NULL, atk_desc);
-        g_free (atk_desc);
-        gtk_widget_show (toggle_button[i]);
-        gtk_button_set_relief (GTK_BUTTON (toggle_button[i]), GTK_RELIEF_NONE);
-
-        /* FIXME : evil hack (see force_no_button_padding) */
-        force_no_button_padding (toggle_button[i]);
-
-        gtk_widget_set_tooltip_text (toggle_button[i], name);
-        g_free (name);
-
-        gtk_widget_get_preferred_size (toggle_button[i], NULL, &req);
-
-        max_width = MAX (max_width, req.width);
-        max_height = MAX (max_height, req.height-2);
-
-        g_object_set_data (G_OBJECT (toggle_button[i]), "unichar",
-                           GINT_TO_POINTER (g_utf8_get_char (label)));
-
-        g_signal_connect (toggle_button[i], "toggled",
-                          G_CALLBACK (toggle_button_toggled_cb),
-                          p_curr_data);
-
-        g_signal_connect (toggle_button[i], "button-press-event",
-                          G_CALLBACK (button_press_hack),
-                          p_curr_data->applet);
-    }
-
-    if (p_curr_data->panel_vertical) {
-        size_ratio = p_curr_data->panel_size / max_width;
-        button_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-    } else {
-        size_ratio = p_curr_data->panel_size / max_height;
-        button_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
-    }
-
-    gtk_box_set_homogeneous (GTK_BOX (button_box), TRUE);
-    gtk_box_pack_start (GTK_BOX (box), button_box, TRUE, TRUE, 0);
-
-    size_ratio = MAX (size_ratio, 1);
-    row_box = g_new0 (GtkWidget *, size_ratio);
-    for (i=0; i < size_ratio; i++) {
-        if (!p_curr_data->panel_vertical)
-            row_box[i] = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
-        else
-            row_box[i] = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
-
-        gtk_box_set_homogeneous (GTK_BOX (row_box[i]), TRUE);
-        gtk_box_pack_start (GTK_BOX (button_box), row_box[i], TRUE, TRUE, 0);
-    }
-
-    for (i = 0; i <len; i++) {
-        int delta = len/size_ratio;
-        int index;
-
-        if (delta > 0)
-            index = i / delta;
-        else
-            index = i;
-
-        index = CLAMP (index, 0, size_ratio-1);
-        gtk_box_pack_start (GTK_BOX (row_box[index]),
-                            toggle_button[i],
-                            TRUE, TRUE, 0);
-    }
-
-    g_free (toggle_button);
-    g_free (row_box);
+    p_curr_data->grid = charpick_grid_new ();
+    charpick_grid_set_chars (CHARPICK_GRID (p_curr_data->grid), p_curr_data->charlist);
+    charpick_grid_set_layout (CHARPICK_GRID (p_curr_data->grid),
+                              p_curr_data->panel_vertical ? GTK_ORIENTATION_VERTICAL
+                                                          : GTK_ORIENTATION_HORIZONTAL,
+                              p_curr_data->panel_size);
+    set_atk_name_description (p_curr_data->grid, _("Special characters"), NULL);
+    g_signal_connect (p_curr_data->grid, "character-activated",
+                      G_CALLBACK (character_activated_cb),
+                      p_curr_data);
+    gtk_box_pack_start (GTK_BOX (box), p_curr_data->grid, TRUE, TRUE, 0);
 
     gtk_container_add (GTK_CONTAINER (p_curr_data->applet), box);
     gtk_widget_show_all (p_curr_data->box);
 
     p_curr_data->last_index = NO_LAST_INDEX;
-    p_curr_data->last_toggle_button = NULL;
-}
-
-static gboolean
-rebuild_cb (gpointer user_data)
-{
-    charpick_data *curr_data;
-
-    curr_data = user_data;
-    curr_data->rebuild_id = 0;
-
-    build_table (curr_data);
-
-    return G_SOURCE_REMOVE;
-}
-
-static void
-queue_rebuild (charpick_data *curr_data)
-{
-    if (curr_data->rebuild_id != 0)
-        return;
-
-    curr_data->rebuild_id = g_idle_add (rebuild_cb, curr_data);
-    g_source_set_name_by_id (curr_data->rebuild_id, "[charpick] rebuild_cb");
 }
 
 static void
@@ -585,7 +463,11 @@ applet_size_allocate (MatePanelApplet *applet,
         curr_data->panel_size = allocation->height;
     }
 
-    queue_rebuild (curr_data);
+    /* only the cells are laid out again */
+    charpick_grid_set_layout (CHARPICK_GRID (curr_data->grid),
+                              curr_data->panel_vertical ? GTK_ORIENTATION_VERTICAL
+                                                        : GTK_ORIENTATION_HORIZONTAL,
+                              curr_data->panel_size);
     return;
 }
 
@@ -669,16 +551,12 @@ applet_destroy (GtkWidget *widget,
 
     g_return_if_fail (curr_data);
 
-    if (curr_data->rebuild_id != 0)
-    {
-        g_source_remove (curr_data->rebuild_id);
-        curr_data->rebuild_id = 0;
-    }
-
     if (curr_data->about_dialog)
         gtk_widget_destroy (curr_data->about_dialog);
     if (curr_data->propwindow)
         gtk_widget_destroy (curr_data->propwindow);
+    if (curr_data->search_window)
+        gtk_widget_destroy (curr_data->search_window);
     if (curr_data->box)
         gtk_widget_destroy (curr_data->box);
     if (curr_data->menu)
@@ -721,6 +599,9 @@ get_chartable (charpick_data *curr_data)
 }
 
 static const GtkActionEntry charpick_applet_menu_actions [] = {
+    { "Search", "edit-find", N_("_Find Character..."),
+      NULL, NULL,
+      G_CALLBACK (show_search_dialog) },
     { "Preferences", "document-properties", N_("_Preferences"),
       NULL, NULL,
       G_CALLBACK (show_preferences_dialog) },
@@ -779,7 +660,6 @@ charpicker_applet_fill (MatePanelApplet *applet)
     curr_data->add_edit_dialog = NULL;
     curr_data->settings = mate_panel_applet_settings_new (applet,
                                                           "org.mate.panel.applet.charpick");
-    curr_data->rebuild_id = 0;
 
     get_chartable (curr_data);
 
@@ -853,6 +733,10 @@ charpicker_applet_fill (MatePanelApplet *applet)
         action = gtk_action_group_get_action (action_group, "Preferences");
         gtk_action_set_visible (action, FALSE);
     }
+#ifndef HAVE_GUCHARMAP
+    /* the names come from gucharmap at build time */
+    gtk_action_set_visible (gtk_action_group_get_action (action_group, "Search"), FALSE);
+#endif
     g_object_unref (action_group);
 
     register_stock_for_edit ();
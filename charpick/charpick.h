@@ -23,17 +23,17 @@ struct _charpick_data {
     GtkWidget       *frame;
     GtkWidget       *applet;
     GtkWidget       *invisible;
-    GtkToggleButton *last_toggle_button;
+    GtkWidget       *grid;
     gint             panel_size;
     gboolean         panel_vertical;
     GtkWidget       *propwindow;
+    GtkWidget       *search_window;
     GtkWidget       *about_dialog;
     GtkWidget       *pref_tree;
     GtkWidget       *menu;
     GtkWidget       *add_edit_dialog;
     GtkWidget       *add_edit_entry;
     GSettings       *settings;
-    guint           rebuild_id;
 };
 
 typedef struct _charpick_button_cb_data charpick_button_cb_data;
@@ -51,8 +51,12 @@ void build_table (charpick_data *curr_data);
 void add_to_popup_menu (charpick_data *curr_data);
 void populate_menu (charpick_data *curr_data);
 void save_chartable (charpick_data *curr_data);
+void select_unichar (charpick_data *curr_data,
+                     gunichar       unichar);
 void show_preferences_dialog (GtkAction     *action,
                               charpick_data *curr_data);
+void show_search_dialog (GtkAction     *action,
+                         charpick_data *curr_data);
 
 void add_edit_dialog_create (charpick_data *curr_data,
                              gchar         *string,
@@ -0,0 +1,154 @@
+/* search.c -- finding characters by their Unicode names for the character
+ * picker applet.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "charpick.h"
+#include "charpick-names.h"
+
+#include <gtk/gtk.h>
+
+/* more would only be scrolled past */
+#define MAX_MATCHES 200
+
+enum {
+    COL_CHAR = 0,
+    COL_NAME,
+    COL_CODEPOINT,
+    TOTAL_COLS
+};
+
+static void
+search_changed_cb (GtkSearchEntry *entry,
+                   GtkListStore   *store)
+{
+    CharpickNameMatch matches[MAX_MATCHES];
+    CharpickNames *names;
+    guint n, i;
+
+    gtk_list_store_clear (store);
+
+    names = charpick_names_get ();
+    if (!names)
+        return;
+
+    n = charpick_names_search (names, gtk_entry_get_text (GTK_ENTRY (entry)),
+                               matches, MAX_MATCHES);
+    for (i = 0; i < n; i++) {
+        gchar text[7];
+
+        text[g_unichar_to_utf8 (matches[i].codepoint, text)] = '\0';
+        gtk_list_store_insert_with_values (store, NULL, -1,
+                                           COL_CHAR, text,
+                                           COL_NAME, matches[i].name,
+                                           COL_CODEPOINT, matches[i].codepoint,
+                                           -1);
+    }
+}
+
+static void
+row_activated_cb (GtkTreeView       *tree,
+                  GtkTreePath       *path,
+                  GtkTreeViewColumn *column,
+                  charpick_data     *curr_data)
+{
+    GtkTreeModel *model;
+    GtkTreeIter iter;
+    guint codepoint;
+
+    model = gtk_tree_view_get_model (tree);
+    if (!gtk_tree_model_get_iter (model, &iter, path))
+        return;
+
+    gtk_tree_model_get (model, &iter, COL_CODEPOINT, &codepoint, -1);
+    select_unichar (curr_data, codepoint);
+
+    /* ready to be pasted */
+    gtk_widget_destroy (curr_data->search_window);
+    curr_data->search_window = NULL;
+}
+
+static void
+search_response_cb (GtkDialog     *dialog,
+                    gint           id,
+                    charpick_data *curr_data)
+{
+    gtk_widget_destroy (curr_data->search_window);
+    curr_data->search_window = NULL;
+}
+
+void
+show_search_dialog (GtkAction     *action,
+                    charpick_data *curr_data)
+{
+    GtkWidget *box, *entry, *scrolled, *tree;
+    GtkListStore *store;
+    GtkCellRenderer *cell;
+
+    if (curr_data->search_window) {
+        gtk_window_set_screen (GTK_WINDOW (curr_data->search_window),
+                               gtk_widget_get_screen (curr_data->applet));
+        gtk_window_present (GTK_WINDOW (curr_data->search_window));
+        return;
+    }
+
+    curr_data->search_window = gtk_dialog_new_with_buttons (_("Find Character"),
+                                                            NULL,
+                                                            GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                            "gtk-close", GTK_RESPONSE_CLOSE,
+                                                            NULL);
+    gtk_window_set_screen (GTK_WINDOW (curr_data->search_window),
+                           gtk_widget_get_screen (curr_data->applet));
+    gtk_window_set_default_size (GTK_WINDOW (curr_data->search_window), 350, 400);
+    gtk_container_set_border_width (GTK_CONTAINER (curr_data->search_window), 5);
+
+    box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+    gtk_container_set_border_width (GTK_CONTAINER (box), 5);
+    gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (curr_data->search_window))),
+                        box, TRUE, TRUE, 0);
+
+    entry = gtk_search_entry_new ();
+    gtk_entry_set_placeholder_text (GTK_ENTRY (entry), _("Name of the character"));
+    gtk_box_pack_start (GTK_BOX (box), entry, FALSE, FALSE, 0);
+
+    store = gtk_list_store_new (TOTAL_COLS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_UINT);
+    tree = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+    g_object_unref (store);
+    gtk_tree_view_set_headers_visible (GTK_TREE_VIEW (tree), FALSE);
+    gtk_tree_view_set_activate_on_single_click (GTK_TREE_VIEW (tree), TRUE);
+    gtk_tree_view_set_enable_search (GTK_TREE_VIEW (tree), FALSE);
+
+    cell = gtk_cell_renderer_text_new ();
+    g_object_set (cell, "scale", 1.5, NULL);
+    gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (tree), -1, NULL, cell,
+                                                 "text", COL_CHAR, NULL);
+    cell = gtk_cell_renderer_text_new ();
+    g_object_set (cell, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+    gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (tree), -1, NULL, cell,
+                                                 "text", COL_NAME, NULL);
+
+    scrolled = gtk_scrolled_window_new (NULL, NULL);
+    gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled),
+                                    GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_scrolled_window_set_shadow_type (GTK_SCROLLED_WINDOW (scrolled), GTK_SHADOW_IN);
+    gtk_container_add (GTK_CONTAINER (scrolled), tree);
+    gtk_box_pack_start (GTK_BOX (box), scrolled, TRUE, TRUE, 0);
+
+    g_signal_connect (entry, "search-changed",
+                      G_CALLBACK (search_changed_cb), store);
+    g_signal_connect (tree, "row-activated",
+                      G_CALLBACK (row_activated_cb), curr_data);
+    g_signal_connect (curr_data->search_window, "response",
+                      G_CALLBACK (search_response_cb), curr_data);
+
+    if (!charpick_names_get ()) {
+        gtk_widget_set_sensitive (box, FALSE);
+        gtk_entry_set_placeholder_text (GTK_ENTRY (entry),
+                                        _("The character names are not installed"));
+    }
+
+    gtk_widget_show_all (curr_data->search_window);
+}
@@ -33,6 +33,7 @@
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
 #include "ma-command.h"
+#include "ma-scheduler.h"
 
 /* Applet constants */
 #define APPLET_ICON    "utilities-terminal"
@@ -44,6 +45,10 @@
 #define INTERVAL_KEY   "interval"
 #define SHOW_ICON_KEY  "show-icon"
 #define WIDTH_KEY      "width"
+#define STREAMING_KEY  "streaming"
+#define MAX_OUTPUT_KEY "max-output"
+#define SHARED_KEY     "shared"
+#define TIMEOUT_KEY    "timeout"
 
 /* GKeyFile constants */
 #define GK_COMMAND_GROUP   "Command"
@@ -65,10 +70,21 @@ typedef struct
     MaCommand         *command;
     GCancellable      *cancellable;
     gboolean           running;
+    gboolean           rerun;
+
+    /* when the current run started, and how long the runs take, in µs */
+    gint64             start_time;
+    gint64             runtime;
 
     gchar             *cmdline;
     gint               interval;
     gint               width;
+    gboolean           streaming;
+    gboolean           shared;
+    MaSchedulerClient *client;
+
+    /* what the label shows now, the same output is not parsed again */
+    gchar             *last_output;
 
     guint              timeout_id;
 } CommandApplet;
@@ -81,6 +97,7 @@ static void interval_value_changed (GtkSpinButton *spin_button, gpointer user_da
 static void width_value_changed (GtkSpinButton *spin_button, gpointer user_data);
 static void command_async_ready_callback (GObject *source_object, GAsyncResult *res, gpointer user_data);
 static gboolean timeout_callback (CommandApplet *command_applet);
+static void process_command_output (CommandApplet *command_applet, gchar *output);
 
 static const GtkActionEntry applet_menu_actions [] = {
     { "Preferences", "document-properties", N_("_Preferences"), NULL, NULL, G_CALLBACK (command_settings_callback) },
@@ -90,13 +107,19 @@ static const GtkActionEntry applet_menu_actions [] = {
 static char *ui = "<menuitem name='Item 1' action='Preferences' />"
                   "<menuitem name='Item 2' action='About' />";
 
+static void
+show_error_output (CommandApplet *command_applet)
+{
+    gtk_label_set_text (command_applet->label, ERROR_OUTPUT);
+    g_clear_pointer (&command_applet->last_output, g_free);
+}
+
 /* GSettings signal callbacks */
 static void
 settings_command_changed (GSettings *settings, gchar *key, CommandApplet *command_applet)
 {
     GError *error = NULL;
     gchar *cmdline;
-    gchar **argv;
 
     cmdline = g_settings_get_string (command_applet->settings, COMMAND_KEY);
     if (strlen (cmdline) == 0 || g_strcmp0(command_applet->cmdline, cmdline) == 0)
@@ -105,18 +128,30 @@ settings_command_changed (GSettings *settings, gchar *key, CommandApplet *comman
         return;
     }
 
-    if (!g_shell_parse_argv (cmdline, NULL, &argv, &error))
+    /* parsed once here, every run spawns the argument vector kept */
+    if (!ma_command_set_command (command_applet->command, cmdline, &error))
     {
-        gtk_label_set_text (command_applet->label, ERROR_OUTPUT);
+        show_error_output (command_applet);
         g_clear_error (&error);
         g_free (cmdline);
         return;
     }
-    g_strfreev(argv);
 
     if (command_applet->cmdline)
         g_free (command_applet->cmdline);
     command_applet->cmdline = cmdline;
+    g_clear_pointer (&command_applet->last_output, g_free);
+
+    /* the output of a run of the old command is of no use */
+    if (command_applet->running)
+    {
+        g_cancellable_cancel (command_applet->cancellable);
+        g_object_unref (command_applet->cancellable);
+        command_applet->cancellable = g_cancellable_new ();
+        command_applet->running = FALSE;
+        command_applet->rerun = FALSE;
+    }
+    command_applet->runtime = 0;
 
     command_execute (command_applet);
 }
@@ -130,6 +165,12 @@ command_applet_destroy (MatePanelApplet *applet_widget, CommandApplet *command_a
                       G_CALLBACK (settings_command_changed),
                       command_applet);
 
+    g_signal_handlers_disconnect_by_data (command_applet->command,
+                                          command_applet);
+    ma_command_stop_streaming (command_applet->command);
+
+    ma_scheduler_remove (command_applet->client);
+    command_applet->client = NULL;
 
     if (command_applet->timeout_id != 0)
     {
@@ -137,12 +178,17 @@ command_applet_destroy (MatePanelApplet *applet_widget, CommandApplet *command_a
         command_applet->timeout_id = 0;
     }
 
+    g_cancellable_cancel (command_applet->cancellable);
+    g_object_unref (command_applet->cancellable);
+
     if (command_applet->cmdline != NULL)
     {
         g_free (command_applet->cmdline);
         command_applet->cmdline = NULL;
     }
 
+    g_clear_pointer (&command_applet->last_output, g_free);
+
     if (command_applet->command != NULL)
     {
         g_object_unref (command_applet->command);
@@ -182,7 +228,7 @@ command_text_changed (GtkWidget *widget, GdkEvent  *event, gpointer user_data)
     }
 
     if (strlen (text) == 0) {
-        gtk_label_set_text (command_applet->label, ERROR_OUTPUT);
+        show_error_output (command_applet);
         return TRUE;
     }
 
@@ -233,6 +279,8 @@ command_settings_callback (GtkAction *action, CommandApplet *command_applet)
     g_settings_bind (command_applet->settings, INTERVAL_KEY, GET_WIDGET ("interval_spinbutton"), "value", G_SETTINGS_BIND_GET_NO_CHANGES);
     g_settings_bind (command_applet->settings, WIDTH_KEY, GET_WIDGET ("width_spinbutton"), "value", G_SETTINGS_BIND_GET_NO_CHANGES);
     g_settings_bind (command_applet->settings, SHOW_ICON_KEY, GET_WIDGET ("show_icon_check"), "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (command_applet->settings, STREAMING_KEY, GET_WIDGET ("streaming_check"), "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (command_applet->settings, SHARED_KEY, GET_WIDGET ("shared_check"), "active", G_SETTINGS_BIND_DEFAULT);
 
     /* signals */
     gtk_builder_add_callback_symbols (builder,
@@ -260,6 +308,8 @@ settings_width_changed (GSettings *settings, gchar *key, CommandApplet *command_
 
     if (command_applet->width != width) {
         command_applet->width = width;
+        /* the next output is cut to the new width */
+        g_clear_pointer (&command_applet->last_output, g_free);
     }
 }
 
@@ -279,12 +329,119 @@ settings_interval_changed (GSettings *settings, gchar *key, CommandApplet *comma
     }
     command_applet->interval = interval;
 
+    /* a streaming command only uses the interval to be restarted, and a
+     * running one is given the new interval when it is done */
+    if (!command_applet->streaming && !command_applet->running)
+        command_execute (command_applet);
+}
+
+static void
+settings_timeout_changed (GSettings *settings, gchar *key, CommandApplet *command_applet)
+{
+    ma_command_set_timeout (command_applet->command,
+                            g_settings_get_int (command_applet->settings, TIMEOUT_KEY));
+
+    /* the shared command takes the timeout of its clients */
+    if (command_applet->client != NULL)
+        command_execute (command_applet);
+}
+
+static void
+settings_max_output_changed (GSettings *settings, gchar *key, CommandApplet *command_applet)
+{
+    ma_command_set_max_output (command_applet->command,
+                               g_settings_get_int (command_applet->settings, MAX_OUTPUT_KEY));
+
+    if (command_applet->client != NULL)
+        command_execute (command_applet);
+}
+
+static void
+settings_shared_changed (GSettings *settings, gchar *key, CommandApplet *command_applet)
+{
+    gboolean shared;
+
+    shared = g_settings_get_boolean (command_applet->settings, SHARED_KEY);
+
+    if (command_applet->shared == shared) {
+        return;
+    }
+    command_applet->shared = shared;
+
     command_execute (command_applet);
 }
 
+static void
+command_shared_output_callback (const gchar *output, const GError *error, gpointer user_data)
+{
+    CommandApplet *command_applet;
+    gchar *copy;
+
+    command_applet = (CommandApplet*) user_data;
+
+    if (error != NULL) {
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_FAILED)) {
+            show_error_output (command_applet);
+        }
+        return;
+    }
+
+    copy = g_strdup (output);
+    process_command_output (command_applet, copy);
+    g_free (copy);
+}
+
+static void
+settings_streaming_changed (GSettings *settings, gchar *key, CommandApplet *command_applet)
+{
+    gboolean streaming;
+
+    streaming = g_settings_get_boolean (command_applet->settings, STREAMING_KEY);
+
+    if (command_applet->streaming == streaming) {
+        return;
+    }
+    command_applet->streaming = streaming;
+
+    if (!streaming)
+        ma_command_stop_streaming (command_applet->command);
+
+    command_execute (command_applet);
+}
+
+static void
+command_line_callback (MaCommand *command, const gchar *line, CommandApplet *command_applet)
+{
+    gchar *output;
+
+    output = g_strdup (line);
+    process_command_output (command_applet, output);
+    g_free (output);
+}
+
+/* the streaming command exited, it is started again after the interval */
+static void
+command_stream_ended_callback (MaCommand *command, CommandApplet *command_applet)
+{
+    if (command_applet->timeout_id != 0)
+        g_source_remove (command_applet->timeout_id);
+
+    command_applet->timeout_id = g_timeout_add_seconds (command_applet->interval,
+                                                        (GSourceFunc) timeout_callback,
+                                                        command_applet);
+}
+
 static void
 process_command_output (CommandApplet *command_applet, gchar *output)
 {
+    /* most commands print the same most of the time, and then there is
+     * nothing to parse, lay out or look up */
+    if (output != NULL && g_strcmp0 (output, command_applet->last_output) == 0)
+        return;
+
+    g_free (command_applet->last_output);
+    command_applet->last_output = g_strdup (output);
+
     gtk_widget_set_tooltip_text (GTK_WIDGET (command_applet->label), command_applet->cmdline);
 
     if ((output == NULL) || (output[0] == '\0'))
@@ -334,25 +491,66 @@ process_command_output (CommandApplet *command_applet, gchar *output)
     }
 }
 
+/* The next run is due an interval after the start of the last one.  A
+ * command that takes close to the interval would then run back to back,
+ * so it waits twice its run time instead. */
+static void
+command_schedule (CommandApplet *command_applet)
+{
+    gint64 delay;
+
+    delay = MAX ((gint64) command_applet->interval * G_USEC_PER_SEC,
+                 command_applet->runtime * 2);
+    delay -= g_get_monotonic_time () - command_applet->start_time;
+
+    command_applet->timeout_id = g_timeout_add_seconds (MAX (1, (delay + G_USEC_PER_SEC / 2) / G_USEC_PER_SEC),
+                                                        (GSourceFunc) timeout_callback,
+                                                        command_applet);
+}
+
 static void command_async_ready_callback (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
     gchar *output;
     GError *error = NULL;
     CommandApplet *command_applet;
+    gint64 runtime;
 
     command_applet = (CommandApplet*) user_data;
 
     output = ma_command_run_finish (command_applet->command, res, &error);
-    if (error == NULL) {
-        process_command_output (command_applet, output);
-    } else {
-        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_FAILED)) {
-            gtk_label_set_text (command_applet->label, ERROR_OUTPUT);
-        }
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
         g_error_free (error);
+        return;
     }
-    g_free (output);
+
     command_applet->running = FALSE;
+
+    /* smoothed, so that one slow run does not hold back the updates */
+    runtime = g_get_monotonic_time () - command_applet->start_time;
+    if (command_applet->runtime == 0)
+        command_applet->runtime = runtime;
+    else
+        command_applet->runtime = (command_applet->runtime * 3 + runtime) / 4;
+
+    if (command_applet->streaming) {
+        /* the stream shows its own output */
+    } else if (error == NULL) {
+        process_command_output (command_applet, output);
+    } else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_FAILED)) {
+        show_error_output (command_applet);
+    }
+    g_clear_error (&error);
+    g_free (output);
+
+    if (command_applet->streaming || command_applet->shared)
+        return;
+
+    if (command_applet->rerun) {
+        command_applet->rerun = FALSE;
+        command_execute (command_applet);
+    } else {
+        command_schedule (command_applet);
+    }
 }
 
 static gboolean timeout_callback (CommandApplet *command_applet)
@@ -362,21 +560,9 @@ static gboolean timeout_callback (CommandApplet *command_applet)
         return G_SOURCE_CONTINUE;
     }
 
-    /* command running, wait for next timer execution */
-    if (command_applet->running) {
-        return G_SOURCE_CONTINUE;
-    } else {
-        gchar **argv;
-        GError *error = NULL;
-        if (!g_shell_parse_argv (command_applet->cmdline, NULL, &argv, &error)) {
-            gtk_label_set_text (command_applet->label, ERROR_OUTPUT);
-            g_clear_error (&error);
-            return G_SOURCE_CONTINUE;
-        }
-        g_strfreev(argv);
-        command_execute (command_applet);
-        return G_SOURCE_REMOVE;
-    }
+    command_applet->timeout_id = 0;
+    command_execute (command_applet);
+    return G_SOURCE_REMOVE;
 }
 
 static gboolean
@@ -389,26 +575,61 @@ command_execute (CommandApplet *command_applet)
         command_applet->timeout_id = 0;
     }
 
+    ma_scheduler_remove (command_applet->client);
+    command_applet->client = NULL;
+
+    /* one long lived child updates the label with every record it
+     * writes, instead of a new one every interval */
+    if (command_applet->streaming)
+    {
+        GError *error = NULL;
+
+        gtk_widget_set_tooltip_text (GTK_WIDGET (command_applet->label), command_applet->cmdline);
+
+        if (!ma_command_start_streaming (command_applet->command, &error))
+        {
+            show_error_output (command_applet);
+            g_error_free (error);
+            command_stream_ended_callback (command_applet->command, command_applet);
+        }
+        return G_SOURCE_REMOVE;
+    }
+
+    /* the shared scheduler runs the command for all applets showing it */
+    if (command_applet->shared)
+    {
+        GError *error = NULL;
+
+        command_applet->client = ma_scheduler_add (command_applet->cmdline,
+                                                   command_applet->interval,
+                                                   g_settings_get_int (command_applet->settings, MAX_OUTPUT_KEY),
+                                                   g_settings_get_int (command_applet->settings, TIMEOUT_KEY),
+                                                   command_shared_output_callback,
+                                                   command_applet,
+                                                   &error);
+        if (command_applet->client == NULL)
+        {
+            show_error_output (command_applet);
+            g_error_free (error);
+        }
+        return G_SOURCE_REMOVE;
+    }
+
+    /* the run is not cancelled and its work wasted, the next one
+     * starts when it is done */
     if (command_applet->running) {
-        g_cancellable_cancel (command_applet->cancellable);
+        command_applet->rerun = TRUE;
+        return G_SOURCE_CONTINUE;
     }
 
-    g_object_set (G_OBJECT(command_applet->command), "command", command_applet->cmdline, NULL);
+    command_applet->start_time = g_get_monotonic_time ();
+    command_applet->running = TRUE;
     ma_command_run_async (command_applet->command,
                           command_applet->cancellable,
                           command_async_ready_callback,
                           command_applet);
-    if (!command_applet->running) {
-        command_applet->running = TRUE;
-    }
-
-    if (g_cancellable_is_cancelled (command_applet->cancellable)) {
-        g_cancellable_reset (command_applet->cancellable);
-    }
 
-    command_applet->timeout_id = g_timeout_add_seconds (command_applet->interval,
-                                                        (GSourceFunc) timeout_callback,
-                                                        command_applet);
+    /* the next run is scheduled when this one is done */
     return G_SOURCE_CONTINUE;
 }
 
@@ -433,8 +654,21 @@ command_applet_fill (MatePanelApplet* applet)
     command_applet->interval = g_settings_get_int (command_applet->settings, INTERVAL_KEY);
     command_applet->cmdline = g_settings_get_string (command_applet->settings, COMMAND_KEY);
     command_applet->width = g_settings_get_int (command_applet->settings, WIDTH_KEY);
+    command_applet->streaming = g_settings_get_boolean (command_applet->settings, STREAMING_KEY);
+    command_applet->shared = g_settings_get_boolean (command_applet->settings, SHARED_KEY);
     command_applet->command = ma_command_new(command_applet->cmdline, NULL);
     command_applet->cancellable = g_cancellable_new ();
+    ma_command_set_max_output (command_applet->command,
+                               g_settings_get_int (command_applet->settings, MAX_OUTPUT_KEY));
+    ma_command_set_timeout (command_applet->command,
+                            g_settings_get_int (command_applet->settings, TIMEOUT_KEY));
+
+    g_signal_connect (command_applet->command, "line",
+                      G_CALLBACK (command_line_callback),
+                      command_applet);
+    g_signal_connect (command_applet->command, "stream-ended",
+                      G_CALLBACK (command_stream_ended_callback),
+                      command_applet);
 
     command_applet->box = GTK_BOX (gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0));
     command_applet->image = GTK_IMAGE (gtk_image_new_from_icon_name (APPLET_ICON, GTK_ICON_SIZE_LARGE_TOOLBAR));
@@ -471,6 +705,22 @@ command_applet_fill (MatePanelApplet* applet)
                       G_CALLBACK (settings_width_changed),
                       command_applet);
 
+    g_signal_connect (command_applet->settings, "changed::" MAX_OUTPUT_KEY,
+                      G_CALLBACK (settings_max_output_changed),
+                      command_applet);
+
+    g_signal_connect (command_applet->settings, "changed::" TIMEOUT_KEY,
+                      G_CALLBACK (settings_timeout_changed),
+                      command_applet);
+
+    g_signal_connect (command_applet->settings, "changed::" SHARED_KEY,
+                      G_CALLBACK (settings_shared_changed),
+                      command_applet);
+
+    g_signal_connect (command_applet->settings, "changed::" STREAMING_KEY,
+                      G_CALLBACK (settings_streaming_changed),
+                      command_applet);
+
     g_settings_bind (command_applet->settings,
                      SHOW_ICON_KEY,
                      command_applet->image,
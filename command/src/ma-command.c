@@ -16,16 +16,40 @@
  */
 
 #include <config.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
 #include "ma-command.h"
 
-#define BUFFER_SIZE 64
+#define BUFFER_SIZE 4096
+
+/* a streaming command is read in chunks of this size, at most
+ * STREAM_READS_PER_WAKEUP of them before the main loop gets a turn */
+#define STREAM_BUFFER_SIZE 4096
+#define STREAM_READS_PER_WAKEUP 16
+
+/* a record that grows past this without a newline is dropped */
+#define STREAM_MAX_RECORD (64 * 1024)
 
 struct _MaCommand
 {
   GObject   parent;
 
-  gchar    *command;
-  gchar   **argv;
+  gchar      *command;
+  gchar     **argv;
+
+  /* the program looked up in PATH once, followed by argv */
+  gchar      *program;
+  gchar     **spawn_argv;
+
+  gsize       max_output;
+  guint       timeout;
+
+  GPid        stream_pid;
+  GIOChannel *stream_channel;
+  GString    *stream_buffer;
+  guint       stream_io_watch_id;
+  guint       stream_child_watch_id;
 };
 
 typedef struct
@@ -35,9 +59,14 @@ typedef struct
   GIOChannel *channel;
 
   GString    *input;
+  gsize       max_output;
+
+  gboolean    exited;
+  gboolean    timed_out;
 
   guint       io_watch_id;
   guint       child_watch_id;
+  guint       timeout_id;
 } CommandData;
 
 enum
@@ -51,6 +80,16 @@ enum
 
 static GParamSpec *command_properties[LAST_PROP] = { NULL };
 
+enum
+{
+  LINE,
+  STREAM_ENDED,
+
+  LAST_SIGNAL
+};
+
+static guint command_signals[LAST_SIGNAL] = { 0 };
+
 static void initable_iface_init (GInitableIface *iface);
 
 G_DEFINE_TYPE_WITH_CODE (MaCommand, ma_command, G_TYPE_OBJECT,
@@ -65,6 +104,7 @@ read_cb (GIOChannel   *source,
   GTask *task;
   CommandData *data;
   gchar buffer[BUFFER_SIZE];
+  gsize buffer_size;
   gsize bytes_read;
   GError *error;
   GIOStatus status;
@@ -81,8 +121,12 @@ read_cb (GIOChannel   *source,
       return G_SOURCE_REMOVE;
     }
 
+  buffer_size = BUFFER_SIZE;
+  if (data->max_output > 0)
+    buffer_size = MIN (buffer_size, data->max_output - data->input->len);
+
   error = NULL;
-  status = g_io_channel_read_chars (source, buffer, BUFFER_SIZE,
+  status = g_io_channel_read_chars (source, buffer, buffer_size,
                                     &bytes_read, &error);
 
   if (status == G_IO_STATUS_AGAIN)
@@ -106,6 +150,16 @@ read_cb (GIOChannel   *source,
 
   g_string_append_len (data->input, buffer, bytes_read);
 
+  /* the rest would never be shown, so the child is not left to write
+   * it; child_watch_cb returns what was read so far */
+  if (data->max_output > 0 && data->input->len >= data->max_output)
+    {
+      kill (data->pid, SIGKILL);
+      data->io_watch_id = 0;
+
+      return G_SOURCE_REMOVE;
+    }
+
   return G_SOURCE_CONTINUE;
 }
 
@@ -119,11 +173,42 @@ child_watch_cb (GPid     pid,
 
   task = (GTask *) user_data;
   data = g_task_get_task_data (task);
+  data->exited = TRUE;
+
+  if (data->timed_out)
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                             "Command timed out");
+  else
+    g_task_return_pointer (task, g_strdup (data->input->str), g_free);
 
-  g_task_return_pointer (task, g_strdup (data->input->str), g_free);
   g_object_unref (task);
 }
 
+/* A hung command is killed, child_watch_cb then reports it. */
+static gboolean
+timeout_cb (gpointer user_data)
+{
+  GTask *task;
+  CommandData *data;
+
+  task = (GTask *) user_data;
+  data = g_task_get_task_data (task);
+
+  data->timed_out = TRUE;
+  data->timeout_id = 0;
+  kill (data->pid, SIGKILL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+reap_cb (GPid     pid,
+         gint     status,
+         gpointer user_data)
+{
+  g_spawn_close_pid (pid);
+}
+
 static void
 cancelled_cb (GCancellable *cancellable,
               gpointer      user_data)
@@ -142,10 +227,25 @@ command_data_free (gpointer user_data)
 
   data = (CommandData *) user_data;
 
-  if (data->pid != 0)
+  /* a cancelled run does not leave its child running, or unreaped */
+  if (data->pid != 0 && !data->exited && data->child_watch_id != 0)
+    {
+      kill (data->pid, SIGKILL);
+      g_source_remove (data->child_watch_id);
+      data->child_watch_id = 0;
+
+      g_child_watch_add (data->pid, reap_cb, NULL);
+    }
+  else if (data->pid != 0)
     {
       g_spawn_close_pid (data->pid);
-      data->pid = 0;
+    }
+  data->pid = 0;
+
+  if (data->timeout_id != 0)
+    {
+      g_source_remove (data->timeout_id);
+      data->timeout_id = 0;
     }
 
   if (data->channel != NULL)
@@ -175,6 +275,150 @@ command_data_free (gpointer user_data)
   g_free (data);
 }
 
+/* Reads what the streaming command has written so far.  Only the last
+ * complete record is returned in @line, as the ones before it are
+ * already out of date; at the end of the output an unterminated record
+ * counts as well. */
+static GIOStatus
+stream_read (MaCommand  *command,
+             gchar     **line)
+{
+  GString *buffer;
+  gchar chunk[STREAM_BUFFER_SIZE];
+  gsize bytes_read;
+  GIOStatus status;
+  gchar *start;
+  gchar *end;
+  gint i;
+
+  buffer = command->stream_buffer;
+  status = G_IO_STATUS_NORMAL;
+
+  for (i = 0; i < STREAM_READS_PER_WAKEUP && status == G_IO_STATUS_NORMAL; i++)
+    {
+      bytes_read = 0;
+      status = g_io_channel_read_chars (command->stream_channel, chunk,
+                                        sizeof (chunk), &bytes_read, NULL);
+      g_string_append_len (buffer, chunk, bytes_read);
+    }
+
+  *line = NULL;
+
+  if (status != G_IO_STATUS_NORMAL && status != G_IO_STATUS_AGAIN &&
+      buffer->len > 0 && buffer->str[buffer->len - 1] != '\n')
+    {
+      g_string_append_c (buffer, '\n');
+    }
+
+  end = buffer->str + buffer->len;
+  while (end > buffer->str && end[-1] != '\n')
+    end--;
+
+  if (end > buffer->str)
+    {
+      start = end - 1;
+      while (start > buffer->str && start[-1] != '\n')
+        start--;
+
+      *line = g_strndup (start, end - 1 - start);
+      g_string_erase (buffer, 0, end - buffer->str);
+    }
+  else if (buffer->len > STREAM_MAX_RECORD)
+    {
+      g_string_truncate (buffer, 0);
+    }
+
+  return status;
+}
+
+static void
+stream_close (MaCommand *command)
+{
+  if (command->stream_io_watch_id != 0)
+    {
+      g_source_remove (command->stream_io_watch_id);
+      command->stream_io_watch_id = 0;
+    }
+
+  if (command->stream_child_watch_id != 0)
+    {
+      g_source_remove (command->stream_child_watch_id);
+      command->stream_child_watch_id = 0;
+    }
+
+  g_clear_pointer (&command->stream_channel, g_io_channel_unref);
+
+  if (command->stream_buffer != NULL)
+    {
+      g_string_free (command->stream_buffer, TRUE);
+      command->stream_buffer = NULL;
+    }
+}
+
+static gboolean
+stream_read_cb (GIOChannel   *source,
+                GIOCondition  condition,
+                gpointer      user_data)
+{
+  MaCommand *command;
+  gchar *line;
+  GIOStatus status;
+  gboolean open;
+
+  command = MA_COMMAND (user_data);
+
+  status = stream_read (command, &line);
+  open = status == G_IO_STATUS_NORMAL || status == G_IO_STATUS_AGAIN;
+
+  if (!open)
+    command->stream_io_watch_id = 0;
+
+  if (line != NULL)
+    {
+      g_signal_emit (command, command_signals[LINE], 0, line);
+      g_free (line);
+    }
+
+  return open ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+static void
+stream_child_watch_cb (GPid     pid,
+                       gint     status,
+                       gpointer user_data)
+{
+  MaCommand *command;
+  gchar *line;
+
+  command = MA_COMMAND (user_data);
+  command->stream_child_watch_id = 0;
+
+  /* what the child wrote before it went is still in the pipe */
+  line = NULL;
+  if (command->stream_io_watch_id != 0)
+    stream_read (command, &line);
+
+  stream_close (command);
+  g_spawn_close_pid (command->stream_pid);
+  command->stream_pid = 0;
+
+  if (line != NULL)
+    {
+      g_signal_emit (command, command_signals[LINE], 0, line);
+      g_free (line);
+    }
+
+  g_signal_emit (command, command_signals[STREAM_ENDED], 0);
+}
+
+/* The child leads a process group of its own, so that stopping it also
+ * stops the rest of a pipeline it started. */
+static void
+stream_child_setup (gpointer user_data)
+{
+  setpgid (0, 0);
+}
+
 static gboolean
 ma_command_initable_init (GInitable     *initable,
                           GCancellable  *cancellable,
@@ -208,8 +452,12 @@ ma_command_finalize (GObject *object)
 
   command = MA_COMMAND (object);
 
+  ma_command_stop_streaming (command);
+
   g_clear_pointer (&command->command, g_free);
   g_clear_pointer (&command->argv, g_strfreev);
+  g_clear_pointer (&command->program, g_free);
+  g_clear_pointer (&command->spawn_argv, g_free);
 
   G_OBJECT_CLASS (ma_command_parent_class)->finalize (object);
 }
@@ -227,12 +475,12 @@ ma_command_set_property (GObject      *object,
   switch (property_id)
     {
       case PROP_COMMAND:
-          //g_assert (command->command == NULL);
-          command->command = g_value_dup_string (value);
-          if (command->argv && *command->argv != NULL) {
-              g_strfreev(command->argv);
+        if (!ma_command_set_command (command, g_value_get_string (value), NULL))
+          {
+            /* the command still has to be known to tell why it is not run */
+            g_free (command->command);
+            command->command = g_value_dup_string (value);
           }
-          g_shell_parse_argv (command->command, NULL, &command->argv, NULL);
         break;
 
       default:
@@ -282,6 +530,31 @@ ma_command_class_init (MaCommandClass *command_class)
   object_class->get_property = ma_command_get_property;
 
   install_properties (object_class);
+
+  /**
+   * MaCommand::line:
+   * @command: the #MaCommand
+   * @line: the newest record, without its newline
+   *
+   * Emitted while streaming, with the last newline terminated record
+   * read in one main loop iteration.
+   */
+  command_signals[LINE] =
+    g_signal_new ("line", G_TYPE_FROM_CLASS (command_class),
+                  G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  /**
+   * MaCommand::stream-ended:
+   * @command: the #MaCommand
+   *
+   * Emitted when the command started with ma_command_start_streaming()
+   * exits on its own.
+   */
+  command_signals[STREAM_ENDED] =
+    g_signal_new ("stream-ended", G_TYPE_FROM_CLASS (command_class),
+                  G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
 }
 
 static void
@@ -307,6 +580,98 @@ ma_command_new (const gchar  *command,
                          NULL);
 }
 
+/**
+ * ma_command_set_command:
+ * @command: a #MaCommand
+ * @cmdline: the new command line
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Parses @cmdline and keeps its argument vector for the next runs.  On
+ * failure the previous command line stays in use.
+ *
+ * Returns: %TRUE if @cmdline could be parsed
+ */
+gboolean
+ma_command_set_command (MaCommand    *command,
+                        const gchar  *cmdline,
+                        GError      **error)
+{
+  gchar **argv;
+
+  g_return_val_if_fail (MA_IS_COMMAND (command), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (command->argv != NULL && g_strcmp0 (command->command, cmdline) == 0)
+    return TRUE;
+
+  if (cmdline == NULL || !g_shell_parse_argv (cmdline, NULL, &argv, error))
+    return FALSE;
+
+  g_free (command->command);
+  command->command = g_strdup (cmdline);
+
+  g_strfreev (command->argv);
+  command->argv = argv;
+
+  /* with the program found here and the flags of ma_command_run_async()
+   * GLib spawns with posix_spawn, which does not have to copy the page
+   * tables of the panel the way fork does */
+  g_free (command->program);
+  g_free (command->spawn_argv);
+  command->program = g_find_program_in_path (argv[0]);
+  command->spawn_argv = NULL;
+
+  if (command->program != NULL)
+    {
+      guint n_args;
+
+      n_args = g_strv_length (argv);
+      command->spawn_argv = g_new (gchar *, n_args + 2);
+      command->spawn_argv[0] = command->program;
+      memcpy (command->spawn_argv + 1, argv, (n_args + 1) * sizeof (gchar *));
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (command),
+                            command_properties[PROP_COMMAND]);
+
+  return TRUE;
+}
+
+/**
+ * ma_command_set_max_output:
+ * @command: a #MaCommand
+ * @max_output: the most bytes to read, or 0 for no limit
+ *
+ * Limits the output of the next runs.  A command that writes more is
+ * killed once @max_output bytes have been read, and those are returned.
+ */
+void
+ma_command_set_max_output (MaCommand *command,
+                           gsize      max_output)
+{
+  g_return_if_fail (MA_IS_COMMAND (command));
+
+  command->max_output = max_output;
+}
+
+/**
+ * ma_command_set_timeout:
+ * @command: a #MaCommand
+ * @timeout: the most seconds a run may take, or 0 for no limit
+ *
+ * Limits how long the next runs may take.  A command still running
+ * after @timeout seconds is killed, and the run fails with
+ * %G_IO_ERROR_TIMED_OUT.
+ */
+void
+ma_command_set_timeout (MaCommand *command,
+                        guint      timeout)
+{
+  g_return_if_fail (MA_IS_COMMAND (command));
+
+  command->timeout = timeout;
+}
+
 /**
  * ma_command_run_async:
  * @command: a #MaCommand
@@ -326,6 +691,7 @@ ma_command_run_async (MaCommand           *command,
   GTask *task;
   CommandData *data;
   GSpawnFlags spawn_flags;
+  gchar **argv;
   gint command_stdout;
   GError *error;
   GIOChannel *channel;
@@ -348,10 +714,37 @@ ma_command_run_async (MaCommand           *command,
   data = g_new0 (CommandData, 1);
   g_task_set_task_data (task, data, command_data_free);
 
-  spawn_flags = G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD;
+  if (command->argv == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                               "Invalid command");
+      g_object_unref (task);
+
+      return;
+    }
+
+  /* GLib only takes its posix_spawn path without a child setup function,
+   * a working directory or the closing of inherited descriptors; the
+   * pipes are still kept from the child */
+  spawn_flags = G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_LEAVE_DESCRIPTORS_OPEN |
+                G_SPAWN_CLOEXEC_PIPES;
+
+  if (command->spawn_argv != NULL)
+    {
+      spawn_flags |= G_SPAWN_FILE_AND_ARGV_ZERO;
+      argv = command->spawn_argv;
+    }
+  else
+    {
+      /* not found, spawning reports why */
+      spawn_flags |= G_SPAWN_SEARCH_PATH;
+      argv = command->argv;
+    }
+
+  data->max_output = command->max_output;
   error = NULL;
 
-  if (!g_spawn_async_with_pipes (NULL, command->argv, NULL, spawn_flags,
+  if (!g_spawn_async_with_pipes (NULL, argv, NULL, spawn_flags,
                                  NULL, NULL, &data->pid, NULL, &command_stdout,
                                  NULL, &error))
     {
@@ -392,6 +785,9 @@ ma_command_run_async (MaCommand           *command,
   data->io_watch_id = g_io_add_watch (channel, condition, read_cb, task);
 
   data->child_watch_id = g_child_watch_add (data->pid, child_watch_cb, task);
+
+  if (command->timeout > 0)
+    data->timeout_id = g_timeout_add_seconds (command->timeout, timeout_cb, task);
 }
 
 /**
@@ -415,3 +811,95 @@ ma_command_run_finish (MaCommand     *command,
 
   return g_task_propagate_pointer (G_TASK (result), error);
 }
+
+/**
+ * ma_command_start_streaming:
+ * @command: a #MaCommand
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Starts the command and keeps it running, emitting #MaCommand::line
+ * for the records it writes and #MaCommand::stream-ended when it exits.
+ * A command that is already streaming is stopped first.
+ *
+ * Returns: %TRUE if the command was started
+ */
+gboolean
+ma_command_start_streaming (MaCommand  *command,
+                            GError    **error)
+{
+  GSpawnFlags spawn_flags;
+  gint command_stdout;
+  GIOChannel *channel;
+
+  g_return_val_if_fail (MA_IS_COMMAND (command), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  ma_command_stop_streaming (command);
+
+  if (command->argv == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Invalid command");
+
+      return FALSE;
+    }
+
+  spawn_flags = G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD;
+
+  if (!g_spawn_async_with_pipes (NULL, command->argv, NULL, spawn_flags,
+                                 stream_child_setup, NULL,
+                                 &command->stream_pid, NULL, &command_stdout,
+                                 NULL, error))
+    {
+      command->stream_pid = 0;
+
+      return FALSE;
+    }
+
+  channel = command->stream_channel = g_io_channel_unix_new (command_stdout);
+  g_io_channel_set_close_on_unref (channel, TRUE);
+  g_io_channel_set_encoding (channel, NULL, NULL);
+
+  if (g_io_channel_set_flags (channel, G_IO_FLAG_NONBLOCK,
+                              error) != G_IO_STATUS_NORMAL)
+    {
+      ma_command_stop_streaming (command);
+
+      return FALSE;
+    }
+
+  command->stream_buffer = g_string_new (NULL);
+
+  command->stream_io_watch_id =
+    g_io_add_watch (channel, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP,
+                    stream_read_cb, command);
+
+  command->stream_child_watch_id =
+    g_child_watch_add (command->stream_pid, stream_child_watch_cb, command);
+
+  return TRUE;
+}
+
+/**
+ * ma_command_stop_streaming:
+ * @command: a #MaCommand
+ *
+ * Stops the command started with ma_command_start_streaming(), without
+ * emitting #MaCommand::stream-ended.  Does nothing if it is not running.
+ */
+void
+ma_command_stop_streaming (MaCommand *command)
+{
+  g_return_if_fail (MA_IS_COMMAND (command));
+
+  if (command->stream_pid == 0)
+    return;
+
+  stream_close (command);
+
+  kill (-command->stream_pid, SIGTERM);
+
+  /* the child still has to be reaped once it is gone */
+  g_child_watch_add (command->stream_pid, reap_cb, NULL);
+  command->stream_pid = 0;
+}
@@ -29,6 +29,16 @@ G_DECLARE_FINAL_TYPE (MaCommand, ma_command, MA, COMMAND, GObject)
 MaCommand *ma_command_new        (const gchar          *command,
                                   GError              **error);
 
+gboolean   ma_command_set_command (MaCommand           *command,
+                                   const gchar         *cmdline,
+                                   GError             **error);
+
+void       ma_command_set_max_output (MaCommand        *command,
+                                      gsize             max_output);
+
+void       ma_command_set_timeout (MaCommand           *command,
+                                   guint                timeout);
+
 void       ma_command_run_async  (MaCommand            *command,
                                   GCancellable         *cancellable,
                                   GAsyncReadyCallback   callback,
@@ -38,6 +48,11 @@ gchar     *ma_command_run_finish (MaCommand            *command,
                                   GAsyncResult         *result,
                                   GError              **error);
 
+gboolean   ma_command_start_streaming (MaCommand       *command,
+                                       GError         **error);
+
+void       ma_command_stop_streaming  (MaCommand       *command);
+
 G_END_DECLS
 
 #endif
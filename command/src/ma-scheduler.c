@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2021 MATE developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "ma-command.h"
+#include "ma-scheduler.h"
+
+/* how many commands run at the same time, the rest wait their turn */
+#define MAX_RUNNING 4
+
+typedef struct
+{
+  gint          ref_count;
+
+  gchar        *cmdline;
+  MaCommand    *command;
+
+  /* MaSchedulerClient, the interval and the timeout are the shortest
+   * of theirs */
+  GList        *clients;
+  guint         interval;
+  gsize         max_output;
+  guint         timeout;
+
+  /* of the last run, in microseconds, the run time smoothed */
+  gint64        start_time;
+  gint64        runtime;
+
+  /* in seconds of the monotonic clock */
+  gint64        due;
+  gboolean      queued;
+  gboolean      running;
+} Job;
+
+struct _MaSchedulerClient
+{
+  Job            *job;
+
+  guint           interval;
+  gsize           max_output;
+  guint           timeout;
+
+  MaSchedulerFunc func;
+  gpointer        user_data;
+};
+
+static GHashTable *jobs = NULL;
+static GQueue queue = G_QUEUE_INIT;
+static guint n_running = 0;
+static guint idle_id = 0;
+
+/* one timeout for the earliest due job, in seconds of the monotonic clock */
+static guint wakeup_id = 0;
+static gint64 wakeup_due = 0;
+
+static void schedule_queued (void);
+static void schedule_wakeup (void);
+
+static Job *
+job_ref (Job *job)
+{
+  job->ref_count++;
+
+  return job;
+}
+
+static void
+job_unref (Job *job)
+{
+  if (--job->ref_count > 0)
+    return;
+
+  g_list_free_full (job->clients, g_free);
+  g_object_unref (job->command);
+  g_free (job->cmdline);
+  g_free (job);
+}
+
+static gint64
+now_seconds (void)
+{
+  return g_get_monotonic_time () / G_USEC_PER_SEC;
+}
+
+/* The next multiple of the interval, so that the commands with the same
+ * interval share their wakeups.  A command that takes close to the
+ * interval would then run back to back, so it waits twice its run time
+ * after its start instead, as in the applet. */
+static void
+job_set_due (Job *job)
+{
+  gint64 earliest;
+
+  earliest = MAX (now_seconds (), (job->start_time + job->runtime * 2) / G_USEC_PER_SEC);
+  job->due = (earliest / job->interval + 1) * job->interval;
+}
+
+static void
+job_ready_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  Job *job;
+  gchar *output;
+  GError *error;
+  GList *clients;
+  GList *l;
+  gint64 runtime;
+
+  job = user_data;
+  error = NULL;
+
+  output = ma_command_run_finish (job->command, res, &error);
+
+  job->running = FALSE;
+  n_running--;
+
+  /* smoothed, so that one slow run does not hold back the updates */
+  runtime = g_get_monotonic_time () - job->start_time;
+  if (job->runtime == 0)
+    job->runtime = runtime;
+  else
+    job->runtime = (job->runtime * 3 + runtime) / 4;
+
+  job_set_due (job);
+  schedule_wakeup ();
+
+  /* a callback may remove its own client */
+  clients = g_list_copy (job->clients);
+  for (l = clients; l != NULL; l = l->next)
+    {
+      MaSchedulerClient *client;
+
+      client = l->data;
+      if (g_list_find (job->clients, client) != NULL)
+        client->func (output, error, client->user_data);
+    }
+  g_list_free (clients);
+
+  g_clear_error (&error);
+  g_free (output);
+  job_unref (job);
+
+  schedule_queued ();
+}
+
+static void
+schedule_queued (void)
+{
+  Job *job;
+
+  while (n_running < MAX_RUNNING && (job = g_queue_pop_head (&queue)) != NULL)
+    {
+      job->queued = FALSE;
+
+      /* the last client went while it waited */
+      if (job->clients == NULL)
+        {
+          job_unref (job);
+          continue;
+        }
+
+      job->running = TRUE;
+      job->start_time = g_get_monotonic_time ();
+      n_running++;
+
+      /* the reference of the queue is kept until it is done */
+      ma_command_run_async (job->command, NULL, job_ready_cb, job);
+    }
+}
+
+static void
+run_due_jobs (void)
+{
+  GHashTableIter iter;
+  Job *job;
+  gint64 now;
+
+  now = now_seconds ();
+
+  g_hash_table_iter_init (&iter, jobs);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &job))
+    {
+      if (job->queued || job->running || job->due > now)
+        continue;
+
+      job->queued = TRUE;
+      g_queue_push_tail (&queue, job_ref (job));
+    }
+
+  schedule_queued ();
+  schedule_wakeup ();
+}
+
+static gboolean
+wakeup_cb (gpointer user_data)
+{
+  wakeup_id = 0;
+  run_due_jobs ();
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Arms the timeout for the earliest job that is neither queued nor
+ * running; those are given a new due time when they are done.  A timeout
+ * that comes earlier than needed only arms the next one. */
+static void
+schedule_wakeup (void)
+{
+  GHashTableIter iter;
+  Job *job;
+  gint64 due;
+
+  due = G_MAXINT64;
+
+  if (jobs != NULL)
+    {
+      g_hash_table_iter_init (&iter, jobs);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &job))
+        if (!job->queued && !job->running)
+          due = MIN (due, job->due);
+    }
+
+  if (wakeup_id != 0)
+    {
+      if (due >= wakeup_due)
+        return;
+
+      g_source_remove (wakeup_id);
+      wakeup_id = 0;
+    }
+
+  if (due == G_MAXINT64)
+    return;
+
+  wakeup_due = due;
+  wakeup_id = g_timeout_add_seconds ((guint) CLAMP (due - now_seconds (), 1, G_MAXUINT),
+                                     wakeup_cb, NULL);
+}
+
+static gboolean
+idle_cb (gpointer user_data)
+{
+  idle_id = 0;
+  run_due_jobs ();
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+job_update (Job *job)
+{
+  gboolean unlimited;
+  GList *l;
+
+  unlimited = FALSE;
+  job->interval = G_MAXUINT;
+  job->max_output = 0;
+  job->timeout = 0;
+
+  for (l = job->clients; l != NULL; l = l->next)
+    {
+      MaSchedulerClient *client;
+
+      client = l->data;
+      job->interval = MIN (job->interval, client->interval);
+
+      if (client->timeout != 0)
+        job->timeout = job->timeout == 0 ? client->timeout : MIN (job->timeout, client->timeout);
+
+      if (client->max_output == 0)
+        unlimited = TRUE;
+      else
+        job->max_output = MAX (job->max_output, client->max_output);
+    }
+
+  if (unlimited)
+    job->max_output = 0;
+
+  ma_command_set_max_output (job->command, job->max_output);
+  ma_command_set_timeout (job->command, job->timeout);
+}
+
+/**
+ * ma_scheduler_add:
+ * @cmdline: the command line to run
+ * @interval: how often to run it, in seconds
+ * @max_output: the most output wanted, or 0 for no limit
+ * @timeout: the most seconds a run may take, or 0 for no limit
+ * @func: the function called with the output of every run
+ * @user_data: the data to pass to @func
+ * @error: (nullable): return location for an error, or %NULL
+ *
+ * Runs @cmdline every @interval seconds, together with the other
+ * clients of the same command line.
+ *
+ * Returns: (nullable): the client to pass to ma_scheduler_remove(), or
+ * %NULL if @cmdline can not be run
+ */
+MaSchedulerClient *
+ma_scheduler_add (const gchar      *cmdline,
+                  guint             interval,
+                  gsize             max_output,
+                  guint             timeout,
+                  MaSchedulerFunc   func,
+                  gpointer          user_data,
+                  GError          **error)
+{
+  MaSchedulerClient *client;
+  Job *job;
+
+  g_return_val_if_fail (cmdline != NULL, NULL);
+  g_return_val_if_fail (func != NULL, NULL);
+
+  if (jobs == NULL)
+    jobs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                  (GDestroyNotify) job_unref);
+
+  job = g_hash_table_lookup (jobs, cmdline);
+
+  if (job == NULL)
+    {
+      MaCommand *command;
+
+      command = ma_command_new (cmdline, error);
+      if (command == NULL)
+        return NULL;
+
+      job = g_new0 (Job, 1);
+      job->ref_count = 1;
+      job->cmdline = g_strdup (cmdline);
+      job->command = command;
+
+      g_hash_table_insert (jobs, job->cmdline, job);
+    }
+
+  client = g_new0 (MaSchedulerClient, 1);
+  client->job = job;
+  client->interval = MAX (interval, 1);
+  client->max_output = max_output;
+  client->timeout = timeout;
+  client->func = func;
+  client->user_data = user_data;
+
+  job->clients = g_list_prepend (job->clients, client);
+  job_update (job);
+
+  /* the first output is not left waiting for a whole interval */
+  if (!job->running)
+    job->due = 0;
+
+  if (idle_id == 0)
+    idle_id = g_idle_add (idle_cb, NULL);
+
+  return client;
+}
+
+/**
+ * ma_scheduler_remove:
+ * @client: (nullable): a client returned by ma_scheduler_add()
+ *
+ * Stops running the command for @client.  A run that already started
+ * for it is completed, but its output is no longer passed on.
+ */
+void
+ma_scheduler_remove (MaSchedulerClient *client)
+{
+  Job *job;
+
+  if (client == NULL)
+    return;
+
+  job = client->job;
+  job->clients = g_list_remove (job->clients, client);
+  g_free (client);
+
+  if (job->clients != NULL)
+    {
+      job_update (job);
+
+      return;
+    }
+
+  g_hash_table_remove (jobs, job->cmdline);
+
+  if (g_hash_table_size (jobs) == 0)
+    {
+      if (wakeup_id != 0)
+        {
+          g_source_remove (wakeup_id);
+          wakeup_id = 0;
+        }
+
+      if (idle_id != 0)
+        {
+          g_source_remove (idle_id);
+          idle_id = 0;
+        }
+    }
+}
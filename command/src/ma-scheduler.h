@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2021 MATE developers
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MA_SCHEDULER_H
+#define MA_SCHEDULER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * One scheduler is shared by all the command applets of a process.  The
+ * same command line is run once for all the applets showing it, on ticks
+ * aligned to its interval, and only a few commands run at a time.
+ */
+
+typedef struct _MaSchedulerClient MaSchedulerClient;
+
+typedef void (* MaSchedulerFunc) (const gchar  *output,
+                                  const GError *error,
+                                  gpointer      user_data);
+
+MaSchedulerClient *ma_scheduler_add    (const gchar      *cmdline,
+                                        guint             interval,
+                                        gsize             max_output,
+                                        guint             timeout,
+                                        MaSchedulerFunc   func,
+                                        gpointer          user_data,
+                                        GError          **error);
+
+void               ma_scheduler_remove (MaSchedulerClient *client);
+
+G_END_DECLS
+
+#endif
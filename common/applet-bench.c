@@ -0,0 +1,186 @@
+/* Offscreen frame timing of the draw paths, see applet-bench.h */
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gtk/gtk.h>
+
+#include "applet-bench.h"
+
+static gint bench_frames = 1000;
+static gint bench_scale = 1;
+
+/* the time of every frame of the current case, allocated up front */
+static gint64 *bench_times = NULL;
+
+static GOptionEntry bench_entries [] = {
+    { "frames", 'n', 0, G_OPTION_ARG_INT, &bench_frames, "Frames measured per case (default 1000)", "N" },
+    { "scale",  's', 0, G_OPTION_ARG_INT, &bench_scale,  "Device scale of the screen, 1 to 4", "FACTOR" },
+    { NULL }
+};
+
+static gint64
+bench_now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static gint
+bench_compare_times (gconstpointer a,
+                     gconstpointer b)
+{
+    gint64 ta = *(const gint64 *) a, tb = *(const gint64 *) b;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+static void
+bench_print (const gchar *path,
+             const gchar *label,
+             gint64       total)
+{
+    qsort (bench_times, (gsize) bench_frames, sizeof (gint64), bench_compare_times);
+
+    printf ("%-28s %-16s %12.0f %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+            path, label,
+            (double) total / bench_frames,
+            bench_times [(bench_frames - 1) / 2],
+            bench_times [(bench_frames - 1) * 99 / 100],
+            bench_times [bench_frames - 1]);
+}
+
+gboolean
+applet_bench_init (int                 *argc,
+                   char              ***argv,
+                   const gchar         *summary,
+                   const GOptionEntry  *entries)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    gchar *scale;
+
+    context = g_option_context_new (summary);
+    g_option_context_add_main_entries (context, bench_entries, NULL);
+    if (entries != NULL)
+        g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, argc, argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return FALSE;
+    }
+    g_option_context_free (context);
+
+    bench_frames = MAX (bench_frames, 1);
+    bench_scale = CLAMP (bench_scale, 1, 4);
+    bench_times = g_new (gint64, bench_frames);
+
+    /* read once, when the display is opened */
+    scale = g_strdup_printf ("%d", bench_scale);
+    g_setenv ("GDK_SCALE", scale, TRUE);
+    g_free (scale);
+
+    if (!gtk_init_check (argc, argv))
+    {
+        g_printerr ("Cannot open the display\n");
+        return FALSE;
+    }
+
+    printf ("# scale %d, %d frames a case\n", bench_scale, bench_frames);
+    printf ("%-28s %-16s %12s %10s %10s %10s\n",
+            "path", "case", "ns/frame", "p50 ns", "p99 ns", "max ns");
+
+    return TRUE;
+}
+
+void
+applet_bench_draw (const gchar     *path,
+                   const gchar     *label,
+                   GtkWidget       *widget,
+                   gint             width,
+                   gint             height,
+                   AppletBenchFunc  prepare,
+                   gpointer         data)
+{
+    GtkWidget *window;
+    cairo_surface_t *surface;
+    gint64 total = 0;
+    gint scale, frame;
+
+    window = gtk_offscreen_window_new ();
+    gtk_widget_set_size_request (widget, width, height);
+    gtk_container_add (GTK_CONTAINER (window), widget);
+    gtk_widget_show_all (window);
+
+    /* realized and allocated, as on the first expose */
+    while (gtk_events_pending ())
+        gtk_main_iteration ();
+
+    width = gtk_widget_get_allocated_width (widget);
+    height = gtk_widget_get_allocated_height (widget);
+    scale = gtk_widget_get_scale_factor (widget);
+
+    surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width * scale, height * scale);
+    cairo_surface_set_device_scale (surface, scale, scale);
+
+    for (frame = -1; frame < bench_frames; frame++)
+    {
+        cairo_t *cr;
+        gint64 start;
+
+        if (prepare != NULL)
+            prepare (frame, data);
+
+        cr = cairo_create (surface);
+        start = bench_now_ns ();
+        gtk_widget_draw (widget, cr);
+        cairo_surface_flush (surface);
+        if (frame >= 0)
+        {
+            bench_times [frame] = bench_now_ns () - start;
+            total += bench_times [frame];
+        }
+        cairo_destroy (cr);
+    }
+
+    cairo_surface_destroy (surface);
+    gtk_widget_destroy (window);
+
+    bench_print (path, label, total);
+}
+
+void
+applet_bench_call (const gchar     *path,
+                   const gchar     *label,
+                   AppletBenchFunc  prepare,
+                   AppletBenchFunc  call,
+                   gpointer         data)
+{
+    gint64 total = 0;
+    gint frame;
+
+    for (frame = -1; frame < bench_frames; frame++)
+    {
+        gint64 start;
+
+        if (prepare != NULL)
+            prepare (frame, data);
+
+        start = bench_now_ns ();
+        call (frame, data);
+        if (frame >= 0)
+        {
+            bench_times [frame] = bench_now_ns () - start;
+            total += bench_times [frame];
+        }
+    }
+
+    bench_print (path, label, total);
+}
@@ -0,0 +1,50 @@
+#ifndef MATE_APPLETS_COMMON_APPLET_BENCH_H
+#define MATE_APPLETS_COMMON_APPLET_BENCH_H
+
+#include <gtk/gtk.h>
+
+/* Offscreen frame timing of the draw paths, for the <applet>-bench
+ * programs.
+ *
+ * applet_bench_draw () puts a widget into a GtkOffscreenWindow and
+ * renders it with gtk_widget_draw () into a cairo image surface, once
+ * per frame, so the draw handlers of the applet run as on the panel.
+ * applet_bench_call () times a function instead, for the paths that
+ * render into surfaces of their own. Before every frame, prepare () may
+ * change what is shown, as a tick of the applet would; it is not timed.
+ *
+ * Each case prints the mean, median, 99th percentile and maximum time
+ * of a frame in nanoseconds, like multiload-bench, after one untimed
+ * frame that fills the caches.
+ *
+ * --scale sets GDK_SCALE before the display is opened, so the widgets
+ * see a HiDPI screen. A display is needed, Xvfb will do. */
+
+/* frame counts from 0, -1 being the untimed first frame */
+typedef void (*AppletBenchFunc) (gint     frame,
+                                 gpointer data);
+
+/* Parses --frames and --scale besides entries, opens the display and
+ * prints the header. Returns FALSE after printing why it failed. */
+G_GNUC_INTERNAL gboolean applet_bench_init (int                 *argc,
+                                            char              ***argv,
+                                            const gchar         *summary,
+                                            const GOptionEntry  *entries);
+
+/* Draws widget at width x height, in device independent pixels, -1
+ * being its natural size. The widget is destroyed afterwards. */
+G_GNUC_INTERNAL void     applet_bench_draw (const gchar     *path,
+                                            const gchar     *label,
+                                            GtkWidget       *widget,
+                                            gint             width,
+                                            gint             height,
+                                            AppletBenchFunc  prepare,
+                                            gpointer         data);
+
+G_GNUC_INTERNAL void     applet_bench_call (const gchar     *path,
+                                            const gchar     *label,
+                                            AppletBenchFunc  prepare,
+                                            AppletBenchFunc  call,
+                                            gpointer         data);
+
+#endif /* MATE_APPLETS_COMMON_APPLET_BENCH_H */
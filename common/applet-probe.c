@@ -0,0 +1,213 @@
+/* Timing probes for the periodic callbacks, shared by the applets */
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "applet-probe.h"
+
+#define APPLET_PROBE_ENV  "MATE_APPLETS_PROBES"
+#define APPLET_PROBE_PATH "/org/mate/applets/Probes"
+
+/* the data of the bus connection holding the probes of the process */
+#define APPLET_PROBE_DATA "mate-applets-probes"
+
+struct _AppletProbe
+{
+    gchar   *name;
+    guint64  calls;
+    guint64  total;     /* microseconds */
+    guint64  max;
+    guint64  buckets [APPLET_PROBE_BUCKETS];
+};
+
+static const gchar applet_probe_xml [] =
+    "<node>"
+    "  <interface name='org.mate.applets.Probes'>"
+    "    <method name='GetProbes'>"
+    "      <arg type='a(stttat)' name='probes' direction='out'/>"
+    "    </method>"
+    "    <method name='Reset'/>"
+    "  </interface>"
+    "</node>";
+
+/* -1 until the environment was checked */
+static gint       applet_probe_enabled = -1;
+
+/* Built in-process, every applet is a module of mate-panel with its own
+ * copy of this file. The first module to look up a probe exports the
+ * list on the connection of the panel and the others add their probes
+ * to it, so that one object covers the whole process. */
+static GPtrArray *applet_probes = NULL;
+
+static GVariant *
+applet_probe_list (void)
+{
+    GVariantBuilder builder;
+    guint i;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(stttat)"));
+
+    for (i = 0; i < applet_probes->len; i++)
+    {
+        AppletProbe *probe = g_ptr_array_index (applet_probes, i);
+        GVariant *buckets;
+
+        buckets = g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                             probe->buckets,
+                                             APPLET_PROBE_BUCKETS,
+                                             sizeof (guint64));
+        g_variant_builder_add (&builder, "(sttt@at)",
+                               probe->name, probe->calls, probe->total,
+                               probe->max, buckets);
+    }
+
+    return g_variant_builder_end (&builder);
+}
+
+static void
+applet_probe_method_call (GDBusConnection       *connection,
+                          const gchar           *sender,
+                          const gchar           *object_path,
+                          const gchar           *interface_name,
+                          const gchar           *method_name,
+                          GVariant              *parameters,
+                          GDBusMethodInvocation *invocation,
+                          gpointer               user_data)
+{
+    if (g_strcmp0 (method_name, "GetProbes") == 0)
+    {
+        g_dbus_method_invocation_return_value (invocation,
+                                               g_variant_new ("(@a(stttat))",
+                                                              applet_probe_list ()));
+    }
+    else if (g_strcmp0 (method_name, "Reset") == 0)
+    {
+        guint i;
+
+        for (i = 0; i < applet_probes->len; i++)
+        {
+            AppletProbe *probe = g_ptr_array_index (applet_probes, i);
+
+            probe->calls = probe->total = probe->max = 0;
+            memset (probe->buckets, 0, sizeof probe->buckets);
+        }
+
+        g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+}
+
+static const GDBusInterfaceVTable applet_probe_vtable = {
+    applet_probe_method_call,
+    NULL,
+    NULL,
+    { NULL }
+};
+
+static void
+applet_probe_export (GDBusConnection *connection)
+{
+    GDBusNodeInfo *info;
+    GError *error = NULL;
+
+    info = g_dbus_node_info_new_for_xml (applet_probe_xml, NULL);
+    if (!g_dbus_connection_register_object (connection, APPLET_PROBE_PATH,
+                                            info->interfaces [0],
+                                            &applet_probe_vtable,
+                                            NULL, NULL, &error))
+    {
+        g_debug ("probes: cannot export %s: %s", APPLET_PROBE_PATH, error->message);
+        g_error_free (error);
+    }
+    g_dbus_node_info_unref (info);
+
+    /* the object stays exported for the life of the process */
+}
+
+static AppletProbe *
+applet_probe_lookup (const gchar *name)
+{
+    AppletProbe *probe;
+    guint i;
+
+    if (applet_probes == NULL)
+    {
+        GDBusConnection *connection;
+        GError *error = NULL;
+
+        /* the factory is on the bus already, so this does not block */
+        connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+        if (connection == NULL)
+        {
+            g_debug ("probes: no session bus: %s", error->message);
+            g_error_free (error);
+            applet_probes = g_ptr_array_new ();
+        }
+        else
+        {
+            applet_probes = g_object_get_data (G_OBJECT (connection), APPLET_PROBE_DATA);
+            if (applet_probes == NULL)
+            {
+                applet_probes = g_ptr_array_new ();
+                g_object_set_data (G_OBJECT (connection), APPLET_PROBE_DATA, applet_probes);
+                applet_probe_export (connection);
+            }
+            /* the connection lives as long as the process */
+            g_object_unref (connection);
+        }
+    }
+
+    /* in-process applets of the same kind use the same probe names */
+    for (i = 0; i < applet_probes->len; i++)
+    {
+        probe = g_ptr_array_index (applet_probes, i);
+        if (strcmp (probe->name, name) == 0)
+            return probe;
+    }
+
+    probe = g_new0 (AppletProbe, 1);
+    probe->name = g_strdup (name);
+    g_ptr_array_add (applet_probes, probe);
+
+    return probe;
+}
+
+gint64
+applet_probe_begin (AppletProbe **probe,
+                    const gchar  *name)
+{
+    if (G_UNLIKELY (applet_probe_enabled < 0))
+        applet_probe_enabled = g_getenv (APPLET_PROBE_ENV) != NULL;
+
+    if (G_LIKELY (!applet_probe_enabled))
+        return 0;
+
+    if (*probe == NULL)
+        *probe = applet_probe_lookup (name);
+
+    return g_get_monotonic_time ();
+}
+
+void
+applet_probe_end (AppletProbe *probe,
+                  gint64       start)
+{
+    guint64 elapsed;
+    guint bucket;
+
+    if (G_LIKELY (probe == NULL || start == 0))
+        return;
+
+    elapsed = (guint64) MAX (g_get_monotonic_time () - start, 0);
+
+    probe->calls++;
+    probe->total += elapsed;
+    probe->max = MAX (probe->max, elapsed);
+
+    /* the number of bits of elapsed, so bucket b holds [2^(b-1), 2^b) */
+    for (bucket = 0; bucket < APPLET_PROBE_BUCKETS - 1 && elapsed >> bucket; bucket++)
+        ;
+    probe->buckets [bucket]++;
+}
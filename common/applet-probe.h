@@ -0,0 +1,39 @@
+#ifndef MATE_APPLETS_COMMON_APPLET_PROBE_H
+#define MATE_APPLETS_COMMON_APPLET_PROBE_H
+
+#include <glib.h>
+
+/* Timing probes for the periodic callbacks of the applets.
+ *
+ * They do nothing unless MATE_APPLETS_PROBES is set in the environment
+ * of the applet process.  Then every probe counts its calls, their total
+ * and maximum duration and a histogram of the durations, and the process
+ * exports them on the session bus:
+ *
+ *   gdbus call --session --dest <unique name> \
+ *              --object-path /org/mate/applets/Probes \
+ *              --method org.mate.applets.Probes.GetProbes
+ *
+ * A callback is measured with
+ *
+ *   static AppletProbe *probe = NULL;
+ *   gint64 start = applet_probe_begin (&probe, "netspeed:timeout_function");
+ *   ...
+ *   applet_probe_end (probe, start);
+ *
+ * Probes belong to the main thread. */
+
+/* bucket 0 counts the calls under a microsecond, bucket b those from
+ * 2^(b-1) up to 2^b microseconds, the last one all longer calls */
+#define APPLET_PROBE_BUCKETS 16
+
+typedef struct _AppletProbe AppletProbe;
+
+/* Returns the start time, 0 when probes are disabled.  The probe is
+ * looked up by name on the first enabled call and kept in *probe. */
+G_GNUC_INTERNAL gint64 applet_probe_begin (AppletProbe **probe,
+                                           const gchar   *name);
+G_GNUC_INTERNAL void   applet_probe_end   (AppletProbe  *probe,
+                                           gint64         start);
+
+#endif /* MATE_APPLETS_COMMON_APPLET_PROBE_H */
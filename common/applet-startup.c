@@ -0,0 +1,133 @@
+/* Startup trace and deferred initialization, shared by the applets */
+#include <config.h>
+
+#include <gtk/gtk.h>
+
+#include "applet-startup.h"
+
+#define APPLET_STARTUP_ENV "MATE_APPLETS_STARTUP_TRACE"
+
+typedef struct
+{
+    GtkWidget         *widget;
+    gchar             *name;
+    AppletStartupFunc  func;
+    gpointer           data;
+    gulong             draw_id;
+    gulong             destroy_id;
+    guint              source_id;  /* the timeout, then the idle after the first frame */
+} AppletStartupDefer;
+
+/* -1 until the environment was checked */
+static gint   applet_startup_enabled = -1;
+static gint64 applet_startup_first = 0;
+static gint64 applet_startup_last = 0;
+
+void
+applet_startup_mark (const gchar *format,
+                     ...)
+{
+    va_list args;
+    gchar *phase;
+    gint64 now;
+
+    if (G_UNLIKELY (applet_startup_enabled < 0))
+        applet_startup_enabled = g_getenv (APPLET_STARTUP_ENV) != NULL;
+
+    if (G_LIKELY (!applet_startup_enabled))
+        return;
+
+    now = g_get_monotonic_time ();
+    if (applet_startup_first == 0)
+        applet_startup_first = applet_startup_last = now;
+
+    va_start (args, format);
+    phase = g_strdup_vprintf (format, args);
+    va_end (args);
+
+    g_printerr ("startup: %.1f ms (+%.1f) %s\n",
+                (now - applet_startup_first) / 1000.0,
+                (now - applet_startup_last) / 1000.0,
+                phase);
+    g_free (phase);
+
+    applet_startup_last = now;
+}
+
+static void
+applet_startup_defer_free (AppletStartupDefer *defer)
+{
+    if (defer->draw_id != 0)
+        g_signal_handler_disconnect (defer->widget, defer->draw_id);
+    g_signal_handler_disconnect (defer->widget, defer->destroy_id);
+    if (defer->source_id != 0)
+        g_source_remove (defer->source_id);
+
+    g_free (defer->name);
+    g_free (defer);
+}
+
+static gboolean
+applet_startup_defer_run (gpointer data)
+{
+    AppletStartupDefer *defer = data;
+
+    defer->source_id = 0;
+
+    applet_startup_mark ("%s deferred work", defer->name);
+    defer->func (defer->data);
+    applet_startup_mark ("%s deferred work done", defer->name);
+
+    applet_startup_defer_free (defer);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* The frame is being painted, the idle runs once it is on screen */
+static gboolean
+applet_startup_draw_cb (GtkWidget *widget,
+                        cairo_t   *cr,
+                        gpointer   data)
+{
+    AppletStartupDefer *defer = data;
+
+    applet_startup_mark ("%s first frame", defer->name);
+
+    g_signal_handler_disconnect (widget, defer->draw_id);
+    defer->draw_id = 0;
+
+    g_source_remove (defer->source_id);
+    defer->source_id = g_idle_add_full (G_PRIORITY_LOW, applet_startup_defer_run,
+                                        defer, NULL);
+
+    return FALSE;
+}
+
+static void
+applet_startup_destroy_cb (GtkWidget *widget,
+                           gpointer   data)
+{
+    applet_startup_defer_free (data);
+}
+
+void
+applet_startup_defer (GtkWidget         *widget,
+                      const gchar       *name,
+                      AppletStartupFunc  func,
+                      gpointer           data)
+{
+    AppletStartupDefer *defer;
+
+    defer = g_new0 (AppletStartupDefer, 1);
+    defer->widget = widget;
+    defer->name = g_strdup (name);
+    defer->func = func;
+    defer->data = data;
+
+    defer->draw_id = g_signal_connect_after (widget, "draw",
+                                             G_CALLBACK (applet_startup_draw_cb), defer);
+    defer->destroy_id = g_signal_connect (widget, "destroy",
+                                          G_CALLBACK (applet_startup_destroy_cb), defer);
+    defer->source_id = g_timeout_add_seconds (APPLET_STARTUP_DEFER_MAX,
+                                              applet_startup_defer_run, defer);
+}
@@ -0,0 +1,36 @@
+#ifndef MATE_APPLETS_COMMON_APPLET_STARTUP_H
+#define MATE_APPLETS_COMMON_APPLET_STARTUP_H
+
+#include <gtk/gtk.h>
+
+/* Startup of the applet factories.
+ *
+ * mate-panel starts all the applets of a session at once, so the work
+ * that is not needed to paint the applet is deferred until after its
+ * first frame with applet_startup_defer ().
+ *
+ * With MATE_APPLETS_STARTUP_TRACE set in the environment of the applet
+ * process, every phase is printed on stderr as
+ *
+ *   startup: <ms since the first phase> ms (+<ms since the previous one>) <phase>
+ *
+ * including the first paint of each applet given to
+ * applet_startup_defer () and the deferred work. */
+
+G_GNUC_INTERNAL void applet_startup_mark  (const gchar *format,
+                                           ...) G_GNUC_PRINTF (1, 2);
+
+typedef void (*AppletStartupFunc) (gpointer data);
+
+/* Runs func (data) once, at low priority after widget painted its first
+ * frame, or after APPLET_STARTUP_DEFER_MAX seconds if it is not painted
+ * by then. Nothing runs if widget is destroyed first. name is that of
+ * the applet in the trace. */
+#define APPLET_STARTUP_DEFER_MAX 5
+
+G_GNUC_INTERNAL void applet_startup_defer (GtkWidget        *widget,
+                                           const gchar      *name,
+                                           AppletStartupFunc func,
+                                           gpointer          data);
+
+#endif /* MATE_APPLETS_COMMON_APPLET_STARTUP_H */
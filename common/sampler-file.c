@@ -0,0 +1,185 @@
+/* Persistent readers of procfs and sysfs files */
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "sampler-file.h"
+#include "sampler-replay.h"
+
+/* The next contents of a replayed file into buffer, as pread() would */
+static gssize
+sampler_replay_pread (gint   fd,
+                      gchar *buffer,
+                      gsize  count)
+{
+    const gchar *data;
+    gsize length;
+
+    data = sampler_replay_read (fd, &length);
+    length = MIN (length, count);
+    memcpy (buffer, data, length);
+
+    return (gssize) length;
+}
+
+const gchar *
+sampler_file_read (SamplerFile *file)
+{
+#ifndef __linux__
+    return NULL;
+#else
+    if (file->fd < 0)
+    {
+        if (file->failed)
+            return NULL;
+
+        file->fd = sampler_open (file->path);
+        if (file->fd < 0)
+        {
+            g_debug ("Failed to open %s: %s", file->path, g_strerror (errno));
+            file->failed = TRUE;
+            return NULL;
+        }
+
+        if (file->buffer == NULL)
+        {
+            file->size = 4096;
+            file->buffer = g_malloc (file->size);
+        }
+    }
+
+    if (file->fd >= SAMPLER_REPLAY_FD)
+    {
+        const gchar *data;
+
+        data = sampler_replay_read (file->fd, &file->length);
+        if (file->length >= file->size)
+        {
+            file->size = file->length + 1;
+            file->buffer = g_realloc (file->buffer, file->size);
+        }
+        memcpy (file->buffer, data, file->length);
+        file->buffer [file->length] = '\0';
+
+        return file->buffer;
+    }
+
+    for (;;)
+    {
+        gssize n;
+
+        n = pread (file->fd, file->buffer, file->size - 1, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            sampler_file_close (file);
+            file->failed = TRUE;
+            return NULL;
+        }
+
+        if ((gsize) n < file->size - 1)
+        {
+            file->buffer [n] = '\0';
+            file->length = (gsize) n;
+            sampler_record_read (file->fd, file->buffer, file->length);
+            return file->buffer;
+        }
+
+        /* the file did not fit, retry with a larger buffer */
+        file->size *= 2;
+        file->buffer = g_realloc (file->buffer, file->size);
+    }
+#endif /* __linux__ */
+}
+
+void
+sampler_file_close (SamplerFile *file)
+{
+    if (file->fd >= 0)
+        close (file->fd);
+
+    file->fd = -1;
+    file->length = 0;
+}
+
+gint
+sampler_open (const gchar *path)
+{
+    gint fd;
+
+    if (sampler_replay_active ())
+        return sampler_replay_open (path);
+
+    fd = open (path, O_RDONLY | O_CLOEXEC);
+    sampler_record_open (fd, path);
+
+    return fd;
+}
+
+gssize
+sampler_pread (gint  *fd,
+               gchar *buffer,
+               gsize  size)
+{
+    gssize len;
+
+    if (*fd < 0)
+        return -1;
+
+    if (*fd >= SAMPLER_REPLAY_FD)
+        len = sampler_replay_pread (*fd, buffer, size - 1);
+    else
+    {
+        do
+            len = pread (*fd, buffer, size - 1, 0);
+        while (len < 0 && errno == EINTR);
+
+        if (len > 0)
+            sampler_record_read (*fd, buffer, (gsize) len);
+    }
+
+    if (len <= 0)
+    {
+        gint save_errno = errno;
+
+        close (*fd);
+        *fd = -1;
+        errno = save_errno;
+
+        return -1;
+    }
+
+    while (len > 0 && g_ascii_isspace (buffer [len - 1]))
+        len--;
+    buffer [len] = '\0';
+
+    return len;
+}
+
+const gchar *
+sampler_parse_u64 (const gchar *p,
+                   guint64     *value)
+{
+    guint64 v = 0;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+
+    if (!g_ascii_isdigit (*p))
+    {
+        *value = 0;
+        return NULL;
+    }
+
+    while (g_ascii_isdigit (*p))
+        v = v * 10 + (guint64) (*p++ - '0');
+
+    *value = v;
+    return p;
+}
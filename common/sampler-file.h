@@ -0,0 +1,45 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_FILE_H
+#define MATE_APPLETS_COMMON_SAMPLER_FILE_H
+
+#include <glib.h>
+
+typedef struct _SamplerFile SamplerFile;
+
+/* A procfs or sysfs file kept open and re-read from offset 0 on every
+ * sample. The buffer grows as needed but is never shrunk, so
+ * steady-state reads are a single pread() and no allocation.
+ *
+ * A file that can not be opened is not tried again, so callers can
+ * fall back to another source once. */
+struct _SamplerFile
+{
+    const gchar *path;
+    gint         fd;
+    gchar       *buffer;
+    gsize        size;
+    gsize        length;
+    gboolean     failed;
+};
+
+#define SAMPLER_FILE_INIT(path) { (path), -1, NULL, 0, 0, FALSE }
+
+/* The contents, NUL terminated, or NULL when the file can not be read */
+G_GNUC_INTERNAL const gchar *sampler_file_read  (SamplerFile *file);
+G_GNUC_INTERNAL void         sampler_file_close (SamplerFile *file);
+
+/* For the many small attributes of sysfs, read into buffers of the
+ * caller: *fd is opened by the caller with sampler_open() and re-read
+ * with sampler_pread(), which trims the trailing newline. A failed or
+ * empty read, as of a device that went away, closes *fd and returns -1,
+ * so the file is opened again on the next read. */
+G_GNUC_INTERNAL gint         sampler_open       (const gchar *path);
+G_GNUC_INTERNAL gssize       sampler_pread      (gint        *fd,
+                                                 gchar       *buffer,
+                                                 gsize        size);
+
+/* Parses an unsigned decimal number after optional blanks. Returns the
+ * position after the number, or NULL if there is none. */
+G_GNUC_INTERNAL const gchar *sampler_parse_u64  (const gchar *p,
+                                                 guint64     *value);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_FILE_H */
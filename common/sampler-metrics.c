@@ -0,0 +1,448 @@
+/* Prometheus text export of the readings, see sampler-metrics.h */
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "sampler-tick.h"
+#include "sampler-metrics.h"
+
+/* a scraper sends a request line and a few headers, anything longer is
+ * not one */
+#define METRICS_REQUEST_MAX 8192
+
+struct _SamplerMetrics
+{
+    SamplerMetricsFunc  func;
+    gpointer            data;
+    GString            *buffer;  /* reused by every rendering */
+
+    gchar              *socket_path;
+    GSocketService     *service;
+    GCancellable       *cancellable;  /* of the clients being served */
+
+    gchar              *textfile;
+    guint               textfile_id;
+    GCancellable       *textfile_cancellable;  /* of the write in flight */
+};
+
+typedef struct
+{
+    GSocketConnection *connection;
+    SamplerMetrics    *metrics;
+    GCancellable      *cancellable;
+    GString           *request;
+    gchar              chunk [512];
+    GBytes            *response;
+} MetricsClient;
+
+static void metrics_client_read (MetricsClient *client);
+
+static const gchar *
+metrics_render (SamplerMetrics *metrics)
+{
+    g_string_truncate (metrics->buffer, 0);
+    metrics->func (metrics->buffer, metrics->data);
+
+    return metrics->buffer->str;
+}
+
+void
+sampler_metrics_family (GString     *out,
+                        const gchar *name,
+                        const gchar *type,
+                        const gchar *help)
+{
+    g_string_append_printf (out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void
+metrics_sample_name (GString     *out,
+                     const gchar *name,
+                     const gchar *labels)
+{
+    g_string_append (out, name);
+    if (labels != NULL && *labels != '\0')
+        g_string_append_printf (out, "{%s}", labels);
+    g_string_append_c (out, ' ');
+}
+
+void
+sampler_metrics_sample (GString     *out,
+                        const gchar *name,
+                        const gchar *labels,
+                        gdouble      value)
+{
+    gchar number [G_ASCII_DTOSTR_BUF_SIZE];
+
+    metrics_sample_name (out, name, labels);
+    g_string_append (out, g_ascii_dtostr (number, sizeof number, value));
+    g_string_append_c (out, '\n');
+}
+
+void
+sampler_metrics_sample_u64 (GString     *out,
+                            const gchar *name,
+                            const gchar *labels,
+                            guint64      value)
+{
+    metrics_sample_name (out, name, labels);
+    g_string_append_printf (out, "%" G_GUINT64_FORMAT "\n", value);
+}
+
+void
+sampler_metrics_label_value (GString     *out,
+                             const gchar *value)
+{
+    g_string_append_c (out, '"');
+    for (; *value != '\0'; value++)
+    {
+        if (*value == '\\' || *value == '"')
+            g_string_append_c (out, '\\');
+        if (*value == '\n')
+            g_string_append (out, "\\n");
+        else
+            g_string_append_c (out, *value);
+    }
+    g_string_append_c (out, '"');
+}
+
+static void
+metrics_client_free (MetricsClient *client)
+{
+    g_io_stream_close (G_IO_STREAM (client->connection), NULL, NULL);
+    g_object_unref (client->connection);
+    g_object_unref (client->cancellable);
+    g_string_free (client->request, TRUE);
+    if (client->response != NULL)
+        g_bytes_unref (client->response);
+    g_free (client);
+}
+
+static void
+metrics_client_written (GObject      *stream,
+                        GAsyncResult *result,
+                        gpointer      data)
+{
+    g_output_stream_write_all_finish (G_OUTPUT_STREAM (stream), result, NULL, NULL);
+    metrics_client_free (data);
+}
+
+static void
+metrics_client_respond (MetricsClient *client)
+{
+    GOutputStream *output;
+    GString *response;
+
+    response = g_string_new ("HTTP/1.0 200 OK\r\n"
+                             "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                             "\r\n");
+    g_string_append (response, metrics_render (client->metrics));
+    client->response = g_string_free_to_bytes (response);
+
+    output = g_io_stream_get_output_stream (G_IO_STREAM (client->connection));
+    g_output_stream_write_all_async (output,
+                                     g_bytes_get_data (client->response, NULL),
+                                     g_bytes_get_size (client->response),
+                                     G_PRIORITY_LOW, client->cancellable,
+                                     metrics_client_written, client);
+}
+
+/* The whole request is read before answering: closing a Unix socket
+ * with unread data resets the connection of the peer. */
+static void
+metrics_client_received (GObject      *stream,
+                         GAsyncResult *result,
+                         gpointer      data)
+{
+    MetricsClient *client = data;
+    gssize len;
+
+    len = g_input_stream_read_finish (G_INPUT_STREAM (stream), result, NULL);
+    if (len < 0)
+    {
+        metrics_client_free (client);
+        return;
+    }
+
+    g_string_append_len (client->request, client->chunk, len);
+
+    if (len == 0 ||
+        strstr (client->request->str, "\r\n\r\n") != NULL ||
+        strstr (client->request->str, "\n\n") != NULL)
+        metrics_client_respond (client);
+    else if (client->request->len > METRICS_REQUEST_MAX)
+        metrics_client_free (client);
+    else
+        metrics_client_read (client);
+}
+
+static void
+metrics_client_read (MetricsClient *client)
+{
+    GInputStream *input;
+
+    input = g_io_stream_get_input_stream (G_IO_STREAM (client->connection));
+    g_input_stream_read_async (input, client->chunk, sizeof client->chunk,
+                               G_PRIORITY_LOW, client->cancellable,
+                               metrics_client_received, client);
+}
+
+static gboolean
+metrics_incoming_cb (GSocketService    *service,
+                     GSocketConnection *connection,
+                     GObject           *source,
+                     gpointer           data)
+{
+    MetricsClient *client;
+
+    client = g_new0 (MetricsClient, 1);
+    client->connection = g_object_ref (connection);
+    client->metrics = data;
+    client->cancellable = g_object_ref (client->metrics->cancellable);
+    client->request = g_string_new (NULL);
+    metrics_client_read (client);
+
+    return TRUE;
+}
+
+/* A socket left by an applet that crashed refuses connections */
+static gboolean
+metrics_socket_is_stale (GSocketAddress *address)
+{
+    GSocketClient *client;
+    GSocketConnection *connection;
+
+    client = g_socket_client_new ();
+    connection = g_socket_client_connect (client, G_SOCKET_CONNECTABLE (address), NULL, NULL);
+    g_object_unref (client);
+
+    if (connection == NULL)
+        return TRUE;
+
+    g_object_unref (connection);
+    return FALSE;
+}
+
+static void
+metrics_socket_stop (SamplerMetrics *metrics)
+{
+    if (metrics->service == NULL)
+        return;
+
+    /* the clients being served fail their next read or write */
+    g_cancellable_cancel (metrics->cancellable);
+    g_clear_object (&metrics->cancellable);
+
+    g_socket_service_stop (metrics->service);
+    g_socket_listener_close (G_SOCKET_LISTENER (metrics->service));
+    g_clear_object (&metrics->service);
+    g_unlink (metrics->socket_path);
+}
+
+/* The mode of the socket is set before it listens, so nobody else can
+ * connect whatever the umask */
+static gboolean
+metrics_socket_listen (SamplerMetrics  *metrics,
+                       GSocketAddress  *address,
+                       GError         **error)
+{
+    GSocket *socket;
+    gboolean listening = FALSE;
+
+    socket = g_socket_new (G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM,
+                           G_SOCKET_PROTOCOL_DEFAULT, error);
+    if (socket == NULL)
+        return FALSE;
+
+    if (!g_socket_bind (socket, address, FALSE, error))
+    {
+        g_object_unref (socket);
+        return FALSE;
+    }
+
+    if (g_chmod (metrics->socket_path, 0600) < 0)
+    {
+        int saved_errno = errno;
+
+        g_set_error_literal (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                             g_strerror (saved_errno));
+    }
+    else if (g_socket_listen (socket, error))
+    {
+        listening = g_socket_listener_add_socket (G_SOCKET_LISTENER (metrics->service),
+                                                  socket, NULL, error);
+    }
+
+    if (!listening)
+        g_unlink (metrics->socket_path);
+
+    g_object_unref (socket);
+    return listening;
+}
+
+static void
+metrics_socket_start (SamplerMetrics *metrics)
+{
+    GSocketAddress *address;
+    GError *error = NULL;
+    gboolean added;
+
+    metrics->service = g_socket_service_new ();
+    metrics->cancellable = g_cancellable_new ();
+    address = g_unix_socket_address_new (metrics->socket_path);
+
+    added = metrics_socket_listen (metrics, address, &error);
+    if (!added && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE) &&
+        metrics_socket_is_stale (address))
+    {
+        g_clear_error (&error);
+        g_unlink (metrics->socket_path);
+        added = metrics_socket_listen (metrics, address, &error);
+    }
+    g_object_unref (address);
+
+    if (!added)
+    {
+        g_warning ("Can not export metrics on %s: %s", metrics->socket_path, error->message);
+        g_error_free (error);
+        g_clear_object (&metrics->service);
+        g_clear_object (&metrics->cancellable);
+        return;
+    }
+
+    g_signal_connect (metrics->service, "incoming",
+                      G_CALLBACK (metrics_incoming_cb), metrics);
+    g_socket_service_start (metrics->service);
+}
+
+static void
+metrics_textfile_written (GObject      *file,
+                          GAsyncResult *result,
+                          gpointer      data)
+{
+    SamplerMetrics *metrics = data;
+    GError *error = NULL;
+
+    if (!g_file_replace_contents_finish (G_FILE (file), result, NULL, &error))
+    {
+        /* the path changed, or the metrics are gone */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_error_free (error);
+            return;
+        }
+
+        g_warning ("Can not export metrics to %s: %s", metrics->textfile, error->message);
+        g_error_free (error);
+        g_source_remove (metrics->textfile_id);
+        metrics->textfile_id = 0;
+    }
+
+    g_clear_object (&metrics->textfile_cancellable);
+}
+
+/* Written to a temporary file that is renamed over the old one, by the
+ * worker threads of GIO; a write that is still going when the next tick
+ * comes is not doubled */
+static gboolean
+metrics_textfile_cb (gpointer data)
+{
+    SamplerMetrics *metrics = data;
+    GFile *file;
+    GBytes *bytes;
+
+    if (metrics->textfile_cancellable != NULL)
+        return G_SOURCE_CONTINUE;
+
+    metrics_render (metrics);
+    bytes = g_bytes_new (metrics->buffer->str, metrics->buffer->len);
+    file = g_file_new_for_path (metrics->textfile);
+    metrics->textfile_cancellable = g_cancellable_new ();
+
+    g_file_replace_contents_bytes_async (file, bytes, NULL, FALSE,
+                                         G_FILE_CREATE_NONE, metrics->textfile_cancellable,
+                                         metrics_textfile_written, metrics);
+    g_object_unref (file);
+    g_bytes_unref (bytes);
+
+    return G_SOURCE_CONTINUE;
+}
+
+SamplerMetrics *
+sampler_metrics_new (SamplerMetricsFunc func,
+                     gpointer           data)
+{
+    SamplerMetrics *metrics;
+
+    metrics = g_new0 (SamplerMetrics, 1);
+    metrics->func = func;
+    metrics->data = data;
+    metrics->buffer = g_string_sized_new (4096);
+
+    return metrics;
+}
+
+void
+sampler_metrics_free (SamplerMetrics *metrics)
+{
+    if (metrics == NULL)
+        return;
+
+    sampler_metrics_set_socket (metrics, NULL);
+    sampler_metrics_set_textfile (metrics, NULL);
+    g_string_free (metrics->buffer, TRUE);
+    g_free (metrics);
+}
+
+void
+sampler_metrics_set_socket (SamplerMetrics *metrics,
+                            const gchar    *path)
+{
+    if (path != NULL && *path == '\0')
+        path = NULL;
+
+    if (metrics->service != NULL && g_strcmp0 (path, metrics->socket_path) == 0)
+        return;
+
+    metrics_socket_stop (metrics);
+    g_free (metrics->socket_path);
+    metrics->socket_path = g_strdup (path);
+
+    if (path != NULL)
+        metrics_socket_start (metrics);
+}
+
+void
+sampler_metrics_set_textfile (SamplerMetrics *metrics,
+                              const gchar    *path)
+{
+    if (path != NULL && *path == '\0')
+        path = NULL;
+
+    if (metrics->textfile_id != 0 && g_strcmp0 (path, metrics->textfile) == 0)
+        return;
+
+    if (metrics->textfile_id != 0)
+    {
+        g_source_remove (metrics->textfile_id);
+        metrics->textfile_id = 0;
+    }
+    if (metrics->textfile_cancellable != NULL)
+    {
+        g_cancellable_cancel (metrics->textfile_cancellable);
+        g_clear_object (&metrics->textfile_cancellable);
+    }
+    g_free (metrics->textfile);
+    metrics->textfile = g_strdup (path);
+
+    if (path == NULL)
+        return;
+
+    metrics->textfile_id = sampler_tick_add (SAMPLER_METRICS_TEXTFILE_INTERVAL,
+                                             metrics_textfile_cb, metrics);
+}
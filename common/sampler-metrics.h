@@ -0,0 +1,57 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_METRICS_H
+#define MATE_APPLETS_COMMON_SAMPLER_METRICS_H
+
+#include <glib.h>
+
+/* Opt-in export of the readings of an applet in the Prometheus text
+ * exposition format.
+ *
+ * The text is rendered by the applet's callback straight from the
+ * values and rings it keeps for drawing, only when it is asked for:
+ *
+ *  - on a Unix socket only the user can connect to, with one HTTP/1.0
+ *    response per connection, as
+ *    curl --unix-socket PATH http://localhost/metrics does;
+ *  - into a file rewritten every SAMPLER_METRICS_TEXTFILE_INTERVAL ms,
+ *    for the textfile collector of node_exporter. The file is written
+ *    off the main thread and replaced by a rename, so the collector
+ *    never reads half of it.
+ *
+ * Either is off while its path is NULL or empty. */
+#define SAMPLER_METRICS_TEXTFILE_INTERVAL 15000
+
+typedef struct _SamplerMetrics SamplerMetrics;
+
+/* Appends the families and samples of the applet to out */
+typedef void (*SamplerMetricsFunc) (GString *out, gpointer data);
+
+G_GNUC_INTERNAL SamplerMetrics *sampler_metrics_new          (SamplerMetricsFunc func,
+                                                              gpointer           data);
+G_GNUC_INTERNAL void            sampler_metrics_free         (SamplerMetrics    *metrics);
+G_GNUC_INTERNAL void            sampler_metrics_set_socket   (SamplerMetrics    *metrics,
+                                                              const gchar       *path);
+G_GNUC_INTERNAL void            sampler_metrics_set_textfile (SamplerMetrics    *metrics,
+                                                              const gchar       *path);
+
+/* For the callbacks: the HELP and TYPE lines of a family, then its
+ * samples. labels is the text between the braces, as
+ * "graph=\"cpuload\"", or NULL. Values are written in the C locale. */
+G_GNUC_INTERNAL void            sampler_metrics_family       (GString           *out,
+                                                              const gchar       *name,
+                                                              const gchar       *type,
+                                                              const gchar       *help);
+G_GNUC_INTERNAL void            sampler_metrics_sample       (GString           *out,
+                                                              const gchar       *name,
+                                                              const gchar       *labels,
+                                                              gdouble            value);
+G_GNUC_INTERNAL void            sampler_metrics_sample_u64   (GString           *out,
+                                                              const gchar       *name,
+                                                              const gchar       *labels,
+                                                              guint64            value);
+
+/* Appends value to out as a quoted label value, for device names and
+ * the like */
+G_GNUC_INTERNAL void            sampler_metrics_label_value  (GString           *out,
+                                                              const gchar       *value);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_METRICS_H */
@@ -0,0 +1,318 @@
+/* rtnetlink link notifications and interface counters */
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/if.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+#include "sampler-netlink.h"
+
+/* how often cached interface information expires without rtnetlink */
+#define NETLINK_FALLBACK_INTERVAL (10 * G_USEC_PER_SEC)
+
+static gint     link_fd = -1;
+static guint    link_generation = 0;
+static gboolean link_initialized = FALSE;
+
+/* a separate unsubscribed socket for dump requests, so replies never
+ * interleave with link notifications */
+static gint     dump_fd = -1;
+static guint32  dump_seq = 0;
+static gboolean dump_failed = FALSE;
+
+#ifdef __linux__
+static gboolean
+netlink_link_event_cb (gint         fd,
+                       GIOCondition condition,
+                       gpointer     user_data)
+{
+    gchar buffer [8192];
+    gssize len;
+
+    for (;;)
+    {
+        struct nlmsghdr *header;
+        int remaining;
+
+        len = recv (fd, buffer, sizeof buffer, MSG_DONTWAIT);
+        if (len < 0 && errno == EINTR)
+            continue;
+
+        /* the socket overran, so some events were lost: the next call
+         * dumps the links again, and the socket goes on after the error */
+        if (len < 0 && errno == ENOBUFS)
+        {
+            link_generation++;
+            continue;
+        }
+
+        if (len <= 0)
+            break;
+
+        remaining = (int) len;
+        for (header = (struct nlmsghdr *) buffer;
+             NLMSG_OK (header, remaining);
+             header = NLMSG_NEXT (header, remaining))
+        {
+            if (header->nlmsg_type == RTM_NEWLINK ||
+                header->nlmsg_type == RTM_DELLINK ||
+                header->nlmsg_type == RTM_NEWADDR ||
+                header->nlmsg_type == RTM_DELADDR)
+                link_generation++;
+        }
+    }
+
+    if ((condition & (G_IO_HUP | G_IO_NVAL)) ||
+        (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        close (link_fd);
+        link_fd = -1;
+        return G_SOURCE_REMOVE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+netlink_link_init (void)
+{
+    struct sockaddr_nl addr = { 0 };
+
+    link_fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (link_fd < 0)
+        return;
+
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+    if (bind (link_fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    {
+        g_debug ("Failed to subscribe to rtnetlink link events: %s", g_strerror (errno));
+        close (link_fd);
+        link_fd = -1;
+        return;
+    }
+
+    g_unix_fd_add (link_fd, G_IO_IN | G_IO_ERR | G_IO_HUP,
+                   netlink_link_event_cb, NULL);
+}
+
+static void
+netlink_parse_link (struct nlmsghdr *header,
+                    GArray          *links)
+{
+    struct ifinfomsg *info = NLMSG_DATA (header);
+    struct rtattr *attr;
+    NetlinkLink link;
+    gboolean have_name = FALSE, have_stats = FALSE;
+    int remaining;
+
+    if (header->nlmsg_len < NLMSG_LENGTH (sizeof *info))
+        return;
+
+    memset (&link, 0, sizeof link);
+    link.flags = info->ifi_flags;
+    remaining = IFLA_PAYLOAD (header);
+
+    for (attr = IFLA_RTA (info); RTA_OK (attr, remaining); attr = RTA_NEXT (attr, remaining))
+    {
+        switch (attr->rta_type)
+        {
+            case IFLA_IFNAME:
+                g_strlcpy (link.name, RTA_DATA (attr),
+                           MIN (sizeof link.name, RTA_PAYLOAD (attr) + 1));
+                have_name = TRUE;
+                break;
+
+            case IFLA_STATS64:
+                if (RTA_PAYLOAD (attr) >= sizeof (struct rtnl_link_stats64))
+                {
+                    struct rtnl_link_stats64 stats;
+
+                    /* the attribute is only 4 byte aligned */
+                    memcpy (&stats, RTA_DATA (attr), sizeof stats);
+                    link.rx_bytes = stats.rx_bytes;
+                    link.tx_bytes = stats.tx_bytes;
+                    have_stats = TRUE;
+                }
+                break;
+
+            case IFLA_STATS:
+                if (!have_stats && RTA_PAYLOAD (attr) >= sizeof (struct rtnl_link_stats))
+                {
+                    struct rtnl_link_stats stats;
+
+                    memcpy (&stats, RTA_DATA (attr), sizeof stats);
+                    link.rx_bytes = stats.rx_bytes;
+                    link.tx_bytes = stats.tx_bytes;
+                }
+                break;
+        }
+    }
+
+    if (have_name)
+        g_array_append_val (links, link);
+}
+
+static gboolean
+netlink_dump_links (GArray *links)
+{
+    /* large enough for the biggest dump part the kernel sends */
+    static guint32 buffer [8192];
+    struct {
+        struct nlmsghdr  header;
+        struct ifinfomsg info;
+    } request;
+
+    if (dump_fd < 0)
+    {
+        struct sockaddr_nl addr = { 0 };
+
+        dump_fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (dump_fd < 0)
+        {
+            /* do not retry on every tick if rtnetlink is not usable here */
+            dump_failed = TRUE;
+            return FALSE;
+        }
+
+        addr.nl_family = AF_NETLINK;
+        if (bind (dump_fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+        {
+            dump_failed = TRUE;
+            goto fail;
+        }
+    }
+
+    memset (&request, 0, sizeof request);
+    request.header.nlmsg_len = NLMSG_LENGTH (sizeof request.info);
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++dump_seq;
+    request.info.ifi_family = AF_UNSPEC;
+
+    if (send (dump_fd, &request, request.header.nlmsg_len, 0) < 0)
+        goto fail;
+
+    for (;;)
+    {
+        struct nlmsghdr *header;
+        gssize len;
+        int remaining;
+
+        len = recv (dump_fd, buffer, sizeof buffer, MSG_TRUNC);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0 || (gsize) len > sizeof buffer)
+            goto fail;
+
+        remaining = (int) len;
+        for (header = (struct nlmsghdr *) buffer;
+             NLMSG_OK (header, remaining);
+             header = NLMSG_NEXT (header, remaining))
+        {
+            /* a leftover reply to an earlier, abandoned request */
+            if (header->nlmsg_seq != dump_seq)
+                continue;
+
+            switch (header->nlmsg_type)
+            {
+                case NLMSG_DONE:
+                    return TRUE;
+                case NLMSG_ERROR:
+                {
+                    const struct nlmsgerr *error = NLMSG_DATA (header);
+
+                    /* a filter that refuses the dump will keep refusing it */
+                    if (error->error == -EPERM || error->error == -EACCES)
+                        dump_failed = TRUE;
+                    g_array_set_size (links, 0);
+                    return FALSE;
+                }
+                case RTM_NEWLINK:
+                    netlink_parse_link (header, links);
+                    break;
+            }
+        }
+    }
+
+fail:
+    /* do not retry on every tick if rtnetlink is filtered */
+    if (errno == EPERM || errno == EACCES)
+        dump_failed = TRUE;
+    g_debug ("Failed to dump rtnetlink links: %s", g_strerror (errno));
+    close (dump_fd);
+    dump_fd = -1;
+    g_array_set_size (links, 0);
+    return FALSE;
+}
+#endif /* __linux__ */
+
+gboolean
+netlink_get_links (GArray *links)
+{
+    g_array_set_size (links, 0);
+
+    if (dump_failed)
+        return FALSE;
+
+#ifdef __linux__
+    return netlink_dump_links (links);
+#else
+    return FALSE;
+#endif
+}
+
+gboolean
+netlink_get_link (const gchar *name,
+                  NetlinkLink *link)
+{
+    static GArray *links = NULL;
+    guint i;
+
+    if (links == NULL)
+        links = g_array_new (FALSE, FALSE, sizeof (NetlinkLink));
+
+    if (!netlink_get_links (links))
+        return FALSE;
+
+    for (i = 0; i < links->len; i++)
+    {
+        NetlinkLink *l = &g_array_index (links, NetlinkLink, i);
+
+        if (g_strcmp0 (l->name, name) == 0)
+        {
+            *link = *l;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+guint
+netlink_link_generation (void)
+{
+    if (!link_initialized)
+    {
+        link_initialized = TRUE;
+#ifdef __linux__
+        netlink_link_init ();
+#endif
+    }
+
+    if (link_fd < 0)
+        return (guint) (g_get_monotonic_time () / NETLINK_FALLBACK_INTERVAL);
+
+    return link_generation;
+}
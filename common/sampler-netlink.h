@@ -0,0 +1,30 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_NETLINK_H
+#define MATE_APPLETS_COMMON_SAMPLER_NETLINK_H
+
+#include <glib.h>
+
+/* A counter that changes whenever a network interface is added, removed
+ * or changed, or gains or loses an address, as reported by rtnetlink. Without rtnetlink it changes
+ * every few seconds instead. Compare it to a previous value to know when
+ * cached per-interface information must be looked up again. */
+G_GNUC_INTERNAL guint netlink_link_generation (void);
+
+typedef struct _NetlinkLink NetlinkLink;
+
+struct _NetlinkLink {
+    gchar   name [16];  /* IFNAMSIZ */
+    guint   flags;      /* IFF_* */
+    guint64 rx_bytes;
+    guint64 tx_bytes;
+};
+
+/* Fills links with a NetlinkLink for every interface, using a single
+ * RTM_GETLINK dump. Returns FALSE when rtnetlink is not available, in
+ * which case callers should fall back to glibtop. */
+G_GNUC_INTERNAL gboolean netlink_get_links (GArray *links);
+
+/* Looks up a single interface by name from a fresh dump. */
+G_GNUC_INTERNAL gboolean netlink_get_link (const gchar *name,
+                                           NetlinkLink *link);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_NETLINK_H */
@@ -0,0 +1,118 @@
+/* Windowed rate estimator of growing counters */
+#include <config.h>
+#include <math.h>
+
+#include <glib.h>
+
+#include "sampler-rate.h"
+
+struct _RateEstimator
+{
+    guint    window;
+    gint64   time_constant;
+
+    /* ring of window + 1 samples, head being the newest one */
+    guint64 *counters;
+    gint64  *times;
+    guint    head;
+    guint    filled;
+
+    gdouble  rate;
+    gboolean have_rate;
+};
+
+RateEstimator *
+rate_estimator_new (guint  window,
+                    gint64 time_constant)
+{
+    RateEstimator *re = g_new0 (RateEstimator, 1);
+
+    re->time_constant = time_constant;
+    rate_estimator_set_window (re, window);
+
+    return re;
+}
+
+void
+rate_estimator_free (RateEstimator *re)
+{
+    if (re == NULL)
+        return;
+
+    g_free (re->counters);
+    g_free (re->times);
+    g_free (re);
+}
+
+void
+rate_estimator_set_window (RateEstimator *re,
+                           guint          window)
+{
+    window = MAX (window, 1);
+
+    if (re->counters != NULL && re->window == window)
+        return;
+
+    re->window = window;
+    re->counters = g_renew (guint64, re->counters, window + 1);
+    re->times = g_renew (gint64, re->times, window + 1);
+
+    rate_estimator_reset (re);
+}
+
+void
+rate_estimator_reset (RateEstimator *re)
+{
+    re->head = 0;
+    re->filled = 0;
+    re->rate = 0.0;
+    re->have_rate = FALSE;
+}
+
+void
+rate_estimator_add (RateEstimator *re,
+                    guint64        counter,
+                    gint64         time)
+{
+    guint size = re->window + 1;
+    guint oldest;
+    gint64 previous_time, elapsed;
+    gdouble current;
+
+    if (re->filled > 0 && counter < re->counters [re->head])
+        rate_estimator_reset (re);
+
+    previous_time = re->times [re->head];
+
+    re->head = (re->head + 1) % size;
+    re->counters [re->head] = counter;
+    re->times [re->head] = time;
+    re->filled = MIN (re->filled + 1, size);
+
+    if (re->filled < 2)
+        return;
+
+    oldest = (re->head + size - (re->filled - 1)) % size;
+    elapsed = time - re->times [oldest];
+    if (elapsed <= 0)
+        return;
+
+    current = (gdouble) (counter - re->counters [oldest]) * G_USEC_PER_SEC / (gdouble) elapsed;
+
+    if (re->time_constant > 0 && re->have_rate)
+    {
+        gdouble alpha = 1.0 - exp (-(gdouble) (time - previous_time) / (gdouble) re->time_constant);
+
+        re->rate += alpha * (current - re->rate);
+    }
+    else
+        re->rate = current;
+
+    re->have_rate = TRUE;
+}
+
+gdouble
+rate_estimator_get (RateEstimator *re)
+{
+    return re->rate;
+}
@@ -0,0 +1,32 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_RATE_H
+#define MATE_APPLETS_COMMON_SAMPLER_RATE_H
+
+#include <glib.h>
+
+typedef struct _RateEstimator RateEstimator;
+
+/* Estimates the per-second rate of a growing counter, such as the bytes
+ * received by an interface, over the last window samples. Samples carry
+ * their own monotonic time, so irregular update intervals do not skew
+ * the result.
+ *
+ * With a time_constant (in microseconds) above 0, the windowed rate is
+ * further smoothed by an exponentially weighted moving average, which
+ * keeps the readout steady at short update intervals. */
+G_GNUC_INTERNAL RateEstimator *rate_estimator_new        (guint          window,
+                                                          gint64         time_constant);
+G_GNUC_INTERNAL void           rate_estimator_free       (RateEstimator *re);
+
+/* Changing the window drops the samples collected so far. */
+G_GNUC_INTERNAL void           rate_estimator_set_window (RateEstimator *re,
+                                                          guint          window);
+G_GNUC_INTERNAL void           rate_estimator_reset      (RateEstimator *re);
+
+/* A counter going backwards, e.g. after the device changed, restarts
+ * the estimate. */
+G_GNUC_INTERNAL void           rate_estimator_add        (RateEstimator *re,
+                                                          guint64        counter,
+                                                          gint64         time);
+G_GNUC_INTERNAL gdouble        rate_estimator_get        (RateEstimator *re);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_RATE_H */
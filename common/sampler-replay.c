@@ -0,0 +1,242 @@
+/* Capture and replay of the sampled files, see sampler-replay.h */
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "sampler-replay.h"
+
+#define SAMPLER_RECORD_ENV "MATE_APPLETS_SAMPLER_RECORD"
+#define SAMPLER_REPLAY_ENV "MATE_APPLETS_SAMPLER_REPLAY"
+
+typedef enum {
+    CAPTURE_UNKNOWN = -1,   /* until the environment was checked */
+    CAPTURE_OFF,
+    CAPTURE_RECORD,
+    CAPTURE_REPLAY
+} CaptureMode;
+
+typedef struct
+{
+    const gchar *data;      /* into replay_contents */
+    gsize        length;
+} ReplayFrame;
+
+typedef struct
+{
+    GArray *frames;
+    guint   next;
+} ReplayStream;
+
+static CaptureMode capture_mode = CAPTURE_UNKNOWN;
+
+static FILE       *record_file = NULL;
+static gint64      record_start = 0;
+static GHashTable *record_paths = NULL;   /* fd to path */
+
+static gchar      *replay_contents = NULL;
+static GHashTable *replay_index = NULL;   /* path to stream number + 1 */
+static GPtrArray  *replay_streams = NULL;
+static gboolean    replay_used_up = FALSE;
+
+static void
+capture_from_environment (void)
+{
+    const gchar *path;
+    GError *error = NULL;
+
+    if (capture_mode != CAPTURE_UNKNOWN)
+        return;
+
+    capture_mode = CAPTURE_OFF;
+
+    if ((path = g_getenv (SAMPLER_REPLAY_ENV)) != NULL)
+        sampler_replay_load (path, &error);
+    else if ((path = g_getenv (SAMPLER_RECORD_ENV)) != NULL)
+        sampler_record_start (path, &error);
+
+    if (error != NULL)
+    {
+        g_warning ("%s", error->message);
+        g_error_free (error);
+    }
+}
+
+gboolean
+sampler_record_start (const gchar  *path,
+                      GError      **error)
+{
+    record_file = g_fopen (path, "we");
+    if (record_file == NULL)
+    {
+        gint save_errno = errno;
+
+        capture_mode = CAPTURE_OFF;
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (save_errno),
+                     "Can not record the samples to %s: %s", path, g_strerror (save_errno));
+        return FALSE;
+    }
+
+    record_paths = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    record_start = g_get_monotonic_time ();
+    capture_mode = CAPTURE_RECORD;
+
+    return TRUE;
+}
+
+static ReplayStream *
+replay_stream_get (const gchar *path)
+{
+    ReplayStream *stream;
+    guint index;
+
+    index = GPOINTER_TO_UINT (g_hash_table_lookup (replay_index, path));
+    if (index != 0)
+        return g_ptr_array_index (replay_streams, index - 1);
+
+    stream = g_new0 (ReplayStream, 1);
+    stream->frames = g_array_new (FALSE, FALSE, sizeof (ReplayFrame));
+    g_ptr_array_add (replay_streams, stream);
+    g_hash_table_insert (replay_index, g_strdup (path),
+                         GUINT_TO_POINTER (replay_streams->len));
+
+    return stream;
+}
+
+gboolean
+sampler_replay_load (const gchar  *path,
+                     GError      **error)
+{
+    gchar *p, *end;
+    gsize length;
+
+    capture_mode = CAPTURE_OFF;
+
+    if (!g_file_get_contents (path, &replay_contents, &length, error))
+        return FALSE;
+
+    replay_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    replay_streams = g_ptr_array_new ();
+
+    /* "<microseconds> <length> <path>\n" and the contents, kept in place */
+    for (p = replay_contents, end = p + length; p < end; )
+    {
+        ReplayFrame frame;
+        gchar *eol;
+        guint64 size;
+
+        eol = memchr (p, '\n', (gsize) (end - p));
+        if (eol == NULL)
+            break;
+        *eol = '\0';
+
+        g_ascii_strtoull (p, &p, 10);
+        size = g_ascii_strtoull (p, &p, 10);
+        if (*p != ' ' || size > (guint64) (end - eol - 1))
+        {
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         "%s is not a capture of the samples", path);
+            return FALSE;
+        }
+
+        frame.data = eol + 1;
+        frame.length = (gsize) size;
+        g_array_append_val (replay_stream_get (p + 1)->frames, frame);
+
+        /* and the newline after the contents */
+        p = eol + 1 + size + 1;
+    }
+
+    capture_mode = CAPTURE_REPLAY;
+    g_debug ("Replaying %u files from %s", replay_streams->len, path);
+
+    return TRUE;
+}
+
+gboolean
+sampler_replay_exhausted (void)
+{
+    return replay_used_up;
+}
+
+gboolean
+sampler_replay_active (void)
+{
+    capture_from_environment ();
+
+    return capture_mode == CAPTURE_REPLAY;
+}
+
+gint
+sampler_replay_open (const gchar *path)
+{
+    guint index;
+
+    index = GPOINTER_TO_UINT (g_hash_table_lookup (replay_index, path));
+    if (index == 0)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    return SAMPLER_REPLAY_FD + (gint) index - 1;
+}
+
+const gchar *
+sampler_replay_read (gint   fd,
+                     gsize *length)
+{
+    ReplayStream *stream;
+    ReplayFrame *frame;
+
+    stream = g_ptr_array_index (replay_streams, fd - SAMPLER_REPLAY_FD);
+
+    /* the last contents repeat, so that counters stand still */
+    if (stream->next < stream->frames->len)
+        frame = &g_array_index (stream->frames, ReplayFrame, stream->next++);
+    else
+    {
+        frame = &g_array_index (stream->frames, ReplayFrame, stream->frames->len - 1);
+        replay_used_up = TRUE;
+    }
+
+    *length = frame->length;
+
+    return frame->data;
+}
+
+void
+sampler_record_open (gint         fd,
+                     const gchar *path)
+{
+    if (capture_mode != CAPTURE_RECORD || fd < 0)
+        return;
+
+    g_hash_table_insert (record_paths, GINT_TO_POINTER (fd), g_strdup (path));
+}
+
+void
+sampler_record_read (gint         fd,
+                     const gchar *data,
+                     gsize        length)
+{
+    const gchar *path;
+
+    if (capture_mode != CAPTURE_RECORD)
+        return;
+
+    path = g_hash_table_lookup (record_paths, GINT_TO_POINTER (fd));
+    if (path == NULL)
+        return;
+
+    fprintf (record_file, "%" G_GINT64_FORMAT " %" G_GSIZE_FORMAT " %s\n",
+             g_get_monotonic_time () - record_start, length, path);
+    fwrite (data, 1, length, record_file);
+    fputc ('\n', record_file);
+
+    /* an applet is not asked before it exits */
+    fflush (record_file);
+}
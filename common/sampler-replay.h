@@ -0,0 +1,48 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_REPLAY_H
+#define MATE_APPLETS_COMMON_SAMPLER_REPLAY_H
+
+#include <glib.h>
+
+/* Capture and replay of the files the collectors read through
+ * sampler-file.h, to reproduce benchmarks and bug reports.
+ *
+ * With MATE_APPLETS_SAMPLER_RECORD=FILE in the environment of an applet,
+ * every sampler_file_read() and sampler_pread() is appended to FILE with
+ * its time and path. With MATE_APPLETS_SAMPLER_REPLAY=FILE the reads
+ * return the recorded contents instead, each read of a path the next
+ * one recorded for it, and paths that were not recorded can not be
+ * opened. Once the reads of a path are used up the last one repeats, so
+ * the counters stop, and sampler_replay_exhausted() turns TRUE.
+ *
+ * The capture is a sequence of frames, a header line
+ * "<microseconds> <length> <path>" followed by length bytes and a
+ * newline. Directory scans, libgtop and netlink are not captured, so a
+ * replay finds the same devices only where they exist.
+ *
+ * Replayed files have descriptors from SAMPLER_REPLAY_FD on, which no
+ * process gets from the kernel; close() on them fails harmlessly. */
+#define SAMPLER_REPLAY_FD (1 << 30)
+
+/* For the bench, before the first read: the same as the environment */
+G_GNUC_INTERNAL gboolean     sampler_record_start     (const gchar  *path,
+                                                       GError      **error);
+G_GNUC_INTERNAL gboolean     sampler_replay_load      (const gchar  *path,
+                                                       GError      **error);
+G_GNUC_INTERNAL gboolean     sampler_replay_exhausted (void);
+
+/* For sampler-file.c, which asks sampler_replay_active() before every
+ * open. sampler_replay_open() fails with ENOENT for the paths that were
+ * not recorded, sampler_replay_read() returns the next contents of a
+ * replayed file, not NUL terminated. The record functions do nothing
+ * unless recording. */
+G_GNUC_INTERNAL gboolean     sampler_replay_active    (void);
+G_GNUC_INTERNAL gint         sampler_replay_open      (const gchar  *path);
+G_GNUC_INTERNAL const gchar *sampler_replay_read      (gint          fd,
+                                                       gsize        *length);
+G_GNUC_INTERNAL void         sampler_record_open      (gint          fd,
+                                                       const gchar  *path);
+G_GNUC_INTERNAL void         sampler_record_read      (gint          fd,
+                                                       const gchar  *data,
+                                                       gsize         length);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_REPLAY_H */
@@ -0,0 +1,74 @@
+/* Aligned periodic timeouts */
+#include <config.h>
+
+#include <glib.h>
+
+#include "sampler-tick.h"
+
+typedef struct
+{
+    GSource source;
+    gint64  interval;
+} SamplerTick;
+
+gint64
+sampler_tick_next (gint64 time,
+                   gint64 interval)
+{
+    return (time / interval + 1) * interval;
+}
+
+static gboolean
+sampler_tick_dispatch (GSource     *source,
+                       GSourceFunc  callback,
+                       gpointer     user_data)
+{
+    SamplerTick *tick = (SamplerTick *) source;
+
+    if (callback == NULL)
+        return G_SOURCE_REMOVE;
+
+    g_source_set_ready_time (source,
+                             sampler_tick_next (g_source_get_time (source),
+                                                tick->interval));
+
+    return callback (user_data);
+}
+
+static GSourceFuncs sampler_tick_funcs = {
+    NULL,
+    NULL,
+    sampler_tick_dispatch,
+    NULL,
+    NULL,
+    NULL
+};
+
+guint
+sampler_tick_add (guint       interval,
+                  GSourceFunc function,
+                  gpointer    data)
+{
+    GSource *source;
+    SamplerTick *tick;
+    guint id;
+
+    g_return_val_if_fail (interval > 0, 0);
+
+    if (interval % 1000 == 0)
+        return g_timeout_add_seconds (interval / 1000, function, data);
+
+    source = g_source_new (&sampler_tick_funcs, sizeof (SamplerTick));
+    tick = (SamplerTick *) source;
+    tick->interval = (gint64) interval * 1000;
+
+    g_source_set_name (source, "[mate-applets] sampler tick");
+    g_source_set_ready_time (source,
+                             sampler_tick_next (g_get_monotonic_time (),
+                                                tick->interval));
+    g_source_set_callback (source, function, data, NULL);
+    id = g_source_attach (source, NULL);
+    g_source_unref (source);
+
+    return id;
+}
@@ -0,0 +1,24 @@
+#ifndef MATE_APPLETS_COMMON_SAMPLER_TICK_H
+#define MATE_APPLETS_COMMON_SAMPLER_TICK_H
+
+#include <glib.h>
+
+/* Periodic timeouts for the samplers of the applets.
+ *
+ * Intervals of whole seconds use g_timeout_add_seconds(), which GLib
+ * aligns for the whole session. Shorter intervals fire on the multiples
+ * of the interval of the monotonic clock, so samplers with the same
+ * interval share their wakeups, even in different processes, and a late
+ * dispatch skips to the next tick instead of drifting.
+ *
+ * The callback returns G_SOURCE_CONTINUE or G_SOURCE_REMOVE, as for
+ * g_timeout_add(). */
+G_GNUC_INTERNAL guint  sampler_tick_add  (guint       interval,
+                                          GSourceFunc function,
+                                          gpointer    data);
+
+/* The next multiple of interval after time, both in microseconds */
+G_GNUC_INTERNAL gint64 sampler_tick_next (gint64      time,
+                                          gint64      interval);
+
+#endif /* MATE_APPLETS_COMMON_SAMPLER_TICK_H */
@@ -37,8 +37,13 @@
 #include "cpufreq-prefs.h"
 #include "cpufreq-popup.h"
 #include "cpufreq-monitor.h"
+#include "cpufreq-monitor-all.h"
+#include "cpufreq-monitor-aperf.h"
 #include "cpufreq-monitor-factory.h"
+#include "cpufreq-idle-monitor.h"
+#include "cpufreq-stats.h"
 #include "cpufreq-utils.h"
+#include "common/applet-probe.h"
 
 struct _CPUFreqApplet {
     MatePanelApplet        base;
@@ -50,19 +55,31 @@ struct _CPUFreqApplet {
     gboolean               show_perc;
     gboolean               show_unit;
     gboolean               show_icon;
+    gboolean               show_idle;
 
     CPUFreqMonitor        *monitor;
+    CPUFreqStats          *stats;
+    CPUFreqIdleMonitor    *idle_monitor;
 
     MatePanelAppletOrient  orient;
     gint                   size;
 
     GtkWidget             *box;
     GtkWidget             *icon;
+    GtkWidget             *bars;
     GtkWidget             *labels_box;
     GtkWidget             *label;
     GtkWidget             *unit_label;
 
+    /* the icons, rendered for surfaces_size and surfaces_scale */
     cairo_surface_t       *surfaces[5];
+    gint                   surfaces_size;
+    gint                   surfaces_scale;
+    gint                   image;
+
+    /* freq -> CPUFreqAppletLabels, at labels_decimal_places */
+    GHashTable            *labels;
+    guint                  labels_decimal_places;
 
     gboolean               need_refresh;
 
@@ -74,6 +91,22 @@ struct _CPUFreqAppletClass {
         MatePanelAppletClass parent_class;
 };
 
+typedef struct {
+    gchar *label;   /* at the decimal places of the monitor */
+    gchar *tooltip; /* at MAX_DECIMAL_PLACES */
+    gchar *unit;
+} CPUFreqAppletLabels;
+
+/* Only a handful of frequencies are seen with the cpufreq
+ * monitors, but the effective frequency takes any value
+ */
+#define CPUFREQ_LABELS_MAX 64
+
+#define CPUFREQ_ICON_SIZE  24
+
+/* The width of a full bar of residency in the tooltip */
+#define CPUFREQ_STATS_BAR_WIDTH 10
+
 static void     cpufreq_applet_preferences_cb    (GtkAction             *action,
                                                   CPUFreqApplet         *applet);
 static void     cpufreq_applet_help_cb           (GtkAction             *action,
@@ -83,6 +116,11 @@ static void     cpufreq_applet_about_cb          (GtkAction             *action,
 
 static void     cpufreq_applet_pixmap_set_image  (CPUFreqApplet         *applet,
                                                   gint                   perc);
+static void     cpufreq_applet_render_icons      (CPUFreqApplet         *applet);
+static void     cpufreq_applet_labels_free       (CPUFreqAppletLabels   *labels);
+static gboolean cpufreq_applet_bars_draw         (GtkWidget             *bars,
+                                                  cairo_t               *cr,
+                                                  CPUFreqApplet         *applet);
 
 static void     cpufreq_applet_setup             (CPUFreqApplet         *applet);
 static void     cpufreq_applet_update            (CPUFreqApplet         *applet,
@@ -137,6 +175,7 @@ cpufreq_applet_show_mode_get_type (void)
             { CPUFREQ_MODE_GRAPHIC, "CPUFREQ_MODE_GRAPHIC", "mode-graphic" },
             { CPUFREQ_MODE_TEXT,    "CPUFREQ_MODE_TEXT",    "mode-text" },
             { CPUFREQ_MODE_BOTH,    "CPUFREQ_MODE_BOTH",    "mode-both" },
+            { CPUFREQ_MODE_IDLE,    "CPUFREQ_MODE_IDLE",    "mode-idle" },
             { 0, NULL, NULL }
         };
 
@@ -175,6 +214,10 @@ cpufreq_applet_init (CPUFreqApplet *applet)
     applet->show_mode = CPUFREQ_MODE_BOTH;
     applet->show_text_mode = CPUFREQ_MODE_TEXT_FREQUENCY_UNIT;
 
+    applet->image = -1;
+    applet->labels = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                            (GDestroyNotify) cpufreq_applet_labels_free);
+
     applet->need_refresh = TRUE;
 
     mate_panel_applet_set_flags (MATE_PANEL_APPLET (applet), MATE_PANEL_APPLET_EXPAND_MINOR);
@@ -200,6 +243,16 @@ cpufreq_applet_init (CPUFreqApplet *applet)
 
     applet->icon = gtk_image_new ();
     gtk_box_pack_start (GTK_BOX (applet->box), applet->icon, FALSE, FALSE, 0);
+    g_signal_connect_swapped (applet->icon, "notify::scale-factor",
+                              G_CALLBACK (cpufreq_applet_render_icons),
+                              applet);
+
+    /* Replaces the icon while all cpus are monitored */
+    applet->bars = gtk_drawing_area_new ();
+    gtk_box_pack_start (GTK_BOX (applet->box), applet->bars, FALSE, FALSE, 0);
+    g_signal_connect (applet->bars, "draw",
+                      G_CALLBACK (cpufreq_applet_bars_draw),
+                      applet);
 
     applet->labels_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 2);
     gtk_box_pack_start (GTK_BOX (applet->box), applet->labels_box, FALSE, FALSE, 0);
@@ -244,13 +297,27 @@ cpufreq_applet_dispose (GObject *widget)
         applet->monitor = NULL;
     }
 
-    for (i = 0; i <= 3; i++) {
+    cpufreq_stats_free (applet->stats);
+    applet->stats = NULL;
+
+    if (applet->idle_monitor) {
+        g_signal_handlers_disconnect_by_data (applet->idle_monitor, applet);
+        g_object_unref (applet->idle_monitor);
+        applet->idle_monitor = NULL;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (applet->surfaces); i++) {
          if (applet->surfaces[i]) {
              cairo_surface_destroy (applet->surfaces[i]);
              applet->surfaces[i] = NULL;
          }
     }
 
+    if (applet->labels) {
+        g_hash_table_destroy (applet->labels);
+        applet->labels = NULL;
+    }
+
     if (applet->prefs) {
         g_object_unref (applet->prefs);
         applet->prefs = NULL;
@@ -286,6 +353,8 @@ cpufreq_applet_size_allocate (GtkWidget     *widget,
 
     if (size != applet->size) {
         applet->size = size;
+        if (applet->surfaces_size)
+            cpufreq_applet_render_icons (applet);
         cpufreq_applet_refresh (applet);
     }
 
@@ -405,6 +474,8 @@ cpufreq_applet_change_orient (MatePanelApplet       *pa,
 
     if (size != applet->size) {
         applet->size = size;
+        if (applet->surfaces_size)
+            cpufreq_applet_render_icons (applet);
         cpufreq_applet_refresh (applet);
     }
 }
@@ -489,13 +560,68 @@ cpufreq_applet_about_cb (GtkAction     *action,
                             NULL);
 }
 
+/* The icons as large as the panel allows, up to their own size */
+static gint
+cpufreq_applet_get_icon_size (CPUFreqApplet *applet)
+{
+    if (applet->size <= 0)
+        return CPUFREQ_ICON_SIZE;
+
+    return MIN (applet->size, CPUFREQ_ICON_SIZE);
+}
+
+/* Renders all the icons at once, for the current size and scale */
+static void
+cpufreq_applet_render_icons (CPUFreqApplet *applet)
+{
+    static AppletProbe *probe = NULL;
+    gint64 start;
+    gint  size;
+    gint  scale;
+    guint i;
+
+    size = cpufreq_applet_get_icon_size (applet);
+    scale = gtk_widget_get_scale_factor (applet->icon);
+
+    if (size == applet->surfaces_size && scale == applet->surfaces_scale)
+        return;
+
+    start = applet_probe_begin (&probe, "cpufreq:render_icons");
+
+    for (i = 0; i < G_N_ELEMENTS (applet->surfaces); i++) {
+        GdkPixbuf *pixbuf;
+
+        if (applet->surfaces[i]) {
+            cairo_surface_destroy (applet->surfaces[i]);
+            applet->surfaces[i] = NULL;
+        }
+
+        pixbuf = gdk_pixbuf_new_from_file_at_scale (cpufreq_icons[i],
+                                                    size * scale,
+                                                    size * scale,
+                                                    TRUE,
+                                                    NULL);
+        if (!pixbuf)
+            continue;
+
+        applet->surfaces[i] = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
+        g_object_unref (pixbuf);
+    }
+
+    applet->surfaces_size = size;
+    applet->surfaces_scale = scale;
+
+    if (applet->image >= 0)
+        gtk_image_set_from_surface (GTK_IMAGE (applet->icon), applet->surfaces[applet->image]);
+
+    applet_probe_end (probe, start);
+}
+
 static void
 cpufreq_applet_pixmap_set_image (CPUFreqApplet *applet,
                                  gint           perc)
 {
     gint image;
-    gint scale;
-    gint size = 24; /* FIXME */
 
     /* 0-29   -> 25%
      * 30-69  -> 50%
@@ -513,20 +639,245 @@ cpufreq_applet_pixmap_set_image (CPUFreqApplet *applet,
     else
         image = 4;
 
-    scale = gtk_widget_get_scale_factor (GTK_WIDGET (applet->icon));
+    if (!applet->surfaces_size)
+        cpufreq_applet_render_icons (applet);
 
-    if (applet->surfaces[image] == NULL) {
-        GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file_at_scale (cpufreq_icons[image],
-                                                               size * scale,
-                                                               size * scale,
-                                                               TRUE,
-                                                               NULL);
-        applet->surfaces[image] = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
-    }
+    if (image == applet->image)
+        return;
 
+    applet->image = image;
     gtk_image_set_from_surface (GTK_IMAGE (applet->icon), applet->surfaces[image]);
 }
 
+/* One bar per cpufreq policy, filled up to its share of
+ * the max frequency, in about the size of the icon
+ */
+#define CPUFREQ_BARS_SIZE    24
+#define CPUFREQ_BARS_SPACING 1
+
+static gint
+cpufreq_applet_bars_get_bar_width (guint n_policies)
+{
+    return CLAMP (CPUFREQ_BARS_SIZE / (gint) MAX (n_policies, 1) - CPUFREQ_BARS_SPACING, 2, 6);
+}
+
+static void
+cpufreq_applet_bars_update_size (CPUFreqApplet *applet)
+{
+    guint n_policies;
+    gint  width;
+
+    n_policies = cpufreq_monitor_all_get_n_policies (CPUFREQ_MONITOR_ALL (applet->monitor));
+    width = cpufreq_applet_bars_get_bar_width (n_policies);
+
+    gtk_widget_set_size_request (applet->bars,
+                                 n_policies * (width + CPUFREQ_BARS_SPACING) - CPUFREQ_BARS_SPACING,
+                                 CPUFREQ_BARS_SIZE);
+}
+
+static gboolean
+cpufreq_applet_bars_draw (GtkWidget     *bars,
+                          cairo_t       *cr,
+                          CPUFreqApplet *applet)
+{
+    static AppletProbe *probe = NULL;
+    gint64             start;
+    CPUFreqMonitorAll *monitor;
+    GtkStyleContext   *context;
+    GdkRGBA            color;
+    guint              n_policies, i;
+    gint               width, height;
+
+    if (!CPUFREQ_IS_MONITOR_ALL (applet->monitor))
+        return FALSE;
+
+    start = applet_probe_begin (&probe, "cpufreq:bars_draw");
+
+    monitor = CPUFREQ_MONITOR_ALL (applet->monitor);
+    n_policies = cpufreq_monitor_all_get_n_policies (monitor);
+    width = cpufreq_applet_bars_get_bar_width (n_policies);
+    height = gtk_widget_get_allocated_height (bars);
+
+    context = gtk_widget_get_style_context (bars);
+    gtk_style_context_get_color (context, gtk_style_context_get_state (context), &color);
+
+    for (i = 0; i < n_policies; i++) {
+        const CPUFreqPolicy *policy = cpufreq_monitor_all_get_policy (monitor, i);
+        gdouble              x = i * (width + CPUFREQ_BARS_SPACING);
+
+        cairo_set_source_rgba (cr, color.red, color.green, color.blue, color.alpha * 0.25);
+        cairo_rectangle (cr, x, 0, width, height);
+        cairo_fill (cr);
+
+        if (policy->online && policy->max_frequency > 0) {
+            gdouble fill;
+
+            fill = height * CLAMP ((gdouble) policy->frequency / policy->max_frequency, 0.0, 1.0);
+            cairo_set_source_rgba (cr, color.red, color.green, color.blue, color.alpha);
+            cairo_rectangle (cr, x, height - fill, width, fill);
+            cairo_fill (cr);
+        }
+    }
+
+    applet_probe_end (probe, start);
+    return FALSE;
+}
+
+static void
+cpufreq_applet_update_graphic_visibility (CPUFreqApplet *applet)
+{
+    gboolean all_cpus = CPUFREQ_IS_MONITOR_ALL (applet->monitor);
+
+    if (all_cpus)
+        cpufreq_applet_bars_update_size (applet);
+
+    gtk_widget_set_visible (applet->icon, applet->show_icon && !all_cpus);
+    gtk_widget_set_visible (applet->bars, applet->show_icon && all_cpus);
+}
+
+/* The graphic of an applet of size without the panel, for
+ * cpufreq-bench: the bars with a monitor of all cpus, the icon
+ * otherwise. The applet takes monitor and must not be finalized.
+ */
+CPUFreqApplet *
+cpufreq_applet_bench_new (gint            size,
+                          CPUFreqMonitor *monitor)
+{
+    CPUFreqApplet *applet;
+
+    applet = g_object_ref_sink (g_object_new (CPUFREQ_TYPE_APPLET, NULL));
+    applet->size = size;
+    applet->show_icon = TRUE;
+    applet->monitor = monitor;
+
+    gtk_widget_hide (applet->labels_box);
+    cpufreq_applet_update_graphic_visibility (applet);
+
+    return applet;
+}
+
+/* Taken off the applet, with a reference for the caller */
+GtkWidget *
+cpufreq_applet_bench_get_graphic (CPUFreqApplet *applet)
+{
+    GtkWidget *box = g_object_ref (applet->box);
+
+    gtk_container_remove (GTK_CONTAINER (applet), box);
+
+    return box;
+}
+
+void
+cpufreq_applet_bench_set_percentage (CPUFreqApplet *applet,
+                                     gint           perc)
+{
+    cpufreq_applet_pixmap_set_image (applet, perc);
+}
+
+/* Renders the icons again, as after a change of the panel size */
+void
+cpufreq_applet_bench_render_icons (CPUFreqApplet *applet)
+{
+    applet->surfaces_size = 0;
+    cpufreq_applet_render_icons (applet);
+}
+
+/* The share of the time in the deepest idle state on the panel,
+ * and of every state in the tooltip
+ */
+static void
+cpufreq_applet_idle_update (CPUFreqApplet *applet)
+{
+    const CPUFreqIdleState *deepest;
+    GString                *text;
+    GtkRequisition          req;
+    gdouble                 idle = 0;
+    gchar                  *perc;
+    guint                   n_states;
+    guint                   i;
+
+    if (!applet->idle_monitor) {
+        gtk_label_set_text (GTK_LABEL (applet->label), "---");
+        gtk_label_set_text (GTK_LABEL (applet->unit_label), "");
+        gtk_widget_set_tooltip_text (GTK_WIDGET (applet), _("No CPU idle states"));
+
+        return;
+    }
+
+    n_states = cpufreq_idle_monitor_get_n_states (applet->idle_monitor);
+    deepest = cpufreq_idle_monitor_get_state (applet->idle_monitor, n_states - 1);
+
+    perc = g_strdup_printf ("%d%%", (gint) (deepest->residency * 100 + 0.5));
+    gtk_label_set_text (GTK_LABEL (applet->label), perc);
+    g_free (perc);
+    gtk_label_set_text (GTK_LABEL (applet->unit_label), deepest->name);
+
+    /* Hold the largest size, as with the frequencies */
+    gtk_widget_get_preferred_size (GTK_WIDGET (applet->label), &req, NULL);
+    gtk_widget_set_size_request (GTK_WIDGET (applet->label), req.width, req.height);
+
+    text = g_string_new (NULL);
+    if (cpufreq_prefs_get_all_cpus (applet->prefs))
+        g_string_append (text, _("Idle states of all CPUs"));
+    else
+        g_string_printf (text, _("Idle states of CPU %u"),
+                         cpufreq_prefs_get_cpu (applet->prefs));
+
+    for (i = 0; i < n_states; i++) {
+        const CPUFreqIdleState *state = cpufreq_idle_monitor_get_state (applet->idle_monitor, i);
+
+        g_string_append_printf (text, "\n%s %d%%", state->name,
+                                (gint) (state->residency * 100 + 0.5));
+        idle += state->residency;
+    }
+
+    g_string_append_c (text, '\n');
+    g_string_append_printf (text, _("Running %d%%"),
+                            (gint) (MAX (1.0 - idle, 0.0) * 100 + 0.5));
+
+    gtk_widget_set_tooltip_text (GTK_WIDGET (applet), text->str);
+    g_string_free (text, TRUE);
+
+    if (applet->need_refresh) {
+        cpufreq_applet_refresh (applet);
+        applet->need_refresh = FALSE;
+    }
+}
+
+/* The idle monitor only runs while its show mode is chosen */
+static void
+cpufreq_applet_create_idle_monitor (CPUFreqApplet *applet)
+{
+    if (applet->idle_monitor) {
+        g_signal_handlers_disconnect_by_data (applet->idle_monitor, applet);
+        g_object_unref (applet->idle_monitor);
+        applet->idle_monitor = NULL;
+    }
+
+    if (!applet->show_idle)
+        return;
+
+    if (cpufreq_prefs_get_all_cpus (applet->prefs))
+        applet->idle_monitor = cpufreq_idle_monitor_new_all ();
+    else
+        applet->idle_monitor = cpufreq_idle_monitor_new (cpufreq_prefs_get_cpu (applet->prefs));
+
+    if (applet->idle_monitor) {
+        cpufreq_idle_monitor_set_interval (applet->idle_monitor,
+                                           cpufreq_prefs_get_interval (applet->prefs));
+        g_signal_connect_swapped (applet->idle_monitor, "changed",
+                                  G_CALLBACK (cpufreq_applet_idle_update),
+                                  applet);
+        cpufreq_idle_monitor_run (applet->idle_monitor);
+    }
+
+    /* Reset label sizes held to the widest text of the old mode */
+    gtk_widget_set_size_request (GTK_WIDGET (applet->label), 0, 0);
+    gtk_widget_set_size_request (GTK_WIDGET (applet->unit_label), 0, 0);
+
+    cpufreq_applet_idle_update (applet);
+}
+
 static gboolean
 refresh_cb (CPUFreqApplet *applet)
 {
@@ -544,13 +895,16 @@ cpufreq_applet_update_visibility (CPUFreqApplet *applet)
     gboolean            show_perc = FALSE;
     gboolean            show_unit = FALSE;
     gboolean            show_icon = FALSE;
+    gboolean            show_idle = FALSE;
     gboolean            changed = FALSE;
     gboolean            need_update = FALSE;
 
     show_mode = cpufreq_prefs_get_show_mode (applet->prefs);
     show_text_mode = cpufreq_prefs_get_show_text_mode (applet->prefs);
 
-    if (show_mode != CPUFREQ_MODE_GRAPHIC) {
+    if (show_mode == CPUFREQ_MODE_IDLE) {
+        show_idle = TRUE;
+    } else if (show_mode != CPUFREQ_MODE_GRAPHIC) {
         show_icon = (show_mode == CPUFREQ_MODE_BOTH);
 
         switch (show_text_mode) {
@@ -589,19 +943,27 @@ cpufreq_applet_update_visibility (CPUFreqApplet *applet)
         changed = TRUE;
     }
 
+    if (show_idle != applet->show_idle) {
+        applet->show_idle = show_idle;
+        changed = TRUE;
+        need_update = TRUE;
+
+        cpufreq_applet_create_idle_monitor (applet);
+    }
+
     if (changed) {
         g_object_set (G_OBJECT (applet->label),
                       "visible",
-                      applet->show_freq || applet->show_perc,
+                      applet->show_freq || applet->show_perc || applet->show_idle,
                       NULL);
     }
 
-    if (show_unit != applet->show_unit) {
+    if (show_unit != applet->show_unit || changed) {
         applet->show_unit = show_unit;
         changed = TRUE;
 
         g_object_set (G_OBJECT (applet->unit_label),
-                      "visible", applet->show_unit,
+                      "visible", applet->show_unit || applet->show_idle,
                       NULL);
     }
 
@@ -609,9 +971,7 @@ cpufreq_applet_update_visibility (CPUFreqApplet *applet)
         applet->show_icon = show_icon;
         changed = TRUE;
 
-        g_object_set (G_OBJECT (applet->icon),
-                      "visible", applet->show_icon,
-                      NULL);
+        cpufreq_applet_update_graphic_visibility (applet);
     }
 
     if (changed)
@@ -621,12 +981,157 @@ cpufreq_applet_update_visibility (CPUFreqApplet *applet)
         cpufreq_applet_update (applet, applet->monitor);
 }
 
+static void
+cpufreq_applet_labels_free (CPUFreqAppletLabels *labels)
+{
+    g_free (labels->label);
+    g_free (labels->tooltip);
+    g_free (labels->unit);
+    g_free (labels);
+}
+
+/* The texts of a frequency, built once per frequency */
+static const CPUFreqAppletLabels *
+cpufreq_applet_get_labels (CPUFreqApplet *applet,
+                           gint           freq,
+                           guint          decimal_places)
+{
+    CPUFreqAppletLabels *labels;
+
+    if (decimal_places != applet->labels_decimal_places) {
+        g_hash_table_remove_all (applet->labels);
+        applet->labels_decimal_places = decimal_places;
+    }
+
+    labels = g_hash_table_lookup (applet->labels, GINT_TO_POINTER (freq));
+    if (labels)
+        return labels;
+
+    if (g_hash_table_size (applet->labels) >= CPUFREQ_LABELS_MAX)
+        g_hash_table_remove_all (applet->labels);
+
+    labels = g_new (CPUFreqAppletLabels, 1);
+    labels->label = cpufreq_utils_get_frequency_label (freq, decimal_places);
+    labels->tooltip = cpufreq_utils_get_frequency_label (freq, MAX_DECIMAL_PLACES);
+    labels->unit = cpufreq_utils_get_frequency_unit (freq);
+    g_hash_table_insert (applet->labels, GINT_TO_POINTER (freq), labels);
+
+    return labels;
+}
+
+static gchar *
+cpufreq_applet_format_frequency (CPUFreqApplet *applet,
+                                 gint           freq)
+{
+    const CPUFreqAppletLabels *labels;
+
+    labels = cpufreq_applet_get_labels (applet, freq,
+                                        cpufreq_monitor_get_decimal_places (applet->monitor));
+
+    return g_strdup_printf ("%s %s", labels->tooltip, labels->unit);
+}
+
+/* The governor, the range over all cpus and a line per policy */
+static gchar *
+cpufreq_applet_get_all_cpus_text (CPUFreqApplet     *applet,
+                                  CPUFreqMonitorAll *monitor)
+{
+    GString     *text;
+    const gchar *governor;
+    gchar       *min_text, *avg_text, *max_text;
+    gint         min, avg, max;
+    guint        i;
+
+    text = g_string_new (_("All CPUs"));
+
+    governor = cpufreq_monitor_get_governor (CPUFREQ_MONITOR (monitor));
+    if (governor) {
+        g_string_append (text, " - ");
+        g_string_append_c (text, g_ascii_toupper (governor[0]));
+        g_string_append (text, governor + 1);
+    }
+
+    cpufreq_monitor_all_get_range (monitor, &min, &avg, &max);
+    min_text = cpufreq_applet_format_frequency (applet, min);
+    avg_text = cpufreq_applet_format_frequency (applet, avg);
+    max_text = cpufreq_applet_format_frequency (applet, max);
+    g_string_append_c (text, '\n');
+    g_string_append_printf (text, _("Min %s, Avg %s, Max %s"),
+                            min_text, avg_text, max_text);
+    g_free (min_text);
+    g_free (avg_text);
+    g_free (max_text);
+
+    for (i = 0; i < cpufreq_monitor_all_get_n_policies (monitor); i++) {
+        const CPUFreqPolicy *policy = cpufreq_monitor_all_get_policy (monitor, i);
+
+        g_string_append_printf (text, "\nCPU %s: ", policy->cpus);
+
+        if (policy->online) {
+            gchar *freq_text = cpufreq_applet_format_frequency (applet, policy->frequency);
+
+            g_string_append (text, freq_text);
+            g_free (freq_text);
+        } else {
+            g_string_append (text, _("offline"));
+        }
+    }
+
+    return g_string_free (text, FALSE);
+}
+
+/* A bar per frequency for its share of the time since the
+ * stats were created, and how often the frequency changes
+ */
+static void
+cpufreq_applet_append_stats_text (CPUFreqApplet *applet,
+                                  GString       *text)
+{
+    guint64 total;
+    guint   decimal_places;
+    guint   i;
+
+    if (!applet->stats)
+        return;
+
+    if (!cpufreq_stats_update (applet->stats))
+        return;
+
+    total = cpufreq_stats_get_total_time (applet->stats);
+    if (total == 0)
+        return;
+
+    decimal_places = cpufreq_monitor_get_decimal_places (applet->monitor);
+
+    g_string_append_c (text, '\n');
+    for (i = 0; i < cpufreq_stats_get_n_states (applet->stats); i++) {
+        const CPUFreqStatsState   *state = cpufreq_stats_get_state (applet->stats, i);
+        const CPUFreqAppletLabels *labels;
+        guint                      perc;
+        guint                      width;
+
+        perc = (guint) (state->time * 100 / total);
+        if (perc == 0)
+            continue;
+
+        labels = cpufreq_applet_get_labels (applet, state->frequency, decimal_places);
+        g_string_append_printf (text, "\n%s %s ", labels->tooltip, labels->unit);
+        for (width = MAX ((perc * CPUFREQ_STATS_BAR_WIDTH + 50) / 100, 1); width > 0; width--)
+            g_string_append (text, "\u2588"); /* a full block */
+        g_string_append_printf (text, " %u%%", perc);
+    }
+
+    g_string_append_c (text, '\n');
+    g_string_append_printf (text, _("%.1f frequency changes per second"),
+                            cpufreq_stats_get_transition_rate (applet->stats));
+}
+
 static void
 cpufreq_applet_update (CPUFreqApplet  *applet,
                        CPUFreqMonitor *monitor)
 {
    gchar          *text_mode = NULL;
-   gchar          *freq_label, *unit_label;
+   const CPUFreqAppletLabels *labels;
    gint            freq;
    gint            perc;
    guint           cpu;
@@ -634,21 +1139,24 @@ cpufreq_applet_update (CPUFreqApplet  *applet,
    GtkRequisition  req;
    const gchar    *governor;
 
+   /* The labels and the tooltip are those of the idle states */
+   if (applet->show_idle)
+       return;
+
    cpu = cpufreq_monitor_get_cpu (monitor);
    freq = cpufreq_monitor_get_frequency (monitor);
    perc = cpufreq_monitor_get_percentage (monitor);
    governor = cpufreq_monitor_get_governor (monitor);
    decimal_places = cpufreq_monitor_get_decimal_places (monitor);
-   freq_label = cpufreq_utils_get_frequency_label (freq, decimal_places);
-   unit_label = cpufreq_utils_get_frequency_unit (freq);
+   labels = cpufreq_applet_get_labels (applet, freq, decimal_places);
 
    if (applet->show_freq) {
        /* Force the label to render if frequencies are not found right away */
-       if (freq_label == NULL) {
+       if (labels->label == NULL) {
            gtk_label_set_text (GTK_LABEL (applet->label),"---");
        }
         else {
-           gtk_label_set_text (GTK_LABEL (applet->label), freq_label);
+           gtk_label_set_text (GTK_LABEL (applet->label), labels->label);
         }
         /*Hold the largest size set by any jumping text */
         gtk_widget_get_preferred_size (GTK_WIDGET (applet->label),&req, NULL);
@@ -664,31 +1172,37 @@ cpufreq_applet_update (CPUFreqApplet  *applet,
     }
 
     if (applet->show_unit) {
-        gtk_label_set_text (GTK_LABEL (applet->unit_label), unit_label);
+        gtk_label_set_text (GTK_LABEL (applet->unit_label), labels->unit);
         /* Hold the largest size set by MHZ or GHZ to prevent jumping */
         gtk_widget_get_preferred_size (GTK_WIDGET (applet->unit_label),&req, NULL);
         gtk_widget_set_size_request (GTK_WIDGET (applet->unit_label),req.width, req.height);
     }
 
     if (applet->show_icon) {
-        cpufreq_applet_pixmap_set_image (applet, perc);
+        if (CPUFREQ_IS_MONITOR_ALL (monitor))
+            gtk_widget_queue_draw (applet->bars);
+        else
+            cpufreq_applet_pixmap_set_image (applet, perc);
     }
 
-    if (governor) {
-        gchar *gov_text;
-
-        gov_text = g_strdup (governor);
-        gov_text[0] = g_ascii_toupper (gov_text[0]);
-        freq_label = cpufreq_utils_get_frequency_label (freq, MAX_DECIMAL_PLACES); // show max decimals in tooltip
-        text_mode = g_strdup_printf ("%s\n%s %s (%d%%)",
-                                     gov_text, freq_label,
-                                     unit_label, perc);
-        g_free (gov_text);
+    if (CPUFREQ_IS_MONITOR_ALL (monitor)) {
+        gchar *all_text;
+
+        all_text = cpufreq_applet_get_all_cpus_text (applet, CPUFREQ_MONITOR_ALL (monitor));
+        gtk_widget_set_tooltip_text (GTK_WIDGET (applet), all_text);
+        g_free (all_text);
+    } else if (governor) {
+        GString *mode;
+
+        mode = g_string_new (governor);
+        mode->str[0] = g_ascii_toupper (mode->str[0]);
+        /* show max decimals in tooltip */
+        g_string_append_printf (mode, "\n%s %s (%d%%)",
+                                labels->tooltip, labels->unit, perc);
+        cpufreq_applet_append_stats_text (applet, mode);
+        text_mode = g_string_free (mode, FALSE);
     }
 
-    g_free (freq_label);
-    g_free (unit_label);
-
     if (text_mode) {
         gchar *text_tip;
 
@@ -730,7 +1244,9 @@ cpufreq_applet_refresh (CPUFreqApplet *applet)
     gtk_widget_get_preferred_width (GTK_WIDGET (applet->unit_label), &unit_label_size, NULL);
     total_size += unit_label_size;
 
-    gtk_widget_get_preferred_width (GTK_WIDGET (applet->icon), &pixmap_size, NULL);
+    gtk_widget_get_preferred_width (CPUFREQ_IS_MONITOR_ALL (applet->monitor) ?
+                                    applet->bars : applet->icon,
+                                    &pixmap_size, NULL);
     total_size += pixmap_size;
 
     if (horizontal) {
@@ -770,8 +1286,97 @@ cpufreq_applet_prefs_cpu_changed (CPUFreqPrefs  *prefs,
                                   GParamSpec    *arg1,
                                   CPUFreqApplet *applet)
 {
+    if (CPUFREQ_IS_MONITOR_ALL (applet->monitor))
+        return;
+
+    cpufreq_stats_free (applet->stats);
+    applet->stats = cpufreq_stats_new (cpufreq_prefs_get_cpu (applet->prefs));
+
     cpufreq_monitor_set_cpu (applet->monitor,
                              cpufreq_prefs_get_cpu (applet->prefs));
+
+    if (applet->show_idle)
+        cpufreq_applet_create_idle_monitor (applet);
+}
+
+static void
+cpufreq_applet_create_monitor (CPUFreqApplet *applet)
+{
+    CPUFreqMonitor *monitor = NULL;
+
+    if (cpufreq_prefs_get_all_cpus (applet->prefs))
+        monitor = cpufreq_monitor_factory_create_all_monitor ();
+    else if (cpufreq_prefs_get_effective_frequency (applet->prefs))
+        monitor = cpufreq_monitor_factory_create_effective_monitor (cpufreq_prefs_get_cpu (applet->prefs));
+
+    /* Without cpufreq policies or counters, the
+     * frequency of one cpu is read from cpufreq
+     */
+    if (!monitor)
+        monitor = cpufreq_monitor_factory_create_monitor (cpufreq_prefs_get_cpu (applet->prefs));
+
+    if (applet->monitor) {
+        g_signal_handlers_disconnect_by_data (applet->monitor, applet);
+        g_object_unref (applet->monitor);
+    }
+    applet->monitor = monitor;
+
+    /* The stats are those of the policy of the monitored cpu */
+    cpufreq_stats_free (applet->stats);
+    applet->stats = CPUFREQ_IS_MONITOR_ALL (monitor) ?
+        NULL : cpufreq_stats_new (cpufreq_monitor_get_cpu (monitor));
+
+    cpufreq_monitor_set_decimal_places (applet->monitor,
+                                        cpufreq_prefs_get_decimal_places (applet->prefs));
+    cpufreq_monitor_set_interval (applet->monitor,
+                                  cpufreq_prefs_get_interval (applet->prefs));
+    cpufreq_monitor_run (applet->monitor);
+
+    g_signal_connect_swapped (applet->monitor, "changed",
+                              G_CALLBACK (cpufreq_applet_update),
+                              applet);
+
+    if (applet->popup)
+        cpufreq_popup_set_monitor (applet->popup, applet->monitor);
+
+    cpufreq_applet_update_graphic_visibility (applet);
+
+    /* The idle states follow the cpus monitored */
+    if (applet->show_idle)
+        cpufreq_applet_create_idle_monitor (applet);
+}
+
+static void
+cpufreq_applet_prefs_interval_changed (CPUFreqPrefs  *prefs,
+                                       GParamSpec    *arg1,
+                                       CPUFreqApplet *applet)
+{
+    cpufreq_monitor_set_interval (applet->monitor,
+                                  cpufreq_prefs_get_interval (applet->prefs));
+
+    if (applet->idle_monitor)
+        cpufreq_idle_monitor_set_interval (applet->idle_monitor,
+                                           cpufreq_prefs_get_interval (applet->prefs));
+}
+
+static void
+cpufreq_applet_prefs_monitor_changed (CPUFreqPrefs  *prefs,
+                                       GParamSpec    *arg1,
+                                       CPUFreqApplet *applet)
+{
+    gboolean all_cpus = cpufreq_prefs_get_all_cpus (applet->prefs);
+
+    if (all_cpus == CPUFREQ_IS_MONITOR_ALL (applet->monitor) &&
+        (all_cpus || cpufreq_prefs_get_effective_frequency (applet->prefs) ==
+                     CPUFREQ_IS_MONITOR_APERF (applet->monitor)))
+        return;
+
+    cpufreq_applet_create_monitor (applet);
+
+    applet->need_refresh = TRUE;
+    /* Reset label sizes held to the widest text of the old monitor */
+    gtk_widget_set_size_request (GTK_WIDGET (applet->label), 0, 0);
+    gtk_widget_set_size_request (GTK_WIDGET (applet->unit_label), 0, 0);
 }
 
 static void
@@ -815,6 +1420,18 @@ cpufreq_applet_setup (CPUFreqApplet *applet)
                       G_CALLBACK (cpufreq_applet_prefs_cpu_changed),
                       applet);
 
+    g_signal_connect (applet->prefs, "notify::all-cpus",
+                      G_CALLBACK (cpufreq_applet_prefs_monitor_changed),
+                      applet);
+
+    g_signal_connect (applet->prefs, "notify::effective-frequency",
+                      G_CALLBACK (cpufreq_applet_prefs_monitor_changed),
+                      applet);
+
+    g_signal_connect (applet->prefs, "notify::interval",
+                      G_CALLBACK (cpufreq_applet_prefs_interval_changed),
+                      applet);
+
     g_signal_connect (applet->prefs, "notify::show-mode",
                       G_CALLBACK (cpufreq_applet_prefs_show_mode_changed),
                       applet);
@@ -828,16 +1445,7 @@ cpufreq_applet_setup (CPUFreqApplet *applet)
                       applet);
 
     /* Monitor */
-    applet->monitor =
-        cpufreq_monitor_factory_create_monitor (cpufreq_prefs_get_cpu (applet->prefs));
-
-    cpufreq_monitor_set_decimal_places (applet->monitor,
-                                        cpufreq_prefs_get_decimal_places (applet->prefs));
-    cpufreq_monitor_run (applet->monitor);
-
-    g_signal_connect_swapped (applet->monitor, "changed",
-                              G_CALLBACK (cpufreq_applet_update),
-                              applet);
+    cpufreq_applet_create_monitor (applet);
 
     /* Setup the menus */
     action_group = gtk_action_group_new ("CPUFreq Applet Actions");
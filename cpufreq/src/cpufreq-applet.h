@@ -23,6 +23,9 @@
 #define CPUFREQ_APPLET_H
 
 #include <glib-object.h>
+#include <gtk/gtk.h>
+
+#include "cpufreq-monitor.h"
 
 G_BEGIN_DECLS
 
@@ -42,7 +45,8 @@ typedef struct _CPUFreqAppletClass CPUFreqAppletClass;
 typedef enum {
     CPUFREQ_MODE_GRAPHIC,
     CPUFREQ_MODE_TEXT,
-    CPUFREQ_MODE_BOTH
+    CPUFREQ_MODE_BOTH,
+    CPUFREQ_MODE_IDLE
 } CPUFreqShowMode;
 
 typedef enum {
@@ -56,6 +60,14 @@ GType    cpufreq_applet_get_type                (void) G_GNUC_CONST;
 GType    cpufreq_applet_show_mode_get_type      (void) G_GNUC_CONST;
 GType    cpufreq_applet_show_text_mode_get_type (void) G_GNUC_CONST;
 
+/* For cpufreq-bench */
+G_GNUC_INTERNAL CPUFreqApplet *cpufreq_applet_bench_new            (gint            size,
+                                                                    CPUFreqMonitor *monitor);
+G_GNUC_INTERNAL GtkWidget     *cpufreq_applet_bench_get_graphic    (CPUFreqApplet  *applet);
+G_GNUC_INTERNAL void           cpufreq_applet_bench_set_percentage (CPUFreqApplet  *applet,
+                                                                    gint            perc);
+G_GNUC_INTERNAL void           cpufreq_applet_bench_render_icons   (CPUFreqApplet  *applet);
+
 G_END_DECLS
 
 #endif /* CPUFREQ_APPLET_H */
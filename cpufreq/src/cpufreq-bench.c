@@ -0,0 +1,108 @@
+/* Measures the graphic of the cpufreq applet offscreen.
+ *
+ * The icon is drawn after the frequency changed as on a tick of the
+ * monitor, going through all the images; the icons are rendered again
+ * as after a change of the panel size; and the bars of all cpus are
+ * drawn after the policies were read. The icons are those installed.
+ *
+ * Built on request only: make -C cpufreq/src cpufreq-bench
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "common/applet-bench.h"
+
+#include "cpufreq-applet.h"
+#include "cpufreq-monitor-all.h"
+
+static void
+bench_icon_percentage (gint     frame,
+                       gpointer data)
+{
+    /* another of the images on almost every frame */
+    cpufreq_applet_bench_set_percentage (data, ((frame + 1) * 23) % 101);
+}
+
+static void
+bench_icon_render (gint     frame,
+                   gpointer data)
+{
+    cpufreq_applet_bench_render_icons (data);
+}
+
+static void
+bench_bars_run (gint     frame,
+                gpointer data)
+{
+    CPUFreqMonitor *monitor = data;
+
+    CPUFREQ_MONITOR_GET_CLASS (monitor)->run (monitor);
+}
+
+static void
+bench_icon (gint size)
+{
+    CPUFreqApplet *applet;
+    GtkWidget *graphic;
+    gchar *label;
+
+    applet = cpufreq_applet_bench_new (size, NULL);
+    label = g_strdup_printf ("icon %d", size);
+
+    applet_bench_call ("cpufreq:render_icons", label, NULL, bench_icon_render, applet);
+
+    graphic = cpufreq_applet_bench_get_graphic (applet);
+    applet_bench_draw ("cpufreq:icon", label, graphic, -1, size,
+                       bench_icon_percentage, applet);
+    g_object_unref (graphic);
+
+    g_free (label);
+}
+
+static void
+bench_bars (gint size)
+{
+    CPUFreqMonitor *monitor;
+    CPUFreqApplet *applet;
+    GtkWidget *graphic;
+    gchar *label;
+
+    monitor = cpufreq_monitor_all_new ();
+    if (monitor == NULL)
+    {
+        printf ("# no cpufreq policies, no bars\n");
+        return;
+    }
+
+    applet = cpufreq_applet_bench_new (size, monitor);
+    label = g_strdup_printf ("bars %u %d",
+                             cpufreq_monitor_all_get_n_policies (CPUFREQ_MONITOR_ALL (monitor)),
+                             size);
+
+    graphic = cpufreq_applet_bench_get_graphic (applet);
+    applet_bench_draw ("cpufreq:bars_draw", label, graphic, -1, size,
+                       bench_bars_run, monitor);
+    g_object_unref (graphic);
+
+    g_free (label);
+}
+
+int
+main (int argc, char *argv [])
+{
+    if (!applet_bench_init (&argc, &argv, "- measure the cpufreq applet offscreen", NULL))
+        return EXIT_FAILURE;
+
+    /* a small panel, and one where the icon has its full size */
+    bench_icon (16);
+    bench_icon (48);
+    bench_bars (16);
+    bench_bars (48);
+
+    return EXIT_SUCCESS;
+}
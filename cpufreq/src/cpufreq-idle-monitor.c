@@ -0,0 +1,387 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/sampler-file.h"
+#include "common/sampler-tick.h"
+
+#include "cpufreq-idle-monitor.h"
+#include "cpufreq-utils.h"
+
+#define CPUFREQ_IDLE_CPU_PATH   "/sys/devices/system/cpu/cpu%u"
+#define CPUFREQ_IDLE_STATE_PATH CPUFREQ_IDLE_CPU_PATH "/cpuidle/state%u/%s"
+
+/* Milliseconds */
+#define CPUFREQ_IDLE_MONITOR_INTERVAL     1000
+#define CPUFREQ_IDLE_MONITOR_MIN_INTERVAL 50
+
+/* Signals */
+enum {
+    SIGNAL_CHANGED,
+    N_SIGNALS
+};
+
+struct _CPUFreqIdleMonitorPrivate {
+    guint            *cpus;
+    guint             n_cpus;
+
+    CPUFreqIdleState *states;
+    guint             n_states;
+
+    /* n_cpus x n_states, the time files, -1 while closed,
+     * and the times of the last run
+     */
+    gint             *fds;
+    guint64          *times;
+    gboolean         *sampled;
+    gint64            time;
+
+    guint             interval;
+    guint             timeout_handler;
+};
+
+static void cpufreq_idle_monitor_finalize (GObject *object);
+
+static guint signals[N_SIGNALS] = { 0 };
+
+G_DEFINE_TYPE_WITH_PRIVATE (CPUFreqIdleMonitor, cpufreq_idle_monitor, G_TYPE_OBJECT)
+
+static void
+cpufreq_idle_monitor_init (CPUFreqIdleMonitor *monitor)
+{
+    monitor->priv = cpufreq_idle_monitor_get_instance_private (monitor);
+
+    monitor->priv->interval = CPUFREQ_IDLE_MONITOR_INTERVAL;
+}
+
+static void
+cpufreq_idle_monitor_class_init (CPUFreqIdleMonitorClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    signals[SIGNAL_CHANGED] =
+            g_signal_new ("changed",
+                          G_TYPE_FROM_CLASS (klass),
+                          G_SIGNAL_RUN_LAST,
+                          G_STRUCT_OFFSET (CPUFreqIdleMonitorClass, changed),
+                          NULL, NULL,
+                          g_cclosure_marshal_VOID__VOID,
+                          G_TYPE_NONE, 0);
+
+    object_class->finalize = cpufreq_idle_monitor_finalize;
+}
+
+static void
+cpufreq_idle_monitor_finalize (GObject *object)
+{
+    CPUFreqIdleMonitorPrivate *priv = CPUFREQ_IDLE_MONITOR (object)->priv;
+    guint                      i;
+
+    if (priv->timeout_handler > 0) {
+        g_source_remove (priv->timeout_handler);
+        priv->timeout_handler = 0;
+    }
+
+    for (i = 0; i < priv->n_cpus * priv->n_states; i++) {
+        if (priv->fds[i] >= 0)
+            close (priv->fds[i]);
+    }
+
+    for (i = 0; i < priv->n_states; i++)
+        g_free (priv->states[i].name);
+
+    g_free (priv->cpus);
+    g_free (priv->states);
+    g_free (priv->fds);
+    g_free (priv->times);
+    g_free (priv->sampled);
+
+    G_OBJECT_CLASS (cpufreq_idle_monitor_parent_class)->finalize (object);
+}
+
+/* The states of the first cpu, the others have the same driver */
+static gboolean
+cpufreq_idle_monitor_setup (CPUFreqIdleMonitor *monitor,
+                            GArray             *cpus)
+{
+    CPUFreqIdleMonitorPrivate *priv = monitor->priv;
+    GArray                    *states;
+    guint                      i;
+
+    if (cpus->len == 0)
+        return FALSE;
+
+    states = g_array_new (FALSE, FALSE, sizeof (CPUFreqIdleState));
+
+    for (i = 0; ; i++) {
+        CPUFreqIdleState  state;
+        gchar            *path;
+        gchar            *name = NULL;
+
+        path = g_strdup_printf (CPUFREQ_IDLE_STATE_PATH,
+                                g_array_index (cpus, guint, 0), i, "name");
+        cpufreq_file_get_contents (path, &name, NULL, NULL);
+        g_free (path);
+
+        if (!name)
+            break;
+
+        state.name = g_strchomp (name);
+        state.residency = 0;
+        g_array_append_val (states, state);
+    }
+
+    if (states->len == 0) {
+        g_array_free (states, TRUE);
+
+        return FALSE;
+    }
+
+    priv->n_cpus = cpus->len;
+    priv->cpus = g_new (guint, cpus->len);
+    memcpy (priv->cpus, cpus->data, cpus->len * sizeof (guint));
+    priv->n_states = states->len;
+    priv->states = (CPUFreqIdleState *) g_array_free (states, FALSE);
+
+    priv->fds = g_new (gint, priv->n_cpus * priv->n_states);
+    for (i = 0; i < priv->n_cpus * priv->n_states; i++)
+        priv->fds[i] = -1;
+    priv->times = g_new0 (guint64, priv->n_cpus * priv->n_states);
+    priv->sampled = g_new0 (gboolean, priv->n_cpus);
+
+    return TRUE;
+}
+
+static CPUFreqIdleMonitor *
+cpufreq_idle_monitor_new_for_cpus (GArray *cpus)
+{
+    CPUFreqIdleMonitor *monitor;
+
+    monitor = CPUFREQ_IDLE_MONITOR (g_object_new (CPUFREQ_TYPE_IDLE_MONITOR, NULL));
+    if (!cpufreq_idle_monitor_setup (monitor, cpus)) {
+        g_object_unref (monitor);
+        monitor = NULL;
+    }
+
+    g_array_unref (cpus);
+
+    return monitor;
+}
+
+CPUFreqIdleMonitor *
+cpufreq_idle_monitor_new (guint cpu)
+{
+    GArray *cpus;
+    gchar  *path;
+    gchar  *related = NULL;
+
+    cpus = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    /* The cpus sharing the clock of cpu, or cpu alone */
+    path = g_strdup_printf (CPUFREQ_IDLE_CPU_PATH "/cpufreq/related_cpus", cpu);
+    if (cpufreq_file_get_contents (path, &related, NULL, NULL)) {
+        gchar **list;
+        guint   i;
+
+        list = g_strsplit_set (g_strstrip (related), " \n", -1);
+        for (i = 0; list[i]; i++) {
+            guint n;
+
+            if (*list[i] == '\0')
+                continue;
+
+            n = (guint) atoi (list[i]);
+            g_array_append_val (cpus, n);
+        }
+        g_strfreev (list);
+        g_free (related);
+    }
+    g_free (path);
+
+    if (cpus->len == 0)
+        g_array_append_val (cpus, cpu);
+
+    return cpufreq_idle_monitor_new_for_cpus (cpus);
+}
+
+CPUFreqIdleMonitor *
+cpufreq_idle_monitor_new_all (void)
+{
+    GArray *cpus;
+    guint   cpu;
+
+    cpus = g_array_new (FALSE, FALSE, sizeof (guint));
+    for (cpu = 0; ; cpu++) {
+        gchar path[64];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_IDLE_CPU_PATH, cpu);
+        if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+            break;
+
+        g_array_append_val (cpus, cpu);
+    }
+
+    return cpufreq_idle_monitor_new_for_cpus (cpus);
+}
+
+/* Reads the time of a state in microseconds, opening the file into fd
+ * the first time. The files of an offline cpu can not be read.
+ */
+static gboolean
+cpufreq_idle_monitor_read_time (gint    *fd,
+                                guint    cpu,
+                                guint    state,
+                                guint64 *time)
+{
+    gchar buffer[32];
+
+    if (*fd < 0) {
+        gchar path[128];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_IDLE_STATE_PATH, cpu, state, "time");
+        *fd = sampler_open (path);
+    }
+
+    if (sampler_pread (fd, buffer, sizeof (buffer)) < 0)
+        return FALSE;
+
+    *time = g_ascii_strtoull (buffer, NULL, 10);
+
+    return TRUE;
+}
+
+static gboolean
+cpufreq_idle_monitor_run_cb (CPUFreqIdleMonitor *monitor)
+{
+    CPUFreqIdleMonitorPrivate *priv = monitor->priv;
+    guint64                   *deltas;
+    guint                      n_sampled = 0;
+    gint64                     now, elapsed;
+    guint                      i, j;
+
+    now = g_get_monotonic_time ();
+    elapsed = priv->time > 0 ? now - priv->time : 0;
+    priv->time = now;
+
+    deltas = g_newa (guint64, priv->n_states);
+    memset (deltas, 0, priv->n_states * sizeof (guint64));
+
+    for (i = 0; i < priv->n_cpus; i++) {
+        guint64  *times = priv->times + i * priv->n_states;
+        gint     *fds = priv->fds + i * priv->n_states;
+        gboolean  sampled = TRUE;
+
+        for (j = 0; j < priv->n_states; j++) {
+            guint64 time;
+
+            sampled = cpufreq_idle_monitor_read_time (&fds[j], priv->cpus[i], j, &time);
+            if (!sampled)
+                break;
+
+            if (priv->sampled[i] && time >= times[j])
+                deltas[j] += time - times[j];
+            times[j] = time;
+        }
+
+        /* Counted from the run after a cpu comes online */
+        if (sampled && priv->sampled[i])
+            n_sampled++;
+        priv->sampled[i] = sampled;
+    }
+
+    for (j = 0; j < priv->n_states; j++) {
+        priv->states[j].residency = (n_sampled > 0 && elapsed > 0) ?
+            CLAMP ((gdouble) deltas[j] / ((gdouble) elapsed * n_sampled), 0.0, 1.0) : 0.0;
+    }
+
+    g_signal_emit (monitor, signals[SIGNAL_CHANGED], 0);
+
+    return TRUE;
+}
+
+void
+cpufreq_idle_monitor_run (CPUFreqIdleMonitor *monitor)
+{
+    CPUFreqIdleMonitorPrivate *priv;
+
+    g_return_if_fail (CPUFREQ_IS_IDLE_MONITOR (monitor));
+
+    priv = monitor->priv;
+
+    if (priv->timeout_handler > 0)
+        return;
+
+    /* The first run only takes the times to diff against */
+    if (priv->time == 0)
+        cpufreq_idle_monitor_run_cb (monitor);
+
+    priv->timeout_handler =
+        sampler_tick_add (priv->interval,
+                          (GSourceFunc) cpufreq_idle_monitor_run_cb,
+                          (gpointer) monitor);
+}
+
+void
+cpufreq_idle_monitor_set_interval (CPUFreqIdleMonitor *monitor,
+                                   guint               interval)
+{
+    CPUFreqIdleMonitorPrivate *priv;
+
+    g_return_if_fail (CPUFREQ_IS_IDLE_MONITOR (monitor));
+
+    priv = monitor->priv;
+    interval = MAX (interval, CPUFREQ_IDLE_MONITOR_MIN_INTERVAL);
+
+    if (priv->interval == interval)
+        return;
+
+    priv->interval = interval;
+
+    /* A running monitor goes on at the new interval */
+    if (priv->timeout_handler > 0) {
+        g_source_remove (priv->timeout_handler);
+        priv->timeout_handler = 0;
+        cpufreq_idle_monitor_run (monitor);
+    }
+}
+
+guint
+cpufreq_idle_monitor_get_n_states (CPUFreqIdleMonitor *monitor)
+{
+    g_return_val_if_fail (CPUFREQ_IS_IDLE_MONITOR (monitor), 0);
+
+    return monitor->priv->n_states;
+}
+
+const CPUFreqIdleState *
+cpufreq_idle_monitor_get_state (CPUFreqIdleMonitor *monitor,
+                                guint               i)
+{
+    g_return_val_if_fail (CPUFREQ_IS_IDLE_MONITOR (monitor), NULL);
+    g_return_val_if_fail (i < monitor->priv->n_states, NULL);
+
+    return &monitor->priv->states[i];
+}
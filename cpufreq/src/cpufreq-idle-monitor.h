@@ -0,0 +1,76 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CPUFREQ_IDLE_MONITOR_H__
+#define __CPUFREQ_IDLE_MONITOR_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define CPUFREQ_TYPE_IDLE_MONITOR            (cpufreq_idle_monitor_get_type ())
+#define CPUFREQ_IDLE_MONITOR(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), CPUFREQ_TYPE_IDLE_MONITOR, CPUFreqIdleMonitor))
+#define CPUFREQ_IDLE_MONITOR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), CPUFREQ_TYPE_IDLE_MONITOR, CPUFreqIdleMonitorClass))
+#define CPUFREQ_IS_IDLE_MONITOR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CPUFREQ_TYPE_IDLE_MONITOR))
+#define CPUFREQ_IS_IDLE_MONITOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CPUFREQ_TYPE_IDLE_MONITOR))
+#define CPUFREQ_IDLE_MONITOR_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), CPUFREQ_TYPE_IDLE_MONITOR, CPUFreqIdleMonitorClass))
+
+typedef struct _CPUFreqIdleMonitor        CPUFreqIdleMonitor;
+typedef struct _CPUFreqIdleMonitorClass   CPUFreqIdleMonitorClass;
+typedef struct _CPUFreqIdleMonitorPrivate CPUFreqIdleMonitorPrivate;
+
+/* An idle state, as stateM of cpuidle */
+typedef struct {
+    gchar   *name;      /* as in "C6" */
+    gdouble  residency; /* share of the last interval spent in it */
+} CPUFreqIdleState;
+
+struct _CPUFreqIdleMonitor {
+    GObject parent;
+
+    CPUFreqIdleMonitorPrivate *priv;
+};
+
+struct _CPUFreqIdleMonitorClass {
+    GObjectClass parent_class;
+
+    /*< signals >*/
+    void (* changed) (CPUFreqIdleMonitor *monitor);
+};
+
+/* Monitors the time the cpus spend in each cpuidle state, from the
+ * time file of every state of every cpu, all kept open. The residency
+ * is the average over the online cpus between two runs.
+ */
+GType                   cpufreq_idle_monitor_get_type     (void) G_GNUC_CONST;
+/* The cpus of the cpufreq policy of cpu, NULL without cpuidle */
+CPUFreqIdleMonitor     *cpufreq_idle_monitor_new          (guint               cpu);
+/* Every cpu, NULL without cpuidle */
+CPUFreqIdleMonitor     *cpufreq_idle_monitor_new_all      (void);
+
+void                    cpufreq_idle_monitor_run          (CPUFreqIdleMonitor *monitor);
+void                    cpufreq_idle_monitor_set_interval (CPUFreqIdleMonitor *monitor,
+                                                           guint               interval);
+guint                   cpufreq_idle_monitor_get_n_states (CPUFreqIdleMonitor *monitor);
+const CPUFreqIdleState *cpufreq_idle_monitor_get_state    (CPUFreqIdleMonitor *monitor,
+                                                           guint               i);
+
+G_END_DECLS
+
+#endif /* __CPUFREQ_IDLE_MONITOR_H__ */
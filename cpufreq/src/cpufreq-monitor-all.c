@@ -0,0 +1,391 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/sampler-file.h"
+
+#include "cpufreq-monitor-all.h"
+#include "cpufreq-utils.h"
+
+#define CPUFREQ_POLICY_BASE_DIR  "/sys/devices/system/cpu/cpufreq"
+#define CPUFREQ_POLICY_BASE_PATH CPUFREQ_POLICY_BASE_DIR "/policy%u/%s"
+
+/* Large enough for the frequency and governor files */
+#define CPUFREQ_POLICY_BUFFER_SIZE 64
+
+struct _CPUFreqMonitorAllPrivate {
+    CPUFreqPolicy *policies;
+    guint          n_policies;
+
+    /* scaling_cur_freq of the policies, and scaling_governor
+     * of the one the governor is read from, -1 while closed
+     */
+    gint          *freq_fds;
+    gint           governor_fd;
+    guint          governor_policy;
+
+    gint           min;
+    gint           avg;
+    gint           max;
+    gint           max_frequency;
+    gboolean       online;
+};
+
+static gboolean cpufreq_monitor_all_run      (CPUFreqMonitor *monitor);
+static void     cpufreq_monitor_all_finalize (GObject        *object);
+
+G_DEFINE_TYPE_WITH_PRIVATE (CPUFreqMonitorAll, cpufreq_monitor_all, CPUFREQ_TYPE_MONITOR)
+
+static gchar *
+cpufreq_policy_read_file (guint        number,
+                          const gchar *file)
+{
+    gchar *path;
+    gchar *buffer = NULL;
+
+    path = g_strdup_printf (CPUFREQ_POLICY_BASE_PATH, number, file);
+    if (cpufreq_file_get_contents (path, &buffer, NULL, NULL))
+        g_strchomp (buffer);
+    g_free (path);
+
+    return buffer;
+}
+
+/* Turns a list of cpus as in related_cpus, "0 1 2 3 8",
+ * into ranges, "0-3,8", and counts them
+ */
+static gchar *
+cpufreq_policy_cpus_to_ranges (const gchar *list,
+                               guint       *n_cpus)
+{
+    GString *ranges = g_string_new (NULL);
+    gchar   *end;
+    glong    first = -1, last = -1;
+
+    *n_cpus = 0;
+
+    for (;;) {
+        glong cpu = strtol (list, &end, 10);
+
+        if (end != list && cpu == last + 1 && first >= 0) {
+            last = cpu;
+        } else {
+            if (first >= 0) {
+                if (ranges->len > 0)
+                    g_string_append_c (ranges, ',');
+                if (first == last)
+                    g_string_append_printf (ranges, "%ld", first);
+                else
+                    g_string_append_printf (ranges, "%ld-%ld", first, last);
+            }
+            if (end == list)
+                break;
+            first = last = cpu;
+        }
+
+        (*n_cpus)++;
+        list = end;
+    }
+
+    return g_string_free (ranges, FALSE);
+}
+
+static guint
+cpufreq_policy_count_cpus (guint        number,
+                           const gchar *file)
+{
+    gchar *list;
+    gchar *ranges;
+    guint  n_cpus = 0;
+
+    list = cpufreq_policy_read_file (number, file);
+    if (!list)
+        return 0;
+
+    ranges = cpufreq_policy_cpus_to_ranges (list, &n_cpus);
+    g_free (ranges);
+    g_free (list);
+
+    return n_cpus;
+}
+
+static gint
+compare_policies (gconstpointer a, gconstpointer b)
+{
+    const CPUFreqPolicy *pa = a;
+    const CPUFreqPolicy *pb = b;
+
+    return pa->number < pb->number ? -1 : pa->number > pb->number;
+}
+
+static void
+cpufreq_monitor_all_init (CPUFreqMonitorAll *monitor)
+{
+    GArray      *policies;
+    GDir        *dir;
+    const gchar *name;
+    guint        i;
+
+    monitor->priv = cpufreq_monitor_all_get_instance_private (monitor);
+
+    policies = g_array_new (FALSE, TRUE, sizeof (CPUFreqPolicy));
+
+    dir = g_dir_open (CPUFREQ_POLICY_BASE_DIR, 0, NULL);
+    while (dir && (name = g_dir_read_name (dir))) {
+        CPUFreqPolicy policy = { 0 };
+        gchar        *end;
+        gchar        *value;
+
+        if (!g_str_has_prefix (name, "policy"))
+            continue;
+
+        policy.number = (guint) strtoul (name + strlen ("policy"), &end, 10);
+        if (*end != '\0')
+            continue;
+
+        value = cpufreq_policy_read_file (policy.number, "related_cpus");
+        policy.cpus = cpufreq_policy_cpus_to_ranges (value ? value : "", &policy.n_cpus);
+        g_free (value);
+
+        value = cpufreq_policy_read_file (policy.number, "cpuinfo_max_freq");
+        policy.max_frequency = value ? atoi (value) : -1;
+        g_free (value);
+
+        g_array_append_val (policies, policy);
+    }
+
+    if (dir)
+        g_dir_close (dir);
+
+    g_array_sort (policies, compare_policies);
+
+    monitor->priv->n_policies = policies->len;
+    monitor->priv->policies = (CPUFreqPolicy *) g_array_free (policies, FALSE);
+
+    monitor->priv->freq_fds = g_new (gint, MAX (monitor->priv->n_policies, 1));
+    for (i = 0; i < monitor->priv->n_policies; i++)
+        monitor->priv->freq_fds[i] = -1;
+    monitor->priv->governor_fd = -1;
+
+    monitor->priv->online = FALSE;
+}
+
+static void
+cpufreq_monitor_all_class_init (CPUFreqMonitorAllClass *klass)
+{
+    GObjectClass        *object_class = G_OBJECT_CLASS (klass);
+    CPUFreqMonitorClass *monitor_class = CPUFREQ_MONITOR_CLASS (klass);
+
+    object_class->finalize = cpufreq_monitor_all_finalize;
+
+    monitor_class->run = cpufreq_monitor_all_run;
+}
+
+static void
+cpufreq_monitor_all_finalize (GObject *object)
+{
+    CPUFreqMonitorAll *monitor = CPUFREQ_MONITOR_ALL (object);
+    guint              i;
+
+    for (i = 0; i < monitor->priv->n_policies; i++) {
+        if (monitor->priv->freq_fds[i] >= 0)
+            close (monitor->priv->freq_fds[i]);
+        g_free (monitor->priv->policies[i].cpus);
+    }
+
+    if (monitor->priv->governor_fd >= 0)
+        close (monitor->priv->governor_fd);
+
+    g_free (monitor->priv->freq_fds);
+    g_free (monitor->priv->policies);
+
+    G_OBJECT_CLASS (cpufreq_monitor_all_parent_class)->finalize (object);
+}
+
+CPUFreqMonitor *
+cpufreq_monitor_all_new (void)
+{
+    CPUFreqMonitorAll *monitor;
+
+    monitor = g_object_new (CPUFREQ_TYPE_MONITOR_ALL, NULL);
+
+    if (monitor->priv->n_policies == 0) {
+        /* No cpufreq policies, nothing to monitor */
+        g_object_unref (monitor);
+
+        return NULL;
+    }
+
+    return CPUFREQ_MONITOR (monitor);
+}
+
+/* Reads file of the policy into buffer without the trailing new line,
+ * opening it into fd the first time. Returns FALSE if it can not be
+ * read, and closes the file to open it again on the next read.
+ */
+static gboolean
+cpufreq_policy_pread (gint        *fd,
+                      guint        number,
+                      const gchar *file,
+                      gchar       *buffer,
+                      gsize        size)
+{
+    if (*fd < 0) {
+        gchar path[128];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_POLICY_BASE_PATH, number, file);
+        *fd = sampler_open (path);
+    }
+
+    /* Files of a policy with all its cpus offline can not be read */
+    return sampler_pread (fd, buffer, size) >= 0;
+}
+
+static gboolean
+cpufreq_monitor_all_run (CPUFreqMonitor *monitor)
+{
+    CPUFreqMonitorAllPrivate *priv = CPUFREQ_MONITOR_ALL (monitor)->priv;
+    gchar                     buffer[CPUFREQ_POLICY_BUFFER_SIZE];
+    gint                      min = G_MAXINT, max = 0, max_frequency = 0;
+    gint64                    sum = 0;
+    guint                     n_cpus = 0;
+    gint                      first_online = -1;
+    gboolean                  changed = FALSE;
+    guint                     i;
+
+    for (i = 0; i < priv->n_policies; i++) {
+        CPUFreqPolicy *policy = &priv->policies[i];
+        gboolean       reopened = priv->freq_fds[i] < 0;
+        gint           frequency;
+
+        if (!cpufreq_policy_pread (&priv->freq_fds[i], policy->number,
+                                   "scaling_cur_freq", buffer, sizeof (buffer))) {
+            changed |= policy->online;
+            policy->online = FALSE;
+            continue;
+        }
+
+        /* The cpus may have gone offline or come back
+         * since the file was last open
+         */
+        if (reopened)
+            policy->n_cpus = MAX (cpufreq_policy_count_cpus (policy->number,
+                                                             "affected_cpus"), 1);
+
+        frequency = (gint) strtol (buffer, NULL, 10);
+        if (!policy->online || frequency != policy->frequency) {
+            policy->online = TRUE;
+            policy->frequency = frequency;
+            changed = TRUE;
+        }
+
+        if (first_online < 0)
+            first_online = i;
+
+        min = MIN (min, frequency);
+        max = MAX (max, frequency);
+        max_frequency = MAX (max_frequency, policy->max_frequency);
+        sum += (gint64) frequency * policy->n_cpus;
+        n_cpus += policy->n_cpus;
+    }
+
+    if (first_online < 0) {
+        if (priv->online) {
+            priv->online = FALSE;
+            g_object_set (G_OBJECT (monitor), "online", FALSE, NULL);
+        }
+
+        return TRUE;
+    }
+
+    if ((guint) first_online != priv->governor_policy && priv->governor_fd >= 0) {
+        close (priv->governor_fd);
+        priv->governor_fd = -1;
+    }
+    priv->governor_policy = first_online;
+
+    if (!cpufreq_policy_pread (&priv->governor_fd,
+                               priv->policies[first_online].number,
+                               "scaling_governor", buffer, sizeof (buffer)))
+        buffer[0] = '\0';
+
+    priv->min = min;
+    priv->avg = (gint) (sum / n_cpus);
+
+    if (!priv->online || max != priv->max || max_frequency != priv->max_frequency ||
+        g_strcmp0 (buffer, cpufreq_monitor_get_governor (monitor)) != 0) {
+        priv->online = TRUE;
+        priv->max = max;
+        priv->max_frequency = max_frequency;
+
+        g_object_set (G_OBJECT (monitor),
+                      "online", TRUE,
+                      "governor", buffer[0] != '\0' ? buffer : NULL,
+                      "frequency", max,
+                      "max-frequency", max_frequency,
+                      NULL);
+    }
+
+    /* A policy other than the fastest one changed */
+    if (changed)
+        cpufreq_monitor_set_changed (monitor);
+
+    return TRUE;
+}
+
+guint
+cpufreq_monitor_all_get_n_policies (CPUFreqMonitorAll *monitor)
+{
+    g_return_val_if_fail (CPUFREQ_IS_MONITOR_ALL (monitor), 0);
+
+    return monitor->priv->n_policies;
+}
+
+const CPUFreqPolicy *
+cpufreq_monitor_all_get_policy (CPUFreqMonitorAll *monitor,
+                                guint              i)
+{
+    g_return_val_if_fail (CPUFREQ_IS_MONITOR_ALL (monitor), NULL);
+    g_return_val_if_fail (i < monitor->priv->n_policies, NULL);
+
+    return &monitor->priv->policies[i];
+}
+
+void
+cpufreq_monitor_all_get_range (CPUFreqMonitorAll *monitor,
+                               gint              *min,
+                               gint              *avg,
+                               gint              *max)
+{
+    g_return_if_fail (CPUFREQ_IS_MONITOR_ALL (monitor));
+
+    if (min)
+        *min = monitor->priv->online ? monitor->priv->min : 0;
+    if (avg)
+        *avg = monitor->priv->online ? monitor->priv->avg : 0;
+    if (max)
+        *max = monitor->priv->online ? monitor->priv->max : 0;
+}
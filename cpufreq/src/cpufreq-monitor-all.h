@@ -0,0 +1,78 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CPUFREQ_MONITOR_ALL_H__
+#define __CPUFREQ_MONITOR_ALL_H__
+
+#include <glib-object.h>
+
+#include "cpufreq-monitor.h"
+
+G_BEGIN_DECLS
+
+#define CPUFREQ_TYPE_MONITOR_ALL            (cpufreq_monitor_all_get_type ())
+#define CPUFREQ_MONITOR_ALL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), CPUFREQ_TYPE_MONITOR_ALL, CPUFreqMonitorAll))
+#define CPUFREQ_MONITOR_ALL_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), CPUFREQ_TYPE_MONITOR_ALL, CPUFreqMonitorAllClass))
+#define CPUFREQ_IS_MONITOR_ALL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CPUFREQ_TYPE_MONITOR_ALL))
+#define CPUFREQ_IS_MONITOR_ALL_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CPUFREQ_TYPE_MONITOR_ALL))
+#define CPUFREQ_MONITOR_ALL_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), CPUFREQ_TYPE_MONITOR_ALL, CPUFreqMonitorAllClass))
+
+typedef struct _CPUFreqMonitorAll        CPUFreqMonitorAll;
+typedef struct _CPUFreqMonitorAllClass   CPUFreqMonitorAllClass;
+typedef struct _CPUFreqMonitorAllPrivate CPUFreqMonitorAllPrivate;
+
+/* A cpufreq policy, the cpus sharing one clock */
+typedef struct {
+    guint    number;        /* N of /sys/devices/system/cpu/cpufreq/policyN */
+    gchar   *cpus;          /* the related cpus, as in "0-3,8" */
+    guint    n_cpus;        /* the online ones */
+    gboolean online;
+    gint     frequency;
+    gint     max_frequency;
+} CPUFreqPolicy;
+
+struct _CPUFreqMonitorAll {
+    CPUFreqMonitor parent;
+
+    CPUFreqMonitorAllPrivate *priv;
+};
+
+struct _CPUFreqMonitorAllClass {
+    CPUFreqMonitorClass parent_class;
+};
+
+/* Monitors every cpu at once, reading one file per policy a run.
+ * The frequency is that of the fastest policy, and the governor
+ * that of the first online one.
+ */
+GType                cpufreq_monitor_all_get_type       (void) G_GNUC_CONST;
+CPUFreqMonitor      *cpufreq_monitor_all_new            (void);
+
+guint                cpufreq_monitor_all_get_n_policies (CPUFreqMonitorAll *monitor);
+const CPUFreqPolicy *cpufreq_monitor_all_get_policy     (CPUFreqMonitorAll *monitor,
+                                                         guint              i);
+/* Over the online cpus, avg weighted by the cpus of each policy */
+void                 cpufreq_monitor_all_get_range      (CPUFreqMonitorAll *monitor,
+                                                         gint              *min,
+                                                         gint              *avg,
+                                                         gint              *max);
+
+G_END_DECLS
+
+#endif /* __CPUFREQ_MONITOR_ALL_H__ */
@@ -0,0 +1,417 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "common/sampler-file.h"
+
+#include "cpufreq-monitor-aperf.h"
+#include "cpufreq-utils.h"
+
+#define CPUFREQ_APERF_SYSFS_PATH "/sys/devices/system/cpu/cpu%u/cpufreq/%s"
+#define CPUFREQ_APERF_MSR_PATH   "/dev/cpu/%u/msr"
+
+/* Architectural MSRs, counting at the base clock
+ * and at the actual clock while in C0
+ */
+#define MSR_IA32_MPERF 0xe7
+#define MSR_IA32_APERF 0xe8
+
+typedef enum {
+    COUNTERS_NONE,
+    COUNTERS_MSR,
+    COUNTERS_PERF
+} CountersKind;
+
+struct _CPUFreqMonitorAperfPrivate {
+    guint        cpu;        /* the one the files below are open for */
+    CountersKind kind;
+    gint         counters_fd; /* the msr device, or the perf group leader */
+    gint         ref_cycles_fd;
+    gint         governor_fd;
+
+    gint         base_freq;
+    gboolean     primed;
+    guint64      aperf;
+    guint64      mperf;
+    gboolean     online;
+};
+
+static gboolean cpufreq_monitor_aperf_run                       (CPUFreqMonitor *monitor);
+static GList   *cpufreq_monitor_aperf_get_available_frequencies (CPUFreqMonitor *monitor);
+static GList   *cpufreq_monitor_aperf_get_available_governors   (CPUFreqMonitor *monitor);
+static void     cpufreq_monitor_aperf_finalize                  (GObject        *object);
+
+G_DEFINE_TYPE_WITH_PRIVATE (CPUFreqMonitorAperf, cpufreq_monitor_aperf, CPUFREQ_TYPE_MONITOR)
+
+static void
+cpufreq_aperf_close_files (CPUFreqMonitorAperf *monitor)
+{
+    CPUFreqMonitorAperfPrivate *priv = monitor->priv;
+
+    if (priv->counters_fd >= 0)
+        close (priv->counters_fd);
+    if (priv->ref_cycles_fd >= 0)
+        close (priv->ref_cycles_fd);
+    if (priv->governor_fd >= 0)
+        close (priv->governor_fd);
+
+    priv->counters_fd = -1;
+    priv->ref_cycles_fd = -1;
+    priv->governor_fd = -1;
+    priv->kind = COUNTERS_NONE;
+    priv->primed = FALSE;
+}
+
+static gchar *
+cpufreq_aperf_read_file (guint        cpu,
+                         const gchar *file)
+{
+    gchar *path;
+    gchar *buffer = NULL;
+
+    path = g_strdup_printf (CPUFREQ_APERF_SYSFS_PATH, cpu, file);
+    if (cpufreq_file_get_contents (path, &buffer, NULL, NULL))
+        g_strchomp (buffer);
+    g_free (path);
+
+    return buffer;
+}
+
+#ifdef __linux__
+static gint
+cpufreq_aperf_perf_open (guint  cpu,
+                         guint  config,
+                         gint   group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset (&attr, 0, sizeof (attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof (attr);
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    /* All tasks on cpu, which needs perf_event_paranoid
+     * at 0 or below, or CAP_PERFMON
+     */
+    return (gint) syscall (__NR_perf_event_open, &attr, -1, (int) cpu,
+                           group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+#endif
+
+static gboolean
+cpufreq_aperf_open_counters (CPUFreqMonitorAperfPrivate *priv,
+                             guint                       cpu)
+{
+#ifdef __linux__
+    gchar   path[64];
+    guint64 value;
+
+    g_snprintf (path, sizeof (path), CPUFREQ_APERF_MSR_PATH, cpu);
+    priv->counters_fd = open (path, O_RDONLY | O_CLOEXEC);
+    if (priv->counters_fd >= 0) {
+        if (pread (priv->counters_fd, &value, sizeof (value), MSR_IA32_MPERF) == sizeof (value)) {
+            priv->kind = COUNTERS_MSR;
+            return TRUE;
+        }
+
+        close (priv->counters_fd);
+    }
+
+    /* cycles leads, so both are scheduled together */
+    priv->counters_fd = cpufreq_aperf_perf_open (cpu, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (priv->counters_fd >= 0) {
+        priv->ref_cycles_fd = cpufreq_aperf_perf_open (cpu, PERF_COUNT_HW_REF_CPU_CYCLES,
+                                                       priv->counters_fd);
+        if (priv->ref_cycles_fd >= 0) {
+            priv->kind = COUNTERS_PERF;
+            return TRUE;
+        }
+
+        close (priv->counters_fd);
+    }
+
+    priv->counters_fd = -1;
+#endif
+
+    return FALSE;
+}
+
+static gboolean
+cpufreq_aperf_read_counters (CPUFreqMonitorAperfPrivate *priv,
+                             guint64                    *aperf,
+                             guint64                    *mperf)
+{
+    switch (priv->kind) {
+    case COUNTERS_MSR:
+        return pread (priv->counters_fd, mperf, sizeof (*mperf), MSR_IA32_MPERF) == sizeof (*mperf) &&
+               pread (priv->counters_fd, aperf, sizeof (*aperf), MSR_IA32_APERF) == sizeof (*aperf);
+    case COUNTERS_PERF: {
+        /* PERF_FORMAT_GROUP: the number of counters, then their values */
+        guint64 values[3];
+
+        if (read (priv->counters_fd, values, sizeof (values)) != sizeof (values) || values[0] != 2)
+            return FALSE;
+
+        *aperf = values[1];
+        *mperf = values[2];
+
+        return TRUE;
+    }
+    default:
+        return FALSE;
+    }
+}
+
+/* Opens the files of cpu, and reads the frequency the
+ * MPERF counter and the ref-cycles run at
+ */
+static gboolean
+cpufreq_aperf_open (CPUFreqMonitorAperf *monitor,
+                    guint                cpu)
+{
+    CPUFreqMonitorAperfPrivate *priv = monitor->priv;
+    gchar                      *value;
+    gint                        max_freq;
+
+    cpufreq_aperf_close_files (monitor);
+    priv->cpu = cpu;
+
+    if (!cpufreq_aperf_open_counters (priv, cpu))
+        return FALSE;
+
+    value = cpufreq_aperf_read_file (cpu, "cpuinfo_max_freq");
+    max_freq = value ? atoi (value) : -1;
+    g_free (value);
+
+    /* Without base_frequency, as with acpi-cpufreq, the max is the
+     * base clock unless boost is on, then the result reads high
+     */
+    value = cpufreq_aperf_read_file (cpu, "base_frequency");
+    priv->base_freq = value ? atoi (value) : max_freq;
+    g_free (value);
+
+    g_object_set (G_OBJECT (monitor),
+                  "max-frequency", max_freq,
+                  NULL);
+
+    return priv->base_freq > 0;
+}
+
+static void
+cpufreq_monitor_aperf_init (CPUFreqMonitorAperf *monitor)
+{
+    monitor->priv = cpufreq_monitor_aperf_get_instance_private (monitor);
+
+    monitor->priv->counters_fd = -1;
+    monitor->priv->ref_cycles_fd = -1;
+    monitor->priv->governor_fd = -1;
+    monitor->priv->kind = COUNTERS_NONE;
+    monitor->priv->online = FALSE;
+}
+
+static void
+cpufreq_monitor_aperf_class_init (CPUFreqMonitorAperfClass *klass)
+{
+    GObjectClass        *object_class = G_OBJECT_CLASS (klass);
+    CPUFreqMonitorClass *monitor_class = CPUFREQ_MONITOR_CLASS (klass);
+
+    object_class->finalize = cpufreq_monitor_aperf_finalize;
+
+    monitor_class->run = cpufreq_monitor_aperf_run;
+    monitor_class->get_available_frequencies = cpufreq_monitor_aperf_get_available_frequencies;
+    monitor_class->get_available_governors = cpufreq_monitor_aperf_get_available_governors;
+}
+
+static void
+cpufreq_monitor_aperf_finalize (GObject *object)
+{
+    cpufreq_aperf_close_files (CPUFREQ_MONITOR_APERF (object));
+
+    G_OBJECT_CLASS (cpufreq_monitor_aperf_parent_class)->finalize (object);
+}
+
+CPUFreqMonitor *
+cpufreq_monitor_aperf_new (guint cpu)
+{
+    CPUFreqMonitorAperf *monitor;
+
+    monitor = g_object_new (CPUFREQ_TYPE_MONITOR_APERF,
+                            "cpu", cpu, NULL);
+
+    return CPUFREQ_MONITOR (monitor);
+}
+
+gboolean
+cpufreq_monitor_aperf_is_available (guint cpu)
+{
+    CPUFreqMonitorAperfPrivate priv = { 0 };
+    gboolean                   retval;
+
+    priv.counters_fd = -1;
+    priv.ref_cycles_fd = -1;
+
+    retval = cpufreq_aperf_open_counters (&priv, cpu);
+
+    if (priv.counters_fd >= 0)
+        close (priv.counters_fd);
+    if (priv.ref_cycles_fd >= 0)
+        close (priv.ref_cycles_fd);
+
+    return retval;
+}
+
+static gboolean
+cpufreq_aperf_read_governor (CPUFreqMonitorAperfPrivate *priv,
+                             gchar                      *buffer,
+                             gsize                       size)
+{
+    if (priv->governor_fd < 0) {
+        gchar path[128];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_APERF_SYSFS_PATH,
+                    priv->cpu, "scaling_governor");
+        priv->governor_fd = sampler_open (path);
+    }
+
+    return sampler_pread (&priv->governor_fd, buffer, size) >= 0;
+}
+
+static gboolean
+cpufreq_monitor_aperf_run (CPUFreqMonitor *monitor)
+{
+    CPUFreqMonitorAperf        *aperf_monitor = CPUFREQ_MONITOR_APERF (monitor);
+    CPUFreqMonitorAperfPrivate *priv = aperf_monitor->priv;
+    guint                       cpu;
+    guint64                     aperf, mperf;
+    gint                        frequency;
+    gchar                       governor[64];
+
+    cpu = cpufreq_monitor_get_cpu (monitor);
+
+    if ((priv->kind == COUNTERS_NONE || cpu != priv->cpu) &&
+        !cpufreq_aperf_open (aperf_monitor, cpu)) {
+        cpufreq_aperf_close_files (aperf_monitor);
+        if (priv->online) {
+            priv->online = FALSE;
+            g_object_set (G_OBJECT (monitor), "online", FALSE, NULL);
+        }
+
+        /* The cpu may come back online */
+        return TRUE;
+    }
+
+    if (!cpufreq_aperf_read_counters (priv, &aperf, &mperf)) {
+        /* Counters of a cpu gone offline can not be read */
+        cpufreq_aperf_close_files (aperf_monitor);
+        return TRUE;
+    }
+
+    if (!priv->primed || mperf <= priv->mperf) {
+        /* Nothing to compare with yet, or the cpu
+         * stayed idle since the last run
+         */
+        priv->primed = TRUE;
+        priv->aperf = aperf;
+        priv->mperf = mperf;
+
+        return TRUE;
+    }
+
+    frequency = (gint) ((gdouble) priv->base_freq *
+                        (gdouble) (aperf - priv->aperf) / (gdouble) (mperf - priv->mperf));
+    priv->aperf = aperf;
+    priv->mperf = mperf;
+
+    if (!cpufreq_aperf_read_governor (priv, governor, sizeof (governor)))
+        governor[0] = '\0';
+
+    if (!priv->online ||
+        frequency != cpufreq_monitor_get_frequency (monitor) ||
+        g_strcmp0 (governor, cpufreq_monitor_get_governor (monitor)) != 0) {
+        priv->online = TRUE;
+        g_object_set (G_OBJECT (monitor),
+                      "online", TRUE,
+                      "governor", governor[0] != '\0' ? governor : NULL,
+                      "frequency", frequency,
+                      NULL);
+    }
+
+    return TRUE;
+}
+
+static gint
+compare_frequencies (gconstpointer a, gconstpointer b)
+{
+    gint aa = atoi ((const gchar *) a);
+    gint bb = atoi ((const gchar *) b);
+
+    return aa == bb ? 0 : (aa > bb ? -1 : 1);
+}
+
+/* The words of a list file of the cpufreq directory */
+static GList *
+cpufreq_aperf_read_list (CPUFreqMonitor *monitor,
+                         const gchar    *file)
+{
+    gchar  *buffer;
+    gchar **words;
+    GList  *list = NULL;
+    gint    i;
+
+    buffer = cpufreq_aperf_read_file (cpufreq_monitor_get_cpu (monitor), file);
+    if (!buffer)
+        return NULL;
+
+    words = g_strsplit (buffer, " ", -1);
+    for (i = 0; words[i]; i++) {
+        if (*words[i] != '\0')
+            list = g_list_prepend (list, g_strdup (words[i]));
+    }
+
+    g_strfreev (words);
+    g_free (buffer);
+
+    return list;
+}
+
+static GList *
+cpufreq_monitor_aperf_get_available_frequencies (CPUFreqMonitor *monitor)
+{
+    return g_list_sort (cpufreq_aperf_read_list (monitor, "scaling_available_frequencies"),
+                        compare_frequencies);
+}
+
+static GList *
+cpufreq_monitor_aperf_get_available_governors (CPUFreqMonitor *monitor)
+{
+    return cpufreq_aperf_read_list (monitor, "scaling_available_governors");
+}
@@ -0,0 +1,63 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CPUFREQ_MONITOR_APERF_H__
+#define __CPUFREQ_MONITOR_APERF_H__
+
+#include <glib-object.h>
+
+#include "cpufreq-monitor.h"
+
+G_BEGIN_DECLS
+
+#define CPUFREQ_TYPE_MONITOR_APERF            (cpufreq_monitor_aperf_get_type ())
+#define CPUFREQ_MONITOR_APERF(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), CPUFREQ_TYPE_MONITOR_APERF, CPUFreqMonitorAperf))
+#define CPUFREQ_MONITOR_APERF_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass), CPUFREQ_TYPE_MONITOR_APERF, CPUFreqMonitorAperfClass))
+#define CPUFREQ_IS_MONITOR_APERF(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), CPUFREQ_TYPE_MONITOR_APERF))
+#define CPUFREQ_IS_MONITOR_APERF_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CPUFREQ_TYPE_MONITOR_APERF))
+#define CPUFREQ_MONITOR_APERF_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), CPUFREQ_TYPE_MONITOR_APERF, CPUFreqMonitorAperfClass))
+
+typedef struct _CPUFreqMonitorAperf        CPUFreqMonitorAperf;
+typedef struct _CPUFreqMonitorAperfClass   CPUFreqMonitorAperfClass;
+typedef struct _CPUFreqMonitorAperfPrivate CPUFreqMonitorAperfPrivate;
+
+struct _CPUFreqMonitorAperf {
+    CPUFreqMonitor parent;
+
+    CPUFreqMonitorAperfPrivate *priv;
+};
+
+struct _CPUFreqMonitorAperfClass {
+    CPUFreqMonitorClass parent_class;
+};
+
+/* The average frequency the cpu actually ran at between runs, from
+ * the APERF and MPERF counters, rather than the one requested by the
+ * governor. The counters are read from /dev/cpu/N/msr, which needs
+ * root, or else counted by perf as cycles and ref-cycles.
+ */
+GType           cpufreq_monitor_aperf_get_type     (void) G_GNUC_CONST;
+CPUFreqMonitor *cpufreq_monitor_aperf_new          (guint cpu);
+
+/* Whether cpu has counters this monitor can read */
+gboolean        cpufreq_monitor_aperf_is_available (guint cpu);
+
+G_END_DECLS
+
+#endif /* __CPUFREQ_MONITOR_APERF_H__ */
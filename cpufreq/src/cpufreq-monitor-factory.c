@@ -29,6 +29,8 @@
 #include "cpufreq-applet.h"
 #include "cpufreq-utils.h"
 #include "cpufreq-monitor-factory.h"
+#include "cpufreq-monitor-all.h"
+#include "cpufreq-monitor-aperf.h"
 #ifdef HAVE_LIBCPUFREQ
 #include "cpufreq-monitor-libcpufreq.h"
 #else
@@ -64,3 +66,17 @@ cpufreq_monitor_factory_create_monitor (guint cpu)
 #endif
 }
 
+CPUFreqMonitor *
+cpufreq_monitor_factory_create_all_monitor (void)
+{
+    return cpufreq_monitor_all_new ();
+}
+
+CPUFreqMonitor *
+cpufreq_monitor_factory_create_effective_monitor (guint cpu)
+{
+    if (!cpufreq_monitor_aperf_is_available (cpu))
+        return NULL;
+
+    return cpufreq_monitor_aperf_new (cpu);
+}
@@ -26,7 +26,11 @@
 
 G_BEGIN_DECLS
 
-CPUFreqMonitor *cpufreq_monitor_factory_create_monitor (guint cpu);
+CPUFreqMonitor *cpufreq_monitor_factory_create_monitor     (guint cpu);
+/* NULL without cpufreq policies in sysfs */
+CPUFreqMonitor *cpufreq_monitor_factory_create_all_monitor (void);
+/* NULL without APERF and MPERF counters that can be read */
+CPUFreqMonitor *cpufreq_monitor_factory_create_effective_monitor (guint cpu);
 
 G_END_DECLS
 
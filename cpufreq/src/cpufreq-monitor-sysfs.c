@@ -24,6 +24,13 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <glib-unix.h>
+
+#include "common/sampler-file.h"
 
 #include "cpufreq-monitor-sysfs.h"
 #include "cpufreq-utils.h"
@@ -42,8 +49,12 @@ static gboolean cpufreq_monitor_sysfs_run                       (CPUFreqMonitor
 static GList   *cpufreq_monitor_sysfs_get_available_frequencies (CPUFreqMonitor *monitor);
 static GList   *cpufreq_monitor_sysfs_get_available_governors   (CPUFreqMonitor *monitor);
 
-static gchar   *cpufreq_sysfs_read                              (const gchar    *path,
-                                                                 GError        **error);
+static gssize   cpufreq_sysfs_pread                             (CPUFreqMonitorSysfs *monitor,
+                                                                 guint                cpu,
+                                                                 gint                 file,
+                                                                 gchar               *buffer,
+                                                                 gsize                size);
+static void     cpufreq_sysfs_close_files                       (CPUFreqMonitorSysfs *monitor);
 
 /* /sys/devices/system/cpu/cpu[0]/cpufreq/scaling_max_freq
  * /sys/devices/system/cpu/cpu[0]/cpufreq/scaling_min_freq
@@ -64,11 +75,62 @@ const gchar *monitor_sysfs_files[] = {
 
 #define CPUFREQ_SYSFS_BASE_PATH "/sys/devices/system/cpu/cpu%u/cpufreq/%s"
 
-G_DEFINE_TYPE (CPUFreqMonitorSysfs, cpufreq_monitor_sysfs, CPUFREQ_TYPE_MONITOR)
+/* Large enough for any of the files above */
+#define CPUFREQ_SYSFS_BUFFER_SIZE 64
+
+struct _CPUFreqMonitorSysfsPrivate {
+    /* The files of cpu, kept open between runs and
+     * reread from the start, -1 until first needed
+     */
+    gint     fds[N_FILES];
+    guint    cpu;
+    gboolean online;
+
+    /* The governor is only read again once a write to the
+     * cpufreq directory of cpu was seen. Without a watch it
+     * is read on every run.
+     */
+    gint     inotify_fd;
+    gint     watch;
+    guint    inotify_source;
+    gboolean governor_stale;
+    gchar    governor[CPUFREQ_SYSFS_BUFFER_SIZE];
+    gint     frequency_file; /* set by the governor */
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (CPUFreqMonitorSysfs, cpufreq_monitor_sysfs, CPUFREQ_TYPE_MONITOR)
 
 static void
 cpufreq_monitor_sysfs_init (CPUFreqMonitorSysfs *monitor)
 {
+    gint i;
+
+    monitor->priv = cpufreq_monitor_sysfs_get_instance_private (monitor);
+
+    for (i = 0; i < N_FILES; i++)
+        monitor->priv->fds[i] = -1;
+    monitor->priv->online = FALSE;
+
+    monitor->priv->inotify_fd = -1;
+    monitor->priv->watch = -1;
+    monitor->priv->inotify_source = 0;
+    monitor->priv->governor_stale = TRUE;
+    monitor->priv->frequency_file = SCALING_CUR_FREQ;
+}
+
+static void
+cpufreq_monitor_sysfs_finalize (GObject *object)
+{
+    CPUFreqMonitorSysfs *monitor = CPUFREQ_MONITOR_SYSFS (object);
+
+    cpufreq_sysfs_close_files (monitor);
+
+    if (monitor->priv->inotify_source > 0)
+        g_source_remove (monitor->priv->inotify_source);
+    if (monitor->priv->inotify_fd >= 0)
+        close (monitor->priv->inotify_fd);
+
+    G_OBJECT_CLASS (cpufreq_monitor_sysfs_parent_class)->finalize (object);
 }
 
 static GObject *
@@ -77,11 +139,9 @@ cpufreq_monitor_sysfs_constructor (GType                  type,
                                    GObjectConstructParam *construct_params)
 {
     GObject *object;
-    gchar   *path;
-    gchar   *frequency;
+    gchar    frequency[CPUFREQ_SYSFS_BUFFER_SIZE];
     gint     max_freq;
     guint    cpu;
-    GError  *error = NULL;
 
     object =
         G_OBJECT_CLASS (cpufreq_monitor_sysfs_parent_class)
@@ -93,20 +153,17 @@ cpufreq_monitor_sysfs_constructor (GType                  type,
                   "cpu", &cpu,
                   NULL);
 
-    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                            cpu, monitor_sysfs_files[CPUINFO_MAX]);
-
-    frequency = cpufreq_sysfs_read (path, &error);
-    if (!frequency) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
+    if (cpufreq_sysfs_pread (CPUFREQ_MONITOR_SYSFS (object), cpu,
+                             CPUINFO_MAX, frequency, sizeof (frequency)) < 0) {
+        g_warning ("Failed to read file '" CPUFREQ_SYSFS_BASE_PATH "': %s",
+                   cpu, monitor_sysfs_files[CPUINFO_MAX], g_strerror (errno));
         max_freq = -1;
     } else {
         max_freq = atoi (frequency);
     }
 
-    g_free (path);
-    g_free (frequency);
+    /* Only read once */
+    cpufreq_sysfs_close_files (CPUFREQ_MONITOR_SYSFS (object));
 
     g_object_set (G_OBJECT (object),
                   "max-frequency", max_freq,
@@ -122,6 +179,7 @@ cpufreq_monitor_sysfs_class_init (CPUFreqMonitorSysfsClass *klass)
     CPUFreqMonitorClass *monitor_class = CPUFREQ_MONITOR_CLASS (klass);
 
     object_class->constructor = cpufreq_monitor_sysfs_constructor;
+    object_class->finalize = cpufreq_monitor_sysfs_finalize;
 
     monitor_class->run = cpufreq_monitor_sysfs_run;
     monitor_class->get_available_frequencies = cpufreq_monitor_sysfs_get_available_frequencies;
@@ -139,19 +197,6 @@ cpufreq_monitor_sysfs_new (guint cpu)
     return CPUFREQ_MONITOR (monitor);
 }
 
-static gchar *
-cpufreq_sysfs_read (const gchar *path,
-                    GError     **error)
-{
-    gchar *buffer = NULL;
-
-    if (!cpufreq_file_get_contents (path, &buffer, NULL, error)) {
-        return NULL;
-    }
-
-    return g_strchomp (buffer);
-}
-
 static gboolean
 cpufreq_sysfs_cpu_is_online (guint cpu)
 {
@@ -165,77 +210,189 @@ cpufreq_sysfs_cpu_is_online (guint cpu)
     return retval;
 }
 
+static void
+cpufreq_sysfs_close_files (CPUFreqMonitorSysfs *monitor)
+{
+    gint i;
+
+    for (i = 0; i < N_FILES; i++) {
+        if (monitor->priv->fds[i] >= 0) {
+            close (monitor->priv->fds[i]);
+            monitor->priv->fds[i] = -1;
+        }
+    }
+
+    if (monitor->priv->watch >= 0) {
+        inotify_rm_watch (monitor->priv->inotify_fd, monitor->priv->watch);
+        monitor->priv->watch = -1;
+    }
+    monitor->priv->governor_stale = TRUE;
+}
+
+static gboolean
+cpufreq_sysfs_inotify_cb (gint         fd,
+                          GIOCondition condition,
+                          gpointer     user_data)
+{
+    CPUFreqMonitorSysfs *monitor = CPUFREQ_MONITOR_SYSFS (user_data);
+    gchar                buffer[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    gssize               len;
+
+    while ((len = read (fd, buffer, sizeof (buffer))) > 0) {
+        gchar *p;
+
+        for (p = buffer; p < buffer + len; p += sizeof (struct inotify_event) + ((struct inotify_event *) p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+
+            /* The directory went away with the cpu */
+            if (event->mask & IN_IGNORED && event->wd == monitor->priv->watch)
+                monitor->priv->watch = -1;
+        }
+
+        /* Any write may have changed the governor or the limits */
+        monitor->priv->governor_stale = TRUE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+cpufreq_sysfs_watch (CPUFreqMonitorSysfs *monitor,
+                     guint                cpu)
+{
+    gchar path[64];
+
+    if (monitor->priv->inotify_fd < 0) {
+        monitor->priv->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+        if (monitor->priv->inotify_fd < 0)
+            return;
+
+        monitor->priv->inotify_source =
+            g_unix_fd_add (monitor->priv->inotify_fd, G_IO_IN,
+                           cpufreq_sysfs_inotify_cb, monitor);
+    }
+
+    g_snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%u/cpufreq", cpu);
+    monitor->priv->watch = inotify_add_watch (monitor->priv->inotify_fd, path,
+                                              IN_MODIFY | IN_ATTRIB);
+}
+
+/* Reads file of cpu into buffer without the trailing new line,
+ * opening it on the first read. Returns the length read, or -1
+ * with errno set, in which case the file is closed to be opened
+ * again on the next read.
+ */
+static gssize
+cpufreq_sysfs_pread (CPUFreqMonitorSysfs *monitor,
+                     guint                cpu,
+                     gint                 file,
+                     gchar               *buffer,
+                     gsize                size)
+{
+    gint *fd = &monitor->priv->fds[file];
+
+    if (cpu != monitor->priv->cpu) {
+        cpufreq_sysfs_close_files (monitor);
+        monitor->priv->cpu = cpu;
+    }
+
+    if (*fd < 0) {
+        gchar path[128];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_SYSFS_BASE_PATH,
+                    cpu, monitor_sysfs_files[file]);
+        *fd = sampler_open (path);
+    }
+
+    return sampler_pread (fd, buffer, size);
+}
+
 static gboolean
 cpufreq_monitor_sysfs_run (CPUFreqMonitor *monitor)
 {
-    guint   cpu;
-    gchar  *frequency;
-    gchar  *governor;
-    gchar  *path;
-    GError *error = NULL;
+    CPUFreqMonitorSysfs        *sysfs = CPUFREQ_MONITOR_SYSFS (monitor);
+    CPUFreqMonitorSysfsPrivate *priv = sysfs->priv;
+    gchar                      *governor = priv->governor;
+    guint                       cpu;
+    gint                        file;
+    gint                        frequency;
+    gboolean                    governor_changed = FALSE;
+    gchar                       buffer[CPUFREQ_SYSFS_BUFFER_SIZE];
+
+    cpu = cpufreq_monitor_get_cpu (monitor);
+
+    if (cpu != priv->cpu) {
+        cpufreq_sysfs_close_files (sysfs);
+        priv->cpu = cpu;
+    }
 
-    g_object_get (G_OBJECT (monitor),
-                  "cpu", &cpu,
-                  NULL);
+    /* Watch before reading, so that no change is missed */
+    if (priv->watch < 0)
+        cpufreq_sysfs_watch (sysfs, cpu);
 
-    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                            cpu, monitor_sysfs_files[GOVERNOR]);
-    governor = cpufreq_sysfs_read (path, &error);
-    if (!governor) {
-        gboolean retval = FALSE;
+    if ((priv->governor_stale || priv->watch < 0) &&
+        cpufreq_sysfs_pread (sysfs, cpu, GOVERNOR, buffer, sizeof (buffer)) < 0) {
+        gint save_errno = errno;
 
         /* Check whether it failed because
          * cpu is not online.
          */
         if (!cpufreq_sysfs_cpu_is_online (cpu)) {
+            /* The files are gone with the cpu */
+            cpufreq_sysfs_close_files (sysfs);
+            sysfs->priv->online = FALSE;
             g_object_set (G_OBJECT (monitor), "online", FALSE, NULL);
-            retval = TRUE;
-        } else {
-            g_warning ("%s", error->message);
+
+            return TRUE;
         }
 
-        g_error_free (error);
-        g_free (path);
+        g_warning ("Failed to read file '" CPUFREQ_SYSFS_BASE_PATH "': %s",
+                   cpu, monitor_sysfs_files[GOVERNOR], g_strerror (save_errno));
 
-        return retval;
+        return FALSE;
     }
 
-    g_free (path);
-
-    if (g_ascii_strcasecmp (governor, "userspace") == 0) {
-        path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                                cpu, monitor_sysfs_files[SCALING_SETSPEED]);
-    } else if (g_ascii_strcasecmp (governor, "powersave") == 0) {
-        path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                                cpu, monitor_sysfs_files[SCALING_MIN]);
-    } else if (g_ascii_strcasecmp (governor, "performance") == 0) {
-        path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                                cpu, monitor_sysfs_files[SCALING_MAX]);
-    } else { /* Ondemand, Conservative, ... */
-        path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH,
-                                cpu, monitor_sysfs_files[SCALING_CUR_FREQ]);
+    if (priv->governor_stale || priv->watch < 0) {
+        priv->governor_stale = FALSE;
+
+        if (strcmp (buffer, governor) != 0) {
+            g_strlcpy (governor, buffer, sizeof (priv->governor));
+            governor_changed = TRUE;
+
+            if (g_ascii_strcasecmp (governor, "userspace") == 0) {
+                priv->frequency_file = SCALING_SETSPEED;
+            } else if (g_ascii_strcasecmp (governor, "powersave") == 0) {
+                priv->frequency_file = SCALING_MIN;
+            } else if (g_ascii_strcasecmp (governor, "performance") == 0) {
+                priv->frequency_file = SCALING_MAX;
+            } else { /* Ondemand, Conservative, ... */
+                priv->frequency_file = SCALING_CUR_FREQ;
+            }
+        }
     }
 
-    frequency = cpufreq_sysfs_read (path, &error);
-    if (!frequency) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
-        g_free (path);
-        g_free (governor);
+    file = priv->frequency_file;
+    if (cpufreq_sysfs_pread (sysfs, cpu, file, buffer, sizeof (buffer)) < 0) {
+        g_warning ("Failed to read file '" CPUFREQ_SYSFS_BASE_PATH "': %s",
+                   cpu, monitor_sysfs_files[file], g_strerror (errno));
 
         return FALSE;
     }
 
-    g_free (path);
-
-    g_object_set (G_OBJECT (monitor),
-                  "online", TRUE,
-                  "governor", governor,
-                  "frequency", atoi (frequency),
-                  NULL);
-
-    g_free (governor);
-    g_free (frequency);
+    frequency = (gint) strtol (buffer, NULL, 10);
+
+    /* Setting the properties copies the governor, only
+     * do it when something changed
+     */
+    if (!sysfs->priv->online || governor_changed ||
+        frequency != cpufreq_monitor_get_frequency (monitor)) {
+        sysfs->priv->online = TRUE;
+        g_object_set (G_OBJECT (monitor),
+                      "online", TRUE,
+                      "governor", governor,
+                      "frequency", frequency,
+                      NULL);
+    }
 
     return TRUE;
 }
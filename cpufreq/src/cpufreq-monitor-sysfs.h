@@ -35,11 +35,14 @@ G_BEGIN_DECLS
 #define CPUFREQ_IS_MONITOR_SYSFS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), CPUFREQ_TYPE_MONITOR_SYSFS))
 #define CPUFREQ_MONITOR_SYSFS_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), CPUFREQ_TYPE_MONITOR_SYSFS, CPUFreqMonitorSysfsClass))
 
-typedef struct _CPUFreqMonitorSysfs      CPUFreqMonitorSysfs;
-typedef struct _CPUFreqMonitorSysfsClass CPUFreqMonitorSysfsClass;
+typedef struct _CPUFreqMonitorSysfs        CPUFreqMonitorSysfs;
+typedef struct _CPUFreqMonitorSysfsClass   CPUFreqMonitorSysfsClass;
+typedef struct _CPUFreqMonitorSysfsPrivate CPUFreqMonitorSysfsPrivate;
 
 struct _CPUFreqMonitorSysfs {
     CPUFreqMonitor parent;
+
+    CPUFreqMonitorSysfsPrivate *priv;
 };
 
 struct _CPUFreqMonitorSysfsClass {
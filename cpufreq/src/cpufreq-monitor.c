@@ -19,10 +19,15 @@
  * Authors : Carlos García Campos <carlosgc@gnome.org>
  */
 
+#include "common/applet-probe.h"
+#include "common/sampler-tick.h"
+
 #include "cpufreq-utils.h"
 #include "cpufreq-monitor.h"
 
-#define CPUFREQ_MONITOR_INTERVAL 1
+/* Milliseconds */
+#define CPUFREQ_MONITOR_INTERVAL     1000
+#define CPUFREQ_MONITOR_MIN_INTERVAL 50
 
 /* Properties */
 enum {
@@ -32,7 +37,8 @@ enum {
     PROP_FREQUENCY,
     PROP_MAX_FREQUENCY,
     PROP_GOVERNOR,
-    PROP_DECIMAL_PLACES
+    PROP_DECIMAL_PLACES,
+    PROP_INTERVAL
 };
 
 /* Signals */
@@ -47,6 +53,7 @@ struct _CPUFreqMonitorPrivate {
     gint     cur_freq;
     gint     max_freq;
     gint     decimal_places;
+    guint    interval;
     gchar   *governor;
     GList   *available_freqs;
     GList   *available_govs;
@@ -79,6 +86,7 @@ cpufreq_monitor_init (CPUFreqMonitor *monitor)
     monitor->priv->available_freqs = NULL;
     monitor->priv->available_govs = NULL;
     monitor->priv->timeout_handler = 0;
+    monitor->priv->interval = CPUFREQ_MONITOR_INTERVAL;
 
     monitor->priv->changed = FALSE;
 }
@@ -149,6 +157,15 @@ cpufreq_monitor_class_init (CPUFreqMonitorClass *klass)
                                                           "The current cpufreq governor",
                                                           NULL,
                                                           G_PARAM_READWRITE));
+    g_object_class_install_property (object_class,
+                                     PROP_INTERVAL,
+                                     g_param_spec_uint ("interval",
+                                                        "Interval",
+                                                        "The time between runs, in milliseconds",
+                                                        CPUFREQ_MONITOR_MIN_INTERVAL,
+                                                        G_MAXUINT,
+                                                        CPUFREQ_MONITOR_INTERVAL,
+                                                        G_PARAM_READWRITE));
 
     /* Signals */
     signals[SIGNAL_CHANGED] =
@@ -210,6 +227,12 @@ cpufreq_monitor_set_property (GObject      *object,
         if (cpu != monitor->priv->cpu) {
             monitor->priv->cpu = cpu;
             monitor->priv->changed = TRUE;
+
+            /* Another cpu may have other ones */
+            g_list_free_full (monitor->priv->available_freqs, g_free);
+            monitor->priv->available_freqs = NULL;
+            g_list_free_full (monitor->priv->available_govs, g_free);
+            monitor->priv->available_govs = NULL;
         }
         break;
     }
@@ -259,6 +282,21 @@ cpufreq_monitor_set_property (GObject      *object,
         }
         break;
     }
+    case PROP_INTERVAL: {
+        guint interval = g_value_get_uint (value);
+
+        if (interval != monitor->priv->interval) {
+            monitor->priv->interval = interval;
+
+            /* Restart with the new interval */
+            if (monitor->priv->timeout_handler > 0) {
+                g_source_remove (monitor->priv->timeout_handler);
+                monitor->priv->timeout_handler = 0;
+                cpufreq_monitor_run (monitor);
+            }
+        }
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
     }
@@ -293,6 +331,9 @@ cpufreq_monitor_get_property (GObject    *object,
     case PROP_GOVERNOR:
         g_value_set_string (value, monitor->priv->governor);
         break;
+    case PROP_INTERVAL:
+        g_value_set_uint (value, monitor->priv->interval);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
     }
@@ -301,6 +342,8 @@ cpufreq_monitor_get_property (GObject    *object,
 static gboolean
 cpufreq_monitor_run_cb (CPUFreqMonitor *monitor)
 {
+    static AppletProbe  *probe = NULL;
+    gint64               start = applet_probe_begin (&probe, "cpufreq:cpufreq_monitor_run_cb");
     CPUFreqMonitorClass *class;
     gboolean             retval = FALSE;
 
@@ -314,6 +357,8 @@ cpufreq_monitor_run_cb (CPUFreqMonitor *monitor)
         monitor->priv->changed = FALSE;
     }
 
+    applet_probe_end (probe, start);
+
     return retval;
 }
 
@@ -326,9 +371,9 @@ cpufreq_monitor_run (CPUFreqMonitor *monitor)
         return;
 
     monitor->priv->timeout_handler =
-        g_timeout_add_seconds (CPUFREQ_MONITOR_INTERVAL,
-                               (GSourceFunc) cpufreq_monitor_run_cb,
-                               (gpointer) monitor);
+        sampler_tick_add (monitor->priv->interval,
+                          (GSourceFunc) cpufreq_monitor_run_cb,
+                          (gpointer) monitor);
 }
 
 GList *
@@ -367,8 +412,11 @@ cpufreq_monitor_get_available_governors (CPUFreqMonitor *monitor)
 
     class = CPUFREQ_MONITOR_GET_CLASS (monitor);
 
+    /* Sorted once here, callers must not reorder the list */
     if (class->get_available_governors) {
-        monitor->priv->available_govs = class->get_available_governors (monitor);
+        monitor->priv->available_govs =
+            g_list_sort (class->get_available_governors (monitor),
+                         (GCompareFunc) g_ascii_strcasecmp);
     }
 
     return monitor->priv->available_govs;
@@ -435,3 +483,28 @@ cpufreq_monitor_set_decimal_places (CPUFreqMonitor *monitor, gint decimal_places
     g_object_set (G_OBJECT (monitor),
                   "decimal-places", decimal_places, NULL);
 }
+
+void
+cpufreq_monitor_set_changed (CPUFreqMonitor *monitor)
+{
+    g_return_if_fail (CPUFREQ_IS_MONITOR (monitor));
+
+    monitor->priv->changed = TRUE;
+}
+
+guint
+cpufreq_monitor_get_interval (CPUFreqMonitor *monitor)
+{
+    g_return_val_if_fail (CPUFREQ_IS_MONITOR (monitor), CPUFREQ_MONITOR_INTERVAL);
+
+    return monitor->priv->interval;
+}
+
+void
+cpufreq_monitor_set_interval (CPUFreqMonitor *monitor, guint interval)
+{
+    g_return_if_fail (CPUFREQ_IS_MONITOR (monitor));
+
+    g_object_set (G_OBJECT (monitor),
+                  "interval", MAX (interval, CPUFREQ_MONITOR_MIN_INTERVAL), NULL);
+}
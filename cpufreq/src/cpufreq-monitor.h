@@ -57,6 +57,7 @@ struct _CPUFreqMonitorClass {
 GType        cpufreq_monitor_get_type                  (void) G_GNUC_CONST;
 
 void         cpufreq_monitor_run                       (CPUFreqMonitor *monitor);
+/* Read once per cpu, and owned by the monitor */
 GList       *cpufreq_monitor_get_available_frequencies (CPUFreqMonitor *monitor);
 GList       *cpufreq_monitor_get_available_governors   (CPUFreqMonitor *monitor);
 
@@ -68,6 +69,12 @@ gint         cpufreq_monitor_get_frequency             (CPUFreqMonitor *monitor)
 gint         cpufreq_monitor_get_percentage            (CPUFreqMonitor *monitor);
 gint         cpufreq_monitor_get_decimal_places        (CPUFreqMonitor *monitor);
 void         cpufreq_monitor_set_decimal_places        (CPUFreqMonitor *monitor, gint decimal_places);
+guint        cpufreq_monitor_get_interval              (CPUFreqMonitor *monitor);
+void         cpufreq_monitor_set_interval              (CPUFreqMonitor *monitor, guint interval);
+
+/* For subclasses with state other than the properties, emits
+ * changed at the end of the run */
+void         cpufreq_monitor_set_changed               (CPUFreqMonitor *monitor);
 
 G_END_DECLS
 
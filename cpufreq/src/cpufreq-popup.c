@@ -41,9 +41,12 @@ struct _CPUFreqPopupPrivate {
     GSList              *govs_actions;
 
     guint                merge_id;
-    gboolean             need_build;
     gboolean             show_freqs;
 
+    /* the lists the menu was built for */
+    gchar               *freqs_key;
+    gchar               *govs_key;
+
     CPUFreqMonitor      *monitor;
     GtkWidget           *parent;
 };
@@ -81,13 +84,18 @@ cpufreq_popup_init (CPUFreqPopup *popup)
     popup->priv->govs_actions = NULL;
 
     popup->priv->merge_id = 0;
-    popup->priv->need_build = TRUE;
     popup->priv->show_freqs = FALSE;
 
+    popup->priv->freqs_key = NULL;
+    popup->priv->govs_key = NULL;
+
     gtk_ui_manager_add_ui_from_string (popup->priv->ui_manager,
                                        ui_popup, -1, NULL);
 
     popup->priv->monitor = NULL;
+
+    /* the selector connects at idle, while the menu is up */
+    cpufreq_selector_get_default ();
 }
 
 static void
@@ -128,6 +136,11 @@ cpufreq_popup_finalize (GObject *object)
         popup->priv->govs_actions = NULL;
     }
 
+    g_free (popup->priv->freqs_key);
+    popup->priv->freqs_key = NULL;
+    g_free (popup->priv->govs_key);
+    popup->priv->govs_key = NULL;
+
     if (popup->priv->monitor) {
         g_object_unref (popup->priv->monitor);
         popup->priv->monitor = NULL;
@@ -303,7 +316,6 @@ governors_menu_create_actions (CPUFreqPopup *popup)
     GList *available_govs;
 
     available_govs = cpufreq_monitor_get_available_governors (popup->priv->monitor);
-    available_govs = g_list_sort (available_govs, (GCompareFunc)g_ascii_strcasecmp);
 
     while (available_govs) {
         const gchar *governor;
@@ -404,15 +416,57 @@ cpufreq_popup_build_governors_menu (CPUFreqPopup *popup,
                             path);
 }
 
+/* Drops the menu items and their actions, for lists that changed */
 static void
-cpufreq_popup_build_menu (CPUFreqPopup *popup)
+cpufreq_popup_clear_menu (CPUFreqPopup *popup)
 {
     if (popup->priv->merge_id > 0) {
         gtk_ui_manager_remove_ui (popup->priv->ui_manager,
                                   popup->priv->merge_id);
         gtk_ui_manager_ensure_update (popup->priv->ui_manager);
+        popup->priv->merge_id = 0;
+    }
+
+    if (popup->priv->freqs_group) {
+        gtk_ui_manager_remove_action_group (popup->priv->ui_manager,
+                                            popup->priv->freqs_group);
+        g_object_unref (popup->priv->freqs_group);
+        popup->priv->freqs_group = NULL;
+    }
+
+    if (popup->priv->govs_group) {
+        gtk_ui_manager_remove_action_group (popup->priv->ui_manager,
+                                            popup->priv->govs_group);
+        g_object_unref (popup->priv->govs_group);
+        popup->priv->govs_group = NULL;
+    }
+
+    g_slist_free (popup->priv->freqs_actions);
+    popup->priv->freqs_actions = NULL;
+    g_slist_free (popup->priv->govs_actions);
+    popup->priv->govs_actions = NULL;
+
+    popup->priv->radio_group = NULL;
+    popup->priv->show_freqs = FALSE;
+}
+
+static gchar *
+cpufreq_popup_list_key (GList *list)
+{
+    GString *key;
+
+    key = g_string_new (NULL);
+    for (; list; list = g_list_next (list)) {
+        g_string_append (key, (const gchar *) list->data);
+        g_string_append_c (key, ' ');
     }
 
+    return g_string_free (key, FALSE);
+}
+
+static void
+cpufreq_popup_build_menu (CPUFreqPopup *popup)
+{
     popup->priv->merge_id = gtk_ui_manager_new_merge_id (popup->priv->ui_manager);
 
     cpufreq_popup_build_frequencies_menu (popup, FREQS_PLACEHOLDER_PATH);
@@ -422,6 +476,35 @@ cpufreq_popup_build_menu (CPUFreqPopup *popup)
                                   popup->priv->show_freqs);
 }
 
+/* The menu is only built again when the available
+ * frequencies or governors are not the same anymore
+ */
+static void
+cpufreq_popup_update_menu (CPUFreqPopup *popup)
+{
+    gchar *freqs_key;
+    gchar *govs_key;
+
+    freqs_key = cpufreq_popup_list_key (cpufreq_monitor_get_available_frequencies (popup->priv->monitor));
+    govs_key = cpufreq_popup_list_key (cpufreq_monitor_get_available_governors (popup->priv->monitor));
+
+    if (g_strcmp0 (freqs_key, popup->priv->freqs_key) == 0 &&
+        g_strcmp0 (govs_key, popup->priv->govs_key) == 0) {
+        g_free (freqs_key);
+        g_free (govs_key);
+
+        return;
+    }
+
+    g_free (popup->priv->freqs_key);
+    popup->priv->freqs_key = freqs_key;
+    g_free (popup->priv->govs_key);
+    popup->priv->govs_key = govs_key;
+
+    cpufreq_popup_clear_menu (popup);
+    cpufreq_popup_build_menu (popup);
+}
+
 static void
 cpufreq_popup_menu_set_active_action (CPUFreqPopup   *popup,
                                       GtkActionGroup *action_group,
@@ -495,10 +578,7 @@ cpufreq_popup_get_menu (CPUFreqPopup *popup)
     if (!cpufreq_utils_selector_is_available ())
         return NULL;
 
-    if (popup->priv->need_build) {
-        cpufreq_popup_build_menu (popup);
-        popup->priv->need_build = FALSE;
-    }
+    cpufreq_popup_update_menu (popup);
 
     cpufreq_popup_menu_set_active (popup);
 
@@ -33,6 +33,9 @@
 enum {
     PROP_0,
     PROP_CPU,
+    PROP_ALL_CPUS,
+    PROP_EFFECTIVE_FREQUENCY,
+    PROP_INTERVAL,
     PROP_SHOW_MODE,
     PROP_SHOW_TEXT_MODE,
     PROP_DECIMAL_PLACES,
@@ -42,6 +45,9 @@ struct _CPUFreqPrefsPrivate {
     GSettings          *settings;
 
     guint               cpu;
+    gboolean            all_cpus;
+    gboolean            effective_frequency;
+    guint               interval;
     CPUFreqShowMode     show_mode;
     CPUFreqShowTextMode show_text_mode;
     guint               decimal_places;
@@ -102,6 +108,29 @@ cpufreq_prefs_class_init (CPUFreqPrefsClass *klass)
                                                         G_MAXUINT,
                                                         0,
                                                         G_PARAM_READWRITE));
+    g_object_class_install_property (g_object_class,
+                                     PROP_ALL_CPUS,
+                                     g_param_spec_boolean ("all-cpus",
+                                                           "AllCPUs",
+                                                           "Whether all cpus are monitored",
+                                                           FALSE,
+                                                           G_PARAM_READWRITE));
+    g_object_class_install_property (g_object_class,
+                                     PROP_EFFECTIVE_FREQUENCY,
+                                     g_param_spec_boolean ("effective-frequency",
+                                                           "EffectiveFrequency",
+                                                           "Whether the effective frequency is monitored",
+                                                           FALSE,
+                                                           G_PARAM_READWRITE));
+    g_object_class_install_property (g_object_class,
+                                     PROP_INTERVAL,
+                                     g_param_spec_uint ("interval",
+                                                        "Interval",
+                                                        "The update interval in milliseconds",
+                                                        50,
+                                                        60000,
+                                                        1000,
+                                                        G_PARAM_READWRITE));
     g_object_class_install_property (g_object_class,
                                      PROP_SHOW_MODE,
                                      g_param_spec_enum ("show-mode",
@@ -170,6 +199,39 @@ cpufreq_prefs_set_property (GObject      *object,
         }
         break;
     }
+    case PROP_ALL_CPUS: {
+        gboolean all_cpus;
+
+        all_cpus = g_value_get_boolean (value);
+        if (prefs->priv->all_cpus != all_cpus) {
+            prefs->priv->all_cpus = all_cpus;
+            g_settings_set_boolean (prefs->priv->settings,
+                                    "all-cpus", all_cpus);
+        }
+        break;
+    }
+    case PROP_EFFECTIVE_FREQUENCY: {
+        gboolean effective_frequency;
+
+        effective_frequency = g_value_get_boolean (value);
+        if (prefs->priv->effective_frequency != effective_frequency) {
+            prefs->priv->effective_frequency = effective_frequency;
+            g_settings_set_boolean (prefs->priv->settings,
+                                    "effective-frequency", effective_frequency);
+        }
+        break;
+    }
+    case PROP_INTERVAL: {
+        guint interval;
+
+        interval = g_value_get_uint (value);
+        if (prefs->priv->interval != interval) {
+            prefs->priv->interval = interval;
+            g_settings_set_int (prefs->priv->settings,
+                                "interval", interval);
+        }
+        break;
+    }
     case PROP_SHOW_MODE: {
         CPUFreqShowMode mode;
 
@@ -225,6 +287,15 @@ cpufreq_prefs_get_property (GObject    *object,
     case PROP_CPU:
         g_value_set_uint (value, prefs->priv->cpu);
         break;
+    case PROP_ALL_CPUS:
+        g_value_set_boolean (value, prefs->priv->all_cpus);
+        break;
+    case PROP_EFFECTIVE_FREQUENCY:
+        g_value_set_boolean (value, prefs->priv->effective_frequency);
+        break;
+    case PROP_INTERVAL:
+        g_value_set_uint (value, prefs->priv->interval);
+        break;
     case PROP_SHOW_MODE:
         g_value_set_enum (value, prefs->priv->show_mode);
         break;
@@ -239,12 +310,39 @@ cpufreq_prefs_get_property (GObject    *object,
     }
 }
 
+/* The keys without a widget in the dialog, for tuning */
+static void
+cpufreq_prefs_settings_changed (GSettings    *settings,
+                                const gchar  *key,
+                                CPUFreqPrefs *prefs)
+{
+    if (g_strcmp0 (key, "effective-frequency") == 0) {
+        g_object_set (G_OBJECT (prefs),
+                      "effective-frequency", g_settings_get_boolean (settings, key),
+                      NULL);
+    } else if (g_strcmp0 (key, "interval") == 0) {
+        g_object_set (G_OBJECT (prefs),
+                      "interval", (guint) g_settings_get_int (settings, key),
+                      NULL);
+    }
+}
+
 static void
 cpufreq_prefs_setup (CPUFreqPrefs *prefs)
 {
     g_assert (G_IS_SETTINGS (prefs->priv->settings));
 
     prefs->priv->cpu = g_settings_get_int (prefs->priv->settings, "cpu");
+    prefs->priv->all_cpus = g_settings_get_boolean (prefs->priv->settings, "all-cpus");
+    prefs->priv->effective_frequency = g_settings_get_boolean (prefs->priv->settings, "effective-frequency");
+    prefs->priv->interval = g_settings_get_int (prefs->priv->settings, "interval");
+
+    g_signal_connect (prefs->priv->settings, "changed::effective-frequency",
+                      G_CALLBACK (cpufreq_prefs_settings_changed),
+                      prefs);
+    g_signal_connect (prefs->priv->settings, "changed::interval",
+                      G_CALLBACK (cpufreq_prefs_settings_changed),
+                      prefs);
     prefs->priv->show_mode = g_settings_get_int (prefs->priv->settings, "show-mode");
     prefs->priv->show_text_mode = g_settings_get_int (prefs->priv->settings, "show-text-mode");
     prefs->priv->decimal_places = g_settings_get_int (prefs->priv->settings, "decimal-places");
@@ -274,6 +372,30 @@ cpufreq_prefs_get_cpu (CPUFreqPrefs *prefs)
     return MIN (prefs->priv->cpu, cpufreq_utils_get_n_cpus () - 1);
 }
 
+gboolean
+cpufreq_prefs_get_all_cpus (CPUFreqPrefs *prefs)
+{
+    g_return_val_if_fail (CPUFREQ_IS_PREFS (prefs), FALSE);
+
+    return prefs->priv->all_cpus;
+}
+
+gboolean
+cpufreq_prefs_get_effective_frequency (CPUFreqPrefs *prefs)
+{
+    g_return_val_if_fail (CPUFREQ_IS_PREFS (prefs), FALSE);
+
+    return prefs->priv->effective_frequency;
+}
+
+guint
+cpufreq_prefs_get_interval (CPUFreqPrefs *prefs)
+{
+    g_return_val_if_fail (CPUFREQ_IS_PREFS (prefs), 1000);
+
+    return prefs->priv->interval;
+}
+
 CPUFreqShowMode
 cpufreq_prefs_get_show_mode (CPUFreqPrefs *prefs)
 {
@@ -363,8 +485,14 @@ cpufreq_prefs_dialog_cpu_number_changed (GtkWidget    *cpu_combo,
 
     cpu = gtk_combo_box_get_active (GTK_COMBO_BOX (prefs->priv->cpu_combo));
 
-    if (cpu >= 0) {
+    /* The last row, after the cpus, stands for all of them */
+    if (cpu >= (gint) cpufreq_utils_get_n_cpus ()) {
         g_object_set (G_OBJECT (prefs),
+                      "all-cpus", TRUE,
+                      NULL);
+    } else if (cpu >= 0) {
+        g_object_set (G_OBJECT (prefs),
+                      "all-cpus", FALSE,
                       "cpu", cpu,
                       NULL);
     }
@@ -437,7 +565,9 @@ cpufreq_prefs_dialog_update_sensitivity (CPUFreqPrefs *prefs)
                               g_settings_is_writable (prefs->priv->settings,
                                                       "show-mode"));
 
-    if (prefs->priv->show_mode != CPUFREQ_MODE_GRAPHIC) {
+    /* The idle states have a text of their own */
+    if (prefs->priv->show_mode != CPUFREQ_MODE_GRAPHIC &&
+        prefs->priv->show_mode != CPUFREQ_MODE_IDLE) {
         gboolean key_writable;
 
         key_writable = g_settings_is_writable (prefs->priv->settings,
@@ -482,6 +612,8 @@ cpufreq_prefs_dialog_update (CPUFreqPrefs *prefs)
 {
     if (cpufreq_utils_get_n_cpus () > 1) {
         gtk_combo_box_set_active (GTK_COMBO_BOX (prefs->priv->cpu_combo),
+                                  prefs->priv->all_cpus ?
+                                  cpufreq_utils_get_n_cpus () :
                                   MIN (prefs->priv->cpu,
                                   cpufreq_utils_get_n_cpus () - 1));
     }
@@ -546,6 +678,11 @@ cpufreq_prefs_dialog_cpu_combo_setup (CPUFreqPrefs *prefs)
         g_free (text_label);
     }
 
+    gtk_list_store_append (model, &iter);
+    gtk_list_store_set (model, &iter,
+                        0, _("All CPUs"),
+                        -1);
+
     g_object_unref (model);
 
     renderer = gtk_cell_renderer_text_new ();
@@ -652,6 +789,11 @@ cpufreq_prefs_dialog_show_mode_combo_setup (CPUFreqPrefs *prefs)
                         0, _("Graphic and Text"),
                         -1);
 
+    gtk_list_store_append (model, &iter);
+    gtk_list_store_set (model, &iter,
+                        0, _("Idle States"),
+                        -1);
+
     g_object_unref (model);
 
     renderer = gtk_cell_renderer_text_new ();
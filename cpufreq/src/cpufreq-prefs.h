@@ -55,6 +55,9 @@ GType               cpufreq_prefs_get_type           (void) G_GNUC_CONST;
 CPUFreqPrefs       *cpufreq_prefs_new                (GSettings *settings);
 
 guint               cpufreq_prefs_get_cpu            (CPUFreqPrefs *prefs);
+gboolean            cpufreq_prefs_get_all_cpus       (CPUFreqPrefs *prefs);
+gboolean            cpufreq_prefs_get_effective_frequency (CPUFreqPrefs *prefs);
+guint               cpufreq_prefs_get_interval       (CPUFreqPrefs *prefs);
 CPUFreqShowMode     cpufreq_prefs_get_show_mode      (CPUFreqPrefs *prefs);
 CPUFreqShowTextMode cpufreq_prefs_get_show_text_mode (CPUFreqPrefs *prefs);
 guint               cpufreq_prefs_get_decimal_places (CPUFreqPrefs *prefs);
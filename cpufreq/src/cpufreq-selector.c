@@ -18,7 +18,6 @@
  */
 
 #include <config.h>
-#include <sys/sysinfo.h>
 
 #ifdef HAVE_POLKIT
 #include <gio/gio.h>
@@ -26,12 +25,30 @@
 
 #include "cpufreq-selector.h"
 
+#ifdef HAVE_POLKIT
+typedef enum {
+    NONE,
+    FREQUENCY,
+    GOVERNOR
+} CPUFreqSelectorCall;
+#endif /* HAVE_POLKIT */
+
 struct _CPUFreqSelector {
     GObject parent;
 
 #ifdef HAVE_POLKIT
     GDBusConnection *system_bus;
     GDBusProxy      *proxy;
+    GCancellable    *cancellable;   /* of the connection and the calls */
+    guint            prewarm_id;
+    gboolean         connecting;
+    gboolean         in_flight;     /* a call waits for its reply */
+
+    /* the last selection that was not sent yet, the ones before it
+     * are dropped */
+    CPUFreqSelectorCall pending;
+    guint               pending_frequency;
+    gchar              *pending_governor;
 #endif /* HAVE_POLKIT */
 };
 
@@ -41,14 +58,27 @@ struct _CPUFreqSelectorClass {
 
 G_DEFINE_TYPE (CPUFreqSelector, cpufreq_selector, G_TYPE_OBJECT)
 
+#ifdef HAVE_POLKIT
+static void cpufreq_selector_connect (CPUFreqSelector *selector);
+static gboolean cpufreq_selector_prewarm (gpointer user_data);
+#endif /* HAVE_POLKIT */
+
 static void
 cpufreq_selector_finalize (GObject *object)
 {
 #ifdef HAVE_POLKIT
     CPUFreqSelector *selector = CPUFREQ_SELECTOR (object);
 
+    if (selector->prewarm_id)
+        g_source_remove (selector->prewarm_id);
+
+    /* the callbacks of what is pending see the cancellation and leave
+     * the selector alone */
+    g_cancellable_cancel (selector->cancellable);
+    g_clear_object (&selector->cancellable);
     g_clear_object (&selector->proxy);
     g_clear_object (&selector->system_bus);
+    g_free (selector->pending_governor);
 #endif /* HAVE_POLKIT */
 
     G_OBJECT_CLASS (cpufreq_selector_parent_class)->finalize (object);
@@ -65,6 +95,16 @@ cpufreq_selector_class_init (CPUFreqSelectorClass *klass)
 static void
 cpufreq_selector_init (CPUFreqSelector *selector)
 {
+#ifdef HAVE_POLKIT
+    selector->cancellable = g_cancellable_new ();
+
+    /* The selector is first asked for when the menu is built. Starting
+     * the service is what takes the time, so it is done while the user
+     * is still choosing, without blocking the panel. */
+    selector->prewarm_id = g_idle_add_full (G_PRIORITY_LOW,
+                                            cpufreq_selector_prewarm,
+                                            selector, NULL);
+#endif /* HAVE_POLKIT */
 }
 
 CPUFreqSelector *
@@ -79,169 +119,195 @@ cpufreq_selector_get_default (void)
 }
 
 #ifdef HAVE_POLKIT
-typedef enum {
-    FREQUENCY,
-    GOVERNOR
-} CPUFreqSelectorCall;
-
-typedef struct {
-    CPUFreqSelector *selector;
-
-    CPUFreqSelectorCall call;
-
-    guint  cpu;
-    guint  frequency;
-    gchar *governor;
-
-    guint32 parent_xid;
-} SelectorAsyncData;
-
-static void
-selector_async_data_free (SelectorAsyncData *data)
+static gboolean
+cpufreq_selector_prewarm (gpointer user_data)
 {
-    if (!data)
-        return;
+    CPUFreqSelector *selector = CPUFREQ_SELECTOR (user_data);
+
+    selector->prewarm_id = 0;
+    cpufreq_selector_connect (selector);
 
-    g_free (data->governor);
-    g_free (data);
+    return G_SOURCE_REMOVE;
 }
 
+/* FALSE, having freed it, for the error of a cancelled operation */
 static gboolean
-cpufreq_selector_connect_to_system_bus (CPUFreqSelector *selector,
-                                        GError         **error)
+cpufreq_selector_check_error (GError *error)
 {
-    if (selector->system_bus)
-        return TRUE;
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return FALSE;
+    }
 
-    selector->system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+    g_warning ("%s", error->message);
+    g_error_free (error);
 
-    return (selector->system_bus != NULL);
+    return TRUE;
 }
 
-static gboolean
-cpufreq_selector_create_proxy (CPUFreqSelector  *selector,
-                               GError          **error)
+static void
+cpufreq_selector_drop_pending (CPUFreqSelector *selector)
 {
-    if (selector->proxy)
-        return TRUE;
-
-    selector->proxy = g_dbus_proxy_new_sync (selector->system_bus,
-                                             G_DBUS_PROXY_FLAGS_NONE,
-                                             NULL,
-                                             "org.mate.CPUFreqSelector",
-                                             "/org/mate/cpufreq_selector/selector",
-                                             "org.mate.CPUFreqSelector",
-                                             NULL,
-                                             error);
-
-    return (selector->proxy != NULL);
+    selector->pending = NONE;
+    g_clear_pointer (&selector->pending_governor, g_free);
 }
 
+static void cpufreq_selector_flush (CPUFreqSelector *selector);
+
 static void
 selector_setter_cb (GObject      *source,
                     GAsyncResult *result,
                     gpointer      user_data)
 {
-    GDBusProxy *proxy = G_DBUS_PROXY (source);
-    SelectorAsyncData *data = (SelectorAsyncData *)user_data;
+    CPUFreqSelector *selector;
     GError *error = NULL;
+    GVariant *reply;
 
-    g_dbus_proxy_call_finish (proxy, result, &error);
-    if (error != NULL) {
-        g_warning ("%s", error->message);
-        g_clear_error (&error);
-    }
-    selector_async_data_free (data);
+    reply = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
+    if (reply)
+        g_variant_unref (reply);
+    else if (!cpufreq_selector_check_error (error))
+        return;
+
+    selector = CPUFREQ_SELECTOR (user_data);
+    selector->in_flight = FALSE;
+
+    /* what was selected while waiting, as of an authentication dialog */
+    cpufreq_selector_flush (selector);
 }
 
+/* Sends the pending selection, one call at a time. The batch methods
+ * authorize once and set every policy. */
 static void
-selector_set_frequency_async (SelectorAsyncData *data)
+cpufreq_selector_flush (CPUFreqSelector *selector)
 {
-    GError *error = NULL;
-
-    if (!cpufreq_selector_connect_to_system_bus (data->selector, &error)) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
-
-        selector_async_data_free (data);
+    const gchar *method;
+    GVariant    *parameters;
 
+    if (selector->in_flight || !selector->proxy || selector->pending == NONE)
         return;
-    }
-
-    if (!cpufreq_selector_create_proxy (data->selector, &error)) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
 
-        selector_async_data_free (data);
-        return;
+    if (selector->pending == FREQUENCY) {
+        method = "SetFrequencyAll";
+        parameters = g_variant_new ("(u)", selector->pending_frequency);
+    } else {
+        method = "SetGovernorAll";
+        parameters = g_variant_new ("(s)", selector->pending_governor);
     }
+    cpufreq_selector_drop_pending (selector);
 
-    g_dbus_proxy_call (data->selector->proxy,
-                       "SetFrequency",
-                       g_variant_new ("(uu)",
-                                      data->cpu,
-                                      data->frequency),
+    selector->in_flight = TRUE;
+    g_dbus_proxy_call (selector->proxy,
+                       method,
+                       parameters,
                        G_DBUS_CALL_FLAGS_NONE,
                        -1,
-                       NULL,
+                       selector->cancellable,
                        selector_setter_cb,
-                       data);
+                       selector);
 }
 
-void
-cpufreq_selector_set_frequency_async (CPUFreqSelector *selector,
-                                      guint            cpu,
-                                      guint            frequency)
+static void
+selector_proxy_cb (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
 {
-    guint            cores;
-    cores = get_nprocs() ;
-    for (cpu = 0; cpu < cores; cpu = cpu+1) {
-        SelectorAsyncData *data;
+    CPUFreqSelector *selector;
+    GDBusProxy *proxy;
+    GError *error = NULL;
 
-        data = g_new0 (SelectorAsyncData, 1);
+    proxy = g_dbus_proxy_new_finish (result, &error);
+    if (!proxy && !cpufreq_selector_check_error (error))
+        return;
 
-        data->selector = selector;
-        data->call = FREQUENCY;
-        data->cpu = cpu;
-        data->frequency = frequency;
+    selector = CPUFREQ_SELECTOR (user_data);
+    selector->connecting = FALSE;
+    selector->proxy = proxy;
 
-        selector_set_frequency_async (data);
-    }
+    if (proxy)
+        cpufreq_selector_flush (selector);
+    else
+        cpufreq_selector_drop_pending (selector);
 }
 
 static void
-selector_set_governor_async (SelectorAsyncData *data)
+cpufreq_selector_create_proxy (CPUFreqSelector *selector)
 {
-    GError *error = NULL;
+    g_dbus_proxy_new (selector->system_bus,
+                      G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                      G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                      NULL,
+                      "org.mate.CPUFreqSelector",
+                      "/org/mate/cpufreq_selector/selector",
+                      "org.mate.CPUFreqSelector",
+                      selector->cancellable,
+                      selector_proxy_cb,
+                      selector);
+}
 
-    if (!cpufreq_selector_connect_to_system_bus (data->selector, &error)) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
+static void
+selector_bus_cb (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+    CPUFreqSelector *selector;
+    GDBusConnection *bus;
+    GError *error = NULL;
 
-        selector_async_data_free (data);
+    bus = g_bus_get_finish (result, &error);
+    if (!bus && !cpufreq_selector_check_error (error))
+        return;
 
+    selector = CPUFREQ_SELECTOR (user_data);
+    if (!bus) {
+        selector->connecting = FALSE;
+        cpufreq_selector_drop_pending (selector);
         return;
     }
 
-    if (!cpufreq_selector_create_proxy (data->selector, &error)) {
-        g_warning ("%s", error->message);
-        g_error_free (error);
-
-        selector_async_data_free (data);
+    selector->system_bus = bus;
+    cpufreq_selector_create_proxy (selector);
+}
 
+/* Creates the proxy once, a failure is tried again by the next selection */
+static void
+cpufreq_selector_connect (CPUFreqSelector *selector)
+{
+    if (selector->proxy || selector->connecting)
         return;
-    }
 
-    g_dbus_proxy_call (data->selector->proxy,
-                       "SetGovernor",
-                       g_variant_new ("(us)",
-                                      data->cpu,
-                                      data->governor),
-                       G_DBUS_CALL_FLAGS_NONE,
-                       -1,
-                       NULL,
-                       selector_setter_cb,
-                       data);
+    selector->connecting = TRUE;
+
+    if (selector->system_bus)
+        cpufreq_selector_create_proxy (selector);
+    else
+        g_bus_get (G_BUS_TYPE_SYSTEM, selector->cancellable,
+                   selector_bus_cb, selector);
+}
+
+static void
+cpufreq_selector_select (CPUFreqSelector    *selector,
+                         CPUFreqSelectorCall call,
+                         guint               frequency,
+                         const gchar        *governor)
+{
+    cpufreq_selector_drop_pending (selector);
+    selector->pending = call;
+    selector->pending_frequency = frequency;
+    selector->pending_governor = g_strdup (governor);
+
+    if (selector->proxy)
+        cpufreq_selector_flush (selector);
+    else
+        cpufreq_selector_connect (selector);
+}
+
+void
+cpufreq_selector_set_frequency_async (CPUFreqSelector *selector,
+                                      guint            cpu,
+                                      guint            frequency)
+{
+    cpufreq_selector_select (selector, FREQUENCY, frequency, NULL);
 }
 
 void
@@ -249,20 +315,7 @@ cpufreq_selector_set_governor_async (CPUFreqSelector *selector,
                                      guint            cpu,
                                      const gchar     *governor)
 {
-    guint            cores;
-    cores = get_nprocs() ;
-    for (cpu = 0; cpu < cores; cpu = cpu+1){
-        SelectorAsyncData *data;
-
-        data = g_new0 (SelectorAsyncData, 1);
-
-        data->selector = selector;
-        data->call = GOVERNOR;
-        data->cpu = cpu;
-        data->governor = g_strdup (governor);
-
-        selector_set_governor_async (data);
-   }
+    cpufreq_selector_select (selector, GOVERNOR, 0, governor);
 }
 #else /* !HAVE_POLKIT */
 static void
@@ -295,16 +348,12 @@ cpufreq_selector_set_frequency_async (CPUFreqSelector *selector,
                                       guint            cpu,
                                       guint            frequency)
 {
-    guint           cores;
-    cores = get_nprocs ();
-
-    for (cpu = 0; cpu < cores; cpu = cpu+1) {
-        gchar *args;
+    gchar *args;
 
-        args = g_strdup_printf ("-c %u -f %u", cpu, frequency);
-        cpufreq_selector_run_command (selector, args);
-        g_free (args);
-    }
+    /* one run sets every policy */
+    args = g_strdup_printf ("-a -f %u", frequency);
+    cpufreq_selector_run_command (selector, args);
+    g_free (args);
 }
 
 void
@@ -312,14 +361,10 @@ cpufreq_selector_set_governor_async (CPUFreqSelector *selector,
                                      guint            cpu,
                                      const gchar     *governor)
 {
-    guint            cores;
-    cores = get_nprocs() ;
-    for (cpu = 0; cpu < cores; cpu = cpu+1){
-        gchar *args;
-
-        args = g_strdup_printf ("-c %u -g %s", cpu, governor);
-        cpufreq_selector_run_command (selector, args);
-        g_free (args);
-    }
+    gchar *args;
+
+    args = g_strdup_printf ("-a -g %s", governor);
+    cpufreq_selector_run_command (selector, args);
+    g_free (args);
 }
 #endif /* HAVE_POLKIT */
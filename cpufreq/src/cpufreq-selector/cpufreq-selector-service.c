@@ -28,16 +28,28 @@
 
 #define MAX_CPUS 255
 
+/* how long an authorization is trusted for the same caller, as polkit
+ * keeps an auth_admin_keep authorization */
+#define AUTHORIZATION_TIMEOUT (5 * 60)
+
+/* how long the service waits for another request before it exits */
+#define DEFAULT_IDLE_TIMEOUT 30
+
 struct _CPUFreqSelectorService {
     GObject parent;
 
     CPUFreqSelector *selectors[MAX_CPUS];
     gint             selectors_max;
 
+    guint            idle_timeout;
+    guint            killtimer_id;
+
     DBusGConnection *system_bus;
+    DBusGProxy      *bus_proxy;     /* for NameOwnerChanged */
 
     /* PolicyKit */
     PolkitAuthority   *authority;
+    GHashTable        *authorized;    /* sender -> expiry time */
 };
 
 struct _CPUFreqSelectorServiceClass {
@@ -88,8 +100,18 @@ cpufreq_selector_service_finalize (GObject *object)
 
     service->system_bus = NULL;
 
+    if (service->bus_proxy) {
+        g_object_unref (service->bus_proxy);
+        service->bus_proxy = NULL;
+    }
+
+    if (service->killtimer_id > 0) {
+        g_source_remove (service->killtimer_id);
+        service->killtimer_id = 0;
+    }
+
     if (service->selectors_max >= 0) {
-        for (i = 0; i < service->selectors_max; i++) {
+        for (i = 0; i <= service->selectors_max; i++) {
             if (service->selectors[i]) {
                 g_object_unref (service->selectors[i]);
                 service->selectors[i] = NULL;
@@ -104,6 +126,11 @@ cpufreq_selector_service_finalize (GObject *object)
         service->authority = NULL;
     }
 
+    if (service->authorized) {
+        g_hash_table_destroy (service->authorized);
+        service->authorized = NULL;
+    }
+
     G_OBJECT_CLASS (cpufreq_selector_service_parent_class)->finalize (object);
 }
 
@@ -119,6 +146,9 @@ static void
 cpufreq_selector_service_init (CPUFreqSelectorService *service)
 {
     service->selectors_max = -1;
+    service->idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    service->authorized = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, g_free);
 }
 
 CPUFreqSelectorService *
@@ -133,24 +163,52 @@ cpufreq_selector_service_get_instance (void)
 }
 
 static gboolean
-service_shutdown (gpointer user_data)
+service_shutdown (CPUFreqSelectorService *service)
 {
-    g_object_unref (SELECTOR_SERVICE);
+    service->killtimer_id = 0;
+    g_object_unref (service);
 
     return FALSE;
 }
 
 static void
-reset_killtimer (void)
+reset_killtimer (CPUFreqSelectorService *service)
 {
-    static guint timer_id = 0;
+    if (service->killtimer_id > 0) {
+        g_source_remove (service->killtimer_id);
+        service->killtimer_id = 0;
+    }
 
-    if (timer_id > 0)
-        g_source_remove (timer_id);
+    /* the selectors keep their sysfs files open while the service
+     * lives, a timeout of 0 keeps it running for good */
+    if (service->idle_timeout == 0)
+        return;
 
-    timer_id = g_timeout_add_seconds (30,
-                                      (GSourceFunc) service_shutdown,
-                                      NULL);
+    service->killtimer_id = g_timeout_add_seconds (service->idle_timeout,
+                                                   (GSourceFunc) service_shutdown,
+                                                   service);
+}
+
+void
+cpufreq_selector_service_set_idle_timeout (CPUFreqSelectorService *service,
+                                           guint                   seconds)
+{
+    service->idle_timeout = seconds;
+
+    if (service->system_bus)
+        reset_killtimer (service);
+}
+
+/* The authorization of a caller goes with its connection */
+static void
+name_owner_changed_cb (DBusGProxy             *proxy,
+                       const gchar            *name,
+                       const gchar            *old_owner,
+                       const gchar            *new_owner,
+                       CPUFreqSelectorService *service)
+{
+    if (new_owner == NULL || *new_owner == '\0')
+        g_hash_table_remove (service->authorized, name);
 }
 
 gboolean
@@ -235,6 +293,19 @@ cpufreq_selector_service_register (CPUFreqSelectorService *service,
 
     service->system_bus = connection;
 
+    service->bus_proxy = dbus_g_proxy_new_for_name (connection,
+                                                    DBUS_SERVICE_DBUS,
+                                                    DBUS_PATH_DBUS,
+                                                    DBUS_INTERFACE_DBUS);
+    if (service->bus_proxy) {
+        dbus_g_proxy_add_signal (service->bus_proxy, "NameOwnerChanged",
+                                 G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
+                                 G_TYPE_INVALID);
+        dbus_g_proxy_connect_signal (service->bus_proxy, "NameOwnerChanged",
+                                     G_CALLBACK (name_owner_changed_cb),
+                                     service, NULL);
+    }
+
     dbus_g_object_type_install_info (CPUFREQ_TYPE_SELECTOR_SERVICE,
                                      &dbus_glib_cpufreq_selector_service_object_info);
     dbus_g_connection_register_g_object (connection,
@@ -243,7 +314,7 @@ cpufreq_selector_service_register (CPUFreqSelectorService *service,
     dbus_g_error_domain_register (CPUFREQ_SELECTOR_SERVICE_ERROR, NULL,
                                   CPUFREQ_TYPE_SELECTOR_SERVICE_ERROR);
 
-    reset_killtimer ();
+    reset_killtimer (service);
 
     return TRUE;
 }
@@ -265,6 +336,14 @@ get_selector_for_cpu (CPUFreqSelectorService *service,
 }
 
 /* PolicyKit */
+static gboolean
+authorization_expired (gpointer key,
+                       gpointer value,
+                       gpointer user_data)
+{
+    return *(gint64 *) value <= *(gint64 *) user_data;
+}
+
 static gboolean
 cpufreq_selector_service_check_policy (CPUFreqSelectorService *service,
                                        DBusGMethodInvocation  *context,
@@ -273,11 +352,22 @@ cpufreq_selector_service_check_policy (CPUFreqSelectorService *service,
     PolkitSubject             *subject;
     PolkitAuthorizationResult *result;
     gchar                     *sender;
+    gint64                    *expiry;
+    gint64                     now;
     gboolean                   ret;
 
+    /* A unique bus name is never given to another connection, so a
+     * caller authorized a moment ago is not asked to authorize again */
     sender = dbus_g_method_get_sender (context);
+    now = g_get_monotonic_time ();
+    expiry = g_hash_table_lookup (service->authorized, sender);
+    if (expiry && *expiry > now) {
+        g_free (sender);
+
+        return TRUE;
+    }
+
     subject = polkit_system_bus_name_new (sender);
-    g_free (sender);
 
     result = polkit_authority_check_authorization_sync (service->authority,
                                                         subject,
@@ -289,19 +379,29 @@ cpufreq_selector_service_check_policy (CPUFreqSelectorService *service,
 
     if (*error) {
         g_warning ("Check policy: %s", (*error)->message);
-        g_object_unref (result);
+        g_free (sender);
 
         return FALSE;
     }
 
     ret = polkit_authorization_result_get_is_authorized (result);
-    if (!ret) {
+    if (ret) {
+        /* the callers that are still there but were authorized long ago */
+        g_hash_table_foreach_remove (service->authorized, authorization_expired, &now);
+
+        expiry = g_new (gint64, 1);
+        *expiry = now + AUTHORIZATION_TIMEOUT * G_USEC_PER_SEC;
+        g_hash_table_replace (service->authorized, sender, expiry);
+        sender = NULL;
+    } else {
+        g_hash_table_remove (service->authorized, sender);
         g_set_error (error,
                      CPUFREQ_SELECTOR_SERVICE_ERROR,
                      SERVICE_ERROR_NOT_AUTHORIZED,
                      "Caller is not authorized");
     }
 
+    g_free (sender);
     g_object_unref (result);
 
     return ret;
@@ -317,7 +417,7 @@ cpufreq_selector_service_set_frequency (CPUFreqSelectorService *service,
     CPUFreqSelector *selector;
     GError          *error = NULL;
 
-    reset_killtimer ();
+    reset_killtimer (service);
 
     if (!cpufreq_selector_service_check_policy (service, context, &error)) {
         dbus_g_method_return_error (context, error);
@@ -326,7 +426,7 @@ cpufreq_selector_service_set_frequency (CPUFreqSelectorService *service,
         return FALSE;
     }
 
-    if (cpu > MAX_CPUS) {
+    if (cpu >= MAX_CPUS) {
         GError *err;
 
         err = g_error_new (CPUFREQ_SELECTOR_SERVICE_ERROR,
@@ -382,7 +482,7 @@ cpufreq_selector_service_set_governor (CPUFreqSelectorService *service,
     CPUFreqSelector *selector;
     GError          *error = NULL;
 
-    reset_killtimer ();
+    reset_killtimer (service);
 
     if (!cpufreq_selector_service_check_policy (service, context, &error)) {
         dbus_g_method_return_error (context, error);
@@ -391,7 +491,7 @@ cpufreq_selector_service_set_governor (CPUFreqSelectorService *service,
         return FALSE;
     }
 
-    if (cpu > MAX_CPUS) {
+    if (cpu >= MAX_CPUS) {
         GError *err;
 
         err = g_error_new (CPUFREQ_SELECTOR_SERVICE_ERROR,
@@ -438,6 +538,114 @@ cpufreq_selector_service_set_governor (CPUFreqSelectorService *service,
     return TRUE;
 }
 
+/* Applies the governor, or else the frequency, to every cpufreq policy,
+ * writing once through the first CPU of each. A CPU that fails does not
+ * stop the others; the first error is returned. */
+static gboolean
+cpufreq_selector_service_set_all (CPUFreqSelectorService *service,
+                                  const gchar            *governor,
+                                  guint                   frequency,
+                                  GError                **error)
+{
+    GArray *cpus;
+    guint   i;
+
+    cpus = cpufreq_selector_get_policy_cpus ();
+    if (cpus->len == 0) {
+        g_set_error (error,
+                     CPUFREQ_SELECTOR_SERVICE_ERROR,
+                     SERVICE_ERROR_DBUS,
+                     "No cpufreq support");
+        g_array_free (cpus, TRUE);
+
+        return FALSE;
+    }
+
+    for (i = 0; i < cpus->len; i++) {
+        CPUFreqSelector *selector;
+        guint            cpu = g_array_index (cpus, guint, i);
+        GError          *err = NULL;
+
+        if (cpu >= MAX_CPUS)
+            break;
+
+        selector = get_selector_for_cpu (service, cpu);
+        if (!selector)
+            continue;
+
+        if (governor)
+            cpufreq_selector_set_governor (selector, governor, &err);
+        else
+            cpufreq_selector_set_frequency (selector, frequency, &err);
+
+        if (err) {
+            if (error && !*error) {
+                if (governor)
+                    g_set_error (error,
+                                 CPUFREQ_SELECTOR_SERVICE_ERROR,
+                                 SERVICE_ERROR_DBUS,
+                                 "Error setting governor %s on cpu %d: %s",
+                                 governor, cpu, err->message);
+                else
+                    g_set_error (error,
+                                 CPUFREQ_SELECTOR_SERVICE_ERROR,
+                                 SERVICE_ERROR_DBUS,
+                                 "Error setting frequency %d on cpu %d: %s",
+                                 frequency, cpu, err->message);
+            }
+            g_error_free (err);
+        }
+    }
+
+    g_array_free (cpus, TRUE);
+
+    return !(error && *error);
+}
+
+gboolean
+cpufreq_selector_service_set_frequency_all (CPUFreqSelectorService *service,
+                                            guint                   frequency,
+                                            DBusGMethodInvocation  *context)
+{
+    GError *error = NULL;
+
+    reset_killtimer (service);
+
+    if (!cpufreq_selector_service_check_policy (service, context, &error) ||
+        !cpufreq_selector_service_set_all (service, NULL, frequency, &error)) {
+        dbus_g_method_return_error (context, error);
+        g_error_free (error);
+
+        return FALSE;
+    }
+
+    dbus_g_method_return (context);
+
+    return TRUE;
+}
+
+gboolean
+cpufreq_selector_service_set_governor_all (CPUFreqSelectorService *service,
+                                           const gchar            *governor,
+                                           DBusGMethodInvocation  *context)
+{
+    GError *error = NULL;
+
+    reset_killtimer (service);
+
+    if (!cpufreq_selector_service_check_policy (service, context, &error) ||
+        !cpufreq_selector_service_set_all (service, governor, 0, &error)) {
+        dbus_g_method_return_error (context, error);
+        g_error_free (error);
+
+        return FALSE;
+    }
+
+    dbus_g_method_return (context);
+
+    return TRUE;
+}
+
 gboolean
 cpufreq_selector_service_can_set (CPUFreqSelectorService *service,
                                   DBusGMethodInvocation  *context)
@@ -448,7 +656,7 @@ cpufreq_selector_service_can_set (CPUFreqSelectorService *service,
     gboolean                   ret;
     GError                    *error = NULL;
 
-    reset_killtimer ();
+    reset_killtimer (service);
 
     sender = dbus_g_method_get_sender (context);
     subject = polkit_system_bus_name_new (sender);
@@ -53,6 +53,8 @@ GQuark                  cpufreq_selector_service_error_quark    (void) G_GNUC_CO
 CPUFreqSelectorService *cpufreq_selector_service_get_instance   (void);
 gboolean                cpufreq_selector_service_register       (CPUFreqSelectorService *service,
                                                                  GError                **error);
+void                    cpufreq_selector_service_set_idle_timeout (CPUFreqSelectorService *service,
+                                                                   guint                   seconds);
 
 gboolean                cpufreq_selector_service_set_frequency  (CPUFreqSelectorService *service,
                                                                  guint                   cpu,
@@ -62,6 +64,12 @@ gboolean                cpufreq_selector_service_set_governor   (CPUFreqSelector
                                                                  guint                   cpu,
                                                                  const gchar            *governor,
                                                                  DBusGMethodInvocation  *context);
+gboolean                cpufreq_selector_service_set_frequency_all (CPUFreqSelectorService *service,
+                                                                    guint                   frequency,
+                                                                    DBusGMethodInvocation  *context);
+gboolean                cpufreq_selector_service_set_governor_all  (CPUFreqSelectorService *service,
+                                                                    const gchar            *governor,
+                                                                    DBusGMethodInvocation  *context);
 gboolean               cpufreq_selector_service_can_set         (CPUFreqSelectorService *service,
                                                                  DBusGMethodInvocation  *context);
 
@@ -20,15 +20,21 @@
  */
 
 #include <glib.h>
-#include <glib/gstdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "cpufreq-selector-sysfs.h"
 
 struct _CPUFreqSelectorSysfsPrivate {
     GList *available_freqs;
     GList *available_govs;
+
+    /* kept open between requests, -1 until needed */
+    gint   governor_fd;
+    gint   setspeed_fd;
 };
 
 static void
@@ -55,6 +61,8 @@ cpufreq_selector_sysfs_init (CPUFreqSelectorSysfs *selector)
 
     selector->priv->available_freqs = NULL;
     selector->priv->available_govs = NULL;
+    selector->priv->governor_fd = -1;
+    selector->priv->setspeed_fd = -1;
 }
 
 static void
@@ -84,6 +92,16 @@ cpufreq_selector_sysfs_finalize (GObject *object)
         selector->priv->available_govs = NULL;
     }
 
+    if (selector->priv->governor_fd >= 0) {
+        close (selector->priv->governor_fd);
+        selector->priv->governor_fd = -1;
+    }
+
+    if (selector->priv->setspeed_fd >= 0) {
+        close (selector->priv->setspeed_fd);
+        selector->priv->setspeed_fd = -1;
+    }
+
     G_OBJECT_CLASS (cpufreq_selector_sysfs_parent_class)->finalize (object);
 }
 
@@ -113,41 +131,112 @@ cpufreq_sysfs_read (const gchar *path,
 }
 
 static gboolean
-cpufreq_sysfs_write (const gchar *path,
-                     const gchar *setting,
-                     GError     **error)
+cpufreq_selector_sysfs_open (CPUFreqSelectorSysfs *selector,
+                             gint                 *fd,
+                             const gchar          *file,
+                             gint                  flags,
+                             GError              **error)
 {
-    FILE *fd;
+    gchar *path;
+    guint  cpu;
+
+    if (*fd >= 0)
+        return TRUE;
+
+    g_object_get (G_OBJECT (selector),
+                  "cpu", &cpu,
+                  NULL);
 
-    fd = g_fopen (path, "w");
+    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH, cpu, file);
+    *fd = open (path, flags | O_CLOEXEC);
 
-    if (!fd) {
+    if (*fd < 0) {
         g_set_error (error,
                      G_FILE_ERROR,
                      g_file_error_from_errno (errno),
-                     "Failed to open '%s' for writing: "
-                     "g_fopen() failed: %s",
+                     "Failed to open '%s': %s",
                      path,
                      g_strerror (errno));
+        g_free (path);
 
         return FALSE;
     }
 
-    if (g_fprintf (fd, "%s", setting) < 0) {
+    g_free (path);
+
+    return TRUE;
+}
+
+/* Reads the current value of an open sysfs file from its start */
+static gchar *
+cpufreq_selector_sysfs_pread (CPUFreqSelectorSysfs *selector,
+                              gint                 *fd,
+                              const gchar          *file,
+                              GError              **error)
+{
+    gchar  buffer[256];
+    gssize len;
+
+    if (!cpufreq_selector_sysfs_open (selector, fd, file, O_RDWR, error))
+        return NULL;
+
+    do {
+        len = pread (*fd, buffer, sizeof (buffer) - 1, 0);
+    } while (len < 0 && errno == EINTR);
+
+    if (len < 0) {
         g_set_error (error,
                      G_FILE_ERROR,
                      g_file_error_from_errno (errno),
-                     "Failed to write '%s': "
-                     "g_fprintf() failed: %s",
-                     path,
+                     "Failed to read '%s': %s",
+                     file,
                      g_strerror (errno));
+        close (*fd);
+        *fd = -1;
+
+        return NULL;
+    }
+
+    buffer[len] = '\0';
 
-        fclose (fd);
+    return g_strchomp (g_strdup (buffer));
+}
+
+/* Writes a setting to an open sysfs file. The file is closed on failure,
+ * so one that went away with its cpu is opened again by the next write.
+ */
+static gboolean
+cpufreq_selector_sysfs_pwrite (CPUFreqSelectorSysfs *selector,
+                               gint                 *fd,
+                               const gchar          *file,
+                               gint                  flags,
+                               const gchar          *setting,
+                               GError              **error)
+{
+    gsize  len = strlen (setting);
+    gssize written;
 
+    if (!cpufreq_selector_sysfs_open (selector, fd, file, flags, error))
         return FALSE;
-    }
 
-    fclose (fd);
+    do {
+        written = pwrite (*fd, setting, len, 0);
+    } while (written < 0 && errno == EINTR);
+
+    if (written != (gssize) len) {
+        gint errsv = written < 0 ? errno : EIO;
+
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (errsv),
+                     "Failed to write '%s': %s",
+                     file,
+                     g_strerror (errsv));
+        close (*fd);
+        *fd = -1;
+
+        return FALSE;
+    }
 
     return TRUE;
 }
@@ -258,20 +347,16 @@ cpufreq_selector_sysfs_set_frequency (CPUFreqSelector *selector,
                                       guint            frequency,
                                       GError         **error)
 {
-    gchar       *governor;
-    gchar       *path;
-    const gchar *frequency_text;
-    guint        cpu;
-
-    g_object_get (G_OBJECT (selector),
-                  "cpu", &cpu,
-                  NULL);
+    CPUFreqSelectorSysfs *selector_sysfs;
+    gchar                *governor;
+    const gchar          *frequency_text;
 
-    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH, cpu,
-                            "scaling_governor");
+    selector_sysfs = CPUFREQ_SELECTOR_SYSFS (selector);
 
-    governor = cpufreq_sysfs_read (path, error);
-    g_free (path);
+    governor = cpufreq_selector_sysfs_pread (selector_sysfs,
+                                             &selector_sysfs->priv->governor_fd,
+                                             "scaling_governor",
+                                             error);
 
     if (!governor)
         return FALSE;
@@ -289,8 +374,7 @@ cpufreq_selector_sysfs_set_frequency (CPUFreqSelector *selector,
     g_free (governor);
 
     frequency_text =
-        cpufreq_selector_sysfs_get_valid_frequency (CPUFREQ_SELECTOR_SYSFS (selector),
-                                                    frequency);
+        cpufreq_selector_sysfs_get_valid_frequency (selector_sysfs, frequency);
     if (!frequency_text) {
         g_set_error (error,
                      CPUFREQ_SELECTOR_ERROR,
@@ -301,17 +385,12 @@ cpufreq_selector_sysfs_set_frequency (CPUFreqSelector *selector,
         return FALSE;
     }
 
-    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH, cpu,
-                            "scaling_setspeed");
-    if (!cpufreq_sysfs_write (path, frequency_text, error)) {
-        g_free (path);
-
-        return FALSE;
-    }
-
-    g_free (path);
-
-    return TRUE;
+    return cpufreq_selector_sysfs_pwrite (selector_sysfs,
+                                          &selector_sysfs->priv->setspeed_fd,
+                                          "scaling_setspeed",
+                                          O_WRONLY,
+                                          frequency_text,
+                                          error);
 }
 
 static GList *
@@ -387,8 +466,6 @@ cpufreq_selector_sysfs_set_governor (CPUFreqSelector *selector,
                                      GError         **error)
 {
     CPUFreqSelectorSysfs *selector_sysfs;
-    gchar                *path;
-    guint                 cpu;
 
     selector_sysfs = CPUFREQ_SELECTOR_SYSFS (selector);
 
@@ -402,20 +479,10 @@ cpufreq_selector_sysfs_set_governor (CPUFreqSelector *selector,
         return FALSE;
     }
 
-    g_object_get (G_OBJECT (selector),
-                  "cpu", &cpu,
-                  NULL);
-
-    path = g_strdup_printf (CPUFREQ_SYSFS_BASE_PATH, cpu,
-                            "scaling_governor");
-
-    if (!cpufreq_sysfs_write (path, governor, error)) {
-        g_free (path);
-
-        return FALSE;
-    }
-
-    g_free (path);
-
-    return TRUE;
+    return cpufreq_selector_sysfs_pwrite (selector_sysfs,
+                                          &selector_sysfs->priv->governor_fd,
+                                          "scaling_governor",
+                                          O_RDWR,
+                                          governor,
+                                          error);
 }
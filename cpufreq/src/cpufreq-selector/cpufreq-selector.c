@@ -20,6 +20,9 @@
  */
 
 #include <glib.h>
+#include <stdlib.h>
+#include <limits.h>
+
 #include "cpufreq-selector.h"
 
 enum {
@@ -163,3 +166,45 @@ cpufreq_selector_set_governor (CPUFreqSelector *selector,
     return FALSE;
 }
 
+
+/* Returns the first CPU of every cpufreq policy, in order. CPUs sharing a
+ * policy link their cpufreq directory to the same policyN directory, so a
+ * setting written through the first of them applies to all, and the
+ * others can be skipped. Offline CPUs have no cpufreq directory.
+ */
+GArray *
+cpufreq_selector_get_policy_cpus (void)
+{
+    GArray     *cpus;
+    GHashTable *policies;
+    guint       cpu;
+
+    cpus = g_array_new (FALSE, FALSE, sizeof (guint));
+    policies = g_hash_table_new_full (g_str_hash, g_str_equal, free, NULL);
+
+    for (cpu = 0; ; cpu++) {
+        gchar  path[PATH_MAX];
+        gchar *policy;
+
+        g_snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%u", cpu);
+        if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+            break;
+
+        g_strlcat (path, "/cpufreq", sizeof (path));
+        policy = realpath (path, NULL);
+        if (!policy)
+            continue;
+
+        if (g_hash_table_contains (policies, policy)) {
+            free (policy);
+            continue;
+        }
+
+        g_hash_table_add (policies, policy);
+        g_array_append_val (cpus, cpu);
+    }
+
+    g_hash_table_destroy (policies);
+
+    return cpus;
+}
@@ -70,4 +70,6 @@ gboolean cpufreq_selector_set_governor  (CPUFreqSelector *selector,
                                          const gchar     *governor,
                                          GError         **error);
 
+GArray  *cpufreq_selector_get_policy_cpus (void);
+
 #endif /* __CPUFREQ_SELECTOR_H__ */
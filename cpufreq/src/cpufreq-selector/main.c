@@ -33,14 +33,23 @@
 #endif
 #include "cpufreq-selector-factory.h"
 
-static gint    cpu = 0;
-static gchar  *governor = NULL;
-static gulong  frequency = 0;
+static gint     cpu = 0;
+static gboolean all = FALSE;
+static gchar   *governor = NULL;
+static gulong   frequency = 0;
+#ifdef HAVE_POLKIT
+static gint     idle_timeout = -1;
+#endif
 
 static const GOptionEntry options[] = {
     { "cpu",       'c', 0, G_OPTION_ARG_INT,    &cpu,       "CPU Number",       NULL },
+    { "all",       'a', 0, G_OPTION_ARG_NONE,   &all,       "All CPUs",         NULL },
     { "governor",  'g', 0, G_OPTION_ARG_STRING, &governor,  "Governor",         NULL },
     { "frequency", 'f', 0, G_OPTION_ARG_INT,    &frequency, "Frequency in KHz", NULL },
+#ifdef HAVE_POLKIT
+    { "idle-timeout", 't', 0, G_OPTION_ARG_INT, &idle_timeout,
+      "Seconds to keep the service running without requests, 0 for ever", "SECONDS" },
+#endif
     { NULL }
 };
 
@@ -80,12 +89,20 @@ cpufreq_selector_set_values_dbus (void)
         return;
     }
 
-    if (governor) {
+    if (governor && all) {
+        res = dbus_g_proxy_call (proxy, "SetGovernorAll", &error,
+                                 G_TYPE_STRING, governor,
+                                 G_TYPE_INVALID,
+                                 G_TYPE_INVALID);
+    } else if (governor) {
         res = dbus_g_proxy_call (proxy, "SetGovernor", &error,
                                  G_TYPE_UINT, cpu,
                                  G_TYPE_STRING, governor,
                                  G_TYPE_INVALID,
                                  G_TYPE_INVALID);
+    }
+
+    if (governor) {
         if (!res) {
             if (error) {
                 g_printerr ("Error calling SetGovernor: %s\n", error->message);
@@ -100,12 +117,20 @@ cpufreq_selector_set_values_dbus (void)
         }
     }
 
-    if (frequency != 0) {
+    if (frequency != 0 && all) {
+        res = dbus_g_proxy_call (proxy, "SetFrequencyAll", &error,
+                                 G_TYPE_UINT, frequency,
+                                 G_TYPE_INVALID,
+                                 G_TYPE_INVALID);
+    } else if (frequency != 0) {
         res = dbus_g_proxy_call (proxy, "SetFrequency", &error,
                                  G_TYPE_UINT, cpu,
                                  G_TYPE_UINT, frequency,
                                  G_TYPE_INVALID,
                                  G_TYPE_INVALID);
+    }
+
+    if (frequency != 0) {
         if (!res) {
             if (error) {
                 g_printerr ("Error calling SetFrequency: %s\n", error->message);
@@ -125,12 +150,12 @@ cpufreq_selector_set_values_dbus (void)
 #endif /* HAVE_POLKIT */
 
 static void
-cpufreq_selector_set_values (void)
+cpufreq_selector_set_values_for_cpu (guint n_cpu)
 {
     CPUFreqSelector *selector;
     GError          *error = NULL;
 
-    selector = cpufreq_selector_factory_create_selector (cpu);
+    selector = cpufreq_selector_factory_create_selector (n_cpu);
     if (!selector) {
         g_printerr ("No cpufreq support\n");
 
@@ -160,6 +185,29 @@ cpufreq_selector_set_values (void)
     g_object_unref (selector);
 }
 
+static void
+cpufreq_selector_set_values (void)
+{
+    GArray *cpus;
+    guint   i;
+
+    if (!all) {
+        cpufreq_selector_set_values_for_cpu (cpu);
+
+        return;
+    }
+
+    /* once per policy, the CPUs sharing it follow */
+    cpus = cpufreq_selector_get_policy_cpus ();
+    if (cpus->len == 0)
+        g_printerr ("No cpufreq support\n");
+
+    for (i = 0; i < cpus->len; i++)
+        cpufreq_selector_set_values_for_cpu (g_array_index (cpus, guint, i));
+
+    g_array_free (cpus, TRUE);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -201,6 +249,9 @@ main (gint argc, gchar **argv)
     g_option_context_free (context);
 
 #ifdef HAVE_POLKIT
+    if (idle_timeout >= 0)
+        cpufreq_selector_service_set_idle_timeout (SELECTOR_SERVICE, idle_timeout);
+
     if (!cpufreq_selector_service_register (SELECTOR_SERVICE, &error)) {
         if (governor || frequency != 0) {
             cpufreq_selector_set_values_dbus ();
@@ -0,0 +1,241 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <glib.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/sampler-file.h"
+
+#include "cpufreq-stats.h"
+
+#define CPUFREQ_STATS_PATH "/sys/devices/system/cpu/cpu%u/cpufreq/stats/%s"
+
+/* A line of time_in_state is about 20 bytes, this holds a
+ * few hundred frequencies
+ */
+#define CPUFREQ_STATS_BUFFER_SIZE 8192
+
+struct _CPUFreqStats {
+    guint              cpu;
+
+    /* -1 while closed */
+    gint               time_in_state_fd;
+    gint               total_trans_fd;
+
+    /* the times as read when the states were first seen */
+    GArray            *base;
+    GArray            *states;
+
+    guint64            trans;
+    gint64             trans_time;
+    gdouble            trans_rate;
+};
+
+static gssize
+cpufreq_stats_pread (CPUFreqStats *stats,
+                     gint         *fd,
+                     const gchar  *file,
+                     gchar        *buffer,
+                     gsize         size)
+{
+    if (*fd < 0) {
+        gchar path[128];
+
+        g_snprintf (path, sizeof (path), CPUFREQ_STATS_PATH, stats->cpu, file);
+        *fd = sampler_open (path);
+    }
+
+    /* The stats go away with the cpu going offline */
+    return sampler_pread (fd, buffer, size);
+}
+
+CPUFreqStats *
+cpufreq_stats_new (guint cpu)
+{
+    CPUFreqStats *stats;
+
+    stats = g_new0 (CPUFreqStats, 1);
+    stats->cpu = cpu;
+    stats->time_in_state_fd = -1;
+    stats->total_trans_fd = -1;
+    stats->base = g_array_new (FALSE, FALSE, sizeof (CPUFreqStatsState));
+    stats->states = g_array_new (FALSE, FALSE, sizeof (CPUFreqStatsState));
+
+    if (!cpufreq_stats_update (stats)) {
+        cpufreq_stats_free (stats);
+
+        return NULL;
+    }
+
+    return stats;
+}
+
+void
+cpufreq_stats_free (CPUFreqStats *stats)
+{
+    if (!stats)
+        return;
+
+    if (stats->time_in_state_fd >= 0)
+        close (stats->time_in_state_fd);
+    if (stats->total_trans_fd >= 0)
+        close (stats->total_trans_fd);
+
+    g_array_free (stats->base, TRUE);
+    g_array_free (stats->states, TRUE);
+    g_free (stats);
+}
+
+/* Parses the "frequency time" lines of time_in_state into states */
+static void
+cpufreq_stats_parse_time_in_state (gchar  *buffer,
+                                   GArray *states)
+{
+    gchar *line = buffer;
+
+    g_array_set_size (states, 0);
+
+    while (line && *line) {
+        CPUFreqStatsState state;
+        gchar            *end;
+
+        state.frequency = (guint) strtoul (line, &end, 10);
+        if (end == line)
+            break;
+        state.time = g_ascii_strtoull (end, &end, 10);
+        g_array_append_val (states, state);
+
+        line = strchr (end, '\n');
+        if (line)
+            line++;
+    }
+}
+
+static gboolean
+cpufreq_stats_same_frequencies (GArray *a,
+                                GArray *b)
+{
+    guint i;
+
+    if (a->len != b->len)
+        return FALSE;
+
+    for (i = 0; i < a->len; i++) {
+        if (g_array_index (a, CPUFreqStatsState, i).frequency !=
+            g_array_index (b, CPUFreqStatsState, i).frequency)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean
+cpufreq_stats_update (CPUFreqStats *stats)
+{
+    gchar  buffer[CPUFREQ_STATS_BUFFER_SIZE];
+    gint64 now;
+    guint  i;
+
+    g_return_val_if_fail (stats != NULL, FALSE);
+
+    if (cpufreq_stats_pread (stats, &stats->time_in_state_fd,
+                             "time_in_state", buffer, sizeof (buffer)) < 0)
+        return FALSE;
+
+    cpufreq_stats_parse_time_in_state (buffer, stats->states);
+    if (stats->states->len == 0)
+        return FALSE;
+
+    /* A new frequency table, or counters that went back after
+     * a reset of the stats, start over
+     */
+    if (!cpufreq_stats_same_frequencies (stats->base, stats->states)) {
+        g_array_set_size (stats->base, 0);
+        g_array_append_vals (stats->base, stats->states->data, stats->states->len);
+    }
+
+    for (i = 0; i < stats->states->len; i++) {
+        CPUFreqStatsState *state = &g_array_index (stats->states, CPUFreqStatsState, i);
+        CPUFreqStatsState *base = &g_array_index (stats->base, CPUFreqStatsState, i);
+
+        if (state->time < base->time)
+            base->time = state->time;
+        state->time -= base->time;
+    }
+
+    now = g_get_monotonic_time ();
+    if (cpufreq_stats_pread (stats, &stats->total_trans_fd,
+                             "total_trans", buffer, sizeof (buffer)) > 0) {
+        guint64 trans = g_ascii_strtoull (buffer, NULL, 10);
+
+        if (stats->trans_time > 0 && now > stats->trans_time && trans >= stats->trans) {
+            stats->trans_rate = (gdouble) (trans - stats->trans) * G_USEC_PER_SEC /
+                                (now - stats->trans_time);
+        }
+        stats->trans = trans;
+        stats->trans_time = now;
+    }
+
+    return TRUE;
+}
+
+guint
+cpufreq_stats_get_n_states (CPUFreqStats *stats)
+{
+    g_return_val_if_fail (stats != NULL, 0);
+
+    return stats->states->len;
+}
+
+const CPUFreqStatsState *
+cpufreq_stats_get_state (CPUFreqStats *stats,
+                         guint         i)
+{
+    g_return_val_if_fail (stats != NULL, NULL);
+    g_return_val_if_fail (i < stats->states->len, NULL);
+
+    return &g_array_index (stats->states, CPUFreqStatsState, i);
+}
+
+guint64
+cpufreq_stats_get_total_time (CPUFreqStats *stats)
+{
+    guint64 total = 0;
+    guint   i;
+
+    g_return_val_if_fail (stats != NULL, 0);
+
+    for (i = 0; i < stats->states->len; i++)
+        total += g_array_index (stats->states, CPUFreqStatsState, i).time;
+
+    return total;
+}
+
+gdouble
+cpufreq_stats_get_transition_rate (CPUFreqStats *stats)
+{
+    g_return_val_if_fail (stats != NULL, 0);
+
+    return stats->trans_rate;
+}
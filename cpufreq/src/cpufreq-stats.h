@@ -0,0 +1,54 @@
+/*
+ * MATE CPUFreq Applet
+ * Copyright (C) 2021 MATE developers
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __CPUFREQ_STATS_H__
+#define __CPUFREQ_STATS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The residency of a cpu at each of its frequencies and how often it
+ * changes frequency, from the cpufreq stats of its policy. Only what
+ * changed since the stats were created is counted, so the applet tells
+ * about the time it has been running, not about the boot.
+ */
+typedef struct _CPUFreqStats CPUFreqStats;
+
+typedef struct {
+    guint   frequency;
+    guint64 time;      /* in 10 ms units, since the stats were created */
+} CPUFreqStatsState;
+
+/* Returns NULL if the kernel keeps no stats for the cpu */
+CPUFreqStats            *cpufreq_stats_new                 (guint         cpu);
+void                     cpufreq_stats_free                (CPUFreqStats *stats);
+/* Reads time_in_state and total_trans once, returns FALSE if they can
+ * not be read anymore */
+gboolean                 cpufreq_stats_update              (CPUFreqStats *stats);
+guint                    cpufreq_stats_get_n_states        (CPUFreqStats *stats);
+const CPUFreqStatsState *cpufreq_stats_get_state           (CPUFreqStats *stats,
+                                                            guint         i);
+guint64                  cpufreq_stats_get_total_time      (CPUFreqStats *stats);
+/* Transitions per second between the last two updates */
+gdouble                  cpufreq_stats_get_transition_rate (CPUFreqStats *stats);
+
+G_END_DECLS
+
+#endif /* __CPUFREQ_STATS_H__ */
@@ -0,0 +1,242 @@
+/* -*- mode: C; c-basic-offset: 4 -*-
+ * Drive Mount Applet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+#include <gio/gunixmounts.h>
+
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "common/sampler-file.h"
+#include "common/sampler-tick.h"
+
+#include "drive-activity.h"
+
+/* how often the counters are read, in milliseconds */
+#define ACTIVITY_INTERVAL 1000
+
+typedef struct {
+    guint             id;
+    guint64           device;
+    DriveActivityFunc func;
+    gpointer          user_data;
+    gboolean          primed;   /* the counters below were read */
+    guint64           sectors_read;
+    guint64           sectors_written;
+    DriveActivity     activity;
+} ActivityWatch;
+
+/* shared by the buttons of all the lists in the process */
+static GPtrArray   *activity_watches = NULL;
+static guint        activity_next_id = 1;
+static guint        activity_tick_id = 0;
+static SamplerFile  activity_file = SAMPLER_FILE_INIT ("/proc/diskstats");
+
+guint64
+drive_activity_lookup_device (GVolume *volume,
+                              GMount  *mount)
+{
+    gchar *path = NULL;
+    struct stat buf;
+    guint64 device = 0;
+
+    if (!volume && mount)
+        volume = g_mount_get_volume (mount);
+    else if (volume)
+        g_object_ref (volume);
+
+    if (volume) {
+        path = g_volume_get_identifier (volume, G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE);
+        g_object_unref (volume);
+    }
+
+    /* a mount of fstab without a volume */
+    if (!path && mount) {
+        GFile *root = g_mount_get_root (mount);
+        gchar *root_path = g_file_get_path (root);
+        GUnixMountEntry *entry;
+
+        entry = root_path ? g_unix_mount_at (root_path, NULL) : NULL;
+        if (entry) {
+            path = g_strdup (g_unix_mount_get_device_path (entry));
+            g_unix_mount_free (entry);
+        }
+        g_free (root_path);
+        g_object_unref (root);
+    }
+
+    /* by number, so /dev/disk/by-uuid and /dev/mapper links match too */
+    if (path && stat (path, &buf) == 0 && S_ISBLK (buf.st_mode))
+        device = buf.st_rdev;
+    g_free (path);
+
+    return device;
+}
+
+/* "major minor name" and then field n, starting at 1 after the name */
+static const gchar *
+activity_parse_line (const gchar *p,
+                     guint64     *device,
+                     guint64      fields[9])
+{
+    guint64 major, minor;
+    guint i;
+
+    if (!(p = sampler_parse_u64 (p, &major)) ||
+        !(p = sampler_parse_u64 (p, &minor)))
+        return NULL;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n')
+        p++;
+
+    for (i = 0; i < 9 && p; i++)
+        p = sampler_parse_u64 (p, &fields[i]);
+
+    *device = makedev (major, minor);
+
+    return p;
+}
+
+static void
+activity_update (ActivityWatch *watch,
+                 const guint64  fields[9])
+{
+    /* fields 3 and 7 are the sectors read and written, 9 the I/Os in
+     * flight */
+    gboolean reading = fields[2] != watch->sectors_read;
+    gboolean writing = fields[6] != watch->sectors_written;
+    DriveActivity activity;
+
+    if (writing)
+        activity = DRIVE_ACTIVITY_WRITING;
+    else if (fields[8] > 0)
+        /* requests still out belong to what the drive was doing */
+        activity = watch->activity != DRIVE_ACTIVITY_IDLE ? watch->activity
+                                                         : DRIVE_ACTIVITY_READING;
+    else if (reading)
+        activity = DRIVE_ACTIVITY_READING;
+    else
+        activity = DRIVE_ACTIVITY_IDLE;
+
+    watch->sectors_read = fields[2];
+    watch->sectors_written = fields[6];
+
+    /* the first reading only sets the counters */
+    if (!watch->primed) {
+        watch->primed = TRUE;
+        return;
+    }
+
+    if (activity != watch->activity) {
+        watch->activity = activity;
+        watch->func (activity, watch->user_data);
+    }
+}
+
+static gboolean
+activity_tick (gpointer user_data)
+{
+    const gchar *p;
+    guint i;
+
+    p = sampler_file_read (&activity_file);
+    if (!p) {
+        activity_tick_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    /* a callback may unwatch, so the watches are walked by index and
+     * each line is parsed once for all of them */
+    while (*p != '\0') {
+        const gchar *eol = strchr (p, '\n');
+        guint64 device, fields[9];
+
+        if (activity_parse_line (p, &device, fields)) {
+            for (i = 0; i < activity_watches->len; i++) {
+                ActivityWatch *watch = g_ptr_array_index (activity_watches, i);
+
+                if (watch->device == device)
+                    activity_update (watch, fields);
+            }
+        }
+
+        if (!eol)
+            break;
+        p = eol + 1;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+guint
+drive_activity_watch (guint64           device,
+                      DriveActivityFunc func,
+                      gpointer          user_data)
+{
+    ActivityWatch *watch;
+
+    if (device == 0)
+        return 0;
+
+    if (!activity_watches)
+        activity_watches = g_ptr_array_new_with_free_func (g_free);
+
+    watch = g_new0 (ActivityWatch, 1);
+    watch->id = activity_next_id++;
+    watch->device = device;
+    watch->func = func;
+    watch->user_data = user_data;
+    g_ptr_array_add (activity_watches, watch);
+
+    if (!activity_tick_id)
+        activity_tick_id = sampler_tick_add (ACTIVITY_INTERVAL, activity_tick, NULL);
+
+    return watch->id;
+}
+
+void
+drive_activity_unwatch (guint id)
+{
+    guint i;
+
+    if (id == 0 || !activity_watches)
+        return;
+
+    for (i = 0; i < activity_watches->len; i++) {
+        ActivityWatch *watch = g_ptr_array_index (activity_watches, i);
+
+        if (watch->id == id) {
+            g_ptr_array_remove_index (activity_watches, i);
+            break;
+        }
+    }
+
+    /* nothing is read while no button shows its activity */
+    if (activity_watches->len == 0 && activity_tick_id) {
+        g_source_remove (activity_tick_id);
+        activity_tick_id = 0;
+        sampler_file_close (&activity_file);
+    }
+}
@@ -0,0 +1,54 @@
+/* -*- mode: C; c-basic-offset: 4 -*-
+ * Drive Mount Applet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DRIVE_ACTIVITY_H
+#define DRIVE_ACTIVITY_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The I/O of the block devices under the buttons, from /proc/diskstats.
+ *
+ * Every button that shows its activity watches the device of its volume
+ * or mount, looked up once when the button gets it.  While there are
+ * watches, the file is read once per second for all of them, and a
+ * watch is only called back when the state of its device changed, so
+ * an idle drive costs its button nothing. */
+typedef enum {
+    DRIVE_ACTIVITY_IDLE,
+    DRIVE_ACTIVITY_READING,
+    DRIVE_ACTIVITY_WRITING      /* sectors written, as dirty data is flushed */
+} DriveActivity;
+
+typedef void (*DriveActivityFunc) (DriveActivity activity,
+                                   gpointer      user_data);
+
+/* The device number of the block device under a volume, or under a
+ * mount without one, 0 if there is none such as for network mounts */
+guint64 drive_activity_lookup_device (GVolume           *volume,
+                                      GMount            *mount);
+
+guint   drive_activity_watch         (guint64            device,
+                                      DriveActivityFunc  func,
+                                      gpointer           user_data);
+void    drive_activity_unwatch       (guint              id);
+
+G_END_DECLS
+
+#endif /* DRIVE_ACTIVITY_H */
@@ -27,6 +27,7 @@
 
 #include <gio/gio.h>
 #include "drive-button.h"
+#include "drive-activity.h"
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
 #include <gio/gdesktopappinfo.h>
@@ -35,6 +36,14 @@
 
 #include <string.h>
 
+/* the usage of a mount is queried every USAGE_INTERVAL_MIN seconds
+ * while it changes, and less often, up to USAGE_INTERVAL_MAX, while it
+ * does not */
+#define USAGE_INTERVAL_MIN 30
+#define USAGE_INTERVAL_MAX 600
+/* how long a query may take before the mount is taken as stale */
+#define USAGE_QUERY_TIMEOUT 5
+
 enum {
     CMD_NONE,
     CMD_MOUNT_OR_PLAY,
@@ -62,6 +71,10 @@ static gboolean drive_button_key_press    (GtkWidget      *widget,
                                            GdkEventKey    *event);
 static void drive_button_theme_change     (GtkIconTheme   *icon_theme,
                                            gpointer        data);
+static void     drive_button_stop_usage   (DriveButton    *self);
+static void     drive_button_probe_media  (DriveButton    *self,
+                                           GMount         *mount);
+static void     drive_button_watch_activity (DriveButton  *self);
 
 static void
 drive_button_class_init (DriveButtonClass *class)
@@ -102,6 +115,13 @@ drive_button_init (DriveButton *self)
     self->icon_size = 24;
     self->update_tag = 0;
 
+    self->show_usage = FALSE;
+    self->usage = -1;
+    self->usage_interval = USAGE_INTERVAL_MIN;
+
+    self->show_activity = FALSE;
+    self->activity = DRIVE_ACTIVITY_IDLE;
+
     self->popup_menu = NULL;
 
     gtk_widget_set_name (GTK_WIDGET (self), "drive-button");
@@ -150,6 +170,14 @@ drive_button_dispose (GObject *object)
         g_source_remove (self->update_tag);
     self->update_tag = 0;
 
+    self->show_usage = FALSE;
+    drive_button_stop_usage (self);
+
+    self->show_activity = FALSE;
+    drive_button_watch_activity (self);
+
+    drive_button_probe_media (self, NULL);
+
     drive_button_reset_popup (self);
 
     if (G_OBJECT_CLASS (drive_button_parent_class)->dispose)
@@ -226,6 +254,7 @@ drive_button_set_volume (DriveButton *self,
     if (volume) {
         self->volume = g_object_ref (volume);
     }
+    drive_button_watch_activity (self);
     drive_button_queue_update (self);
 }
 
@@ -247,16 +276,377 @@ drive_button_set_mount (DriveButton *self,
     if (mount) {
         self->mount = g_object_ref (mount);
     }
+    drive_button_watch_activity (self);
     drive_button_queue_update (self);
 }
 
+static void
+drive_button_probe_done (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+    DriveButton *self = user_data;
+    GError *error = NULL;
+    gchar **content_types;
+
+    content_types = g_mount_guess_content_type_finish (G_MOUNT (source), result, &error);
+
+    /* the mount went away meanwhile */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        g_object_unref (self);
+        return;
+    }
+    g_clear_error (&error);
+
+    g_clear_object (&self->probe_cancellable);
+    g_strfreev (self->content_types);
+    self->content_types = content_types;
+
+    /* the menu gets the play item */
+    drive_button_reset_popup (self);
+    g_object_unref (self);
+}
+
+/* Looks at what is on the media of a new mount in the background, so
+ * the popup needs not read a slow optical drive.  NULL forgets it. */
+static void
+drive_button_probe_media (DriveButton *self,
+                          GMount      *mount)
+{
+    if (mount == self->probed_mount)
+        return;
+
+    if (self->probe_cancellable) {
+        g_cancellable_cancel (self->probe_cancellable);
+        g_clear_object (&self->probe_cancellable);
+    }
+    g_clear_pointer (&self->content_types, g_strfreev);
+    g_clear_object (&self->probed_mount);
+
+    if (!mount)
+        return;
+
+    self->probed_mount = g_object_ref (mount);
+    self->probe_cancellable = g_cancellable_new ();
+    g_mount_guess_content_type (mount, FALSE, self->probe_cancellable,
+                                drive_button_probe_done, g_object_ref (self));
+}
+
+/* Returns a new reference to the mount of the button, if it is mounted */
+static GMount *
+drive_button_get_mount (DriveButton *self)
+{
+    if (self->volume)
+        return g_volume_get_mount (self->volume);
+    else if (self->mount)
+        return g_object_ref (self->mount);
+
+    return NULL;
+}
+
+static gboolean drive_button_query_usage (gpointer user_data);
+
+static void
+drive_button_stop_usage (DriveButton *self)
+{
+    if (self->usage_tag)
+        g_source_remove (self->usage_tag);
+    self->usage_tag = 0;
+
+    /* the query in flight finds it cancelled when it returns */
+    if (self->usage_cancellable)
+        g_cancellable_cancel (self->usage_cancellable);
+
+    /* so the next reading is shown even if the mount did not change */
+    self->usage = -1;
+    self->usage_size = 0;
+    self->usage_free = 0;
+}
+
+static void
+drive_button_schedule_usage (DriveButton *self)
+{
+    if (self->show_usage && !self->usage_tag)
+        self->usage_tag = g_timeout_add_seconds (self->usage_interval,
+                                                 drive_button_query_usage, self);
+}
+
 static gboolean
-drive_button_update (gpointer user_data)
+drive_button_usage_timeout (gpointer user_data)
+{
+    DriveButton *self = user_data;
+
+    self->usage_timeout_tag = 0;
+    g_cancellable_cancel (self->usage_cancellable);
+
+    return FALSE;
+}
+
+static void
+drive_button_usage_done (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+    DriveButton *self = user_data;
+    GFileInfo *info;
+    GError *error = NULL;
+    gboolean timed_out;
+
+    info = g_file_query_filesystem_info_finish (G_FILE (source), result, &error);
+
+    /* drive_button_usage_timeout () leaves no tag behind */
+    timed_out = self->usage_timeout_tag == 0;
+
+    if (self->usage_timeout_tag)
+        g_source_remove (self->usage_timeout_tag);
+    self->usage_timeout_tag = 0;
+    g_clear_object (&self->usage_cancellable);
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) && !timed_out) {
+        /* stopped; if the usage was shown again meanwhile, the update
+         * starts a new query now that this one is done */
+        if (self->show_usage)
+            drive_button_queue_update (self);
+    } else if (!self->show_usage) {
+        /* turned off, or the button is gone */
+    } else if (info && g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE) > 0) {
+        guint64 size, free;
+        gdouble usage;
+
+        size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
+        free = MIN (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE), size);
+        usage = (gdouble) (size - free) / size;
+
+        /* a mount that fills or drains is followed closely */
+        if (self->usage < 0 || ABS (usage - self->usage) >= 0.01)
+            self->usage_interval = USAGE_INTERVAL_MIN;
+        else
+            self->usage_interval = MIN (self->usage_interval * 2, USAGE_INTERVAL_MAX);
+
+        if (size != self->usage_size || free != self->usage_free) {
+            self->usage = usage;
+            self->usage_size = size;
+            self->usage_free = free;
+            drive_button_queue_update (self);
+        }
+        drive_button_schedule_usage (self);
+    } else {
+        /* a stale network mount, or one without the attributes */
+        self->usage_interval = USAGE_INTERVAL_MAX;
+        drive_button_schedule_usage (self);
+    }
+
+    g_clear_error (&error);
+    if (info)
+        g_object_unref (info);
+    g_object_unref (self);
+}
+
+/* Asks for the free space of the mount in the background, never more
+ * than one query at a time, so a hung mount costs a single thread */
+static gboolean
+drive_button_query_usage (gpointer user_data)
+{
+    DriveButton *self = user_data;
+    GMount *mount;
+    GFile *root;
+
+    self->usage_tag = 0;
+
+    if (self->usage_cancellable)
+        return FALSE;
+
+    mount = drive_button_get_mount (self);
+    if (!mount)
+        return FALSE;
+
+    root = g_mount_get_root (mount);
+    g_object_unref (mount);
+
+    self->usage_cancellable = g_cancellable_new ();
+    self->usage_timeout_tag = g_timeout_add_seconds (USAGE_QUERY_TIMEOUT,
+                                                     drive_button_usage_timeout,
+                                                     self);
+    g_file_query_filesystem_info_async (root,
+                                        G_FILE_ATTRIBUTE_FILESYSTEM_SIZE ","
+                                        G_FILE_ATTRIBUTE_FILESYSTEM_FREE,
+                                        G_PRIORITY_LOW,
+                                        self->usage_cancellable,
+                                        drive_button_usage_done,
+                                        g_object_ref (self));
+    g_object_unref (root);
+
+    return FALSE;
+}
+
+void
+drive_button_set_show_usage (DriveButton *self,
+                             gboolean     show_usage)
+{
+    g_return_if_fail (DRIVE_IS_BUTTON (self));
+
+    show_usage = show_usage != FALSE;
+    if (self->show_usage == show_usage)
+        return;
+
+    self->show_usage = show_usage;
+    self->usage_interval = USAGE_INTERVAL_MIN;
+    if (!show_usage)
+        drive_button_stop_usage (self);
+
+    drive_button_queue_update (self);
+}
+
+static void
+drive_button_activity_changed (DriveActivity activity,
+                               gpointer      user_data)
+{
+    DriveButton *self = user_data;
+
+    self->activity = activity;
+    drive_button_queue_update (self);
+}
+
+/* Looks up the device of the volume or mount once, when the button gets
+ * it, and follows its I/O while the activity is shown */
+static void
+drive_button_watch_activity (DriveButton *self)
+{
+    guint64 device = 0;
+
+    drive_activity_unwatch (self->activity_watch);
+    self->activity_watch = 0;
+    self->activity = DRIVE_ACTIVITY_IDLE;
+
+    if (self->show_activity)
+        device = drive_activity_lookup_device (self->volume, self->mount);
+
+    self->activity_watch = drive_activity_watch (device,
+                                                 drive_button_activity_changed,
+                                                 self);
+}
+
+void
+drive_button_set_show_activity (DriveButton *self,
+                                gboolean     show_activity)
+{
+    g_return_if_fail (DRIVE_IS_BUTTON (self));
+
+    show_activity = show_activity != FALSE;
+    if (self->show_activity == show_activity)
+        return;
+
+    self->show_activity = show_activity;
+    drive_button_watch_activity (self);
+    drive_button_queue_update (self);
+}
+
+/* The icons loaded for the buttons, shared by all of them since most
+ * drives show the same few icons.  The whole cache goes when the icon
+ * theme changes. */
+typedef struct {
+    GIcon *icon;
+    int    size;
+    int    scale;
+} IconCacheKey;
+
+static GHashTable   *icon_cache = NULL;
+static GtkIconTheme *icon_cache_theme = NULL;
+
+static guint
+icon_cache_key_hash (gconstpointer data)
+{
+    const IconCacheKey *key = data;
+
+    return g_icon_hash (key->icon) ^ (key->size << 4) ^ key->scale;
+}
+
+static gboolean
+icon_cache_key_equal (gconstpointer a,
+                      gconstpointer b)
+{
+    const IconCacheKey *key_a = a, *key_b = b;
+
+    return key_a->size == key_b->size && key_a->scale == key_b->scale &&
+           g_icon_equal (key_a->icon, key_b->icon);
+}
+
+static void
+icon_cache_key_free (gpointer data)
+{
+    IconCacheKey *key = data;
+
+    g_object_unref (key->icon);
+    g_free (key);
+}
+
+static void
+icon_cache_clear (GtkIconTheme *icon_theme,
+                  gpointer      data)
+{
+    g_hash_table_remove_all (icon_cache);
+}
+
+/* Returns a new reference to the surface of the icon, from the cache
+ * if it was loaded before */
+static cairo_surface_t *
+drive_button_load_icon (DriveButton *self,
+                        GIcon       *icon,
+                        int          size,
+                        int          scale)
 {
-    DriveButton *self;
-    GdkScreen *screen;
     GtkIconTheme *icon_theme;
     GtkIconInfo *icon_info;
+    cairo_surface_t *surface = NULL;
+    IconCacheKey lookup = { icon, size, scale };
+    IconCacheKey *key;
+
+    icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (GTK_WIDGET (self)));
+
+    if (!icon_cache)
+        icon_cache = g_hash_table_new_full (icon_cache_key_hash, icon_cache_key_equal,
+                                            icon_cache_key_free,
+                                            (GDestroyNotify) cairo_surface_destroy);
+
+    if (icon_theme != icon_cache_theme) {
+        if (icon_cache_theme)
+            g_signal_handlers_disconnect_by_func (icon_cache_theme,
+                                                  G_CALLBACK (icon_cache_clear), NULL);
+        icon_cache_clear (icon_theme, NULL);
+        icon_cache_theme = icon_theme;
+        g_signal_connect (icon_theme, "changed",
+                          G_CALLBACK (icon_cache_clear), NULL);
+    }
+
+    surface = g_hash_table_lookup (icon_cache, &lookup);
+    if (surface)
+        return cairo_surface_reference (surface);
+
+    icon_info = gtk_icon_theme_lookup_by_gicon_for_scale (icon_theme, icon,
+                                                          size, scale,
+                                                          GTK_ICON_LOOKUP_USE_BUILTIN);
+    if (icon_info) {
+        surface = gtk_icon_info_load_surface (icon_info, NULL, NULL);
+        g_object_unref (icon_info);
+    }
+
+    if (!surface)
+        return NULL;
+
+    key = g_new (IconCacheKey, 1);
+    key->icon = g_object_ref (icon);
+    key->size = size;
+    key->scale = scale;
+    g_hash_table_insert (icon_cache, key, cairo_surface_reference (surface));
+
+    return surface;
+}
+
+static gboolean
+drive_button_update (gpointer user_data)
+{
+    DriveButton *self;
     GIcon *icon;
     int width, height, scale;
     cairo_t *cr;
@@ -281,22 +671,17 @@ drive_button_update (gpointer user_data)
     if (!self->volume && !self->mount)
     {
         gtk_widget_set_tooltip_text (GTK_WIDGET (self), _("nothing to mount"));
-        screen = gtk_widget_get_screen (GTK_WIDGET (self));
-        icon_theme = gtk_icon_theme_get_for_screen (screen); //m
         // note - other good icon would be emblem-unreadable
-        icon_info = gtk_icon_theme_lookup_icon_for_scale (icon_theme, "media-floppy",
-                                                          MIN (width, height), scale,
-                                                          GTK_ICON_LOOKUP_USE_BUILTIN);
-        if (icon_info) {
-            surface = gtk_icon_info_load_surface (icon_info, NULL, NULL);
-            g_object_unref (icon_info);
-        }
+        icon = g_themed_icon_new ("media-floppy");
+        surface = drive_button_load_icon (self, icon, MIN (width, height), scale);
+        g_object_unref (icon);
 
         if (!surface)
             return FALSE;
 
         if (gtk_bin_get_child (GTK_BIN (self)) != NULL)
             gtk_image_set_from_surface (GTK_IMAGE (gtk_bin_get_child (GTK_BIN (self))), surface);
+        cairo_surface_destroy (surface);
 
         return FALSE;
     }
@@ -310,6 +695,8 @@ drive_button_update (gpointer user_data)
         display_name = g_volume_get_name (self->volume);
         mount = g_volume_get_mount (self->volume);
 
+        drive_button_probe_media (self, mount);
+
         if (mount)
         {
             is_mounted = TRUE;
@@ -331,21 +718,43 @@ drive_button_update (gpointer user_data)
         icon = g_mount_get_icon (self->mount);
     }
 
+    /* unmounted volumes are never queried */
+    if (!self->show_usage || !is_mounted) {
+        drive_button_stop_usage (self);
+    } else if (!self->usage_tag && !self->usage_cancellable) {
+        drive_button_query_usage (self);
+    }
+
+    if (self->show_usage && is_mounted && self->usage >= 0) {
+        char *free_str, *size_str, *tmp;
+
+        free_str = g_format_size (self->usage_free);
+        size_str = g_format_size (self->usage_size);
+        /* Translators: free space and size of a mount, as in "1.2 GB free of 8.0 GB" */
+        tmp = g_strdup_printf (_("%s free of %s"), free_str, size_str);
+        g_free (free_str);
+        g_free (size_str);
+
+        free_str = tip;
+        tip = g_strdup_printf ("%s\n%s", tip, tmp);
+        g_free (free_str);
+        g_free (tmp);
+    }
+
+    if (self->activity != DRIVE_ACTIVITY_IDLE) {
+        char *tmp = tip;
+
+        tip = g_strdup_printf ("%s\n%s", tmp,
+                               self->activity == DRIVE_ACTIVITY_WRITING
+                               ? _("Writing data") : _("Reading data"));
+        g_free (tmp);
+    }
+
     gtk_widget_set_tooltip_text (GTK_WIDGET (self), tip);
     g_free (tip);
     g_free (display_name);
 
-    screen = gtk_widget_get_screen (GTK_WIDGET (self));
-    icon_theme = gtk_icon_theme_get_for_screen (screen);
-    icon_info = gtk_icon_theme_lookup_by_gicon_for_scale (icon_theme, icon,
-                                                          MIN (width, height), scale,
-                                                          GTK_ICON_LOOKUP_USE_BUILTIN);
-    if (icon_info)
-    {
-        surface = gtk_icon_info_load_surface (icon_info, NULL, NULL);
-        g_object_unref (icon_info);
-    }
-
+    surface = drive_button_load_icon (self, icon, MIN (width, height), scale);
     g_object_unref (icon);
 
     if (!surface)
@@ -409,6 +818,48 @@ drive_button_update (gpointer user_data)
     cairo_set_source_surface (cr, surface, 0, 0);
     cairo_paint (cr);
 
+    /* the usage bar along the bottom edge */
+    if (is_mounted && self->show_usage && self->usage >= 0)
+    {
+        int bar_width = cairo_image_surface_get_width (surface) / scale;
+        int bar_height = cairo_image_surface_get_height (surface) / scale;
+        int thickness = MAX (2, bar_height / 8);
+
+        cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+        cairo_set_source_rgba (cr, 0, 0, 0, 0.5);
+        cairo_rectangle (cr, 0, bar_height - thickness, bar_width, thickness);
+        cairo_fill (cr);
+
+        if (self->usage >= 0.9)
+            cairo_set_source_rgb (cr, 0.8, 0.1, 0.1);
+        else
+            cairo_set_source_rgb (cr, 0.2, 0.5, 0.9);
+        cairo_rectangle (cr, 0, bar_height - thickness,
+                         bar_width * self->usage, thickness);
+        cairo_fill (cr);
+    }
+
+    /* the activity light in the top right corner, amber while data is
+     * written out: not a moment to pull the drive */
+    if (self->activity != DRIVE_ACTIVITY_IDLE)
+    {
+        int light_width = cairo_image_surface_get_width (surface) / scale;
+        int light_height = cairo_image_surface_get_height (surface) / scale;
+        double radius = MAX (2, light_height / 10);
+
+        cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+        cairo_arc (cr, light_width - radius - 1, radius + 1, radius, 0, 2 * G_PI);
+        if (self->activity == DRIVE_ACTIVITY_WRITING)
+            cairo_set_source_rgb (cr, 0.95, 0.6, 0.1);
+        else
+            cairo_set_source_rgb (cr, 0.3, 0.8, 0.3);
+        cairo_fill_preserve (cr);
+        cairo_set_source_rgba (cr, 0, 0, 0, 0.5);
+        cairo_set_line_width (cr, 1);
+        cairo_stroke (cr);
+    }
+    cairo_destroy (cr);
+
     gtk_image_set_from_surface (GTK_IMAGE (gtk_bin_get_child (GTK_BIN (self))), tmp_surface);
 
     cairo_surface_destroy (surface);
@@ -448,44 +899,6 @@ drive_button_redraw (gpointer key,
     drive_button_queue_update (button);
 }
 
-int
-drive_button_compare (DriveButton *button,
-                      DriveButton *other_button)
-{
-    /* sort drives before driveless volumes volumes */
-    if (button->volume) {
-        if (other_button->volume) {
-            int cmp;
-            gchar *str1, *str2;
-
-            str1 = g_volume_get_name (button->volume);
-            str2 = g_volume_get_name (other_button->volume);
-            cmp = g_utf8_collate (str1, str2);
-            g_free (str2);
-            g_free (str1);
-
-            return cmp;
-        } else {
-            return -1;
-        }
-    } else {
-        if (other_button->volume) {
-            return 1;
-        } else {
-            int cmp;
-            gchar *str1, *str2;
-
-            str1 = g_mount_get_name (button->mount);
-            str2 = g_mount_get_name (other_button->mount);
-            cmp = g_utf8_collate (str1, str2);
-            g_free (str2);
-            g_free (str1);
-
-            return cmp;
-        }
-    }
-}
-
 static void
 drive_button_reset_popup (DriveButton *self)
 {
@@ -671,106 +1084,24 @@ gvm_run_command (const char *device,
     g_string_free (exec, TRUE);
     g_free (new_command);
 }
-
-/*
- * gvm_check_dvd_only - is this a Video DVD?
- *
- * Returns TRUE if this was a Video DVD and FALSE otherwise.
- * (the original in gvm was also running the autoplay action,
- * I removed that code, so I renamed from gvm_check_dvd to
- * gvm_check_dvd_only)
- */
-static gboolean
-gvm_check_dvd_only (const char *udi,
-                    const char *device,
-                    const char *mount_point)
-{
-    char *path;
-    gboolean retval;
-
-    path = g_build_path (G_DIR_SEPARATOR_S, mount_point, "video_ts", NULL);
-    retval = g_file_test (path, G_FILE_TEST_IS_DIR);
-    g_free (path);
-
-    /* try the other name, if needed */
-    if (retval == FALSE) {
-        path = g_build_path (G_DIR_SEPARATOR_S, mount_point,
-                             "VIDEO_TS", NULL);
-        retval = g_file_test (path, G_FILE_TEST_IS_DIR);
-        g_free (path);
-    }
-
-    return retval;
-}
 /* END copied from mate-volume-manager/src/manager.c */
 
+/* the content types come from drive_button_probe_media(), until they
+ * do the drive is offered to be opened */
 static gboolean
 check_dvd_video (DriveButton *self)
 {
-    GFile *file;
-    char *udi, *device_path, *mount_path;
-    gboolean result;
-    GMount *mount;
-
-    if (!self->volume)
-        return FALSE;
-
-    mount = g_volume_get_mount (self->volume);
-    if (!mount)
-        return FALSE;
-
-    file = g_mount_get_root (mount);
-    g_object_unref (mount);
-
-    if (!file)
-        return FALSE;
-
-    mount_path = g_file_get_path (file);
-
-    g_object_unref (file);
-
-    device_path = g_volume_get_identifier (self->volume,
-                                           G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE);
-    udi = g_volume_get_identifier (self->volume,
-                                   G_VOLUME_IDENTIFIER_KIND_HAL_UDI);
-
-    result = gvm_check_dvd_only (udi, device_path, mount_path);
-
-    g_free (device_path);
-    g_free (udi);
-    g_free (mount_path);
-
-    return result;
+    return self->content_types &&
+           g_strv_contains ((const gchar * const *) self->content_types,
+                            "x-content/video-dvd");
 }
 
 static gboolean
 check_audio_cd (DriveButton *self)
 {
-    GFile *file;
-    char *activation_uri;
-    GMount *mount;
-
-    if (!self->volume)
-        return FALSE;
-
-    mount = g_volume_get_mount (self->volume);
-    if (!mount)
-        return FALSE;
-
-    file = g_mount_get_root (mount);
-    g_object_unref (mount);
-
-    if (!file)
-        return FALSE;
-
-    activation_uri = g_file_get_uri (file);
-
-    g_object_unref (file);
-
-    /* we have an audioCD if the activation URI starts by 'cdda://' */
-    gboolean result = (strncmp ("cdda://", activation_uri, 7) == 0);
-    g_free (activation_uri);
-    return result;
+    return self->content_types &&
+           g_strv_contains ((const gchar * const *) self->content_types,
+                            "x-content/audio-cdda");
 }
 
 static void
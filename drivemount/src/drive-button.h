@@ -46,6 +46,23 @@ struct _DriveButton
     int icon_size;
     guint update_tag;
 
+    gboolean show_usage;
+    gdouble usage;              /* the used fraction, -1 if not known */
+    guint64 usage_free;
+    guint64 usage_size;
+    guint usage_tag;            /* the next query */
+    guint usage_timeout_tag;
+    guint usage_interval;       /* in seconds */
+    GCancellable *usage_cancellable; /* while a query runs */
+
+    gboolean show_activity;
+    guint activity_watch;       /* on the device under the button */
+    gint activity;              /* a DriveActivity */
+
+    GMount *probed_mount;       /* the mount the content types are of */
+    gchar **content_types;
+    GCancellable *probe_cancellable;
+
     GtkWidget *popup_menu;
 };
 
@@ -60,9 +77,10 @@ GtkWidget *drive_button_new_from_mount  (GMount *mount);
 void       drive_button_queue_update    (DriveButton *button);
 void       drive_button_set_size        (DriveButton *button,
                                          int          icon_size);
-
-int        drive_button_compare         (DriveButton *button,
-                                         DriveButton *other_button);
+void       drive_button_set_show_usage  (DriveButton *button,
+                                         gboolean     show_usage);
+void       drive_button_set_show_activity (DriveButton *button,
+                                           gboolean     show_activity);
 
 void       drive_button_redraw (gpointer key, gpointer value, gpointer user_data);
 
@@ -50,6 +50,15 @@ static void remove_volume       (DriveList *self, GVolume *volume);
 static void add_mount           (DriveList *self, GMount *mount);
 static void remove_mount        (DriveList *self, GMount *mount);
 static void queue_relayout      (DriveList *self);
+static void settings_show_usage_changed (GSettings *settings,
+                                         gchar     *key,
+                                         DriveList *self);
+static void settings_show_activity_changed (GSettings *settings,
+                                            gchar     *key,
+                                            DriveList *self);
+static void settings_filter_changed     (GSettings *settings,
+                                         gchar     *key,
+                                         DriveList *self);
 
 static void
 drive_list_class_init (DriveListClass *class)
@@ -60,30 +69,100 @@ drive_list_class_init (DriveListClass *class)
     GTK_CONTAINER_CLASS (class)->remove = drive_list_remove;
 }
 
+/* The mounts matching one of the ignored-mounts patterns are left out,
+ * and past max-buttons the drives are collapsed into one button. */
 static void
-drive_list_init (DriveList *self)
+load_filter (DriveList *self)
+{
+    gchar **patterns;
+    int i;
+
+    if (self->ignored)
+        g_ptr_array_unref (self->ignored);
+    self->ignored = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+    patterns = g_settings_get_strv (self->settings, "ignored-mounts");
+    for (i = 0; patterns[i] != NULL; i++)
+        g_ptr_array_add (self->ignored, g_pattern_spec_new (patterns[i]));
+    g_strfreev (patterns);
+
+    self->max_buttons = MAX (0, g_settings_get_int (self->settings, "max-buttons"));
+}
+
+static void
+add_all (DriveList *self)
 {
     GList *volumes, *mounts, *tmp;
 
+    volumes = g_volume_monitor_get_volumes (volume_monitor);
+    for (tmp = volumes; tmp != NULL; tmp = tmp->next) {
+        GVolume *volume = tmp->data;
+        add_volume (self, volume);
+        g_object_unref (volume);
+    }
+    g_list_free (volumes);
+
+    mounts = g_volume_monitor_get_mounts (volume_monitor);
+    for (tmp = mounts; tmp != NULL; tmp = tmp->next) {
+        GMount *mount = tmp->data;
+        add_mount (self, mount);
+        g_object_unref (mount);
+    }
+    g_list_free (mounts);
+
+    queue_relayout (self);
+}
+
+static void
+drive_list_init (DriveList *self)
+{
     gtk_grid_set_column_homogeneous (GTK_GRID (self), TRUE);
     gtk_grid_set_row_homogeneous (GTK_GRID (self), TRUE);
 
     self->volumes = g_hash_table_new (NULL, NULL);
     self->mounts = g_hash_table_new (NULL, NULL);
+    self->entries = g_ptr_array_new_with_free_func (g_object_unref);
+    self->placed = g_ptr_array_new ();
     self->orientation = GTK_ORIENTATION_HORIZONTAL;
     self->layout_tag = 0;
     self->settings = g_settings_new ("org.mate.drivemount");
     self->icon_size = 24;
     self->relief = GTK_RELIEF_NORMAL;
+    self->show_usage = g_settings_get_boolean (self->settings, "show-usage");
+    self->show_activity = g_settings_get_boolean (self->settings, "show-activity");
+    self->expanded = FALSE;
+    self->overflow = NULL;
+    self->ignored = NULL;
+    load_filter (self);
 
     g_signal_connect (self->settings,
                       "changed::drivemount-checkmark-color",
                       G_CALLBACK (settings_color_changed),
                       self);
+    g_signal_connect (self->settings,
+                      "changed::show-usage",
+                      G_CALLBACK (settings_show_usage_changed),
+                      self);
+    g_signal_connect (self->settings,
+                      "changed::show-activity",
+                      G_CALLBACK (settings_show_activity_changed),
+                      self);
+    g_signal_connect (self->settings,
+                      "changed::ignored-mounts",
+                      G_CALLBACK (settings_filter_changed),
+                      self);
+    g_signal_connect (self->settings,
+                      "changed::max-buttons",
+                      G_CALLBACK (settings_filter_changed),
+                      self);
+
+    /* shown while there is nothing else */
+    self->dummy = g_object_ref_sink (drive_button_new (NULL));
+    gtk_button_set_relief (GTK_BUTTON (self->dummy), self->relief);
+    drive_button_set_size (DRIVE_BUTTON (self->dummy), self->icon_size);
 
     /* listen for drive connects/disconnects, and add
      * currently connected drives. */
-    self->count = 0;
     if (!volume_monitor)
         volume_monitor = g_volume_monitor_get ();
 
@@ -99,32 +178,7 @@ drive_list_init (DriveList *self)
                              G_CALLBACK (volume_changed), self, 0);
     g_signal_connect_object (volume_monitor, "volume-removed",
                              G_CALLBACK (volume_removed), self, 0);
-    volumes = g_volume_monitor_get_volumes (volume_monitor);
-    for (tmp = volumes; tmp != NULL; tmp = tmp->next) {
-        GVolume *volume = tmp->data;
-        add_volume (self, volume);
-        g_object_unref (volume);
-        self->count++;
-    }
-    g_list_free (volumes);
-
-    mounts = g_volume_monitor_get_mounts (volume_monitor);
-    for (tmp = mounts; tmp != NULL; tmp = tmp->next) {
-        GMount *mount = tmp->data;
-        add_mount (self, mount);
-        g_object_unref (mount);
-        self->count++;
-    }
-    self->dummy = drive_button_new (NULL);
-    gtk_button_set_relief (GTK_BUTTON (self->dummy), self->relief);
-    drive_button_set_size (DRIVE_BUTTON (self->dummy), self->icon_size);
-
-    if (self->count == 0) {
-        gtk_container_add (GTK_CONTAINER (self), self->dummy);
-        queue_relayout (self);
-        drive_button_queue_update (DRIVE_BUTTON (self->dummy));
-    }
-    g_list_free (mounts);
+    add_all (self);
 }
 
 GtkWidget *
@@ -140,6 +194,10 @@ drive_list_finalize (GObject *object)
 
     g_hash_table_destroy (self->volumes);
     g_hash_table_destroy (self->mounts);
+    g_ptr_array_free (self->entries, TRUE);
+    g_ptr_array_free (self->placed, TRUE);
+    g_ptr_array_unref (self->ignored);
+    g_object_unref (self->dummy);
     g_object_unref (self->settings);
 
     if (G_OBJECT_CLASS (drive_list_parent_class)->finalize)
@@ -180,11 +238,15 @@ drive_list_add (GtkContainer *container,
     DriveButton *button;
 
     g_return_if_fail (DRIVE_IS_LIST (container));
-    g_return_if_fail (DRIVE_IS_BUTTON (child));
+    g_return_if_fail (GTK_IS_BUTTON (child));
 
     if (GTK_CONTAINER_CLASS (drive_list_parent_class)->add)
         (* GTK_CONTAINER_CLASS (drive_list_parent_class)->add) (container, child);
 
+    /* the overflow button stands for no drive */
+    if (!DRIVE_IS_BUTTON (child))
+        return;
+
     self = DRIVE_LIST (container);
     button = DRIVE_BUTTON (child);
     if (button->volume)
@@ -199,78 +261,316 @@ drive_list_remove (GtkContainer *container,
 {
     DriveList *self;
     DriveButton *button;
+    guint i;
 
     g_return_if_fail (DRIVE_IS_LIST (container));
-    g_return_if_fail (DRIVE_IS_BUTTON (child));
+    g_return_if_fail (GTK_IS_BUTTON (child));
 
     self = DRIVE_LIST (container);
-    button = DRIVE_BUTTON (child);
-    if (button->volume)
-        g_hash_table_remove (self->volumes, button->volume);
-    else
-        g_hash_table_remove (self->mounts, button->mount);
+
+    if (child == self->overflow) {
+        self->overflow = NULL;
+    } else if (DRIVE_IS_BUTTON (child)) {
+        button = DRIVE_BUTTON (child);
+        if (button->volume)
+            g_hash_table_remove (self->volumes, button->volume);
+        else
+            g_hash_table_remove (self->mounts, button->mount);
+
+        /* the place is empty now, the buttons after it are still there */
+        for (i = 0; i < self->placed->len; i++) {
+            if (g_ptr_array_index (self->placed, i) == button)
+                g_ptr_array_index (self->placed, i) = NULL;
+        }
+    }
 
     if (GTK_CONTAINER_CLASS (drive_list_parent_class)->remove)
         (* GTK_CONTAINER_CLASS (drive_list_parent_class)->remove) (container, child);
 }
 
+static char *
+entry_get_name (GObject *entry)
+{
+    if (G_IS_VOLUME (entry))
+        return g_volume_get_name (G_VOLUME (entry));
+    else
+        return g_mount_get_name (G_MOUNT (entry));
+}
+
+static int
+entry_compare (GObject *entry,
+               GObject *other)
+{
+    int cmp;
+    gchar *str1, *str2;
+
+    /* sort drives before driveless volumes volumes */
+    if (G_IS_VOLUME (entry) != G_IS_VOLUME (other))
+        return G_IS_VOLUME (entry) ? -1 : 1;
+
+    str1 = entry_get_name (entry);
+    str2 = entry_get_name (other);
+    cmp = g_utf8_collate (str1, str2);
+    g_free (str2);
+    g_free (str1);
+
+    return cmp;
+}
+
+static gboolean
+matches_filter (DriveList  *self,
+                const char *string)
+{
+    guint i;
+
+    if (!string)
+        return FALSE;
+
+    for (i = 0; i < self->ignored->len; i++) {
+        if (g_pattern_match_string (g_ptr_array_index (self->ignored, i), string))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Volumes are matched by name and device, mounts by name, mount point
+ * and URI */
+static gboolean
+is_ignored (DriveList *self,
+            GObject   *entry)
+{
+    gboolean ignored;
+    char *name, *path, *uri = NULL;
+
+    if (self->ignored->len == 0)
+        return FALSE;
+
+    name = entry_get_name (entry);
+    if (G_IS_VOLUME (entry)) {
+        path = g_volume_get_identifier (G_VOLUME (entry),
+                                        G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE);
+    } else {
+        GFile *root = g_mount_get_root (G_MOUNT (entry));
+
+        path = g_file_get_path (root);
+        uri = g_file_get_uri (root);
+        g_object_unref (root);
+    }
+
+    ignored = matches_filter (self, name) || matches_filter (self, path) ||
+              matches_filter (self, uri);
+
+    g_free (name);
+    g_free (path);
+    g_free (uri);
+
+    return ignored;
+}
+
+static gint
+find_entry (DriveList *self,
+            gpointer   entry)
+{
+    guint i;
+
+    for (i = 0; i < self->entries->len; i++) {
+        if (g_ptr_array_index (self->entries, i) == entry)
+            return i;
+    }
+    return -1;
+}
+
+/* Puts the entry in its place in the sorted entries, by bisection */
+static void
+insert_entry (DriveList *self,
+              GObject   *entry)
+{
+    guint low = 0, high = self->entries->len;
+
+    while (low < high) {
+        guint middle = (low + high) / 2;
+
+        if (entry_compare (g_ptr_array_index (self->entries, middle), entry) <= 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    g_ptr_array_insert (self->entries, low, g_object_ref (entry));
+    queue_relayout (self);
+}
+
+/* Moves an entry whose name may have changed, if it is out of order */
 static void
-list_buttons (gpointer key,
-              gpointer value,
-              gpointer user_data)
+update_entry (DriveList *self,
+              GObject   *entry)
 {
-    GtkWidget *button = value;
-    GList **sorted_buttons = user_data;
+    gint i = find_entry (self, entry);
+
+    if (i < 0)
+        return;
 
-    *sorted_buttons = g_list_insert_sorted (*sorted_buttons, button,
-                                            (GCompareFunc)drive_button_compare);
+    if ((i > 0 &&
+         entry_compare (g_ptr_array_index (self->entries, i - 1), entry) > 0) ||
+        (i + 1 < (gint) self->entries->len &&
+         entry_compare (entry, g_ptr_array_index (self->entries, i + 1)) > 0)) {
+        g_object_ref (entry);
+        g_ptr_array_remove_index (self->entries, i);
+        insert_entry (self, entry);
+        g_object_unref (entry);
+    }
+}
+
+static GtkWidget *
+lookup_button (DriveList *self,
+               GObject   *entry)
+{
+    if (G_IS_VOLUME (entry))
+        return g_hash_table_lookup (self->volumes, entry);
+    else
+        return g_hash_table_lookup (self->mounts, entry);
+}
+
+static GtkWidget *
+create_button (DriveList *self,
+               GObject   *entry)
+{
+    GtkWidget *button;
+
+    if (G_IS_VOLUME (entry))
+        button = drive_button_new (G_VOLUME (entry));
+    else
+        button = drive_button_new_from_mount (G_MOUNT (entry));
+
+    gtk_button_set_relief (GTK_BUTTON (button), self->relief);
+    drive_button_set_size (DRIVE_BUTTON (button), self->icon_size);
+    drive_button_set_show_usage (DRIVE_BUTTON (button), self->show_usage);
+    drive_button_set_show_activity (DRIVE_BUTTON (button), self->show_activity);
+    gtk_container_add (GTK_CONTAINER (self), button);
+    gtk_widget_show (button);
+
+    return button;
+}
+
+static void
+place_button (DriveList *self,
+              GtkWidget *button,
+              guint      i)
+{
+    if (self->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        gtk_container_child_set (GTK_CONTAINER (self), button,
+                                 "left-attach", i + 1, "top-attach", 0,
+                                 "width", 1, "height", 1,
+                                 NULL);
+    }
+    else {
+        gtk_container_child_set (GTK_CONTAINER (self), button,
+                                 "left-attach", 0, "top-attach", i + 1,
+                                 "width", 1, "height", 1,
+                                 NULL);
+    }
+}
+
+static void
+overflow_clicked (GtkButton *button,
+                  DriveList *self)
+{
+    self->expanded = !self->expanded;
+    queue_relayout (self);
+}
+
+/* The button after the drives, with the number of the ones collapsed
+ * into it, or to collapse them again */
+static void
+update_overflow (DriveList *self,
+                 guint      hidden,
+                 guint      position)
+{
+    char *text;
+
+    if (self->max_buttons == 0 || self->entries->len <= self->max_buttons) {
+        if (self->overflow)
+            gtk_container_remove (GTK_CONTAINER (self), self->overflow);
+        self->expanded = FALSE;
+        return;
+    }
+
+    if (!self->overflow) {
+        self->overflow = gtk_button_new ();
+        gtk_widget_set_name (self->overflow, "drive-button");
+        gtk_button_set_relief (GTK_BUTTON (self->overflow), self->relief);
+        g_signal_connect (self->overflow, "clicked",
+                          G_CALLBACK (overflow_clicked), self);
+        gtk_container_add (GTK_CONTAINER (self), self->overflow);
+        gtk_widget_show (self->overflow);
+    }
+
+    if (self->expanded) {
+        gtk_button_set_label (GTK_BUTTON (self->overflow), "\342\210\222");
+        gtk_widget_set_tooltip_text (self->overflow, _("Show fewer drives"));
+    } else {
+        text = g_strdup_printf ("+%u", hidden);
+        gtk_button_set_label (GTK_BUTTON (self->overflow), text);
+        g_free (text);
+
+        text = g_strdup_printf (ngettext ("%u more drive", "%u more drives", hidden),
+                                hidden);
+        gtk_widget_set_tooltip_text (self->overflow, text);
+        g_free (text);
+    }
+
+    place_button (self, self->overflow, position);
 }
 
 static gboolean
 relayout_buttons (gpointer data)
 {
     DriveList *self = DRIVE_LIST (data);
-    GList *sorted_buttons = NULL, *tmp;
-    int i = 0;
+    guint i, shown;
 
     self->layout_tag = 0;
-    if ( self->count > 0 ) {
-        g_hash_table_foreach (self->volumes, list_buttons, &sorted_buttons);
-        g_hash_table_foreach (self->mounts, list_buttons, &sorted_buttons);
-
-        /* position buttons in the table according to their sorted order */
-        for (tmp = sorted_buttons, i = 0; tmp != NULL; tmp = tmp->next, i++) {
-            GtkWidget *button = tmp->data;
-
-            if (self->orientation == GTK_ORIENTATION_HORIZONTAL) {
-                gtk_container_child_set (GTK_CONTAINER (self), button,
-                                         "left-attach", i + 1, "top-attach", 0,
-                                         "width", 1, "height", 1,
-                                         NULL);
-            }
-            else {
-                gtk_container_child_set (GTK_CONTAINER (self), button,
-                                         "left-attach", 0, "top-attach", i + 1,
-                                         "width", 1, "height", 1,
-                                         NULL);
-            }
+
+    if (self->entries->len == 0) {
+        if (!gtk_widget_get_parent (self->dummy)) {
+            gtk_container_add (GTK_CONTAINER (self), self->dummy);
+            drive_button_queue_update (DRIVE_BUTTON (self->dummy));
         }
-    }
-    else {
         gtk_widget_show (self->dummy);
-        if (self->orientation == GTK_ORIENTATION_HORIZONTAL) {
-            gtk_container_child_set (GTK_CONTAINER (self), self->dummy,
-                                     "left-attach", i + 1, "top-attach", 0,
-                                     "width", 1, "height", 1,
-                                     NULL);
-        }
-        else {
-            gtk_container_child_set (GTK_CONTAINER (self), self->dummy,
-                                     "left-attach", 0, "top-attach", i + 1,
-                                     "width", 1, "height", 1,
-                                     NULL);
-        }
+        place_button (self, self->dummy, 0);
+    } else if (gtk_widget_get_parent (self->dummy)) {
+        gtk_container_remove (GTK_CONTAINER (self), self->dummy);
+    }
+
+    shown = self->entries->len;
+    if (self->max_buttons > 0 && !self->expanded)
+        shown = MIN (shown, self->max_buttons);
+
+    /* the drives past the limit have no button while collapsed */
+    for (i = shown; i < self->entries->len; i++) {
+        GtkWidget *button = lookup_button (self, g_ptr_array_index (self->entries, i));
+
+        if (button)
+            gtk_container_remove (GTK_CONTAINER (self), button);
+    }
+
+    /* only the buttons not already in their place are moved */
+    for (i = 0; i < shown; i++) {
+        GObject *entry = g_ptr_array_index (self->entries, i);
+        GtkWidget *button = lookup_button (self, entry);
+
+        if (!button)
+            button = create_button (self, entry);
+        else if (i < self->placed->len && g_ptr_array_index (self->placed, i) == button)
+            continue;
+
+        place_button (self, button, i);
     }
+
+    g_ptr_array_set_size (self->placed, shown);
+    for (i = 0; i < shown; i++)
+        g_ptr_array_index (self->placed, i) = lookup_button (self, g_ptr_array_index (self->entries, i));
+
+    update_overflow (self, self->entries->len - shown, shown);
+
     return FALSE;
 }
 
@@ -288,9 +588,6 @@ mount_added (GVolumeMonitor *monitor,
              DriveList      *self)
 {
     add_mount (self, mount);
-    self->count++;
-    if (self->count == 1)
-        gtk_container_remove (GTK_CONTAINER (self), g_object_ref (self->dummy));
 
     mount_changed (monitor, mount, self);
 }
@@ -301,17 +598,19 @@ mount_changed (GVolumeMonitor *monitor,
                DriveList      *self)
 {
     GVolume *volume;
-    DriveButton *button = NULL;;
+    GtkWidget *button = NULL;;
 
     volume = g_mount_get_volume (mount);
     if (volume) {
+        update_entry (self, G_OBJECT (volume));
         button = g_hash_table_lookup (self->volumes, volume);
         g_object_unref (volume);
     } else {
+        update_entry (self, G_OBJECT (mount));
         button = g_hash_table_lookup (self->mounts, mount);
     }
     if (button)
-        drive_button_queue_update (button);
+        drive_button_queue_update (DRIVE_BUTTON (button));
 }
 
 static void
@@ -321,11 +620,6 @@ mount_removed (GVolumeMonitor *monitor,
 {
     remove_mount (self, mount);
     mount_changed (monitor, mount, self);
-    self->count--;
-    if (self->count == 0) {
-        gtk_container_add (GTK_CONTAINER (self), self->dummy);
-        queue_relayout (self);
-    }
 }
 
 static void
@@ -334,9 +628,6 @@ volume_added (GVolumeMonitor *monitor,
               DriveList      *self)
 {
     add_volume (self, volume);
-    self->count++;
-    if (self->count == 1)
-        gtk_container_remove (GTK_CONTAINER (self), g_object_ref (self->dummy));
 }
 
 static void
@@ -344,11 +635,12 @@ volume_changed (GVolumeMonitor *monitor,
                 GVolume        *volume,
                 DriveList      *self)
 {
-    DriveButton *button = NULL;;
+    GtkWidget *button = NULL;;
 
+    update_entry (self, G_OBJECT (volume));
     button = g_hash_table_lookup (self->volumes, volume);
     if (button)
-        drive_button_queue_update (button);
+        drive_button_queue_update (DRIVE_BUTTON (button));
 }
 
 static void
@@ -357,28 +649,38 @@ volume_removed (GVolumeMonitor *monitor,
                 DriveList      *self)
 {
     remove_volume (self, volume);
-    self->count--;
-    if (self->count == 0) {
-        gtk_container_add (GTK_CONTAINER (self), self->dummy);
-        queue_relayout (self);
-    }
 }
 
 static void
 add_volume (DriveList *self,
             GVolume   *volume)
+{
+    /* if the volume has already been added, return */
+    if (find_entry (self, volume) >= 0)
+        return;
+
+    if (is_ignored (self, G_OBJECT (volume)))
+        return;
+
+    insert_entry (self, G_OBJECT (volume));
+}
+
+static void
+remove_entry (DriveList *self,
+              GObject   *entry)
 {
     GtkWidget *button;
+    gint i;
 
-    /* if the volume has already been added, return */
-    if (g_hash_table_lookup (self->volumes, volume) != NULL)
+    i = find_entry (self, entry);
+    if (i < 0)
         return;
 
-    button = drive_button_new (volume);
-    gtk_button_set_relief (GTK_BUTTON (button), self->relief);
-    drive_button_set_size (DRIVE_BUTTON (button), self->icon_size);
-    gtk_container_add (GTK_CONTAINER (self), button);
-    gtk_widget_show (button);
+    button = lookup_button (self, entry);
+    if (button)
+        gtk_container_remove (GTK_CONTAINER (self), button);
+
+    g_ptr_array_remove_index (self->entries, i);
     queue_relayout (self);
 }
 
@@ -386,21 +688,13 @@ static void
 remove_volume (DriveList *self,
                GVolume   *volume)
 {
-    GtkWidget *button;
-
-    /* if the volume has already been added, return */
-    button = g_hash_table_lookup (self->volumes, volume);
-    if (button) {
-        gtk_container_remove (GTK_CONTAINER (self), button);
-        queue_relayout (self);
-    }
+    remove_entry (self, G_OBJECT (volume));
 }
 
 static void
 add_mount (DriveList *self,
            GMount    *mount)
 {
-    GtkWidget *button;
     GVolume *volume;
 
     /* ignore mounts reported as shadowed */
@@ -416,29 +710,42 @@ add_mount (DriveList *self,
     }
 
     /* if the mount has already been added, return */
-    if (g_hash_table_lookup (self->mounts, mount) != NULL)
+    if (find_entry (self, mount) >= 0)
         return;
 
-    button = drive_button_new_from_mount (mount);
-    gtk_button_set_relief (GTK_BUTTON (button), self->relief);
-    drive_button_set_size (DRIVE_BUTTON (button), self->icon_size);
-    gtk_container_add (GTK_CONTAINER (self), button);
-    gtk_widget_show (button);
-    queue_relayout (self);
+    if (is_ignored (self, G_OBJECT (mount)))
+        return;
+
+    insert_entry (self, G_OBJECT (mount));
 }
 
 static void
 remove_mount (DriveList *self,
               GMount    *mount)
 {
-    GtkWidget *button;
+    remove_entry (self, G_OBJECT (mount));
+}
 
-    /* if the mount has already been added, return */
-    button = g_hash_table_lookup (self->mounts, mount);
-    if (button) {
-        gtk_container_remove (GTK_CONTAINER (self), button);
-        queue_relayout (self);
+static void
+settings_filter_changed (GSettings *settings,
+                         gchar     *key,
+                         DriveList *self)
+{
+    guint i;
+
+    load_filter (self);
+
+    /* the drives are taken again through the new rules */
+    for (i = 0; i < self->entries->len; i++) {
+        GtkWidget *button = lookup_button (self, g_ptr_array_index (self->entries, i));
+
+        if (button)
+            gtk_container_remove (GTK_CONTAINER (self), button);
     }
+    g_ptr_array_set_size (self->entries, 0);
+    self->expanded = FALSE;
+
+    add_all (self);
 }
 
 void
@@ -449,6 +756,8 @@ drive_list_set_orientation (DriveList      *self,
 
     if (orientation != self->orientation) {
         self->orientation = orientation;
+        /* every button moves */
+        g_ptr_array_set_size (self->placed, 0);
         queue_relayout (self);
     }
 }
@@ -493,6 +802,46 @@ settings_color_changed (GSettings *settings,
     drive_list_redraw (drive_list);
 }
 
+static void
+set_show_usage (gpointer key,
+                gpointer value,
+                gpointer user_data)
+{
+    DriveList *self = user_data;
+
+    drive_button_set_show_usage (DRIVE_BUTTON (value), self->show_usage);
+}
+
+static void
+settings_show_usage_changed (GSettings *settings,
+                             gchar     *key,
+                             DriveList *self)
+{
+    self->show_usage = g_settings_get_boolean (settings, key);
+    g_hash_table_foreach (self->volumes, set_show_usage, self);
+    g_hash_table_foreach (self->mounts, set_show_usage, self);
+}
+
+static void
+set_show_activity (gpointer key,
+                   gpointer value,
+                   gpointer user_data)
+{
+    DriveList *self = user_data;
+
+    drive_button_set_show_activity (DRIVE_BUTTON (value), self->show_activity);
+}
+
+static void
+settings_show_activity_changed (GSettings *settings,
+                                gchar     *key,
+                                DriveList *self)
+{
+    self->show_activity = g_settings_get_boolean (settings, key);
+    g_hash_table_foreach (self->volumes, set_show_activity, self);
+    g_hash_table_foreach (self->mounts, set_show_activity, self);
+}
+
 static void
 set_button_relief (gpointer key,
                    gpointer value,
@@ -518,4 +867,6 @@ drive_list_set_transparent (DriveList *self,
     self->relief = relief;
     g_hash_table_foreach (self->volumes, set_button_relief, self);
     g_hash_table_foreach (self->mounts, set_button_relief, self);
+    if (self->overflow)
+        gtk_button_set_relief (GTK_BUTTON (self->overflow), relief);
 }
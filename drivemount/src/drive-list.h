@@ -43,11 +43,18 @@ struct _DriveList
 
     GHashTable *volumes;
     GHashTable *mounts;
+    GPtrArray *entries;     /* the volumes and mounts in display order */
+    GPtrArray *placed;      /* the buttons as last attached to the grid */
+    GPtrArray *ignored;     /* GPatternSpecs of the mounts left out */
+    guint max_buttons;      /* before the rest collapse, 0 for no limit */
+    gboolean expanded;
+    GtkWidget *overflow;    /* the button for the collapsed drives */
     GtkOrientation orientation;
     guint layout_tag;
     GtkReliefStyle relief;
+    gboolean show_usage;
+    gboolean show_activity;
     GtkWidget *dummy;
-    gint count;
 
     GSettings *settings;
 
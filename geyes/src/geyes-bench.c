@@ -0,0 +1,109 @@
+/* Measures the eyes of the geyes themes offscreen.
+ *
+ * The eyes are set up as on the panel and drawn by the same draw
+ * handler, after they were turned towards a pointer going round the
+ * applet as on every poll of the pointer.
+ *
+ * Built on request only: make -C geyes/src geyes-bench
+ * and run with --themes geyes/themes to use the themes of the source
+ * tree rather than the installed ones.
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "common/applet-bench.h"
+
+#include "geyes.h"
+
+static gchar *bench_themes_dir = NULL;
+
+static GOptionEntry bench_entries [] = {
+    { "themes", 't', 0, G_OPTION_ARG_FILENAME, &bench_themes_dir, "Directory of the themes (default: the installed ones)", "DIR" },
+    { NULL }
+};
+
+static void
+bench_eyes_look (gint     frame,
+                 gpointer data)
+{
+    EyesApplet *eyes_applet = data;
+    GtkAllocation allocation;
+    gint x, y;
+    gsize i;
+
+    /* once round the applet every 64 frames, at a distance where the
+     * pupils sit against the wall */
+    gtk_widget_get_allocation (eyes_applet->vbox, &allocation);
+    x = allocation.width / 2 + (gint) (allocation.width * cos (frame * G_PI / 32));
+    y = allocation.height / 2 + (gint) (allocation.height * sin (frame * G_PI / 32));
+
+    for (i = 0; i < eyes_applet->num_eyes; i++)
+    {
+        gint eye_x, eye_y;
+
+        gtk_widget_translate_coordinates (eyes_applet->vbox, eyes_applet->eyes[i],
+                                          x, y, &eye_x, &eye_y);
+        eyes_look_at (eyes_applet, i, eye_x, eye_y);
+    }
+}
+
+static void
+bench_theme (const gchar *name,
+             gint         panel_size)
+{
+    EyesApplet *eyes_applet;
+    gchar *theme_dir, *config, *label;
+
+    theme_dir = g_build_filename (bench_themes_dir != NULL ? bench_themes_dir : GEYES_THEMES_DIR,
+                                  name, NULL);
+
+    /* load_theme falls back to the installed default, and takes the
+     * applet off the panel without it */
+    config = g_build_filename (theme_dir, "config", NULL);
+    if (!g_file_test (config, G_FILE_TEST_IS_REGULAR))
+    {
+        g_printerr ("No theme in %s\n", theme_dir);
+        g_free (config);
+        g_free (theme_dir);
+        return;
+    }
+    g_free (config);
+
+    /* the eyes of a panel applet, without the panel; they are not
+     * destroyed, the window takes them along */
+    eyes_applet = g_new0 (EyesApplet, 1);
+    eyes_applet->vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+    load_theme (eyes_applet, theme_dir);
+    setup_eyes (eyes_applet);
+
+    label = g_strdup_printf ("%s %d", name, panel_size);
+    applet_bench_draw ("geyes:eye_draw_cb", label, eyes_applet->vbox, -1, panel_size,
+                       bench_eyes_look, eyes_applet);
+
+    g_free (label);
+    g_free (theme_dir);
+}
+
+int
+main (int argc, char *argv [])
+{
+    static const gchar *themes [] = { "Default-tiny", "Default", "Digital", "Horrid" };
+    gsize i;
+
+    if (!applet_bench_init (&argc, &argv, "- measure the geyes themes offscreen", bench_entries))
+        return EXIT_FAILURE;
+
+    /* the smallest and the largest panel */
+    for (i = 0; i < G_N_ELEMENTS (themes); i++)
+    {
+        bench_theme (themes [i], 24);
+        bench_theme (themes [i], 128);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -22,10 +22,19 @@
 #include <stdlib.h>
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
+#include "common/applet-probe.h"
 #include "geyes.h"
 
 #define UPDATE_TIMEOUT 100
 
+/* The pointer is only seen by polling, so a pointer left alone for
+ * IDLE_DELAY is polled every IDLE_TIMEOUT, in seconds to let the wakeups
+ * of the applets line up. */
+#define IDLE_DELAY (2 * G_USEC_PER_SEC)
+#define IDLE_TIMEOUT 1
+
+static void timer_update (EyesApplet *eyes_applet);
+
 static gfloat
 gtk_align_to_gfloat (GtkAlign align)
 {
@@ -42,7 +51,11 @@ gtk_align_to_gfloat (GtkAlign align)
     }
 }
 
-/* TODO - Optimize this a bit */
+/* The pupil follows a pointer near the middle of the eye, and otherwise
+ * sits against the wall in the direction of the pointer, as worked out
+ * for the theme by load_theme. The direction is the pseudo angle
+ * ny / (|nx| + |ny|) made to go round from 0 to 4, which keeps the order
+ * of the angles without any trigonometry. */
 static void
 calculate_pupil_xy (EyesApplet *eyes_applet,
                     gint        x,
@@ -52,13 +65,11 @@ calculate_pupil_xy (EyesApplet *eyes_applet,
                     GtkWidget  *widget)
 {
     GtkAllocation allocation;
-    float sina;
-    float cosa;
-    float h;
-    float temp;
+    const EyesPupilPosition *position;
     float nx, ny;
     float xalign, yalign;
     float eye_width_half, eye_height_half;
+    float d;
 
     gtk_widget_get_allocation (GTK_WIDGET (widget), &allocation);
     xalign = gtk_align_to_gfloat (gtk_widget_get_halign (widget));
@@ -71,28 +82,22 @@ calculate_pupil_xy (EyesApplet *eyes_applet,
     ny = (float) y - (float) MAX (allocation.height - eyes_applet->eye_height, 0) * yalign
          - eye_height_half;
 
-    h = hypotf (nx, ny);
-    if ((h < 0.5f) ||
-        (fabs (h) < (fabs (hypotf (eye_height_half, eye_width_half)
-                           - (float) eyes_applet->wall_thickness
-                           - (float) eyes_applet->pupil_height)))) {
+    if (nx * nx + ny * ny < eyes_applet->pupil_free_distance2) {
         *pupil_x = (gint)(nx + eye_width_half);
         *pupil_y = (gint)(ny + eye_height_half);
         return;
     }
 
-    sina = nx / h;
-    cosa = ny / h;
-
-    temp  = hypotf ((float) eyes_applet->eye_width * sina,
-                    (float) eyes_applet->eye_height * cosa);
-    temp -= hypotf ((float) eyes_applet->pupil_width * sina,
-                    (float) eyes_applet->pupil_height * cosa);
-    temp -= (float) eyes_applet->wall_thickness * hypotf (sina, cosa);
-    temp *= 0.5f;
+    if (ny >= 0.0f)
+        d = nx >= 0.0f ? ny / (nx + ny) : 1.0f - nx / (ny - nx);
+    else
+        d = nx < 0.0f ? 2.0f - ny / (-nx - ny) : 3.0f + nx / (nx - ny);
 
-    *pupil_x = (gint)(temp * sina + eye_width_half);
-    *pupil_y = (gint)(temp * cosa + eye_height_half);
+    /* 4 is 0 again */
+    position = &eyes_applet->pupil_positions[(gsize) (d * (PUPIL_DIRECTIONS / 4))
+                                             & (PUPIL_DIRECTIONS - 1)];
+    *pupil_x = position->x;
+    *pupil_y = position->y;
 }
 
 static void
@@ -101,39 +106,115 @@ draw_eye (EyesApplet *eyes_applet,
           gint        pupil_x,
           gint        pupil_y)
 {
-    GdkPixbuf *pixbuf;
-    GdkRectangle rect, r1, r2;
-
-    pixbuf = gdk_pixbuf_copy (eyes_applet->eye_image);
-    r1.x = pupil_x - eyes_applet->pupil_width / 2;
-    r1.y = pupil_y - eyes_applet->pupil_height / 2;
-    r1.width = eyes_applet->pupil_width;
-    r1.height = eyes_applet->pupil_height;
-    r2.x = 0;
-    r2.y = 0;
-    r2.width = eyes_applet->eye_width;
-    r2.height = eyes_applet->eye_height;
-    gdk_rectangle_intersect (&r1, &r2, &rect);
-    gdk_pixbuf_composite (eyes_applet->pupil_image, pixbuf,
-                          rect.x, rect.y,
-                          rect.width, rect.height,
-                          pupil_x - eyes_applet->pupil_width / 2,
-                          pupil_y - eyes_applet->pupil_height / 2,
-                          1.0, 1.0,
-                          GDK_INTERP_BILINEAR,
-                          255);
-    gtk_image_set_from_pixbuf (GTK_IMAGE (eyes_applet->eyes[eye_num]), pixbuf);
-    g_object_unref (pixbuf);
+    eyes_applet->pupil_x[eye_num] = pupil_x;
+    eyes_applet->pupil_y[eye_num] = pupil_y;
+    gtk_widget_queue_draw (eyes_applet->eyes[eye_num]);
+}
+
+static cairo_surface_t *
+surface_from_pixbuf (GdkWindow *window,
+                     GdkPixbuf *pixbuf)
+{
+    cairo_surface_t *surface;
+    cairo_t *cr;
+
+    /* similar to the window, so it has the device scale of the screen
+     * and paints without conversion */
+    surface = gdk_window_create_similar_surface (window,
+                                                 CAIRO_CONTENT_COLOR_ALPHA,
+                                                 gdk_pixbuf_get_width (pixbuf),
+                                                 gdk_pixbuf_get_height (pixbuf));
+    cr = cairo_create (surface);
+    gdk_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
+    cairo_paint (cr);
+    cairo_destroy (cr);
+
+    return surface;
+}
 
+static void
+free_surfaces (EyesApplet *eyes_applet)
+{
+    g_clear_pointer (&eyes_applet->eye_surface, cairo_surface_destroy);
+    g_clear_pointer (&eyes_applet->pupil_surface, cairo_surface_destroy);
 }
 
-static gint
+static gboolean
+eye_draw_cb (GtkWidget  *widget,
+             cairo_t    *cr,
+             EyesApplet *eyes_applet)
+{
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "geyes:eye_draw_cb");
+    GtkAllocation allocation;
+    gsize eye_num;
+    double x, y;
+    gint scale;
+
+    scale = gtk_widget_get_scale_factor (widget);
+    if (eyes_applet->eye_surface == NULL || eyes_applet->surface_scale != scale) {
+        GdkWindow *window = gtk_widget_get_window (widget);
+
+        free_surfaces (eyes_applet);
+        eyes_applet->eye_surface = surface_from_pixbuf (window, eyes_applet->eye_image);
+        eyes_applet->pupil_surface = surface_from_pixbuf (window, eyes_applet->pupil_image);
+        eyes_applet->surface_scale = scale;
+    }
+
+    /* placed like calculate_pupil_xy expects */
+    gtk_widget_get_allocation (widget, &allocation);
+    x = floor (MAX (allocation.width - eyes_applet->eye_width, 0)
+               * gtk_align_to_gfloat (gtk_widget_get_halign (widget)));
+    y = floor (MAX (allocation.height - eyes_applet->eye_height, 0)
+               * gtk_align_to_gfloat (gtk_widget_get_valign (widget)));
+
+    cairo_set_source_surface (cr, eyes_applet->eye_surface, x, y);
+    cairo_paint (cr);
+
+    eye_num = GPOINTER_TO_SIZE (g_object_get_data (G_OBJECT (widget), "eye-num"));
+    cairo_rectangle (cr, x, y, eyes_applet->eye_width, eyes_applet->eye_height);
+    cairo_clip (cr);
+    cairo_set_source_surface (cr, eyes_applet->pupil_surface,
+                              x + eyes_applet->pupil_x[eye_num] - eyes_applet->pupil_width / 2,
+                              y + eyes_applet->pupil_y[eye_num] - eyes_applet->pupil_height / 2);
+    cairo_paint (cr);
+
+    applet_probe_end (probe, start);
+    return FALSE;
+}
+
+gboolean
+eyes_look_at (EyesApplet *eyes_applet,
+              gsize       eye_num,
+              gint        x,
+              gint        y)
+{
+    gint pupil_x, pupil_y;
+
+    if ((x == eyes_applet->pointer_last_x[eye_num]) &&
+        (y == eyes_applet->pointer_last_y[eye_num]))
+        return FALSE;
+
+    calculate_pupil_xy (eyes_applet, x, y, &pupil_x, &pupil_y,
+                        eyes_applet->eyes[eye_num]);
+    draw_eye (eyes_applet, eye_num, pupil_x, pupil_y);
+
+    eyes_applet->pointer_last_x[eye_num] = x;
+    eyes_applet->pointer_last_y[eye_num] = y;
+
+    return TRUE;
+}
+
+static gboolean
 timer_cb (EyesApplet *eyes_applet)
 {
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "geyes:timer_cb");
     GdkDisplay *display;
     GdkSeat *seat;
     gint x, y;
-    gint pupil_x, pupil_y;
+    gint64 now;
+    guint interval;
     gsize i;
 #ifdef ENABLE_IN_PROCESS
     GtkAllocation allocation;
@@ -142,6 +223,7 @@ timer_cb (EyesApplet *eyes_applet)
     gint dx, dy;
 #endif
 
+    now = g_get_monotonic_time ();
     display = gtk_widget_get_display (GTK_WIDGET (eyes_applet->applet));
     seat = gdk_display_get_default_seat (display);
 
@@ -168,19 +250,118 @@ timer_cb (EyesApplet *eyes_applet)
             y -= dy;
 #endif
 
-            if ((x != eyes_applet->pointer_last_x[i]) ||
-                (y != eyes_applet->pointer_last_y[i])) {
+            if (eyes_look_at (eyes_applet, i, x, y))
+                eyes_applet->pointer_last_move = now;
+        }
+    }
+
+    applet_probe_end (probe, start);
+
+    interval = now - eyes_applet->pointer_last_move > IDLE_DELAY ?
+               IDLE_TIMEOUT * 1000 : UPDATE_TIMEOUT;
+    if (interval == eyes_applet->timeout_interval)
+        return G_SOURCE_CONTINUE;
+
+    /* the pointer stopped or moved again */
+    eyes_applet->timeout_id = 0;
+    eyes_applet->timeout_interval = interval;
+    timer_update (eyes_applet);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Polls the pointer while the eyes can be seen, at the interval of the
+ * last poll. */
+static void
+timer_update (EyesApplet *eyes_applet)
+{
+    gboolean shown;
 
-                calculate_pupil_xy (eyes_applet, x, y, &pupil_x, &pupil_y,
-                                    eyes_applet->eyes[i]);
-                draw_eye (eyes_applet, i, pupil_x, pupil_y);
+    shown = !eyes_applet->screensaver_active &&
+            eyes_applet->hbox != NULL &&
+            gtk_widget_get_mapped (eyes_applet->vbox);
 
-                eyes_applet->pointer_last_x[i] = x;
-                eyes_applet->pointer_last_y[i] = y;
-            }
+    if (!shown) {
+        if (eyes_applet->timeout_id) {
+            g_source_remove (eyes_applet->timeout_id);
+            eyes_applet->timeout_id = 0;
         }
+        /* the pointer is sure to have moved when the eyes show again */
+        eyes_applet->timeout_interval = UPDATE_TIMEOUT;
+        eyes_applet->pointer_last_move = g_get_monotonic_time ();
+        return;
     }
-    return TRUE;
+
+    if (eyes_applet->timeout_id)
+        return;
+
+    if (eyes_applet->timeout_interval == UPDATE_TIMEOUT)
+        eyes_applet->timeout_id = g_timeout_add (UPDATE_TIMEOUT,
+                                                 (GSourceFunc) timer_cb,
+                                                 eyes_applet);
+    else
+        eyes_applet->timeout_id = g_timeout_add_seconds (IDLE_TIMEOUT,
+                                                         (GSourceFunc) timer_cb,
+                                                         eyes_applet);
+}
+
+/* A pointer coming over the panel is followed at once */
+static gboolean
+enter_notify_cb (GtkWidget        *widget,
+                 GdkEventCrossing *event,
+                 EyesApplet       *eyes_applet)
+{
+    eyes_applet->pointer_last_move = g_get_monotonic_time ();
+
+    if (eyes_applet->timeout_interval != UPDATE_TIMEOUT &&
+        eyes_applet->timeout_id) {
+        g_source_remove (eyes_applet->timeout_id);
+        eyes_applet->timeout_id = 0;
+        eyes_applet->timeout_interval = UPDATE_TIMEOUT;
+        timer_update (eyes_applet);
+    }
+
+    return FALSE;
+}
+
+static void
+screensaver_signal_cb (GDBusProxy  *proxy,
+                       const gchar *sender_name,
+                       const gchar *signal_name,
+                       GVariant    *parameters,
+                       EyesApplet  *eyes_applet)
+{
+    if (g_strcmp0 (signal_name, "ActiveChanged") != 0 ||
+        !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+        return;
+
+    g_variant_get (parameters, "(b)", &eyes_applet->screensaver_active);
+    timer_update (eyes_applet);
+}
+
+static void
+screensaver_ready_cb (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      data)
+{
+    EyesApplet *eyes_applet;
+    GDBusProxy *proxy;
+    GError *error = NULL;
+
+    proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+    if (proxy == NULL) {
+        /* the applet is gone if this was cancelled */
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_debug ("no screensaver to follow: %s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    eyes_applet = data;
+    eyes_applet->screensaver = proxy;
+
+    g_signal_connect (eyes_applet->screensaver, "g-signal",
+                      G_CALLBACK (screensaver_signal_cb), eyes_applet);
 }
 
 static void
@@ -250,11 +431,21 @@ setup_eyes (EyesApplet *eyes_applet)
     eyes_applet->eyes = g_new0 (GtkWidget *, eyes_applet->num_eyes);
     eyes_applet->pointer_last_x = g_new0 (gint, eyes_applet->num_eyes);
     eyes_applet->pointer_last_y = g_new0 (gint, eyes_applet->num_eyes);
+    eyes_applet->pupil_x = g_new0 (gint, eyes_applet->num_eyes);
+    eyes_applet->pupil_y = g_new0 (gint, eyes_applet->num_eyes);
 
     for (i = 0; i < eyes_applet->num_eyes; i++) {
-        if ((eyes_applet->eyes[i] = gtk_image_new ()) == NULL)
+        if ((eyes_applet->eyes[i] = gtk_drawing_area_new ()) == NULL)
             g_error ("Error creating geyes\n");
 
+        /* drawn on the window of the applet, which the pointer is
+         * looked up in */
+        gtk_widget_set_has_window (eyes_applet->eyes[i], FALSE);
+        g_object_set_data (G_OBJECT (eyes_applet->eyes[i]), "eye-num",
+                           GSIZE_TO_POINTER (i));
+        g_signal_connect (eyes_applet->eyes[i], "draw",
+                          G_CALLBACK (eye_draw_cb), eyes_applet);
+
         gtk_widget_set_size_request (GTK_WIDGET (eyes_applet->eyes[i]),
                                      eyes_applet->eye_width,
                                      eyes_applet->eye_height);
@@ -284,6 +475,8 @@ setup_eyes (EyesApplet *eyes_applet)
 
     }
     gtk_widget_show (eyes_applet->hbox);
+
+    timer_update (eyes_applet);
 }
 
 void
@@ -291,10 +484,16 @@ destroy_eyes (EyesApplet *eyes_applet)
 {
     gtk_widget_destroy (eyes_applet->hbox);
     eyes_applet->hbox = NULL;
+    timer_update (eyes_applet);
 
     g_free (eyes_applet->eyes);
     g_free (eyes_applet->pointer_last_x);
     g_free (eyes_applet->pointer_last_y);
+    g_free (eyes_applet->pupil_x);
+    g_free (eyes_applet->pupil_y);
+
+    /* the theme is changing */
+    free_surfaces (eyes_applet);
 }
 
 static EyesApplet*
@@ -317,11 +516,22 @@ destroy_cb (GObject    *object,
 {
     g_return_if_fail (eyes_applet);
 
-    g_source_remove (eyes_applet->timeout_id);
+    if (eyes_applet->timeout_id)
+        g_source_remove (eyes_applet->timeout_id);
+    eyes_applet->timeout_id = 0;
+    g_signal_handlers_disconnect_by_data (eyes_applet->applet, eyes_applet);
+
+    g_cancellable_cancel (eyes_applet->screensaver_cancellable);
+    g_clear_object (&eyes_applet->screensaver_cancellable);
+    if (eyes_applet->screensaver) {
+        g_signal_handlers_disconnect_by_data (eyes_applet->screensaver,
+                                              eyes_applet);
+        g_object_unref (eyes_applet->screensaver);
+        eyes_applet->screensaver = NULL;
+    }
 
     if (eyes_applet->hbox)
         destroy_eyes (eyes_applet);
-    eyes_applet->timeout_id = 0;
 
     if (eyes_applet->eye_image)
         g_object_unref (eyes_applet->eye_image);
@@ -422,9 +632,27 @@ geyes_applet_fill (MatePanelApplet *applet)
 
     eyes_applet = create_eyes (applet);
 
-    eyes_applet->timeout_id = g_timeout_add (UPDATE_TIMEOUT,
-                                             (GSourceFunc) timer_cb,
-                                             eyes_applet);
+    /* the timer runs while the eyes are mapped */
+    eyes_applet->timeout_interval = UPDATE_TIMEOUT;
+    g_signal_connect_swapped (eyes_applet->vbox, "map",
+                              G_CALLBACK (timer_update), eyes_applet);
+    g_signal_connect_swapped (eyes_applet->vbox, "unmap",
+                              G_CALLBACK (timer_update), eyes_applet);
+    gtk_widget_add_events (GTK_WIDGET (eyes_applet->applet), GDK_ENTER_NOTIFY_MASK);
+    g_signal_connect (eyes_applet->applet, "enter-notify-event",
+                      G_CALLBACK (enter_notify_cb), eyes_applet);
+
+    eyes_applet->screensaver_cancellable = g_cancellable_new ();
+    g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                              G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                              G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                              NULL,
+                              "org.mate.ScreenSaver",
+                              "/org/mate/ScreenSaver",
+                              "org.mate.ScreenSaver",
+                              eyes_applet->screensaver_cancellable,
+                              screensaver_ready_cb,
+                              eyes_applet);
 
     action_group = gtk_action_group_new ("Geyes Applet Actions");
     gtk_action_group_set_translation_domain (action_group, GETTEXT_PACKAGE);
@@ -477,9 +705,12 @@ geyes_applet_factory (MatePanelApplet *applet,
     if (!strcmp (iid, "GeyesApplet"))
         retval = geyes_applet_fill (applet);
 
+#ifndef ENABLE_IN_PROCESS
+    /* in-process this would take the whole panel down */
     if (retval == FALSE) {
         exit (-1);
     }
+#endif
 
     return retval;
 }
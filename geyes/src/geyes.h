@@ -29,6 +29,17 @@
 #define GEYES_SETTINGS_SCHEMA "org.mate.panel.applet.geyes"
 #define GEYES_SETTINGS_THEME_PATH_KEY "theme-path"
 
+/* The directions the pupil positions are worked out for, a power of two.
+ * A direction is a pseudo angle of 0 to 4 going round the eye, see
+ * calculate_pupil_xy. */
+#define PUPIL_DIRECTIONS 1024
+
+typedef struct
+{
+    gint x;
+    gint y;
+} EyesPupilPosition;
+
 typedef struct
 {
     GtkWidget *pbox;
@@ -44,12 +55,25 @@ typedef struct
     GtkWidget       *hbox;
     GtkWidget      **eyes;
     guint            timeout_id;
+    guint            timeout_interval;
+    gint64           pointer_last_move;
     gint            *pointer_last_x;
     gint            *pointer_last_y;
+    gint            *pupil_x;
+    gint            *pupil_y;
+
+    /* The locked screen hides the eyes */
+    GDBusProxy      *screensaver;
+    GCancellable    *screensaver_cancellable;
+    gboolean         screensaver_active;
 
     /* Theme */
     GdkPixbuf       *eye_image;
     GdkPixbuf       *pupil_image;
+    /* the images at the scale of the screen, made at the first draw */
+    cairo_surface_t *eye_surface;
+    cairo_surface_t *pupil_surface;
+    gint             surface_scale;
     gchar           *theme_dir;
     gchar           *theme_name;
     gchar           *eye_filename;
@@ -61,6 +85,12 @@ typedef struct
     gint             pupil_width;
     gint             wall_thickness;
 
+    /* Where the pupil sits against the wall in each direction, and the
+     * squared distance from the middle within which it follows the
+     * pointer instead */
+    EyesPupilPosition pupil_positions[PUPIL_DIRECTIONS];
+    gfloat            pupil_free_distance2;
+
     /* Properties */
     EyesPropertyBox  prop_box;
 
@@ -71,6 +101,12 @@ typedef struct
 /* eyes.c */
 void   setup_eyes         (EyesApplet  *eyes_applet);
 void   destroy_eyes       (EyesApplet  *eyes_applet);
+/* Turns the eye towards the pointer at x, y in the coordinates of the
+ * eye, and returns whether the pointer moved since it last looked */
+gboolean eyes_look_at     (EyesApplet  *eyes_applet,
+                           gsize        eye_num,
+                           gint         x,
+                           gint         y);
 
 /* theme.c */
 void    theme_dirs_create (void);
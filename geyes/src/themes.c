@@ -17,6 +17,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <ctype.h>
 #include <gtk/gtk.h>
@@ -96,6 +97,65 @@ parse_theme_file (EyesApplet *eyes_applet,
     }
 }
 
+/* Works out where the pupil meets the wall of the eye, for each of the
+ * directions calculate_pupil_xy looks up. */
+static void
+build_pupil_positions (EyesApplet *eyes_applet)
+{
+    float eye_width_half = (float) eyes_applet->eye_width * 0.5f;
+    float eye_height_half = (float) eyes_applet->eye_height * 0.5f;
+    float free_distance;
+    gsize i;
+
+    for (i = 0; i < PUPIL_DIRECTIONS; i++) {
+        float d, t, nx, ny, h;
+        float sina, cosa, temp;
+
+        /* the middle of the range of pseudo angles of the entry, back to
+         * a point on the diamond |nx| + |ny| = 1 */
+        d = ((float) i + 0.5f) * 4.0f / PUPIL_DIRECTIONS;
+        t = d - floorf (d);
+        switch ((int) d) {
+            case 0:
+                nx = 1.0f - t;
+                ny = t;
+                break;
+            case 1:
+                nx = -t;
+                ny = 1.0f - t;
+                break;
+            case 2:
+                nx = t - 1.0f;
+                ny = -t;
+                break;
+            default:
+                nx = t;
+                ny = t - 1.0f;
+                break;
+        }
+
+        h = hypotf (nx, ny);
+        sina = nx / h;
+        cosa = ny / h;
+
+        temp  = hypotf ((float) eyes_applet->eye_width * sina,
+                        (float) eyes_applet->eye_height * cosa);
+        temp -= hypotf ((float) eyes_applet->pupil_width * sina,
+                        (float) eyes_applet->pupil_height * cosa);
+        temp -= (float) eyes_applet->wall_thickness;
+        temp *= 0.5f;
+
+        eyes_applet->pupil_positions[i].x = (gint) (temp * sina + eye_width_half);
+        eyes_applet->pupil_positions[i].y = (gint) (temp * cosa + eye_height_half);
+    }
+
+    free_distance = fabsf (hypotf (eye_height_half, eye_width_half)
+                           - (float) eyes_applet->wall_thickness
+                           - (float) eyes_applet->pupil_height);
+    free_distance = MAX (free_distance, 0.5f);
+    eyes_applet->pupil_free_distance2 = free_distance * free_distance;
+}
+
 int
 load_theme (EyesApplet  *eyes_applet,
             const gchar *theme_dir)
@@ -155,6 +215,8 @@ load_theme (EyesApplet  *eyes_applet,
     eyes_applet->pupil_height = gdk_pixbuf_get_height (eyes_applet->pupil_image);
     eyes_applet->pupil_width = gdk_pixbuf_get_width (eyes_applet->pupil_image);
 
+    build_pupil_positions (eyes_applet);
+
     return TRUE;
 }
 
@@ -21,21 +21,32 @@
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
-#include <json-glib/json-glib.h>
+#include <string.h>
 #include <libsoup/soup.h>
 #include <cairo/cairo.h>
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
+#include "common/applet-probe.h"
 #include "invest-applet-chart.h"
+#include "invest-cache.h"
+
+/* a chart of a closed market is asked for again only this often */
+#define CLOSED_MARKET_TTL (60 * 60)
 
 typedef struct _StockChartData StockChartData;
 
 struct _StockChartData {
     gchar *symbol;
+    gchar *key; /* of the chart in the cache and in flight */
     gdouble *prices;
     gint64 *timestamps;
     gint data_count;
     gboolean valid;
+    /* found once when the data arrives, for scaling the chart */
+    gdouble min_price;
+    gdouble max_price;
+    gint64 min_time;
+    gint64 max_time;
 };
 
 struct _InvestChart {
@@ -46,18 +57,47 @@ struct _InvestChart {
     gint chart_data_count;
     gchar *chart_range;
     gchar *chart_interval;
+    guint generation; /* responses of an older fetch are dropped */
+    GHashTable *in_flight; /* cache key -> ChartRequest */
+    cairo_surface_t *surface; /* the chart as drawn last */
+    gint surface_width;
+    gint surface_height;
 };
 
+typedef struct {
+    InvestChart *chart;
+    guint generation;
+    gint index;
+    gchar *cache_key;
+    InvestCacheEntry *cached;
+    SoupMessage *msg;
+} ChartRequest;
+
 static void fetch_chart_data (InvestChart *chart);
 static void on_chart_data_received (SoupSession *session, SoupMessage *msg, gpointer user_data);
+static void chart_request_free (ChartRequest *request);
+static void cancel_chart_requests (InvestChart *chart);
 static gboolean chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart);
 static gboolean chart_window_key_press (GtkWidget *widget, GdkEventKey *event, InvestChart *chart);
 static void chart_range_button_clicked (GtkWidget *widget, InvestChart *chart);
 static void create_chart_toolbar (InvestChart *chart, GtkWidget *parent);
 static void free_chart_data (InvestChart *chart);
+static gboolean parse_chart_data (StockChartData *data, const gchar *body, gsize length);
+static gboolean chart_data_find_range (StockChartData *data);
 static void draw_loading_message (cairo_t *cr, gint width, gint height, const gchar *message);
 static void on_chart_window_destroy (GtkWidget *widget, InvestChart *chart);
 
+/* Drops the chart as drawn, after its data changed */
+static void
+invalidate_chart (InvestChart *chart)
+{
+    g_clear_pointer (&chart->surface, cairo_surface_destroy);
+
+    if (chart->window && gtk_widget_get_visible (chart->window)) {
+        gtk_widget_queue_draw (chart->window);
+    }
+}
+
 InvestChart*
 invest_chart_new (InvestApplet *applet)
 {
@@ -67,6 +107,7 @@ invest_chart_new (InvestApplet *applet)
     chart->chart_data_count = 0;
     chart->chart_range = g_strdup ("1d");
     chart->chart_interval = g_strdup ("1m");
+    chart->in_flight = g_hash_table_new (g_str_hash, g_str_equal);
     return chart;
 }
 
@@ -81,7 +122,10 @@ invest_chart_free (InvestChart *chart)
         invest_chart_hide (chart);
     }
 
+    cancel_chart_requests (chart);
+    g_hash_table_destroy (chart->in_flight);
     free_chart_data (chart);
+    g_clear_pointer (&chart->surface, cairo_surface_destroy);
     g_free (chart->chart_range);
     g_free (chart->chart_interval);
     g_free (chart);
@@ -92,6 +136,7 @@ on_chart_window_destroy (GtkWidget *widget, InvestChart *chart)
 {
     chart->window = NULL;
     chart->drawing_area = NULL;
+    g_clear_pointer (&chart->surface, cairo_surface_destroy);
 }
 
 void
@@ -176,6 +221,14 @@ invest_chart_refresh_data (InvestChart *chart)
 static void
 fetch_chart_data (InvestChart *chart)
 {
+    const gchar *range = chart->chart_range ? chart->chart_range : "1d";
+    const gchar *interval = chart->chart_interval ? chart->chart_interval : "1m";
+    SoupSession *session = chart->applet->soup_session;
+    StockChartData *old_data;
+    gint old_count;
+    GHashTable *in_flight;
+    GHashTableIter iter;
+    ChartRequest *request;
     gchar **symbols;
     gint symbol_count;
 
@@ -192,184 +245,637 @@ fetch_chart_data (InvestChart *chart)
 
     symbol_count = g_strv_length (symbols);
 
-    /* Free existing chart data */
-    free_chart_data (chart);
+    /* Keep the existing chart data until it is replaced */
+    old_data = chart->chart_data;
+    old_count = chart->chart_data_count;
 
     /* Allocate chart data array */
     chart->chart_data = g_malloc0 (symbol_count * sizeof (StockChartData));
     chart->chart_data_count = symbol_count;
 
-    /* Initialize chart data for each stock symbol */
-    for (gint i = 0; i < symbol_count; i++) {
-        chart->chart_data[i].symbol = g_strdup (symbols[i]);
-        chart->chart_data[i].valid = FALSE;
-        chart->chart_data[i].prices = NULL;
-        chart->chart_data[i].timestamps = NULL;
-        chart->chart_data[i].data_count = 0;
-    }
+    chart->generation++;
 
-    /* This will show loading state */
-    if (chart->window && gtk_widget_get_visible (chart->window)) {
-        gtk_widget_queue_draw (chart->window);
-    }
+    /* the requests of this fetch, the ones left in_flight are stale */
+    in_flight = chart->in_flight;
+    chart->in_flight = g_hash_table_new (g_str_hash, g_str_equal);
 
-    /* Fetch chart the actual stock data */
     for (gint i = 0; i < symbol_count; i++) {
-        const gchar *range = chart->chart_range ? chart->chart_range : "1d";
-        const gchar *interval = chart->chart_interval ? chart->chart_interval : "1m";
-        gchar *url = g_strdup_printf ("https://query2.finance.yahoo.com/v8/finance/chart/%s?interval=%s&range=%s", symbols[i], interval, range);
-        SoupMessage *msg = soup_message_new ("GET", url);
+        StockChartData *data = &chart->chart_data[i];
+
+        data->symbol = g_strdup (symbols[i]);
+        data->key = g_strdup_printf ("chart/%s/%s/%s", symbols[i], range, interval);
+
+        /* a chart of the same symbol and range is shown until the new
+         * one is there */
+        for (gint j = 0; j < old_count; j++) {
+            if (old_data[j].key && g_strcmp0 (old_data[j].key, data->key) == 0) {
+                g_free (data->symbol);
+                g_free (data->key);
+                *data = old_data[j];
+                old_data[j].symbol = NULL;
+                old_data[j].key = NULL;
+                old_data[j].prices = NULL;
+                old_data[j].timestamps = NULL;
+                break;
+            }
+        }
+
+        /* a request for it that is still going is not made again */
+        request = g_hash_table_lookup (in_flight, data->key);
+        if (request && !g_hash_table_contains (chart->in_flight, data->key)) {
+            g_hash_table_steal (in_flight, data->key);
+            request->generation = chart->generation;
+            request->index = i;
+            g_hash_table_insert (chart->in_flight, request->cache_key, request);
+            continue;
+        }
+
+        /* the same symbol twice */
+        if (g_hash_table_contains (chart->in_flight, data->key)) {
+            continue;
+        }
+
+        request = g_new0 (ChartRequest, 1);
+        request->chart = chart;
+        request->generation = chart->generation;
+        request->index = i;
+        request->cache_key = g_strdup (data->key);
+        request->cached = invest_cache_lookup (request->cache_key);
+
+        /* the last known chart is shown at once */
+        if (request->cached && !data->valid) {
+            gsize length;
+            const gchar *body = g_bytes_get_data (request->cached->body, &length);
+
+            parse_chart_data (data, body, length);
+        }
+
+        if (invest_cache_entry_is_fresh (request->cached)) {
+            chart_request_free (request);
+            continue;
+        }
+
+        gchar *symbol = g_uri_escape_string (symbols[i], NULL, FALSE);
+        gchar *url = g_strdup_printf ("https://query2.finance.yahoo.com/v8/finance/chart/%s?interval=%s&range=%s", symbol, interval, range);
+
+        request->msg = soup_message_new ("GET", url);
 
         /* HACK: avoid rate limiting */
-        soup_message_headers_replace (msg->request_headers, "User-Agent",
+        soup_message_headers_replace (request->msg->request_headers, "User-Agent",
                                       "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
-
-        gpointer *user_data_with_index = g_malloc (2 * sizeof (gpointer));
-        user_data_with_index[0] = chart;
-        user_data_with_index[1] = GINT_TO_POINTER (i);
+        invest_cache_add_validators (request->cached, request->msg);
 
         /* Queue the actual request to the Yahoo Finance API */
-        soup_session_queue_message (chart->applet->soup_session, msg, on_chart_data_received, user_data_with_index);
+        g_hash_table_insert (chart->in_flight, request->cache_key, request);
+        soup_session_queue_message (session, request->msg, on_chart_data_received, request);
         g_free (url);
+        g_free (symbol);
     }
 
+    /* the charts of a range that was left, or of symbols that are gone */
+    g_hash_table_iter_init (&iter, in_flight);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request)) {
+        g_hash_table_iter_steal (&iter);
+        soup_session_cancel_message (session, request->msg, SOUP_STATUS_CANCELLED);
+    }
+    g_hash_table_destroy (in_flight);
+
+    for (gint j = 0; j < old_count; j++) {
+        g_free (old_data[j].symbol);
+        g_free (old_data[j].key);
+        g_free (old_data[j].prices);
+        g_free (old_data[j].timestamps);
+    }
+    g_free (old_data);
+
+    /* This will show loading state, or what was found */
+    invalidate_chart (chart);
+
     g_strfreev (symbols);
 }
 
+/* How long a chart stays current: about one interval of its points, or
+ * an hour when the last point is old and so the market is closed. */
+static gint64
+chart_fresh_until (InvestChart *chart, StockChartData *data)
+{
+    const gchar *range = chart->chart_range ? chart->chart_range : "1d";
+    gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+    gint64 ttl;
+
+    if (g_strcmp0 (range, "1d") == 0) {
+        ttl = 60;
+    } else if (g_strcmp0 (range, "5d") == 0) {
+        ttl = 5 * 60;
+    } else if (g_strcmp0 (range, "1mo") == 0) {
+        ttl = 30 * 60;
+    } else {
+        ttl = 6 * 60 * 60;
+    }
+
+    if (ttl < CLOSED_MARKET_TTL && data->valid && data->data_count > 0 &&
+        now - data->timestamps[data->data_count - 1] > CLOSED_MARKET_TTL / 2) {
+        ttl = CLOSED_MARKET_TTL;
+    }
+
+    return now + ttl;
+}
+
+static void
+chart_request_free (ChartRequest *request)
+{
+    invest_cache_entry_free (request->cached);
+    g_free (request->cache_key);
+    g_free (request);
+}
+
+/* Cancels the requests in flight, which are dropped by their callback
+ * without looking at the chart */
+static void
+cancel_chart_requests (InvestChart *chart)
+{
+    GHashTableIter iter;
+    ChartRequest *request;
+
+    g_hash_table_iter_init (&iter, chart->in_flight);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request)) {
+        g_hash_table_iter_steal (&iter);
+        soup_session_cancel_message (chart->applet->soup_session, request->msg, SOUP_STATUS_CANCELLED);
+    }
+}
+
 static void
 on_chart_data_received (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
-    gpointer *user_data_with_index = (gpointer *)user_data;
-    InvestChart *chart = (InvestChart *)user_data_with_index[0];
-    gint symbol_index = GPOINTER_TO_INT (user_data_with_index[1]);
+    ChartRequest *request = user_data;
+    InvestChart *chart = request->chart;
+    gint symbol_index = request->index;
+    StockChartData *data;
+
+    /* the request is stale, or the chart is going */
+    if (msg->status_code == SOUP_STATUS_CANCELLED) {
+        chart_request_free (request);
+        return;
+    }
+
+    g_hash_table_remove (chart->in_flight, request->cache_key);
 
-    JsonParser *parser = NULL;
-    JsonNode *root;
-    JsonObject *root_obj;
-    GError *error = NULL;
+    /* a newer fetch replaced the chart data */
+    if (request->generation != chart->generation) {
+        chart_request_free (request);
+        return;
+    }
 
-    if (msg->status_code != SOUP_STATUS_OK) {
+    data = &chart->chart_data[symbol_index];
+
+    if (msg->status_code == SOUP_STATUS_NOT_MODIFIED && request->cached) {
+        /* what is shown already is current */
+        invest_cache_revalidated (request->cache_key, request->cached,
+                                  chart_fresh_until (chart, data));
+    } else if (msg->status_code != SOUP_STATUS_OK) {
         g_warning ("Failed to fetch chart data for symbol %d: %s", symbol_index, msg->reason_phrase);
-        goto cleanup;
-    }
-
-    parser = json_parser_new ();
-    if (!json_parser_load_from_data (parser, msg->response_body->data,
-                                     msg->response_body->length, &error)) {
-        g_warning ("Failed to parse chart JSON for symbol %d: %s", symbol_index, error->message);
-        g_error_free (error);
-        goto cleanup;
-    }
-
-    root = json_parser_get_root (parser);
-    root_obj = json_node_get_object (root);
-
-    /* This was... fun. The structure for the chart data looks like this:
-     *
-     * {
-     *   "chart": {
-     *     "result": [
-     *       {
-     *         "timestamp": [ ... ],
-     *         "indicators": {
-     *           "quote": [{
-     *             "close": [ ... ]
-     *           }]
-     *         }
-     *       }
-     *     ]
-     *   }
-     * }
-     *
-     * The closing prices for each stock map to the same index of
-     * the corresponding timestamps, so we need to parse them all
-     * separately but store them together for display later.
-     */
-    if (json_object_has_member (root_obj, "chart")) {
-        JsonObject *chart_obj = json_object_get_object_member (root_obj, "chart");
-        if (json_object_has_member (chart_obj, "result") && !json_object_get_null_member (chart_obj, "result")) {
-            JsonArray *results = json_object_get_array_member (chart_obj, "result");
-            if (results && json_array_get_length (results) > 0) {
-                JsonObject *result = json_array_get_object_element (results, 0);
-                if (result) {
-                    /* Parse timestamps */
-                    if (json_object_has_member (result, "timestamp")) {
-                        JsonArray *timestamps = json_object_get_array_member (result, "timestamp");
-                        if (timestamps) {
-                            gint timestamp_count = json_array_get_length (timestamps);
-                            /* Allocate memory for all the timestamps */
-                            chart->chart_data[symbol_index].timestamps = g_malloc0 (timestamp_count * sizeof (gint64));
-                            chart->chart_data[symbol_index].data_count = timestamp_count;
-
-                            /* Then store them */
-                            for (gint i = 0; i < timestamp_count; i++) {
-                                JsonNode *timestamp_node = json_array_get_element (timestamps, i);
-                                if (json_node_get_value_type (timestamp_node) == G_TYPE_INT64) {
-                                    chart->chart_data[symbol_index].timestamps[i] = json_node_get_int (timestamp_node);
-                                }
-                            }
-                        }
-                    }
-
-                    /* Parse price data */
-                    if (json_object_has_member (result, "indicators")) {
-                        JsonObject *indicators = json_object_get_object_member (result, "indicators");
-                        if (json_object_has_member (indicators, "quote")) {
-                            JsonArray *quotes = json_object_get_array_member (indicators, "quote");
-                            if (quotes && json_array_get_length (quotes) > 0) {
-                                /* For some reason quote is an array, but there's only one quote for each stock symbol */
-                                JsonObject *quote = json_array_get_object_element (quotes, 0);
-                                if (quote && json_object_has_member (quote, "close")) {
-                                    JsonArray *close_prices = json_object_get_array_member (quote, "close");
-                                    if (close_prices) {
-                                        gint price_count = json_array_get_length (close_prices);
-                                        /* Allocate memory for all the closing prices */
-                                        chart->chart_data[symbol_index].prices = g_malloc0 (price_count * sizeof (gdouble));
-
-                                        /* Then store them */
-                                        for (gint i = 0; i < price_count; i++) {
-                                            JsonNode *price_node = json_array_get_element (close_prices, i);
-                                            if (json_node_get_value_type (price_node) == G_TYPE_DOUBLE) {
-                                                chart->chart_data[symbol_index].prices[i] = json_node_get_double (price_node);
-                                            }
-                                        }
-                                        /* We assume that the existence of data constitutes valid data */
-                                        chart->chart_data[symbol_index].valid = TRUE;
-                                    }
-                                }
-                            }
-                        }
-                    }
+    } else {
+        /* drop what the cache had */
+        g_free (data->prices);
+        g_free (data->timestamps);
+        data->prices = NULL;
+        data->timestamps = NULL;
+        data->data_count = 0;
+        data->valid = FALSE;
+
+        if (parse_chart_data (data, msg->response_body->data, msg->response_body->length)) {
+            invest_cache_store (request->cache_key, msg, chart_fresh_until (chart, data));
+        } else {
+            g_warning ("Failed to parse chart data for symbol %d", symbol_index);
+        }
+    }
+
+    /* Redraw chart if window is still visible */
+    invalidate_chart (chart);
+
+    chart_request_free (request);
+}
+
+/* The chart responses are scanned in place rather than loaded into a
+ * JsonParser tree: only the "timestamp" and "close" arrays are wanted,
+ * and they are read straight into buffers sized by a first pass over
+ * each array. */
+typedef struct {
+    const gchar *p;
+    const gchar *end;
+} ChartScanner;
+
+typedef gboolean (*ChartMemberFunc) (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data);
+
+static void
+scanner_skip_space (ChartScanner *scanner)
+{
+    while (scanner->p < scanner->end && g_ascii_isspace (*scanner->p)) {
+        scanner->p++;
+    }
+}
+
+static gboolean
+scanner_expect (ChartScanner *scanner, gchar c)
+{
+    scanner_skip_space (scanner);
+    if (scanner->p >= scanner->end || *scanner->p != c) {
+        return FALSE;
+    }
+    scanner->p++;
+    return TRUE;
+}
+
+static gboolean
+scanner_peek (ChartScanner *scanner, gchar c)
+{
+    scanner_skip_space (scanner);
+    return scanner->p < scanner->end && *scanner->p == c;
+}
+
+/* the raw string, escapes and all, the keys looked for have none */
+static gboolean
+scanner_string (ChartScanner *scanner, const gchar **start, gsize *length)
+{
+    if (!scanner_expect (scanner, '"')) {
+        return FALSE;
+    }
+
+    *start = scanner->p;
+    while (scanner->p < scanner->end && *scanner->p != '"') {
+        if (*scanner->p == '\\') {
+            scanner->p++;
+        }
+        scanner->p++;
+    }
+
+    if (scanner->p >= scanner->end) {
+        return FALSE;
+    }
+
+    *length = scanner->p - *start;
+    scanner->p++;
+    return TRUE;
+}
+
+static gboolean
+scanner_skip_value (ChartScanner *scanner)
+{
+    const gchar *start;
+    gsize length;
+    gint depth = 0;
+
+    scanner_skip_space (scanner);
+    if (scanner->p >= scanner->end) {
+        return FALSE;
+    }
+
+    if (*scanner->p == '"') {
+        return scanner_string (scanner, &start, &length);
+    }
+
+    if (*scanner->p != '{' && *scanner->p != '[') {
+        /* a number, true, false or null */
+        while (scanner->p < scanner->end && !strchr (",]} \t\r\n", *scanner->p)) {
+            scanner->p++;
+        }
+        return TRUE;
+    }
+
+    /* containers are only matched up, strings can hold brackets */
+    while (scanner->p < scanner->end) {
+        switch (*scanner->p) {
+            case '"':
+                if (!scanner_string (scanner, &start, &length)) {
+                    return FALSE;
                 }
+                continue;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    scanner->p++;
+                    return TRUE;
+                }
+                break;
+        }
+        scanner->p++;
+    }
+
+    return FALSE;
+}
+
+/* Calls func for every member of an object, func consumes the value of
+ * the members it wants and returns FALSE to skip it. */
+static gboolean
+scanner_object (ChartScanner *scanner, ChartMemberFunc func, gpointer user_data)
+{
+    if (!scanner_expect (scanner, '{')) {
+        return FALSE;
+    }
+    if (scanner_expect (scanner, '}')) {
+        return TRUE;
+    }
+
+    do {
+        const gchar *key;
+        gsize key_length;
+        const gchar *value;
+
+        if (!scanner_string (scanner, &key, &key_length) ||
+            !scanner_expect (scanner, ':')) {
+            return FALSE;
+        }
+
+        scanner_skip_space (scanner);
+        value = scanner->p;
+
+        /* a member func took but could not read is broken */
+        if (!func (scanner, key, key_length, user_data) &&
+            (scanner->p != value || !scanner_skip_value (scanner))) {
+            return FALSE;
+        }
+    } while (scanner_expect (scanner, ','));
+
+    return scanner_expect (scanner, '}');
+}
+
+/* Scans the first element of an array as an object, skipping the rest */
+static gboolean
+scanner_first_object (ChartScanner *scanner, ChartMemberFunc func, gpointer user_data)
+{
+    if (!scanner_expect (scanner, '[')) {
+        return FALSE;
+    }
+    if (scanner_expect (scanner, ']')) {
+        return TRUE;
+    }
+
+    if (!scanner_object (scanner, func, user_data)) {
+        return FALSE;
+    }
+
+    while (scanner_expect (scanner, ',')) {
+        if (!scanner_skip_value (scanner)) {
+            return FALSE;
+        }
+    }
+
+    return scanner_expect (scanner, ']');
+}
+
+/* Reads an array of numbers, where a null counts as 0 */
+static gboolean
+scanner_numbers (ChartScanner *scanner, gdouble **doubles, gint64 **integers, gint *count)
+{
+    const gchar *p;
+    gint n = 1;
+
+    if (!scanner_expect (scanner, '[')) {
+        return FALSE;
+    }
+
+    /* first count the elements, for one allocation of the right size */
+    for (p = scanner->p; p < scanner->end && *p != ']'; p++) {
+        if (*p == ',') {
+            n++;
+        } else if (*p == '[' || *p == '{' || *p == '"') {
+            return FALSE;
+        }
+    }
+    if (p >= scanner->end) {
+        return FALSE;
+    }
+
+    if (scanner_peek (scanner, ']')) {
+        n = 0;
+    }
+
+    if (doubles) {
+        *doubles = g_new0 (gdouble, MAX (n, 1));
+    } else {
+        *integers = g_new0 (gint64, MAX (n, 1));
+    }
+    *count = n;
+
+    for (gint i = 0; i < n; i++) {
+        gchar *number_end;
+
+        scanner_skip_space (scanner);
+        if (doubles) {
+            gdouble value = g_ascii_strtod (scanner->p, &number_end);
+            if (number_end != scanner->p) {
+                (*doubles)[i] = value;
+            }
+        } else {
+            gint64 value = g_ascii_strtoll (scanner->p, &number_end, 10);
+            if (number_end != scanner->p) {
+                (*integers)[i] = value;
             }
         }
+
+        scanner->p = number_end;
+        if (!scanner_skip_value (scanner) ||
+            !scanner_expect (scanner, i < n - 1 ? ',' : ']')) {
+            return FALSE;
+        }
     }
 
-cleanup:
-    if (parser) {
-        g_object_unref (parser);
+    return n > 0 || scanner_expect (scanner, ']');
+}
+
+typedef struct {
+    gint64 *timestamps;
+    gint timestamp_count;
+    gdouble *prices;
+    gint price_count;
+} ChartArrays;
+
+#define KEY_IS(name) (key_length == strlen (name) && strncmp (key, name, key_length) == 0)
+
+static gboolean
+scan_quote_member (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data)
+{
+    ChartArrays *arrays = user_data;
+
+    if (KEY_IS ("close") && !arrays->prices && scanner_peek (scanner, '[')) {
+        return scanner_numbers (scanner, &arrays->prices, NULL, &arrays->price_count);
     }
+    return FALSE;
+}
 
-    /* Redraw chart if window is still visible */
-    if (chart->window && gtk_widget_get_visible (chart->window)) {
-        gtk_widget_queue_draw (chart->window);
+static gboolean
+scan_indicators_member (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data)
+{
+    /* there's only one quote for each stock symbol */
+    if (KEY_IS ("quote") && scanner_peek (scanner, '[')) {
+        return scanner_first_object (scanner, scan_quote_member, user_data);
     }
+    return FALSE;
+}
+
+static gboolean
+scan_result_member (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data)
+{
+    ChartArrays *arrays = user_data;
 
-    g_free (user_data_with_index);
+    if (KEY_IS ("timestamp") && !arrays->timestamps && scanner_peek (scanner, '[')) {
+        return scanner_numbers (scanner, NULL, &arrays->timestamps, &arrays->timestamp_count);
+    }
+    if (KEY_IS ("indicators") && scanner_peek (scanner, '{')) {
+        return scanner_object (scanner, scan_indicators_member, user_data);
+    }
+    return FALSE;
 }
 
 static gboolean
-chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart)
+scan_chart_member (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data)
 {
-    gint width, height;
-    GtkAllocation allocation;
-    gtk_widget_get_size_request (widget, &width, &height);
-    if (width <= 0 || height <= 0) {
-        gtk_widget_get_allocated_size (widget, &allocation, NULL);
-        width = allocation.width;
-        height = allocation.height;
+    if (KEY_IS ("result") && scanner_peek (scanner, '[')) {
+        return scanner_first_object (scanner, scan_result_member, user_data);
+    }
+    return FALSE;
+}
+
+static gboolean
+scan_root_member (ChartScanner *scanner, const gchar *key, gsize key_length, gpointer user_data)
+{
+    if (KEY_IS ("chart") && scanner_peek (scanner, '{')) {
+        return scanner_object (scanner, scan_chart_member, user_data);
+    }
+    return FALSE;
+}
+
+#undef KEY_IS
+
+/* Fills data with the timestamps and closing prices of a chart response.
+ * The structure for the chart data looks like this:
+ *
+ * {
+ *   "chart": {
+ *     "result": [
+ *       {
+ *         "timestamp": [ ... ],
+ *         "indicators": {
+ *           "quote": [{
+ *             "close": [ ... ]
+ *           }]
+ *         }
+ *       }
+ *     ]
+ *   }
+ * }
+ *
+ * The closing prices for each stock map to the same index of the
+ * corresponding timestamps.
+ */
+static gboolean
+parse_chart_data (StockChartData *data, const gchar *body, gsize length)
+{
+    ChartScanner scanner = { body, body + length };
+    ChartArrays arrays = { NULL, 0, NULL, 0 };
+
+    if (!scanner_object (&scanner, scan_root_member, &arrays) ||
+        !arrays.timestamps || !arrays.prices) {
+        g_free (arrays.timestamps);
+        g_free (arrays.prices);
+        return FALSE;
+    }
+
+    data->timestamps = arrays.timestamps;
+    data->prices = arrays.prices;
+    data->data_count = MIN (arrays.timestamp_count, arrays.price_count);
+
+    return chart_data_find_range (data);
+}
+
+/* Finds the ranges of the chart once, when its data arrives */
+static gboolean
+chart_data_find_range (StockChartData *data)
+{
+    data->valid = data->data_count > 0;
+
+    data->min_price = G_MAXDOUBLE;
+    data->max_price = G_MINDOUBLE;
+    data->min_time = G_MAXINT64;
+    data->max_time = G_MININT64;
+
+    for (gint i = 0; i < data->data_count; i++) {
+        if (data->prices[i] > 0) {
+            data->min_price = MIN (data->min_price, data->prices[i]);
+            data->max_price = MAX (data->max_price, data->prices[i]);
+        }
+    }
+
+    if (data->valid &&
+        data->timestamps[0] > 0 &&
+        data->timestamps[data->data_count - 1] > 0 &&
+        data->timestamps[0] < 9999999999) { /* HACK: This works, but there's probably a better way */
+        data->min_time = data->timestamps[0];
+        data->max_time = data->timestamps[data->data_count - 1];
+    }
+
+    return data->valid;
+}
+
+/* Draws the series of one stock, with at most a first, lowest, highest
+ * and last point for every pixel column, which look the same as all the
+ * points at a fraction of the strokes */
+static void
+draw_series (cairo_t *cr, StockChartData *data, gint width, gdouble max_price, gdouble y_scale)
+{
+    gboolean first_point = TRUE;
+    gint column = G_MININT;
+    gdouble column_min = 0, column_max = 0, column_last = 0;
+    gdouble column_x = 0;
+
+    for (gint j = 0; j < data->data_count; j++) {
+        if (data->prices[j] > 0 &&
+            data->timestamps[j] > 0 &&
+            data->timestamps[j] < 9999999999) { /* Just to be safe... */
+            gdouble x = 50 + (gdouble)j * (width - 100) / MAX (data->data_count - 1, 1);
+            gdouble price = data->prices[j];
+
+            if ((gint) x != column) {
+                /* close the previous column */
+                if (!first_point) {
+                    cairo_line_to (cr, column_x, 50 + (max_price - column_min) * y_scale);
+                    cairo_line_to (cr, column_x, 50 + (max_price - column_max) * y_scale);
+                    cairo_line_to (cr, column_x, 50 + (max_price - column_last) * y_scale);
+                }
+
+                if (first_point) {
+                    cairo_move_to (cr, x, 50 + (max_price - price) * y_scale);
+                    first_point = FALSE;
+                } else {
+                    cairo_line_to (cr, x, 50 + (max_price - price) * y_scale);
+                }
+
+                column = (gint) x;
+                column_x = x;
+                column_min = column_max = price;
+            } else {
+                column_min = MIN (column_min, price);
+                column_max = MAX (column_max, price);
+            }
+            column_last = price;
+        }
+    }
+
+    if (!first_point) {
+        cairo_line_to (cr, column_x, 50 + (max_price - column_min) * y_scale);
+        cairo_line_to (cr, column_x, 50 + (max_price - column_max) * y_scale);
+        cairo_line_to (cr, column_x, 50 + (max_price - column_last) * y_scale);
     }
+    cairo_stroke (cr);
+}
 
+static void
+render_chart (InvestChart *chart, cairo_t *cr, gint width, gint height)
+{
     /* Clear background */
     cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
     cairo_paint (cr);
@@ -387,35 +893,30 @@ chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart)
 
     if (!has_valid_data) {
         draw_loading_message (cr, width, height, _("Loading chart data..."));
-        return FALSE;
+        return;
     }
 
-    /* Find min/max prices for scaling the chart properly */
+    /* Find min/max prices for scaling the chart properly, from the
+     * ranges found when the data arrived */
     gdouble min_price = G_MAXDOUBLE;
     gdouble max_price = G_MINDOUBLE;
     gint64 min_time = G_MAXINT64;
     gint64 max_time = G_MININT64;
 
     for (gint i = 0; i < chart->chart_data_count; i++) {
-        if (chart->chart_data[i].valid && chart->chart_data[i].data_count > 0) {
-            for (gint j = 0; j < chart->chart_data[i].data_count; j++) {
-                if (chart->chart_data[i].prices[j] > 0) {
-                    min_price = MIN (min_price, chart->chart_data[i].prices[j]);
-                    max_price = MAX (max_price, chart->chart_data[i].prices[j]);
-                }
-            }
-            if (chart->chart_data[i].timestamps[0] > 0 &&
-                chart->chart_data[i].timestamps[chart->chart_data[i].data_count - 1] > 0 &&
-                chart->chart_data[i].timestamps[0] < 9999999999) { /* HACK: This works, but there's probably a better way */
-                min_time = MIN (min_time, chart->chart_data[i].timestamps[0]);
-                max_time = MAX (max_time, chart->chart_data[i].timestamps[chart->chart_data[i].data_count - 1]);
-            }
+        StockChartData *data = &chart->chart_data[i];
+
+        if (data->valid && data->data_count > 0) {
+            min_price = MIN (min_price, data->min_price);
+            max_price = MAX (max_price, data->max_price);
+            min_time = MIN (min_time, data->min_time);
+            max_time = MAX (max_time, data->max_time);
         }
     }
 
     if (min_price == G_MAXDOUBLE || max_price == G_MINDOUBLE || min_time == G_MAXINT64 || max_time == G_MININT64) {
         draw_loading_message (cr, width, height, _("No chart data available"));
-        return FALSE;
+        return;
     }
 
     /* Add some padding to price range */
@@ -544,25 +1045,7 @@ chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart)
         cairo_set_line_width (cr, 2.0);
 
         /* Draw price line */
-        gboolean first_point = TRUE;
-
-        for (gint j = 0; j < chart->chart_data[stock_index].data_count; j++) {
-            if (chart->chart_data[stock_index].prices[j] > 0 &&
-                chart->chart_data[stock_index].timestamps[j] > 0 &&
-                chart->chart_data[stock_index].timestamps[j] < 9999999999) { /* Just to be safe... */
-
-                gdouble x = 50 + (gdouble)j * (width - 100) / (chart->chart_data[stock_index].data_count - 1);
-                gdouble y = 50 + (max_price - chart->chart_data[stock_index].prices[j]) * y_scale;
-
-                if (first_point) {
-                    cairo_move_to (cr, x, y);
-                    first_point = FALSE;
-                } else {
-                    cairo_line_to (cr, x, y);
-                }
-            }
-        }
-        cairo_stroke (cr);
+        draw_series (cr, &chart->chart_data[stock_index], width, max_price, y_scale);
 
         /* Draw legend with current price */
         gdouble current_price = chart->chart_data[stock_index].prices[chart->chart_data[stock_index].data_count - 1];
@@ -573,7 +1056,47 @@ chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart)
     }
 
     g_free (sort_info);
+}
 
+/* The chart only changes with its data and its size, so it is drawn
+ * into a surface that the expose events just paint */
+static gboolean
+chart_draw_cb (GtkWidget *widget, cairo_t *cr, InvestChart *chart)
+{
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "invest:chart_draw_cb");
+    gint width, height;
+    GtkAllocation allocation;
+    gtk_widget_get_size_request (widget, &width, &height);
+    if (width <= 0 || height <= 0) {
+        gtk_widget_get_allocated_size (widget, &allocation, NULL);
+        width = allocation.width;
+        height = allocation.height;
+    }
+
+    if (chart->surface &&
+        (chart->surface_width != width || chart->surface_height != height)) {
+        g_clear_pointer (&chart->surface, cairo_surface_destroy);
+    }
+
+    if (!chart->surface) {
+        cairo_t *surface_cr;
+
+        chart->surface = gdk_window_create_similar_surface (gtk_widget_get_window (widget),
+                                                            CAIRO_CONTENT_COLOR,
+                                                            width, height);
+        chart->surface_width = width;
+        chart->surface_height = height;
+
+        surface_cr = cairo_create (chart->surface);
+        render_chart (chart, surface_cr, width, height);
+        cairo_destroy (surface_cr);
+    }
+
+    cairo_set_source_surface (cr, chart->surface, 0, 0);
+    cairo_paint (cr);
+
+    applet_probe_end (probe, start);
     return FALSE;
 }
 
@@ -642,6 +1165,7 @@ free_chart_data (InvestChart *chart)
 
     for (gint i = 0; i < chart->chart_data_count; i++) {
         g_free (chart->chart_data[i].symbol);
+        g_free (chart->chart_data[i].key);
         g_free (chart->chart_data[i].prices);
         g_free (chart->chart_data[i].timestamps);
     }
@@ -651,6 +1175,49 @@ free_chart_data (InvestChart *chart)
     chart->chart_data_count = 0;
 }
 
+/* A chart of n_stocks stocks of n_points prices a minute apart, made up,
+ * drawn on drawing_area as in the chart window, for invest-bench */
+InvestChart*
+invest_chart_bench_new (GtkWidget *drawing_area, gint n_stocks, gint n_points)
+{
+    InvestChart *chart = invest_chart_new (NULL);
+    GRand *rand = g_rand_new_with_seed (1);
+
+    chart->chart_data = g_new0 (StockChartData, n_stocks);
+    chart->chart_data_count = n_stocks;
+
+    for (gint i = 0; i < n_stocks; i++) {
+        StockChartData *data = &chart->chart_data[i];
+        gdouble price = 50.0 + 50.0 * i;
+
+        data->symbol = g_strdup_printf ("BENCH%d", i);
+        data->prices = g_new (gdouble, n_points);
+        data->timestamps = g_new (gint64, n_points);
+        data->data_count = n_points;
+
+        for (gint j = 0; j < n_points; j++) {
+            price = MAX (price * (1.0 + g_rand_double_range (rand, -0.002, 0.002)), 0.01);
+            data->prices[j] = price;
+            data->timestamps[j] = G_GINT64_CONSTANT (1735689600) + j * 60;
+        }
+
+        chart_data_find_range (data);
+    }
+    g_rand_free (rand);
+
+    chart->drawing_area = drawing_area;
+    g_signal_connect (drawing_area, "draw", G_CALLBACK (chart_draw_cb), chart);
+
+    return chart;
+}
+
+/* The chart is drawn again on the next frame, as after new data */
+void
+invest_chart_bench_invalidate (InvestChart *chart)
+{
+    invalidate_chart (chart);
+}
+
 static void
 chart_range_button_clicked (GtkWidget *widget, InvestChart *chart)
 {
@@ -32,4 +32,8 @@ void invest_chart_hide (InvestChart *chart);
 gboolean invest_chart_is_visible (InvestChart *chart);
 void invest_chart_refresh_data (InvestChart *chart);
 
+/* For invest-bench */
+G_GNUC_INTERNAL InvestChart* invest_chart_bench_new (GtkWidget *drawing_area, gint n_stocks, gint n_points);
+G_GNUC_INTERNAL void invest_chart_bench_invalidate (InvestChart *chart);
+
 #endif /* INVEST_APPLET_CHART_H */
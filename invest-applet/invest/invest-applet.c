@@ -30,6 +30,8 @@
 #include <mate-panel-applet-gsettings.h>
 #include "invest-applet.h"
 #include "invest-applet-chart.h"
+#include "invest-cache.h"
+#include "invest-stream.h"
 
 static gchar* create_stock_tooltip (InvestApplet *applet);
 static void free_stock_data (InvestApplet *applet);
@@ -38,12 +40,49 @@ static void update_applet_text (InvestApplet *applet, const gchar *message, gdou
 static gboolean invest_applet_cycle_stocks (InvestApplet *applet);
 static void display_stock_at_index (InvestApplet *applet, gint stock_index);
 static void clear_timeout (guint *timeout_id);
+static gboolean invest_applet_update_stocks (gpointer user_data);
+static void schedule_update (InvestApplet *applet);
 
 G_DEFINE_TYPE (InvestApplet, invest_applet, PANEL_TYPE_APPLET);
 
 #define DEFAULT_UPDATE_INTERVAL 15 /* 15 minutes */
 #define DEFAULT_CYCLE_INTERVAL   5 /* 5 seconds */
 
+/* the spark endpoint returns the chart meta of up to 20 symbols at once */
+#define QUOTE_BATCH_URL  "https://query2.finance.yahoo.com/v7/finance/spark?range=1d&interval=1d&symbols="
+#define QUOTE_BATCH_SIZE 20
+
+/* the quotes of the last update are kept here, and shown at startup */
+#define QUOTE_CACHE_FILE "quotes.ini"
+#define QUOTE_CACHE_TTL  60 /* seconds they are used without asking again */
+
+/* an update is asked for this long after a market opens, once it has
+ * the new trading period */
+#define MARKET_OPEN_DELAY 60
+
+typedef struct {
+    InvestApplet *applet;
+    guint generation;
+    gint start;  /* the first symbol of the request */
+    gint count;
+} QuoteRequest;
+
+static void queue_chart_request (InvestApplet *applet, QuoteRequest *request);
+
+/* The quotes, the charts and the stream all go to a few Yahoo! hosts
+ * through the one session of the applet.  Its connections are kept
+ * alive between the updates and the chart fetches, and the number per
+ * host is capped so that a chart of many symbols queues instead of
+ * opening a connection for each. */
+static SoupSession *
+new_soup_session (void)
+{
+    return soup_session_new_with_options ("max-conns-per-host", 4,
+                                          "idle-timeout", 120,
+                                          "timeout", 30,
+                                          NULL);
+}
+
 static void
 invest_applet_update_display (InvestApplet *applet)
 {
@@ -65,20 +104,310 @@ invest_applet_update_display (InvestApplet *applet)
     gtk_image_set_from_icon_name (GTK_IMAGE (applet->direction_icon), direction_icon, GTK_ICON_SIZE_MENU);
 }
 
+/* Stores the price of a symbol from the "meta" object of its chart */
+static void
+store_quote (InvestApplet *applet, gint symbol_index, JsonObject *meta)
+{
+    gdouble current_price = 0;
+    gdouble prev_close = 0;
+
+    if (json_object_has_member (meta, "regularMarketPrice")) {
+        current_price = json_object_get_double_member (meta, "regularMarketPrice");
+    }
+
+    if (json_object_has_member (meta, "previousClose")) {
+        prev_close = json_object_get_double_member (meta, "previousClose");
+    } else if (json_object_has_member (meta, "chartPreviousClose")) {
+        prev_close = json_object_get_double_member (meta, "chartPreviousClose");
+    }
+
+    if (current_price > 0 && prev_close > 0) {
+        gdouble change_percent = ((current_price - prev_close) / prev_close) * 100.0;
+
+        /* store individual stock data */
+        applet->stock_prices[symbol_index] = current_price;
+        applet->stock_changes[symbol_index] = change_percent;
+        applet->stock_valid[symbol_index] = TRUE;
+    }
+
+    /* "currentTradingPeriod": { "regular": { "start": ..., "end": ..., "gmtoffset": ... }, ... } */
+    if (json_object_has_member (meta, "currentTradingPeriod")) {
+        JsonObject *period = json_object_get_object_member (meta, "currentTradingPeriod");
+        JsonObject *regular;
+
+        if (period && json_object_has_member (period, "regular") &&
+            (regular = json_object_get_object_member (period, "regular")) &&
+            json_object_has_member (regular, "start") &&
+            json_object_has_member (regular, "end")) {
+            InvestTradingPeriod *trading = &applet->stock_periods[symbol_index];
+
+            trading->start = json_object_get_int_member (regular, "start");
+            trading->end = json_object_get_int_member (regular, "end");
+            trading->gmtoffset = json_object_has_member (regular, "gmtoffset") ?
+                                 json_object_get_int_member (regular, "gmtoffset") : 0;
+        }
+    }
+}
+
+/* Returns when the next market opens, or now if one of them is open or
+ * their hours are not known yet.  With a market open, closes is set to
+ * when the last of the open ones closes. */
+static gint64
+market_next_open (InvestApplet *applet, gint64 now, gint64 *closes)
+{
+    gint64 next_open = G_MAXINT64;
+
+    *closes = 0;
+
+    for (gint i = 0; i < applet->total_symbols; i++) {
+        InvestTradingPeriod *period = &applet->stock_periods[i];
+        gint64 start = period->start;
+
+        if (!period->end) {
+            continue;
+        }
+
+        if (start <= now && now < period->end) {
+            *closes = MAX (*closes, period->end);
+            next_open = now;
+            continue;
+        }
+
+        /* after the close the period is still the one of that day, so
+         * the next one is guessed as the next weekday at the same time */
+        while (start <= now) {
+            GDateTime *local;
+            gint day;
+
+            start += 24 * 60 * 60;
+            local = g_date_time_new_from_unix_utc (start + period->gmtoffset);
+            day = g_date_time_get_day_of_week (local);
+            g_date_time_unref (local);
+
+            if (day == 6) {
+                start += 2 * 24 * 60 * 60;
+            } else if (day == 7) {
+                start += 24 * 60 * 60;
+            }
+        }
+
+        next_open = MIN (next_open, start);
+    }
+
+    return next_open == G_MAXINT64 ? now : next_open;
+}
+
+static void
+save_cached_quotes (InvestApplet *applet)
+{
+    GKeyFile *file = g_key_file_new ();
+    gchar *path = invest_cache_get_path (QUOTE_CACHE_FILE);
+    gchar *data;
+    gsize length;
+
+    g_key_file_set_int64 (file, "Quotes", "Fetched", g_get_real_time () / G_USEC_PER_SEC);
+
+    for (gint i = 0; i < applet->total_symbols; i++) {
+        if (applet->stock_valid[i]) {
+            g_key_file_set_double (file, applet->stock_symbols[i], "Price", applet->stock_prices[i]);
+            g_key_file_set_double (file, applet->stock_symbols[i], "Change", applet->stock_changes[i]);
+        }
+    }
+
+    data = g_key_file_to_data (file, &length, NULL);
+    g_file_set_contents (path, data, length, NULL);
+
+    g_free (data);
+    g_free (path);
+    g_key_file_free (file);
+}
+
+/* Fills the stock data with the quotes of the last update, returns when
+ * they were fetched or 0 */
+static gint64
+load_cached_quotes (InvestApplet *applet)
+{
+    GKeyFile *file = g_key_file_new ();
+    gchar *path = invest_cache_get_path (QUOTE_CACHE_FILE);
+    gint64 fetched = 0;
+
+    if (g_key_file_load_from_file (file, path, G_KEY_FILE_NONE, NULL)) {
+        fetched = g_key_file_get_int64 (file, "Quotes", "Fetched", NULL);
+
+        for (gint i = 0; i < applet->total_symbols; i++) {
+            const gchar *symbol = applet->stock_symbols[i];
+
+            if (g_key_file_has_key (file, symbol, "Price", NULL)) {
+                applet->stock_prices[i] = g_key_file_get_double (file, symbol, "Price", NULL);
+                applet->stock_changes[i] = g_key_file_get_double (file, symbol, "Change", NULL);
+                applet->stock_valid[i] = TRUE;
+            }
+        }
+    }
+
+    g_free (path);
+    g_key_file_free (file);
+
+    return fetched;
+}
+
+static void
+show_stocks (InvestApplet *applet)
+{
+    if (applet->total_symbols > 0) {
+        clear_timeout (&applet->cycle_timeout_id);
+
+        applet->cycle_position = 0;
+
+        gint valid_indices[applet->total_symbols];
+        gint valid_count = get_valid_stock_indices (applet, valid_indices);
+
+        if (valid_count > 0) {
+            display_stock_at_index (applet, valid_indices[0]);
+
+            /* start cycle timer if we have multiple stocks */
+            if (!applet->cycle_timeout_id && valid_count > 1) {
+                applet->cycle_timeout_id = g_timeout_add_seconds (applet->cycle_interval, (GSourceFunc) invest_applet_cycle_stocks, applet);
+            }
+
+            gchar *tooltip_text = create_stock_tooltip (applet);
+            gtk_widget_set_tooltip_text (GTK_WIDGET (applet), tooltip_text);
+            g_free (tooltip_text);
+        } else {
+            update_applet_text (applet, _("No valid stock data"), 0.0);
+        }
+    } else {
+        update_applet_text (applet, _("No valid stock data"), 0.0);
+    }
+}
+
+/* Shows the stocks once the last request of an update is done */
+static void
+stock_request_done (InvestApplet *applet)
+{
+    applet->pending_requests--;
+
+    if (applet->pending_requests == 0) {
+        show_stocks (applet);
+        save_cached_quotes (applet);
+        schedule_update (applet);
+    }
+}
+
+/* Shows a quote of the stream without restarting the cycle */
+static void
+on_stream_quote (const gchar *symbol,
+                 gdouble      price,
+                 gdouble      change_percent,
+                 gpointer     user_data)
+{
+    InvestApplet *applet = user_data;
+    gboolean changed = FALSE;
+
+    for (gint i = 0; i < applet->total_symbols; i++) {
+        if (g_ascii_strcasecmp (applet->stock_symbols[i], symbol) == 0) {
+            applet->stock_prices[i] = price;
+            applet->stock_changes[i] = change_percent;
+            applet->stock_valid[i] = TRUE;
+            changed = TRUE;
+        }
+    }
+
+    if (changed) {
+        gint valid_indices[applet->total_symbols];
+        gint valid_count = get_valid_stock_indices (applet, valid_indices);
+        gchar *tooltip_text;
+
+        if (applet->cycle_position < valid_count) {
+            display_stock_at_index (applet, valid_indices[applet->cycle_position]);
+        }
+
+        tooltip_text = create_stock_tooltip (applet);
+        gtk_widget_set_tooltip_text (GTK_WIDGET (applet), tooltip_text);
+        g_free (tooltip_text);
+    }
+}
+
+/* The quotes are polled until the stream is opened again by the next
+ * update */
+static void
+on_stream_closed (gpointer user_data)
+{
+    InvestApplet *applet = user_data;
+
+    g_clear_pointer (&applet->stream, invest_stream_free);
+}
+
+static gboolean
+update_timeout_cb (gpointer user_data)
+{
+    InvestApplet *applet = INVEST_APPLET (user_data);
+
+    applet->update_timeout_id = 0;
+
+    /* the stream keeps the quotes up to date by itself, otherwise the
+     * update plans the next one again when it is done */
+    if (!invest_stream_is_connected (applet->stream)) {
+        invest_applet_update_stocks (applet);
+    }
+    schedule_update (applet);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Plans the next update.  While all the markets are closed nothing is
+ * asked for until the first of them opens; while one is open the quotes
+ * are streamed or polled every refresh interval. */
+static void
+schedule_update (InvestApplet *applet)
+{
+    gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+    gint64 closes;
+    gint64 next_open = market_next_open (applet, now, &closes);
+    gint64 delay;
+
+    clear_timeout (&applet->update_timeout_id);
+
+    if (next_open > now) {
+        g_clear_pointer (&applet->stream, invest_stream_free);
+        delay = next_open - now + MARKET_OPEN_DELAY;
+    } else {
+        if (applet->streaming && !applet->stream && applet->total_symbols > 0) {
+            applet->stream = invest_stream_new (applet->soup_session, applet->stock_symbols,
+                                                on_stream_quote, on_stream_closed, applet);
+        }
+
+        delay = applet->refresh_interval * 60;
+        /* to stop streaming and polling at the close */
+        if (closes > now) {
+            delay = MIN (delay, closes - now + 1);
+        }
+    }
+
+    applet->update_timeout_id = g_timeout_add_seconds ((guint) delay, update_timeout_cb, applet);
+}
+
 static void
 on_stock_data_received (SoupSession *session,
                         SoupMessage *msg,
                         gpointer     user_data)
 {
-    gpointer *user_data_with_index = (gpointer *)user_data;
-    InvestApplet *applet = INVEST_APPLET (user_data_with_index[0]);
-    gint symbol_index = GPOINTER_TO_INT (user_data_with_index[1]);
+    QuoteRequest *request = user_data;
+    InvestApplet *applet = request->applet;
+    gint symbol_index = request->start;
 
     JsonParser *parser = NULL;
     JsonNode *root;
     JsonObject *root_obj;
     GError *error = NULL;
 
+    /* a newer update replaced the stock data, or the applet is going */
+    if (request->generation != applet->update_generation ||
+        msg->status_code == SOUP_STATUS_CANCELLED) {
+        g_free (request);
+        return;
+    }
+
     if (msg->status_code != SOUP_STATUS_OK) {
         g_warning ("Failed to fetch stock data for symbol %d: %s", symbol_index, msg->reason_phrase);
         goto cleanup;
@@ -127,17 +456,7 @@ on_stock_data_received (SoupSession *session,
                     JsonObject *meta = json_object_get_object_member (result, "meta");
 
                     if (meta) {
-                        gdouble current_price = json_object_get_double_member (meta, "regularMarketPrice");
-                        gdouble prev_close = json_object_get_double_member (meta, "previousClose");
-
-                        if (current_price > 0 && prev_close > 0) {
-                            gdouble change_percent = ((current_price - prev_close) / prev_close) * 100.0;
-
-                            /* store individual stock data */
-                            applet->stock_prices[symbol_index] = current_price;
-                            applet->stock_changes[symbol_index] = change_percent;
-                            applet->stock_valid[symbol_index] = TRUE;
-                        }
+                        store_quote (applet, symbol_index, meta);
                     }
                 }
             }
@@ -148,37 +467,177 @@ cleanup:
     if (parser) {
         g_object_unref (parser);
     }
-    applet->pending_requests--;
 
-    if (applet->pending_requests == 0) {
-        if (applet->total_symbols > 0) {
-            clear_timeout (&applet->cycle_timeout_id);
+    g_free (request);
+    stock_request_done (applet);
+}
+
+/* Parses the quotes of a batch of symbols.  The spark endpoint wraps the
+ * chart of each symbol like this:
+ * {
+ *   "spark": {
+ *     "result": [{
+ *       "symbol": "IBM",
+ *       "response": [{
+ *         "meta": { "regularMarketPrice": 288.998, "previousClose": 291.2, ... },
+ *         ...
+ *       }]
+ *     }, ...],
+ *     "error": null
+ *   }
+ * }
+ */
+static gboolean
+parse_quote_batch (InvestApplet *applet, QuoteRequest *request, SoupMessage *msg)
+{
+    JsonParser *parser;
+    JsonObject *root_obj;
+    JsonObject *spark;
+    JsonArray *results;
+    gboolean parsed = FALSE;
+
+    parser = json_parser_new ();
+    if (!json_parser_load_from_data (parser, msg->response_body->data,
+                                     msg->response_body->length, NULL) ||
+        !JSON_NODE_HOLDS_OBJECT (json_parser_get_root (parser))) {
+        g_object_unref (parser);
+        return FALSE;
+    }
+
+    root_obj = json_node_get_object (json_parser_get_root (parser));
+
+    if (json_object_has_member (root_obj, "spark") &&
+        (spark = json_object_get_object_member (root_obj, "spark")) &&
+        json_object_has_member (spark, "result") &&
+        !json_object_get_null_member (spark, "result") &&
+        (results = json_object_get_array_member (spark, "result"))) {
+        parsed = TRUE;
 
-            applet->cycle_position = 0;
+        for (guint i = 0; i < json_array_get_length (results); i++) {
+            JsonObject *result = json_array_get_object_element (results, i);
+            const gchar *symbol;
+            JsonArray *responses;
+            JsonObject *response;
 
-            gint valid_indices[applet->total_symbols];
-            gint valid_count = get_valid_stock_indices (applet, valid_indices);
+            if (!result || !json_object_has_member (result, "symbol") ||
+                !json_object_has_member (result, "response")) {
+                continue;
+            }
+
+            symbol = json_object_get_string_member (result, "symbol");
+            responses = json_object_get_array_member (result, "response");
+            if (!symbol || !responses || json_array_get_length (responses) == 0) {
+                continue;
+            }
 
-            if (valid_count > 0) {
-                display_stock_at_index (applet, valid_indices[0]);
+            response = json_array_get_object_element (responses, 0);
+            if (!response || !json_object_has_member (response, "meta")) {
+                continue;
+            }
 
-                /* start cycle timer if we have multiple stocks */
-                if (!applet->cycle_timeout_id && valid_count > 1) {
-                    applet->cycle_timeout_id = g_timeout_add_seconds (applet->cycle_interval, (GSourceFunc) invest_applet_cycle_stocks, applet);
+            /* the symbols come back in upper case */
+            for (gint j = request->start; j < request->start + request->count; j++) {
+                if (g_ascii_strcasecmp (applet->stock_symbols[j], symbol) == 0) {
+                    store_quote (applet, j, json_object_get_object_member (response, "meta"));
                 }
+            }
+        }
+    }
+
+    g_object_unref (parser);
+    return parsed;
+}
+
+static void
+on_quote_batch_received (SoupSession *session,
+                         SoupMessage *msg,
+                         gpointer     user_data)
+{
+    QuoteRequest *request = user_data;
+    InvestApplet *applet = request->applet;
+
+    /* a newer update replaced the stock data, or the applet is going */
+    if (request->generation != applet->update_generation ||
+        msg->status_code == SOUP_STATUS_CANCELLED) {
+        g_free (request);
+        return;
+    }
+
+    /* without the batch endpoint every symbol is asked for on its own */
+    if (msg->status_code != SOUP_STATUS_OK || !parse_quote_batch (applet, request, msg)) {
+        g_debug ("Batch quote request failed (%s), asking for each symbol", msg->reason_phrase);
+
+        for (gint i = request->start; i < request->start + request->count; i++) {
+            QuoteRequest *single = g_new (QuoteRequest, 1);
+
+            *single = *request;
+            single->start = i;
+            single->count = 1;
+            applet->pending_requests++;
+            queue_chart_request (applet, single);
+        }
+    }
+
+    g_free (request);
+    stock_request_done (applet);
+}
+
+static SoupMessage *
+new_quote_message (const gchar *url)
+{
+    SoupMessage *msg = soup_message_new ("GET", url);
+
+    /* HACK: avoid rate limiting */
+    soup_message_headers_replace (msg->request_headers, "User-Agent",
+                                  "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
+
+    return msg;
+}
+
+static void
+queue_chart_request (InvestApplet *applet, QuoteRequest *request)
+{
+    gchar *symbol = g_uri_escape_string (applet->stock_symbols[request->start], NULL, FALSE);
+    gchar *url = g_strdup_printf ("https://query2.finance.yahoo.com/v8/finance/chart/%s", symbol);
 
-                gchar *tooltip_text = create_stock_tooltip (applet);
-                gtk_widget_set_tooltip_text (GTK_WIDGET (applet), tooltip_text);
-                g_free (tooltip_text);
-            } else {
-                update_applet_text (applet, _("No valid stock data"), 0.0);
+    soup_session_queue_message (applet->soup_session, new_quote_message (url), on_stock_data_received, request);
+    g_free (url);
+    g_free (symbol);
+}
+
+/* Sets up the stock data of new symbols, keeping the last known quotes
+ * of the symbols that were there before */
+static void
+set_stock_symbols (InvestApplet *applet, gchar **symbols)
+{
+    gint symbol_count = g_strv_length (symbols);
+    gdouble *prices = g_malloc0 (symbol_count * sizeof (gdouble));
+    gdouble *changes = g_malloc0 (symbol_count * sizeof (gdouble));
+    gboolean *valid = g_malloc0 (symbol_count * sizeof (gboolean));
+    InvestTradingPeriod *periods = g_malloc0 (symbol_count * sizeof (InvestTradingPeriod));
+
+    for (gint i = 0; i < symbol_count; i++) {
+        for (gint j = 0; j < applet->total_symbols; j++) {
+            if (g_strcmp0 (applet->stock_symbols[j], symbols[i]) == 0) {
+                periods[i] = applet->stock_periods[j];
+                if (applet->stock_valid[j]) {
+                    prices[i] = applet->stock_prices[j];
+                    changes[i] = applet->stock_changes[j];
+                    valid[i] = TRUE;
+                }
+                break;
             }
-        } else {
-            update_applet_text (applet, _("No valid stock data"), 0.0);
         }
     }
 
-    g_free (user_data_with_index);
+    free_stock_data (applet);
+
+    applet->total_symbols = symbol_count;
+    applet->stock_symbols = g_strdupv (symbols);
+    applet->stock_prices = prices;
+    applet->stock_changes = changes;
+    applet->stock_valid = valid;
+    applet->stock_periods = periods;
 }
 
 /* fetch stock data from Yahoo! Finance for all configured symbols */
@@ -204,38 +663,39 @@ invest_applet_update_stocks (gpointer user_data)
 
     symbol_count = g_strv_length (symbols);
 
-    free_stock_data (applet);
+    set_stock_symbols (applet, symbols);
 
-    applet->pending_requests = symbol_count;
-    applet->total_symbols = symbol_count;
-    applet->stock_symbols = g_strdupv (symbols);
-    applet->stock_prices = g_malloc0 (symbol_count * sizeof (gdouble));
-    applet->stock_changes = g_malloc0 (symbol_count * sizeof (gdouble));
-    applet->stock_valid = g_malloc0 (symbol_count * sizeof (gboolean));
+    applet->pending_requests = 0;
+    applet->update_generation++;
 
     applet->cycle_position = 0;
     clear_timeout (&applet->cycle_timeout_id);
 
     /* initialize networking */
     if (!applet->soup_session) {
-        applet->soup_session = soup_session_new ();
+        applet->soup_session = new_soup_session ();
     }
 
-    /* make separate request for each stock symbol */
-    for (gint i = 0; i < symbol_count; i++) {
-        gchar *url = g_strdup_printf ("https://query2.finance.yahoo.com/v8/finance/chart/%s", symbols[i]);
-        SoupMessage *msg = soup_message_new ("GET", url);
+    /* one request for every QUOTE_BATCH_SIZE symbols */
+    for (gint start = 0; start < symbol_count; start += QUOTE_BATCH_SIZE) {
+        QuoteRequest *request = g_new (QuoteRequest, 1);
+        GString *url = g_string_new (QUOTE_BATCH_URL);
 
-        /* HACK: avoid rate limiting */
-        soup_message_headers_replace (msg->request_headers, "User-Agent",
-                                      "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
+        request->applet = applet;
+        request->generation = applet->update_generation;
+        request->start = start;
+        request->count = MIN (QUOTE_BATCH_SIZE, symbol_count - start);
 
-        gpointer *user_data_with_index = g_malloc (2 * sizeof (gpointer));
-        user_data_with_index[0] = applet;
-        user_data_with_index[1] = GINT_TO_POINTER (i);
+        for (gint i = start; i < start + request->count; i++) {
+            if (i > start) {
+                g_string_append (url, "%2C");
+            }
+            g_string_append_uri_escaped (url, symbols[i], NULL, FALSE);
+        }
 
-        soup_session_queue_message (applet->soup_session, msg, on_stock_data_received, user_data_with_index);
-        g_free (url);
+        applet->pending_requests++;
+        soup_session_queue_message (applet->soup_session, new_quote_message (url->str), on_quote_batch_received, request);
+        g_string_free (url, TRUE);
     }
 
     g_strfreev (symbols);
@@ -247,7 +707,7 @@ invest_applet_preferences_cb (GtkAction    *action,
                               InvestApplet *applet)
 {
     GtkWidget *dialog, *content_area, *entry, *label, *spin_button, *refresh_label, *cycle_label, *cycle_spin;
-    GtkWidget *hbox1, *hbox2, *hbox3;
+    GtkWidget *hbox1, *hbox2, *hbox3, *stream_check;
     gchar **symbols;
     gchar *symbols_text;
     gint response, refresh_interval, cycle_interval;
@@ -294,6 +754,10 @@ invest_applet_preferences_cb (GtkAction    *action,
     gtk_box_pack_start (GTK_BOX (hbox3), cycle_label, FALSE, FALSE, 0);
     gtk_box_pack_start (GTK_BOX (hbox3), cycle_spin, FALSE, FALSE, 0);
 
+    /* Streaming */
+    stream_check = gtk_check_button_new_with_mnemonic (_("_Stream live quotes while the markets are open"));
+    gtk_widget_set_sensitive (stream_check, invest_stream_is_supported ());
+
     if (!G_IS_SETTINGS (applet->settings)) {
         g_warning ("Settings not available in preferences");
         gtk_widget_destroy (dialog);
@@ -312,10 +776,14 @@ invest_applet_preferences_cb (GtkAction    *action,
     cycle_interval = g_settings_get_int (applet->settings, "cycle-interval");
     gtk_spin_button_set_value (GTK_SPIN_BUTTON (cycle_spin), cycle_interval);
 
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (stream_check),
+                                  g_settings_get_boolean (applet->settings, "streaming"));
+
     /* Pack all rows into content area */
     gtk_box_pack_start (GTK_BOX (content_area), hbox1, FALSE, FALSE, 6);
     gtk_box_pack_start (GTK_BOX (content_area), hbox2, FALSE, FALSE, 6);
     gtk_box_pack_start (GTK_BOX (content_area), hbox3, FALSE, FALSE, 6);
+    gtk_box_pack_start (GTK_BOX (content_area), stream_check, FALSE, FALSE, 6);
 
     gtk_widget_show_all (dialog);
 
@@ -326,6 +794,7 @@ invest_applet_preferences_cb (GtkAction    *action,
         gchar **new_symbols = g_strsplit (text, ",", -1);
         gint new_refresh_interval = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (spin_button));
         gint new_cycle_interval = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (cycle_spin));
+        gboolean new_streaming = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (stream_check));
 
         /* trim whitespaces */
         for (gint i = 0; new_symbols[i]; i++) {
@@ -335,16 +804,14 @@ invest_applet_preferences_cb (GtkAction    *action,
         g_settings_set_strv (applet->settings, "stock-symbols", (const gchar * const *)new_symbols);
         g_settings_set_int (applet->settings, "refresh-interval", new_refresh_interval);
         g_settings_set_int (applet->settings, "cycle-interval", new_cycle_interval);
+        g_settings_set_boolean (applet->settings, "streaming", new_streaming);
         g_strfreev (new_symbols);
 
-        /* Update refresh interval if changed */
-        if (new_refresh_interval != applet->refresh_interval) {
-            clear_timeout (&applet->update_timeout_id);
-            applet->refresh_interval = new_refresh_interval;
-            applet->update_timeout_id = g_timeout_add_seconds (new_refresh_interval * 60,
-                                                               invest_applet_update_stocks,
-                                                               applet);
-        }
+        applet->refresh_interval = new_refresh_interval;
+        applet->streaming = new_streaming;
+
+        /* the symbols may have changed, the update opens a new stream */
+        g_clear_pointer (&applet->stream, invest_stream_free);
 
         /* Update cycle interval if changed */
         if (new_cycle_interval != applet->cycle_interval) {
@@ -481,6 +948,8 @@ invest_applet_destroy (GtkWidget    *widget,
     clear_timeout (&applet->update_timeout_id);
     clear_timeout (&applet->cycle_timeout_id);
 
+    g_clear_pointer (&applet->stream, invest_stream_free);
+
     if (applet->chart) {
         if (invest_chart_is_visible (applet->chart)) {
             invest_chart_hide (applet->chart);
@@ -518,6 +987,10 @@ invest_applet_init (InvestApplet *applet)
     applet->stock_prices = NULL;
     applet->stock_changes = NULL;
     applet->stock_valid = NULL;
+    applet->stock_periods = NULL;
+
+    applet->streaming = FALSE;
+    applet->stream = NULL;
 
     /* init stock cycling in panel display */
     applet->cycle_position = 0;
@@ -527,7 +1000,7 @@ invest_applet_init (InvestApplet *applet)
     applet->chart = invest_chart_new (applet);
 
     /* init networking */
-    applet->soup_session = soup_session_new ();
+    applet->soup_session = new_soup_session ();
 
     /* UI */
     hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 4);
@@ -598,15 +1071,32 @@ invest_applet_factory (MatePanelApplet *applet,
         if (G_IS_SETTINGS (invest_applet->settings)) {
             invest_applet->refresh_interval = g_settings_get_int (invest_applet->settings, "refresh-interval");
             invest_applet->cycle_interval = g_settings_get_int (invest_applet->settings, "cycle-interval");
+            invest_applet->streaming = g_settings_get_boolean (invest_applet->settings, "streaming");
         }
 
-        /* Start periodic updates */
-        invest_applet->update_timeout_id = g_timeout_add_seconds (invest_applet->refresh_interval * 60,
-                                                                  invest_applet_update_stocks,
-                                                                  invest_applet);
+        /* Show the quotes of the last run at once, and only ask again
+         * when they are not recent */
+        gchar **symbols = g_settings_get_strv (invest_applet->settings, "stock-symbols");
+        gint64 fetched = 0;
+
+        if (symbols && symbols[0]) {
+            set_stock_symbols (invest_applet, symbols);
+            fetched = load_cached_quotes (invest_applet);
+            if (fetched) {
+                show_stocks (invest_applet);
+            }
+        }
+        g_strfreev (symbols);
 
         /* Load initial data */
-        invest_applet_update_stocks (invest_applet);
+        if (g_get_real_time () / G_USEC_PER_SEC - fetched >= QUOTE_CACHE_TTL) {
+            invest_applet_update_stocks (invest_applet);
+        }
+
+        /* Start periodic updates */
+        if (!invest_applet->update_timeout_id) {
+            schedule_update (invest_applet);
+        }
         invest_applet_update_display (invest_applet);
 
         return TRUE;
@@ -651,12 +1141,14 @@ free_stock_data (InvestApplet *applet)
     g_free (applet->stock_prices);
     g_free (applet->stock_changes);
     g_free (applet->stock_valid);
+    g_free (applet->stock_periods);
     g_free (applet->stock_summary);
 
     applet->stock_symbols = NULL;
     applet->stock_prices = NULL;
     applet->stock_changes = NULL;
     applet->stock_valid = NULL;
+    applet->stock_periods = NULL;
     applet->stock_summary = NULL;
 }
 
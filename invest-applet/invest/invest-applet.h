@@ -30,6 +30,13 @@ G_BEGIN_DECLS
 typedef struct _InvestApplet InvestApplet;
 typedef struct _InvestAppletClass InvestAppletClass;
 
+/* the regular trading hours of the market of a symbol, in unix time */
+typedef struct {
+    gint64 start;
+    gint64 end;
+    gint gmtoffset; /* of the exchange */
+} InvestTradingPeriod;
+
 struct _InvestApplet {
     MatePanelApplet parent;
 
@@ -43,13 +50,17 @@ struct _InvestApplet {
     gdouble change_percent;
     gint refresh_interval;
     gint cycle_interval;
+    gboolean streaming;
+    struct _InvestStream *stream;
 
     gint pending_requests;
+    guint update_generation; /* responses of an older update are dropped */
     gint total_symbols;
     gchar **stock_symbols;
     gdouble *stock_prices;
     gdouble *stock_changes;
     gboolean *stock_valid;
+    InvestTradingPeriod *stock_periods; /* zero until known */
 
     /* for cycling through multiple stocks */
     gint cycle_position;
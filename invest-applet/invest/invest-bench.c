@@ -0,0 +1,68 @@
+/* Measures the chart of the invest applet offscreen.
+ *
+ * The chart is drawn by the same draw handler as in the chart window,
+ * with made up prices. Drawn as cached, only the surface of the last
+ * chart is painted, as on every expose of the window; drawn again, the
+ * chart is rendered first, as after new data arrived.
+ *
+ * Built on request only: make -C invest-applet/invest invest-bench
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "common/applet-bench.h"
+
+#include "invest-applet-chart.h"
+
+static void
+bench_chart_invalidate (gint     frame,
+                        gpointer data)
+{
+    invest_chart_bench_invalidate (data);
+}
+
+static void
+bench_chart (const gchar *size,
+             gint         width,
+             gint         height,
+             gint         n_stocks,
+             gint         n_points)
+{
+    GtkWidget *drawing_area;
+    InvestChart *chart;
+    gchar *label;
+
+    label = g_strdup_printf ("%s cached", size);
+    drawing_area = gtk_drawing_area_new ();
+    chart = invest_chart_bench_new (drawing_area, n_stocks, n_points);
+    applet_bench_draw ("invest:chart_draw_cb", label, drawing_area, width, height,
+                       NULL, chart);
+    invest_chart_free (chart);
+    g_free (label);
+
+    label = g_strdup_printf ("%s redraw", size);
+    drawing_area = gtk_drawing_area_new ();
+    chart = invest_chart_bench_new (drawing_area, n_stocks, n_points);
+    applet_bench_draw ("invest:chart_draw_cb", label, drawing_area, width, height,
+                       bench_chart_invalidate, chart);
+    invest_chart_free (chart);
+    g_free (label);
+}
+
+int
+main (int argc, char *argv [])
+{
+    if (!applet_bench_init (&argc, &argv, "- measure the invest chart offscreen", NULL))
+        return EXIT_FAILURE;
+
+    /* a day of three stocks in the window as it opens, and months of
+     * many stocks in a window maximized on a large screen */
+    bench_chart ("800x500", 800, 500, 3, 390);
+    bench_chart ("2560x1440", 2560, 1440, 8, 10000);
+
+    return EXIT_SUCCESS;
+}
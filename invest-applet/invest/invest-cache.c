@@ -0,0 +1,184 @@
+/*
+ * MATE Invest Applet - On-disk response cache
+ * Copyright (C) 2025 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include "invest-cache.h"
+
+#define CACHE_GROUP "Cache"
+
+gchar*
+invest_cache_get_path (const gchar *name)
+{
+    gchar *dir = g_build_filename (g_get_user_cache_dir (), "mate-invest-applet", NULL);
+    gchar *path;
+
+    g_mkdir_with_parents (dir, 0700);
+    path = g_build_filename (dir, name, NULL);
+    g_free (dir);
+
+    return path;
+}
+
+/* keys hold symbols such as "^GSPC" or "EURUSD=X", which are hashed
+ * into file names */
+static void
+get_entry_paths (const gchar *key, gchar **body_path, gchar **meta_path)
+{
+    gchar *hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+    gchar *name;
+
+    name = g_strconcat (hash, ".json", NULL);
+    *body_path = invest_cache_get_path (name);
+    g_free (name);
+
+    name = g_strconcat (hash, ".meta", NULL);
+    *meta_path = invest_cache_get_path (name);
+    g_free (name);
+
+    g_free (hash);
+}
+
+InvestCacheEntry*
+invest_cache_lookup (const gchar *key)
+{
+    InvestCacheEntry *entry = NULL;
+    gchar *body_path, *meta_path;
+    GKeyFile *meta = g_key_file_new ();
+    gchar *contents;
+    gsize length;
+
+    get_entry_paths (key, &body_path, &meta_path);
+
+    /* the key is kept too, in case of a hash collision */
+    if (g_key_file_load_from_file (meta, meta_path, G_KEY_FILE_NONE, NULL)) {
+        gchar *stored_key = g_key_file_get_string (meta, CACHE_GROUP, "Key", NULL);
+
+        if (g_strcmp0 (stored_key, key) == 0 &&
+            g_file_get_contents (body_path, &contents, &length, NULL)) {
+            entry = g_new0 (InvestCacheEntry, 1);
+            entry->body = g_bytes_new_take (contents, length);
+            entry->etag = g_key_file_get_string (meta, CACHE_GROUP, "ETag", NULL);
+            entry->last_modified = g_key_file_get_string (meta, CACHE_GROUP, "LastModified", NULL);
+            entry->fetched = g_key_file_get_int64 (meta, CACHE_GROUP, "Fetched", NULL);
+            entry->fresh_until = g_key_file_get_int64 (meta, CACHE_GROUP, "FreshUntil", NULL);
+        }
+        g_free (stored_key);
+    }
+
+    g_key_file_free (meta);
+    g_free (body_path);
+    g_free (meta_path);
+
+    return entry;
+}
+
+void
+invest_cache_entry_free (InvestCacheEntry *entry)
+{
+    if (!entry) {
+        return;
+    }
+
+    g_bytes_unref (entry->body);
+    g_free (entry->etag);
+    g_free (entry->last_modified);
+    g_free (entry);
+}
+
+gboolean
+invest_cache_entry_is_fresh (InvestCacheEntry *entry)
+{
+    return entry && g_get_real_time () / G_USEC_PER_SEC < entry->fresh_until;
+}
+
+/* Makes the request conditional, so that an unchanged response comes
+ * back as a bodiless 304 */
+void
+invest_cache_add_validators (InvestCacheEntry *entry, SoupMessage *msg)
+{
+    if (!entry) {
+        return;
+    }
+
+    if (entry->etag) {
+        soup_message_headers_replace (msg->request_headers, "If-None-Match", entry->etag);
+    }
+    if (entry->last_modified) {
+        soup_message_headers_replace (msg->request_headers, "If-Modified-Since", entry->last_modified);
+    }
+}
+
+static void
+save_meta (const gchar *key, const gchar *etag, const gchar *last_modified, gint64 fresh_until)
+{
+    gchar *body_path, *meta_path;
+    GKeyFile *meta = g_key_file_new ();
+    gchar *data;
+    gsize length;
+
+    get_entry_paths (key, &body_path, &meta_path);
+
+    g_key_file_set_string (meta, CACHE_GROUP, "Key", key);
+    if (etag) {
+        g_key_file_set_string (meta, CACHE_GROUP, "ETag", etag);
+    }
+    if (last_modified) {
+        g_key_file_set_string (meta, CACHE_GROUP, "LastModified", last_modified);
+    }
+    g_key_file_set_int64 (meta, CACHE_GROUP, "Fetched", g_get_real_time () / G_USEC_PER_SEC);
+    g_key_file_set_int64 (meta, CACHE_GROUP, "FreshUntil", fresh_until);
+
+    data = g_key_file_to_data (meta, &length, NULL);
+    g_file_set_contents (meta_path, data, length, NULL);
+
+    g_free (data);
+    g_key_file_free (meta);
+    g_free (body_path);
+    g_free (meta_path);
+}
+
+void
+invest_cache_store (const gchar *key, SoupMessage *msg, gint64 fresh_until)
+{
+    gchar *body_path, *meta_path;
+
+    get_entry_paths (key, &body_path, &meta_path);
+
+    if (g_file_set_contents (body_path, msg->response_body->data,
+                             msg->response_body->length, NULL)) {
+        save_meta (key,
+                   soup_message_headers_get_one (msg->response_headers, "ETag"),
+                   soup_message_headers_get_one (msg->response_headers, "Last-Modified"),
+                   fresh_until);
+    }
+
+    g_free (body_path);
+    g_free (meta_path);
+}
+
+/* The server said the cached body is still current */
+void
+invest_cache_revalidated (const gchar *key, InvestCacheEntry *entry, gint64 fresh_until)
+{
+    save_meta (key, entry->etag, entry->last_modified, fresh_until);
+    entry->fresh_until = fresh_until;
+}
@@ -0,0 +1,50 @@
+/*
+ * MATE Invest Applet - On-disk response cache
+ * Copyright (C) 2025 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INVEST_CACHE_H
+#define INVEST_CACHE_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+/* Responses are kept in the user cache dir, one body and one keyfile
+ * with its validators per key, so that they can be shown at startup and
+ * revalidated instead of fetched again. */
+
+typedef struct _InvestCacheEntry InvestCacheEntry;
+
+struct _InvestCacheEntry {
+    GBytes *body;
+    gchar *etag;
+    gchar *last_modified;
+    gint64 fetched;     /* unix time */
+    gint64 fresh_until; /* no need to ask before this */
+};
+
+gchar* invest_cache_get_path (const gchar *name);
+
+InvestCacheEntry* invest_cache_lookup (const gchar *key);
+void invest_cache_entry_free (InvestCacheEntry *entry);
+gboolean invest_cache_entry_is_fresh (InvestCacheEntry *entry);
+
+void invest_cache_add_validators (InvestCacheEntry *entry, SoupMessage *msg);
+void invest_cache_store (const gchar *key, SoupMessage *msg, gint64 fresh_until);
+void invest_cache_revalidated (const gchar *key, InvestCacheEntry *entry, gint64 fresh_until);
+
+#endif /* INVEST_CACHE_H */
@@ -0,0 +1,348 @@
+/*
+ * MATE Invest Applet - Live quote stream
+ * Copyright (C) 2025 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include "invest-stream.h"
+
+#define STREAM_URL    "wss://streamer.finance.yahoo.com/"
+#define STREAM_ORIGIN "https://finance.yahoo.com"
+
+/* the fields of the PricingData protobuf message that are used */
+#define PRICING_ID             1 /* string */
+#define PRICING_PRICE          2 /* float */
+#define PRICING_CHANGE_PERCENT 8 /* float */
+
+struct _InvestStream {
+    SoupWebsocketConnection *connection;
+    GCancellable *cancellable;
+    gchar **symbols;
+    InvestStreamQuoteFunc quote_func;
+    InvestStreamClosedFunc closed_func;
+    gpointer user_data;
+};
+
+#if SOUP_CHECK_VERSION (2, 50, 0)
+
+static gboolean
+read_varint (const guchar **p, const guchar *end, guint64 *value)
+{
+    guint64 result = 0;
+
+    for (gint shift = 0; shift < 64 && *p < end; shift += 7) {
+        guchar byte = *(*p)++;
+
+        result |= (guint64) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static gdouble
+read_float (const guchar *p)
+{
+    guint32 bits = (guint32) p[0] | (guint32) p[1] << 8 | (guint32) p[2] << 16 | (guint32) p[3] << 24;
+    gfloat value;
+
+    memcpy (&value, &bits, sizeof (value));
+
+    return value;
+}
+
+/* Reads the symbol, price and change of a PricingData message, skipping
+ * the fields that are not used */
+static void
+parse_pricing_data (InvestStream *stream, const guchar *data, gsize length)
+{
+    const guchar *p = data;
+    const guchar *end = data + length;
+    gchar *symbol = NULL;
+    gdouble price = 0;
+    gdouble change_percent = 0;
+    gboolean have_change = FALSE;
+
+    while (p < end) {
+        guint64 key, value;
+
+        if (!read_varint (&p, end, &key)) {
+            goto out;
+        }
+
+        switch (key & 7) {
+            case 0: /* varint */
+                if (!read_varint (&p, end, &value)) {
+                    goto out;
+                }
+                break;
+            case 1: /* 64 bit */
+                if (end - p < 8) {
+                    goto out;
+                }
+                p += 8;
+                break;
+            case 2: /* length delimited */
+                if (!read_varint (&p, end, &value) || value > (guint64) (end - p)) {
+                    goto out;
+                }
+                if ((key >> 3) == PRICING_ID) {
+                    g_free (symbol);
+                    symbol = g_strndup ((const gchar *) p, value);
+                }
+                p += value;
+                break;
+            case 5: /* 32 bit */
+                if (end - p < 4) {
+                    goto out;
+                }
+                if ((key >> 3) == PRICING_PRICE) {
+                    price = read_float (p);
+                } else if ((key >> 3) == PRICING_CHANGE_PERCENT) {
+                    change_percent = read_float (p);
+                    have_change = TRUE;
+                }
+                p += 4;
+                break;
+            default:
+                goto out;
+        }
+    }
+
+    if (symbol && price > 0 && have_change) {
+        stream->quote_func (symbol, price, change_percent, stream->user_data);
+    }
+
+out:
+    g_free (symbol);
+}
+
+/* The messages are the base64 of a PricingData, either on their own or
+ * as the "message" of a JSON object */
+static void
+on_stream_message (SoupWebsocketConnection *connection,
+                   gint                     type,
+                   GBytes                  *message,
+                   gpointer                 user_data)
+{
+    InvestStream *stream = user_data;
+    gsize size;
+    const gchar *data = g_bytes_get_data (message, &size);
+    gchar *text;
+    guchar *pricing;
+    gsize length;
+
+    if (type != SOUP_WEBSOCKET_DATA_TEXT || size == 0) {
+        return;
+    }
+
+    if (data[0] == '{') {
+        JsonParser *parser = json_parser_new ();
+        JsonObject *object;
+
+        text = NULL;
+        if (json_parser_load_from_data (parser, data, size, NULL) &&
+            JSON_NODE_HOLDS_OBJECT (json_parser_get_root (parser)) &&
+            (object = json_node_get_object (json_parser_get_root (parser))) &&
+            json_object_has_member (object, "message")) {
+            text = g_strdup (json_object_get_string_member (object, "message"));
+        }
+        g_object_unref (parser);
+
+        if (!text) {
+            return;
+        }
+    } else {
+        text = g_strndup (data, size);
+    }
+
+    pricing = g_base64_decode (text, &length);
+    parse_pricing_data (stream, pricing, length);
+
+    g_free (pricing);
+    g_free (text);
+}
+
+static void
+on_stream_closed (SoupWebsocketConnection *connection,
+                  gpointer                 user_data)
+{
+    InvestStream *stream = user_data;
+
+    g_debug ("Quote stream closed (%d)", soup_websocket_connection_get_close_code (connection));
+    stream->closed_func (stream->user_data);
+}
+
+static void
+send_subscribe (InvestStream *stream)
+{
+    JsonBuilder *builder = json_builder_new ();
+    JsonGenerator *generator = json_generator_new ();
+    JsonNode *root;
+    gchar *text;
+
+    json_builder_begin_object (builder);
+    json_builder_set_member_name (builder, "subscribe");
+    json_builder_begin_array (builder);
+    for (gint i = 0; stream->symbols[i]; i++) {
+        json_builder_add_string_value (builder, stream->symbols[i]);
+    }
+    json_builder_end_array (builder);
+    json_builder_end_object (builder);
+
+    root = json_builder_get_root (builder);
+    json_generator_set_root (generator, root);
+    text = json_generator_to_data (generator, NULL);
+
+    soup_websocket_connection_send_text (stream->connection, text);
+
+    g_free (text);
+    json_node_free (root);
+    g_object_unref (generator);
+    g_object_unref (builder);
+}
+
+static void
+on_stream_connected (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+    SoupWebsocketConnection *connection;
+    InvestStream *stream;
+    GError *error = NULL;
+
+    connection = soup_session_websocket_connect_finish (SOUP_SESSION (source), result, &error);
+
+    /* the stream was freed */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return;
+    }
+
+    stream = user_data;
+
+    if (!connection) {
+        g_debug ("Failed to open the quote stream: %s", error->message);
+        g_error_free (error);
+        stream->closed_func (stream->user_data);
+        return;
+    }
+
+    stream->connection = connection;
+    g_signal_connect (connection, "message", G_CALLBACK (on_stream_message), stream);
+    g_signal_connect (connection, "closed", G_CALLBACK (on_stream_closed), stream);
+
+    send_subscribe (stream);
+}
+
+gboolean
+invest_stream_is_supported (void)
+{
+    return TRUE;
+}
+
+InvestStream*
+invest_stream_new (SoupSession            *session,
+                   gchar                 **symbols,
+                   InvestStreamQuoteFunc   quote_func,
+                   InvestStreamClosedFunc  closed_func,
+                   gpointer                user_data)
+{
+    InvestStream *stream = g_new0 (InvestStream, 1);
+    SoupMessage *msg = soup_message_new ("GET", STREAM_URL);
+
+    stream->cancellable = g_cancellable_new ();
+    stream->symbols = g_strdupv (symbols);
+    stream->quote_func = quote_func;
+    stream->closed_func = closed_func;
+    stream->user_data = user_data;
+
+    soup_message_headers_replace (msg->request_headers, "User-Agent",
+                                  "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36");
+    soup_session_websocket_connect_async (session, msg, STREAM_ORIGIN, NULL,
+                                          stream->cancellable, on_stream_connected, stream);
+    g_object_unref (msg);
+
+    return stream;
+}
+
+void
+invest_stream_free (InvestStream *stream)
+{
+    if (!stream) {
+        return;
+    }
+
+    g_cancellable_cancel (stream->cancellable);
+    g_object_unref (stream->cancellable);
+
+    if (stream->connection) {
+        g_signal_handlers_disconnect_by_data (stream->connection, stream);
+        if (soup_websocket_connection_get_state (stream->connection) == SOUP_WEBSOCKET_STATE_OPEN) {
+            soup_websocket_connection_close (stream->connection, SOUP_WEBSOCKET_CLOSE_NORMAL, NULL);
+        }
+        g_object_unref (stream->connection);
+    }
+
+    g_strfreev (stream->symbols);
+    g_free (stream);
+}
+
+gboolean
+invest_stream_is_connected (InvestStream *stream)
+{
+    return stream && stream->connection &&
+           soup_websocket_connection_get_state (stream->connection) == SOUP_WEBSOCKET_STATE_OPEN;
+}
+
+#else /* !SOUP_CHECK_VERSION (2, 50, 0) */
+
+gboolean
+invest_stream_is_supported (void)
+{
+    return FALSE;
+}
+
+InvestStream*
+invest_stream_new (SoupSession            *session,
+                   gchar                 **symbols,
+                   InvestStreamQuoteFunc   quote_func,
+                   InvestStreamClosedFunc  closed_func,
+                   gpointer                user_data)
+{
+    return NULL;
+}
+
+void
+invest_stream_free (InvestStream *stream)
+{
+}
+
+gboolean
+invest_stream_is_connected (InvestStream *stream)
+{
+    return FALSE;
+}
+
+#endif /* SOUP_CHECK_VERSION (2, 50, 0) */
@@ -0,0 +1,51 @@
+/*
+ * MATE Invest Applet - Live quote stream
+ * Copyright (C) 2025 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INVEST_STREAM_H
+#define INVEST_STREAM_H
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+/* The quotes of some symbols, pushed by the Yahoo! Finance streamer over
+ * a WebSocket as they trade.  Streaming needs libsoup 2.50 or newer;
+ * without it no stream can be opened and the quotes are polled. */
+
+typedef struct _InvestStream InvestStream;
+
+typedef void (*InvestStreamQuoteFunc) (const gchar *symbol,
+                                       gdouble      price,
+                                       gdouble      change_percent,
+                                       gpointer     user_data);
+
+/* Called once when the stream failed to open or was closed by the
+ * server; the stream may be freed from it */
+typedef void (*InvestStreamClosedFunc) (gpointer user_data);
+
+gboolean invest_stream_is_supported (void);
+
+InvestStream* invest_stream_new (SoupSession            *session,
+                                 gchar                 **symbols,
+                                 InvestStreamQuoteFunc   quote_func,
+                                 InvestStreamClosedFunc  closed_func,
+                                 gpointer                user_data);
+void invest_stream_free (InvestStream *stream);
+gboolean invest_stream_is_connected (InvestStream *stream);
+
+#endif /* INVEST_STREAM_H */
@@ -21,15 +21,25 @@
 
 #include <libmateweather/mateweather-prefs.h>
 
+#include "common/applet-startup.h"
+
 #include "mateweather.h"
 #include "mateweather-pref.h"
 #include "mateweather-dialog.h"
 #include "mateweather-applet.h"
 
+/* The first fetch goes to the network, the panel is painted before */
+static void mateweather_applet_start_update(gpointer data)
+{
+	mateweather_update_cached((MateWeatherApplet*) data);
+}
+
 static gboolean mateweather_applet_new(MatePanelApplet* applet, const gchar* iid, gpointer data)
 {
 	MateWeatherApplet* gw_applet;
 
+	applet_startup_mark("mateweather factory");
+
 	gw_applet = g_new0(MateWeatherApplet, 1);
 
 	gw_applet->applet = applet;
@@ -40,7 +50,10 @@ static gboolean mateweather_applet_new(MatePanelApplet* applet, const gchar* iid
 
 	mateweather_prefs_load(&gw_applet->mateweather_pref, gw_applet->settings);
 
-	mateweather_update(gw_applet);
+	applet_startup_defer(GTK_WIDGET(applet), "mateweather",
+	                     mateweather_applet_start_update, gw_applet);
+
+	applet_startup_mark("mateweather constructed");
 
 	return TRUE;
 }
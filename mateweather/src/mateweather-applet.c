@@ -41,6 +41,133 @@
 
 #define MAX_CONSECUTIVE_FAULTS (3)
 
+/* The weather fetched by one applet of the process, for the others
+ * showing the same location with the same preferences.  An applet whose
+ * timer fires takes the weather another one fetched in the last half
+ * update interval, or waits for the fetch another one has going. */
+typedef struct {
+    WeatherInfo       *info;     /* a copy of the last valid weather */
+    gint64             fetched;  /* monotonic time of info */
+    MateWeatherApplet *fetcher;  /* the applet fetching it now */
+    GSList            *waiting;  /* applets waiting for that fetch */
+} WeatherCacheEntry;
+
+static GHashTable *weather_cache = NULL;
+
+static void update_finish (WeatherInfo *info, gpointer data);
+
+static void
+weather_cache_entry_free (WeatherCacheEntry *entry)
+{
+    weather_info_free (entry->info);
+    g_slist_free (entry->waiting);
+    g_free (entry);
+}
+
+static WeatherCacheEntry *
+weather_cache_lookup (const gchar *key)
+{
+    WeatherCacheEntry *entry;
+
+    if (!weather_cache)
+        weather_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                               (GDestroyNotify) weather_cache_entry_free);
+
+    entry = g_hash_table_lookup (weather_cache, key);
+    if (!entry) {
+        entry = g_new0 (WeatherCacheEntry, 1);
+        g_hash_table_insert (weather_cache, g_strdup (key), entry);
+    }
+
+    return entry;
+}
+
+/* Everything the weather of an update depends on */
+static gchar *
+weather_cache_key (WeatherLocation *location, WeatherPrefs *prefs)
+{
+    if (!location)
+        return g_strdup ("");
+
+    return g_strdup_printf ("%s|%s|%.4f|%.4f|%d|%d|%s|%d|%d|%d|%d",
+                            location->code ? location->code : "",
+                            location->zone ? location->zone : "",
+                            location->latitude, location->longitude,
+                            prefs->type, prefs->radar,
+                            prefs->radar_custom_url ? prefs->radar_custom_url : "",
+                            prefs->temperature_unit, prefs->speed_unit,
+                            prefs->pressure_unit, prefs->distance_unit);
+}
+
+/* Hands the weather of a fetch that is done to the applets waiting for
+ * it, which fetch it themselves if it failed */
+static void
+weather_cache_fetched (MateWeatherApplet *gw_applet, WeatherInfo *info)
+{
+    WeatherCacheEntry *entry;
+    GSList *waiting, *l;
+
+    if (!weather_cache || !gw_applet->cache_key)
+        return;
+
+    entry = g_hash_table_lookup (weather_cache, gw_applet->cache_key);
+    if (!entry || entry->fetcher != gw_applet)
+        return;
+
+    entry->fetcher = NULL;
+    waiting = entry->waiting;
+    entry->waiting = NULL;
+
+    if (info && weather_info_is_valid (info)) {
+        weather_info_free (entry->info);
+        entry->info = weather_info_clone (info);
+        entry->fetched = g_get_monotonic_time ();
+    }
+
+    for (l = waiting; l; l = l->next) {
+        MateWeatherApplet *waiter = l->data;
+
+        if (info && weather_info_is_valid (info)) {
+            weather_info_free (waiter->mateweather_info);
+            waiter->mateweather_info = weather_info_clone (entry->info);
+            update_finish (waiter->mateweather_info, waiter);
+        } else {
+            mateweather_update (waiter);
+        }
+    }
+
+    g_slist_free (waiting);
+}
+
+/* Takes an applet that is going out of the cache */
+static void
+weather_cache_forget (MateWeatherApplet *gw_applet)
+{
+    WeatherCacheEntry *entry;
+    GSList *waiting, *l;
+
+    if (!weather_cache || !gw_applet->cache_key)
+        return;
+
+    entry = g_hash_table_lookup (weather_cache, gw_applet->cache_key);
+    if (entry) {
+        entry->waiting = g_slist_remove (entry->waiting, gw_applet);
+
+        if (entry->fetcher == gw_applet) {
+            /* the fetch is aborted, whoever waited for it fetches */
+            entry->fetcher = NULL;
+            waiting = entry->waiting;
+            entry->waiting = NULL;
+
+            for (l = waiting; l; l = l->next)
+                mateweather_update (l->data);
+            g_slist_free (waiting);
+        }
+    }
+
+    g_clear_pointer (&gw_applet->cache_key, g_free);
+}
+
 static void about_cb (GtkAction      *action,
 		      MateWeatherApplet *gw_applet)
 {
@@ -319,6 +446,7 @@ applet_destroy (GtkWidget *widget, MateWeatherApplet *gw_applet)
                                           G_CALLBACK (network_changed),
                                           gw_applet);
 
+    weather_cache_forget (gw_applet);
     weather_info_abort (gw_applet->mateweather_info);
 }
 
@@ -407,7 +535,7 @@ gint timeout_cb (gpointer data)
 {
     MateWeatherApplet *gw_applet = (MateWeatherApplet *)data;
 
-    mateweather_update(gw_applet);
+    mateweather_update_cached(gw_applet);
     return 0;  /* Do not repeat timeout (will be reset by mateweather_update) */
 }
 
@@ -517,6 +645,13 @@ update_finish (WeatherInfo *info, gpointer data)
     }
 }
 
+static void
+fetch_finish (WeatherInfo *info, gpointer data)
+{
+    weather_cache_fetched ((MateWeatherApplet *)data, info);
+    update_finish (info, data);
+}
+
 gint suncalc_timeout_cb (gpointer data)
 {
     WeatherInfo *info = ((MateWeatherApplet *)data)->mateweather_info;
@@ -524,37 +659,91 @@ gint suncalc_timeout_cb (gpointer data)
     return 0;  /* Do not repeat timeout (will be reset by update_finish) */
 }
 
+static void
+get_weather_prefs (MateWeatherApplet *gw_applet, WeatherPrefs *prefs)
+{
+    /* Set preferred forecast type */
+    prefs->type = gw_applet->mateweather_pref.detailed ? FORECAST_ZONE : FORECAST_STATE;
+
+    /* The radar map is fetched by the details dialog itself, off the
+     * main thread, see mateweather-radar.c */
+    prefs->radar = FALSE;
+    prefs->radar_custom_url = NULL;
+
+    /* Set the units */
+    prefs->temperature_unit = gw_applet->mateweather_pref.temperature_unit;
+    prefs->speed_unit = gw_applet->mateweather_pref.speed_unit;
+    prefs->pressure_unit = gw_applet->mateweather_pref.pressure_unit;
+    prefs->distance_unit = gw_applet->mateweather_pref.distance_unit;
+}
+
 void mateweather_update (MateWeatherApplet *gw_applet)
 {
     WeatherPrefs prefs;
+    WeatherCacheEntry *entry;
+    gchar *key;
 
     gtk_widget_set_tooltip_text (GTK_WIDGET(gw_applet->applet),  _("Updating..."));
 
-    /* Set preferred forecast type */
-    prefs.type = gw_applet->mateweather_pref.detailed ? FORECAST_ZONE : FORECAST_STATE;
+    get_weather_prefs (gw_applet, &prefs);
 
-    /* Set radar map retrieval option */
-    prefs.radar = gw_applet->mateweather_pref.radar_enabled;
-    prefs.radar_custom_url = (gw_applet->mateweather_pref.use_custom_radar_url &&
-    				gw_applet->mateweather_pref.radar) ?
-				gw_applet->mateweather_pref.radar : NULL;
+    /* the other applets with the same weather wait for this fetch */
+    key = weather_cache_key (gw_applet->mateweather_pref.location, &prefs);
+    if (g_strcmp0 (key, gw_applet->cache_key) != 0) {
+        weather_cache_forget (gw_applet);
+        gw_applet->cache_key = key;
+    } else {
+        g_free (key);
+    }
 
-    /* Set the units */
-    prefs.temperature_unit = gw_applet->mateweather_pref.temperature_unit;
-    prefs.speed_unit = gw_applet->mateweather_pref.speed_unit;
-    prefs.pressure_unit = gw_applet->mateweather_pref.pressure_unit;
-    prefs.distance_unit = gw_applet->mateweather_pref.distance_unit;
+    entry = weather_cache_lookup (gw_applet->cache_key);
+    entry->waiting = g_slist_remove (entry->waiting, gw_applet);
+    if (entry->fetcher == NULL)
+        entry->fetcher = gw_applet;
 
     /* Update current conditions */
     if (gw_applet->mateweather_info &&
     	weather_location_equal(weather_info_get_location(gw_applet->mateweather_info),
     			       gw_applet->mateweather_pref.location)) {
 	weather_info_update(gw_applet->mateweather_info, &prefs,
-			    update_finish, gw_applet);
+			    fetch_finish, gw_applet);
     } else {
         weather_info_free(gw_applet->mateweather_info);
         gw_applet->mateweather_info = weather_info_new(gw_applet->mateweather_pref.location,
 						    &prefs,
-						    update_finish, gw_applet);
+						    fetch_finish, gw_applet);
+    }
+}
+
+/* An update that takes the weather another applet just fetched, or
+ * waits for the one it is fetching */
+void mateweather_update_cached (MateWeatherApplet *gw_applet)
+{
+    WeatherPrefs prefs;
+    WeatherCacheEntry *entry;
+    gchar *key;
+
+    get_weather_prefs (gw_applet, &prefs);
+    key = weather_cache_key (gw_applet->mateweather_pref.location, &prefs);
+    entry = weather_cache_lookup (key);
+
+    if (entry->info && entry->fetcher != gw_applet &&
+        g_get_monotonic_time () - entry->fetched <
+        (gint64) gw_applet->mateweather_pref.update_interval * G_USEC_PER_SEC / 2) {
+        weather_cache_forget (gw_applet);
+        gw_applet->cache_key = key;
+
+        weather_info_free (gw_applet->mateweather_info);
+        gw_applet->mateweather_info = weather_info_clone (entry->info);
+        update_finish (gw_applet->mateweather_info, gw_applet);
+    } else if (entry->fetcher && entry->fetcher != gw_applet) {
+        weather_cache_forget (gw_applet);
+        gw_applet->cache_key = key;
+
+        gtk_widget_set_tooltip_text (GTK_WIDGET(gw_applet->applet),  _("Updating..."));
+        entry->waiting = g_slist_append (entry->waiting, gw_applet);
+    } else {
+        g_free (key);
+        mateweather_update (gw_applet);
     }
 }
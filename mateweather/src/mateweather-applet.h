@@ -23,6 +23,7 @@ extern void mateweather_applet_create(MateWeatherApplet *gw_applet);
 extern gint timeout_cb (gpointer data);
 extern gint suncalc_timeout_cb (gpointer data);
 extern void mateweather_update (MateWeatherApplet *applet);
+extern void mateweather_update_cached (MateWeatherApplet *applet);
 
 G_END_DECLS
 
@@ -26,6 +26,7 @@
 #include "mateweather-applet.h"
 #include "mateweather-pref.h"
 #include "mateweather-dialog.h"
+#include "mateweather-radar.h"
 
 struct _MateWeatherDialog {
     GtkDialog  parent;
@@ -48,6 +49,12 @@ struct _MateWeatherDialog {
     GtkWidget *forecast_text;
     GtkWidget *radar_image;
 
+    gchar *radar_url;                 /* of the map shown or loading */
+    MateWeatherRadar *radar;
+    guint radar_frame;
+    guint radar_tag;                  /* the next frame */
+    GCancellable *radar_cancellable;  /* while the map loads */
+
     MateWeatherApplet *applet;
 };
 
@@ -58,6 +65,10 @@ enum {
 
 G_DEFINE_TYPE (MateWeatherDialog, mateweather_dialog, GTK_TYPE_DIALOG);
 
+/* the size radar maps are scaled to before the dialog is shown */
+#define RADAR_DEFAULT_WIDTH  520
+#define RADAR_DEFAULT_HEIGHT 340
+
 #define MONOSPACE_FONT_SCHEMA  "org.mate.interface"
 #define MONOSPACE_FONT_KEY     "monospace-font-name"
 
@@ -178,6 +189,128 @@ override_widget_font (GtkWidget            *widget,
     g_free (size);
 }
 
+static void
+radar_stop (MateWeatherDialog *dialog)
+{
+    if (dialog->radar_cancellable) {
+        /* the load finds it cancelled and leaves the dialog alone */
+        g_cancellable_cancel (dialog->radar_cancellable);
+        g_clear_object (&dialog->radar_cancellable);
+    }
+
+    if (dialog->radar_tag)
+        g_source_remove (dialog->radar_tag);
+    dialog->radar_tag = 0;
+
+    g_clear_pointer (&dialog->radar, mateweather_radar_unref);
+}
+
+/* Shows the frame and waits for the next one, the frames are ready */
+static gboolean
+radar_show_frame (gpointer data)
+{
+    MateWeatherDialog *dialog = data;
+    gint delay;
+
+    dialog->radar_tag = 0;
+
+    gtk_image_set_from_pixbuf (GTK_IMAGE (dialog->radar_image),
+                               mateweather_radar_get_frame (dialog->radar,
+                                                            dialog->radar_frame,
+                                                            &delay));
+
+    if (delay >= 0 && mateweather_radar_get_n_frames (dialog->radar) > 1) {
+        dialog->radar_frame = (dialog->radar_frame + 1) %
+                              mateweather_radar_get_n_frames (dialog->radar);
+        dialog->radar_tag = g_timeout_add (MAX (delay, 20), radar_show_frame, dialog);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+radar_loaded (GObject      *source,
+              GAsyncResult *result,
+              gpointer      data)
+{
+    MateWeatherDialog *dialog = data;
+    MateWeatherRadar *radar;
+    GError *error = NULL;
+
+    radar = mateweather_radar_load_finish (result, &error);
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return;
+    }
+
+    g_clear_object (&dialog->radar_cancellable);
+
+    if (!radar) {
+        g_debug ("Failed to load the radar map %s: %s", dialog->radar_url, error->message);
+        g_error_free (error);
+        return;
+    }
+
+    /* the frames from the cache, still fresh: they keep running */
+    if (radar == dialog->radar) {
+        mateweather_radar_unref (radar);
+        return;
+    }
+
+    if (dialog->radar_tag)
+        g_source_remove (dialog->radar_tag);
+    dialog->radar_tag = 0;
+    if (dialog->radar)
+        mateweather_radar_unref (dialog->radar);
+
+    dialog->radar = radar;
+    dialog->radar_frame = 0;
+    radar_show_frame (dialog);
+}
+
+/* Loads the map again once it may have changed, the frames are reused
+ * from the cache until then */
+static void
+radar_update (MateWeatherDialog *dialog)
+{
+    GtkWidget *view;
+    gint width, height;
+    gchar *url;
+
+    url = mateweather_radar_get_url (dialog->applet);
+    if (!url) {
+        radar_stop (dialog);
+        g_clear_pointer (&dialog->radar_url, g_free);
+        return;
+    }
+
+    /* a load of the same map is already on its way */
+    if (dialog->radar_cancellable && g_strcmp0 (url, dialog->radar_url) == 0) {
+        g_free (url);
+        return;
+    }
+
+    if (dialog->radar_cancellable) {
+        g_cancellable_cancel (dialog->radar_cancellable);
+        g_clear_object (&dialog->radar_cancellable);
+    }
+    g_free (dialog->radar_url);
+    dialog->radar_url = url;
+
+    /* the scrolled window around the viewport of the image */
+    view = gtk_widget_get_parent (gtk_widget_get_parent (dialog->radar_image));
+    width = gtk_widget_get_allocated_width (view);
+    height = gtk_widget_get_allocated_height (view);
+    if (!gtk_widget_get_realized (view) || width <= 1 || height <= 1) {
+        width = RADAR_DEFAULT_WIDTH;
+        height = RADAR_DEFAULT_HEIGHT;
+    }
+
+    dialog->radar_cancellable = g_cancellable_new ();
+    mateweather_radar_load_async (url, width, height, dialog->radar_cancellable,
+                                  radar_loaded, dialog);
+}
+
 void
 mateweather_dialog_update (MateWeatherDialog *dialog)
 {
@@ -236,13 +369,8 @@ mateweather_dialog_update (MateWeatherDialog *dialog)
     }
 
     /* Update radar map */
+    radar_update (dialog);
     if (dialog->applet->mateweather_pref.radar_enabled) {
-        GdkPixbufAnimation *radar;
-
-	radar = weather_info_get_radar (info);
-        if (radar) {
-            gtk_image_set_from_animation (GTK_IMAGE (dialog->radar_image), radar);
-        }
         gtk_widget_show (gtk_notebook_get_nth_page (GTK_NOTEBOOK (dialog->weather_notebook), 2));
         gtk_window_set_default_size (GTK_WINDOW (dialog), 570, 440);
     } else {
@@ -293,6 +421,17 @@ mateweather_dialog_get_property (GObject    *object,
     }
 }
 
+static void
+mateweather_dialog_dispose (GObject *object)
+{
+    MateWeatherDialog *dialog = MATEWEATHER_DIALOG (object);
+
+    radar_stop (dialog);
+    g_clear_pointer (&dialog->radar_url, g_free);
+
+    G_OBJECT_CLASS (mateweather_dialog_parent_class)->dispose (object);
+}
+
 static void
 mateweather_dialog_init (MateWeatherDialog *dialog)
 {
@@ -333,6 +472,7 @@ mateweather_dialog_class_init (MateWeatherDialogClass *klass)
     object_class->set_property = mateweather_dialog_set_property;
     object_class->get_property = mateweather_dialog_get_property;
     object_class->constructor = mateweather_dialog_constructor;
+    object_class->dispose = mateweather_dialog_dispose;
 
     /* This becomes an OBJECT property when MateWeatherApplet is redone */
     g_object_class_install_property (object_class,
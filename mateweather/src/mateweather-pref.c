@@ -30,6 +30,7 @@
 #define MATEWEATHER_I_KNOW_THIS_IS_UNSTABLE
 
 #include <libmateweather/mateweather-xml.h>
+#include <libmateweather/mateweather-location.h>
 #include "mateweather.h"
 #include "mateweather-pref.h"
 #include "mateweather-applet.h"
@@ -37,6 +38,13 @@
 
 #define NEVER_SENSITIVE "never_sensitive"
 
+/* the columns of the locations after the ones of mateweather-xml */
+enum {
+	LOCATION_COL_NODE = MATEWEATHER_XML_NUM_COLUMNS, /* MateWeatherLocation */
+	LOCATION_COL_PENDING,                            /* rows below not added yet */
+	LOCATION_NUM_COLUMNS
+};
+
 struct _MateWeatherPrefPrivate {
 	GtkWidget* notebook;
 
@@ -63,6 +71,8 @@ struct _MateWeatherPrefPrivate {
 	GtkWidget* tree;
 
 	GtkTreeModel* model;
+	MateWeatherLocation* world;
+	struct _LocationIndex* index;
 
 	MateWeatherApplet* applet;
 };
@@ -239,30 +249,222 @@ on_row_selected (GtkTreeSelection *selection,
 	mateweather_update(gw_applet);
 }
 
-static gboolean compare_location(GtkTreeModel* model, GtkTreePath* path, GtkTreeIter* iter, gpointer user_data)
+/* The rows of the tree are made from the locations database as they are
+ * needed: a row with locations below it gets a placeholder child, and
+ * the real children are added when it is first expanded.  The world
+ * and the second level divisions get no rows, their locations go to
+ * the row above.  A city with one weather station is the row of that
+ * station. */
+static gboolean location_has_row(MateWeatherLocation* node)
 {
-    MateWeatherPref* pref = user_data;
-    WeatherLocation* loc;
-    GtkTreeView* view;
+	MateWeatherLocation** children;
+	gboolean has_row;
 
-    gtk_tree_model_get(model, iter, MATEWEATHER_XML_COL_POINTER, &loc, -1);
+	switch (mateweather_location_get_level(node))
+	{
+		case MATEWEATHER_LOCATION_WORLD:
+		case MATEWEATHER_LOCATION_ADM2:
+			return FALSE;
+		case MATEWEATHER_LOCATION_WEATHER_STATION:
+			return TRUE;
+		default:
+			children = mateweather_location_get_children(node);
+			has_row = children[0] != NULL;
+			mateweather_location_free_children(node, children);
+			return has_row;
+	}
+}
 
-    if (!loc)
-    {
+/* Whether the locations below the row of a location get rows of
+ * their own */
+static gboolean location_has_child_rows(MateWeatherLocation* node)
+{
+	MateWeatherLocation** children;
+	gboolean has_child_rows;
+
+	if (mateweather_location_get_level(node) == MATEWEATHER_LOCATION_WEATHER_STATION)
 		return FALSE;
+
+	children = mateweather_location_get_children(node);
+	if (mateweather_location_get_level(node) == MATEWEATHER_LOCATION_CITY)
+		has_child_rows = children[0] && children[1];
+	else
+		has_child_rows = children[0] != NULL;
+	mateweather_location_free_children(node, children);
+
+	return has_child_rows;
+}
+
+/* The name of the weather of a station, which is the one of its city */
+static const gchar* station_name(MateWeatherLocation* station)
+{
+	MateWeatherLocation* parent = mateweather_location_get_parent(station);
+
+	if (parent && mateweather_location_get_level(parent) == MATEWEATHER_LOCATION_CITY)
+		return mateweather_location_get_name(parent);
+
+	return mateweather_location_get_name(station);
+}
+
+static void add_location_rows(GtkTreeStore* store, GtkTreeIter* parent, MateWeatherLocation* node);
+
+static void add_location_row(GtkTreeStore* store, GtkTreeIter* parent, MateWeatherLocation* node)
+{
+	GtkTreeIter iter;
+	GtkTreeIter placeholder;
+	WeatherLocation* wloc = NULL;
+	gboolean pending;
+
+	if (!location_has_row(node))
+	{
+		add_location_rows(store, parent, node);
+		return;
 	}
 
-    if (!weather_location_equal(loc, pref->priv->applet->mateweather_pref.location))
-    {
-		return FALSE;
+	pending = location_has_child_rows(node);
+
+	if (mateweather_location_get_level(node) == MATEWEATHER_LOCATION_WEATHER_STATION)
+	{
+		wloc = mateweather_location_to_weather_location(node, station_name(node));
+	}
+	else if (mateweather_location_get_level(node) == MATEWEATHER_LOCATION_CITY && !pending)
+	{
+		MateWeatherLocation** children = mateweather_location_get_children(node);
+
+		wloc = mateweather_location_to_weather_location(children[0], mateweather_location_get_name(node));
+		mateweather_location_free_children(node, children);
 	}
 
-    view = GTK_TREE_VIEW(pref->priv->tree);
-    gtk_tree_view_expand_to_path(view, path);
-    gtk_tree_view_set_cursor(view, path, NULL, FALSE);
-    gtk_tree_view_scroll_to_cell(view, path, NULL, TRUE, 0.5, 0.5);
+	gtk_tree_store_append(store, &iter, parent);
+	gtk_tree_store_set(store, &iter,
+	                   MATEWEATHER_XML_COL_LOC, mateweather_location_get_name(node),
+	                   MATEWEATHER_XML_COL_POINTER, wloc,
+	                   LOCATION_COL_NODE, node,
+	                   LOCATION_COL_PENDING, pending,
+	                   -1);
 
-    return TRUE;
+	if (pending)
+	{
+		gtk_tree_store_append(store, &placeholder, &iter);
+		gtk_tree_store_set(store, &placeholder, MATEWEATHER_XML_COL_LOC, "", -1);
+	}
+}
+
+static void add_location_rows(GtkTreeStore* store, GtkTreeIter* parent, MateWeatherLocation* node)
+{
+	MateWeatherLocation** children = mateweather_location_get_children(node);
+	gint i;
+
+	for (i = 0; children[i]; i++)
+		add_location_row(store, parent, children[i]);
+
+	mateweather_location_free_children(node, children);
+}
+
+/* Replaces the placeholder of a row by the rows below it */
+static void populate_row(GtkTreeStore* store, GtkTreeIter* iter)
+{
+	MateWeatherLocation* node;
+	GtkTreeIter placeholder;
+	gboolean pending;
+
+	gtk_tree_model_get(GTK_TREE_MODEL(store), iter,
+	                   LOCATION_COL_NODE, &node,
+	                   LOCATION_COL_PENDING, &pending,
+	                   -1);
+
+	if (!pending)
+		return;
+
+	if (gtk_tree_model_iter_children(GTK_TREE_MODEL(store), &placeholder, iter))
+		gtk_tree_store_remove(store, &placeholder);
+
+	gtk_tree_store_set(store, iter, LOCATION_COL_PENDING, FALSE, -1);
+	add_location_rows(store, iter, node);
+}
+
+static gboolean on_row_expanding(GtkTreeView* tree, GtkTreeIter* iter, GtkTreePath* path, MateWeatherPref* pref)
+{
+	populate_row(GTK_TREE_STORE(pref->priv->model), iter);
+
+	return FALSE;
+}
+
+/* Adds the rows down to the one of a location, returns FALSE if it has
+ * none.  For the station of a city with one station that is the row of
+ * the city. */
+static gboolean reveal_location(MateWeatherPref* pref, MateWeatherLocation* node, GtkTreeIter* iter)
+{
+	GtkTreeModel* model = pref->priv->model;
+	GSList* chain = NULL;
+	GSList* l;
+	gboolean found = FALSE;
+
+	for (; node; node = mateweather_location_get_parent(node))
+	{
+		if (location_has_row(node))
+			chain = g_slist_prepend(chain, node);
+	}
+
+	for (l = chain; l; l = l->next)
+	{
+		GtkTreeIter child;
+		gboolean valid;
+
+		if (found)
+		{
+			populate_row(GTK_TREE_STORE(model), iter);
+			valid = gtk_tree_model_iter_children(model, &child, iter);
+		}
+		else
+		{
+			valid = gtk_tree_model_get_iter_first(model, &child);
+		}
+
+		for (; valid; valid = gtk_tree_model_iter_next(model, &child))
+		{
+			MateWeatherLocation* row_node;
+
+			gtk_tree_model_get(model, &child, LOCATION_COL_NODE, &row_node, -1);
+			if (row_node == l->data)
+				break;
+		}
+
+		if (!valid)
+			break;
+
+		*iter = child;
+		found = TRUE;
+	}
+
+	g_slist_free(chain);
+
+	return found;
+}
+
+/* The weather station of a location, searched in the database rather
+ * than in the tree that only has the rows that were looked at */
+static MateWeatherLocation* find_station(MateWeatherLocation* node, WeatherLocation* loc)
+{
+	MateWeatherLocation** children;
+	MateWeatherLocation* station = NULL;
+	gint i;
+
+	if (mateweather_location_get_level(node) == MATEWEATHER_LOCATION_WEATHER_STATION)
+	{
+		if (g_strcmp0(mateweather_location_get_code(node), loc->code) == 0 &&
+		    g_strcmp0(station_name(node), loc->name) == 0)
+			return node;
+
+		return NULL;
+	}
+
+	children = mateweather_location_get_children(node);
+	for (i = 0; children[i] && !station; i++)
+		station = find_station(children[i], loc);
+	mateweather_location_free_children(node, children);
+
+	return station;
 }
 
 static void load_locations(MateWeatherPref* pref)
@@ -270,6 +472,7 @@ static void load_locations(MateWeatherPref* pref)
 	GtkTreeView* tree = GTK_TREE_VIEW(pref->priv->tree);
 	GtkTreeViewColumn* column;
 	GtkCellRenderer* cell_renderer;
+	WeatherLocation* current = pref->priv->applet->mateweather_pref.location;
 
 	/* Add a column for the locations */
 	cell_renderer = gtk_cell_renderer_text_new();
@@ -278,21 +481,41 @@ static void load_locations(MateWeatherPref* pref)
 	gtk_tree_view_set_expander_column(GTK_TREE_VIEW(tree), column);
 
 	/* load locations from xml file */
-	pref->priv->model = mateweather_xml_load_locations();
+	pref->priv->world = mateweather_location_new_world(FALSE);
 
-	if (!pref->priv->model)
+	if (!pref->priv->world)
 	{
 		GtkWidget* d = gtk_message_dialog_new(NULL, 0, GTK_MESSAGE_ERROR, GTK_BUTTONS_OK, _("Failed to load the Locations XML database.  Please report this as a bug."));
 		gtk_dialog_run(GTK_DIALOG(d));
 		gtk_widget_destroy(d);
+		return;
 	}
 
+	pref->priv->model = GTK_TREE_MODEL(gtk_tree_store_new(LOCATION_NUM_COLUMNS,
+	                                                      G_TYPE_STRING,
+	                                                      G_TYPE_POINTER,
+	                                                      G_TYPE_POINTER,
+	                                                      G_TYPE_BOOLEAN));
+	add_location_rows(GTK_TREE_STORE(pref->priv->model), NULL, pref->priv->world);
+
 	gtk_tree_view_set_model (tree, pref->priv->model);
+	g_signal_connect (tree, "test-expand-row", G_CALLBACK (on_row_expanding), pref);
 
-	if (pref->priv->applet->mateweather_pref.location)
+	if (current && current->code)
 	{
 		/* Select the current (default) location */
-		gtk_tree_model_foreach(GTK_TREE_MODEL(pref->priv->model), compare_location, pref);
+		MateWeatherLocation* station = find_station(pref->priv->world, current);
+		GtkTreeIter iter;
+
+		if (station && reveal_location(pref, station, &iter))
+		{
+			GtkTreePath* path = gtk_tree_model_get_path(pref->priv->model, &iter);
+
+			gtk_tree_view_expand_to_path(tree, path);
+			gtk_tree_view_set_cursor(tree, path, NULL, FALSE);
+			gtk_tree_view_scroll_to_cell(tree, path, NULL, TRUE, 0.5, 0.5);
+			gtk_tree_path_free(path);
+		}
 	}
 }
 
@@ -659,6 +882,199 @@ static gboolean find_location(GtkTreeModel* model, GtkTreeIter* iter, const gcha
 	return FALSE;
 }
 
+/* The names of the locations, for finding them as they are typed.  The
+ * locations that have rows are kept in the order of the tree, including
+ * the ones whose rows are not added yet, and sorted by their folded
+ * names in a worker thread after the dialog opens.  Until the index is
+ * there the rows that were added are searched one by one. */
+typedef struct {
+	gchar* name;        /* folded */
+	MateWeatherLocation* node;
+} LocationRow;
+
+typedef struct _LocationIndex {
+	LocationRow* rows;
+	guint* sorted;      /* rows by name */
+	guint n_rows;
+	GHashTable* rows_by_node; /* node -> row + 1 */
+} LocationIndex;
+
+static void location_index_free(LocationIndex* index)
+{
+	guint i;
+
+	if (!index)
+		return;
+
+	for (i = 0; i < index->n_rows; i++)
+		g_free(index->rows[i].name);
+
+	g_hash_table_destroy(index->rows_by_node);
+	g_free(index->rows);
+	g_free(index->sorted);
+	g_free(index);
+}
+
+static gint compare_rows(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	LocationIndex* index = user_data;
+	guint row_a = *(const guint*) a;
+	guint row_b = *(const guint*) b;
+	gint result = strcmp(index->rows[row_a].name, index->rows[row_b].name);
+
+	/* the same names stay in the order of the tree */
+	if (result == 0)
+		result = row_a < row_b ? -1 : 1;
+
+	return result;
+}
+
+static void build_location_index(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	LocationIndex* index = task_data;
+	guint i;
+
+	index->sorted = g_new(guint, index->n_rows);
+
+	for (i = 0; i < index->n_rows; i++)
+	{
+		gchar* folded = g_ascii_strdown(index->rows[i].name, -1);
+
+		g_free(index->rows[i].name);
+		index->rows[i].name = folded;
+		index->sorted[i] = i;
+	}
+
+	g_qsort_with_data(index->sorted, (gint) index->n_rows, sizeof(guint), compare_rows, index);
+
+	g_task_return_pointer(task, index, (GDestroyNotify) location_index_free);
+}
+
+static void location_index_built(GObject* source_object, GAsyncResult* result, gpointer user_data)
+{
+	MateWeatherPref* pref = MATEWEATHER_PREF(source_object);
+
+	pref->priv->index = g_task_propagate_pointer(G_TASK(result), NULL);
+}
+
+static void collect_rows(GArray* rows, MateWeatherLocation* node)
+{
+	MateWeatherLocation** children = mateweather_location_get_children(node);
+	gint i;
+
+	for (i = 0; children[i]; i++)
+	{
+		if (location_has_row(children[i]))
+		{
+			LocationRow row;
+
+			row.name = g_strdup(mateweather_location_get_name(children[i]));
+			row.node = children[i];
+			g_array_append_val(rows, row);
+
+			if (location_has_child_rows(children[i]))
+				collect_rows(rows, children[i]);
+		}
+		else
+		{
+			collect_rows(rows, children[i]);
+		}
+	}
+
+	mateweather_location_free_children(node, children);
+}
+
+/* Only the names are copied from the database here, the worker thread
+ * does not touch it */
+static void start_location_index(MateWeatherPref* pref)
+{
+	LocationIndex* index;
+	GArray* rows;
+	GTask* task;
+	guint i;
+
+	if (!pref->priv->world)
+		return;
+
+	rows = g_array_new(FALSE, FALSE, sizeof(LocationRow));
+	collect_rows(rows, pref->priv->world);
+
+	index = g_new0(LocationIndex, 1);
+	index->n_rows = rows->len;
+	index->rows = (LocationRow*) g_array_free(rows, FALSE);
+	index->rows_by_node = g_hash_table_new(NULL, NULL);
+	for (i = 0; i < index->n_rows; i++)
+		g_hash_table_insert(index->rows_by_node, index->rows[i].node, GUINT_TO_POINTER(i + 1));
+
+	/* the task keeps the dialog until the index is built */
+	task = g_task_new(pref, NULL, location_index_built, NULL);
+	g_task_set_task_data(task, index, NULL);
+	g_task_run_in_thread(task, build_location_index);
+	g_object_unref(task);
+}
+
+/* Returns the first row after the given one in the order of the tree
+ * whose name starts with the text, wrapping around, or -1 */
+static gint location_index_find(LocationIndex* index, const gchar* text, gint after)
+{
+	gchar* prefix = g_ascii_strdown(text, -1);
+	size_t len = strlen(prefix);
+	guint low = 0, high = index->n_rows;
+	gint first = -1, next = -1;
+
+	/* the names starting with the prefix sort right from it */
+	while (low < high)
+	{
+		guint middle = low + (high - low) / 2;
+
+		if (strcmp(index->rows[index->sorted[middle]].name, prefix) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (; low < index->n_rows && strncmp(index->rows[index->sorted[low]].name, prefix, len) == 0; low++)
+	{
+		gint row = (gint) index->sorted[low];
+
+		if (first < 0 || row < first)
+			first = row;
+		if (row > after && (next < 0 || row < next))
+			next = row;
+	}
+
+	g_free(prefix);
+
+	return next >= 0 ? next : first;
+}
+
+static void
+select_found_location (MateWeatherPref *pref,
+                       GtkTreePath     *path)
+{
+	GtkTreeView *tree = GTK_TREE_VIEW (pref->priv->tree);
+
+	gtk_widget_set_sensitive (pref->priv->find_next_btn, TRUE);
+
+	gtk_tree_view_expand_to_path (tree, path);
+	gtk_tree_selection_select_path (gtk_tree_view_get_selection (tree), path);
+	gtk_tree_view_scroll_to_cell (tree, path, NULL, TRUE, 0.5, 0);
+}
+
+/* Adds the rows down to a location that was found and selects it */
+static void select_found_node(MateWeatherPref* pref, MateWeatherLocation* node)
+{
+	GtkTreeIter iter;
+	GtkTreePath* path;
+
+	if (!reveal_location(pref, node, &iter))
+		return;
+
+	path = gtk_tree_model_get_path(pref->priv->model, &iter);
+	select_found_location(pref, path);
+	gtk_tree_path_free(path);
+}
+
 static void
 on_find_next_clicked (GtkButton       *button,
                       MateWeatherPref *pref)
@@ -677,6 +1093,28 @@ on_find_next_clicked (GtkButton       *button,
 	entry = GTK_ENTRY (pref->priv->find_entry);
 
 	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (tree));
+	location = gtk_entry_get_text (entry);
+
+	if (pref->priv->index)
+	{
+		gint after = -1;
+		gint row;
+
+		if (gtk_tree_selection_get_selected (selection, &model, &iter))
+		{
+			MateWeatherLocation *node;
+
+			gtk_tree_model_get (model, &iter, LOCATION_COL_NODE, &node, -1);
+			after = GPOINTER_TO_INT (g_hash_table_lookup (pref->priv->index->rows_by_node, node)) - 1;
+		}
+
+		if (*location && (row = location_index_find (pref->priv->index, location, after)) >= 0)
+			select_found_node (pref, pref->priv->index->rows[row].node);
+		else
+			gtk_widget_set_sensitive (pref->priv->find_next_btn, FALSE);
+
+		return;
+	}
 
 	if (gtk_tree_selection_count_selected_rows (selection) >= 1)
 	{
@@ -698,17 +1136,10 @@ on_find_next_clicked (GtkButton       *button,
 		gtk_tree_model_get_iter_first (model, &iter);
 	}
 
-	location = gtk_entry_get_text (entry);
-
 	if (find_location (model, &iter, location, TRUE))
 	{
-		gtk_widget_set_sensitive (pref->priv->find_next_btn, TRUE);
-
 		path = gtk_tree_model_get_path (model, &iter);
-		gtk_tree_view_expand_to_path (tree, path);
-		gtk_tree_selection_select_path (selection, path);
-		gtk_tree_view_scroll_to_cell (tree, path, NULL, TRUE, 0.5, 0);
-
+		select_found_location (pref, path);
 		gtk_tree_path_free (path);
 	}
 	else
@@ -723,30 +1154,34 @@ find_entry_changed (GtkEditable     *entry,
 {
 	GtkTreeView *tree;
 	GtkTreeModel *model;
-	GtkTreeSelection *selection;
 	GtkTreeIter iter;
 	GtkTreePath *path;
 	const gchar *location;
+	gint row;
 
 	tree = GTK_TREE_VIEW (pref->priv->tree);
 	model = gtk_tree_view_get_model (tree);
 
 	g_return_if_fail (model != NULL);
 
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (tree));
-	gtk_tree_model_get_iter_first (model, &iter);
-
 	location = gtk_entry_get_text (GTK_ENTRY (entry));
 
-	if (find_location (model, &iter, location, TRUE))
+	if (pref->priv->index)
 	{
-		gtk_widget_set_sensitive (pref->priv->find_next_btn, TRUE);
+		if (*location && (row = location_index_find (pref->priv->index, location, -1)) >= 0)
+			select_found_node (pref, pref->priv->index->rows[row].node);
+		else
+			gtk_widget_set_sensitive (pref->priv->find_next_btn, FALSE);
 
-		path = gtk_tree_model_get_path (model, &iter);
-		gtk_tree_view_expand_to_path (tree, path);
-		gtk_tree_selection_select_iter (selection, &iter);
-		gtk_tree_view_scroll_to_cell (tree, path, NULL, TRUE, 0.5, 0);
+		return;
+	}
 
+	gtk_tree_model_get_iter_first (model, &iter);
+
+	if (find_location (model, &iter, location, TRUE))
+	{
+		path = gtk_tree_model_get_path (model, &iter);
+		select_found_location (pref, path);
 		gtk_tree_path_free (path);
 	}
 	else
@@ -1128,6 +1563,7 @@ mateweather_pref_create (MateWeatherPref* pref)
 	gtk_widget_show (scrolled_window);
 	gtk_box_pack_start (GTK_BOX (pref_loc_hbox), scrolled_window, TRUE, TRUE, 0);
 	load_locations(pref);
+	start_location_index(pref);
 
 	pref_find_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
 	pref_find_label = gtk_label_new (_("_Find:"));
@@ -1246,8 +1682,16 @@ static void mateweather_pref_finalize(GObject* object)
 {
 	MateWeatherPref* self = MATEWEATHER_PREF(object);
 
-	gtk_tree_model_foreach(self->priv->model, free_data, NULL);
-	g_object_unref(G_OBJECT(self->priv->model));
+	location_index_free(self->priv->index);
+
+	if (self->priv->model)
+	{
+		gtk_tree_model_foreach(self->priv->model, free_data, NULL);
+		g_object_unref(G_OBJECT(self->priv->model));
+	}
+
+	if (self->priv->world)
+		mateweather_location_unref(self->priv->world);
 
 	G_OBJECT_CLASS(mateweather_pref_parent_class)->finalize(object);
 }
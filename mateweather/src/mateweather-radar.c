@@ -0,0 +1,387 @@
+/*
+ *  This code released under the GNU GPL.
+ *  Read the file COPYING for more information.
+ *
+ *  Radar maps for the details dialog
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#define MATEWEATHER_I_KNOW_THIS_IS_UNSTABLE
+
+#include "mateweather.h"
+#include "mateweather-radar.h"
+
+/* animations that never loop back are cut there */
+#define RADAR_MAX_FRAMES 64
+
+struct _MateWeatherRadar {
+    gint       ref_count;
+    GPtrArray *frames;      /* GdkPixbufs */
+    GArray    *delays;      /* gint milliseconds */
+    gint64     loaded;      /* monotonic, in seconds */
+};
+
+typedef struct {
+    gchar *url;
+    gchar *cache_path;
+    gchar *key;
+    gint   width;
+    gint   height;
+} RadarRequest;
+
+/* the prepared frames, by url and size, shared by the dialogs of all the
+ * applets in the process */
+static GHashTable *radar_cache = NULL;
+
+gchar *
+mateweather_radar_get_url (MateWeatherApplet *applet)
+{
+    MateWeatherPrefs *pref = &applet->mateweather_pref;
+    WeatherLocation *location = pref->location;
+
+    if (!pref->radar_enabled)
+        return NULL;
+
+    if (pref->use_custom_radar_url && pref->radar && pref->radar[0] != '\0')
+        return g_strdup (pref->radar);
+
+    /* the map libmateweather would fetch, none for "-" */
+    if (!location || !location->radar ||
+        location->radar[0] == '\0' || location->radar[0] == '-')
+        return NULL;
+
+    return g_strdup_printf ("http://image.weather.com/web/radar/us_%s_closeradar_medium_usen.jpg",
+                            location->radar);
+}
+
+static MateWeatherRadar *
+radar_new (void)
+{
+    MateWeatherRadar *radar;
+
+    radar = g_new0 (MateWeatherRadar, 1);
+    radar->ref_count = 1;
+    radar->frames = g_ptr_array_new_with_free_func (g_object_unref);
+    radar->delays = g_array_new (FALSE, FALSE, sizeof (gint));
+    radar->loaded = g_get_monotonic_time () / G_USEC_PER_SEC;
+
+    return radar;
+}
+
+MateWeatherRadar *
+mateweather_radar_ref (MateWeatherRadar *radar)
+{
+    g_atomic_int_inc (&radar->ref_count);
+
+    return radar;
+}
+
+void
+mateweather_radar_unref (MateWeatherRadar *radar)
+{
+    if (!g_atomic_int_dec_and_test (&radar->ref_count))
+        return;
+
+    g_ptr_array_unref (radar->frames);
+    g_array_unref (radar->delays);
+    g_free (radar);
+}
+
+guint
+mateweather_radar_get_n_frames (MateWeatherRadar *radar)
+{
+    return radar->frames->len;
+}
+
+GdkPixbuf *
+mateweather_radar_get_frame (MateWeatherRadar *radar,
+                             guint             i,
+                             gint             *delay)
+{
+    if (delay)
+        *delay = g_array_index (radar->delays, gint, i);
+
+    return g_ptr_array_index (radar->frames, i);
+}
+
+static void
+radar_request_free (RadarRequest *request)
+{
+    g_free (request->url);
+    g_free (request->cache_path);
+    g_free (request->key);
+    g_free (request);
+}
+
+/* =============== worker thread code begins here =============== */
+/* The download of the url, if it is recent enough */
+static GBytes *
+radar_read_cache (const gchar *path)
+{
+    GStatBuf buf;
+    gchar *contents;
+    gsize length;
+
+    if (g_stat (path, &buf) != 0 ||
+        g_get_real_time () / G_USEC_PER_SEC - buf.st_mtime >= MATEWEATHER_RADAR_TTL)
+        return NULL;
+
+    if (!g_file_get_contents (path, &contents, &length, NULL))
+        return NULL;
+
+    return g_bytes_new_take (contents, length);
+}
+
+static void
+radar_write_cache (const gchar *path,
+                   GBytes      *bytes)
+{
+    gchar *dir = g_path_get_dirname (path);
+    gsize length;
+    gconstpointer data = g_bytes_get_data (bytes, &length);
+
+    /* only a speedup, a download that can not be kept is not an error */
+    if (g_mkdir_with_parents (dir, 0700) == 0)
+        g_file_set_contents (path, data, (gssize) length, NULL);
+    g_free (dir);
+}
+
+/* The frame fitted into the size it is shown at, never made larger */
+static GdkPixbuf *
+radar_scale_frame (GdkPixbuf *pixbuf,
+                   gint       width,
+                   gint       height)
+{
+    gint frame_width = gdk_pixbuf_get_width (pixbuf);
+    gint frame_height = gdk_pixbuf_get_height (pixbuf);
+    gdouble scale;
+
+    scale = MIN ((gdouble) width / frame_width, (gdouble) height / frame_height);
+    if (scale >= 1.0)
+        return gdk_pixbuf_copy (pixbuf);
+
+    return gdk_pixbuf_scale_simple (pixbuf,
+                                    MAX (1, (gint) (frame_width * scale)),
+                                    MAX (1, (gint) (frame_height * scale)),
+                                    GDK_INTERP_BILINEAR);
+}
+
+/* Whether the animation is back at its first frame.  The loaders may
+ * draw every frame into the same pixbuf, so the pixels are compared. */
+static gboolean
+radar_same_frame (GdkPixbuf *a,
+                  GdkPixbuf *b)
+{
+    return gdk_pixbuf_get_width (a) == gdk_pixbuf_get_width (b) &&
+           gdk_pixbuf_get_height (a) == gdk_pixbuf_get_height (b) &&
+           gdk_pixbuf_get_byte_length (a) == gdk_pixbuf_get_byte_length (b) &&
+           memcmp (gdk_pixbuf_read_pixels (a), gdk_pixbuf_read_pixels (b),
+                   gdk_pixbuf_get_byte_length (a)) == 0;
+}
+
+/* Steps through the animation once, until it comes back to its first
+ * frame */
+static void
+radar_add_frames (MateWeatherRadar   *radar,
+                  GdkPixbufAnimation *animation,
+                  gint                width,
+                  gint                height)
+{
+    GdkPixbufAnimationIter *iter;
+    GdkPixbuf *first = NULL;
+    GTimeVal time = { 0, 0 };
+    guint i;
+
+    if (gdk_pixbuf_animation_is_static_image (animation)) {
+        gint delay = -1;
+
+        g_ptr_array_add (radar->frames,
+                         radar_scale_frame (gdk_pixbuf_animation_get_static_image (animation),
+                                            width, height));
+        g_array_append_val (radar->delays, delay);
+        return;
+    }
+
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+    iter = gdk_pixbuf_animation_get_iter (animation, &time);
+
+    for (i = 0; i < RADAR_MAX_FRAMES; i++) {
+        GdkPixbuf *pixbuf = gdk_pixbuf_animation_iter_get_pixbuf (iter);
+        gint delay = gdk_pixbuf_animation_iter_get_delay_time (iter);
+
+        if (!first)
+            first = gdk_pixbuf_copy (pixbuf);
+        else if (radar_same_frame (pixbuf, first))
+            break;
+
+        g_ptr_array_add (radar->frames, radar_scale_frame (pixbuf, width, height));
+        g_array_append_val (radar->delays, delay);
+
+        if (delay < 0)
+            break;
+        g_time_val_add (&time, (glong) delay * 1000);
+        gdk_pixbuf_animation_iter_advance (iter, &time);
+    }
+    G_GNUC_END_IGNORE_DEPRECATIONS
+
+    g_object_unref (iter);
+    if (first)
+        g_object_unref (first);
+}
+
+static void
+radar_load_thread (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+    RadarRequest *request = task_data;
+    GdkPixbufAnimation *animation;
+    MateWeatherRadar *radar;
+    GInputStream *stream;
+    GError *error = NULL;
+    GBytes *bytes;
+
+    bytes = radar_read_cache (request->cache_path);
+    if (!bytes) {
+        GFile *file = g_file_new_for_uri (request->url);
+        gchar *contents;
+        gsize length;
+
+        /* http through GVfs, in this thread */
+        if (!g_file_load_contents (file, cancellable, &contents, &length, NULL, &error)) {
+            g_object_unref (file);
+            g_task_return_error (task, error);
+            return;
+        }
+        g_object_unref (file);
+
+        bytes = g_bytes_new_take (contents, length);
+        radar_write_cache (request->cache_path, bytes);
+    }
+
+    stream = g_memory_input_stream_new_from_bytes (bytes);
+    animation = gdk_pixbuf_animation_new_from_stream (stream, cancellable, &error);
+    g_object_unref (stream);
+    g_bytes_unref (bytes);
+
+    if (!animation) {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    radar = radar_new ();
+    radar_add_frames (radar, animation, request->width, request->height);
+    g_object_unref (animation);
+
+    g_task_return_pointer (task, radar, (GDestroyNotify) mateweather_radar_unref);
+}
+/* ================ worker thread code ends here ================ */
+
+/* Whether the frames of key are stale once the frames of url were
+ * loaded: expired, or of the same url at another size, from before the
+ * dialog was resized */
+static gboolean
+radar_cache_is_stale (gpointer key,
+                      gpointer value,
+                      gpointer user_data)
+{
+    MateWeatherRadar *radar = value;
+    const gchar *url = user_data;
+    const gchar *key_url = strchr (key, ' ');
+
+    if (g_get_monotonic_time () / G_USEC_PER_SEC - radar->loaded >= MATEWEATHER_RADAR_TTL)
+        return TRUE;
+
+    return key_url && strcmp (key_url + 1, url) == 0;
+}
+
+static void
+radar_load_done (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+    GTask *task = user_data;
+    RadarRequest *request = g_task_get_task_data (G_TASK (result));
+    MateWeatherRadar *radar;
+    GError *error = NULL;
+
+    radar = g_task_propagate_pointer (G_TASK (result), &error);
+    if (!radar) {
+        g_task_return_error (task, error);
+        g_object_unref (task);
+        return;
+    }
+
+    if (!radar_cache)
+        radar_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) mateweather_radar_unref);
+    g_hash_table_foreach_remove (radar_cache, radar_cache_is_stale, request->url);
+    g_hash_table_replace (radar_cache, g_strdup (request->key),
+                          mateweather_radar_ref (radar));
+
+    g_task_return_pointer (task, radar, (GDestroyNotify) mateweather_radar_unref);
+    g_object_unref (task);
+}
+
+void
+mateweather_radar_load_async (const gchar         *url,
+                              gint                 width,
+                              gint                 height,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+    RadarRequest *request;
+    MateWeatherRadar *radar;
+    GTask *task, *thread_task;
+    gchar *checksum, *name;
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+
+    request = g_new0 (RadarRequest, 1);
+    request->url = g_strdup (url);
+    request->width = width;
+    request->height = height;
+    request->key = g_strdup_printf ("%dx%d %s", width, height, url);
+
+    radar = radar_cache ? g_hash_table_lookup (radar_cache, request->key) : NULL;
+    if (radar &&
+        g_get_monotonic_time () / G_USEC_PER_SEC - radar->loaded < MATEWEATHER_RADAR_TTL) {
+        radar_request_free (request);
+        g_task_return_pointer (task, mateweather_radar_ref (radar),
+                               (GDestroyNotify) mateweather_radar_unref);
+        g_object_unref (task);
+        return;
+    }
+
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, url, -1);
+    name = g_strconcat ("radar-", checksum, NULL);
+    request->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                            "mate-applets", "mateweather",
+                                            name, NULL);
+    g_free (name);
+    g_free (checksum);
+
+    /* the frames are cached on the way back, in the main thread */
+    thread_task = g_task_new (NULL, cancellable, radar_load_done, task);
+    g_task_set_task_data (thread_task, request, (GDestroyNotify) radar_request_free);
+    g_task_run_in_thread (thread_task, radar_load_thread);
+    g_object_unref (thread_task);
+}
+
+MateWeatherRadar *
+mateweather_radar_load_finish (GAsyncResult  *result,
+                               GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,54 @@
+#ifndef __MATEWEATHER_RADAR_H_
+#define __MATEWEATHER_RADAR_H_
+
+/*
+ *  This code released under the GNU GPL.
+ *  Read the file COPYING for more information.
+ *
+ *  Radar maps for the details dialog
+ *
+ */
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#define MATEWEATHER_I_KNOW_THIS_IS_UNSTABLE
+
+#include "mateweather.h"
+
+G_BEGIN_DECLS
+
+/* The frames of a radar map, downloaded, decoded and scaled to the size
+ * they are shown at in a thread, so the dialog only swaps pixbufs.
+ *
+ * The downloads are kept in the cache directory and the prepared frames
+ * in memory, both for MATEWEATHER_RADAR_TTL seconds, so opening the
+ * dialog again or another applet with the same map costs nothing. */
+#define MATEWEATHER_RADAR_TTL (10 * 60)
+
+typedef struct _MateWeatherRadar MateWeatherRadar;
+
+/* The map of the location or the custom one, NULL if there is none or
+ * the map is off */
+gchar            *mateweather_radar_get_url      (MateWeatherApplet   *applet);
+
+void              mateweather_radar_load_async   (const gchar         *url,
+                                                  gint                 width,
+                                                  gint                 height,
+                                                  GCancellable        *cancellable,
+                                                  GAsyncReadyCallback  callback,
+                                                  gpointer             user_data);
+MateWeatherRadar *mateweather_radar_load_finish  (GAsyncResult        *result,
+                                                  GError             **error);
+
+MateWeatherRadar *mateweather_radar_ref          (MateWeatherRadar    *radar);
+void              mateweather_radar_unref        (MateWeatherRadar    *radar);
+
+guint             mateweather_radar_get_n_frames (MateWeatherRadar    *radar);
+/* The frame, and how long it is shown in milliseconds, -1 for ever */
+GdkPixbuf        *mateweather_radar_get_frame    (MateWeatherRadar    *radar,
+                                                  guint                i,
+                                                  gint                *delay);
+
+G_END_DECLS
+
+#endif /* __MATEWEATHER_RADAR_H_ */
@@ -46,6 +46,9 @@ typedef struct _MateWeatherApplet {
 
 	/* dialog stuff */
 	GtkWidget* details_dialog;
+
+	/* the weather cache entry of the last update */
+	gchar* cache_key;
 } MateWeatherApplet;
 
 G_END_DECLS
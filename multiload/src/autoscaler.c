@@ -2,52 +2,85 @@
 
 #include "autoscaler.h"
 
-/* i wish i could have used C99 initializers instead of writing this function */
+void
+window_max_init (WindowMax *window,
+                 gsize      size)
+{
+    window->size = MAX (size, 1);
+    window->values = g_new (guint64, window->size);
+    window->numbers = g_new (guint64, window->size);
+    window->first = 0;
+    window->length = 0;
+    window->count = 0;
+}
+
+void
+window_max_clear (WindowMax *window)
+{
+    g_clear_pointer (&window->values, g_free);
+    g_clear_pointer (&window->numbers, g_free);
+    window->size = 0;
+    window->length = 0;
+}
+
+void
+window_max_push (WindowMax *window,
+                 guint64    value)
+{
+    gsize last;
+
+    if (window->values == NULL)
+        return;
+
+    /* the front scrolled out of the window */
+    if (window->length > 0 &&
+        window->numbers [window->first] + window->size <= window->count)
+    {
+        window->first = (window->first + 1) % window->size;
+        window->length--;
+    }
+
+    /* smaller values before this one can never be the maximum again */
+    while (window->length > 0)
+    {
+        last = (window->first + window->length - 1) % window->size;
+        if (window->values [last] > value)
+            break;
+        window->length--;
+    }
+
+    last = (window->first + window->length) % window->size;
+    window->values [last] = value;
+    window->numbers [last] = window->count++;
+    window->length++;
+}
+
+guint64
+window_max_get (const WindowMax *window)
+{
+    return window->length > 0 ? window->values [window->first] : 0;
+}
+
 void
 autoscaler_init (AutoScaler *that,
-                 gint64      interval,
+                 gsize       window,
                  guint64     floor)
 {
-    that->update_interval = interval;
+    window_max_init (&that->peak, window);
     that->floor = floor;
-    that->max = 0;
-    that->count = 0;
-    that->last_update = 0;
-    that->sum = 0;
-    that->last_average = 0.0f;
+}
+
+void
+autoscaler_clear (AutoScaler *that)
+{
+    window_max_clear (&that->peak);
 }
 
 guint64
 autoscaler_get_max (AutoScaler *that,
                     guint64     current)
 {
-    gint64 now;
-
-    that->sum += current;
-    that->count++;
-    now = g_get_monotonic_time ();
-
-    if ((now - that->last_update) > that->update_interval)
-    {
-        float new_average = (float) that->sum / (float) that->count;
-        float average;
-
-        if (new_average < that->last_average)
-            average = ((that->last_average * 0.5f) + new_average) / 1.5f;
-        else
-            average = new_average;
-
-        that->max = (guint64) (average * 1.2f);
-        that->sum = 0;
-        that->count = 0;
-        that->last_update = now;
-        that->last_average = average;
-    }
+    window_max_push (&that->peak, current);
 
-    that->max = MAX(that->max, current);
-    that->max = MAX(that->max, that->floor);
-#if 0
-    printf("%p max = %u, current = %u, last_average = %f\n", that, that->max, current, that->last_average);
-#endif
-    return that->max;
+    return MAX (window_max_get (&that->peak), that->floor);
 }
@@ -3,20 +3,38 @@
 
 #include <glib.h>
 
+typedef struct _WindowMax  WindowMax;
 typedef struct _AutoScaler AutoScaler;
 
+/* The maximum of the last size values pushed, kept as a deque of the
+ * values that can still become the maximum: each one is larger than all
+ * the values pushed after it. Pushing is O(1) amortized, as every value
+ * enters and leaves the deque once, and the maximum is at its front. */
+struct _WindowMax
+{
+    gsize    size;
+    guint64 *values;    /* ring of size entries */
+    guint64 *numbers;   /* the sample number of each value */
+    gsize    first;
+    gsize    length;
+    guint64  count;     /* values pushed so far */
+};
+
+/* Scales a graph to the largest sample of the last window samples */
 struct _AutoScaler
 {
-    gint64 update_interval;
-    gint64 last_update;
-    guint64 floor;
-    guint64 max;
-    guint64 count;
-    guint64 sum;
-    float last_average;
+    WindowMax peak;
+    guint64   floor;
 };
 
-G_GNUC_INTERNAL void    autoscaler_init    (AutoScaler *that, gint64  interval, guint64 floor);
+G_GNUC_INTERNAL void    window_max_init    (WindowMax *window, gsize size);
+G_GNUC_INTERNAL void    window_max_clear   (WindowMax *window);
+G_GNUC_INTERNAL void    window_max_push    (WindowMax *window, guint64 value);
+/* 0 until a value is pushed */
+G_GNUC_INTERNAL guint64 window_max_get     (const WindowMax *window);
+
+G_GNUC_INTERNAL void    autoscaler_init    (AutoScaler *that, gsize window, guint64 floor);
+G_GNUC_INTERNAL void    autoscaler_clear   (AutoScaler *that);
 G_GNUC_INTERNAL guint64 autoscaler_get_max (AutoScaler *that, guint64 current);
 
 #endif /* MATE_APPLETS_MULTILOAD_AUTOSCALER_H */
@@ -0,0 +1,265 @@
+/* cgroup v2 counters of a few systemd units, see
+ * Documentation/admin-guide/cgroup-v2.rst in the kernel.
+ *
+ * Unlike summing the processes of a unit, the kernel keeps these
+ * counters per cgroup, so a sample reads three small files per cgroup.
+ */
+#include <config.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "common/sampler-file.h"
+
+#include "cgroup.h"
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+
+/* how often a cgroup that is not there is looked for again, in µs */
+#define CGROUP_RETRY_INTERVAL (10 * G_USEC_PER_SEC)
+
+typedef enum {
+    CGROUP_FILE_CPU = 0,
+    CGROUP_FILE_MEMORY,
+    CGROUP_FILE_IO,
+    CGROUP_FILE_N
+} CgroupFile;
+
+static const gchar *cgroup_file_names [CGROUP_FILE_N] = {
+    [CGROUP_FILE_CPU]    = "cpu.stat",
+    [CGROUP_FILE_MEMORY] = "memory.current",
+    [CGROUP_FILE_IO]     = "io.stat",
+};
+
+typedef struct
+{
+    gchar       *name;
+    gchar       *paths [CGROUP_FILE_N];
+    SamplerFile  files [CGROUP_FILE_N];
+
+    /* the counters of the previous sample */
+    gboolean     seen;
+    guint64      cpu;
+    guint64      read;
+    guint64      write;
+} Cgroup;
+
+struct _CgroupSampler
+{
+    Cgroup  cgroups [CGROUP_MAX];
+    guint   n;
+    gint64  last_time;
+    gint64  last_retry;
+};
+
+gchar *
+cgroup_path_for_unit (const gchar *unit)
+{
+    GString *path;
+    const gchar *dash;
+    gsize prefix;
+
+    while (*unit == '/')
+        unit++;
+
+    if (strchr (unit, '/') != NULL || *unit == '\0')
+        return g_build_filename (CGROUP_ROOT, unit, NULL);
+
+    /* services and scopes outside of system.slice need a path */
+    if (!g_str_has_suffix (unit, ".slice"))
+        return g_build_filename (CGROUP_ROOT, "system.slice", unit, NULL);
+
+    if (strcmp (unit, "-.slice") == 0)
+        return g_strdup (CGROUP_ROOT);
+
+    /* "a-b.slice" is in "a.slice" */
+    path = g_string_new (CGROUP_ROOT);
+    prefix = strlen (unit) - strlen (".slice");
+    for (dash = strchr (unit, '-'); dash != NULL && (gsize) (dash - unit) < prefix;
+         dash = strchr (dash + 1, '-'))
+    {
+        g_string_append_c (path, '/');
+        g_string_append_len (path, unit, dash - unit);
+        g_string_append (path, ".slice");
+    }
+    g_string_append_c (path, '/');
+    g_string_append (path, unit);
+
+    return g_string_free (path, FALSE);
+}
+
+CgroupSampler *
+cgroup_sampler_new (const gchar * const *units)
+{
+    CgroupSampler *sampler;
+    guint i, f;
+
+    sampler = g_new0 (CgroupSampler, 1);
+
+    for (i = 0; units != NULL && units [i] != NULL && sampler->n < CGROUP_MAX; i++)
+    {
+        Cgroup *cgroup;
+        gchar *dir;
+
+        if (*units [i] == '\0')
+            continue;
+
+        cgroup = &sampler->cgroups [sampler->n++];
+        cgroup->name = g_strdup (units [i]);
+
+        dir = cgroup_path_for_unit (units [i]);
+        for (f = 0; f < CGROUP_FILE_N; f++)
+        {
+            SamplerFile file = SAMPLER_FILE_INIT (NULL);
+
+            cgroup->paths [f] = g_build_filename (dir, cgroup_file_names [f], NULL);
+            file.path = cgroup->paths [f];
+            cgroup->files [f] = file;
+        }
+        g_free (dir);
+    }
+
+    return sampler;
+}
+
+void
+cgroup_sampler_free (CgroupSampler *sampler)
+{
+    guint i, f;
+
+    if (sampler == NULL)
+        return;
+
+    for (i = 0; i < sampler->n; i++)
+    {
+        Cgroup *cgroup = &sampler->cgroups [i];
+
+        for (f = 0; f < CGROUP_FILE_N; f++)
+        {
+            sampler_file_close (&cgroup->files [f]);
+            g_free (cgroup->files [f].buffer);
+            g_free (cgroup->paths [f]);
+        }
+        g_free (cgroup->name);
+    }
+
+    g_free (sampler);
+}
+
+guint
+cgroup_sampler_get_n (CgroupSampler *sampler)
+{
+    return sampler->n;
+}
+
+const gchar *
+cgroup_sampler_get_name (CgroupSampler *sampler,
+                         guint          i)
+{
+    g_return_val_if_fail (i < sampler->n, NULL);
+
+    return sampler->cgroups [i].name;
+}
+
+/* Sums the values of key over the lines of a flat keyed file */
+static guint64
+cgroup_sum_key (const gchar *buffer,
+                const gchar *key)
+{
+    const gchar *p = buffer;
+    gsize length = strlen (key);
+    guint64 sum = 0;
+
+    while ((p = strstr (p, key)) != NULL)
+    {
+        guint64 value;
+
+        p += length;
+        if (sampler_parse_u64 (p, &value) != NULL)
+            sum += value;
+    }
+
+    return sum;
+}
+
+static guint64
+cgroup_delta (guint64 now,
+              guint64 last)
+{
+    /* a cgroup that was removed and created again starts from 0 */
+    return now >= last ? now - last : 0;
+}
+
+static void
+cgroup_read (Cgroup      *cgroup,
+             CgroupUsage *usage)
+{
+    const gchar *p;
+    guint64 cpu, read = 0, write = 0;
+
+    memset (usage, 0, sizeof *usage);
+
+    p = sampler_file_read (&cgroup->files [CGROUP_FILE_CPU]);
+    if (p == NULL || (p = strstr (p, "usage_usec ")) == NULL ||
+        sampler_parse_u64 (p + strlen ("usage_usec "), &cpu) == NULL)
+    {
+        cgroup->seen = FALSE;
+        return;
+    }
+
+    /* without the memory and io controllers the cgroup only has a CPU time */
+    p = sampler_file_read (&cgroup->files [CGROUP_FILE_MEMORY]);
+    if (p != NULL)
+        sampler_parse_u64 (p, &usage->memory);
+
+    p = sampler_file_read (&cgroup->files [CGROUP_FILE_IO]);
+    if (p != NULL)
+    {
+        read = cgroup_sum_key (p, "rbytes=");
+        write = cgroup_sum_key (p, "wbytes=");
+    }
+
+    if (cgroup->seen)
+    {
+        usage->valid = TRUE;
+        usage->cpu = cgroup_delta (cpu, cgroup->cpu);
+        usage->read = cgroup_delta (read, cgroup->read);
+        usage->write = cgroup_delta (write, cgroup->write);
+    }
+
+    cgroup->seen = TRUE;
+    cgroup->cpu = cpu;
+    cgroup->read = read;
+    cgroup->write = write;
+}
+
+gint64
+cgroup_sampler_read (CgroupSampler *sampler,
+                     CgroupUsage   *usage)
+{
+    gboolean retry;
+    gint64 now, elapsed;
+    guint i, f;
+
+    now = g_get_monotonic_time ();
+
+    /* units that were not running may have been started since */
+    retry = now - sampler->last_retry >= CGROUP_RETRY_INTERVAL;
+    if (retry)
+        sampler->last_retry = now;
+
+    for (i = 0; i < sampler->n; i++)
+    {
+        Cgroup *cgroup = &sampler->cgroups [i];
+
+        for (f = 0; retry && f < CGROUP_FILE_N; f++)
+            cgroup->files [f].failed = FALSE;
+
+        cgroup_read (cgroup, &usage [i]);
+    }
+
+    elapsed = sampler->last_time != 0 ? now - sampler->last_time : 0;
+    sampler->last_time = now;
+
+    return MAX (elapsed, 0);
+}
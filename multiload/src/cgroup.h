@@ -0,0 +1,44 @@
+#ifndef MATE_APPLETS_MULTILOAD_CGROUP_H
+#define MATE_APPLETS_MULTILOAD_CGROUP_H
+
+#include <glib.h>
+
+/* the graph stacks at most this many cgroups */
+#define CGROUP_MAX 4
+
+typedef struct _CgroupSampler CgroupSampler;
+typedef struct _CgroupUsage   CgroupUsage;
+
+/* What one cgroup used since the previous sample */
+struct _CgroupUsage
+{
+    gboolean valid;      /* the cgroup exists and has the controllers */
+    guint64  cpu;        /* microseconds of CPU time, from cpu.stat */
+    guint64  memory;     /* bytes charged now, from memory.current */
+    guint64  read;       /* bytes, from io.stat, summed over the devices */
+    guint64  write;
+};
+
+/* Samples the cgroup v2 counters of a few systemd units or cgroups.
+ *
+ * A unit name like "user-1000.slice" or "sshd.service" is looked up
+ * where systemd puts it below /sys/fs/cgroup, other services being in
+ * system.slice. A name with a '/' is a path below /sys/fs/cgroup.
+ *
+ * The three files of each cgroup stay open, so a sample costs three
+ * pread() per cgroup, however many processes they contain. */
+G_GNUC_INTERNAL CgroupSampler *cgroup_sampler_new      (const gchar * const *units);
+G_GNUC_INTERNAL void           cgroup_sampler_free     (CgroupSampler       *sampler);
+G_GNUC_INTERNAL guint          cgroup_sampler_get_n    (CgroupSampler       *sampler);
+G_GNUC_INTERNAL const gchar   *cgroup_sampler_get_name (CgroupSampler       *sampler,
+                                                        guint                i);
+
+/* Fills usage [cgroup_sampler_get_n ()] and returns the microseconds
+ * since the previous sample, or 0 on the first one. */
+G_GNUC_INTERNAL gint64         cgroup_sampler_read     (CgroupSampler       *sampler,
+                                                        CgroupUsage         *usage);
+
+/* The directory of a unit or cgroup name, see above */
+G_GNUC_INTERNAL gchar         *cgroup_path_for_unit    (const gchar         *unit);
+
+#endif /* MATE_APPLETS_MULTILOAD_CGROUP_H */
@@ -0,0 +1,293 @@
+/* Cached /proc/diskstats reader.
+ *
+ * Unlike the per-mount statistics, counters of block devices cost the
+ * same however many filesystems are mounted, never touch the filesystems
+ * themselves, and count a device once even if it backs several mounts.
+ *
+ * The file is kept open and re-read with pread(). The line numbers of
+ * the devices that matched are remembered, so a regular sample only
+ * looks for line ends and parses the counters of those lines. The match
+ * is redone when the number of lines or a cached device name changes,
+ * i.e. when disks or partitions come and go.
+ */
+#include <config.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "common/sampler-file.h"
+
+#include "diskstats.h"
+
+#define DISKSTATS_NAME_MAX 32
+
+typedef struct
+{
+    guint line;
+    gsize length;
+    gchar name [DISKSTATS_NAME_MAX];
+} DiskstatsDevice;
+
+struct _Diskstats
+{
+    SamplerFile         file;
+    DiskstatsMatchFunc  match;
+    GArray             *devices;
+    guint               n_lines;
+    gboolean            resolved;
+};
+
+Diskstats *
+diskstats_new (DiskstatsMatchFunc match)
+{
+    Diskstats *ds;
+
+    ds = g_new0 (Diskstats, 1);
+    ds->file.path = "/proc/diskstats";
+    ds->file.fd = -1;
+    ds->match = match;
+    ds->devices = g_array_new (FALSE, FALSE, sizeof (DiskstatsDevice));
+
+    return ds;
+}
+
+void
+diskstats_free (Diskstats *ds)
+{
+    if (ds == NULL)
+        return;
+
+    sampler_file_close (&ds->file);
+    g_free (ds->file.buffer);
+    g_array_free (ds->devices, TRUE);
+    g_free (ds);
+}
+
+gboolean
+diskstats_match_nvme (const gchar *name,
+                      gsize        length)
+{
+    gsize i = 4;
+
+    if (length < 7 || strncmp (name, "nvme", 4) != 0)
+        return FALSE;
+
+    if (!g_ascii_isdigit (name [i]))
+        return FALSE;
+    while (i < length && g_ascii_isdigit (name [i]))
+        i++;
+
+    if (i >= length || name [i] != 'n')
+        return FALSE;
+    i++;
+
+    if (i >= length || !g_ascii_isdigit (name [i]))
+        return FALSE;
+    while (i < length && g_ascii_isdigit (name [i]))
+        i++;
+
+    return i == length;
+}
+
+gboolean
+diskstats_match_physical (const gchar *name,
+                          gsize        length)
+{
+    static const gchar * const ignored [] = { "loop", "ram", "zram", "fd", "sr" };
+    gchar *device, *path, *slaves;
+    gboolean match = FALSE;
+    gsize i;
+
+    for (i = 0; i < G_N_ELEMENTS (ignored); i++)
+    {
+        gsize prefix = strlen (ignored [i]);
+
+        if (length > prefix && strncmp (name, ignored [i], prefix) == 0 &&
+            g_ascii_isdigit (name [prefix]))
+            return FALSE;
+    }
+
+    /* sysfs spells "cciss/c0d0" as "cciss!c0d0" */
+    device = g_strndup (name, length);
+    g_strdelimit (device, "/", '!');
+
+    /* partitions have no entry of their own in /sys/block */
+    path = g_build_filename ("/sys/block", device, NULL);
+    if (g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+        GDir *dir;
+
+        /* md and dm devices are stacked on other block devices, which
+         * already account for their I/O */
+        slaves = g_build_filename (path, "slaves", NULL);
+        dir = g_dir_open (slaves, 0, NULL);
+        match = (dir == NULL || g_dir_read_name (dir) == NULL);
+        if (dir != NULL)
+            g_dir_close (dir);
+        g_free (slaves);
+    }
+
+    g_free (path);
+    g_free (device);
+
+    return match;
+}
+
+/* Splits "major minor name counters..." and returns the counters */
+static const gchar *
+diskstats_parse_name (const gchar  *line,
+                      const gchar **name,
+                      gsize        *length)
+{
+    guint64 dummy;
+    const gchar *p;
+
+    p = sampler_parse_u64 (line, &dummy);
+    if (p != NULL)
+        p = sampler_parse_u64 (p, &dummy);
+    if (p == NULL)
+        return NULL;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+
+    *name = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\n')
+        p++;
+    *length = (gsize) (p - *name);
+
+    return *length > 0 ? p : NULL;
+}
+
+/* Extracts field 6 (sectors read) and field 10 (sectors written) */
+static gboolean
+diskstats_parse_counters (const gchar *p,
+                          guint64     *read,
+                          guint64     *write)
+{
+    guint64 value = 0;
+    guint field;
+
+    for (field = 4; field <= 10 && p != NULL; field++)
+    {
+        p = sampler_parse_u64 (p, &value);
+        if (field == 6)
+            *read = value * 512;
+    }
+
+    if (p == NULL)
+        return FALSE;
+
+    *write = value * 512;
+    return TRUE;
+}
+
+/* Matches every line again, rebuilding the device cache */
+static void
+diskstats_resolve (Diskstats   *ds,
+                   const gchar *p,
+                   guint64     *read,
+                   guint64     *write)
+{
+    guint line = 0;
+
+    g_array_set_size (ds->devices, 0);
+    *read = *write = 0;
+
+    while (*p != '\0')
+    {
+        const gchar *eol, *name, *counters;
+        gsize length;
+        guint64 r, w;
+
+        eol = strchr (p, '\n');
+
+        counters = diskstats_parse_name (p, &name, &length);
+        if (counters != NULL && length < DISKSTATS_NAME_MAX &&
+            ds->match (name, length) &&
+            diskstats_parse_counters (counters, &r, &w))
+        {
+            DiskstatsDevice device;
+
+            device.line = line;
+            device.length = length;
+            memcpy (device.name, name, length);
+            device.name [length] = '\0';
+            g_array_append_val (ds->devices, device);
+
+            *read += r;
+            *write += w;
+        }
+
+        line++;
+        if (eol == NULL)
+            break;
+        p = eol + 1;
+    }
+
+    ds->n_lines = line;
+    ds->resolved = TRUE;
+}
+
+gboolean
+diskstats_read (Diskstats *ds,
+                guint64   *read,
+                guint64   *write)
+{
+    const gchar *buffer, *p;
+    guint line = 0;
+    guint next = 0;
+
+    buffer = sampler_file_read (&ds->file);
+    if (buffer == NULL)
+        return FALSE;
+
+    if (!ds->resolved)
+    {
+        diskstats_resolve (ds, buffer, read, write);
+        return TRUE;
+    }
+
+    *read = *write = 0;
+
+    for (p = buffer; *p != '\0'; line++)
+    {
+        const gchar *eol;
+
+        eol = strchr (p, '\n');
+
+        if (next < ds->devices->len &&
+            g_array_index (ds->devices, DiskstatsDevice, next).line == line)
+        {
+            DiskstatsDevice *device;
+            const gchar *name, *counters;
+            gsize length;
+            guint64 r, w;
+
+            device = &g_array_index (ds->devices, DiskstatsDevice, next);
+            counters = diskstats_parse_name (p, &name, &length);
+
+            if (counters == NULL || length != device->length ||
+                memcmp (name, device->name, length) != 0 ||
+                !diskstats_parse_counters (counters, &r, &w))
+                break;
+
+            *read += r;
+            *write += w;
+            next++;
+        }
+
+        if (eol == NULL)
+        {
+            line++;
+            break;
+        }
+        p = eol + 1;
+    }
+
+    /* the device list changed under us */
+    if (line != ds->n_lines || next != ds->devices->len)
+        diskstats_resolve (ds, buffer, read, write);
+
+    return TRUE;
+}
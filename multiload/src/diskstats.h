@@ -0,0 +1,28 @@
+#ifndef MATE_APPLETS_MULTILOAD_DISKSTATS_H
+#define MATE_APPLETS_MULTILOAD_DISKSTATS_H
+
+#include <glib.h>
+
+typedef struct _Diskstats Diskstats;
+
+/* Decides whether a /proc/diskstats device (not nul-terminated) is counted */
+typedef gboolean (*DiskstatsMatchFunc) (const gchar *name, gsize length);
+
+G_GNUC_INTERNAL Diskstats *diskstats_new  (DiskstatsMatchFunc match);
+G_GNUC_INTERNAL void       diskstats_free (Diskstats *ds);
+
+/* Sums the bytes read and written by all matching devices. Returns FALSE
+ * if /proc/diskstats cannot be read. */
+G_GNUC_INTERNAL gboolean   diskstats_read (Diskstats *ds,
+                                           guint64   *read,
+                                           guint64   *write);
+
+/* Whole NVMe namespaces (nvme0n1), not their partitions */
+G_GNUC_INTERNAL gboolean   diskstats_match_nvme (const gchar *name, gsize length);
+
+/* Whole block devices at the bottom of the storage stack (sda, vda,
+ * nvme0n1, mmcblk0, ...). Partitions, loop and ram devices are skipped,
+ * as are md and dm devices, whose I/O is counted on their members. */
+G_GNUC_INTERNAL gboolean   diskstats_match_physical (const gchar *name, gsize length);
+
+#endif /* MATE_APPLETS_MULTILOAD_DISKSTATS_H */
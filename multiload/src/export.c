@@ -0,0 +1,396 @@
+/* Shared memory export of the readings, see export.h */
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "global.h"
+#include "export.h"
+
+/* how many samples an instance that lost the race for the lock waits
+ * before trying to take over the export again */
+#define EXPORT_RETRY_TICKS 64
+
+struct _MultiloadExport
+{
+    gchar                 *path;
+    gint                   fd;
+    gboolean               owner;
+    guint                  retry;
+    gsize                  size;
+    MultiloadExportHeader *header;  /* read-only unless owner */
+    gint64                 taken [6];  /* per bit, time of the reading used last */
+};
+
+MultiloadExport *
+multiload_export_new (void)
+{
+    MultiloadExport *export = g_new0 (MultiloadExport, 1);
+
+    export->path = g_build_filename (g_get_user_runtime_dir (), "mate-multiload.shm", NULL);
+    export->fd = -1;
+    export->size = sizeof (MultiloadExportHeader) +
+                   MULTILOAD_EXPORT_SLOTS * sizeof (MultiloadExportSample);
+
+    return export;
+}
+
+void
+multiload_export_free (MultiloadExport *export)
+{
+    if (export == NULL)
+        return;
+
+    if (export->header != NULL)
+        munmap (export->header, export->size);
+
+    /* closing the file also drops the lock for the next instance */
+    if (export->fd >= 0)
+        close (export->fd);
+
+    g_free (export->path);
+    g_free (export);
+}
+
+/* Only the instance holding the lock on the file writes to it */
+static gboolean
+multiload_export_acquire (MultiloadExport *export)
+{
+    gpointer mapping;
+
+    if (export->retry > 0) {
+        export->retry--;
+        return FALSE;
+    }
+
+    if (export->fd < 0) {
+        export->fd = open (export->path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (export->fd < 0) {
+            g_debug ("Failed to open %s: %s", export->path, g_strerror (errno));
+            export->retry = G_MAXUINT;
+            return FALSE;
+        }
+    }
+
+    if (flock (export->fd, LOCK_EX | LOCK_NB) < 0) {
+        export->retry = EXPORT_RETRY_TICKS;
+        return FALSE;
+    }
+
+    if (ftruncate (export->fd, (off_t) export->size) < 0)
+        goto fail;
+
+    /* the mapping of the reader, taken over */
+    if (export->header != NULL) {
+        munmap (export->header, export->size);
+        export->header = NULL;
+    }
+
+    mapping = mmap (NULL, export->size, PROT_READ | PROT_WRITE, MAP_SHARED, export->fd, 0);
+    if (mapping == MAP_FAILED)
+        goto fail;
+
+    export->header = mapping;
+    memset (export->header, 0, export->size);
+    export->header->version = MULTILOAD_EXPORT_VERSION;
+    export->header->slots = MULTILOAD_EXPORT_SLOTS;
+    export->header->sample_size = sizeof (MultiloadExportSample);
+    /* readers check the magic last */
+    __atomic_store_n (&export->header->magic, MULTILOAD_EXPORT_MAGIC, __ATOMIC_RELEASE);
+
+    export->owner = TRUE;
+    return TRUE;
+
+fail:
+    g_debug ("Failed to map %s: %s", export->path, g_strerror (errno));
+    close (export->fd);
+    export->fd = -1;
+    export->retry = G_MAXUINT;
+    return FALSE;
+}
+
+/* The other instances map the file of the owner read-only, once the
+ * owner sized it */
+static gboolean
+multiload_export_map (MultiloadExport *export)
+{
+    struct stat st;
+    gpointer mapping;
+
+    if (export->header != NULL)
+        return TRUE;
+
+    if (export->fd < 0 || fstat (export->fd, &st) < 0 || (gsize) st.st_size < export->size)
+        return FALSE;
+
+    mapping = mmap (NULL, export->size, PROT_READ, MAP_SHARED, export->fd, 0);
+    if (mapping == MAP_FAILED) {
+        g_debug ("Failed to map %s: %s", export->path, g_strerror (errno));
+        return FALSE;
+    }
+
+    export->header = mapping;
+    return TRUE;
+}
+
+/* Copies the newest sample, if there is one and it was not being
+ * written meanwhile */
+static gboolean
+multiload_export_read (MultiloadExportHeader *header,
+                       MultiloadExportSample *sample)
+{
+    const MultiloadExportSample *slot;
+    guint64 head;
+    guint32 sequence;
+
+    if (__atomic_load_n (&header->magic, __ATOMIC_ACQUIRE) != MULTILOAD_EXPORT_MAGIC ||
+        header->version != MULTILOAD_EXPORT_VERSION ||
+        header->slots != MULTILOAD_EXPORT_SLOTS ||
+        header->sample_size != sizeof (MultiloadExportSample))
+        return FALSE;
+
+    head = __atomic_load_n (&header->head, __ATOMIC_ACQUIRE);
+    if (head == 0)
+        return FALSE;
+
+    slot = (const MultiloadExportSample *) (header + 1) + (head - 1) % MULTILOAD_EXPORT_SLOTS;
+
+    sequence = __atomic_load_n (&slot->sequence, __ATOMIC_ACQUIRE);
+    if (sequence & 1)
+        return FALSE;
+
+    memcpy (sample, slot, sizeof *sample);
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+    return __atomic_load_n (&slot->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+gboolean
+multiload_export_take (MultiloadExport        *export,
+                       guint32                 bit,
+                       guint                   speed,
+                       MultiloadExportReading *reading)
+{
+    MultiloadExportSample sample;
+    gint64 now;
+    gint index;
+
+    if (export == NULL)
+        return FALSE;
+
+    now = g_get_monotonic_time ();
+    index = g_bit_nth_lsf (bit, -1);
+    g_return_val_if_fail (index >= 0 && index < (gint) G_N_ELEMENTS (export->taken), FALSE);
+
+    /* the ticks of the instances line up, but the owner may publish
+     * after this instance sampled, so a sample of up to a period ago is
+     * still the latest */
+    if (export->owner ||
+        !multiload_export_map (export) ||
+        !multiload_export_read (export->header, &sample) ||
+        !(sample.read & bit) ||
+        sample.time <= export->taken [index] ||
+        now - sample.time >= (gint64) speed * 1000) {
+        export->taken [index] = now;
+        return FALSE;
+    }
+
+    export->taken [index] = sample.time;
+    *reading = sample.reading;
+    return TRUE;
+}
+
+static guint32
+ratio_to_ppm (float ratio)
+{
+    return (guint32) (CLAMP (ratio, 0.0f, 1.0f) * 1000000.0f);
+}
+
+void
+multiload_export_publish (MultiloadExport *export,
+                          MultiloadApplet *ma)
+{
+    MultiloadExportSample *slot;
+    guint64 head;
+    guint32 sequence;
+
+    if (!export->owner && !multiload_export_acquire (export))
+        return;
+
+    head = export->header->head;
+    slot = (MultiloadExportSample *) (export->header + 1) + head % MULTILOAD_EXPORT_SLOTS;
+
+    sequence = slot->sequence + 1;
+    __atomic_store_n (&slot->sequence, sequence, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+
+    slot->valid = 0;
+    slot->time = g_get_monotonic_time ();
+
+    if (ma->graphs [graph_cpuload]->running) {
+        slot->valid |= MULTILOAD_EXPORT_CPU;
+        slot->cpu_used = ratio_to_ppm (ma->cpu_used_ratio);
+    }
+    if (ma->graphs [graph_memload]->running) {
+        slot->valid |= MULTILOAD_EXPORT_MEMORY;
+        slot->memory_user = ma->memload_user;
+        slot->memory_cache = ma->memload_cache;
+        slot->memory_total = ma->memload_total;
+    }
+    if (ma->graphs [graph_netload2]->running) {
+        slot->valid |= MULTILOAD_EXPORT_NET;
+        slot->net_in = (guint64) netspeed_get_rate (ma->netspeed_in);
+        slot->net_out = (guint64) netspeed_get_rate (ma->netspeed_out);
+    }
+    if (ma->graphs [graph_swapload]->running) {
+        slot->valid |= MULTILOAD_EXPORT_SWAP;
+        slot->swap_used = ratio_to_ppm (ma->swapload_used_ratio);
+    }
+    if (ma->graphs [graph_loadavg]->running) {
+        slot->valid |= MULTILOAD_EXPORT_LOADAVG;
+        slot->loadavg = (guint32) (MAX (ma->loadavg1, 0.0) * 1000.0);
+    }
+    if (ma->graphs [graph_diskload]->running) {
+        slot->valid |= MULTILOAD_EXPORT_DISK;
+        slot->disk_used = ratio_to_ppm (ma->diskload_used_ratio);
+    }
+
+    slot->read = ma->reading_read;
+    slot->reading = ma->reading;
+    ma->reading_read = 0;
+
+    __atomic_store_n (&slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+    __atomic_store_n (&export->header->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#define METRICS_PREFIX "mate_multiload_"
+
+static gboolean
+metrics_running (MultiloadApplet *ma,
+                 E_graph          graph)
+{
+    return ma->graphs [graph] != NULL && ma->graphs [graph]->running;
+}
+
+/* The newest closed bucket of every history level, as a share of the
+ * graph height. The levels are named after their interval. */
+static void
+metrics_levels (GString         *out,
+                MultiloadApplet *ma,
+                gboolean         peak)
+{
+    GString *labels;
+    guint i, l, j;
+
+    labels = g_string_new (NULL);
+
+    for (i = 0; i < graph_n; i++)
+    {
+        LoadGraph *g = ma->graphs [i];
+
+        /* the autoscaled graphs have no height to be a share of */
+        if (g == NULL || !g->running || !g->allocated || g->peak_value >= 0)
+            continue;
+
+        for (l = 0; l < LOAD_GRAPH_LEVELS; l++)
+        {
+            const LoadGraphLevel *level = &g->levels [l];
+            const guint64 *column;
+
+            if (level->filled == 0)
+                continue;
+
+            column = (peak ? level->max_ring : level->avg_ring) + level->head * g->n_values;
+            for (j = 0; j < g->n_values; j++)
+            {
+                g_string_printf (labels, "graph=\"%s\",value=\"%u\",window=\"%us\"",
+                                 g->name, j, level->interval / 1000);
+                sampler_metrics_sample (out,
+                                        peak ? METRICS_PREFIX "graph_peak_ratio"
+                                             : METRICS_PREFIX "graph_ratio",
+                                        labels->str,
+                                        (gdouble) column [j] / (gdouble) g->draw_height);
+            }
+        }
+    }
+
+    g_string_free (labels, TRUE);
+}
+
+void
+multiload_export_metrics (GString  *out,
+                          gpointer  data)
+{
+    MultiloadApplet *ma = data;
+
+    if (metrics_running (ma, graph_cpuload)) {
+        sampler_metrics_family (out, METRICS_PREFIX "cpu_used_ratio", "gauge",
+                                "Share of the CPU time not spent idle");
+        sampler_metrics_sample (out, METRICS_PREFIX "cpu_used_ratio", NULL, ma->cpu_used_ratio);
+    }
+    if (metrics_running (ma, graph_memload)) {
+        sampler_metrics_family (out, METRICS_PREFIX "memory_bytes", "gauge",
+                                "Memory used by programs and caches, and in total");
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "memory_bytes", "kind=\"user\"", ma->memload_user);
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "memory_bytes", "kind=\"cache\"", ma->memload_cache);
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "memory_bytes", "kind=\"total\"", ma->memload_total);
+    }
+    if (metrics_running (ma, graph_netload2)) {
+        sampler_metrics_family (out, METRICS_PREFIX "network_bytes_per_second", "gauge",
+                                "Traffic of the physical network devices");
+        sampler_metrics_sample (out, METRICS_PREFIX "network_bytes_per_second", "direction=\"in\"",
+                                netspeed_get_rate (ma->netspeed_in));
+        sampler_metrics_sample (out, METRICS_PREFIX "network_bytes_per_second", "direction=\"out\"",
+                                netspeed_get_rate (ma->netspeed_out));
+    }
+    if (metrics_running (ma, graph_swapload)) {
+        sampler_metrics_family (out, METRICS_PREFIX "swap_used_ratio", "gauge",
+                                "Share of the swap space in use");
+        sampler_metrics_sample (out, METRICS_PREFIX "swap_used_ratio", NULL, ma->swapload_used_ratio);
+    }
+    if (metrics_running (ma, graph_loadavg)) {
+        sampler_metrics_family (out, METRICS_PREFIX "load1", "gauge",
+                                "Load average over 1 minute");
+        sampler_metrics_sample (out, METRICS_PREFIX "load1", NULL, ma->loadavg1);
+    }
+    if (metrics_running (ma, graph_diskload)) {
+        sampler_metrics_family (out, METRICS_PREFIX "disk_used_ratio", "gauge",
+                                "Disk traffic as a share of the disk graph scale");
+        sampler_metrics_sample (out, METRICS_PREFIX "disk_used_ratio", NULL, ma->diskload_used_ratio);
+    }
+    if (metrics_running (ma, graph_psi)) {
+        sampler_metrics_family (out, METRICS_PREFIX "pressure_ratio", "gauge",
+                                "Share of the last interval some task was stalled");
+        sampler_metrics_sample (out, METRICS_PREFIX "pressure_ratio", "resource=\"cpu\"", ma->psi_ratio [psi_cpu]);
+        sampler_metrics_sample (out, METRICS_PREFIX "pressure_ratio", "resource=\"memory\"", ma->psi_ratio [psi_memory]);
+        sampler_metrics_sample (out, METRICS_PREFIX "pressure_ratio", "resource=\"io\"", ma->psi_ratio [psi_io]);
+    }
+    if (metrics_running (ma, graph_gpuload) && ma->gpu_usage.n_cards > 0) {
+        sampler_metrics_family (out, METRICS_PREFIX "gpu_busy_ratio", "gauge",
+                                "Busy share of the busiest graphics card");
+        sampler_metrics_sample (out, METRICS_PREFIX "gpu_busy_ratio", NULL, ma->gpu_usage.busy / 1000.0);
+    }
+    if (metrics_running (ma, graph_thermal) && ma->thermal_valid) {
+        GString *labels = g_string_new ("sensor=");
+
+        sampler_metrics_label_value (labels, ma->thermal_reading.label);
+        sampler_metrics_family (out, METRICS_PREFIX "temperature_celsius", "gauge",
+                                "Temperature of the hottest sensor");
+        sampler_metrics_sample (out, METRICS_PREFIX "temperature_celsius", labels->str,
+                                ma->thermal_reading.hottest / 1000.0);
+        g_string_free (labels, TRUE);
+    }
+
+    sampler_metrics_family (out, METRICS_PREFIX "graph_ratio", "gauge",
+                            "Average of the newest column of a history level, as a share of the graph");
+    metrics_levels (out, ma, FALSE);
+    sampler_metrics_family (out, METRICS_PREFIX "graph_peak_ratio", "gauge",
+                            "Maximum of the newest column of a history level, as a share of the graph");
+    metrics_levels (out, ma, TRUE);
+}
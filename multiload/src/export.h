@@ -0,0 +1,116 @@
+#ifndef MATE_APPLETS_MULTILOAD_EXPORT_H
+#define MATE_APPLETS_MULTILOAD_EXPORT_H
+
+#include <glib.h>
+
+/* Shared memory export of the multiload readings.
+ *
+ * One applet instance per session publishes what its collectors read
+ * into $XDG_RUNTIME_DIR/mate-multiload.shm, laid out as a
+ * MultiloadExportHeader followed by MULTILOAD_EXPORT_SLOTS samples.
+ * Other tools can map the file read-only, and so do the other applet
+ * instances: their collectors of the cpu, memory, swap, net and load
+ * average graphs take what the owner read from the newest sample rather
+ * than reading /proc themselves, and only scale it to their own graphs.
+ * The disk graph depends on the settings of each instance, and the
+ * other graphs are cheap or event driven; they are always read locally.
+ *
+ * The writer bumps head after every sample, and each slot is protected
+ * by its own sequence counter. head % slots is the slot written next, so
+ * readers take the newest sample from slot (head - 1) % slots, once head
+ * is not 0: they read its sequence, copy the sample and read the
+ * sequence again. The copy is only valid when both reads return the same
+ * even value. */
+
+#define MULTILOAD_EXPORT_MAGIC   0x4d4c4f41 /* "MLOA" */
+#define MULTILOAD_EXPORT_VERSION 2
+#define MULTILOAD_EXPORT_SLOTS   64
+
+/* bits of MultiloadExportSample.valid, one per graph that was running,
+ * and of MultiloadExportSample.read, one per collector that filled its
+ * part of the reading */
+#define MULTILOAD_EXPORT_CPU     (1 << 0)
+#define MULTILOAD_EXPORT_MEMORY  (1 << 1)
+#define MULTILOAD_EXPORT_NET     (1 << 2)
+#define MULTILOAD_EXPORT_SWAP    (1 << 3)
+#define MULTILOAD_EXPORT_LOADAVG (1 << 4)
+#define MULTILOAD_EXPORT_DISK    (1 << 5)
+
+typedef struct _MultiloadExportHeader  MultiloadExportHeader;
+typedef struct _MultiloadExportReading MultiloadExportReading;
+typedef struct _MultiloadExportSample  MultiloadExportSample;
+
+/* What the collectors of the shared graphs read, before any scaling */
+struct _MultiloadExportReading
+{
+    guint64 cpu_time [5];   /* cumulative clock ticks, in the order of E_cpuload */
+    guint64 mem_total;      /* bytes */
+    guint64 mem_free;
+    guint64 mem_buffer;
+    guint64 mem_cached;
+    guint64 mem_shared;
+    guint64 swap_total;     /* bytes */
+    guint64 swap_used;
+    guint64 net_bytes [3];  /* cumulative bytes in, out and over loopback */
+    double  load1;
+};
+
+struct _MultiloadExportSample
+{
+    guint32 sequence;       /* odd while the slot is being written */
+    guint32 valid;
+    gint64  time;           /* g_get_monotonic_time () */
+    guint32 cpu_used;       /* parts per million */
+    guint32 swap_used;      /* parts per million */
+    guint32 disk_used;      /* parts per million of the disk graph scale */
+    guint32 loadavg;        /* 1 minute load average * 1000 */
+    guint64 memory_user;    /* bytes */
+    guint64 memory_cache;
+    guint64 memory_total;
+    guint64 net_in;         /* bytes per second */
+    guint64 net_out;
+    guint32 read;
+    guint32 padding;
+    MultiloadExportReading reading;
+};
+
+struct _MultiloadExportHeader
+{
+    guint32 magic;
+    guint32 version;
+    guint32 slots;
+    guint32 sample_size;
+    guint64 head;           /* number of samples published so far */
+};
+
+typedef struct _MultiloadExport MultiloadExport;
+struct _MultiloadApplet;
+
+G_GNUC_INTERNAL MultiloadExport *multiload_export_new     (void);
+G_GNUC_INTERNAL void             multiload_export_free    (MultiloadExport *export);
+
+/* Publishes the latest readings of ma, if this instance is the one
+ * owning the export. */
+G_GNUC_INTERNAL void             multiload_export_publish (MultiloadExport        *export,
+                                                           struct _MultiloadApplet *ma);
+
+/* Fills reading with what the owner read for the collector of bit, and
+ * returns TRUE, if this instance is not the owner and the newest sample
+ * holds that part, is younger than speed milliseconds and newer than
+ * what the collector used before. Otherwise returns FALSE, and the
+ * collector reads for itself: the counters it takes stay in order. */
+G_GNUC_INTERNAL gboolean         multiload_export_take    (MultiloadExport        *export,
+                                                           guint32                 bit,
+                                                           guint                   speed,
+                                                           MultiloadExportReading *reading);
+
+/* SamplerMetricsFunc of the applet, data being the MultiloadApplet.
+ *
+ * Writes the latest readings of the running graphs, then the newest
+ * column of each decimated history level of the graphs with a fixed
+ * scale, as a share of the graph: the rings are read where they are, so
+ * serving the metrics costs no sampling of its own. */
+G_GNUC_INTERNAL void             multiload_export_metrics (GString  *out,
+                                                           gpointer  data);
+
+#endif /* MATE_APPLETS_MULTILOAD_EXPORT_H */
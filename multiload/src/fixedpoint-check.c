@@ -0,0 +1,130 @@
+/* Checks the integer scaling of the collectors at the edges: memory
+ * totals of several TiB and network counters of 100 GbE links, where
+ * value * maximum no longer fits a guint64.
+ *
+ * Run by make check.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "fixedpoint.h"
+
+#define TIB (G_GUINT64_CONSTANT (1) << 40)
+
+/* 100 Gbit/s in bytes per second */
+#define RATE_100GBE G_GUINT64_CONSTANT (12500000000)
+
+static void
+test_scale_zero_total (void)
+{
+    g_assert_cmpuint (fixedpoint_scale (1, 100, 0), ==, 0);
+    g_assert_cmpuint (fixedpoint_scale (0, 100, 10), ==, 0);
+    g_assert_cmpuint (fixedpoint_scale (10, 0, 10), ==, 0);
+}
+
+static void
+test_scale_memory_tib (void)
+{
+    /* half of 6 TiB on a graph 40 pixels high */
+    g_assert_cmpuint (fixedpoint_scale (3 * TIB, 40, 6 * TIB), ==, 20);
+
+    /* one byte short of half is rounded down */
+    g_assert_cmpuint (fixedpoint_scale (3 * TIB - 1, 40, 6 * TIB), ==, 19);
+
+    /* as parts per million, and with a maximum that overflows the
+     * product: 3 TiB * 2^32 is 3 * 2^72 */
+    g_assert_cmpuint (fixedpoint_scale (3 * TIB, 1000000, 6 * TIB), ==, 500000);
+    g_assert_cmpuint (fixedpoint_scale (3 * TIB, G_GUINT64_CONSTANT (1) << 32, 6 * TIB),
+                      ==, G_GUINT64_CONSTANT (1) << 31);
+
+    /* all of it */
+    g_assert_cmpuint (fixedpoint_scale (64 * TIB, 1000, 64 * TIB), ==, 1000);
+}
+
+static void
+test_scale_saturates (void)
+{
+    /* the result itself does not fit */
+    g_assert_cmpuint (fixedpoint_scale (G_MAXUINT64, 2, 1), ==, G_MAXUINT64);
+    g_assert_cmpuint (fixedpoint_scale (G_MAXUINT64, G_MAXUINT64, G_MAXUINT64), ==, G_MAXUINT64);
+}
+
+static void
+test_stack_memory_tib (void)
+{
+    /* user, shared, buffers and cache of a 4 TiB machine, 1 byte each
+     * short of a quarter, so every segment rounds down on its own */
+    const guint64 values [] = { TIB - 1, TIB - 1, TIB - 1, TIB - 1 };
+    guint64 scaled [G_N_ELEMENTS (values)];
+    guint64 sum;
+
+    sum = fixedpoint_scale_stack (values, G_N_ELEMENTS (values), 30, 4 * TIB, scaled);
+
+    /* just under 7.5 pixels each: the boundaries at 7, 14, 22 and 29
+     * are rounded once, not the segments */
+    g_assert_cmpuint (scaled [0], ==, 7);
+    g_assert_cmpuint (scaled [1], ==, 7);
+    g_assert_cmpuint (scaled [2], ==, 8);
+    g_assert_cmpuint (scaled [3], ==, 7);
+    g_assert_cmpuint (sum, ==, 29);
+}
+
+static void
+test_stack_clamped (void)
+{
+    /* inconsistent samples that add up to more than the total */
+    const guint64 values [] = { 5 * TIB, 5 * TIB, 5 * TIB };
+    guint64 scaled [G_N_ELEMENTS (values)];
+    guint64 sum;
+
+    sum = fixedpoint_scale_stack (values, G_N_ELEMENTS (values), 100, 8 * TIB, scaled);
+
+    g_assert_cmpuint (scaled [0], ==, 62);
+    g_assert_cmpuint (scaled [1], ==, 38);
+    g_assert_cmpuint (scaled [2], ==, 0);
+    g_assert_cmpuint (sum, ==, 100);
+}
+
+static void
+test_rate_100gbe (void)
+{
+    /* a saturated link over one second and over the fastest refresh */
+    g_assert_cmpuint (fixedpoint_rate (RATE_100GBE, 1000), ==, RATE_100GBE);
+    g_assert_cmpuint (fixedpoint_rate (RATE_100GBE / 20, 50), ==, RATE_100GBE);
+
+    /* over the slowest refresh, 60 s, the difference is 750 GB */
+    g_assert_cmpuint (fixedpoint_rate (RATE_100GBE * 60, 60000), ==, RATE_100GBE);
+
+    /* a zero interval gives no rate rather than a division by zero */
+    g_assert_cmpuint (fixedpoint_rate (RATE_100GBE, 0), ==, 0);
+}
+
+static void
+test_rate_near_overflow (void)
+{
+    /* delta * 1000 overflows a guint64 for these */
+    g_assert_cmpuint (fixedpoint_rate (G_MAXUINT64, 1000), ==, G_MAXUINT64);
+    g_assert_cmpuint (fixedpoint_rate (G_MAXUINT64, 3000), ==, G_MAXUINT64 / 3);
+    g_assert_cmpuint (fixedpoint_rate (G_MAXUINT64 / 1000 + 1, 1000), ==, G_MAXUINT64 / 1000 + 1);
+
+    /* faster than a guint64 per second saturates */
+    g_assert_cmpuint (fixedpoint_rate (G_MAXUINT64, 500), ==, G_MAXUINT64);
+}
+
+int
+main (int argc, char *argv [])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/fixedpoint/scale/zero-total", test_scale_zero_total);
+    g_test_add_func ("/fixedpoint/scale/memory-tib", test_scale_memory_tib);
+    g_test_add_func ("/fixedpoint/scale/saturates", test_scale_saturates);
+    g_test_add_func ("/fixedpoint/stack/memory-tib", test_stack_memory_tib);
+    g_test_add_func ("/fixedpoint/stack/clamped", test_stack_clamped);
+    g_test_add_func ("/fixedpoint/rate/100gbe", test_rate_100gbe);
+    g_test_add_func ("/fixedpoint/rate/near-overflow", test_rate_near_overflow);
+
+    return g_test_run ();
+}
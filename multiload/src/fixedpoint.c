@@ -0,0 +1,76 @@
+/* Integer scaling for the collectors.
+ *
+ * Counters such as memory sizes in bytes or network totals do not fit
+ * the 24 bit mantissa of a float, so scaling them through float both
+ * loses precision and makes the stacked segments not add up to the
+ * graph height.
+ */
+#include <config.h>
+
+#include <glib.h>
+
+#include "fixedpoint.h"
+
+guint64
+fixedpoint_scale (guint64 value,
+                  guint64 maximum,
+                  guint64 total)
+{
+    if (total == 0)
+        return 0;
+
+#ifdef __SIZEOF_INT128__
+    {
+        unsigned __int128 product = (unsigned __int128) value * maximum / total;
+
+        return product > G_MAXUINT64 ? G_MAXUINT64 : (guint64) product;
+    }
+#else
+    {
+        /* value * maximum / total == q * maximum + r * maximum / total */
+        guint64 q = value / total;
+        guint64 r = value % total;
+
+        if (maximum != 0 && q > G_MAXUINT64 / maximum)
+            return G_MAXUINT64;
+
+        if (maximum == 0 || r <= G_MAXUINT64 / maximum)
+            return q * maximum + r * maximum / total;
+
+        /* r < total, so the remainder term is below maximum */
+        return q * maximum + (guint64) ((long double) r * maximum / total);
+    }
+#endif
+}
+
+guint64
+fixedpoint_scale_stack (const guint64 *values,
+                        guint          n,
+                        guint64        maximum,
+                        guint64        total,
+                        guint64       *scaled)
+{
+    guint64 cumulative = 0, previous = 0;
+    guint i;
+
+    for (i = 0; i < n; i++)
+    {
+        guint64 boundary;
+
+        /* clamp so inconsistent samples cannot exceed maximum */
+        cumulative = MIN (cumulative + values [i], total);
+        boundary = fixedpoint_scale (cumulative, maximum, total);
+
+        scaled [i] = boundary - previous;
+        previous = boundary;
+    }
+
+    return previous;
+}
+
+guint64
+fixedpoint_rate (guint64 delta,
+                 guint   interval)
+{
+    return fixedpoint_scale (delta, 1000, interval);
+}
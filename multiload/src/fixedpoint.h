@@ -0,0 +1,27 @@
+#ifndef MATE_APPLETS_MULTILOAD_FIXEDPOINT_H
+#define MATE_APPLETS_MULTILOAD_FIXEDPOINT_H
+
+#include <glib.h>
+
+/* Returns value * maximum / total rounded down, computed without
+ * intermediate overflow. Returns 0 when total is 0. */
+G_GNUC_INTERNAL guint64 fixedpoint_scale       (guint64        value,
+                                                guint64        maximum,
+                                                guint64        total);
+
+/* Scales n stacked values so that each boundary between them is rounded
+ * down exactly once. The scaled values then always add up to
+ * sum (values) * maximum / total, and never to more than maximum.
+ * Returns that sum. */
+G_GNUC_INTERNAL guint64 fixedpoint_scale_stack (const guint64 *values,
+                                                guint          n,
+                                                guint64        maximum,
+                                                guint64        total,
+                                                guint64       *scaled);
+
+/* Converts a counter difference over interval milliseconds into a
+ * per-second rate. */
+G_GNUC_INTERNAL guint64 fixedpoint_rate        (guint64        delta,
+                                                guint          interval);
+
+#endif /* MATE_APPLETS_MULTILOAD_FIXEDPOINT_H */
@@ -34,6 +34,19 @@ G_BEGIN_DECLS
 #define KEY_DISKLOAD_READ_COLOR       "diskload-color0"
 #define KEY_DISKLOAD_WRITE_COLOR      "diskload-color1"
 #define KEY_DISKLOAD_FREE_COLOR       "diskload-color2"
+#define KEY_PSI_CPU_COLOR             "psi-color0"
+#define KEY_PSI_MEMORY_COLOR          "psi-color1"
+#define KEY_PSI_IO_COLOR              "psi-color2"
+#define KEY_PSI_FREE_COLOR            "psi-color3"
+#define KEY_CGROUP_0_COLOR            "cgroup-color0"
+#define KEY_CGROUP_1_COLOR            "cgroup-color1"
+#define KEY_CGROUP_2_COLOR            "cgroup-color2"
+#define KEY_CGROUP_3_COLOR            "cgroup-color3"
+#define KEY_CGROUP_FREE_COLOR         "cgroup-color4"
+#define KEY_GPULOAD_USED_COLOR        "gpuload-color0"
+#define KEY_GPULOAD_FREE_COLOR        "gpuload-color1"
+#define KEY_THERMAL_TEMP_COLOR        "thermal-color0"
+#define KEY_THERMAL_FREE_COLOR        "thermal-color1"
 
 #define KEY_NET_THRESHOLD1 "netthreshold1"
 #define KEY_NET_THRESHOLD2 "netthreshold2"
@@ -51,8 +64,15 @@ G_BEGIN_DECLS
 #define VIEW_SWAPLOAD_KEY  "view-swapload"
 #define VIEW_LOADAVG_KEY   "view-loadavg"
 #define VIEW_DISKLOAD_KEY  "view-diskload"
+#define VIEW_PSI_KEY       "view-psi"
+#define VIEW_CGROUP_KEY    "view-cgroup"
+#define VIEW_GPULOAD_KEY   "view-gpuload"
+#define VIEW_THERMAL_KEY   "view-thermal"
 
 #define DISKLOAD_NVME_KEY  "diskload-nvme-diskstats"
+#define CPULOAD_PER_CORE_KEY "cpuload-per-core"
+#define PSI_TRIGGER_KEY    "psi-trigger"
+#define CGROUP_UNITS_KEY   "cgroup-units"
 
 #define REFRESH_RATE_KEY   "speed"
 #define REFRESH_RATE_MIN   50
@@ -62,11 +82,23 @@ G_BEGIN_DECLS
 #define GRAPH_SIZE_MIN     10
 #define GRAPH_SIZE_MAX     1000
 
+#define HISTORY_LEVEL_KEY  "history-level"
+#define METRICS_SOCKET_KEY   "metrics-socket"
+#define METRICS_TEXTFILE_KEY "metrics-textfile"
+
 typedef struct _MultiloadApplet MultiloadApplet;
 typedef struct _LoadGraph LoadGraph;
+typedef struct _LoadGraphLevel LoadGraphLevel;
 typedef void (*LoadGraphDataFunc) (guint64, guint64 [], LoadGraph *);
 
+#include "autoscaler.h"
 #include "netspeed.h"
+#include "export.h"
+#include "pressure.h"
+#include "cgroup.h"
+#include "gpu.h"
+#include "thermal.h"
+#include "common/sampler-metrics.h"
 
 typedef enum {
     graph_cpuload = 0,
@@ -75,6 +107,10 @@ typedef enum {
     graph_swapload,
     graph_loadavg,
     graph_diskload,
+    graph_psi,
+    graph_cgroup,
+    graph_gpuload,
+    graph_thermal,
     graph_n,
 } E_graph;
 
@@ -126,10 +162,63 @@ typedef enum {
     diskload_n
 } E_diskload;
 
+/* time some task was stalled on each resource, see GetPsi () */
+typedef enum {
+    psi_cpu = 0,
+    psi_memory,
+    psi_io,
+    psi_free,
+    psi_n
+} E_psi;
+
+/* CPU time of each selected cgroup, see GetCgroup () */
+typedef enum {
+    cgroup_0 = 0,
+    cgroup_1,
+    cgroup_2,
+    cgroup_3,
+    cgroup_free,
+    cgroup_n
+} E_cgroup;
+
+typedef enum {
+    gpuload_used = 0,
+    gpuload_free,
+    gpuload_n
+} E_gpuload;
+
+typedef enum {
+    thermal_temp = 0,
+    thermal_free,
+    thermal_n
+} E_thermal;
+
+/* decimated history levels, one column per 1 s, 10 s and 60 s */
+#define LOAD_GRAPH_LEVELS 3
+
+/* ms between the samples of graphs that nobody can see */
+#define LOAD_GRAPH_BACKGROUND_INTERVAL 30000
+
+/* Samples of one history level are summed into an open bucket, which
+ * becomes a new column of averages and maxima once it covers interval
+ * milliseconds. */
+struct _LoadGraphLevel {
+    guint    interval;
+    guint    elapsed;   /* milliseconds in the open bucket */
+    guint    count;     /* samples in the open bucket */
+    guint64 *sum;       /* open bucket, n_values each */
+    guint64 *max;
+    guint64 *avg_ring;  /* rings of draw_width columns, like LoadGraph data */
+    guint64 *max_ring;
+    gsize    head;
+    gsize    filled;    /* columns of the rings holding a closed bucket */
+};
+
 struct _LoadGraph {
     MultiloadApplet *multiload;
 
-    guint n;
+    guint n;            /* number of colors */
+    guint n_values;     /* values per sample, usually n */
     gint  id;
     guint speed, size;
     guint orient, pixel_size;
@@ -140,16 +229,38 @@ struct _LoadGraph {
     guint allocated;
 
     GdkRGBA *colors;
-    guint64 **data;
-    guint64  *pos;
+    guint64 *data;      /* ring of draw_width samples, n values each */
+    gsize    head;      /* column of the newest sample */
+    guint    interval;  /* ms covered by the sample being taken */
+    gint64   sampled;   /* g_get_monotonic_time () of the newest sample */
+    guint64 *pos;
+    gint64  *stack;     /* n + 1 rows of draw_width segment bottoms */
+
+    /* 0 shows data, one column per sample, otherwise levels [level - 1] */
+    guint          level;
+    LoadGraphLevel levels [LOAD_GRAPH_LEVELS];
+
+    /* maxima of the value that sets the scale, over data and each level */
+    gint      peak_value;
+    WindowMax peaks [LOAD_GRAPH_LEVELS + 1];
 
     GtkWidget *main_widget;
     GtkWidget *frame, *box, *disp;
     cairo_surface_t *surface;
-    int timer_index;
+    cairo_surface_t *back_surface;
+    gboolean running;
+
+    /* scale of the last full repaint, see load_graph_draw () */
+    gboolean full_redraw;
+    guint64  drawn_threshold;
+    guint64  drawn_segments;
+    guint    drawn_level;
 
     gboolean visible;
+    gboolean heatmap;   /* one shaded row per value instead of stacked columns */
     gboolean tooltip_update;
+    gboolean tooltip_valid;  /* tooltip_text matches the newest sample */
+    GString *tooltip_text;
     const gchar *name;
 };
 
@@ -161,6 +272,23 @@ struct _MultiloadApplet
 
     LoadGraph *graphs [graph_n];
 
+    /* shared timeout sampling all running graphs */
+    guint speed;
+    guint sampler_id;
+    guint sampler_speed;
+    gboolean sampler_background;  /* no graph is shown */
+    gboolean sampler_backfill;    /* the next tick fills the columns since the last one */
+    gint64   last_tick;
+    gboolean screensaver_active;
+    GDBusProxy *screensaver;
+    GCancellable *screensaver_cancellable;
+    guint history_level;
+
+    MultiloadExport *export;
+    MultiloadExportReading reading;  /* of the collectors, for the export */
+    guint32          reading_read;   /* MULTILOAD_EXPORT_* bits filled since the last publish */
+    SamplerMetrics  *metrics;  /* of METRICS_SOCKET_KEY and METRICS_TEXTFILE_KEY */
+
     GtkWidget *box;
 
     gboolean view_cpuload;
@@ -169,6 +297,7 @@ struct _MultiloadApplet
     gboolean view_swapload;
     gboolean view_loadavg;
     gboolean view_diskload;
+    gboolean view_psi;
 
     GtkWidget *about_dialog;
     GtkWidget *check_boxes [graph_n];
@@ -181,6 +310,10 @@ struct _MultiloadApplet
     guint64  cpu_last [cpuload_n];
     gboolean cpu_initialized;
 
+    gboolean cpuload_per_core;
+    guint    ncpu;
+    guint64 *cpu_core_last;  /* used and total time of each core */
+
     double loadavg1;
 
     guint64 memload_user;
@@ -192,6 +325,22 @@ struct _MultiloadApplet
     float diskload_used_ratio;
     gboolean nvme_diskstats;
 
+    float psi_ratio [psi_free];  /* share of the last interval stalled */
+    PressureTrigger *psi_trigger;
+    guint psi_kick_id;  /* idle source taking the stalls of all resources at once */
+    gboolean psi_trigger_enabled;
+
+    CgroupSampler *cgroups;  /* of the units in CGROUP_UNITS_KEY */
+    CgroupUsage    cgroup_usage [CGROUP_MAX];
+    gint64         cgroup_elapsed;  /* µs covered by cgroup_usage */
+
+    GpuSampler *gpu;
+    GpuUsage    gpu_usage;
+
+    ThermalSampler *thermal;
+    ThermalReading  thermal_reading;
+    gboolean        thermal_valid;
+
     NetSpeed *netspeed_in;
     NetSpeed *netspeed_out;
     guint64 net_threshold1;
@@ -211,9 +360,13 @@ multiload_properties_cb (GtkAction       *action,
 G_GNUC_INTERNAL void
 multiload_applet_refresh (MultiloadApplet *ma);
 
-/* update the tooltip to the graph's current "used" percentage */
+/* install the PSI triggers while they are enabled and the graph runs */
 G_GNUC_INTERNAL void
-multiload_applet_tooltip_update (LoadGraph *g);
+multiload_applet_update_psi_trigger (MultiloadApplet *ma);
+
+/* the tooltip text for the graph's current "used" percentage */
+G_GNUC_INTERNAL const gchar *
+multiload_applet_tooltip_text (LoadGraph *g);
 
 G_END_DECLS
 
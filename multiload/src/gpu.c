@@ -0,0 +1,270 @@
+/* Busy share and VRAM of the DRM cards, from their sysfs attributes.
+ *
+ * The per-client engine times of DRM fdinfo would need the fdinfo of
+ * every open file of every process, so only the counters the drivers
+ * keep per card are used.
+ */
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "common/sampler-file.h"
+
+#include "gpu.h"
+
+#define GPU_DRM_DIR "/sys/class/drm"
+
+typedef enum {
+    GPU_STATUS = 0,     /* runtime PM status, readable without resuming */
+    GPU_BUSY,
+    GPU_VRAM_USED,
+    GPU_VRAM_TOTAL,
+    GPU_ATTR_N
+} GpuAttr;
+
+typedef struct
+{
+    gchar    *paths [GPU_ATTR_N];  /* NULL when the driver lacks it */
+    gint      fds [GPU_ATTR_N];
+
+    /* GPU_BUSY is a percentage, or else a residency in ms of an idle state */
+    gboolean  busy_percent;
+    guint64   residency;
+    gint64    residency_time;
+
+    guint     busy;
+    guint64   vram_used;
+    guint64   vram_total;
+} GpuCard;
+
+struct _GpuSampler
+{
+    GArray   *cards;
+    gint64    last_read;
+    GpuUsage  usage;
+};
+
+static gchar *
+gpu_card_find (const gchar *dir,
+               const gchar * const *names)
+{
+    guint i;
+
+    for (i = 0; names [i] != NULL; i++)
+    {
+        gchar *path = g_build_filename (dir, names [i], NULL);
+
+        if (access (path, R_OK) == 0)
+            return path;
+        g_free (path);
+    }
+
+    return NULL;
+}
+
+static void
+gpu_sampler_add_card (GpuSampler  *sampler,
+                      const gchar *dir,
+                      const gchar *driver)
+{
+    static const gchar * const amdgpu_busy [] = { "device/gpu_busy_percent", NULL };
+    static const gchar * const i915_rc6 [] = { "gt/gt0/rc6_residency_ms",
+                                               "power/rc6_residency_ms", NULL };
+    static const gchar * const xe_idle [] = { "device/tile0/gt0/gtidle/idle_residency_ms", NULL };
+    static const gchar * const amdgpu_vram_used [] = { "device/mem_info_vram_used", NULL };
+    static const gchar * const amdgpu_vram_total [] = { "device/mem_info_vram_total", NULL };
+    static const gchar * const status [] = { "device/power/runtime_status", NULL };
+    GpuCard card = { { NULL }, { -1, -1, -1, -1 } };
+    guint a;
+
+    if (strcmp (driver, "amdgpu") == 0)
+    {
+        card.paths [GPU_BUSY] = gpu_card_find (dir, amdgpu_busy);
+        card.paths [GPU_VRAM_USED] = gpu_card_find (dir, amdgpu_vram_used);
+        card.paths [GPU_VRAM_TOTAL] = gpu_card_find (dir, amdgpu_vram_total);
+        card.busy_percent = TRUE;
+    }
+    else if (strcmp (driver, "i915") == 0)
+        card.paths [GPU_BUSY] = gpu_card_find (dir, i915_rc6);
+    else if (strcmp (driver, "xe") == 0)
+        card.paths [GPU_BUSY] = gpu_card_find (dir, xe_idle);
+
+    /* nouveau and the other drivers keep no usable counters */
+    if (card.paths [GPU_BUSY] == NULL && card.paths [GPU_VRAM_USED] == NULL)
+    {
+        for (a = 0; a < GPU_ATTR_N; a++)
+            g_free (card.paths [a]);
+        return;
+    }
+
+    card.paths [GPU_STATUS] = gpu_card_find (dir, status);
+    g_array_append_val (sampler->cards, card);
+}
+
+GpuSampler *
+gpu_sampler_new (void)
+{
+    GpuSampler *sampler;
+    GDir *drm;
+    const gchar *name;
+
+    sampler = g_new0 (GpuSampler, 1);
+    sampler->cards = g_array_new (FALSE, FALSE, sizeof (GpuCard));
+
+    drm = g_dir_open (GPU_DRM_DIR, 0, NULL);
+    if (drm == NULL)
+        return sampler;
+
+    while ((name = g_dir_read_name (drm)) != NULL)
+    {
+        gchar *dir, *link, *driver;
+        guint number;
+        gchar end;
+
+        /* cardN, not the connectors cardN-HDMI-A-1 */
+        if (sscanf (name, "card%u%c", &number, &end) != 1)
+            continue;
+
+        dir = g_build_filename (GPU_DRM_DIR, name, NULL);
+        link = g_build_filename (dir, "device", "driver", NULL);
+        driver = g_file_read_link (link, NULL);
+        if (driver != NULL)
+        {
+            gchar *base = g_path_get_basename (driver);
+
+            gpu_sampler_add_card (sampler, dir, base);
+            g_free (base);
+        }
+        g_free (driver);
+        g_free (link);
+        g_free (dir);
+    }
+
+    g_dir_close (drm);
+
+    return sampler;
+}
+
+void
+gpu_sampler_free (GpuSampler *sampler)
+{
+    guint i, a;
+
+    if (sampler == NULL)
+        return;
+
+    for (i = 0; i < sampler->cards->len; i++)
+    {
+        GpuCard *card = &g_array_index (sampler->cards, GpuCard, i);
+
+        for (a = 0; a < GPU_ATTR_N; a++)
+        {
+            if (card->fds [a] >= 0)
+                close (card->fds [a]);
+            g_free (card->paths [a]);
+        }
+    }
+
+    g_array_free (sampler->cards, TRUE);
+    g_free (sampler);
+}
+
+static gssize
+gpu_card_pread (GpuCard *card,
+                GpuAttr  attr,
+                gchar   *buffer,
+                gsize    size)
+{
+    if (card->paths [attr] == NULL)
+        return -1;
+
+    if (card->fds [attr] < 0)
+        card->fds [attr] = sampler_open (card->paths [attr]);
+
+    return sampler_pread (&card->fds [attr], buffer, size);
+}
+
+static gboolean
+gpu_card_read_u64 (GpuCard *card,
+                   GpuAttr  attr,
+                   guint64 *value)
+{
+    gchar buffer [32];
+
+    return gpu_card_pread (card, attr, buffer, sizeof buffer) > 0 &&
+           sampler_parse_u64 (buffer, value) != NULL;
+}
+
+static void
+gpu_card_read (GpuCard *card,
+               gint64   now)
+{
+    gchar status [32];
+    guint64 value;
+
+    /* a suspended card is idle, and stays suspended */
+    if (gpu_card_pread (card, GPU_STATUS, status, sizeof status) > 0 &&
+        strcmp (status, "suspended") == 0)
+    {
+        card->busy = 0;
+        card->residency_time = 0;
+        return;
+    }
+
+    if (card->busy_percent)
+    {
+        if (gpu_card_read_u64 (card, GPU_BUSY, &value))
+            card->busy = (guint) MIN (value * 10, 1000);
+    }
+    else if (gpu_card_read_u64 (card, GPU_BUSY, &value))
+    {
+        if (card->residency_time != 0 && now > card->residency_time &&
+            value >= card->residency)
+        {
+            guint64 idle = (value - card->residency) * G_TIME_SPAN_MILLISECOND;
+            guint64 elapsed = (guint64) (now - card->residency_time);
+
+            card->busy = 1000 - (guint) (MIN (idle, elapsed) * 1000 / elapsed);
+        }
+        card->residency = value;
+        card->residency_time = now;
+    }
+
+    if (gpu_card_read_u64 (card, GPU_VRAM_USED, &value))
+        card->vram_used = value;
+    if (gpu_card_read_u64 (card, GPU_VRAM_TOTAL, &value))
+        card->vram_total = value;
+}
+
+void
+gpu_sampler_read (GpuSampler *sampler,
+                  GpuUsage   *usage)
+{
+    gint64 now;
+    guint i;
+
+    now = g_get_monotonic_time ();
+
+    if (sampler->last_read == 0 || now - sampler->last_read >= GPU_SAMPLE_INTERVAL)
+    {
+        memset (&sampler->usage, 0, sizeof sampler->usage);
+        sampler->usage.n_cards = sampler->cards->len;
+
+        for (i = 0; i < sampler->cards->len; i++)
+        {
+            GpuCard *card = &g_array_index (sampler->cards, GpuCard, i);
+
+            gpu_card_read (card, now);
+            sampler->usage.busy = MAX (sampler->usage.busy, card->busy);
+            sampler->usage.vram_used += card->vram_used;
+            sampler->usage.vram_total += card->vram_total;
+        }
+
+        sampler->last_read = now;
+    }
+
+    *usage = sampler->usage;
+}
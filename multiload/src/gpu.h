@@ -0,0 +1,32 @@
+#ifndef MATE_APPLETS_MULTILOAD_GPU_H
+#define MATE_APPLETS_MULTILOAD_GPU_H
+
+#include <glib.h>
+
+typedef struct _GpuSampler GpuSampler;
+typedef struct _GpuUsage   GpuUsage;
+
+struct _GpuUsage
+{
+    guint   n_cards;     /* cards with a supported driver */
+    guint   busy;        /* per mille, of the busiest card */
+    guint64 vram_used;   /* bytes, summed over the cards */
+    guint64 vram_total;
+};
+
+/* Samples the busy share and VRAM of the DRM cards from sysfs:
+ * gpu_busy_percent and mem_info_vram_* of amdgpu, the idle residency of
+ * the render engines of i915 and xe.
+ *
+ * A card that is runtime suspended counts as idle and is not read, as
+ * reading the counters of most drivers resumes the device. Cards are
+ * read at most every GPU_SAMPLE_INTERVAL, faster samples repeat the
+ * last values. */
+#define GPU_SAMPLE_INTERVAL (500 * G_TIME_SPAN_MILLISECOND)
+
+G_GNUC_INTERNAL GpuSampler *gpu_sampler_new  (void);
+G_GNUC_INTERNAL void        gpu_sampler_free (GpuSampler *sampler);
+G_GNUC_INTERNAL void        gpu_sampler_read (GpuSampler *sampler,
+                                              GpuUsage   *usage);
+
+#endif /* MATE_APPLETS_MULTILOAD_GPU_H */
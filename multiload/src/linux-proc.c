@@ -4,6 +4,7 @@
 #include <sys/statvfs.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <net/if.h>
 
 #include <glibtop.h>
 #include <glibtop/cpu.h>
@@ -14,9 +15,14 @@
 #include <glibtop/netlist.h>
 #include <glibtop/mountlist.h>
 #include <glibtop/fsusage.h>
+#include <glibtop/sysinfo.h>
 
 #include "linux-proc.h"
 #include "autoscaler.h"
+#include "diskstats.h"
+#include "fixedpoint.h"
+#include "common/sampler-netlink.h"
+#include "procfs.h"
 
 static const unsigned needed_cpu_flags =
 (1 << GLIBTOP_CPU_USER) +
@@ -45,28 +51,59 @@ static const unsigned needed_netload_flags =
 (1 << GLIBTOP_NETLOAD_IF_FLAGS) +
 (1 << GLIBTOP_NETLOAD_BYTES_TOTAL);
 
+/* Whether the instance owning the export read the part of bit for this
+ * one, into multiload->reading. Either way that part is filled for the
+ * export once the collector is done. */
+static gboolean
+take_reading (MultiloadApplet *multiload,
+              guint32          bit)
+{
+    multiload->reading_read |= bit;
+
+    return multiload_export_take (multiload->export, bit, multiload->sampler_speed,
+                                  &multiload->reading);
+}
+
 void
 GetLoad (guint64    Maximum,
          guint64    data [cpuload_n],
          LoadGraph *g)
 {
     MultiloadApplet *multiload;
-    glibtop_cpu cpu;
+    MultiloadExportReading *reading;
+    ProcfsCpu cpu;
     guint64 cpu_aux [cpuload_n], used = 0, total = 0;
-    guint64 current_scaled, used_scaled = 0;
+    guint64 used_scaled;
     unsigned i;
 
-    glibtop_get_cpu (&cpu);
+    multiload = g->multiload;
+    reading = &multiload->reading;
 
-    g_return_if_fail ((cpu.flags & needed_cpu_flags) == needed_cpu_flags);
+    if (!take_reading (multiload, MULTILOAD_EXPORT_CPU)) {
+        if (!procfs_get_cpu (&cpu)) {
+            glibtop_cpu gcpu;
 
-    multiload = g->multiload;
+            glibtop_get_cpu (&gcpu);
 
-    multiload->cpu_time [cpuload_usr]    = cpu.user;
-    multiload->cpu_time [cpuload_nice]   = cpu.nice;
-    multiload->cpu_time [cpuload_sys]    = cpu.sys;
-    multiload->cpu_time [cpuload_iowait] = cpu.iowait + cpu.irq + cpu.softirq;
-    multiload->cpu_time [cpuload_free]   = cpu.idle;
+            g_return_if_fail ((gcpu.flags & needed_cpu_flags) == needed_cpu_flags);
+
+            cpu.user    = gcpu.user;
+            cpu.nice    = gcpu.nice;
+            cpu.sys     = gcpu.sys;
+            cpu.idle    = gcpu.idle;
+            cpu.iowait  = gcpu.iowait;
+            cpu.irq     = gcpu.irq;
+            cpu.softirq = gcpu.softirq;
+        }
+
+        reading->cpu_time [cpuload_usr]    = cpu.user;
+        reading->cpu_time [cpuload_nice]   = cpu.nice;
+        reading->cpu_time [cpuload_sys]    = cpu.sys;
+        reading->cpu_time [cpuload_iowait] = cpu.iowait + cpu.irq + cpu.softirq;
+        reading->cpu_time [cpuload_free]   = cpu.idle;
+    }
+
+    memcpy (multiload->cpu_time, reading->cpu_time, sizeof (multiload->cpu_time));
 
     if (!multiload->cpu_initialized) {
         memcpy (multiload->cpu_last, multiload->cpu_time, sizeof (multiload->cpu_last));
@@ -78,12 +115,10 @@ GetLoad (guint64    Maximum,
         total += cpu_aux [i];
     }
 
-    for (i = 0; i < cpuload_free; i++) {
+    for (i = 0; i < cpuload_free; i++)
         used += cpu_aux [i];
-        current_scaled = (guint64) ((float)(cpu_aux [i] * Maximum) / (float)total);
-        used_scaled += current_scaled;
-        data [i] = current_scaled;
-    }
+
+    used_scaled = fixedpoint_scale_stack (cpu_aux, cpuload_free, Maximum, total, data);
     data [cpuload_free] = Maximum - used_scaled;
 
     multiload->cpu_used_ratio = (float)(used) / (float)total;
@@ -91,6 +126,121 @@ GetLoad (guint64    Maximum,
     memcpy (multiload->cpu_last, multiload->cpu_time, sizeof multiload->cpu_last);
 }
 
+guint
+multiload_get_ncpu (void)
+{
+    const glibtop_sysinfo *sysinfo;
+
+    sysinfo = glibtop_get_sysinfo ();
+
+    return CLAMP ((guint) sysinfo->ncpu, 1, GLIBTOP_NCPU);
+}
+
+/* Stores a scaled busy fraction per core, for the heat map */
+void
+GetLoadPerCore (guint64    Maximum,
+                guint64    data [],
+                LoadGraph *g)
+{
+    static ProcfsCpu *cores = NULL;
+    static guint cores_size = 0;
+
+    MultiloadApplet *multiload;
+    guint64 used_sum = 0, total_sum = 0;
+    guint ncpu, i;
+
+    multiload = g->multiload;
+    ncpu = g->n_values;
+
+    if (cores_size < ncpu) {
+        cores = g_renew (ProcfsCpu, cores, ncpu);
+        cores_size = ncpu;
+    }
+    memset (cores, 0, ncpu * sizeof cores [0]);
+
+    /* both paths read all cores at once */
+    if (procfs_get_cpus (cores, ncpu) == 0) {
+        glibtop_cpu cpu;
+
+        glibtop_get_cpu (&cpu);
+
+        g_return_if_fail ((cpu.flags & needed_cpu_flags) == needed_cpu_flags);
+
+        for (i = 0; i < MIN (ncpu, GLIBTOP_NCPU); i++) {
+            cores [i].user    = cpu.xcpu_user [i];
+            cores [i].nice    = cpu.xcpu_nice [i];
+            cores [i].sys     = cpu.xcpu_sys [i];
+            cores [i].idle    = cpu.xcpu_idle [i];
+            cores [i].iowait  = cpu.xcpu_iowait [i];
+            cores [i].irq     = cpu.xcpu_irq [i];
+            cores [i].softirq = cpu.xcpu_softirq [i];
+        }
+    }
+
+    for (i = 0; i < ncpu; i++) {
+        guint64 *last = &multiload->cpu_core_last [2 * i];
+        guint64 total, used, total_diff, used_diff;
+
+        total = cores [i].user + cores [i].nice + cores [i].sys + cores [i].idle +
+                cores [i].iowait + cores [i].irq + cores [i].softirq;
+        used = total - cores [i].idle;
+
+        /* offline cores read as 0, do not wrap around */
+        total_diff = total >= last [1] ? total - last [1] : 0;
+        used_diff = used >= last [0] ? used - last [0] : 0;
+
+        data [i] = fixedpoint_scale (MIN (used_diff, total_diff), Maximum, total_diff);
+
+        last [0] = used;
+        last [1] = total;
+        used_sum += used_diff;
+        total_sum += total_diff;
+    }
+
+    if (total_sum > 0)
+        multiload->cpu_used_ratio = (float) used_sum / (float) total_sum;
+    else
+        multiload->cpu_used_ratio = 0.0f;
+}
+
+/* Portable fallback summing the per-mount statistics, used where
+ * /proc/diskstats is not available */
+static void
+get_mounts_disk_usage (guint64 *read,
+                       guint64 *write)
+{
+    glibtop_mountlist mountlist;
+    glibtop_mountentry *mountentries;
+    guint i;
+
+    mountentries = glibtop_get_mountlist (&mountlist, FALSE);
+
+    for (i = 0; i < mountlist.number; i++)
+    {
+        struct statvfs statresult;
+        glibtop_fsusage fsusage;
+
+        if (strstr (mountentries[i].devname, "/dev/") == NULL)
+            continue;
+
+        if (strstr (mountentries[i].mountdir, "/media/") != NULL)
+            continue;
+
+        if (statvfs (mountentries[i].mountdir, &statresult) < 0)
+        {
+            g_debug ("Failed to get statistics for mount entry: %s. Reason: %s. Skipping entry.",
+                     mountentries[i].mountdir, strerror(errno));
+            continue;
+        }
+
+        glibtop_get_fsusage(&fsusage, mountentries[i].mountdir);
+        *read += fsusage.read;
+        *write += fsusage.write;
+    }
+
+    g_free(mountentries);
+}
+
 void
 GetDiskLoad (guint64    Maximum,
              guint64    data [diskload_n],
@@ -103,88 +253,51 @@ GetDiskLoad (guint64    Maximum,
     guint64 max;
     guint64 read, write;
     guint64 readdiff, writediff;
-    guint   i;
+    guint64 diff [diskload_free];
 
     MultiloadApplet *multiload;
 
     multiload = g->multiload;
 
-    if(first_call)
+    /* the scale follows the largest sample the graph shows */
+    if (scaler.peak.size != g->draw_width)
     {
-        autoscaler_init (&scaler, g->speed, 500);
+        autoscaler_clear (&scaler);
+        autoscaler_init (&scaler, g->draw_width, 500);
     }
 
     read = write = 0;
 
     if (multiload->nvme_diskstats)
     {
-        FILE *fdr;
-        char line[255];
-        guint64 s_read, s_write;
+        static Diskstats *nvme_stats = NULL;
+
+        if (nvme_stats == NULL)
+            nvme_stats = diskstats_new (diskstats_match_nvme);
 
-        fdr = fopen("/proc/diskstats", "r");
-        if (!fdr)
+        if (!diskstats_read (nvme_stats, &read, &write))
         {
+            diskstats_free (nvme_stats);
+            nvme_stats = NULL;
             multiload->nvme_diskstats = FALSE;
             g_settings_set_boolean (multiload->settings, "diskload-nvme-diskstats", FALSE);
             return;
         }
-
-        while (fgets(line, 255, fdr))
-        {
-            /* Match main device, rather than individual partitions (e.g. nvme0n1) */
-            if (!g_regex_match_simple("\\snvme\\d+\\w+\\d+\\s", line, 0, 0))
-            {
-                continue;
-            }
-
-            /*
-               6 - sectors read
-               10 - sectors written
-               */
-            if (sscanf(line, "%*d %*d %*s %*d %*d %ld %*d %*d %*d %ld", &s_read, &s_write) == 2)
-            {
-                read += 512 * s_read;
-                write += 512 * s_write;
-            }
-        }
-        fclose(fdr);
     }
     else
     {
-        glibtop_mountlist mountlist;
-        glibtop_mountentry *mountentries;
-
-        mountentries = glibtop_get_mountlist (&mountlist, FALSE);
+        static Diskstats *block_stats = NULL;
 
-        for (i = 0; i < mountlist.number; i++)
-        {
-            struct statvfs statresult;
-            glibtop_fsusage fsusage;
-
-            if (strstr (mountentries[i].devname, "/dev/") == NULL)
-                continue;
+        if (block_stats == NULL)
+            block_stats = diskstats_new (diskstats_match_physical);
 
-            if (strstr (mountentries[i].mountdir, "/media/") != NULL)
-                continue;
-
-            if (statvfs (mountentries[i].mountdir, &statresult) < 0)
-            {
-                g_debug ("Failed to get statistics for mount entry: %s. Reason: %s. Skipping entry.",
-                         mountentries[i].mountdir, strerror(errno));
-                continue;
-            }
-
-            glibtop_get_fsusage(&fsusage, mountentries[i].mountdir);
-            read += fsusage.read;
-            write += fsusage.write;
-        }
-
-        g_free(mountentries);
+        if (!diskstats_read (block_stats, &read, &write))
+            get_mounts_disk_usage (&read, &write);
     }
 
-    readdiff  = read - lastread;
-    writediff = write - lastwrite;
+    /* devices went away, do not wrap around */
+    readdiff  = read >= lastread ? read - lastread : 0;
+    writediff = write >= lastwrite ? write - lastwrite : 0;
 
     lastread  = read;
     lastwrite = write;
@@ -196,13 +309,20 @@ GetDiskLoad (guint64    Maximum,
         return;
     }
 
+    /* a backfilled sample covers several periods, scale it to one */
+    if (g->interval > g->speed)
+    {
+        readdiff  = fixedpoint_scale (readdiff, g->speed, g->interval);
+        writediff = fixedpoint_scale (writediff, g->speed, g->interval);
+    }
+
     max = autoscaler_get_max(&scaler, readdiff + writediff);
 
     multiload->diskload_used_ratio = (float)(readdiff + writediff) / (float)max;
 
-    data [diskload_read]  = (guint64) ((float)Maximum *  (float)readdiff / (float)max);
-    data [diskload_write] = (guint64) ((float)Maximum * (float)writediff / (float)max);
-    data [diskload_free]  = Maximum - (data [0] + data[1]);
+    diff [diskload_read]  = readdiff;
+    diff [diskload_write] = writediff;
+    data [diskload_free]  = Maximum - fixedpoint_scale_stack (diff, diskload_free, Maximum, max, data);
 }
 
 /* GNU/Linux:
@@ -223,14 +343,42 @@ GetMemory (guint64    Maximum,
            LoadGraph *g)
 {
     MultiloadApplet *multiload;
+    MultiloadExportReading *reading;
     glibtop_mem mem;
+    ProcfsMem meminfo;
     guint64 aux [memload_n], cache = 0;
-    guint64 current_scaled, used_scaled = 0;
+    guint64 used_scaled;
     int i;
 
-    glibtop_get_mem (&mem);
+    multiload = g->multiload;
+    reading = &multiload->reading;
+
+    if (take_reading (multiload, MULTILOAD_EXPORT_MEMORY)) {
+        mem.total  = reading->mem_total;
+        mem.free   = reading->mem_free;
+        mem.buffer = reading->mem_buffer;
+        mem.cached = reading->mem_cached;
+        mem.shared = reading->mem_shared;
+#ifndef __linux__
+        mem.user   = mem.total - mem.free - mem.buffer - mem.cached;
+#endif /* __linux__ */
+    } else if (procfs_get_mem (&meminfo)) {
+        mem.total  = meminfo.total;
+        mem.free   = meminfo.free;
+        mem.buffer = meminfo.buffer;
+        mem.cached = meminfo.cached;
+        mem.shared = meminfo.shared;
+    } else {
+        glibtop_get_mem (&mem);
+
+        g_return_if_fail ((mem.flags & needed_mem_flags) == needed_mem_flags);
+    }
 
-    g_return_if_fail ((mem.flags & needed_mem_flags) == needed_mem_flags);
+    reading->mem_total  = mem.total;
+    reading->mem_free   = mem.free;
+    reading->mem_buffer = mem.buffer;
+    reading->mem_cached = mem.cached;
+    reading->mem_shared = mem.shared;
 
 #ifndef __linux__
     aux [memload_user]   = mem.user;
@@ -243,16 +391,14 @@ GetMemory (guint64    Maximum,
     aux [memload_buffer] = mem.buffer;
 
     for (i = 0; i < memload_free; i++) {
-        current_scaled = (guint64) ((float)(aux [i] * Maximum) / (float)mem.total);
         if (i != memload_user) {
             cache += aux [i];
         }
-        used_scaled += current_scaled;
-        data [i] = current_scaled;
     }
-    data [memload_free] = MAX (Maximum - used_scaled, 0);
 
-    multiload = g->multiload;
+    used_scaled = fixedpoint_scale_stack (aux, memload_free, Maximum, mem.total, data);
+    data [memload_free] = Maximum - used_scaled;
+
     multiload->memload_user  = aux [memload_user];
     multiload->memload_cache = cache;
     multiload->memload_total = mem.total;
@@ -266,22 +412,31 @@ GetSwap (guint64    Maximum,
     guint64 used;
     MultiloadApplet *multiload;
     glibtop_swap swap;
-
-    glibtop_get_swap (&swap);
-    g_return_if_fail ((swap.flags & needed_swap_flags) == needed_swap_flags);
+    ProcfsMem meminfo;
 
     multiload = g->multiload;
 
+    if (take_reading (multiload, MULTILOAD_EXPORT_SWAP)) {
+        swap.total = multiload->reading.swap_total;
+        swap.used  = multiload->reading.swap_used;
+    } else if (procfs_get_mem (&meminfo)) {
+        swap.total = meminfo.swap_total;
+        swap.used  = meminfo.swap_total - meminfo.swap_free;
+    } else {
+        glibtop_get_swap (&swap);
+        g_return_if_fail ((swap.flags & needed_swap_flags) == needed_swap_flags);
+    }
+
+    multiload->reading.swap_total = swap.total;
+    multiload->reading.swap_used  = swap.used;
+
     if (swap.total == 0) {
         used = 0;
         multiload->swapload_used_ratio = 0.0f;
     }
     else {
-        float ratio;
-
-        ratio = (float)swap.used / (float)swap.total;
-        used = (guint64) ((float) Maximum * ratio);
-        multiload->swapload_used_ratio = ratio;
+        used = fixedpoint_scale (MIN (swap.used, swap.total), Maximum, swap.total);
+        multiload->swapload_used_ratio = (float)swap.used / (float)swap.total;
     }
 
     data [0] = used;
@@ -293,20 +448,184 @@ GetLoadAvg (guint64    Maximum,
             guint64    data [2],
             LoadGraph *g)
 {
-    glibtop_loadavg loadavg;
+    double load1;
     MultiloadApplet *multiload;
 
-    glibtop_get_loadavg (&loadavg);
+    multiload = g->multiload;
 
-    g_return_if_fail ((loadavg.flags & needed_loadavg_flags) == needed_loadavg_flags);
+    if (take_reading (multiload, MULTILOAD_EXPORT_LOADAVG)) {
+        load1 = multiload->reading.load1;
+    } else if (!procfs_get_loadavg (&load1)) {
+        glibtop_loadavg loadavg;
 
-    multiload = g->multiload;
-    multiload->loadavg1 = loadavg.loadavg[0];
+        glibtop_get_loadavg (&loadavg);
+
+        g_return_if_fail ((loadavg.flags & needed_loadavg_flags) == needed_loadavg_flags);
+
+        load1 = loadavg.loadavg[0];
+    }
 
-    data [0] = (guint64) ((float) Maximum * loadavg.loadavg[0]);
+    multiload->reading.load1 = load1;
+    multiload->loadavg1 = load1;
+
+    data [0] = (guint64) ((float) Maximum * load1);
     data [1] = Maximum - data[0];
 }
 
+/* Pressure stall information: the share of time in which some task was
+ * waiting for the CPU, memory or I/O. The three overlap, so a graph
+ * stalled on more than all of the interval is scaled down to fit. */
+void
+GetPsi (guint64    Maximum,
+        guint64    data [psi_n],
+        LoadGraph *g)
+{
+    static guint64 last [psi_free];
+    static gint64 last_time = 0;
+    guint64 totals [psi_free], stalled [psi_free];
+    guint64 elapsed, sum = 0;
+    MultiloadApplet *multiload;
+    gint64 now;
+    guint i;
+
+    multiload = g->multiload;
+    now = g_get_monotonic_time ();
+
+    memset (data, 0, psi_n * sizeof data [0]);
+    data [psi_free] = Maximum;
+
+    if (!procfs_get_pressure (totals))
+        return;
+
+    /* PSI triggers take extra samples, so use the real interval */
+    elapsed = last_time != 0 && now > last_time ? (guint64) (now - last_time) : 0;
+
+    for (i = 0; i < psi_free; i++)
+    {
+        stalled [i] = totals [i] >= last [i] ? totals [i] - last [i] : 0;
+        last [i] = totals [i];
+        sum += stalled [i];
+    }
+    last_time = now;
+
+    if (elapsed == 0)
+        return;
+
+    for (i = 0; i < psi_free; i++)
+        multiload->psi_ratio [i] = MIN ((float) stalled [i] / (float) elapsed, 1.0f);
+
+    data [psi_free] = Maximum - fixedpoint_scale_stack (stalled, psi_free, Maximum,
+                                                         MAX (sum, elapsed), data);
+}
+
+/* CPU time of the selected cgroups, as shares of all processors. The
+ * cgroups may be nested, so they are scaled down if they add up to more
+ * time than the processors had. Their memory and I/O go to the tooltip. */
+void
+GetCgroup (guint64    Maximum,
+           guint64    data [cgroup_n],
+           LoadGraph *g)
+{
+    static guint ncpu = 0;
+    CgroupUsage *usage;
+    guint64 cpu [cgroup_free] = { 0 };
+    guint64 elapsed, sum = 0;
+    MultiloadApplet *multiload;
+    guint n, i;
+
+    multiload = g->multiload;
+    usage = multiload->cgroup_usage;
+
+    memset (data, 0, cgroup_n * sizeof data [0]);
+    data [cgroup_free] = Maximum;
+
+    if (ncpu == 0)
+        ncpu = multiload_get_ncpu ();
+
+    /* dropped when the list of units changes */
+    if (multiload->cgroups == NULL)
+    {
+        static const gchar * const bench_units [] = { "system.slice", "user.slice", NULL };
+        gchar **units;
+
+        /* multiload-bench has no settings */
+        if (multiload->settings == NULL)
+        {
+            multiload->cgroups = cgroup_sampler_new (bench_units);
+        }
+        else
+        {
+            units = g_settings_get_strv (multiload->settings, CGROUP_UNITS_KEY);
+            multiload->cgroups = cgroup_sampler_new ((const gchar * const *) units);
+            g_strfreev (units);
+        }
+    }
+
+    n = MIN (cgroup_sampler_get_n (multiload->cgroups), cgroup_free);
+    elapsed = (guint64) cgroup_sampler_read (multiload->cgroups, usage);
+    multiload->cgroup_elapsed = (gint64) elapsed;
+
+    if (elapsed == 0)
+        return;
+
+    for (i = 0; i < n; i++)
+    {
+        if (!usage [i].valid)
+            continue;
+
+        cpu [i] = usage [i].cpu;
+        sum += cpu [i];
+    }
+
+    data [cgroup_free] = Maximum - fixedpoint_scale_stack (cpu, cgroup_free, Maximum,
+                                                            MAX (sum, elapsed * ncpu), data);
+}
+
+/* The busy share of the busiest GPU. Its VRAM goes to the tooltip. */
+void
+GetGpu (guint64    Maximum,
+        guint64    data [gpuload_n],
+        LoadGraph *g)
+{
+    MultiloadApplet *multiload;
+
+    multiload = g->multiload;
+
+    if (multiload->gpu == NULL)
+        multiload->gpu = gpu_sampler_new ();
+
+    gpu_sampler_read (multiload->gpu, &multiload->gpu_usage);
+
+    data [gpuload_used] = fixedpoint_scale (multiload->gpu_usage.busy, Maximum, 1000);
+    data [gpuload_free] = Maximum - data [gpuload_used];
+}
+
+/* The hottest sensor, over a fixed range so that graphs compare */
+#define THERMAL_GRAPH_MAX 110000 /* millidegrees Celsius */
+
+void
+GetThermal (guint64    Maximum,
+            guint64    data [thermal_n],
+            LoadGraph *g)
+{
+    MultiloadApplet *multiload;
+    gint hottest;
+
+    multiload = g->multiload;
+
+    if (multiload->thermal == NULL)
+        multiload->thermal = thermal_sampler_new ();
+
+    multiload->thermal_valid = thermal_sampler_read (multiload->thermal,
+                                                     &multiload->thermal_reading);
+
+    hottest = multiload->thermal_valid ? multiload->thermal_reading.hottest : 0;
+    hottest = CLAMP (hottest, 0, THERMAL_GRAPH_MAX);
+
+    data [thermal_temp] = fixedpoint_scale ((guint64) hottest, Maximum, THERMAL_GRAPH_MAX);
+    data [thermal_free] = Maximum - data [thermal_temp];
+}
+
 /*
  * Return true if a network device (identified by its name) is virtual
  * (ie: not corresponding to a physical device). In case it is a physical
@@ -348,6 +667,35 @@ is_net_device_virtual(char *device)
     return ret;
 }
 
+/* Same as is_net_device_virtual (), but only looks again after rtnetlink
+ * reported a change to the interfaces */
+static gboolean
+is_net_device_virtual_cached (char *device)
+{
+    static GHashTable *cache = NULL;
+    static guint generation = 0;
+    guint current;
+    gpointer value;
+    gboolean ret;
+
+    current = netlink_link_generation ();
+
+    if (cache == NULL)
+        cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    else if (generation != current)
+        g_hash_table_remove_all (cache);
+
+    generation = current;
+
+    if (g_hash_table_lookup_extended (cache, device, NULL, &value))
+        return GPOINTER_TO_INT (value);
+
+    ret = is_net_device_virtual (device);
+    g_hash_table_insert (cache, g_strdup (device), GINT_TO_POINTER (ret));
+
+    return ret;
+}
+
 void
 GetNet (guint64    Maximum,
         guint64    data [4],
@@ -365,6 +713,8 @@ GetNet (guint64    Maximum,
 
     guint64 present[COUNT_TYPES] = {0};
 
+    static GArray *links = NULL;
+
     guint i;
     gchar **devices;
     glibtop_netlist netlist;
@@ -372,37 +722,74 @@ GetNet (guint64    Maximum,
     MultiloadApplet *multiload;
 
     multiload = g->multiload;
-    devices = glibtop_get_netlist(&netlist);
 
-    for(i = 0; i < netlist.number; ++i)
+    if (links == NULL)
+        links = g_array_new (FALSE, FALSE, sizeof (NetlinkLink));
+
+    if (take_reading (multiload, MULTILOAD_EXPORT_NET))
     {
-        glibtop_netload netload;
+        memcpy (present, multiload->reading.net_bytes, sizeof present);
+    }
+    /* one rtnetlink dump covers every interface */
+    else if (netlink_get_links (links))
+    {
+        for (i = 0; i < links->len; i++)
+        {
+            NetlinkLink *link = &g_array_index (links, NetlinkLink, i);
 
-        glibtop_get_netload(&netload, devices[i]);
+            if (!(link->flags & IFF_UP))
+                continue;
 
-        g_return_if_fail((netload.flags & needed_netload_flags) == needed_netload_flags);
+            if (link->flags & IFF_LOOPBACK) {
+                /* for loopback in and out are identical, so only count in */
+                present[LOCAL_COUNT] += link->rx_bytes;
+                continue;
+            }
 
-        if (!(netload.if_flags & (1L << GLIBTOP_IF_FLAGS_UP)))
-            continue;
+            if (is_net_device_virtual_cached (link->name))
+                continue;
 
-        if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_LOOPBACK)) {
-            /* for loopback in and out are identical, so only count in */
-            present[LOCAL_COUNT] += netload.bytes_in;
-            continue;
+            present[IN_COUNT] += link->rx_bytes;
+            present[OUT_COUNT] += link->tx_bytes;
         }
+    }
+    else
+    {
+        devices = glibtop_get_netlist(&netlist);
 
-        /*
-         * Do not include virtual devices (VPN, PPPOE...) to avoid
-         * counting the same throughput several times.
-         */
-        if (is_net_device_virtual(devices[i]))
-            continue;
+        for(i = 0; i < netlist.number; ++i)
+        {
+            glibtop_netload netload;
 
-        present[IN_COUNT] += netload.bytes_in;
-        present[OUT_COUNT] += netload.bytes_out;
+            glibtop_get_netload(&netload, devices[i]);
+
+            g_return_if_fail((netload.flags & needed_netload_flags) == needed_netload_flags);
+
+            if (!(netload.if_flags & (1L << GLIBTOP_IF_FLAGS_UP)))
+                continue;
+
+            if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_LOOPBACK)) {
+                /* for loopback in and out are identical, so only count in */
+                present[LOCAL_COUNT] += netload.bytes_in;
+                continue;
+            }
+
+            /*
+             * Do not include virtual devices (VPN, PPPOE...) to avoid
+             * counting the same throughput several times.
+             */
+            if (is_net_device_virtual_cached (devices[i]))
+                continue;
+
+            present[IN_COUNT] += netload.bytes_in;
+            present[OUT_COUNT] += netload.bytes_out;
+        }
+
+        g_strfreev(devices);
     }
 
-    g_strfreev(devices);
+    memcpy (multiload->reading.net_bytes, present, sizeof present);
+
     netspeed_add (multiload->netspeed_in, present[IN_COUNT]);
     netspeed_add (multiload->netspeed_out, present[OUT_COUNT]);
 
@@ -414,12 +801,11 @@ GetNet (guint64    Maximum,
     else
     {
         data[COUNT_TYPES] = 0;
-        float seconds = (float) g->speed / 1000.0f;
         for (i = 0; i < COUNT_TYPES; i++)
         {
             /* protect against weirdness */
             if (present[i] >= past[i])
-                data[i] = (guint) ((float) (present[i] - past[i]) / seconds);
+                data[i] = fixedpoint_rate (present[i] - past[i], g->interval);
             else
                 data[i] = 0;
             data[COUNT_TYPES] += data[i];
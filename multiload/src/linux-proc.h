@@ -4,10 +4,18 @@
 #include <load-graph.h>
 
 G_GNUC_INTERNAL void GetLoad     (guint64 Maximum, guint64 data [cpuload_n],  LoadGraph *g);
+G_GNUC_INTERNAL void GetLoadPerCore (guint64 Maximum, guint64 data [],          LoadGraph *g);
 G_GNUC_INTERNAL void GetDiskLoad (guint64 Maximum, guint64 data [diskload_n], LoadGraph *g);
 G_GNUC_INTERNAL void GetMemory   (guint64 Maximum, guint64 data [memload_n],  LoadGraph *g);
 G_GNUC_INTERNAL void GetSwap     (guint64 Maximum, guint64 data [swapload_n], LoadGraph *g);
 G_GNUC_INTERNAL void GetLoadAvg  (guint64 Maximum, guint64 data [2],          LoadGraph *g);
+G_GNUC_INTERNAL void GetPsi      (guint64 Maximum, guint64 data [psi_n],      LoadGraph *g);
+G_GNUC_INTERNAL void GetCgroup   (guint64 Maximum, guint64 data [cgroup_n],   LoadGraph *g);
+G_GNUC_INTERNAL void GetGpu      (guint64 Maximum, guint64 data [gpuload_n],  LoadGraph *g);
+G_GNUC_INTERNAL void GetThermal  (guint64 Maximum, guint64 data [thermal_n],  LoadGraph *g);
 G_GNUC_INTERNAL void GetNet      (guint64 Maximum, guint64 data [4],          LoadGraph *g);
 
+/* number of CPUs for the per-core graph */
+G_GNUC_INTERNAL guint multiload_get_ncpu (void);
+
 #endif
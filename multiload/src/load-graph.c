@@ -14,110 +14,401 @@
 #include <mate-panel-applet-gsettings.h>
 #include <math.h>
 
+#include "common/applet-probe.h"
+#include "common/sampler-tick.h"
+
 #include "global.h"
 
-/*
-  Shifts data right
+/* columns covered by the network graph level indicator */
+#define LOAD_GRAPH_INDICATOR_COLUMNS 7
 
-  data[i+1] = data[i]
+/* milliseconds per column of each decimated history level */
+static const guint load_graph_level_intervals [LOAD_GRAPH_LEVELS] = { 1000, 10000, 60000 };
 
-  data[i] are int*, so we just move the pointer, not the data.
-  But moving data loses data[n-1], so we save data[n-1] and reuse
-  it as new data[0]. In fact, we rotate data[].
+/*
+  Pushes a new sample into the history ring
 
+  The history is a single block of draw_width samples of n_values each.
+  g->head is the column of the newest sample, so moving it one column back
+  turns the oldest sample into the slot for the new one.
 */
 
-static void
-shift_right(LoadGraph *g)
+static guint64 *
+load_graph_push (LoadGraph *g)
+{
+    g->head = (g->head == 0) ? g->draw_width - 1 : g->head - 1;
+
+    return g->data + g->head * g->n_values;
+}
+
+/* Adds the newest sample to the open bucket of every history level and
+ * closes the buckets that are complete. Returns TRUE when the history
+ * being shown got a new column. */
+static gboolean
+load_graph_levels_add (LoadGraph     *g,
+                       const guint64 *sample)
 {
-    guint64 *last_data;
-    gsize i;
+    gboolean shown_changed = (g->level == 0);
+    guint l, j;
+
+    if (g->peak_value >= 0)
+        window_max_push (&g->peaks [0], sample [g->peak_value]);
 
-    /* data[g->draw_width - 1] becomes data[0] */
-    last_data = g->data[g->draw_width - 1];
+    for (l = 0; l < LOAD_GRAPH_LEVELS; l++)
+    {
+        LoadGraphLevel *level = &g->levels [l];
+        guint64 *avg, *max;
+        guint64 cumulative = 0, previous = 0;
+
+        for (j = 0; j < g->n_values; j++)
+        {
+            level->sum [j] += sample [j];
+            level->max [j] = MAX (level->max [j], sample [j]);
+        }
+        level->count++;
+        level->elapsed += g->speed;
+
+        if (level->elapsed < level->interval)
+            continue;
 
-    /* data[i+1] = data[i] */
-    for (i = g->draw_width - 1; i != 0; --i)
-      g->data[i] = g->data[i - 1];
+        level->head = (level->head == 0) ? g->draw_width - 1 : level->head - 1;
+        level->filled = MIN (level->filled + 1, g->draw_width);
+        avg = level->avg_ring + level->head * g->n_values;
+        max = level->max_ring + level->head * g->n_values;
+
+        /* rounding the running sum rather than each value keeps the
+         * averages of stacked values adding up to the graph height */
+        for (j = 0; j < g->n_values; j++)
+        {
+            guint64 boundary;
+
+            cumulative += level->sum [j];
+            boundary = cumulative / level->count;
+            avg [j] = boundary - previous;
+            previous = boundary;
+        }
+        memcpy (max, level->max, g->n_values * sizeof max [0]);
+        if (g->peak_value >= 0)
+            window_max_push (&g->peaks [l + 1], max [g->peak_value]);
+
+        memset (level->sum, 0, g->n_values * sizeof level->sum [0]);
+        memset (level->max, 0, g->n_values * sizeof level->max [0]);
+        level->count = 0;
+        /* the time past the end of the bucket counts towards the next
+         * one, so the buckets do not drift; a sample slower than a
+         * bucket closes one bucket only */
+        level->elapsed %= level->interval;
+
+        if (l + 1 == g->level)
+            shown_changed = TRUE;
+    }
 
-    g->data[0] = last_data;
+    return shown_changed;
 }
 
-/* Redraws the backing pixmap for the load graph and updates the window */
-static void
-load_graph_draw (LoadGraph *g)
+/* Returns column i of the history being shown, 0 being the newest one.
+ * Decimated levels return the averages of each bucket, or the maxima
+ * when peak is set. */
+static const guint64 *
+load_graph_get_column (LoadGraph *g,
+                       gsize      i,
+                       gboolean   peak)
 {
-  guint i, j, k;
-  cairo_t *cr;
-  MultiloadApplet *multiload;
+    LoadGraphLevel *level;
+    gsize column;
 
-  multiload = g->multiload;
+    if (g->level == 0)
+        return load_graph_get_sample (g, i);
 
-  /* we might get called before the configure event so that
-   * g->disp->allocation may not have the correct size
-   * (after the user resized the applet in the prop dialog). */
+    level = &g->levels [g->level - 1];
 
-  if (!g->surface)
-    g->surface = gdk_window_create_similar_surface (gtk_widget_get_window (g->disp),
-                                                    CAIRO_CONTENT_COLOR,
-                                                    (int) g->draw_width,
-                                                    (int) g->draw_height);
+    column = level->head + i;
+    if (column >= g->draw_width)
+        column -= g->draw_width;
 
-  cr = cairo_create (g->surface);
-  cairo_set_line_width (cr, 1.0);
-  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-  cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+    return (peak ? level->max_ring : level->avg_ring) + column * g->n_values;
+}
 
-  /* all graphs except Load and Net go this path */
+/* The value of the samples whose maximum over the shown history sets
+ * the scale, or -1 for graphs with a fixed scale */
+static gint
+load_graph_peak_value (LoadGraph *g)
+{
   switch (g->id) {
+  case graph_netload2:
+    return 3;
+  case graph_loadavg:
+    return 0;
+  default:
+    return -1;
+  }
+}
 
-  /* This is for network graph */
+/* Computes the vertical scale of the graph from the whole history.
+ * The network and load average graphs rescale as old samples scroll
+ * out, and need a full repaint whenever the scale changes. The maxima
+ * come from g->peaks, which follow the history as it is pushed. */
+static void
+load_graph_get_scale (LoadGraph *g,
+                      guint64   *threshold,
+                      guint64   *segments,
+                      guint     *level)
+{
+  MultiloadApplet *multiload;
+  guint64 peak;
+
+  multiload = g->multiload;
+  peak = window_max_get (&g->peaks [g->level]);
+
+  *threshold = 1;
+  *segments = 1;
+  *level = 0;
+
+  switch (g->id) {
   case graph_netload2: {
-    guint64 maxnet = 1;
-    guint64 segments = 1;
-    guint64 net_threshold;
-    guint   level = 0;
-    double  ratio;
-    double  spacing;
-
-    for (i = 0; i < g->draw_width; i++)
-    {
-      g->pos [i] = g->draw_height - 1;
-      if (g->data[i][3] > maxnet)
-        maxnet = g->data[i][3];
-    }
-    //printf("max = %d ", maxnet);
+    guint64 maxnet = MAX (peak, 1);
+
     if (maxnet > multiload->net_threshold3) {
-      net_threshold = multiload->net_threshold3;
-      level = 3;
+      *threshold = multiload->net_threshold3;
+      *level = 3;
     }
     else
       if (maxnet > multiload->net_threshold2) {
-        net_threshold = multiload->net_threshold2;
-        level = 2;
+        *threshold = multiload->net_threshold2;
+        *level = 2;
       }
       else {
-        net_threshold = multiload->net_threshold1;
+        *threshold = multiload->net_threshold1;
         if (maxnet >= multiload->net_threshold1)
-            level = 1;
+          *level = 1;
       }
 
-    //printf("level %d maxnet = %d ", level, maxnet);
-    maxnet = maxnet/net_threshold;
-    segments = MAX (maxnet+1,1);
-    ratio = (double) g->draw_height / (double) (net_threshold*segments);
-    //printf("segments %d ratio = %f t1=%ld t2=%ld t3=%ld t=%ld\n", segments, ratio, multiload->net_threshold1, multiload->net_threshold2, multiload->net_threshold3, multiload->net_threshold);
+    *segments = MAX (maxnet / *threshold + 1, 1);
+    break;
+  }
+
+  case graph_loadavg: {
+    guint64 maxload = MAX (peak, 1);
+
+    /* the load graph divides samples by this value */
+    *segments = (guint64) ceil ((double) maxload / (double) g->draw_height) + 1;
+    break;
+  }
+
+  default:
+    break;
+  }
+}
+
+/* Paints one row per core, or per group of cores when there are more
+ * cores than pixels, shaded from the idle to the user color. A group
+ * shows its busiest core, and a decimated column the busiest sample,
+ * so that a single saturated core stands out. */
+static void
+load_graph_paint_heatmap (LoadGraph *g,
+                          cairo_t   *cr,
+                          gsize      first,
+                          gsize      last)
+{
+  const GdkRGBA *cold = &(g->colors [cpuload_free]);
+  const GdkRGBA *hot = &(g->colors [cpuload_usr]);
+  guint rows, row, c;
+  gsize i;
+
+  rows = (guint) MIN ((guint64) g->n_values, g->draw_height);
+
+  for (i = first; i < last; i++)
+  {
+    const guint64 *sample = load_graph_get_column (g, i, TRUE);
+    double x = (double) (g->draw_width - i - 1);
+
+    for (row = 0; row < rows; row++)
+    {
+      guint from = row * g->n_values / rows;
+      guint to = (row + 1) * g->n_values / rows;
+      guint64 value = 0;
+      double t, top, bottom;
+
+      for (c = from; c < to; c++)
+        value = MAX (value, sample [c]);
+
+      t = MIN ((double) value / (double) g->draw_height, 1.0);
+      top = floor ((double) row * (double) g->draw_height / (double) rows);
+      bottom = floor ((double) (row + 1) * (double) g->draw_height / (double) rows);
+
+      cairo_set_source_rgb (cr,
+                            cold->red + (hot->red - cold->red) * t,
+                            cold->green + (hot->green - cold->green) * t,
+                            cold->blue + (hot->blue - cold->blue) * t);
+      cairo_rectangle (cr, x, top, 1.0, bottom - top);
+      cairo_fill (cr);
+    }
+  }
+}
+
+/* Fills the rows of g->stack with the bottom of every segment of columns
+ * [first, last) of a stacked graph, row n holding the top of the last
+ * segment. The last segment, the background color of the graph, always
+ * reaches the top row, so that a column adding up to less than the
+ * height leaves no rows of the scrolled image above it. Each column is
+ * read once, front to back, and the painting loops below then walk one
+ * contiguous row per color. */
+static void
+load_graph_stack_columns (LoadGraph *g,
+                          gsize      first,
+                          gsize      last)
+{
+  gsize i;
+  guint j;
+
+  for (i = first; i < last; i++)
+  {
+    const guint64 *sample = load_graph_get_column (g, i, FALSE);
+    /* a full column ends one above the top row */
+    gint64 bottom = (gint64) g->draw_height - 1;
+
+    for (j = 0; j < g->n; j++)
+    {
+      g->stack [j * g->draw_width + i] = bottom;
+      bottom -= (gint64) sample [j];
+    }
+    g->stack [g->n * g->draw_width + i] = MIN (bottom, -1);
+  }
+}
+
+/* Returns the pixels of the backing surface if the graph can write them
+ * directly: an unscaled image surface with 32 bits per pixel. */
+static guint32 *
+load_graph_get_pixels (LoadGraph *g,
+                       gsize     *stride)
+{
+  cairo_format_t format;
+  double sx, sy;
+
+  if (cairo_surface_get_type (g->surface) != CAIRO_SURFACE_TYPE_IMAGE)
+    return NULL;
+
+  format = cairo_image_surface_get_format (g->surface);
+  if (format != CAIRO_FORMAT_RGB24 && format != CAIRO_FORMAT_ARGB32)
+    return NULL;
+
+  cairo_surface_get_device_scale (g->surface, &sx, &sy);
+  if (sx != 1.0 || sy != 1.0)
+    return NULL;
+
+  if ((gsize) cairo_image_surface_get_width (g->surface) < g->draw_width ||
+      (guint64) cairo_image_surface_get_height (g->surface) < g->draw_height)
+    return NULL;
+
+  cairo_surface_flush (g->surface);
+  *stride = (gsize) cairo_image_surface_get_stride (g->surface) / sizeof (guint32);
+
+  return (guint32 *) cairo_image_surface_get_data (g->surface);
+}
+
+/* Writes the segments of columns [first, last) of a stacked graph straight
+ * into the pixels of the backing surface. Segment j covers the rows from
+ * stack [j + 1] (exclusive) down to stack [j] of its column, in a solid
+ * color; the strokes below cover the same rows, but cairo tessellates and
+ * rasterizes a path for every one of them. Returns FALSE, having drawn
+ * nothing, if the surface or translucent colors need cairo. */
+static gboolean
+load_graph_fill_spans (LoadGraph *g,
+                       gsize      first,
+                       gsize      last)
+{
+  guint32 colors [8];
+  guint32 *pixels;
+  gsize stride, i;
+  guint j;
+
+  if (g->n > G_N_ELEMENTS (colors))
+    return FALSE;
+
+  for (j = 0; j < g->n; j++)
+  {
+    const GdkRGBA *c = &(g->colors [j]);
+
+    if (c->alpha < 1.0)
+      return FALSE;
+
+    colors [j] = 0xff000000 |
+                 (guint32) (CLAMP (c->red, 0.0, 1.0) * 255.0 + 0.5) << 16 |
+                 (guint32) (CLAMP (c->green, 0.0, 1.0) * 255.0 + 0.5) << 8 |
+                 (guint32) (CLAMP (c->blue, 0.0, 1.0) * 255.0 + 0.5);
+  }
+
+  if ((pixels = load_graph_get_pixels (g, &stride)) == NULL)
+    return FALSE;
+
+  for (i = first; i < last; i++)
+  {
+    guint32 *column = pixels + (g->draw_width - i - 1);
+
+    for (j = 0; j < g->n; j++)
+    {
+      gint64 y = MAX (g->stack [(j + 1) * g->draw_width + i] + 1, 0);
+      gint64 bottom = g->stack [j * g->draw_width + i];
+
+      for (; y <= bottom; y++)
+        column [(gsize) y * stride] = colors [j];
+    }
+  }
+
+  cairo_surface_mark_dirty_rectangle (g->surface,
+                                      (int) (g->draw_width - last), 0,
+                                      (int) (last - first), (int) g->draw_height);
+
+  return TRUE;
+}
+
+/* Paints history columns [first, last) of the graph, data[0] being the
+ * rightmost one, together with the grid lines and indicators crossing
+ * them. Drawing is clipped to those columns. */
+static void
+load_graph_paint_columns (LoadGraph *g,
+                          cairo_t   *cr,
+                          gsize      first,
+                          gsize      last)
+{
+  gsize i;
+  guint j, k;
+
+  cairo_save (cr);
+  cairo_rectangle (cr,
+                   (double) (g->draw_width - last), 0.0,
+                   (double) (last - first), (double) g->draw_height);
+  cairo_clip (cr);
+
+  if (g->heatmap) {
+    load_graph_paint_heatmap (g, cr, first, last);
+    cairo_restore (cr);
+    return;
+  }
+
+  switch (g->id) {
+
+  /* This is for network graph */
+  case graph_netload2: {
+    double ratio;
+    double spacing;
+
+    ratio = (double) g->draw_height / (double) (g->drawn_threshold * g->drawn_segments);
+
+    for (i = first; i < last; i++)
+      g->pos [i] = g->draw_height - 1;
 
     for (j = 0; j < g->n-1; j++)
     {
       gdk_cairo_set_source_rgba (cr, &(g->colors [j]));
 
-      for (i = 0; i < g->draw_width; i++)
+      for (i = first; i < last; i++)
       {
         double x = (double) (g->draw_width - i) - 0.5;
+        double value = (double) load_graph_get_column (g, i, FALSE)[j];
         cairo_move_to (cr, x, (double) g->pos[i] + 0.5);
-        cairo_line_to (cr, x, (double) g->pos[i] - 0.5 - (((double) g->data [i][j] * ratio)));
-        g->pos [i] -= (guint64) ((double) g->data [i][j] * ratio);
+        cairo_line_to (cr, x, (double) g->pos[i] - 0.5 - (value * ratio));
+        g->pos [i] -= (guint64) (value * ratio);
       }
       cairo_stroke (cr);
     }
@@ -125,7 +416,7 @@ load_graph_draw (LoadGraph *g)
     for (j = g->n-1; j < g->n; j++)
     {
       gdk_cairo_set_source_rgba (cr, &(g->colors [j]));
-      for (i = 0; i < g->draw_width; i++)
+      for (i = first; i < last; i++)
       {
           double x = (double) (g->draw_width - i) - 0.5;
           cairo_move_to (cr, x, (double) g->pos[i] + 0.5);
@@ -136,18 +427,18 @@ load_graph_draw (LoadGraph *g)
 
     /* draw grid lines if needed */
     gdk_cairo_set_source_rgba (cr, &(g->colors [4]));
-    for (k = 0; k < segments -1; k++)
+    for (k = 0; k < g->drawn_segments - 1; k++)
     {
-      spacing = ((double) g->draw_height / (double) segments) * (k+1);
+      spacing = ((double) g->draw_height / (double) g->drawn_segments) * (k+1);
       cairo_move_to (cr, 0.5, spacing);
       cairo_line_to (cr, (double) g->draw_width - 0.5, spacing);
     }
     cairo_stroke (cr);
     /* draw indicator if needed */
-    if (level > 0)
+    if (g->drawn_level > 0)
     {
       gdk_cairo_set_source_rgba (cr, &(g->colors [5]));
-      for (k = 0; k< level; k++ )
+      for (k = 0; k < g->drawn_level; k++ )
         cairo_rectangle (cr,
                          0.5, (double) k * 2.0 * (double) g->draw_height / 5.0,
                          5.0, (double) g->draw_height / 5.0);
@@ -160,33 +451,31 @@ load_graph_draw (LoadGraph *g)
   /* this is Load graph */
   case graph_loadavg: {
     double load;
-    guint64 maxload = 1;
-    for (i = 0; i < g->draw_width; i++)
-    {
+    double spacing;
+
+    load = (double) g->drawn_segments;
+
+    for (i = first; i < last; i++)
       g->pos [i] = g->draw_height - 1;
-      /* find maximum value */
-      if (g->data[i][0] > maxload)
-        maxload = g->data[i][0];
-    }
-    load = ceil ((double) maxload / (double) g->draw_height) + 1.0;
 
     for (j = 0; j < g->n; j++)
     {
       gdk_cairo_set_source_rgba (cr, &(g->colors [j]));
 
-      for (i = 0; i < g->draw_width; i++)
+      for (i = first; i < last; i++)
       {
         double x = (double) (g->draw_width - i) - 0.5;
+        double value = (double) load_graph_get_column (g, i, FALSE)[j];
         cairo_move_to (cr, x, (double) g->pos[i] + 0.5);
         if (j == 0)
         {
-          cairo_line_to (cr, x, (double) g->pos[i] - (((double) g->data [i][j] - 0.5)/load));
+          cairo_line_to (cr, x, (double) g->pos[i] - ((value - 0.5)/load));
         }
         else
         {
           cairo_line_to (cr, x, 0.5);
         }
-        g->pos [i] -= (guint64) ((double) g->data [i][j] / load);
+        g->pos [i] -= (guint64) (value / load);
       }
       cairo_stroke (cr);
     }
@@ -194,7 +483,6 @@ load_graph_draw (LoadGraph *g)
     /* draw grid lines in Load graph if needed */
     gdk_cairo_set_source_rgba (cr, &(g->colors [2]));
 
-    double spacing;
     for (k = 0; k < load - 1; k++)
     {
       spacing = ((double) g->draw_height/load) * (k+1);
@@ -207,68 +495,228 @@ load_graph_draw (LoadGraph *g)
   }
 
   default:
-    for (i = 0; i < g->draw_width; i++)
-      g->pos [i] = g->draw_height - 1;
+    load_graph_stack_columns (g, first, last);
+
+    if (load_graph_fill_spans (g, first, last))
+      break;
 
     for (j = 0; j < g->n; j++)
     {
+      const gint64 *bottom = g->stack + j * g->draw_width;
+      const gint64 *top = bottom + g->draw_width;
+
       gdk_cairo_set_source_rgba (cr, &(g->colors [j]));
 
-      for (i = 0; i < g->draw_width; i++)
+      for (i = first; i < last; i++)
       {
-        if (g->data [i][j] != 0)
+        if (top [i] != bottom [i])
         {
           double x = (double) (g->draw_width - i) - 0.5;
-          cairo_move_to (cr, x, (double) g->pos[i] + 0.5);
-          cairo_line_to (cr, x, (double) g->pos[i] - (double) g->data [i][j] - 0.5);
+          cairo_move_to (cr, x, (double) bottom [i] + 0.5);
+          cairo_line_to (cr, x, (double) top [i] - 0.5);
         }
-        g->pos [i] -= g->data [i][j];
       }
       cairo_stroke (cr);
     }
   }
 
-  gtk_widget_queue_draw (g->disp);
+  cairo_restore (cr);
+}
+
+/* Moves the contents of the backing surface one column to the left.
+ * Cairo does not support a surface being its own source, so the
+ * scrolled image goes to a second surface and the two are swapped. */
+static void
+load_graph_scroll (LoadGraph *g)
+{
+  cairo_surface_t *tmp;
+  cairo_t *cr;
+  guint32 *pixels;
+  gsize stride;
+  guint64 y;
+
+  /* an image surface can simply move its rows */
+  if ((pixels = load_graph_get_pixels (g, &stride)) != NULL) {
+    for (y = 0; y < g->draw_height; y++)
+      memmove (pixels + y * stride, pixels + y * stride + 1,
+               (g->draw_width - 1) * sizeof (guint32));
+    cairo_surface_mark_dirty_rectangle (g->surface, 0, 0,
+                                        (int) g->draw_width - 1, (int) g->draw_height);
+    return;
+  }
 
+  if (!g->back_surface)
+    g->back_surface = cairo_surface_create_similar (g->surface,
+                                                    CAIRO_CONTENT_COLOR,
+                                                    (int) g->draw_width,
+                                                    (int) g->draw_height);
+
+  cr = cairo_create (g->back_surface);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, g->surface, -1.0, 0.0);
+  cairo_paint (cr);
   cairo_destroy (cr);
+
+  tmp = g->surface;
+  g->surface = g->back_surface;
+  g->back_surface = tmp;
 }
 
-/* Updates the load graph when the timeout expires */
-static gboolean
-load_graph_update (LoadGraph *g)
+/* The backing surface lives in client memory, so that the stacked graphs
+ * can write their columns into it and scrolling moves its rows in place. */
+static cairo_surface_t *
+load_graph_create_surface (LoadGraph *g)
 {
+  GdkWindow *window = gtk_widget_get_window (g->disp);
+
+  return gdk_window_create_similar_image_surface (window,
+                                                  CAIRO_FORMAT_RGB24,
+                                                  (int) g->draw_width,
+                                                  (int) g->draw_height,
+                                                  gdk_window_get_scale_factor (window));
+}
+
+/* Updates the backing pixmap for the load graph and the window.
+ * As long as the scale stays the same, only the newest column is drawn
+ * after scrolling the old image; everything is repainted otherwise. */
+static void
+load_graph_draw (LoadGraph *g)
+{
+  guint64 threshold, segments;
+  guint level;
+  cairo_t *cr;
+
+  /* we might get called before the configure event so that
+   * g->disp->allocation may not have the correct size
+   * (after the user resized the applet in the prop dialog). */
+
+  if (!g->surface) {
+    g->surface = load_graph_create_surface (g);
+    g->full_redraw = TRUE;
+  }
+
+  load_graph_get_scale (g, &threshold, &segments, &level);
+  if (threshold != g->drawn_threshold ||
+      segments != g->drawn_segments ||
+      level != g->drawn_level) {
+    g->drawn_threshold = threshold;
+    g->drawn_segments = segments;
+    g->drawn_level = level;
+    g->full_redraw = TRUE;
+  }
+
+  if (!g->full_redraw)
+    load_graph_scroll (g);
+
+  cr = cairo_create (g->surface);
+  cairo_set_line_width (cr, 1.0);
+  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+  cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+
+  if (g->full_redraw) {
+    load_graph_paint_columns (g, cr, 0, g->draw_width);
+    g->full_redraw = FALSE;
+  }
+  else {
+    load_graph_paint_columns (g, cr, 0, 1);
+
+    /* the level indicator covers the leftmost columns */
+    if (g->drawn_level > 0)
+      load_graph_paint_columns (g, cr,
+                                g->draw_width - MIN (g->draw_width, LOAD_GRAPH_INDICATOR_COLUMNS),
+                                g->draw_width);
+  }
+
+  /* offscreen graphs have no widget, see load_graph_set_surface () */
+  if (g->disp)
+    gtk_widget_queue_draw (g->disp);
+
+  cairo_destroy (cr);
+}
+
+/* Takes one sample for the last columns periods of g->speed and adds it
+ * that many times to the history. The collectors with cumulative
+ * counters return the average over the whole interval, the others the
+ * current value. Hidden graphs are only drawn once shown again. */
+static void
+load_graph_sample (LoadGraph *g,
+                   guint      columns,
+                   gboolean   draw)
+{
+    guint64 *sample, *copy;
+    gboolean changed;
+    guint c;
+
     if (g->data == NULL)
-        return TRUE;
+        return;
+
+    g->interval = columns * g->speed;
+    g->sampled = g_get_monotonic_time ();
 
-    shift_right(g);
+    sample = load_graph_push (g);
 
+    g->get_data (g->draw_height, sample, g);
+
+    changed = load_graph_levels_add (g, sample);
+    for (c = 1; c < MIN (columns, g->draw_width); c++)
+    {
+        copy = load_graph_push (g);
+        memcpy (copy, sample, g->n_values * sizeof copy [0]);
+        changed |= load_graph_levels_add (g, copy);
+        sample = copy;
+    }
+
+    /* the tooltip text is only rebuilt if it is shown */
+    g->tooltip_valid = FALSE;
     if (g->tooltip_update)
-        multiload_applet_tooltip_update (g);
+        gtk_widget_trigger_tooltip_query (g->disp);
 
-    g->get_data (g->draw_height, g->data [0], g);
+    if (!draw) {
+        g->full_redraw = TRUE;
+        return;
+    }
 
-    load_graph_draw (g);
-    return TRUE;
+    /* a decimated history only scrolls when a bucket is complete */
+    if (changed || g->full_redraw)
+        load_graph_draw (g);
+}
+
+/* Updates the load graph when the sampler ticks */
+void
+load_graph_update (LoadGraph *g)
+{
+    load_graph_sample (g, 1, TRUE);
 }
 
 void
 load_graph_unalloc (LoadGraph *g)
 {
-    gsize i;
+    guint l;
 
     if (!g->allocated)
         return;
 
-    for (i = 0; i < g->draw_width; i++)
-    {
-        g_free (g->data [i]);
-    }
-
     g_free (g->data);
     g_free (g->pos);
+    g_free (g->stack);
 
     g->pos = NULL;
     g->data = NULL;
+    g->stack = NULL;
+
+    for (l = 0; l < LOAD_GRAPH_LEVELS; l++)
+    {
+        LoadGraphLevel *level = &g->levels [l];
+
+        g_free (level->sum);
+        g_free (level->max);
+        g_free (level->avg_ring);
+        g_free (level->max_ring);
+        memset (level, 0, sizeof *level);
+    }
+
+    for (l = 0; l <= LOAD_GRAPH_LEVELS; l++)
+        window_max_clear (&g->peaks [l]);
 
     g->size = CLAMP (g_settings_get_uint (g->multiload->settings, GRAPH_SIZE_KEY),
                      GRAPH_SIZE_MIN,
@@ -279,30 +727,68 @@ load_graph_unalloc (LoadGraph *g)
         g->surface = NULL;
     }
 
+    if (g->back_surface) {
+        cairo_surface_destroy (g->back_surface);
+        g->back_surface = NULL;
+    }
+
     g->allocated = FALSE;
 }
 
 static void
 load_graph_alloc (LoadGraph *g)
 {
-    gsize i;
-    gsize data_size;
+    guint l;
 
     if (g->allocated)
         return;
 
-    g->data = g_new0 (guint64 *, g->draw_width);
+    g->data = g_new0 (guint64, g->draw_width * g->n_values);
     g->pos = g_new0 (guint64, g->draw_width);
+    g->stack = g_new0 (gint64, g->draw_width * (g->n + 1));
+    g->head = 0;
+
+    for (l = 0; l < LOAD_GRAPH_LEVELS; l++)
+    {
+        LoadGraphLevel *level = &g->levels [l];
 
-    data_size = sizeof (guint64) * g->n;
+        level->interval = load_graph_level_intervals [l];
+        level->sum = g_new0 (guint64, g->n_values);
+        level->max = g_new0 (guint64, g->n_values);
+        level->avg_ring = g_new0 (guint64, g->draw_width * g->n_values);
+        level->max_ring = g_new0 (guint64, g->draw_width * g->n_values);
+    }
 
-    for (i = 0; i < g->draw_width; i++) {
-        g->data [i] = g_malloc0 (data_size);
+    g->peak_value = load_graph_peak_value (g);
+    if (g->peak_value >= 0)
+    {
+        for (l = 0; l <= LOAD_GRAPH_LEVELS; l++)
+            window_max_init (&g->peaks [l], g->draw_width);
     }
 
     g->allocated = TRUE;
 }
 
+void
+load_graph_set_surface (LoadGraph       *g,
+                        cairo_surface_t *surface)
+{
+    double sx, sy;
+
+    g_return_if_fail (g->disp == NULL);
+    g_return_if_fail (!g->allocated);
+
+    /* the graph is as large as the surface in device independent units */
+    cairo_surface_get_device_scale (surface, &sx, &sy);
+    g->draw_width = (gsize) MAX (cairo_image_surface_get_width (surface) / sx, 1);
+    g->draw_height = (guint64) MAX (cairo_image_surface_get_height (surface) / sy, 1);
+
+    load_graph_alloc (g);
+
+    g->surface = cairo_surface_reference (surface);
+    g->full_redraw = TRUE;
+}
+
 static gint
 load_graph_configure (GtkWidget *widget, GdkEventConfigure *event,
                       gpointer data_ptr)
@@ -322,10 +808,8 @@ load_graph_configure (GtkWidget *widget, GdkEventConfigure *event,
     load_graph_alloc (c);
 
     if (!c->surface)
-        c->surface = gdk_window_create_similar_surface (gtk_widget_get_window (c->disp),
-                                                        CAIRO_CONTENT_COLOR,
-                                                        (int) c->draw_width,
-                                                        (int) c->draw_height);
+        c->surface = load_graph_create_surface (c);
+    c->full_redraw = TRUE;
     gtk_widget_queue_draw (widget);
 
     return TRUE;
@@ -369,7 +853,6 @@ load_graph_enter_cb(GtkWidget *widget, GdkEventCrossing *event, gpointer data)
     graph = (LoadGraph *)data;
 
     graph->tooltip_update = TRUE;
-    multiload_applet_tooltip_update(graph);
 
     return TRUE;
 }
@@ -385,6 +868,21 @@ load_graph_leave_cb(GtkWidget *widget, GdkEventCrossing *event, gpointer data)
     return TRUE;
 }
 
+static gboolean
+load_graph_query_tooltip_cb (GtkWidget  *widget,
+                             gint        x,
+                             gint        y,
+                             gboolean    keyboard_mode,
+                             GtkTooltip *tooltip,
+                             gpointer    data)
+{
+    LoadGraph *graph = (LoadGraph *) data;
+
+    gtk_tooltip_set_text (tooltip, multiload_applet_tooltip_text (graph));
+
+    return TRUE;
+}
+
 static void
 load_graph_load_config (LoadGraph *g)
 {
@@ -418,11 +916,13 @@ load_graph_new (MultiloadApplet *ma, guint n, const gchar *label,
     g->visible = visible;
     g->name = name;
     g->n = n;
+    g->n_values = n;
     g->id = id;
     g->speed = speed;
     g->size = size;
     g->pixel_size = mate_panel_applet_get_size (ma->applet);
     g->tooltip_update = FALSE;
+    g->level = ma->history_level;
     g->multiload = ma;
 
     g->main_widget = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
@@ -457,7 +957,7 @@ load_graph_new (MultiloadApplet *ma, guint n, const gchar *label,
 
     g->get_data = get_data;
 
-    g->timer_index = -1;
+    g->running = FALSE;
 
     if (g->orient)
         gtk_widget_set_size_request (g->main_widget, -1, (gint) g->size);
@@ -470,6 +970,8 @@ load_graph_new (MultiloadApplet *ma, guint n, const gchar *label,
                                     GDK_LEAVE_NOTIFY_MASK |
                                     GDK_BUTTON_PRESS_MASK);
 
+    g->full_redraw = TRUE;
+
     g_signal_connect (g->disp, "draw",
                       G_CALLBACK (load_graph_expose), g);
     g_signal_connect (g->disp, "configure-event",
@@ -482,6 +984,13 @@ load_graph_new (MultiloadApplet *ma, guint n, const gchar *label,
                       G_CALLBACK(load_graph_enter_cb), g);
     g_signal_connect (g->disp, "leave-notify-event",
                       G_CALLBACK(load_graph_leave_cb), g);
+    g_signal_connect (g->disp, "query-tooltip",
+                      G_CALLBACK (load_graph_query_tooltip_cb), g);
+    g_signal_connect_swapped (g->disp, "map",
+                              G_CALLBACK (load_graph_sampler_update), ma);
+    g_signal_connect_swapped (g->disp, "unmap",
+                              G_CALLBACK (load_graph_sampler_update), ma);
+    gtk_widget_set_has_tooltip (g->disp, TRUE);
 
     gtk_box_pack_start (GTK_BOX (g->box), g->disp, TRUE, TRUE, 0);
     gtk_widget_show_all(g->box);
@@ -490,24 +999,193 @@ load_graph_new (MultiloadApplet *ma, guint n, const gchar *label,
 }
 
 void
-load_graph_start (LoadGraph *g)
+load_graph_iter_init (LoadGraphIter *iter,
+                      LoadGraph     *g)
 {
-    guint event_source_id;
+    iter->graph = g;
+    iter->index = 0;
+}
 
-    if (g->timer_index != -1)
-        g_source_remove ((guint) g->timer_index);
+gboolean
+load_graph_iter_next (LoadGraphIter  *iter,
+                      const guint64 **sample)
+{
+    LoadGraph *g = iter->graph;
+
+    if (g->data == NULL || iter->index >= g->draw_width)
+        return FALSE;
 
-    event_source_id = g_timeout_add (g->speed,
-                                    (GSourceFunc) load_graph_update, g);
+    *sample = load_graph_get_sample (g, iter->index);
+    iter->index++;
 
-    g->timer_index = (gint) event_source_id;
+    return TRUE;
+}
+
+void
+load_graph_queue_full_redraw (LoadGraph *g)
+{
+    g->full_redraw = TRUE;
+}
+
+void
+load_graph_set_level (LoadGraph *g,
+                      guint      level)
+{
+    g->level = MIN (level, LOAD_GRAPH_LEVELS);
+    g->full_redraw = TRUE;
+}
+
+/* Whether any running graph can be seen. Graphs without a widget, as in
+ * multiload-bench, always count as shown. */
+static gboolean
+load_graph_sampler_shown (MultiloadApplet *ma)
+{
+    guint i;
+
+    if (ma->screensaver_active)
+        return FALSE;
+
+    for (i = 0; i < graph_n; i++)
+    {
+        LoadGraph *g = ma->graphs[i];
+
+        if (g && g->running && (g->disp == NULL || gtk_widget_get_mapped (g->disp)))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* One timeout drives all the graphs of an applet, so they are sampled
+ * back to back and the applet wakes up only once per period.
+ *
+ * While no graph is shown, the sampler ticks every
+ * LOAD_GRAPH_BACKGROUND_INTERVAL and nothing is drawn. Each of these
+ * ticks, and the first one after the graphs are shown again, fills all
+ * the columns since the previous tick. */
+static gboolean
+load_graph_sampler_cb (MultiloadApplet *ma)
+{
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "multiload:load_graph_sampler_cb");
+    gint64 now = g_get_monotonic_time ();
+    gint64 period = (gint64) ma->speed * 1000;
+    guint columns = 1;
+    guint i;
+
+    if (ma->sampler_backfill && ma->last_tick != 0 && now - ma->last_tick >= period) {
+        gint64 elapsed = now - ma->last_tick;
+
+        columns = (guint) MIN (elapsed / period, G_MAXUINT / MAX (ma->speed, 1));
+        /* the rest of a period counts towards the next tick */
+        now -= elapsed - (gint64) columns * period;
+    }
+    ma->last_tick = now;
+    ma->sampler_backfill = ma->sampler_background;
+
+    for (i = 0; i < graph_n; i++)
+    {
+        if (ma->graphs[i] && ma->graphs[i]->running)
+            load_graph_sample (ma->graphs[i], columns, !ma->sampler_background);
+    }
+
+    if (ma->export)
+        multiload_export_publish (ma->export, ma);
+
+    applet_probe_end (probe, start);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+load_graph_sampler_stop (MultiloadApplet *ma)
+{
+    if (ma->sampler_id != 0)
+        g_source_remove (ma->sampler_id);
+
+    ma->sampler_id = 0;
+}
+
+static void
+load_graph_sampler_start (MultiloadApplet *ma)
+{
+    gboolean background = !load_graph_sampler_shown (ma);
+    guint speed = background ? MAX (ma->speed, LOAD_GRAPH_BACKGROUND_INTERVAL) : ma->speed;
+
+    if (ma->sampler_id != 0 && ma->sampler_speed == speed &&
+        ma->sampler_background == background)
+        return;
+
+    load_graph_sampler_stop (ma);
+
+    ma->sampler_speed = speed;
+    ma->sampler_background = background;
+    if (background)
+        ma->sampler_backfill = TRUE;
+
+    ma->sampler_id = sampler_tick_add (speed,
+                                       (GSourceFunc) load_graph_sampler_cb, ma);
+}
+
+/* The other graphs keep their schedule: the collectors with cumulative
+ * counters assume a whole period between their samples. Within half a
+ * period of the last sample the stall waits for the next tick, rather
+ * than squeezing the graph with columns of a few milliseconds. */
+void
+load_graph_kick (LoadGraph *g)
+{
+    MultiloadApplet *ma = g->multiload;
+
+    if (ma->sampler_id == 0 || ma->sampler_background || !g->running)
+        return;
+
+    if (g_get_monotonic_time () - g->sampled < (gint64) g->speed * 1000 / 2)
+        return;
+
+    load_graph_sample (g, 1, TRUE);
+}
+
+void
+load_graph_sampler_update (MultiloadApplet *ma)
+{
+    gboolean was_background = ma->sampler_background;
+
+    /* nothing is running, or the graphs are being torn down */
+    if (ma->sampler_id == 0)
+        return;
+
+    load_graph_sampler_start (ma);
+
+    /* catch up at once rather than up to a background interval later */
+    if (was_background && !ma->sampler_background)
+        load_graph_sampler_cb (ma);
+}
+
+void
+load_graph_start (LoadGraph *g)
+{
+    g->running = TRUE;
+
+    load_graph_sampler_start (g->multiload);
 }
 
 void
 load_graph_stop (LoadGraph *g)
 {
-    if (g->timer_index != -1)
-        g_source_remove ((guint) g->timer_index);
+    MultiloadApplet *ma = g->multiload;
+    guint i;
+
+    g->running = FALSE;
+
+    for (i = 0; i < graph_n; i++)
+    {
+        if (ma->graphs[i] && ma->graphs[i]->running)
+        {
+            /* the graph might have been the only one shown */
+            load_graph_sampler_update (ma);
+            return;
+        }
+    }
 
-    g->timer_index = -1;
+    load_graph_sampler_stop (ma);
 }
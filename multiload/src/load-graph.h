@@ -3,6 +3,26 @@
 
 #include "global.h"
 
+typedef struct _LoadGraphIter LoadGraphIter;
+
+struct _LoadGraphIter
+{
+    LoadGraph *graph;
+    gsize      index;
+};
+
+/* Return the i-th most recent sample of the history, 0 being the newest. */
+static inline guint64 *
+load_graph_get_sample (LoadGraph *g, gsize i)
+{
+    gsize column = g->head + i;
+
+    if (column >= g->draw_width)
+        column -= g->draw_width;
+
+    return g->data + column * g->n_values;
+}
+
 /* Create new load graph. */
 G_GNUC_INTERNAL LoadGraph *
 load_graph_new (MultiloadApplet *multiload, guint n, const gchar *label,
@@ -17,6 +37,41 @@ load_graph_start (LoadGraph *g);
 G_GNUC_INTERNAL void
 load_graph_stop (LoadGraph *g);
 
+/* Take one sample and draw it, the sampler calls this on every tick. */
+G_GNUC_INTERNAL void
+load_graph_update (LoadGraph *g);
+
+/* Draw a graph that has no widget into an image surface of the history
+ * size, used by multiload-bench. */
+G_GNUC_INTERNAL void
+load_graph_set_surface (LoadGraph *g, cairo_surface_t *surface);
+
+/* Switch between sampling at the refresh rate and the slow background
+ * rate of hidden graphs, after the graphs were mapped or unmapped or the
+ * screensaver was (de)activated. */
+G_GNUC_INTERNAL void
+load_graph_sampler_update (MultiloadApplet *ma);
+
+/* Sample one graph right away, e.g. when the kernel reports a stall.
+ * Its collector must measure the real time since its last sample. */
+G_GNUC_INTERNAL void
+load_graph_kick (LoadGraph *g);
+
+/* Repaint the whole graph on the next update. */
+G_GNUC_INTERNAL void
+load_graph_queue_full_redraw (LoadGraph *g);
+
+/* Show the samples (0) or one of the decimated history levels. */
+G_GNUC_INTERNAL void
+load_graph_set_level (LoadGraph *g, guint level);
+
+/* Walk the history from the newest sample to the oldest one. */
+G_GNUC_INTERNAL void
+load_graph_iter_init (LoadGraphIter *iter, LoadGraph *g);
+
+G_GNUC_INTERNAL gboolean
+load_graph_iter_next (LoadGraphIter *iter, const guint64 **sample);
+
 /* free load graph */
 G_GNUC_INTERNAL void
 load_graph_unalloc (LoadGraph *g);
@@ -27,6 +27,8 @@
 #include <mate-panel-applet.h>
 #include <mate-panel-applet-gsettings.h>
 
+#include "common/applet-startup.h"
+
 #include "global.h"
 
 static void
@@ -192,6 +194,18 @@ multiload_destroy_cb(GtkWidget *widget, gpointer data)
     guint i;
     MultiloadApplet *ma = data;
 
+    /* the metrics are rendered from the graphs freed below */
+    sampler_metrics_free (ma->metrics);
+    ma->metrics = NULL;
+
+    g_cancellable_cancel (ma->screensaver_cancellable);
+    g_object_unref (ma->screensaver_cancellable);
+    if (ma->screensaver)
+    {
+        g_signal_handlers_disconnect_by_data (ma->screensaver, ma);
+        g_object_unref (ma->screensaver);
+    }
+
     for (i = 0; i < graph_n; i++)
     {
         load_graph_stop(ma->graphs[i]);
@@ -203,11 +217,21 @@ multiload_destroy_cb(GtkWidget *widget, gpointer data)
         gtk_widget_destroy(ma->graphs[i]->main_widget);
 
         load_graph_unalloc(ma->graphs[i]);
+        if (ma->graphs[i]->tooltip_text)
+            g_string_free (ma->graphs[i]->tooltip_text, TRUE);
         g_free(ma->graphs[i]);
+        ma->graphs[i] = NULL;
     }
 
+    multiload_applet_update_psi_trigger (ma);
+    g_signal_handlers_disconnect_by_data (ma->settings, ma);
+    cgroup_sampler_free (ma->cgroups);
+    gpu_sampler_free (ma->gpu);
+    thermal_sampler_free (ma->thermal);
     netspeed_delete (ma->netspeed_in);
     netspeed_delete (ma->netspeed_out);
+    g_free (ma->cpu_core_last);
+    multiload_export_free (ma->export);
 
     if (ma->about_dialog)
         gtk_widget_destroy (ma->about_dialog);
@@ -222,6 +246,144 @@ multiload_destroy_cb(GtkWidget *widget, gpointer data)
     return;
 }
 
+static gboolean
+multiload_psi_kick_cb (gpointer data)
+{
+    MultiloadApplet *ma = data;
+
+    ma->psi_kick_id = 0;
+
+    /* show the stall now rather than at the next tick */
+    if (ma->graphs [graph_psi] != NULL)
+        load_graph_kick (ma->graphs [graph_psi]);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* The triggers of the three resources often fire together, so they
+ * sample the graph once, after the main loop dispatched all of them */
+static gboolean
+multiload_psi_stall_cb (gpointer data)
+{
+    MultiloadApplet *ma = data;
+
+    if (ma->psi_kick_id == 0)
+        ma->psi_kick_id = g_idle_add (multiload_psi_kick_cb, ma);
+
+    return G_SOURCE_CONTINUE;
+}
+
+void
+multiload_applet_update_psi_trigger (MultiloadApplet *ma)
+{
+    LoadGraph *g = ma->graphs [graph_psi];
+    gboolean wanted = ma->psi_trigger_enabled && g != NULL && g->running;
+
+    if (wanted && ma->psi_trigger == NULL)
+    {
+        ma->psi_trigger = pressure_trigger_new (multiload_psi_stall_cb, ma);
+    }
+    else if (!wanted && ma->psi_trigger != NULL)
+    {
+        pressure_trigger_free (ma->psi_trigger);
+        ma->psi_trigger = NULL;
+
+        if (ma->psi_kick_id != 0)
+        {
+            g_source_remove (ma->psi_kick_id);
+            ma->psi_kick_id = 0;
+        }
+    }
+}
+
+/* the cgroup graph opens the files of the new units on its next sample */
+static void
+multiload_cgroup_units_changed_cb (GSettings       *settings,
+                                   const gchar     *key,
+                                   MultiloadApplet *ma)
+{
+    cgroup_sampler_free (ma->cgroups);
+    ma->cgroups = NULL;
+    memset (ma->cgroup_usage, 0, sizeof ma->cgroup_usage);
+}
+
+static void
+multiload_metrics_changed_cb (GSettings       *settings,
+                              const gchar     *key,
+                              MultiloadApplet *ma)
+{
+    gchar *path;
+
+    path = g_settings_get_string (settings, METRICS_SOCKET_KEY);
+    sampler_metrics_set_socket (ma->metrics, path);
+    g_free (path);
+
+    path = g_settings_get_string (settings, METRICS_TEXTFILE_KEY);
+    sampler_metrics_set_textfile (ma->metrics, path);
+    g_free (path);
+}
+
+/* Nobody sees the graphs while the screen is locked. */
+static void
+multiload_screensaver_signal_cb (GDBusProxy      *proxy,
+                                 const gchar     *sender_name,
+                                 const gchar     *signal_name,
+                                 GVariant        *parameters,
+                                 MultiloadApplet *ma)
+{
+    if (g_strcmp0 (signal_name, "ActiveChanged") != 0 ||
+        !g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+        return;
+
+    g_variant_get (parameters, "(b)", &ma->screensaver_active);
+    load_graph_sampler_update (ma);
+}
+
+static void
+multiload_screensaver_ready_cb (GObject      *source,
+                                GAsyncResult *result,
+                                gpointer      data)
+{
+    MultiloadApplet *ma;
+    GDBusProxy *proxy;
+    GError *error = NULL;
+
+    proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+    if (proxy == NULL)
+    {
+        /* the applet is gone if this was cancelled */
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            g_debug ("no screensaver to follow: %s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    ma = data;
+    ma->screensaver = proxy;
+
+    g_signal_connect (ma->screensaver, "g-signal",
+                      G_CALLBACK (multiload_screensaver_signal_cb), ma);
+}
+
+static void
+multiload_applet_start_deferred (gpointer data)
+{
+    MultiloadApplet *ma = data;
+
+    multiload_metrics_changed_cb (ma->settings, NULL, ma);
+
+    g_dbus_proxy_new_for_bus (G_BUS_TYPE_SESSION,
+                              G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                              G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                              NULL,
+                              "org.mate.ScreenSaver",
+                              "/org/mate/ScreenSaver",
+                              "org.mate.ScreenSaver",
+                              ma->screensaver_cancellable,
+                              multiload_screensaver_ready_cb,
+                              ma);
+}
+
 static gboolean
 multiload_button_press_event_cb (GtkWidget *widget, GdkEventButton *event, MultiloadApplet *ma)
 {
@@ -261,11 +423,12 @@ multiload_key_press_event_cb (GtkWidget *widget, GdkEventKey *event, MultiloadAp
     return FALSE;
 }
 
-/* update the tooltip to the graph's current "used" percentage */
-void
-multiload_applet_tooltip_update(LoadGraph *g)
+/* Formats the tooltip into the graph's reusable buffer. The text is only
+ * built when GTK asks for it, and at most once per sample. */
+const gchar *
+multiload_applet_tooltip_text (LoadGraph *g)
 {
-    gchar *tooltip_text;
+    GString *tooltip_text;
     MultiloadApplet *multiload;
     const char *tooltip_label [graph_n] = {
         [graph_cpuload]  = N_("Processor"),
@@ -273,12 +436,25 @@ multiload_applet_tooltip_update(LoadGraph *g)
         [graph_netload2] = N_("Network"),
         [graph_swapload] = N_("Swap Space"),
         [graph_loadavg]  = N_("Load Average"),
-        [graph_diskload] = N_("Disk")
+        [graph_diskload] = N_("Disk"),
+        [graph_psi]      = N_("Pressure"),
+        [graph_cgroup]   = N_("Control Groups"),
+        [graph_gpuload]  = N_("Graphics"),
+        [graph_thermal]  = N_("Temperature")
     };
     const char *name;
 
     g_assert(g);
 
+    if (g->tooltip_text == NULL)
+        g->tooltip_text = g_string_sized_new (64);
+
+    tooltip_text = g->tooltip_text;
+
+    if (g->tooltip_valid)
+        return tooltip_text->str;
+
+    g->tooltip_valid = TRUE;
     multiload = g->multiload;
 
     /* label the tooltip intuitively */
@@ -290,31 +466,119 @@ multiload_applet_tooltip_update(LoadGraph *g)
 
             user_percent  = MIN ((float)(100 * multiload->memload_user)  / (float)(multiload->memload_total), 100.0f);
             cache_percent = MIN ((float)(100 * multiload->memload_cache) / (float)(multiload->memload_total), 100.0f);
-            tooltip_text = g_strdup_printf (_("%s:\n"
-                                              "%.01f%% in use by programs\n"
-                                              "%.01f%% in use as cache"),
-                                            name,
-                                            user_percent,
-                                            cache_percent);
+            g_string_printf (tooltip_text, _("%s:\n"
+                                             "%.01f%% in use by programs\n"
+                                             "%.01f%% in use as cache"),
+                             name,
+                             user_percent,
+                             cache_percent);
             break;
         }
         case graph_loadavg: {
-            tooltip_text = g_strdup_printf (_("The system load average is %0.02f"),
-                                            multiload->loadavg1);
+            g_string_printf (tooltip_text, _("The system load average is %0.02f"),
+                             multiload->loadavg1);
+            break;
+        }
+        case graph_psi: {
+            /* xgettext: share of time some task waited for the resource */
+            g_string_printf (tooltip_text, _("%s:\n"
+                                             "%.01f%% waiting for the processor\n"
+                                             "%.01f%% waiting for memory\n"
+                                             "%.01f%% waiting for I/O"),
+                             name,
+                             multiload->psi_ratio [psi_cpu] * 100.0f,
+                             multiload->psi_ratio [psi_memory] * 100.0f,
+                             multiload->psi_ratio [psi_io] * 100.0f);
+            break;
+        }
+        case graph_cgroup: {
+            guint i, n;
+
+            g_string_printf (tooltip_text, "%s:", name);
+            n = multiload->cgroups ? cgroup_sampler_get_n (multiload->cgroups) : 0;
+            for (i = 0; i < n; i++) {
+                const CgroupUsage *usage = &multiload->cgroup_usage [i];
+                gchar *memory, *read, *write;
+                gdouble seconds;
+
+                if (!usage->valid || multiload->cgroup_elapsed <= 0) {
+                    /* xgettext: a cgroup that does not exist or was not sampled yet */
+                    g_string_append_printf (tooltip_text, _("\n%s: not running"),
+                                            cgroup_sampler_get_name (multiload->cgroups, i));
+                    continue;
+                }
+
+                seconds = (gdouble) multiload->cgroup_elapsed / G_USEC_PER_SEC;
+                memory = g_format_size (usage->memory);
+                read = g_format_size ((guint64) ((gdouble) usage->read / seconds));
+                write = g_format_size ((guint64) ((gdouble) usage->write / seconds));
+                /* xgettext: processor time, memory in use, bytes read and written per second */
+                g_string_append_printf (tooltip_text, _("\n%s: %.01f%% processor, %s memory, "
+                                                        "reading %s/s, writing %s/s"),
+                                        cgroup_sampler_get_name (multiload->cgroups, i),
+                                        (gdouble) usage->cpu * 100.0 / (gdouble) multiload->cgroup_elapsed,
+                                        memory, read, write);
+                g_free (memory);
+                g_free (read);
+                g_free (write);
+            }
+            break;
+        }
+        case graph_gpuload: {
+            const GpuUsage *usage = &multiload->gpu_usage;
+
+            if (usage->n_cards == 0) {
+                g_string_printf (tooltip_text, _("%s:\nNo supported graphics card"), name);
+            }
+            else if (usage->vram_total > 0) {
+                gchar *used = g_format_size (usage->vram_used);
+                gchar *total = g_format_size (usage->vram_total);
+
+                /* xgettext: busy share of the GPU, then its video memory in use */
+                g_string_printf (tooltip_text, _("%s:\n"
+                                                 "%.01f%% in use\n"
+                                                 "%s of %s video memory"),
+                                 name, usage->busy / 10.0, used, total);
+                g_free (used);
+                g_free (total);
+            }
+            else {
+                g_string_printf (tooltip_text, _("%s:\n"
+                                                 "%.01f%% in use"),
+                                 name, usage->busy / 10.0);
+            }
+            break;
+        }
+        case graph_thermal: {
+            const ThermalReading *reading = &multiload->thermal_reading;
+
+            if (!multiload->thermal_valid) {
+                g_string_printf (tooltip_text, _("%s:\nNo temperature sensor"), name);
+            }
+            else {
+                /* xgettext: the hottest temperature, its sensor, then the number of sensors */
+                g_string_printf (tooltip_text, ngettext ("%s:\n"
+                                                         "%.01f \302\260C (%s)\n"
+                                                         "hottest of %u sensor",
+                                                         "%s:\n"
+                                                         "%.01f \302\260C (%s)\n"
+                                                         "hottest of %u sensors",
+                                                         reading->n_sensors),
+                                 name, reading->hottest / 1000.0, reading->label,
+                                 reading->n_sensors);
+            }
             break;
         }
         case graph_netload2: {
-            char *tx_in, *tx_out;
+            char tx_in [NETSPEED_FORMAT_SIZE], tx_out [NETSPEED_FORMAT_SIZE];
 
-            tx_in = netspeed_get(multiload->netspeed_in);
-            tx_out = netspeed_get(multiload->netspeed_out);
+            netspeed_format (multiload->netspeed_in, tx_in, sizeof tx_in);
+            netspeed_format (multiload->netspeed_out, tx_out, sizeof tx_out);
             /* xgettext: same as in graphic tab of g-s-m */
-            tooltip_text = g_strdup_printf(_("%s:\n"
-                                           "Receiving %s\n"
-                                           "Sending %s"),
-                                           name, tx_in, tx_out);
-            g_free(tx_in);
-            g_free(tx_out);
+            g_string_printf (tooltip_text, _("%s:\n"
+                                             "Receiving %s\n"
+                                             "Sending %s"),
+                             name, tx_in, tx_out);
             break;
         }
         default: {
@@ -331,16 +595,14 @@ multiload_applet_tooltip_update(LoadGraph *g)
                 g_assert_not_reached ();
 
             percent = CLAMP (ratio * 100.0f, 0.0f, 100.0f);
-            tooltip_text = g_strdup_printf(_("%s:\n"
-                                           "%.01f%% in use"),
-                                           name,
-                                           percent);
+            g_string_printf (tooltip_text, _("%s:\n"
+                                             "%.01f%% in use"),
+                             name,
+                             percent);
         }
     }
 
-    gtk_widget_set_tooltip_text(g->disp, tooltip_text);
-
-    g_free(tooltip_text);
+    return tooltip_text->str;
 }
 
 static void
@@ -357,7 +619,11 @@ multiload_create_graphs(MultiloadApplet *ma)
              [graph_netload2] = { _("Net Load"),     VIEW_NETLOAD_KEY,  "netload2", 6,          GetNet },
              [graph_swapload] = { _("Swap Load"),    VIEW_SWAPLOAD_KEY, "swapload", swapload_n, GetSwap },
              [graph_loadavg]  = { _("Load Average"), VIEW_LOADAVG_KEY,  "loadavg",  3,          GetLoadAvg },
-             [graph_diskload] = { _("Disk Load"),    VIEW_DISKLOAD_KEY, "diskload", diskload_n, GetDiskLoad }
+             [graph_diskload] = { _("Disk Load"),    VIEW_DISKLOAD_KEY, "diskload", diskload_n, GetDiskLoad },
+             [graph_psi]      = { _("Pressure"),     VIEW_PSI_KEY,      "psi",      psi_n,      GetPsi },
+             [graph_cgroup]   = { _("Control Groups"), VIEW_CGROUP_KEY, "cgroup",   cgroup_n,   GetCgroup },
+             [graph_gpuload]  = { _("GPU Load"),     VIEW_GPULOAD_KEY,  "gpuload",  gpuload_n,  GetGpu },
+             [graph_thermal]  = { _("Temperature"),  VIEW_THERMAL_KEY,  "thermal",  thermal_n,  GetThermal }
            };
 
     guint size;
@@ -372,6 +638,7 @@ multiload_create_graphs(MultiloadApplet *ma)
     net_threshold1  = CLAMP (g_settings_get_uint64 (ma->settings, KEY_NET_THRESHOLD1), MIN_NET_THRESHOLD1, MAX_NET_THRESHOLD1);
     net_threshold2  = CLAMP (g_settings_get_uint64 (ma->settings, KEY_NET_THRESHOLD2), MIN_NET_THRESHOLD2, MAX_NET_THRESHOLD2);
     net_threshold3  = CLAMP (g_settings_get_uint64 (ma->settings, KEY_NET_THRESHOLD3), MIN_NET_THRESHOLD3, MAX_NET_THRESHOLD3);
+    ma->speed = speed;
     if (net_threshold1 >= net_threshold2)
     {
        net_threshold1 = net_threshold2 - 1;
@@ -397,6 +664,7 @@ multiload_create_graphs(MultiloadApplet *ma)
     /* for Network graph, colors[4] is grid line color, it should not be used in loop in load-graph.c */
     /* for Network graph, colors[5] is indicator color, it should not be used in loop in load-graph.c */
     ma->graphs[graph_netload2]->n = 4;
+    ma->graphs[graph_netload2]->n_values = 4;
     ma->net_threshold1 = net_threshold1;
     ma->net_threshold2 = net_threshold2;
     ma->net_threshold3 = net_threshold3;
@@ -404,6 +672,18 @@ multiload_create_graphs(MultiloadApplet *ma)
     ma->netspeed_out = netspeed_new (ma->graphs [graph_netload2]);
     /* for Load graph, colors[2] is grid line color, it should not be used in loop in load-graph.c */
     ma->graphs[graph_loadavg]->n = 2;
+    ma->graphs[graph_loadavg]->n_values = 2;
+
+    /* the per-core heat map keeps one value per core, and the colors of the total graph */
+    if (ma->cpuload_per_core) {
+        ma->ncpu = multiload_get_ncpu ();
+        ma->graphs[graph_cpuload]->n_values = ma->ncpu;
+        ma->graphs[graph_cpuload]->heatmap = TRUE;
+        ma->graphs[graph_cpuload]->get_data = GetLoadPerCore;
+
+        g_free (ma->cpu_core_last);
+        ma->cpu_core_last = g_new0 (guint64, 2 * ma->ncpu);
+    }
 }
 
 /* remove the old graphs and rebuild them */
@@ -423,7 +703,10 @@ multiload_applet_refresh(MultiloadApplet *ma)
         gtk_widget_destroy(ma->graphs[i]->main_widget);
 
         load_graph_unalloc(ma->graphs[i]);
+        if (ma->graphs[i]->tooltip_text)
+            g_string_free (ma->graphs[i]->tooltip_text, TRUE);
         g_free(ma->graphs[i]);
+        ma->graphs[i] = NULL;
     }
 
     if (ma->box)
@@ -456,6 +739,8 @@ multiload_applet_refresh(MultiloadApplet *ma)
     }
     gtk_widget_show (ma->box);
 
+    multiload_applet_update_psi_trigger (ma);
+
     return;
 }
 
@@ -487,6 +772,8 @@ multiload_applet_new(MatePanelApplet *applet, const gchar *iid, gpointer data)
     context = gtk_widget_get_style_context (GTK_WIDGET (applet));
     gtk_style_context_add_class (context, "multiload-applet");
 
+    applet_startup_mark ("multiload factory");
+
     ma = g_new0(MultiloadApplet, 1);
 
     ma->applet = applet;
@@ -502,6 +789,23 @@ multiload_applet_new(MatePanelApplet *applet, const gchar *iid, gpointer data)
     gtk_window_set_default_icon_name ("utilities-system-monitor");
 
     ma->settings = mate_panel_applet_settings_new (applet, "org.mate.panel.applet.multiload");
+    ma->cpuload_per_core = g_settings_get_boolean (ma->settings, CPULOAD_PER_CORE_KEY);
+    ma->history_level = MIN (g_settings_get_uint (ma->settings, HISTORY_LEVEL_KEY), LOAD_GRAPH_LEVELS);
+    ma->psi_trigger_enabled = g_settings_get_boolean (ma->settings, PSI_TRIGGER_KEY);
+    g_signal_connect (ma->settings, "changed::" CGROUP_UNITS_KEY,
+                      G_CALLBACK (multiload_cgroup_units_changed_cb), ma);
+    ma->export = multiload_export_new ();
+
+    ma->metrics = sampler_metrics_new (multiload_export_metrics, ma);
+    g_signal_connect (ma->settings, "changed::" METRICS_SOCKET_KEY,
+                      G_CALLBACK (multiload_metrics_changed_cb), ma);
+    g_signal_connect (ma->settings, "changed::" METRICS_TEXTFILE_KEY,
+                      G_CALLBACK (multiload_metrics_changed_cb), ma);
+
+    /* the screensaver and the metrics can wait for the first frame */
+    ma->screensaver_cancellable = g_cancellable_new ();
+    applet_startup_defer (GTK_WIDGET (applet), "multiload",
+                          multiload_applet_start_deferred, ma);
     mate_panel_applet_set_flags (applet, MATE_PANEL_APPLET_EXPAND_MINOR);
 
     action_group = gtk_action_group_new ("Multiload Applet Actions");
@@ -560,6 +864,8 @@ multiload_applet_new(MatePanelApplet *applet, const gchar *iid, gpointer data)
 
     gtk_widget_show(GTK_WIDGET(applet));
 
+    applet_startup_mark ("multiload constructed");
+
     return TRUE;
 }
 
@@ -0,0 +1,412 @@
+/* Measures the multiload collectors and the graph renderer without a panel.
+ *
+ * Every graph is created without a widget and drawn into a cairo image
+ * surface; each tick runs the same load_graph_update () as the applet's
+ * sampler.  The collector alone is timed in a separate pass, so the
+ * difference between both is the cost of the history and of drawing.
+ * A third pass repaints the whole graph on every tick, as after a change
+ * of scale, which is the worst case of a frame. Every pass reports the
+ * median, 99th percentile and maximum time of a tick besides the mean.
+ *
+ * With --record the files the collectors read are captured, and with
+ * --replay a capture is read instead of /proc and /sys, so that a run
+ * on another machine or from a bug report can be repeated.
+ *
+ * Built on request only: make -C multiload/src multiload-bench
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <cairo.h>
+
+#include "common/sampler-replay.h"
+
+#include "global.h"
+
+/* Count the allocations of the whole process, glib and cairo included.
+ * glibc lets a program replace malloc () and keeps the real one reachable
+ * under its internal name. */
+#ifdef __GLIBC__
+static guint64 bench_allocs = 0;
+
+extern void *__libc_malloc   (size_t size);
+extern void *__libc_calloc   (size_t n, size_t size);
+extern void *__libc_realloc  (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+void *
+malloc (size_t size)
+{
+    bench_allocs++;
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+    bench_allocs++;
+    return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+    bench_allocs++;
+    return __libc_realloc (ptr, size);
+}
+
+void *
+memalign (size_t alignment, size_t size)
+{
+    bench_allocs++;
+    return __libc_memalign (alignment, size);
+}
+#define BENCH_HAVE_ALLOCS TRUE
+#else
+static const guint64 bench_allocs = 0;
+#define BENCH_HAVE_ALLOCS FALSE
+#endif
+
+typedef struct
+{
+    gint64  ns;
+    guint64 allocs;
+    guint64 syscalls;
+} BenchCounters;
+
+/* the time of every tick of the current pass, allocated up front */
+static gint64 *bench_times = NULL;
+
+static gint    bench_width = 40;
+static gint    bench_height = 24;
+static gint    bench_ticks = 1000;
+static gint    bench_interval = 0;
+static gint    bench_level = 0;
+static gint    bench_scale = 1;
+static gchar  *bench_graphs = NULL;
+static gboolean bench_per_core = FALSE;
+static gchar  *bench_record = NULL;
+static gchar  *bench_replay = NULL;
+
+static GOptionEntry bench_entries [] = {
+    { "width",    'W', 0, G_OPTION_ARG_INT,      &bench_width,    "History width in pixels (default 40)", "PIXELS" },
+    { "height",   'H', 0, G_OPTION_ARG_INT,      &bench_height,   "Graph height in pixels (default 24)", "PIXELS" },
+    { "ticks",    'n', 0, G_OPTION_ARG_INT,      &bench_ticks,    "Ticks measured per graph (default 1000)", "N" },
+    { "interval", 'i', 0, G_OPTION_ARG_INT,      &bench_interval, "Sample interval in ms, 0 runs back to back", "MS" },
+    { "level",    'l', 0, G_OPTION_ARG_INT,      &bench_level,    "History level shown, 0 to 3", "LEVEL" },
+    { "scale",    's', 0, G_OPTION_ARG_INT,      &bench_scale,    "Device scale of the surface, 1 to 4", "FACTOR" },
+    { "graphs",   'g', 0, G_OPTION_ARG_STRING,   &bench_graphs,   "Comma separated graphs (default all)", "cpuload,memload,..." },
+    { "per-core", 'c', 0, G_OPTION_ARG_NONE,     &bench_per_core, "Use the per-core CPU heat map", NULL },
+    { "record",   'r', 0, G_OPTION_ARG_FILENAME, &bench_record,   "Capture the files read into FILE", "FILE" },
+    { "replay",   'R', 0, G_OPTION_ARG_FILENAME, &bench_replay,   "Read the files from a capture", "FILE" },
+    { NULL }
+};
+
+/* The applet only formats tooltips for graphs on the panel. */
+const gchar *
+multiload_applet_tooltip_text (LoadGraph *g)
+{
+    return g->name;
+}
+
+static gint64
+bench_now_ns (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The kernel counts the read and write class system calls of a process;
+ * nothing cheaper counts all of them without privileges. */
+static guint64
+bench_syscalls (void)
+{
+    static int fd = -1;
+    char buffer [256];
+    const char *field;
+    ssize_t len;
+    guint64 total = 0;
+
+    if (fd < 0 && (fd = open ("/proc/self/io", O_RDONLY | O_CLOEXEC)) < 0)
+        return 0;
+
+    /* a single read, so that the measurement costs one call */
+    len = pread (fd, buffer, sizeof buffer - 1, 0);
+    if (len <= 0)
+        return 0;
+    buffer [len] = '\0';
+
+    if ((field = strstr (buffer, "syscr: ")) != NULL)
+        total += g_ascii_strtoull (field + 7, NULL, 10);
+    if ((field = strstr (buffer, "syscw: ")) != NULL)
+        total += g_ascii_strtoull (field + 7, NULL, 10);
+
+    return total;
+}
+
+/* Time is only summed around the measured calls, but neither the waits
+ * between them nor the clock allocate or read, so the other counters span
+ * the whole pass. */
+static void
+bench_counters_start (BenchCounters *c)
+{
+    c->ns = 0;
+    c->syscalls = bench_syscalls ();
+    c->allocs = bench_allocs;
+}
+
+static void
+bench_counters_stop (BenchCounters *c)
+{
+    c->allocs = bench_allocs - c->allocs;
+    /* the read of /proc/self/io that started the measurement */
+    c->syscalls = bench_syscalls () - c->syscalls - 1;
+}
+
+static void
+bench_counters_add (BenchCounters *c,
+                    gint           tick,
+                    gint64         start)
+{
+    gint64 ns = bench_now_ns () - start;
+
+    bench_times [tick] = ns;
+    c->ns += ns;
+}
+
+static gint
+bench_compare_times (gconstpointer a,
+                     gconstpointer b)
+{
+    gint64 ta = *(const gint64 *) a, tb = *(const gint64 *) b;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+static void
+bench_wait (void)
+{
+    if (bench_interval > 0)
+        g_usleep ((gulong) bench_interval * 1000);
+}
+
+static void
+bench_print (const gchar         *name,
+             const gchar         *what,
+             const BenchCounters *c)
+{
+    qsort (bench_times, (gsize) bench_ticks, sizeof (gint64), bench_compare_times);
+
+    printf ("%-10s %-8s %12.0f %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %12.2f %12.2f\n",
+            name, what,
+            (double) c->ns / bench_ticks,
+            bench_times [(bench_ticks - 1) / 2],
+            bench_times [(bench_ticks - 1) * 99 / 100],
+            bench_times [bench_ticks - 1],
+            (double) c->allocs / bench_ticks,
+            (double) c->syscalls / bench_ticks);
+}
+
+static LoadGraph *
+bench_graph_new (MultiloadApplet   *ma,
+                 const gchar       *name,
+                 guint              n,
+                 guint              n_values,
+                 LoadGraphDataFunc  get_data)
+{
+    LoadGraph *g;
+    guint i;
+
+    g = g_new0 (LoadGraph, 1);
+    g->multiload = ma;
+    g->name = name;
+    g->n = n;
+    g->n_values = n_values;
+    g->speed = (guint) MAX (bench_interval, REFRESH_RATE_MIN);
+    g->interval = g->speed;
+    g->level = (guint) CLAMP (bench_level, 0, LOAD_GRAPH_LEVELS);
+    g->get_data = get_data;
+
+    /* distinct colors, so that every segment really gets painted */
+    g->colors = g_new0 (GdkRGBA, n + 2);
+    for (i = 0; i < n + 2; i++)
+    {
+        g->colors [i].red = (gdouble) (i % 3) / 2.0;
+        g->colors [i].green = (gdouble) (i % 5) / 4.0;
+        g->colors [i].blue = (gdouble) (i % 7) / 6.0;
+        g->colors [i].alpha = 1.0;
+    }
+
+    return g;
+}
+
+static void
+bench_graph (LoadGraph *g)
+{
+    cairo_surface_t *surface;
+    BenchCounters collect, tick, redraw;
+    guint64 *scratch;
+    gint i;
+
+    /* as gdk_window_create_similar_image_surface () on a HiDPI screen */
+    surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                          bench_width * bench_scale,
+                                          bench_height * bench_scale);
+    cairo_surface_set_device_scale (surface, bench_scale, bench_scale);
+    load_graph_set_surface (g, surface);
+    cairo_surface_destroy (surface);
+
+    /* prime the counters of the collectors and the first full repaint */
+    load_graph_update (g);
+
+    scratch = g_new0 (guint64, g->n_values);
+    bench_counters_start (&collect);
+    for (i = 0; i < bench_ticks; i++)
+    {
+        gint64 start;
+
+        bench_wait ();
+        start = bench_now_ns ();
+        g->get_data (g->draw_height, scratch, g);
+        bench_counters_add (&collect, i, start);
+    }
+    bench_counters_stop (&collect);
+    g_free (scratch);
+    bench_print (g->name, "collect", &collect);
+
+    bench_counters_start (&tick);
+    for (i = 0; i < bench_ticks; i++)
+    {
+        gint64 start;
+
+        bench_wait ();
+        start = bench_now_ns ();
+        load_graph_update (g);
+        bench_counters_add (&tick, i, start);
+    }
+    bench_counters_stop (&tick);
+    bench_print (g->name, "tick", &tick);
+
+    bench_counters_start (&redraw);
+    for (i = 0; i < bench_ticks; i++)
+    {
+        gint64 start;
+
+        bench_wait ();
+        start = bench_now_ns ();
+        load_graph_queue_full_redraw (g);
+        load_graph_update (g);
+        bench_counters_add (&redraw, i, start);
+    }
+    bench_counters_stop (&redraw);
+    bench_print (g->name, "redraw", &redraw);
+}
+
+static gboolean
+bench_wanted (gchar       **wanted,
+              const gchar  *name)
+{
+    return wanted == NULL || g_strv_contains ((const gchar * const *) wanted, name);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    MultiloadApplet *ma;
+    gchar **wanted = NULL;
+    guint i;
+
+    context = g_option_context_new ("- measure the multiload collectors and renderer");
+    g_option_context_add_main_entries (context, bench_entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    bench_width = CLAMP (bench_width, 1, 4096);
+    bench_height = CLAMP (bench_height, 1, 4096);
+    bench_ticks = MAX (bench_ticks, 1);
+    bench_interval = CLAMP (bench_interval, 0, REFRESH_RATE_MAX);
+    bench_scale = CLAMP (bench_scale, 1, 4);
+    bench_times = g_new (gint64, bench_ticks);
+
+    if (bench_graphs != NULL)
+        wanted = g_strsplit (bench_graphs, ",", -1);
+
+    if ((bench_replay != NULL && !sampler_replay_load (bench_replay, &error)) ||
+        (bench_record != NULL && !sampler_record_start (bench_record, &error)))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+
+    ma = g_new0 (MultiloadApplet, 1);
+    ma->speed = (guint) MAX (bench_interval, REFRESH_RATE_MIN);
+    ma->net_threshold1 = 1000000;
+    ma->net_threshold2 = 10000000;
+    ma->net_threshold3 = 100000000;
+
+    ma->graphs [graph_cpuload]  = bench_graph_new (ma, "cpuload",  cpuload_n,  cpuload_n,  GetLoad);
+    ma->graphs [graph_memload]  = bench_graph_new (ma, "memload",  memload_n,  memload_n,  GetMemory);
+    ma->graphs [graph_netload2] = bench_graph_new (ma, "netload2", 4,          4,          GetNet);
+    ma->graphs [graph_swapload] = bench_graph_new (ma, "swapload", swapload_n, swapload_n, GetSwap);
+    ma->graphs [graph_loadavg]  = bench_graph_new (ma, "loadavg",  2,          2,          GetLoadAvg);
+    ma->graphs [graph_diskload] = bench_graph_new (ma, "diskload", diskload_n, diskload_n, GetDiskLoad);
+    ma->graphs [graph_psi]      = bench_graph_new (ma, "psi",      psi_n,      psi_n,      GetPsi);
+    ma->graphs [graph_cgroup]   = bench_graph_new (ma, "cgroup",   cgroup_n,   cgroup_n,   GetCgroup);
+    ma->graphs [graph_gpuload]  = bench_graph_new (ma, "gpuload",  gpuload_n,  gpuload_n,  GetGpu);
+    ma->graphs [graph_thermal]  = bench_graph_new (ma, "thermal",  thermal_n,  thermal_n,  GetThermal);
+
+    ma->netspeed_in = netspeed_new (ma->graphs [graph_netload2]);
+    ma->netspeed_out = netspeed_new (ma->graphs [graph_netload2]);
+
+    if (bench_per_core)
+    {
+        ma->cpuload_per_core = TRUE;
+        ma->ncpu = multiload_get_ncpu ();
+        ma->cpu_core_last = g_new0 (guint64, 2 * ma->ncpu);
+        ma->graphs [graph_cpuload]->n_values = ma->ncpu;
+        ma->graphs [graph_cpuload]->heatmap = TRUE;
+        ma->graphs [graph_cpuload]->get_data = GetLoadPerCore;
+    }
+
+    printf ("# %dx%d at scale %d, level %d, %d ticks every %d ms%s\n",
+            bench_width, bench_height, bench_scale, bench_level, bench_ticks, bench_interval,
+            BENCH_HAVE_ALLOCS ? "" : ", allocations not counted");
+    printf ("%-10s %-8s %12s %10s %10s %10s %12s %12s\n",
+            "graph", "pass", "ns/tick", "p50 ns", "p99 ns", "max ns",
+            "allocs/tick", "syscalls/tick");
+
+    for (i = 0; i < graph_n; i++)
+    {
+        if (bench_wanted (wanted, ma->graphs [i]->name))
+            bench_graph (ma->graphs [i]);
+    }
+
+    /* the last samples were repeated, so the later ticks read no change */
+    if (sampler_replay_exhausted ())
+        printf ("# %s ran out of samples, run it with the graphs and ticks it was recorded with\n",
+                bench_replay);
+
+    g_strfreev (wanted);
+    g_free (bench_times);
+
+    return EXIT_SUCCESS;
+}
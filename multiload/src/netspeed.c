@@ -1,15 +1,19 @@
 #include <config.h>
 #include <glib.h>
+#include <glib/gi18n.h>
 
 #include "netspeed.h"
+#include "common/sampler-rate.h"
 
-enum { N_STATES = 4 };
+/* the tooltip shows the rate over at least this long */
+#define NETSPEED_WINDOW_MSEC 1500
+/* and smooths it further with this time constant */
+#define NETSPEED_SMOOTHING   G_USEC_PER_SEC
 
 struct _NetSpeed
 {
     LoadGraph *graph;
-    guint64 states[N_STATES];
-    size_t cur;
+    RateEstimator *estimator;
 };
 
 NetSpeed*
@@ -17,11 +21,13 @@ netspeed_new (LoadGraph *g)
 {
     NetSpeed *ns = g_new0 (NetSpeed, 1);
     ns->graph = g;
+    ns->estimator = rate_estimator_new (3, NETSPEED_SMOOTHING);
     return ns;
 }
 
 void netspeed_delete(NetSpeed *ns)
 {
+    rate_estimator_free (ns->estimator);
     g_free(ns);
 }
 
@@ -29,36 +35,48 @@ void
 netspeed_add (NetSpeed *ns,
               guint64   tx)
 {
-    ns->cur = (ns->cur + 1) % N_STATES;
-    ns->states[ns->cur] = tx;
+    /* keep the window length in time when the update interval changes */
+    rate_estimator_set_window (ns->estimator,
+                               MAX (3, NETSPEED_WINDOW_MSEC / MAX (ns->graph->speed, 1)));
+    rate_estimator_add (ns->estimator, tx, g_get_monotonic_time ());
 }
 
-char*
-netspeed_get (NetSpeed *ns)
+/* bytes per second */
+gdouble
+netspeed_get_rate (NetSpeed *ns)
 {
-    guint64  older;
-    guint64  newer;
-    guint64  rate;
-    char    *bytes;
-    char    *text;
+    return rate_estimator_get (ns->estimator);
+}
+
+void
+netspeed_format (NetSpeed *ns,
+                 gchar    *buffer,
+                 gsize     size)
+{
+    static const gchar *formats [] = {
+        N_("%.1f kB/s"),
+        N_("%.1f MB/s"),
+        N_("%.1f GB/s"),
+        N_("%.1f TB/s")
+    };
+    gdouble rate;
+    guint unit;
+
+    /* Until there is enough data, or after the network interface has
+       jumped back, the rate is 0. That is likely to be accurate, and
+       in any event it fixes itself in a few seconds. */
+    rate = netspeed_get_rate (ns);
 
-    newer = ns->states[ns->cur];
-    older = ns->states[(ns->cur + 1) % N_STATES];
+    if (rate < 1000.0) {
+        guint bytes = (guint) rate;
 
-    if ((older != 0) && (newer > older))
-        rate = (newer - older) * 1000 / ((N_STATES - 1) * ns->graph->speed);
-    else
-        /* We end up here if we haven't got enough data yet or the
-        network interface has jumped back (or there has never
-        been any activity on any interface). A value of 0 is
-        likely to be accurate, but if it is wrong it will be
-        clearly wrong. In any event, it should fix itself in a
-        few seconds. */
-        rate = 0;
+        g_snprintf (buffer, size, ngettext ("%u byte/s", "%u bytes/s", bytes), bytes);
+        return;
+    }
 
-    bytes = g_format_size (rate);
-    text = g_strdup_printf (_("%s/s"), bytes);
-    g_free (bytes);
+    rate /= 1000.0;
+    for (unit = 0; rate >= 1000.0 && unit < G_N_ELEMENTS (formats) - 1; unit++)
+        rate /= 1000.0;
 
-    return text;
+    g_snprintf (buffer, size, _(formats [unit]), rate);
 }
@@ -7,9 +7,13 @@ typedef struct _NetSpeed NetSpeed;
 
 #include "global.h"
 
+/* large enough for any netspeed_format () result */
+#define NETSPEED_FORMAT_SIZE 32
+
 NetSpeed* netspeed_new(LoadGraph *graph);
 void netspeed_delete(NetSpeed *ns);
 void netspeed_add(NetSpeed *ns, guint64 tx);
-char* netspeed_get(NetSpeed *ns);
+void netspeed_format(NetSpeed *ns, gchar *buffer, gsize size);
+gdouble netspeed_get_rate(NetSpeed *ns);
 
 #endif /* H_MULTILOAD_NETSPEED_ */
@@ -0,0 +1,119 @@
+/* PSI triggers, see Documentation/accounting/psi.rst in the kernel */
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#include "pressure.h"
+
+/* some task stalled for 200 ms of a 2 s window */
+#define PRESSURE_TRIGGER "some 200000 2000000"
+
+static const gchar *pressure_paths [] = {
+    "/proc/pressure/cpu",
+    "/proc/pressure/memory",
+    "/proc/pressure/io",
+};
+
+struct _PressureTrigger
+{
+    GSourceFunc func;
+    gpointer    data;
+    gint        fds [G_N_ELEMENTS (pressure_paths)];
+    guint       watches [G_N_ELEMENTS (pressure_paths)];
+};
+
+static gboolean
+pressure_trigger_cb (gint         fd,
+                     GIOCondition condition,
+                     gpointer     data)
+{
+    PressureTrigger *trigger = data;
+    guint i;
+
+    if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
+    {
+        for (i = 0; i < G_N_ELEMENTS (trigger->fds); i++)
+        {
+            if (trigger->fds [i] == fd)
+                trigger->watches [i] = 0;
+        }
+        return G_SOURCE_REMOVE;
+    }
+
+    trigger->func (trigger->data);
+
+    return G_SOURCE_CONTINUE;
+}
+
+PressureTrigger *
+pressure_trigger_new (GSourceFunc func,
+                      gpointer    data)
+{
+    PressureTrigger *trigger;
+    gboolean any = FALSE;
+    guint i;
+
+    trigger = g_new0 (PressureTrigger, 1);
+    trigger->func = func;
+    trigger->data = data;
+
+    for (i = 0; i < G_N_ELEMENTS (pressure_paths); i++)
+    {
+        gint fd;
+
+        trigger->fds [i] = -1;
+
+        fd = open (pressure_paths [i], O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            g_debug ("Failed to open %s: %s", pressure_paths [i], g_strerror (errno));
+            continue;
+        }
+
+        /* the kernel wants the terminating NUL too */
+        if (write (fd, PRESSURE_TRIGGER, sizeof PRESSURE_TRIGGER) < 0)
+        {
+            g_debug ("Failed to install a trigger on %s: %s",
+                     pressure_paths [i], g_strerror (errno));
+            close (fd);
+            continue;
+        }
+
+        trigger->fds [i] = fd;
+        trigger->watches [i] = g_unix_fd_add (fd, G_IO_PRI | G_IO_ERR,
+                                              pressure_trigger_cb, trigger);
+        any = TRUE;
+    }
+
+    if (!any)
+    {
+        g_free (trigger);
+        return NULL;
+    }
+
+    return trigger;
+}
+
+void
+pressure_trigger_free (PressureTrigger *trigger)
+{
+    guint i;
+
+    if (trigger == NULL)
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS (trigger->fds); i++)
+    {
+        if (trigger->watches [i] != 0)
+            g_source_remove (trigger->watches [i]);
+        if (trigger->fds [i] >= 0)
+            close (trigger->fds [i]);
+    }
+
+    g_free (trigger);
+}
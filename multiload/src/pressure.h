@@ -0,0 +1,19 @@
+#ifndef MATE_APPLETS_MULTILOAD_PRESSURE_H
+#define MATE_APPLETS_MULTILOAD_PRESSURE_H
+
+#include <glib.h>
+
+typedef struct _PressureTrigger PressureTrigger;
+
+/* Calls func from the main loop as soon as some task was stalled on the
+ * CPU, memory or I/O for a tenth of a two second window, two seconds
+ * being the shortest window the kernel grants unprivileged users. The
+ * kernel reports a stall at most once per window.
+ *
+ * Returns NULL when none of the triggers can be installed: the kernel
+ * lacks PSI, or it reserves triggers for privileged users. */
+G_GNUC_INTERNAL PressureTrigger *pressure_trigger_new  (GSourceFunc      func,
+                                                        gpointer         data);
+G_GNUC_INTERNAL void             pressure_trigger_free (PressureTrigger *trigger);
+
+#endif /* MATE_APPLETS_MULTILOAD_PRESSURE_H */
@@ -0,0 +1,193 @@
+/* Direct procfs readers for the Linux collectors.
+ *
+ * libgtop opens and parses the whole file again in every glibtop_get_*
+ * call. The readers here keep the files open, pread() them into a
+ * reusable buffer and only scan for the fields the graphs need.
+ */
+#include <config.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "common/sampler-file.h"
+
+#include "procfs.h"
+
+static SamplerFile proc_stat    = SAMPLER_FILE_INIT ("/proc/stat");
+static SamplerFile proc_meminfo = SAMPLER_FILE_INIT ("/proc/meminfo");
+static SamplerFile proc_loadavg = SAMPLER_FILE_INIT ("/proc/loadavg");
+static SamplerFile proc_pressure [3] = {
+    SAMPLER_FILE_INIT ("/proc/pressure/cpu"),
+    SAMPLER_FILE_INIT ("/proc/pressure/memory"),
+    SAMPLER_FILE_INIT ("/proc/pressure/io"),
+};
+
+/* Parses the columns of a "cpu" line of /proc/stat */
+static gboolean
+procfs_parse_cpu (const gchar *p,
+                  ProcfsCpu   *cpu)
+{
+    guint64 *fields [] = {
+        &cpu->user, &cpu->nice, &cpu->sys, &cpu->idle,
+        &cpu->iowait, &cpu->irq, &cpu->softirq
+    };
+    gsize i;
+
+    memset (cpu, 0, sizeof *cpu);
+
+    /* older kernels have fewer columns, leave the missing ones at 0 */
+    for (i = 0; i < G_N_ELEMENTS (fields); i++)
+    {
+        p = sampler_parse_u64 (p, fields [i]);
+        if (p == NULL)
+            break;
+    }
+
+    /* at least up to idle */
+    return i >= 4;
+}
+
+gboolean
+procfs_get_cpu (ProcfsCpu *cpu)
+{
+    const gchar *p;
+
+    p = sampler_file_read (&proc_stat);
+    if (p == NULL || strncmp (p, "cpu ", 4) != 0)
+        return FALSE;
+
+    return procfs_parse_cpu (p + 4, cpu);
+}
+
+guint
+procfs_get_cpus (ProcfsCpu *cpus,
+                 guint      max)
+{
+    const gchar *p;
+    guint n = 0;
+
+    p = sampler_file_read (&proc_stat);
+    if (p == NULL)
+        return 0;
+
+    /* the "cpuN" lines follow the total, offline CPUs are left out */
+    while ((p = strchr (p, '\n')) != NULL)
+    {
+        guint64 index;
+        const gchar *columns;
+
+        p++;
+        if (strncmp (p, "cpu", 3) != 0)
+            break;
+
+        columns = sampler_parse_u64 (p + 3, &index);
+        if (columns == NULL || index >= max)
+            continue;
+
+        if (procfs_parse_cpu (columns, &cpus [index]))
+            n = MAX (n, (guint) index + 1);
+    }
+
+    return n;
+}
+
+gboolean
+procfs_get_mem (ProcfsMem *mem)
+{
+    static const struct {
+        const gchar *key;
+        gsize        length;
+        gsize        offset;
+    } keys [] = {
+        { "MemTotal",      8, G_STRUCT_OFFSET (ProcfsMem, total) },
+        { "MemFree",       7, G_STRUCT_OFFSET (ProcfsMem, free) },
+        { "Buffers",       7, G_STRUCT_OFFSET (ProcfsMem, buffer) },
+        { "Cached",        6, G_STRUCT_OFFSET (ProcfsMem, cached) },
+        { "Shmem",         5, G_STRUCT_OFFSET (ProcfsMem, shared) },
+        { "SReclaimable", 12, G_STRUCT_OFFSET (ProcfsMem, reclaimable) },
+        { "SwapTotal",     9, G_STRUCT_OFFSET (ProcfsMem, swap_total) },
+        { "SwapFree",      8, G_STRUCT_OFFSET (ProcfsMem, swap_free) }
+    };
+    const gchar *p;
+    gsize found = 0;
+
+    p = sampler_file_read (&proc_meminfo);
+    if (p == NULL)
+        return FALSE;
+
+    memset (mem, 0, sizeof *mem);
+
+    while (*p != '\0' && found < G_N_ELEMENTS (keys))
+    {
+        const gchar *colon;
+        gsize i;
+
+        colon = strchr (p, ':');
+        if (colon == NULL)
+            break;
+
+        for (i = 0; i < G_N_ELEMENTS (keys); i++)
+        {
+            guint64 value;
+
+            if ((gsize) (colon - p) != keys [i].length ||
+                strncmp (p, keys [i].key, keys [i].length) != 0)
+                continue;
+
+            /* meminfo values are in kB */
+            if (sampler_parse_u64 (colon + 1, &value) != NULL)
+            {
+                G_STRUCT_MEMBER (guint64, mem, keys [i].offset) = value * 1024;
+                found++;
+            }
+            break;
+        }
+
+        p = strchr (colon, '\n');
+        if (p == NULL)
+            break;
+        p++;
+    }
+
+    /* the reclaimable slab is cache too, as in free(1) and libgtop */
+    mem->cached += mem->reclaimable;
+
+    return mem->total > 0;
+}
+
+gboolean
+procfs_get_loadavg (double *loadavg)
+{
+    const gchar *p;
+    gchar *end;
+
+    p = sampler_file_read (&proc_loadavg);
+    if (p == NULL)
+        return FALSE;
+
+    *loadavg = g_ascii_strtod (p, &end);
+
+    return end != p;
+}
+
+gboolean
+procfs_get_pressure (guint64 totals [3])
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (proc_pressure); i++)
+    {
+        const gchar *p;
+
+        /* "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" comes first */
+        p = sampler_file_read (&proc_pressure [i]);
+        if (p == NULL || !g_str_has_prefix (p, "some "))
+            return FALSE;
+
+        p = strstr (p, "total=");
+        if (p == NULL || sampler_parse_u64 (p + 6, &totals [i]) == NULL)
+            return FALSE;
+    }
+
+    return TRUE;
+}
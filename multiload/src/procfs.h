@@ -0,0 +1,47 @@
+#ifndef MATE_APPLETS_MULTILOAD_PROCFS_H
+#define MATE_APPLETS_MULTILOAD_PROCFS_H
+
+#include <glib.h>
+
+typedef struct _ProcfsCpu  ProcfsCpu;
+typedef struct _ProcfsMem  ProcfsMem;
+
+/* Values in the units of /proc/stat (clock ticks), like glibtop_cpu */
+struct _ProcfsCpu
+{
+    guint64 user;
+    guint64 nice;
+    guint64 sys;
+    guint64 idle;
+    guint64 iowait;
+    guint64 irq;
+    guint64 softirq;
+};
+
+/* Values in bytes, like glibtop_mem and glibtop_swap */
+struct _ProcfsMem
+{
+    guint64 total;
+    guint64 free;
+    guint64 buffer;
+    guint64 cached;         /* SReclaimable included */
+    guint64 reclaimable;
+    guint64 shared;
+    guint64 swap_total;
+    guint64 swap_free;
+};
+
+/* These return FALSE when /proc is unusable, callers then fall back
+ * to libgtop. */
+G_GNUC_INTERNAL gboolean procfs_get_cpu     (ProcfsCpu *cpu);
+/* Fills cpus [N] from the "cpuN" lines and returns the highest N + 1,
+ * or 0 on failure. Entries of offline CPUs are left untouched. */
+G_GNUC_INTERNAL guint    procfs_get_cpus    (ProcfsCpu *cpus, guint max);
+G_GNUC_INTERNAL gboolean procfs_get_mem     (ProcfsMem *mem);
+G_GNUC_INTERNAL gboolean procfs_get_loadavg (double    *loadavg);
+
+/* The "some" stall totals of /proc/pressure/cpu, memory and io, in
+ * microseconds. FALSE without PSI, which has no libgtop fallback. */
+G_GNUC_INTERNAL gboolean procfs_get_pressure (guint64    totals [3]);
+
+#endif /* MATE_APPLETS_MULTILOAD_PROCFS_H */
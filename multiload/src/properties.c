@@ -98,6 +98,7 @@ on_speed_spin_button_value_changed (GtkSpinButton *spin_button,
 
     value = gtk_spin_button_get_value_as_int (spin_button);
     g_settings_set_uint (ma->settings, REFRESH_RATE_KEY, (guint) value);
+    ma->speed = (guint) value;
     for (i = 0; i < graph_n; i++) {
         load_graph_stop (ma->graphs[i]);
         ma->graphs[i]->speed = (guint) value;
@@ -130,6 +131,23 @@ on_graph_size_spin_button_value_changed (GtkSpinButton *spin_button,
     }
 }
 
+static void
+on_history_level_combo_changed (GtkComboBox *combo,
+                                gpointer     user_data)
+{
+    MultiloadApplet *ma = user_data;
+    gint active;
+    guint i;
+
+    active = gtk_combo_box_get_active (combo);
+    if (active < 0)
+        return;
+
+    ma->history_level = (guint) active;
+    for (i = 0; i < graph_n; i++)
+        load_graph_set_level (ma->graphs[i], ma->history_level);
+}
+
 static void
 on_net_threshold1_spin_button_value_changed (GtkSpinButton *spin_button,
                                              gpointer       user_data)
@@ -185,14 +203,17 @@ static void
 color_button_set (GtkColorChooser *button,
                   GSettings       *settings,
                   const char      *key,
-                  GdkRGBA         *color)
+                  LoadGraph       *graph,
+                  guint            index)
 {
     gchar   *color_string;
 
-    gtk_color_chooser_get_rgba (button, color);
-    color_string = gdk_rgba_to_string (color);
+    gtk_color_chooser_get_rgba (button, &(graph->colors[index]));
+    color_string = gdk_rgba_to_string (&(graph->colors[index]));
     g_settings_set_string (settings, key, color_string);
     g_free (color_string);
+
+    load_graph_queue_full_redraw (graph);
 }
 
 static void
@@ -201,7 +222,7 @@ on_cpuload_usr_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_CPULOAD_USR_COLOR,
-                      &(ma->graphs[graph_cpuload]->colors[cpuload_usr]));
+                      ma->graphs[graph_cpuload], cpuload_usr);
 }
 
 static void
@@ -210,7 +231,7 @@ on_cpuload_sys_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_CPULOAD_SYS_COLOR,
-                      &(ma->graphs[graph_cpuload]->colors[cpuload_sys]));
+                      ma->graphs[graph_cpuload], cpuload_sys);
 }
 
 static void
@@ -219,7 +240,7 @@ on_cpuload_nice_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_CPULOAD_NICE_COLOR,
-                      &(ma->graphs[graph_cpuload]->colors[cpuload_nice]));
+                      ma->graphs[graph_cpuload], cpuload_nice);
 }
 
 static void
@@ -228,7 +249,7 @@ on_cpuload_iowait_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_CPULOAD_IOWAIT_COLOR,
-                      &(ma->graphs[graph_cpuload]->colors[cpuload_iowait]));
+                      ma->graphs[graph_cpuload], cpuload_iowait);
 }
 
 static void
@@ -237,7 +258,7 @@ on_cpuload_free_color_button_color_set (GtkColorButton *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_CPULOAD_IDLE_COLOR,
-                      &(ma->graphs[graph_cpuload]->colors[cpuload_free]));
+                      ma->graphs[graph_cpuload], cpuload_free);
 }
 
 static void
@@ -246,7 +267,7 @@ on_memload_user_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_MEMLOAD_USER_COLOR,
-                      &(ma->graphs[graph_memload]->colors[memload_user]));
+                      ma->graphs[graph_memload], memload_user);
 }
 
 static void
@@ -255,7 +276,7 @@ on_memload_shared_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_MEMLOAD_SHARED_COLOR,
-                      &(ma->graphs[graph_memload]->colors[memload_shared]));
+                      ma->graphs[graph_memload], memload_shared);
 }
 
 static void
@@ -264,7 +285,7 @@ on_memload_buffer_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_MEMLOAD_BUFFER_COLOR,
-                      &(ma->graphs[graph_memload]->colors[memload_buffer]));
+                      ma->graphs[graph_memload], memload_buffer);
 }
 
 static void
@@ -273,7 +294,7 @@ on_memload_cached_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_MEMLOAD_CACHED_COLOR,
-                      &(ma->graphs[graph_memload]->colors[memload_cached]));
+                      ma->graphs[graph_memload], memload_cached);
 }
 
 static void
@@ -282,7 +303,7 @@ on_memload_free_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_MEMLOAD_FREE_COLOR,
-                      &(ma->graphs[graph_memload]->colors[memload_free]));
+                      ma->graphs[graph_memload], memload_free);
 }
 
 static void
@@ -291,7 +312,7 @@ on_netload2_in_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_IN_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_in]));
+                      ma->graphs[graph_netload2], netload2_in);
 }
 
 static void
@@ -300,7 +321,7 @@ on_netload2_out_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_OUT_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_out]));
+                      ma->graphs[graph_netload2], netload2_out);
 }
 
 static void
@@ -309,7 +330,7 @@ on_netload2_loopback_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_LOOPBACK_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_loopback]));
+                      ma->graphs[graph_netload2], netload2_loopback);
 }
 
 static void
@@ -318,7 +339,7 @@ on_netload2_background_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_BACKGROUND_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_background]));
+                      ma->graphs[graph_netload2], netload2_background);
 }
 
 static void
@@ -327,7 +348,7 @@ on_netload2_gridline_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_GRIDLINE_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_gridline]));
+                      ma->graphs[graph_netload2], netload2_gridline);
 }
 
 static void
@@ -336,7 +357,7 @@ on_netload2_indicator_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_NETLOAD2_INDICATOR_COLOR,
-                      &(ma->graphs[graph_netload2]->colors[netload2_indicator]));
+                      ma->graphs[graph_netload2], netload2_indicator);
 }
 
 static void
@@ -345,7 +366,7 @@ on_swapload_used_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_SWAPLOAD_USED_COLOR,
-                      &(ma->graphs[graph_swapload]->colors[swapload_used]));
+                      ma->graphs[graph_swapload], swapload_used);
 }
 
 static void
@@ -354,7 +375,7 @@ on_swapload_free_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_SWAPLOAD_FREE_COLOR,
-                      &(ma->graphs[graph_swapload]->colors[swapload_free]));
+                      ma->graphs[graph_swapload], swapload_free);
 }
 
 static void
@@ -363,7 +384,7 @@ on_loadavg_average_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_LOADAVG_AVERAGE_COLOR,
-                      &(ma->graphs[graph_loadavg]->colors[loadavg_average]));
+                      ma->graphs[graph_loadavg], loadavg_average);
 }
 
 static void
@@ -372,7 +393,7 @@ on_loadavg_background_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_LOADAVG_BACKGROUND_COLOR,
-                      &(ma->graphs[graph_loadavg]->colors[loadavg_background]));
+                      ma->graphs[graph_loadavg], loadavg_background);
 }
 
 static void
@@ -381,7 +402,7 @@ on_loadavg_gridline_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_LOADAVG_GRIDLINE_COLOR,
-                      &(ma->graphs[graph_loadavg]->colors[loadavg_gridline]));
+                      ma->graphs[graph_loadavg], loadavg_gridline);
 }
 
 static void
@@ -390,7 +411,7 @@ on_diskload_read_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_DISKLOAD_READ_COLOR,
-                      &(ma->graphs[graph_diskload]->colors[diskload_read]));
+                      ma->graphs[graph_diskload], diskload_read);
 }
 
 static void
@@ -399,7 +420,7 @@ on_diskload_write_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_DISKLOAD_WRITE_COLOR,
-                      &(ma->graphs[graph_diskload]->colors[diskload_write]));
+                      ma->graphs[graph_diskload], diskload_write);
 }
 
 static void
@@ -408,7 +429,124 @@ on_diskload_free_color_button_color_set (GtkColorButton  *button,
 {
     color_button_set (GTK_COLOR_CHOOSER (button),
                       ma->settings, KEY_DISKLOAD_FREE_COLOR,
-                      &(ma->graphs[graph_diskload]->colors[diskload_free]));
+                      ma->graphs[graph_diskload], diskload_free);
+}
+
+static void
+on_psi_cpu_color_button_color_set (GtkColorButton  *button,
+                                   MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_PSI_CPU_COLOR,
+                      ma->graphs[graph_psi], psi_cpu);
+}
+
+static void
+on_psi_memory_color_button_color_set (GtkColorButton  *button,
+                                      MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_PSI_MEMORY_COLOR,
+                      ma->graphs[graph_psi], psi_memory);
+}
+
+static void
+on_psi_io_color_button_color_set (GtkColorButton  *button,
+                                  MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_PSI_IO_COLOR,
+                      ma->graphs[graph_psi], psi_io);
+}
+
+static void
+on_psi_free_color_button_color_set (GtkColorButton  *button,
+                                    MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_PSI_FREE_COLOR,
+                      ma->graphs[graph_psi], psi_free);
+}
+
+static void
+on_cgroup_0_color_button_color_set (GtkColorButton  *button,
+                                    MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_CGROUP_0_COLOR,
+                      ma->graphs[graph_cgroup], cgroup_0);
+}
+
+static void
+on_cgroup_1_color_button_color_set (GtkColorButton  *button,
+                                    MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_CGROUP_1_COLOR,
+                      ma->graphs[graph_cgroup], cgroup_1);
+}
+
+static void
+on_cgroup_2_color_button_color_set (GtkColorButton  *button,
+                                    MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_CGROUP_2_COLOR,
+                      ma->graphs[graph_cgroup], cgroup_2);
+}
+
+static void
+on_cgroup_3_color_button_color_set (GtkColorButton  *button,
+                                    MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_CGROUP_3_COLOR,
+                      ma->graphs[graph_cgroup], cgroup_3);
+}
+
+static void
+on_cgroup_free_color_button_color_set (GtkColorButton  *button,
+                                       MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_CGROUP_FREE_COLOR,
+                      ma->graphs[graph_cgroup], cgroup_free);
+}
+
+static void
+on_gpuload_used_color_button_color_set (GtkColorButton  *button,
+                                        MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_GPULOAD_USED_COLOR,
+                      ma->graphs[graph_gpuload], gpuload_used);
+}
+
+static void
+on_gpuload_free_color_button_color_set (GtkColorButton  *button,
+                                        MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_GPULOAD_FREE_COLOR,
+                      ma->graphs[graph_gpuload], gpuload_free);
+}
+
+static void
+on_thermal_temp_color_button_color_set (GtkColorButton  *button,
+                                        MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_THERMAL_TEMP_COLOR,
+                      ma->graphs[graph_thermal], thermal_temp);
+}
+
+static void
+on_thermal_free_color_button_color_set (GtkColorButton  *button,
+                                        MultiloadApplet *ma)
+{
+    color_button_set (GTK_COLOR_CHOOSER (button),
+                      ma->settings, KEY_THERMAL_FREE_COLOR,
+                      ma->graphs[graph_thermal], thermal_free);
 }
 
 static void
@@ -429,6 +567,8 @@ graph_set_active (MultiloadApplet *ma,
         gtk_widget_hide (graph->main_widget);
         properties_set_insensitive (ma);
     }
+
+    multiload_applet_update_psi_trigger (ma);
 }
 
 #define GRAPH_ACTIVE_SET(x) graph_set_active (ma, ma->graphs[(x)], \
@@ -476,6 +616,34 @@ on_graph_diskload_checkbox_toggled (GtkCheckButton  *checkbox,
     GRAPH_ACTIVE_SET (graph_diskload);
 }
 
+static void
+on_graph_psi_checkbox_toggled (GtkCheckButton  *checkbox,
+                               MultiloadApplet *ma)
+{
+    GRAPH_ACTIVE_SET (graph_psi);
+}
+
+static void
+on_graph_cgroup_checkbox_toggled (GtkCheckButton  *checkbox,
+                                  MultiloadApplet *ma)
+{
+    GRAPH_ACTIVE_SET (graph_cgroup);
+}
+
+static void
+on_graph_gpuload_checkbox_toggled (GtkCheckButton  *checkbox,
+                                   MultiloadApplet *ma)
+{
+    GRAPH_ACTIVE_SET (graph_gpuload);
+}
+
+static void
+on_graph_thermal_checkbox_toggled (GtkCheckButton  *checkbox,
+                                   MultiloadApplet *ma)
+{
+    GRAPH_ACTIVE_SET (graph_thermal);
+}
+
 /* save the checkbox option to gsettings and apply it on the applet */
 static void
 on_nvme_checkbox_toggled (GtkCheckButton  *checkbox,
@@ -484,6 +652,29 @@ on_nvme_checkbox_toggled (GtkCheckButton  *checkbox,
     ma->nvme_diskstats = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (checkbox));
 }
 
+static void
+on_psi_trigger_checkbox_toggled (GtkCheckButton  *checkbox,
+                                 MultiloadApplet *ma)
+{
+    ma->psi_trigger_enabled = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (checkbox));
+    multiload_applet_update_psi_trigger (ma);
+}
+
+/* the per-core graph keeps a different history, so rebuild the graphs */
+static void
+on_cpuload_per_core_checkbox_toggled (GtkCheckButton  *checkbox,
+                                      MultiloadApplet *ma)
+{
+    gboolean active;
+
+    active = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (checkbox));
+    if (active == ma->cpuload_per_core)
+        return;
+
+    ma->cpuload_per_core = active;
+    multiload_applet_refresh (ma);
+}
+
 static void
 read_spin_uint_button (GtkWidget    *widget,
                        GSettings    *settings,
@@ -536,6 +727,25 @@ read_color_button (GtkWidget    *widget,
         hard_set_sensitive (widget, FALSE);
 }
 
+/* the units are only set in GSettings, the tab lists them */
+static void
+properties_set_cgroup_units (GtkLabel  *label,
+                             GSettings *settings)
+{
+    gchar **units, *list, *text;
+
+    units = g_settings_get_strv (settings, CGROUP_UNITS_KEY);
+    list = g_strjoinv (", ", units);
+    text = g_strdup_printf (_("Shows the processor time of %s. The control groups "
+                              "are set with the %s key."),
+                            *list != '\0' ? list : _("no control groups"),
+                            CGROUP_UNITS_KEY);
+    gtk_label_set_text (label, text);
+    g_free (text);
+    g_free (list);
+    g_strfreev (units);
+}
+
 /* show properties dialog */
 void
 multiload_properties_cb (GtkAction       *action,
@@ -588,6 +798,19 @@ multiload_properties_cb (GtkAction       *action,
     read_color_button (GET_WIDGET ("netload2_indicator_color_button"), ma->settings, KEY_NETLOAD2_INDICATOR_COLOR);
     read_color_button (GET_WIDGET ("netload2_loopback_color_button"), ma->settings, KEY_NETLOAD2_LOOPBACK_COLOR);
     read_color_button (GET_WIDGET ("netload2_out_color_button"), ma->settings, KEY_NETLOAD2_OUT_COLOR);
+    read_color_button (GET_WIDGET ("psi_cpu_color_button"), ma->settings, KEY_PSI_CPU_COLOR);
+    read_color_button (GET_WIDGET ("psi_free_color_button"), ma->settings, KEY_PSI_FREE_COLOR);
+    read_color_button (GET_WIDGET ("psi_io_color_button"), ma->settings, KEY_PSI_IO_COLOR);
+    read_color_button (GET_WIDGET ("psi_memory_color_button"), ma->settings, KEY_PSI_MEMORY_COLOR);
+    read_color_button (GET_WIDGET ("cgroup_0_color_button"), ma->settings, KEY_CGROUP_0_COLOR);
+    read_color_button (GET_WIDGET ("cgroup_1_color_button"), ma->settings, KEY_CGROUP_1_COLOR);
+    read_color_button (GET_WIDGET ("cgroup_2_color_button"), ma->settings, KEY_CGROUP_2_COLOR);
+    read_color_button (GET_WIDGET ("cgroup_3_color_button"), ma->settings, KEY_CGROUP_3_COLOR);
+    read_color_button (GET_WIDGET ("cgroup_free_color_button"), ma->settings, KEY_CGROUP_FREE_COLOR);
+    read_color_button (GET_WIDGET ("gpuload_used_color_button"), ma->settings, KEY_GPULOAD_USED_COLOR);
+    read_color_button (GET_WIDGET ("gpuload_free_color_button"), ma->settings, KEY_GPULOAD_FREE_COLOR);
+    read_color_button (GET_WIDGET ("thermal_temp_color_button"), ma->settings, KEY_THERMAL_TEMP_COLOR);
+    read_color_button (GET_WIDGET ("thermal_free_color_button"), ma->settings, KEY_THERMAL_FREE_COLOR);
     read_color_button (GET_WIDGET ("swapload_free_color_button"), ma->settings, KEY_SWAPLOAD_FREE_COLOR);
     read_color_button (GET_WIDGET ("swapload_used_color_button"), ma->settings, KEY_SWAPLOAD_USED_COLOR);
 
@@ -618,6 +841,10 @@ multiload_properties_cb (GtkAction       *action,
     ma->check_boxes[graph_swapload] = GET_WIDGET ("graph_swapload_checkbox");
     ma->check_boxes[graph_loadavg]  = GET_WIDGET ("graph_loadavg_checkbox");
     ma->check_boxes[graph_diskload] = GET_WIDGET ("graph_diskload_checkbox");
+    ma->check_boxes[graph_psi]      = GET_WIDGET ("graph_psi_checkbox");
+    ma->check_boxes[graph_cgroup]   = GET_WIDGET ("graph_cgroup_checkbox");
+    ma->check_boxes[graph_gpuload]  = GET_WIDGET ("graph_gpuload_checkbox");
+    ma->check_boxes[graph_thermal]  = GET_WIDGET ("graph_thermal_checkbox");
 
     g_settings_bind (ma->settings, VIEW_CPULOAD_KEY,  ma->check_boxes[graph_cpuload],  "active", G_SETTINGS_BIND_DEFAULT);
     g_settings_bind (ma->settings, VIEW_MEMLOAD_KEY,  ma->check_boxes[graph_memload],  "active", G_SETTINGS_BIND_DEFAULT);
@@ -625,8 +852,17 @@ multiload_properties_cb (GtkAction       *action,
     g_settings_bind (ma->settings, VIEW_SWAPLOAD_KEY, ma->check_boxes[graph_swapload], "active", G_SETTINGS_BIND_DEFAULT);
     g_settings_bind (ma->settings, VIEW_LOADAVG_KEY,  ma->check_boxes[graph_loadavg],  "active", G_SETTINGS_BIND_DEFAULT);
     g_settings_bind (ma->settings, VIEW_DISKLOAD_KEY, ma->check_boxes[graph_diskload], "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, VIEW_PSI_KEY,      ma->check_boxes[graph_psi],      "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, VIEW_CGROUP_KEY,   ma->check_boxes[graph_cgroup],   "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, VIEW_GPULOAD_KEY,  ma->check_boxes[graph_gpuload],  "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, VIEW_THERMAL_KEY,  ma->check_boxes[graph_thermal],  "active", G_SETTINGS_BIND_DEFAULT);
 
     g_settings_bind (ma->settings, DISKLOAD_NVME_KEY, GET_WIDGET ("nvme_checkbox"), "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, CPULOAD_PER_CORE_KEY, GET_WIDGET ("cpuload_per_core_checkbox"), "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, PSI_TRIGGER_KEY, GET_WIDGET ("psi_trigger_checkbox"), "active", G_SETTINGS_BIND_DEFAULT);
+    g_settings_bind (ma->settings, HISTORY_LEVEL_KEY, GET_WIDGET ("history_level_combo"), "active", G_SETTINGS_BIND_DEFAULT);
+
+    properties_set_cgroup_units (GTK_LABEL (GET_WIDGET ("cgroup_units_label")), ma->settings);
 
     #undef GET_WIDGET
 
@@ -657,6 +893,19 @@ multiload_properties_cb (GtkAction       *action,
                                       "on_diskload_read_color_button_color_set",       G_CALLBACK (on_diskload_read_color_button_color_set),
                                       "on_diskload_write_color_button_color_set",      G_CALLBACK (on_diskload_write_color_button_color_set),
                                       "on_diskload_free_color_button_color_set",       G_CALLBACK (on_diskload_free_color_button_color_set),
+                                      "on_psi_cpu_color_button_color_set",             G_CALLBACK (on_psi_cpu_color_button_color_set),
+                                      "on_psi_memory_color_button_color_set",          G_CALLBACK (on_psi_memory_color_button_color_set),
+                                      "on_psi_io_color_button_color_set",              G_CALLBACK (on_psi_io_color_button_color_set),
+                                      "on_psi_free_color_button_color_set",            G_CALLBACK (on_psi_free_color_button_color_set),
+                                      "on_cgroup_0_color_button_color_set",            G_CALLBACK (on_cgroup_0_color_button_color_set),
+                                      "on_cgroup_1_color_button_color_set",            G_CALLBACK (on_cgroup_1_color_button_color_set),
+                                      "on_cgroup_2_color_button_color_set",            G_CALLBACK (on_cgroup_2_color_button_color_set),
+                                      "on_cgroup_3_color_button_color_set",            G_CALLBACK (on_cgroup_3_color_button_color_set),
+                                      "on_cgroup_free_color_button_color_set",         G_CALLBACK (on_cgroup_free_color_button_color_set),
+                                      "on_gpuload_used_color_button_color_set",        G_CALLBACK (on_gpuload_used_color_button_color_set),
+                                      "on_gpuload_free_color_button_color_set",        G_CALLBACK (on_gpuload_free_color_button_color_set),
+                                      "on_thermal_temp_color_button_color_set",        G_CALLBACK (on_thermal_temp_color_button_color_set),
+                                      "on_thermal_free_color_button_color_set",        G_CALLBACK (on_thermal_free_color_button_color_set),
                                       "on_properties_dialog_response",                 G_CALLBACK (on_properties_dialog_response),
                                       "on_graph_cpuload_checkbox_toggled",             G_CALLBACK (on_graph_cpuload_checkbox_toggled),
                                       "on_graph_memload_checkbox_toggled",             G_CALLBACK (on_graph_memload_checkbox_toggled),
@@ -664,9 +913,16 @@ multiload_properties_cb (GtkAction       *action,
                                       "on_graph_swapload_checkbox_toggled",            G_CALLBACK (on_graph_swapload_checkbox_toggled),
                                       "on_graph_loadavg_checkbox_toggled",             G_CALLBACK (on_graph_loadavg_checkbox_toggled),
                                       "on_graph_diskload_checkbox_toggled",            G_CALLBACK (on_graph_diskload_checkbox_toggled),
+                                      "on_graph_psi_checkbox_toggled",                 G_CALLBACK (on_graph_psi_checkbox_toggled),
+                                      "on_graph_cgroup_checkbox_toggled",              G_CALLBACK (on_graph_cgroup_checkbox_toggled),
+                                      "on_graph_gpuload_checkbox_toggled",             G_CALLBACK (on_graph_gpuload_checkbox_toggled),
+                                      "on_graph_thermal_checkbox_toggled",             G_CALLBACK (on_graph_thermal_checkbox_toggled),
+                                      "on_psi_trigger_checkbox_toggled",               G_CALLBACK (on_psi_trigger_checkbox_toggled),
                                       "on_nvme_checkbox_toggled",                      G_CALLBACK (on_nvme_checkbox_toggled),
+                                      "on_cpuload_per_core_checkbox_toggled",          G_CALLBACK (on_cpuload_per_core_checkbox_toggled),
                                       "on_graph_size_spin_button_value_changed",       G_CALLBACK (on_graph_size_spin_button_value_changed),
                                       "on_speed_spin_button_value_changed",            G_CALLBACK (on_speed_spin_button_value_changed),
+                                      "on_history_level_combo_changed",                G_CALLBACK (on_history_level_combo_changed),
                                       "on_net_threshold1_spin_button_value_changed",   G_CALLBACK (on_net_threshold1_spin_button_value_changed),
                                       "on_net_threshold2_spin_button_value_changed",   G_CALLBACK (on_net_threshold2_spin_button_value_changed),
                                       "on_net_threshold3_spin_button_value_changed",   G_CALLBACK (on_net_threshold3_spin_button_value_changed),
@@ -0,0 +1,337 @@
+/* Temperature sensors, see Documentation/hwmon/sysfs-interface.rst in
+ * the kernel */
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+
+#include "common/sampler-file.h"
+
+#include "thermal.h"
+
+#define THERMAL_HWMON_DIR "/sys/class/hwmon"
+#define THERMAL_ZONE_DIR  "/sys/class/thermal"
+
+/* the size of the buffer the kernel builds a uevent in */
+#define THERMAL_UEVENT_SIZE 2048
+
+/* A sensor that failed is read again after this long (microseconds),
+ * for the ones that are only switched off for a while without a uevent */
+#define THERMAL_RETRY_INTERVAL (60 * G_USEC_PER_SEC)
+
+typedef struct
+{
+    gchar    *label;
+    gchar    *path;
+    gint      fd;
+    gint64    retry;    /* failed, not read again before this, monotonic */
+} ThermalSensor;
+
+struct _ThermalSampler
+{
+    GArray   *sensors;
+    gboolean  rescan;
+    gint      event_fd;
+    guint     event_id;
+};
+
+/* Reads a short text attribute, NULL if it is not there */
+static gchar *
+thermal_read_text (const gchar *dir,
+                   const gchar *name)
+{
+    gchar *path, buffer [64];
+    gssize len;
+    gint fd;
+
+    path = g_build_filename (dir, name, NULL);
+    fd = sampler_open (path);
+    g_free (path);
+
+    len = sampler_pread (&fd, buffer, sizeof buffer);
+    if (fd >= 0)
+        close (fd);
+
+    return len > 0 ? g_strdup (buffer) : NULL;
+}
+
+static void
+thermal_add_sensor (ThermalSampler *sampler,
+                    gchar          *path,
+                    gchar          *label)
+{
+    ThermalSensor sensor = { label, path, -1, 0 };
+
+    g_array_append_val (sampler->sensors, sensor);
+}
+
+static void
+thermal_scan_hwmon (ThermalSampler *sampler)
+{
+    GDir *hwmons, *attrs;
+    const gchar *hwmon, *attr;
+
+    hwmons = g_dir_open (THERMAL_HWMON_DIR, 0, NULL);
+    if (hwmons == NULL)
+        return;
+
+    while ((hwmon = g_dir_read_name (hwmons)) != NULL)
+    {
+        gchar *dir, *name;
+
+        dir = g_build_filename (THERMAL_HWMON_DIR, hwmon, NULL);
+        attrs = g_dir_open (dir, 0, NULL);
+        if (attrs == NULL)
+        {
+            g_free (dir);
+            continue;
+        }
+
+        name = thermal_read_text (dir, "name");
+
+        while ((attr = g_dir_read_name (attrs)) != NULL)
+        {
+            gchar *label_attr, *label;
+            guint index;
+            gchar end [8];
+
+            /* tempN_input, not the tempN_max and the other limits */
+            if (sscanf (attr, "temp%u_%7s", &index, end) != 2 ||
+                strcmp (end, "input") != 0)
+                continue;
+
+            label_attr = g_strdup_printf ("temp%u_label", index);
+            label = thermal_read_text (dir, label_attr);
+            g_free (label_attr);
+
+            thermal_add_sensor (sampler,
+                                g_build_filename (dir, attr, NULL),
+                                g_strdup_printf ("%s %s", name ? name : hwmon,
+                                                 label ? label : attr));
+            g_free (label);
+        }
+
+        g_free (name);
+        g_dir_close (attrs);
+        g_free (dir);
+    }
+
+    g_dir_close (hwmons);
+}
+
+static void
+thermal_scan_zones (ThermalSampler *sampler)
+{
+    GDir *zones;
+    const gchar *zone;
+
+    zones = g_dir_open (THERMAL_ZONE_DIR, 0, NULL);
+    if (zones == NULL)
+        return;
+
+    while ((zone = g_dir_read_name (zones)) != NULL)
+    {
+        gchar *dir, *type;
+
+        /* not the cooling_deviceN */
+        if (!g_str_has_prefix (zone, "thermal_zone"))
+            continue;
+
+        dir = g_build_filename (THERMAL_ZONE_DIR, zone, NULL);
+        type = thermal_read_text (dir, "type");
+        thermal_add_sensor (sampler,
+                            g_build_filename (dir, "temp", NULL),
+                            type ? type : g_strdup (zone));
+        g_free (dir);
+    }
+
+    g_dir_close (zones);
+}
+
+static void
+thermal_clear_sensors (ThermalSampler *sampler)
+{
+    guint i;
+
+    for (i = 0; i < sampler->sensors->len; i++)
+    {
+        ThermalSensor *sensor = &g_array_index (sampler->sensors, ThermalSensor, i);
+
+        if (sensor->fd >= 0)
+            close (sensor->fd);
+        g_free (sensor->path);
+        g_free (sensor->label);
+    }
+
+    g_array_set_size (sampler->sensors, 0);
+}
+
+static void
+thermal_scan (ThermalSampler *sampler)
+{
+    thermal_clear_sensors (sampler);
+    thermal_scan_hwmon (sampler);
+    thermal_scan_zones (sampler);
+    sampler->rescan = FALSE;
+
+    g_debug ("Found %u temperature sensors", sampler->sensors->len);
+}
+
+/* Notes that the sensors changed, from the uevents of the kernel */
+static gboolean
+thermal_event_cb (gint         fd,
+                  GIOCondition condition,
+                  gpointer     data)
+{
+    ThermalSampler *sampler = data;
+    gchar buffer [THERMAL_UEVENT_SIZE];
+    gssize len;
+
+    if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
+    {
+        sampler->event_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    while ((len = recv (fd, buffer, sizeof buffer - 1, 0)) > 0 ||
+           (len < 0 && errno == EINTR))
+    {
+        gboolean sensor = FALSE, hotplug = FALSE;
+        gchar *s;
+
+        if (len < 0)
+            continue;
+
+        /* "action@devpath" then NUL separated KEY=value pairs */
+        buffer [len] = '\0';
+        for (s = buffer; s < buffer + len; s += strlen (s) + 1)
+        {
+            if (strcmp (s, "SUBSYSTEM=hwmon") == 0 ||
+                strcmp (s, "SUBSYSTEM=thermal") == 0)
+                sensor = TRUE;
+            else if (strcmp (s, "ACTION=add") == 0 ||
+                     strcmp (s, "ACTION=remove") == 0)
+                hotplug = TRUE;
+        }
+
+        if (sensor && hotplug)
+            sampler->rescan = TRUE;
+    }
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+thermal_watch_events (ThermalSampler *sampler)
+{
+    struct sockaddr_nl addr;
+    gint fd;
+
+    fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                 NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+        return;
+
+    memset (&addr, 0, sizeof addr);
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1; /* the events of the kernel, not udev's */
+
+    if (bind (fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    {
+        close (fd);
+        return;
+    }
+
+    sampler->event_fd = fd;
+    sampler->event_id = g_unix_fd_add (fd, G_IO_IN | G_IO_ERR | G_IO_HUP,
+                                       thermal_event_cb, sampler);
+}
+
+ThermalSampler *
+thermal_sampler_new (void)
+{
+    ThermalSampler *sampler;
+
+    sampler = g_new0 (ThermalSampler, 1);
+    sampler->sensors = g_array_new (FALSE, FALSE, sizeof (ThermalSensor));
+    sampler->event_fd = -1;
+
+    /* without uevents the sensors found now are all there is */
+    thermal_watch_events (sampler);
+    thermal_scan (sampler);
+
+    return sampler;
+}
+
+void
+thermal_sampler_free (ThermalSampler *sampler)
+{
+    if (sampler == NULL)
+        return;
+
+    if (sampler->event_id != 0)
+        g_source_remove (sampler->event_id);
+    if (sampler->event_fd >= 0)
+        close (sampler->event_fd);
+
+    thermal_clear_sensors (sampler);
+    g_array_free (sampler->sensors, TRUE);
+    g_free (sampler);
+}
+
+gboolean
+thermal_sampler_read (ThermalSampler *sampler,
+                      ThermalReading *reading)
+{
+    const ThermalSensor *hottest = NULL;
+    gint64 now;
+    guint i;
+
+    if (sampler->rescan)
+        thermal_scan (sampler);
+
+    memset (reading, 0, sizeof *reading);
+    now = g_get_monotonic_time ();
+
+    for (i = 0; i < sampler->sensors->len; i++)
+    {
+        ThermalSensor *sensor = &g_array_index (sampler->sensors, ThermalSensor, i);
+        gchar buffer [16];
+        gint temperature;
+
+        if (sensor->retry != 0 && now < sensor->retry)
+            continue;
+
+        if (sensor->fd < 0)
+            sensor->fd = sampler_open (sensor->path);
+
+        /* sensors that are switched off fail with ENODATA or EAGAIN */
+        if (sampler_pread (&sensor->fd, buffer, sizeof buffer) <= 0)
+        {
+            sensor->retry = now + THERMAL_RETRY_INTERVAL;
+            continue;
+        }
+        sensor->retry = 0;
+
+        temperature = (gint) g_ascii_strtoll (buffer, NULL, 10);
+        if (hottest == NULL || temperature > reading->hottest)
+        {
+            hottest = sensor;
+            reading->hottest = temperature;
+        }
+        reading->n_sensors++;
+    }
+
+    if (hottest == NULL)
+        return FALSE;
+
+    g_strlcpy (reading->label, hottest->label, sizeof reading->label);
+
+    return TRUE;
+}
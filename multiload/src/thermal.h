@@ -0,0 +1,29 @@
+#ifndef MATE_APPLETS_MULTILOAD_THERMAL_H
+#define MATE_APPLETS_MULTILOAD_THERMAL_H
+
+#include <glib.h>
+
+typedef struct _ThermalSampler ThermalSampler;
+typedef struct _ThermalReading ThermalReading;
+
+struct _ThermalReading
+{
+    guint  n_sensors;
+    gint   hottest;        /* millidegrees Celsius */
+    gchar  label [64];     /* of the hottest sensor */
+};
+
+/* The temperature sensors of /sys/class/hwmon and /sys/class/thermal.
+ *
+ * The sensors are looked up once and their files kept open, so a read
+ * is one pread() per sensor. They are only looked up again when a
+ * uevent reports a hwmon device or thermal zone that was added or
+ * removed. */
+G_GNUC_INTERNAL ThermalSampler *thermal_sampler_new  (void);
+G_GNUC_INTERNAL void            thermal_sampler_free (ThermalSampler *sampler);
+
+/* FALSE when there is no sensor that can be read */
+G_GNUC_INTERNAL gboolean        thermal_sampler_read (ThermalSampler *sampler,
+                                                      ThermalReading *reading);
+
+#endif /* MATE_APPLETS_MULTILOAD_THERMAL_H */
@@ -39,6 +39,8 @@
 #include <glibtop/netload.h>
 
 #include "backend.h"
+#include "common/sampler-file.h"
+#include "common/sampler-netlink.h"
 
 #ifdef HAVE_IW
 #include <iwlib.h>
@@ -54,6 +56,8 @@
 #include <netlink/attr.h>
 #include <netlink/msg.h>
 
+#include <glib-unix.h>
+
 #include "nl80211.h"
 #include "ieee80211.h"
 
@@ -62,6 +66,13 @@ struct nl80211_state {
     int nl80211_id;
 };
 
+/* The signal strength is not announced, so the station is also looked
+ * up again after this long (microseconds) */
+#define NL80211_STATION_INTERVAL (10 * G_USEC_PER_SEC)
+
+static guint
+nl80211_event_generation (void);
+
 #endif /* HAVE_NL */
 
 gboolean
@@ -111,135 +122,165 @@ get_available_devices (void)
     return device_glist;
 }
 
-GSList*
-get_ip_address_list (const char *iface_name,
-                     gboolean    ipv4)
+/* The addresses of every interface, from a single getifaddrs () walk
+ * that is only done again once rtnetlink reported an address change
+ */
+typedef struct {
+    GSList        *ipv4;      /* "address/prefix" */
+    GSList        *ipv6;      /* "address/prefix (scope)" */
+    GSList        *ipv6_bare; /* "address" */
+} IfaceAddresses;
+
+static GHashTable *iface_addresses = NULL;
+static guint       iface_addresses_generation;
+
+static void
+iface_addresses_free (IfaceAddresses *addresses)
 {
-    GSList *list = NULL;
-    struct ifaddrs *ifaces;
+    g_slist_free_full (addresses->ipv4, g_free);
+    g_slist_free_full (addresses->ipv6, g_free);
+    g_slist_free_full (addresses->ipv6_bare, g_free);
+    g_free (addresses);
+}
 
-    if (getifaddrs (&ifaces) != -1) {
-        int family;
-        char ip[INET6_ADDRSTRLEN];
+static void
+add_iface_address (IfaceAddresses *addresses,
+                   struct ifaddrs *iface)
+{
+    char ip[INET6_ADDRSTRLEN];
+    unsigned int netmask = 0;
+    void *sinx_addr = NULL;
+
+    if (iface->ifa_addr->sa_family == AF_INET6) {
+        struct sockaddr_in6 ip6_addr;
+        struct sockaddr_in6 ip6_network;
+        uint32_t ip6_netmask = 0;
+        const char *scope;
+        int i;
+
+        memcpy (&ip6_addr, iface->ifa_addr, sizeof (struct sockaddr_in6));
+        memcpy (&ip6_network, iface->ifa_netmask, sizeof (struct sockaddr_in6));
+
+        /* get network scope */
+        if (IN6_IS_ADDR_LINKLOCAL (&ip6_addr.sin6_addr)) {
+            scope = _("link-local");
+        } else if (IN6_IS_ADDR_SITELOCAL (&ip6_addr.sin6_addr)) {
+            scope = _("site-local");
+        } else if (IN6_IS_ADDR_V4MAPPED (&ip6_addr.sin6_addr)) {
+            scope = _("v4mapped");
+        } else if (IN6_IS_ADDR_V4COMPAT (&ip6_addr.sin6_addr)) {
+            scope = _("v4compat");
+        } else if (IN6_IS_ADDR_LOOPBACK (&ip6_addr.sin6_addr)) {
+            scope = _("host");
+        } else if (IN6_IS_ADDR_UNSPECIFIED (&ip6_addr.sin6_addr)) {
+            scope = _("unspecified");
+        } else {
+            scope = _("global");
+        }
 
-        family = ipv4 ? AF_INET : AF_INET6;
-        for (struct ifaddrs *iface = ifaces; iface != NULL; iface = iface->ifa_next) {
-            if (iface->ifa_addr == NULL)
-                continue;
+        /* get network ip */
+        sinx_addr = &ip6_addr.sin6_addr;
+        inet_ntop (iface->ifa_addr->sa_family, sinx_addr, ip, sizeof (ip));
 
-            if ((iface->ifa_addr->sa_family == family) &&
-                !g_strcmp0 (iface->ifa_name, iface_name))
-            {
-                unsigned int netmask = 0;
-                void *sinx_addr = NULL;
-
-                if (iface->ifa_addr->sa_family == AF_INET6) {
-                    struct sockaddr_in6 ip6_addr;
-                    struct sockaddr_in6 ip6_network;
-                    uint32_t ip6_netmask = 0;
-                    const char *scope;
-                    int i;
-
-                    memcpy (&ip6_addr, iface->ifa_addr, sizeof (struct sockaddr_in6));
-                    memcpy (&ip6_network, iface->ifa_netmask, sizeof (struct sockaddr_in6));
-
-                    /* get network scope */
-                    if (IN6_IS_ADDR_LINKLOCAL (&ip6_addr.sin6_addr)) {
-                        scope = _("link-local");
-                    } else if (IN6_IS_ADDR_SITELOCAL (&ip6_addr.sin6_addr)) {
-                        scope = _("site-local");
-                    } else if (IN6_IS_ADDR_V4MAPPED (&ip6_addr.sin6_addr)) {
-                        scope = _("v4mapped");
-                    } else if (IN6_IS_ADDR_V4COMPAT (&ip6_addr.sin6_addr)) {
-                        scope = _("v4compat");
-                    } else if (IN6_IS_ADDR_LOOPBACK (&ip6_addr.sin6_addr)) {
-                        scope = _("host");
-                    } else if (IN6_IS_ADDR_UNSPECIFIED (&ip6_addr.sin6_addr)) {
-                        scope = _("unspecified");
-                    } else {
-                        scope = _("global");
-                    }
-
-                    /* get network ip */
-                    sinx_addr = &ip6_addr.sin6_addr;
-                    inet_ntop (iface->ifa_addr->sa_family, sinx_addr, ip, sizeof (ip));
-
-                    /* get network mask length */
-                    for (i = 0; i < 4; i++) {
-                        ip6_netmask = ntohl (((uint32_t*)(&ip6_network.sin6_addr))[i]);
-                        while (ip6_netmask) {
-                            netmask++;
-                            ip6_netmask <<= 1;
-                        }
-                    }
-
-                    list = g_slist_prepend (list,
-                                            g_strdup_printf ("%s/%u (%s)",
-                                                             ip, netmask, scope));
-                } else {
-                    struct sockaddr_in ip4_addr;
-                    struct sockaddr_in ip4_network;
-                    in_addr_t ip4_netmask = 0;
-
-                    memcpy (&ip4_addr, iface->ifa_addr, sizeof (struct sockaddr_in));
-                    memcpy (&ip4_network, iface->ifa_netmask, sizeof (struct sockaddr_in));
-
-                    /* get network ip */
-                    sinx_addr = &ip4_addr.sin_addr;
-                    inet_ntop (iface->ifa_addr->sa_family, sinx_addr, ip, sizeof (ip));
-
-                    /* get network mask length */
-                    ip4_netmask = ntohl (ip4_network.sin_addr.s_addr);
-                    while (ip4_netmask) {
-                        netmask++;
-                        ip4_netmask <<= 1;
-                    }
-
-                    list = g_slist_prepend (list,
-                                            g_strdup_printf ("%s/%u", ip, netmask));
-                }
+        /* get network mask length */
+        for (i = 0; i < 4; i++) {
+            ip6_netmask = ntohl (((uint32_t*)(&ip6_network.sin6_addr))[i]);
+            while (ip6_netmask) {
+                netmask++;
+                ip6_netmask <<= 1;
             }
         }
-        if (list != NULL)
-            list = g_slist_sort (list, (GCompareFunc) g_strcmp0);
-        freeifaddrs (ifaces);
+
+        addresses->ipv6 = g_slist_prepend (addresses->ipv6,
+                                           g_strdup_printf ("%s/%u (%s)",
+                                                            ip, netmask, scope));
+        addresses->ipv6_bare = g_slist_prepend (addresses->ipv6_bare, g_strdup (ip));
+    } else {
+        struct sockaddr_in ip4_addr;
+        struct sockaddr_in ip4_network;
+        in_addr_t ip4_netmask = 0;
+
+        memcpy (&ip4_addr, iface->ifa_addr, sizeof (struct sockaddr_in));
+        memcpy (&ip4_network, iface->ifa_netmask, sizeof (struct sockaddr_in));
+
+        /* get network ip */
+        sinx_addr = &ip4_addr.sin_addr;
+        inet_ntop (iface->ifa_addr->sa_family, sinx_addr, ip, sizeof (ip));
+
+        /* get network mask length */
+        ip4_netmask = ntohl (ip4_network.sin_addr.s_addr);
+        while (ip4_netmask) {
+            netmask++;
+            ip4_netmask <<= 1;
+        }
+
+        addresses->ipv4 = g_slist_prepend (addresses->ipv4,
+                                           g_strdup_printf ("%s/%u", ip, netmask));
     }
-    return list;
 }
 
-GSList*
-get_ip6_address_list (const char *iface_name)
+static IfaceAddresses *
+get_iface_addresses (const char *iface_name)
 {
-    GSList *list = NULL;
+    guint generation = netlink_link_generation ();
     struct ifaddrs *ifaces;
+    GHashTableIter iter;
+    IfaceAddresses *addresses;
+
+    if (iface_addresses && generation == iface_addresses_generation)
+        return g_hash_table_lookup (iface_addresses, iface_name);
+
+    if (!iface_addresses)
+        iface_addresses = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                 (GDestroyNotify) iface_addresses_free);
+    g_hash_table_remove_all (iface_addresses);
+    iface_addresses_generation = generation;
+
+    if (getifaddrs (&ifaces) == -1)
+        return NULL;
+
+    for (struct ifaddrs *iface = ifaces; iface != NULL; iface = iface->ifa_next) {
+        if (iface->ifa_addr == NULL || iface->ifa_netmask == NULL ||
+            (iface->ifa_addr->sa_family != AF_INET && iface->ifa_addr->sa_family != AF_INET6))
+            continue;
+
+        addresses = g_hash_table_lookup (iface_addresses, iface->ifa_name);
+        if (!addresses) {
+            addresses = g_new0 (IfaceAddresses, 1);
+            g_hash_table_insert (iface_addresses, g_strdup (iface->ifa_name), addresses);
+        }
+        add_iface_address (addresses, iface);
+    }
+    freeifaddrs (ifaces);
 
-    if (getifaddrs (&ifaces) != -1) {
-        char ip6[INET6_ADDRSTRLEN];
-
-        for (struct ifaddrs *iface = ifaces; iface != NULL; iface = iface->ifa_next) {
-            if ((iface->ifa_addr == NULL) || (iface->ifa_addr->sa_family != AF_INET6))
-                continue;
+    g_hash_table_iter_init (&iter, iface_addresses);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &addresses)) {
+        addresses->ipv4 = g_slist_sort (addresses->ipv4, (GCompareFunc) g_strcmp0);
+        addresses->ipv6 = g_slist_sort (addresses->ipv6, (GCompareFunc) g_strcmp0);
+        addresses->ipv6_bare = g_slist_sort (addresses->ipv6_bare, (GCompareFunc) g_strcmp0);
+    }
 
-            if (!g_strcmp0 (iface->ifa_name, iface_name)) {
-                void *sinx_addr = NULL;
+    return g_hash_table_lookup (iface_addresses, iface_name);
+}
 
-                struct sockaddr_in6 ip6_addr;
+const GSList*
+get_ip_address_list (const char *iface_name,
+                     gboolean    ipv4)
+{
+    IfaceAddresses *addresses = get_iface_addresses (iface_name);
 
-                memcpy (&ip6_addr, iface->ifa_addr, sizeof (struct sockaddr_in6));
+    if (!addresses)
+        return NULL;
 
-                /* get network ip */
-                sinx_addr = &ip6_addr.sin6_addr;
-                inet_ntop (iface->ifa_addr->sa_family, sinx_addr, ip6, sizeof (ip6));
+    return ipv4 ? addresses->ipv4 : addresses->ipv6;
+}
 
-                list = g_slist_prepend (list, g_strdup (ip6));
-            }
-        }
+const GSList*
+get_ip6_address_list (const char *iface_name)
+{
+    IfaceAddresses *addresses = get_iface_addresses (iface_name);
 
-        if (list != NULL)
-            list = g_slist_sort (list, (GCompareFunc) g_strcmp0);
-        freeifaddrs (ifaces);
-    }
-    return list;
+    return addresses ? addresses->ipv6_bare : NULL;
 }
 
 const gchar*
@@ -283,13 +324,14 @@ get_default_route (void)
 void
 free_device_info (DevInfo *devinfo)
 {
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (devinfo->sysfs_fd); i++)
+        if (devinfo->sysfs_fd [i] >= 0)
+            close (devinfo->sysfs_fd [i]);
+
     g_free (devinfo->name);
     g_free (devinfo->essid);
-#ifdef HAVE_NL
-    g_free (devinfo->tx_bitrate);
-    g_free (devinfo->rx_bitrate);
-    g_free (devinfo->channel);
-#endif /* HAVE_NL */
     g_free (devinfo);
 }
 
@@ -316,38 +358,27 @@ get_ptp_info (DevInfo *devinfo)
     close (fd);
 }
 
-void
-get_device_info (const char  *device,
-                 DevInfo    **info)
+/* Looks up what only changes with a link or address event: the
+ * interface type, the hardware address or the wireless details, and
+ * the addresses while the device is running
+ */
+static void
+get_device_details (DevInfo               *devinfo,
+                    const glibtop_netload *netload)
 {
-    DevInfo *devinfo;
-    glibtop_netload netload;
     gboolean ptp = FALSE;
 
-    g_assert (device);
-
-    *info = g_new0 (DevInfo, 1);
-    devinfo = *info;
-
-    devinfo->name = g_strdup (device);
-    devinfo->type = DEV_UNKNOWN;
-
-    glibtop_get_netload (&netload, device);
-
-    devinfo->up = (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_UP) ? TRUE : FALSE);
-    devinfo->running = (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_RUNNING) ? TRUE : FALSE);
-
-    if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_LOOPBACK)) {
+    if (netload->if_flags & (1L << GLIBTOP_IF_FLAGS_LOOPBACK)) {
         devinfo->type = DEV_LO;
     }
-    else if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_WIRELESS)) {
+    else if (netload->if_flags & (1L << GLIBTOP_IF_FLAGS_WIRELESS)) {
         devinfo->type = DEV_WIRELESS;
     }
-    else if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_POINTOPOINT)) {
-        if (g_str_has_prefix (device, "plip")) {
+    else if (netload->if_flags & (1L << GLIBTOP_IF_FLAGS_POINTOPOINT)) {
+        if (g_str_has_prefix (devinfo->name, "plip")) {
             devinfo->type = DEV_PLIP;
         }
-        else if (g_str_has_prefix (device, "sl")) {
+        else if (g_str_has_prefix (devinfo->name, "sl")) {
             devinfo->type = DEV_SLIP;
         }
         else {
@@ -367,53 +398,244 @@ get_device_info (const char  *device,
 #endif /* HAVE_NL */
         case DEV_LO:
             break;
-#if defined (HAVE_IW)
-        case DEV_WIRELESS:
-            get_wireless_info (devinfo);
-#endif /* HAVE_IW */
         default:
-            memcpy (devinfo->hwaddr, netload.hwaddress, 8);
+            memcpy (devinfo->hwaddr, netload->hwaddress, 8);
             break;
     }
 
+    devinfo->ptpip = 0;
     if (devinfo->running) {
-        devinfo->ip = netload.address;
-        devinfo->netmask = netload.subnet;
+        devinfo->ip = netload->address;
+        devinfo->netmask = netload->subnet;
+        if (ptp)
+            get_ptp_info (devinfo);
+    } else {
+        devinfo->ip = 0;
+        devinfo->netmask = 0;
+    }
+}
+
+void
+get_device_info (const char  *device,
+                 DevInfo    **info)
+{
+    guint i;
+
+    g_assert (device);
+
+    *info = g_new0 (DevInfo, 1);
+
+    (*info)->name = g_strdup (device);
+    (*info)->type = DEV_UNKNOWN;
+    for (i = 0; i < G_N_ELEMENTS ((*info)->sysfs_fd); i++)
+        (*info)->sysfs_fd [i] = -1;
+
+    update_device_info (*info);
+}
+
+/* The counters are read on every call.  The addresses and the interface
+ * type only change together with an rtnetlink link or address event, so
+ * they are only looked up again after one.
+ * link is the interface from the rtnetlink dump or from sysfs, NULL to use
+ * glibtop.
+ */
+static gboolean
+update_device_info_from_link (DevInfo           *devinfo,
+                              const NetlinkLink *link,
+                              guint              generation,
+                              gint64             time)
+{
+    gboolean have_link = (link != NULL);
+    gboolean refresh;
+    gboolean up, running;
+    guint32 ip;
+
+    g_assert (devinfo && devinfo->name);
+
+    up = devinfo->up;
+    running = devinfo->running;
+    ip = devinfo->ip;
+
+    if (have_link) {
+        devinfo->up = (link->flags & IFF_UP ? TRUE : FALSE);
+        devinfo->running = (link->flags & IFF_RUNNING ? TRUE : FALSE);
+        devinfo->rx = link->rx_bytes;
+        devinfo->tx = link->tx_bytes;
+        devinfo->time = time;
+    }
+
+    refresh = (!have_link || !devinfo->has_details || devinfo->details_generation != generation);
 #if defined (HAVE_NL)
-        if (devinfo->type != DEV_WIRELESS) {
-            devinfo->tx = netload.bytes_out;
+    /* roaming changes the station without a link event */
+    if (devinfo->type == DEV_WIRELESS && devinfo->wireless_generation != nl80211_event_generation ())
+        refresh = TRUE;
+#endif /* HAVE_NL */
+
+    if (refresh) {
+        glibtop_netload netload;
+
+        glibtop_get_netload (&netload, devinfo->name);
+
+        if (!have_link) {
+            devinfo->up = (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_UP) ? TRUE : FALSE);
+            devinfo->running = (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_RUNNING) ? TRUE : FALSE);
             devinfo->rx = netload.bytes_in;
-            if (ptp)
-                get_ptp_info (devinfo);
+            devinfo->tx = netload.bytes_out;
+            devinfo->time = g_get_monotonic_time ();
         }
-#else
-        devinfo->tx = netload.bytes_out;
-        devinfo->rx = netload.bytes_in;
-        if (ptp)
-            get_ptp_info (devinfo);
+
+#if defined (HAVE_NL)
+        /* taken before the dumps, so that no event gets lost */
+        if (netload.if_flags & (1L << GLIBTOP_IF_FLAGS_WIRELESS))
+            devinfo->wireless_generation = nl80211_event_generation ();
 #endif /* HAVE_NL */
+        get_device_details (devinfo, &netload);
+        devinfo->details_generation = generation;
+        devinfo->has_details = TRUE;
+    }
+
+    if (devinfo->type == DEV_WIRELESS) {
+#if defined (HAVE_NL)
+        if (devinfo->running) {
+            gint64 now = g_get_monotonic_time ();
+            guint station_generation;
+
+            station_generation = devinfo->wireless_generation + (guint) (now / NL80211_STATION_INTERVAL);
+
+            if (refresh || devinfo->station_generation != station_generation) {
+                get_wireless_station_info (devinfo);
+                devinfo->station_generation = station_generation;
+                devinfo->station_time = now;
+                devinfo->station_connected_time = devinfo->connected_time;
+            } else if (devinfo->station_connected_time > 0) {
+                devinfo->connected_time = devinfo->station_connected_time +
+                    (guint32) ((now - devinfo->station_time) / G_USEC_PER_SEC);
+            }
+        }
+#elif defined (HAVE_IW)
+        /* the signal changes without any event */
+        get_wireless_info (devinfo);
+#endif
     }
+
+    return (devinfo->ip != ip || devinfo->up != up || devinfo->running != running);
+}
+
+/* The files of /sys/class/net/<device> read when there is no rtnetlink,
+ * each kept open in the DevInfo and read again with a pread() */
+enum {
+    SYSFS_RX_BYTES,
+    SYSFS_TX_BYTES,
+    SYSFS_CARRIER,
+    SYSFS_OPERSTATE
+};
+
+static const char * const sysfs_files [] = {
+    "statistics/rx_bytes",
+    "statistics/tx_bytes",
+    "carrier",
+    "operstate"
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (sysfs_files) == G_N_ELEMENTS (((DevInfo *) NULL)->sysfs_fd));
+
+static gssize
+read_sysfs_file (DevInfo *devinfo,
+                 guint    file,
+                 gchar   *buffer,
+                 gsize    size)
+{
+    if (devinfo->sysfs_fd [file] < 0) {
+        gchar *path;
+
+        path = g_strdup_printf ("/sys/class/net/%s/%s", devinfo->name, sysfs_files [file]);
+        devinfo->sysfs_fd [file] = sampler_open (path);
+        g_free (path);
+    }
+
+    return sampler_pread (&devinfo->sysfs_fd [file], buffer, size);
+}
+
+/* The counters and the state of the device from sysfs, into link as
+ * rtnetlink would have them, which is a few pread() calls where glibtop
+ * parses all of /proc/net/dev.  FALSE if the device has no statistics
+ * there, as on other kernels.
+ */
+static gboolean
+get_sysfs_link (DevInfo     *devinfo,
+                NetlinkLink *link)
+{
+    gchar buffer [32];
+
+    if (read_sysfs_file (devinfo, SYSFS_RX_BYTES, buffer, sizeof buffer) <= 0 ||
+        !sampler_parse_u64 (buffer, &link->rx_bytes) ||
+        read_sysfs_file (devinfo, SYSFS_TX_BYTES, buffer, sizeof buffer) <= 0 ||
+        !sampler_parse_u64 (buffer, &link->tx_bytes))
+        return FALSE;
+
+    g_strlcpy (link->name, devinfo->name, sizeof link->name);
+    link->flags = 0;
+
+    /* the carrier can not be read while the device is down; lo and
+     * tunnels have an operstate of "unknown" when they are up */
+    if (read_sysfs_file (devinfo, SYSFS_CARRIER, buffer, sizeof buffer) > 0) {
+        link->flags |= IFF_UP;
+
+        if (strcmp (buffer, "1") == 0 &&
+            read_sysfs_file (devinfo, SYSFS_OPERSTATE, buffer, sizeof buffer) > 0 &&
+            (strcmp (buffer, "up") == 0 || strcmp (buffer, "unknown") == 0))
+            link->flags |= IFF_RUNNING;
+    }
+
+    return TRUE;
 }
 
 gboolean
-compare_device_info (const DevInfo *a,
-                     const DevInfo *b)
+update_devices_info (DevInfo **devinfos,
+                     guint     n_devinfos)
 {
-    g_assert (a && b);
-    g_assert (a->name && b->name);
+    static GArray *links = NULL;
+    gboolean have_links, changed = FALSE;
+    guint generation, i;
+    gint64 time;
+
+    if (links == NULL)
+        links = g_array_new (FALSE, FALSE, sizeof (NetlinkLink));
+
+    /* one dump for the counters of all the devices */
+    generation = netlink_link_generation ();
+    have_links = netlink_get_links (links);
+    time = g_get_monotonic_time ();
+
+    for (i = 0; i < n_devinfos; i++) {
+        const NetlinkLink *link = NULL;
+        NetlinkLink sysfs_link;
+        guint j;
+
+        for (j = 0; have_links && j < links->len; j++) {
+            if (g_strcmp0 (g_array_index (links, NetlinkLink, j).name, devinfos [i]->name) == 0) {
+                link = &g_array_index (links, NetlinkLink, j);
+                break;
+            }
+        }
 
-    if (!g_str_equal (a->name, b->name))
-        return TRUE;
-    if (a->ip != b->ip)
-        return TRUE;
-    /* Ignore hwaddr, ptpip and netmask... I think this is ok */
-    if (a->up != b->up)
-        return TRUE;
-    if (a->running != b->running)
-        return TRUE;
+        /* glibtop is only left for the details */
+        if (!have_links && get_sysfs_link (devinfos [i], &sysfs_link))
+            link = &sysfs_link;
 
-    return FALSE;
+        if (update_device_info_from_link (devinfos [i], link, generation, time) && i == 0)
+            changed = TRUE;
+    }
+
+    return changed;
 }
+
+gboolean
+update_device_info (DevInfo *devinfo)
+{
+    return update_devices_info (&devinfo, 1);
+}
+
 #ifdef HAVE_IW
 void
 get_wireless_info (DevInfo *devinfo)
@@ -432,10 +654,11 @@ get_wireless_info (DevInfo *devinfo)
 
     if (info.b.has_essid) {
         if ((!devinfo->essid) || (strcmp (devinfo->essid, info.b.essid) != 0)) {
+            g_free (devinfo->essid);
             devinfo->essid = g_strdup (info.b.essid);
         }
     } else {
-        devinfo->essid = NULL;
+        g_clear_pointer (&devinfo->essid, g_free);
     }
 
     if (iw_get_stats (fd, devinfo->name, &info.stats, &info.range, info.has_range) >= 0)
@@ -466,6 +689,13 @@ out:
 #ifdef HAVE_NL
 int iw_debug = 0;
 
+/* One socket for the dumps and one for the events, both kept open for
+ * the lifetime of the applet */
+static struct nl80211_state nl80211 = {.sock = NULL, .nl80211_id = -1};
+static struct nl_sock *nl80211_events = NULL;
+static guint nl80211_generation = 0;
+static gboolean nl80211_initialized = FALSE;
+
 static int
 nl80211_init (struct nl80211_state *state)
 {
@@ -501,13 +731,157 @@ nl80211_init (struct nl80211_state *state)
 
 out_handle_destroy:
     nl_socket_free (state->sock);
+    state->sock = NULL;
     return err;
 }
 
+static int
+nl80211_event_cb (struct nl_msg *msg,
+                  void          *arg)
+{
+    nl80211_generation++;
+
+    return NL_SKIP;
+}
+
+static gboolean
+nl80211_event_io_cb (gint         fd,
+                     GIOCondition condition,
+                     gpointer     user_data)
+{
+    gchar byte;
+    gssize len;
+    int ret;
+
+    if (condition & (G_IO_HUP | G_IO_NVAL))
+        goto close;
+
+    /* Drains what is queued. An overrun of the socket, in which some
+     * events were lost, is reported once as ENOBUFS, and the socket goes
+     * on after it. */
+    while ((len = recv (fd, &byte, sizeof byte, MSG_PEEK | MSG_DONTWAIT)) != 0) {
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno != ENOBUFS)
+                goto close;
+
+            nl80211_generation++;
+            continue;
+        }
+
+        /* libnl reports ENOBUFS as -NLE_NOMEM, and a message it could
+         * not parse may have been an event as well */
+        ret = nl_recvmsgs_default (nl80211_events);
+        if (ret < 0 && ret != -NLE_AGAIN)
+            nl80211_generation++;
+    }
+
+    return G_SOURCE_CONTINUE;
+
+close:
+    nl_socket_free (nl80211_events);
+    nl80211_events = NULL;
+    nl80211_generation++;
+    return G_SOURCE_REMOVE;
+}
+
+/* Connection, roaming, channel switches and finished scans are announced
+ * in the mlme and scan groups */
 static void
-nl80211_cleanup (struct nl80211_state *state)
+nl80211_subscribe (void)
 {
-    nl_socket_free (state->sock);
+    static const char *groups [] = { "mlme", "scan" };
+    gboolean subscribed = FALSE;
+    guint i;
+
+    nl80211_events = nl_socket_alloc ();
+    if (!nl80211_events)
+        return;
+
+    if (genl_connect (nl80211_events))
+        goto fail;
+
+    nl_socket_disable_seq_check (nl80211_events);
+    nl_socket_modify_cb (nl80211_events, NL_CB_VALID, NL_CB_CUSTOM, nl80211_event_cb, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (groups); i++) {
+        int group = genl_ctrl_resolve_grp (nl80211.sock, "nl80211", groups [i]);
+
+        if (group >= 0 && nl_socket_add_membership (nl80211_events, group) == 0)
+            subscribed = TRUE;
+    }
+    if (!subscribed)
+        goto fail;
+
+    nl_socket_set_nonblocking (nl80211_events);
+    g_unix_fd_add (nl_socket_get_fd (nl80211_events), G_IO_IN | G_IO_ERR | G_IO_HUP,
+                   nl80211_event_io_cb, NULL);
+    return;
+
+fail:
+    g_debug ("Failed to subscribe to nl80211 events");
+    nl_socket_free (nl80211_events);
+    nl80211_events = NULL;
+}
+
+static struct nl80211_state *
+nl80211_get (void)
+{
+    if (!nl80211_initialized) {
+        nl80211_initialized = TRUE;
+        if (nl80211_init (&nl80211) == 0)
+            nl80211_subscribe ();
+    }
+
+    return nl80211.sock ? &nl80211 : NULL;
+}
+
+/* Changes with every nl80211 event, see netlink_link_generation () */
+static guint
+nl80211_event_generation (void)
+{
+    nl80211_get ();
+
+    return nl80211_generation;
+}
+
+static void
+nl80211_dump (DevInfo             *devinfo,
+              enum nl80211_commands cmd,
+              nl_recvmsg_msg_cb_t  cb)
+{
+    struct nl80211_state *state;
+    struct nl_msg *msg;
+    int ret;
+
+    state = nl80211_get ();
+    if (!state)
+        return;
+
+    msg = nlmsg_alloc ();
+    if (!msg) {
+        g_warning ("failed to allocate netlink message");
+        return;
+    }
+    genlmsg_put (msg, 0, 0, state->nl80211_id, 0, NLM_F_DUMP, cmd, 0);
+    /* Add message attribute, which interface to use */
+    if (cmd == NL80211_CMD_GET_STATION)
+        nla_put (msg, NL80211_ATTR_MAC, ETH_ALEN, devinfo->station_mac_addr);
+    nla_put_u32 (msg, NL80211_ATTR_IFINDEX, if_nametoindex (devinfo->name));
+    /* Add the callback */
+    nl_socket_modify_cb (state->sock, NL_CB_VALID, NL_CB_CUSTOM, cb, devinfo);
+    /* Send the message */
+    ret = nl_send_auto (state->sock, msg);
+    g_debug ("nl80211 command %d sent %d bytes to the kernel", cmd, ret);
+    /* Retrieve the kernel's answer */
+    ret = nl_recvmsgs_default (state->sock);
+    nlmsg_free (msg);
+    if (ret < 0) {
+        g_warning ("failed to receive netlink message");
+    }
 }
 
 static int
@@ -656,20 +1030,8 @@ station_cb (struct nl_msg *msg,
         return NL_SKIP;
     }
 
-    if (sinfo[NL80211_STA_INFO_RX_BYTES] && sinfo[NL80211_STA_INFO_RX_PACKETS]) {
-        guint32 rx_bytes = nla_get_u32 (sinfo[NL80211_STA_INFO_RX_BYTES]);
-        devinfo->rx = (guint64) rx_bytes;
-        g_debug ("RX: %" G_GUINT32_FORMAT " bytes (%" G_GUINT32_FORMAT " packets)",
-                 rx_bytes,
-                 nla_get_u32 (sinfo[NL80211_STA_INFO_RX_PACKETS]));
-    }
-    if (sinfo[NL80211_STA_INFO_TX_BYTES] && sinfo[NL80211_STA_INFO_TX_PACKETS]) {
-        guint32 tx_bytes = nla_get_u32 (sinfo[NL80211_STA_INFO_TX_BYTES]);
-        devinfo->tx = (guint64) tx_bytes;
-        g_debug ("TX: %" G_GUINT32_FORMAT " bytes (%" G_GUINT32_FORMAT " packets)",
-                 tx_bytes,
-                 nla_get_u32 (sinfo[NL80211_STA_INFO_TX_PACKETS]));
-    }
+    /* the byte counters of the station are only 32 bit wide, the
+     * interface counters are used instead */
     if (sinfo[NL80211_STA_INFO_SIGNAL]) {
         int8_t dBm = (int8_t)nla_get_u8 (sinfo[NL80211_STA_INFO_SIGNAL]);
         g_debug ("signal: %d dBm", dBm);
@@ -677,16 +1039,14 @@ station_cb (struct nl_msg *msg,
         devinfo->qual =  CLAMP (2 * ((int)dBm + 100), 1, 100);
     }
     if (sinfo[NL80211_STA_INFO_RX_BITRATE]) {
-        char buf[100];
-        parse_bitrate (sinfo[NL80211_STA_INFO_RX_BITRATE], buf, sizeof (buf));
-        g_debug ("rx bitrate: %s", buf);
-        devinfo->rx_bitrate = g_strdup (buf);
+        parse_bitrate (sinfo[NL80211_STA_INFO_RX_BITRATE],
+                       devinfo->rx_bitrate, sizeof (devinfo->rx_bitrate));
+        g_debug ("rx bitrate: %s", devinfo->rx_bitrate);
     }
     if (sinfo[NL80211_STA_INFO_TX_BITRATE]) {
-        char buf[100];
-        parse_bitrate (sinfo[NL80211_STA_INFO_TX_BITRATE], buf, sizeof (buf));
-        g_debug ("tx bitrate: %s", buf);
-        devinfo->tx_bitrate = g_strdup (buf);
+        parse_bitrate (sinfo[NL80211_STA_INFO_TX_BITRATE],
+                       devinfo->tx_bitrate, sizeof (devinfo->tx_bitrate));
+        g_debug ("tx bitrate: %s", devinfo->tx_bitrate);
     }
     if (sinfo[NL80211_STA_INFO_CONNECTED_TIME]) {
         devinfo->connected_time = nla_get_u32 (sinfo[NL80211_STA_INFO_CONNECTED_TIME]);
@@ -759,116 +1119,50 @@ iface_cb (struct nl_msg *msg,
         int len = nla_len (tb_msg[NL80211_ATTR_SSID]);
         memcpy (buf, nla_data (tb_msg[NL80211_ATTR_SSID]), len);
         buf [len] = '\0';
+        g_free (devinfo->essid);
         devinfo->essid = g_strescape (buf, NULL);
         g_debug ("ssid: %s", buf);
     }
 
     if (tb_msg[NL80211_ATTR_WIPHY_FREQ]) {
         uint32_t freq = nla_get_u32 (tb_msg[NL80211_ATTR_WIPHY_FREQ]);
-        char buf[100];
-        char *pos = buf;
+        char *buf = devinfo->channel;
+        int len;
 
-        pos += sprintf (pos, _("%d (%d MHz)"),
-                        ieee80211_frequency_to_channel (freq), freq);
+        len = g_snprintf (buf, sizeof (devinfo->channel), _("%d (%d MHz)"),
+                          ieee80211_frequency_to_channel (freq), freq);
 
-        if (tb_msg[NL80211_ATTR_CHANNEL_WIDTH])
-            sprintf (pos, _(", width: %s"),
-                     channel_width_name (nla_get_u32 (tb_msg[NL80211_ATTR_CHANNEL_WIDTH])));
-
-        devinfo->channel = g_strdup (buf);
+        if (tb_msg[NL80211_ATTR_CHANNEL_WIDTH] && len < (int) sizeof (devinfo->channel))
+            g_snprintf (buf + len, sizeof (devinfo->channel) - len, _(", width: %s"),
+                        channel_width_name (nla_get_u32 (tb_msg[NL80211_ATTR_CHANNEL_WIDTH])));
     }
 
     return NL_SKIP;
 }
 
+/* The interface and the station it is associated to, which only change
+ * together with a link or nl80211 event
+ */
 void
 get_wireless_info (DevInfo *devinfo)
 {
-    struct nl80211_state nlstate = {.sock = NULL, .nl80211_id = -1};
-    int err, ret;
-    struct nl_msg *msg;
-    signed long long devidx = 0;
-
-    err = nl80211_init (&nlstate);
-    if (err || (nlstate.nl80211_id < 0)) {
-        g_warning ("failed to init netlink");
-        return;
-    }
-
-    devidx = if_nametoindex (devinfo->name);
+    g_clear_pointer (&devinfo->essid, g_free);
+    devinfo->channel[0] = '\0';
 
     /* Get MAC, SSID & channel info from interface message */
-    msg = nlmsg_alloc ();
-    if (!msg) {
-        g_warning ("failed to allocate netlink message");
-        goto cleanup;
-    }
-    genlmsg_put (msg, 0, 0, nlstate.nl80211_id, 0, NLM_F_DUMP, NL80211_CMD_GET_INTERFACE, 0);
-    /* Add message attribute, which interface to use */
-    nla_put_u32 (msg, NL80211_ATTR_IFINDEX, devidx);
-    /* Add the callback */
-    nl_socket_modify_cb (nlstate.sock, NL_CB_VALID, NL_CB_CUSTOM, iface_cb, devinfo);
-    /* Send the message */
-    ret = nl_send_auto (nlstate.sock, msg);
-    g_debug ("NL80211_CMD_GET_INTERFACE sent %d bytes to the kernel", ret);
-    /* Retrieve the kernel's answer */
-    ret = nl_recvmsgs_default (nlstate.sock);
-    nlmsg_free (msg);
-    if (ret < 0) {
-        g_warning ("failed to receive netlink message");
-    }
-
-    if (!devinfo->running)
-        goto cleanup;
+    nl80211_dump (devinfo, NL80211_CMD_GET_INTERFACE, iface_cb);
 
     /* Get station MAC from scan message */
-    msg = nlmsg_alloc ();
-    if (!msg) {
-        g_warning ("failed to allocate netlink message");
-        goto cleanup;
-    }
-    genlmsg_put (msg, 0, 0, nlstate.nl80211_id, 0, NLM_F_DUMP, NL80211_CMD_GET_SCAN, 0);
-    /* Add message attribute, which interface to use */
-    nla_put_u32 (msg, NL80211_ATTR_IFINDEX, devidx);
-    /* Add the callback */
-    nl_socket_modify_cb (nlstate.sock, NL_CB_VALID, NL_CB_CUSTOM, scan_cb, devinfo);
-    /* Send the message */
-    ret = nl_send_auto (nlstate.sock, msg);
-    g_debug ("NL80211_CMD_GET_SCAN sent %d bytes to the kernel", ret);
-    /* Retrieve the kernel's answer */
-    ret = nl_recvmsgs_default (nlstate.sock);
-    nlmsg_free (msg);
-    if (ret < 0) {
-        g_warning ("failed to receive netlink message");
-        goto cleanup;
-    }
-
-    if (!devinfo->running)
-        goto cleanup;
+    if (devinfo->running)
+        nl80211_dump (devinfo, NL80211_CMD_GET_SCAN, scan_cb);
+}
 
+/* Signal, bitrates and connected time of the station
+ */
+void
+get_wireless_station_info (DevInfo *devinfo)
+{
     /* Get in/out bitrate/rate/total, signal quality from station message */
-    msg = nlmsg_alloc ();
-    if (!msg) {
-        g_warning ("failed to allocate netlink message");
-        goto cleanup;
-    }
-    genlmsg_put (msg, 0, 0, nlstate.nl80211_id, 0, NLM_F_DUMP, NL80211_CMD_GET_STATION, 0);
-    /* Add message attribute, which interface to use */
-    nla_put (msg, NL80211_ATTR_MAC, ETH_ALEN, devinfo->station_mac_addr);
-    nla_put_u32 (msg, NL80211_ATTR_IFINDEX, devidx);
-    /* Add the callback */
-    nl_socket_modify_cb (nlstate.sock, NL_CB_VALID, NL_CB_CUSTOM, station_cb, devinfo);
-    /* Send the message */
-    ret = nl_send_auto (nlstate.sock, msg);
-    g_debug ("NL80211_CMD_GET_STATION sent %d bytes to the kernel", ret);
-    /* Retrieve the kernel's answer */
-    ret = nl_recvmsgs_default (nlstate.sock);
-    nlmsg_free (msg);
-    if (ret < 0) {
-        g_warning ("failed to receive netlink message");
-    }
-
- cleanup:
-    nl80211_cleanup (&nlstate);
+    nl80211_dump (devinfo, NL80211_CMD_GET_STATION, station_cb);
 }
 #endif /* HAVE_NL */
@@ -40,6 +40,7 @@
 #define ETH_ALEN        6
 #define ETH_LEN         20
 #define MAX_FORMAT_SIZE 15
+#define MAX_NL_INFO_SIZE 100
 
 /* Different types of interfaces */
 typedef enum {
@@ -53,6 +54,7 @@ typedef enum {
 } DevType;
 
 /* Some information about the selected network device
+ * It is kept for as long as the device is selected and updated in place.
  */
 typedef struct {
     DevType        type;
@@ -66,17 +68,25 @@ typedef struct {
     gboolean       running;
     guint64        tx;
     guint64        rx;
+    gint64         time; /* g_get_monotonic_time () when tx and rx were read */
+    int            sysfs_fd [4]; /* without rtnetlink, -1 until opened */
     int            qual;
     char           rx_rate [MAX_FORMAT_SIZE];
     char           tx_rate [MAX_FORMAT_SIZE];
     char           sum_rate [MAX_FORMAT_SIZE];
+    gboolean       has_details;
+    guint          details_generation; /* netlink_link_generation () */
 #ifdef HAVE_NL
     int            rssi;
-    char          *tx_bitrate;
-    char          *rx_bitrate;
-    char          *channel;
+    char           tx_bitrate [MAX_NL_INFO_SIZE];
+    char           rx_bitrate [MAX_NL_INFO_SIZE];
+    char           channel [MAX_NL_INFO_SIZE];
     guint32        connected_time;
     unsigned char  station_mac_addr [ETH_ALEN];
+    guint          wireless_generation;
+    guint          station_generation;
+    gint64         station_time;
+    guint32        station_connected_time;
 #endif /* HAVE_NL */
 } DevInfo;
 
@@ -95,16 +105,29 @@ free_device_info (DevInfo *devinfo);
 void
 get_device_info (const char *device, DevInfo **info);
 
+/* Returns TRUE if the address or the state of the device changed */
 gboolean
-compare_device_info (const DevInfo *a, const DevInfo *b);
+update_device_info (DevInfo *devinfo);
+
+/* Updates all the devices from a single read of the counters, returns
+ * TRUE if the first one changed */
+gboolean
+update_devices_info (DevInfo **devinfos, guint n_devinfos);
 
 void
 get_wireless_info (DevInfo *devinfo);
 
-GSList*
+#ifdef HAVE_NL
+void
+get_wireless_station_info (DevInfo *devinfo);
+#endif /* HAVE_NL */
+
+/* The lists belong to the backend, and are valid until the addresses of
+ * any interface change */
+const GSList*
 get_ip_address_list (const char *ifa_name, gboolean ipv4);
 
-GSList*
+const GSList*
 get_ip6_address_list (const char *ifa_name);
 
 #endif /* _BACKEND_H */
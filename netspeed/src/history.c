@@ -0,0 +1,279 @@
+/*  history.c
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "history.h"
+
+#define HISTORY_MAGIC   0x4e534849 /* "NSHI" */
+#define HISTORY_VERSION 1
+
+typedef enum {
+    HISTORY_SECONDS,
+    HISTORY_MINUTES,
+    HISTORY_HOURS,
+    HISTORY_TIERS
+} HistoryTier;
+
+static const struct {
+    guint32 slots;
+    guint32 seconds; /* covered by one slot */
+} history_tiers [HISTORY_TIERS] = {
+    { 3600,      1 },
+    { 2 * 1440,  60 },
+    { 31 * 24,   3600 }
+};
+
+typedef struct {
+    guint64        rx;
+    guint64        tx;
+} HistorySlot;
+
+typedef struct {
+    guint32        magic;
+    guint32        version;
+    guint32        slots [HISTORY_TIERS];
+    guint32        reserved;
+    /* the time of the newest slot of each tier, in its own unit,
+     * 0 while the tier is empty */
+    guint64        head [HISTORY_TIERS];
+} HistoryHeader;
+
+struct _NetspeedHistory {
+    int            fd;
+    gboolean       writable;
+    gsize          size;
+    HistoryHeader *header;
+    HistorySlot   *tiers [HISTORY_TIERS];
+};
+
+static gsize
+history_file_size (void)
+{
+    gsize size = sizeof (HistoryHeader);
+    int i;
+
+    for (i = 0; i < HISTORY_TIERS; i++)
+        size += history_tiers[i].slots * sizeof (HistorySlot);
+
+    return size;
+}
+
+static gboolean
+history_header_is_valid (const HistoryHeader *header)
+{
+    int i;
+
+    if (header->magic != HISTORY_MAGIC || header->version != HISTORY_VERSION)
+        return FALSE;
+
+    for (i = 0; i < HISTORY_TIERS; i++) {
+        if (header->slots[i] != history_tiers[i].slots)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+NetspeedHistory *
+netspeed_history_open (const char *device)
+{
+    NetspeedHistory *history;
+    gchar *dir, *name, *path;
+    struct stat st;
+    gpointer mapping;
+    HistorySlot *slots;
+    int i;
+
+    history = g_new0 (NetspeedHistory, 1);
+    history->fd = -1;
+    history->size = history_file_size ();
+
+    if (!device || !*device || strchr (device, G_DIR_SEPARATOR))
+        return history;
+
+    dir = g_build_filename (g_get_user_data_dir (), "mate-netspeed", NULL);
+    name = g_strconcat (device, ".history", NULL);
+    path = g_build_filename (dir, name, NULL);
+    g_mkdir_with_parents (dir, 0700);
+
+    history->fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (history->fd < 0) {
+        g_debug ("Failed to open %s: %s", path, g_strerror (errno));
+        goto out;
+    }
+
+    /* another applet showing the same device keeps the history */
+    history->writable = flock (history->fd, LOCK_EX | LOCK_NB) == 0;
+
+    if (fstat (history->fd, &st) < 0)
+        goto fail;
+
+    if ((gsize) st.st_size != history->size) {
+        if (!history->writable)
+            goto fail;
+        /* a file of another layout starts over, zeroed */
+        if (ftruncate (history->fd, 0) < 0 ||
+            ftruncate (history->fd, (off_t) history->size) < 0)
+            goto fail;
+    }
+
+    mapping = mmap (NULL, history->size,
+                    history->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, history->fd, 0);
+    if (mapping == MAP_FAILED)
+        goto fail;
+
+    history->header = mapping;
+    if (!history_header_is_valid (history->header)) {
+        if (!history->writable) {
+            munmap (mapping, history->size);
+            history->header = NULL;
+            goto fail;
+        }
+        memset (history->header, 0, history->size);
+        history->header->magic = HISTORY_MAGIC;
+        history->header->version = HISTORY_VERSION;
+        for (i = 0; i < HISTORY_TIERS; i++)
+            history->header->slots[i] = history_tiers[i].slots;
+    }
+
+    slots = (HistorySlot *) (history->header + 1);
+    for (i = 0; i < HISTORY_TIERS; i++) {
+        history->tiers[i] = slots;
+        slots += history_tiers[i].slots;
+    }
+    goto out;
+
+fail:
+    g_debug ("Failed to map %s: %s", path, g_strerror (errno));
+    close (history->fd);
+    history->fd = -1;
+    history->writable = FALSE;
+
+out:
+    g_free (path);
+    g_free (name);
+    g_free (dir);
+
+    return history;
+}
+
+void
+netspeed_history_close (NetspeedHistory *history)
+{
+    if (!history)
+        return;
+
+    if (history->header)
+        munmap (history->header, history->size);
+
+    /* closing the file also drops the lock */
+    if (history->fd >= 0)
+        close (history->fd);
+
+    g_free (history);
+}
+
+void
+netspeed_history_add (NetspeedHistory *history,
+                      gint64           time,
+                      guint64          rx,
+                      guint64          tx)
+{
+    guint64 seconds;
+    int i;
+
+    if (!history->header || !history->writable)
+        return;
+
+    seconds = (guint64) MAX (time, 0) / G_USEC_PER_SEC;
+
+    for (i = 0; i < HISTORY_TIERS; i++) {
+        guint64 slots = history_tiers[i].slots;
+        guint64 unit = seconds / history_tiers[i].seconds;
+        guint64 head = history->header->head[i];
+        HistorySlot *slot;
+
+        if (unit > head) {
+            guint64 u;
+
+            /* clear the slots skipped while nothing was recorded */
+            for (u = MAX (head + 1, unit >= slots ? unit - slots + 1 : 0); u <= unit; u++)
+                memset (&history->tiers[i][u % slots], 0, sizeof (HistorySlot));
+            history->header->head[i] = head = unit;
+        }
+
+        /* once the clock went back, the newest slot gets the bytes */
+        slot = &history->tiers[i][head % slots];
+        slot->rx += rx;
+        slot->tx += tx;
+    }
+}
+
+gboolean
+netspeed_history_get_totals (NetspeedHistory *history,
+                             gint64           from,
+                             guint64         *rx,
+                             guint64         *tx)
+{
+    HistoryTier tier;
+    guint64 seconds, slots, first, head, u;
+
+    *rx = *tx = 0;
+
+    if (!history->header)
+        return FALSE;
+
+    seconds = (guint64) MAX (from, 0) / G_USEC_PER_SEC;
+
+    /* the finest tier that still reaches back to from */
+    for (tier = HISTORY_SECONDS; tier < HISTORY_HOURS; tier++) {
+        head = history->header->head[tier];
+        if (head >= history_tiers[tier].slots &&
+            seconds / history_tiers[tier].seconds > head - history_tiers[tier].slots)
+            break;
+    }
+
+    slots = history_tiers[tier].slots;
+    head = history->header->head[tier];
+    if (head == 0)
+        return FALSE;
+
+    first = seconds / history_tiers[tier].seconds;
+    if (head >= slots)
+        first = MAX (first, head - slots + 1);
+
+    for (u = first; u <= head; u++) {
+        *rx += history->tiers[tier][u % slots].rx;
+        *tx += history->tiers[tier][u % slots].tx;
+    }
+
+    return first <= head;
+}
@@ -0,0 +1,61 @@
+/*  history.h
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+#include <glib.h>
+
+/* Long term traffic history of a device.
+ *
+ * The bytes transferred are summed per second for the last hour, per
+ * minute for the last two days and per hour for the last 31 days, in
+ * rings that are indexed by the wall clock time. The rings live in a
+ * fixed size file under $XDG_DATA_HOME/mate-netspeed/, one per device,
+ * that is mapped into memory: opening it reads nothing, and an update
+ * only touches the slots of the current second, minute and hour.
+ *
+ * Only the first applet opening the file of a device writes to it,
+ * others map it read only.
+ */
+
+typedef struct _NetspeedHistory NetspeedHistory;
+
+/* Never returns NULL, a history whose file can not be mapped just
+ * records nothing */
+NetspeedHistory *
+netspeed_history_open (const char *device);
+
+void
+netspeed_history_close (NetspeedHistory *history);
+
+/* Adds rx and tx bytes transferred at time, g_get_real_time () */
+void
+netspeed_history_add (NetspeedHistory *history,
+                      gint64           time,
+                      guint64          rx,
+                      guint64          tx);
+
+/* Sums the bytes transferred from time from up to now.
+ * Returns FALSE if nothing was recorded in that time. */
+gboolean
+netspeed_history_get_totals (NetspeedHistory *history,
+                             gint64           from,
+                             guint64         *rx,
+                             guint64         *tx);
+
+#endif /* _HISTORY_H */
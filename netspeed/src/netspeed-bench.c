@@ -0,0 +1,84 @@
+/* Measures the graph of the netspeed details dialog offscreen.
+ *
+ * The graph is drawn by the same draw handler as in the dialog, after
+ * a sample has been added to it as on every tick of the applet. With
+ * rates that stay within a power of two only the newest point is
+ * scaled; with rates that keep growing the scale changes on almost
+ * every frame, and all points and the labels are done again.
+ *
+ * Built on request only: make -C netspeed/src netspeed-bench
+ */
+
+#include <config.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+
+#include "common/applet-bench.h"
+
+#include "netspeed.h"
+
+/* GRAPH_VALUES of netspeed.c, three minutes of samples */
+#define BENCH_HISTORY 180
+
+typedef struct
+{
+    NetspeedApplet *netspeed;
+    gboolean        rescale;
+} BenchGraph;
+
+static void
+bench_graph_sample (gint     frame,
+                    gpointer data)
+{
+    BenchGraph *bench = data;
+    double inrate;
+
+    if (bench->rescale)
+        /* the largest rate yet, until the cycle starts over */
+        inrate = ldexp (1000.0, (frame + 1) % 32);
+    else
+        /* between 20 and 60 kB/s, the scale stays at 64 KiB/s */
+        inrate = 40000.0 + 20000.0 * sin (frame / 10.0);
+
+    netspeed_applet_bench_add_sample (bench->netspeed, inrate, inrate / 3);
+}
+
+static void
+bench_graph (const gchar *label,
+             gint         width,
+             gint         height,
+             gboolean     rescale)
+{
+    GtkWidget *da;
+    BenchGraph bench;
+    gint i;
+
+    da = gtk_drawing_area_new ();
+    bench.netspeed = netspeed_applet_bench_new (GTK_DRAWING_AREA (da));
+    bench.rescale = rescale;
+
+    /* a full graph, as after the dialog was open for a while */
+    for (i = 0; i < BENCH_HISTORY; i++)
+        bench_graph_sample (i, &bench);
+
+    applet_bench_draw ("netspeed:redraw_graph", label, da, width, height,
+                       bench_graph_sample, &bench);
+}
+
+int
+main (int argc, char *argv [])
+{
+    if (!applet_bench_init (&argc, &argv, "- measure the netspeed graph offscreen", NULL))
+        return EXIT_FAILURE;
+
+    /* the size of the graph in the details dialog, and maximized on a
+     * large screen */
+    bench_graph ("400x180", 400, 180, FALSE);
+    bench_graph ("400x180 rescale", 400, 180, TRUE);
+    bench_graph ("1920x540", 1920, 540, FALSE);
+
+    return EXIT_SUCCESS;
+}
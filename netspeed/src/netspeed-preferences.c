@@ -32,9 +32,13 @@ struct _NetspeedPreferences
 
   GSettings *settings;
   GtkWidget *network_device_combo;
+  GtkWidget *refresh_time_spinbutton;
+  GtkWidget *extra_devices_entry;
+  GtkWidget *combine_devices_checkbutton;
   GtkWidget *show_all_addresses_checkbutton;
   GtkWidget *show_sum_checkbutton;
   GtkWidget *show_bits_checkbutton;
+  GtkWidget *fixed_width_checkbutton;
   GtkWidget *show_icon_checkbutton;
   GtkWidget *show_quality_icon_checkbutton;
   GtkWidget *change_icon_checkbutton;
@@ -175,9 +179,13 @@ netspeed_preferences_class_init (NetspeedPreferencesClass *klass)
   gtk_widget_class_set_template_from_resource (widget_class, NETSPEED_RESOURCE_PATH "netspeed-preferences.ui");
 
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, network_device_combo);
+  gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, refresh_time_spinbutton);
+  gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, extra_devices_entry);
+  gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, combine_devices_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, show_all_addresses_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, show_sum_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, show_bits_checkbutton);
+  gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, fixed_width_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, show_icon_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, show_quality_icon_checkbutton);
   gtk_widget_class_bind_template_child (widget_class, NetspeedPreferences, change_icon_checkbutton);
@@ -211,6 +219,46 @@ fill_device_combo (NetspeedPreferences *preferences, GSettings *settings)
   gtk_combo_box_set_active (GTK_COMBO_BOX (preferences->network_device_combo), active);
 }
 
+/* The other devices are edited as one comma separated list */
+static gboolean
+extra_devices_get_mapping (GValue   *value,
+                           GVariant *variant,
+                           gpointer  user_data)
+{
+  const gchar **devices;
+
+  devices = g_variant_get_strv (variant, NULL);
+  g_value_take_string (value, g_strjoinv (", ", (gchar **) devices));
+  g_free (devices);
+
+  return TRUE;
+}
+
+static GVariant *
+extra_devices_set_mapping (const GValue       *value,
+                           const GVariantType *expected_type,
+                           gpointer            user_data)
+{
+  GPtrArray *devices;
+  gchar **names;
+  GVariant *variant;
+  int i;
+
+  devices = g_ptr_array_new ();
+  names = g_strsplit_set (g_value_get_string (value), ", ", -1);
+  for (i = 0; names[i]; i++) {
+    if (names[i][0] != '\0')
+      g_ptr_array_add (devices, names[i]);
+  }
+
+  variant = g_variant_new_strv ((const gchar * const *) devices->pdata, devices->len);
+
+  g_ptr_array_free (devices, TRUE);
+  g_strfreev (names);
+
+  return variant;
+}
+
 GtkWidget *
 netspeed_preferences_new (NetspeedApplet *netspeed)
 {
@@ -225,6 +273,21 @@ netspeed_preferences_new (NetspeedApplet *netspeed)
 
   fill_device_combo (preferences, settings);
 
+  g_settings_bind (settings, "refresh-time",
+                   preferences->refresh_time_spinbutton, "value",
+                   G_SETTINGS_BIND_DEFAULT);
+
+  g_settings_bind_with_mapping (settings, "extra-devices",
+                                preferences->extra_devices_entry, "text",
+                                G_SETTINGS_BIND_DEFAULT,
+                                extra_devices_get_mapping,
+                                extra_devices_set_mapping,
+                                NULL, NULL);
+
+  g_settings_bind (settings, "combine-devices",
+                   preferences->combine_devices_checkbutton, "active",
+                   G_SETTINGS_BIND_DEFAULT);
+
   g_settings_bind (settings, "show-all-addresses",
                    preferences->show_all_addresses_checkbutton, "active",
                    G_SETTINGS_BIND_DEFAULT);
@@ -237,6 +300,10 @@ netspeed_preferences_new (NetspeedApplet *netspeed)
                    preferences->show_bits_checkbutton, "active",
                    G_SETTINGS_BIND_DEFAULT);
 
+  g_settings_bind (settings, "fixed-width",
+                   preferences->fixed_width_checkbutton, "active",
+                   G_SETTINGS_BIND_DEFAULT);
+
   g_settings_bind (settings, "show-icon",
                    preferences->show_icon_checkbutton, "active",
                    G_SETTINGS_BIND_DEFAULT);
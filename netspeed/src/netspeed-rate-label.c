@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2020 MATE Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtk/gtk.h>
+#include "netspeed-rate-label.h"
+
+struct _NetspeedRateLabel
+{
+  GtkWidget parent;
+
+  gchar *text;
+  gchar **samples;
+
+  /* created once the widget has a style */
+  PangoLayout *layout;
+  int text_width;
+  int fixed_width; /* -1 without samples */
+  int height;
+};
+
+G_DEFINE_TYPE (NetspeedRateLabel, netspeed_rate_label, GTK_TYPE_WIDGET)
+
+static int
+layout_width (PangoLayout *layout)
+{
+  int width;
+
+  pango_layout_get_pixel_size (layout, &width, NULL);
+
+  return width;
+}
+
+static void
+measure_fixed_width (NetspeedRateLabel *label)
+{
+  int i;
+
+  label->fixed_width = -1;
+  if (!label->samples)
+    return;
+
+  for (i = 0; label->samples[i]; i++) {
+    pango_layout_set_text (label->layout, label->samples[i], -1);
+    label->fixed_width = MAX (label->fixed_width, layout_width (label->layout));
+  }
+
+  pango_layout_set_text (label->layout, label->text, -1);
+}
+
+static void
+ensure_layout (NetspeedRateLabel *label)
+{
+  PangoAttrList *attrs;
+
+  if (label->layout)
+    return;
+
+  label->layout = gtk_widget_create_pango_layout (GTK_WIDGET (label), label->text);
+
+  /* all digits as wide as each other */
+  attrs = pango_attr_list_new ();
+  pango_attr_list_insert (attrs, pango_attr_font_features_new ("tnum"));
+  pango_layout_set_attributes (label->layout, attrs);
+  pango_attr_list_unref (attrs);
+
+  pango_layout_get_pixel_size (label->layout, &label->text_width, &label->height);
+  measure_fixed_width (label);
+}
+
+static void
+netspeed_rate_label_get_preferred_width (GtkWidget *widget,
+                                         gint      *minimum,
+                                         gint      *natural)
+{
+  NetspeedRateLabel *label = NETSPEED_RATE_LABEL (widget);
+
+  ensure_layout (label);
+  *minimum = *natural = label->fixed_width >= 0 ? label->fixed_width : label->text_width;
+}
+
+static void
+netspeed_rate_label_get_preferred_height (GtkWidget *widget,
+                                          gint      *minimum,
+                                          gint      *natural)
+{
+  NetspeedRateLabel *label = NETSPEED_RATE_LABEL (widget);
+
+  ensure_layout (label);
+  *minimum = *natural = label->height;
+}
+
+static gboolean
+netspeed_rate_label_draw (GtkWidget *widget,
+                          cairo_t   *cr)
+{
+  NetspeedRateLabel *label = NETSPEED_RATE_LABEL (widget);
+  int width, height;
+
+  ensure_layout (label);
+  pango_layout_get_pixel_size (label->layout, &width, &height);
+
+  /* centered, like the labels it replaces */
+  gtk_render_layout (gtk_widget_get_style_context (widget), cr,
+                     (gtk_widget_get_allocated_width (widget) - width) / 2,
+                     (gtk_widget_get_allocated_height (widget) - height) / 2,
+                     label->layout);
+
+  return FALSE;
+}
+
+static void
+netspeed_rate_label_style_updated (GtkWidget *widget)
+{
+  NetspeedRateLabel *label = NETSPEED_RATE_LABEL (widget);
+
+  GTK_WIDGET_CLASS (netspeed_rate_label_parent_class)->style_updated (widget);
+
+  /* the font may have changed */
+  g_clear_object (&label->layout);
+  gtk_widget_queue_resize (widget);
+}
+
+static void
+netspeed_rate_label_finalize (GObject *object)
+{
+  NetspeedRateLabel *label = NETSPEED_RATE_LABEL (object);
+
+  g_clear_object (&label->layout);
+  g_free (label->text);
+  g_strfreev (label->samples);
+
+  G_OBJECT_CLASS (netspeed_rate_label_parent_class)->finalize (object);
+}
+
+static void
+netspeed_rate_label_init (NetspeedRateLabel *label)
+{
+  gtk_widget_set_has_window (GTK_WIDGET (label), FALSE);
+
+  label->text = g_strdup ("");
+  label->fixed_width = -1;
+}
+
+static void
+netspeed_rate_label_class_init (NetspeedRateLabelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->finalize = netspeed_rate_label_finalize;
+
+  widget_class->get_preferred_width = netspeed_rate_label_get_preferred_width;
+  widget_class->get_preferred_height = netspeed_rate_label_get_preferred_height;
+  widget_class->draw = netspeed_rate_label_draw;
+  widget_class->style_updated = netspeed_rate_label_style_updated;
+
+  /* styled by the panel themes as any other label */
+  gtk_widget_class_set_css_name (widget_class, "label");
+}
+
+GtkWidget *
+netspeed_rate_label_new (void)
+{
+  return g_object_new (NETSPEED_TYPE_RATE_LABEL, NULL);
+}
+
+void
+netspeed_rate_label_set_text (NetspeedRateLabel *label,
+                              const gchar       *text)
+{
+  int width;
+
+  if (g_strcmp0 (label->text, text) == 0)
+    return;
+
+  g_free (label->text);
+  label->text = g_strdup (text);
+
+  if (!label->layout)
+    return;
+
+  pango_layout_set_text (label->layout, label->text, -1);
+  width = layout_width (label->layout);
+
+  if (label->fixed_width < 0 && width != label->text_width) {
+    label->text_width = width;
+    gtk_widget_queue_resize (GTK_WIDGET (label));
+  } else {
+    label->text_width = width;
+    gtk_widget_queue_draw (GTK_WIDGET (label));
+  }
+}
+
+void
+netspeed_rate_label_set_fixed_width (NetspeedRateLabel  *label,
+                                     const gchar *const *samples)
+{
+  g_strfreev (label->samples);
+  label->samples = g_strdupv ((gchar **) samples);
+
+  if (label->layout)
+    measure_fixed_width (label);
+
+  gtk_widget_queue_resize (GTK_WIDGET (label));
+}
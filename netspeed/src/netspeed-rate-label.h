@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 MATE Development Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETSPEED_RATE_LABEL_H
+#define NETSPEED_RATE_LABEL_H
+
+#include <gtk/gtk.h>
+
+/* A label for the rates on the panel. Digits are drawn with tabular
+ * widths, and a new text that is as wide as the previous one only
+ * queues a redraw. With a fixed width, the width is that of the widest
+ * of the sample texts and the label never asks for a new size, so the
+ * panel is not laid out again at every tick. */
+
+#define NETSPEED_TYPE_RATE_LABEL netspeed_rate_label_get_type ()
+G_DECLARE_FINAL_TYPE (NetspeedRateLabel, netspeed_rate_label,
+                      NETSPEED, RATE_LABEL, GtkWidget)
+
+GtkWidget *netspeed_rate_label_new (void);
+void netspeed_rate_label_set_text (NetspeedRateLabel *label, const gchar *text);
+
+/* samples is NULL terminated, NULL lets the width follow the text */
+void netspeed_rate_label_set_fixed_width (NetspeedRateLabel  *label,
+                                          const gchar *const *samples);
+
+#endif
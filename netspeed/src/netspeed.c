@@ -32,7 +32,15 @@
 #include <gio/gio.h>
 
 #include "backend.h"
+#include "history.h"
+#include "talkers.h"
+#include "common/applet-probe.h"
+#include "common/applet-startup.h"
+#include "common/sampler-metrics.h"
+#include "common/sampler-rate.h"
+#include "common/sampler-tick.h"
 #include "netspeed-preferences.h"
+#include "netspeed-rate-label.h"
 
 #include "netspeed.h"
 
@@ -70,10 +78,23 @@ static const char LOGO_ICON[] = "mate-netspeed-applet";
  * "jumping around like crazy"
  */
 #define OLD_VALUES          5
-#define OLD_VALUES_DBL      5.0
 #define GRAPH_VALUES      180
 #define GRAPH_LINES         4
-#define REFRESH_TIME     1000
+#define REFRESH_TIME_MIN  100
+#define REFRESH_TIME_MAX 10000
+
+#define TOP_TALKERS          5
+
+/* Another device, whose rates are added to those of the selected device or
+ * shown on their own label
+ */
+typedef struct
+{
+    DevInfo         *devinfo;
+    RateEstimator   *in_rate;
+    RateEstimator   *out_rate;
+    GtkWidget       *label;
+} NetspeedExtraDevice;
 
 /* A struct containing all the "global" data of the
  * applet
@@ -96,15 +117,21 @@ struct _NetspeedApplet
     GtkWidget       *dev_pix;
     GtkWidget       *qual_pix;
     cairo_surface_t *qual_surfaces[4];
+    gboolean         qual_surfaces_loaded; /* by the first wireless device */
     gboolean         labels_dont_shrink;
     DevInfo         *devinfo;
     gboolean         device_has_changed;
+    GPtrArray       *extra_devices;
+    GPtrArray       *devinfos; /* devinfo, then those of the extra devices */
+    gboolean         combine_devices;
     guint            timeout_id;
+    guint            refresh_time;
     char            *up_cmd;
     char            *down_cmd;
     gboolean         show_all_addresses;
     gboolean         show_sum;
     gboolean         show_bits;
+    gboolean         fixed_width;
     gboolean         change_icon;
     gboolean         auto_change_device;
     gboolean         show_icon;
@@ -122,6 +149,11 @@ struct _NetspeedApplet
     GtkWidget       *hwaddr_text;
     GtkWidget       *inbytes_text;
     GtkWidget       *outbytes_text;
+    GtkWidget       *today_text;
+    GtkWidget       *month_text;
+    GtkWidget       *talkers_expander;
+    GtkWidget       *talkers_text;
+    NetspeedTalkers *talkers;
     GtkWidget       *essid_text;
     GtkWidget       *signalbar;
 #ifdef HAVE_NL
@@ -135,15 +167,35 @@ struct _NetspeedApplet
     /* settings dialog */
     GtkWidget       *preferences;
 
-    guint            index_old;
-    guint64          in_old [OLD_VALUES];
-    guint64          out_old [OLD_VALUES];
+    RateEstimator   *in_rate;
+    RateEstimator   *out_rate;
+    NetspeedHistory *history;
+    SamplerMetrics  *metrics;  /* of the metrics-socket and metrics-textfile keys */
+    char            *history_device;
+    gboolean         history_primed;
+    guint64          history_rx;
+    guint64          history_tx;
     double           max_graph;
     double           in_graph [GRAPH_VALUES];
     double           out_graph [GRAPH_VALUES];
     int              index_graph;
+    /* what redraw_graph keeps while the details dialog is open */
+    cairo_surface_t *graph_frame;
+    int              graph_width;
+    int              graph_height;
+    int              graph_x [GRAPH_VALUES];
+    int              graph_in_y [GRAPH_VALUES];
+    int              graph_out_y [GRAPH_VALUES];
+    double           graph_points_max;
+    PangoLayout     *graph_max_layout;
+    PangoLayout     *graph_zero_layout;
+    int              graph_zero_height;
+    double           graph_layout_max;
+    gboolean         graph_layout_bits;
     GtkWidget       *connect_dialog;
     gboolean         show_tooltip;
+    GString         *tooltip;      /* the text set on the applet */
+    GString         *tooltip_next;
     GtkIconTheme    *icon_theme;
     GSettings       *settings;
 };
@@ -165,16 +217,15 @@ netspeed_applet_get_current_device_name (NetspeedApplet *netspeed)
     return netspeed->devinfo->name;
 }
 
-/* Adds a Pango markup "foreground" to a bytestring
+/* Sets the text of a label, unless it already shows it; GTK would
+ * relayout the label anyway
  */
 static void
-add_markup_fgcolor (char       **string,
-                    const char  *color)
+set_label_text (GtkWidget  *label,
+                const char *text)
 {
-    char *tmp = *string;
-
-    *string = g_strdup_printf ("<span foreground=\"%s\">%s</span>", color, tmp);
-    g_free (tmp);
+    if (strcmp (gtk_label_get_label (GTK_LABEL (label)), text) != 0)
+        gtk_label_set_text (GTK_LABEL (label), text);
 }
 
 /* Change the icons according to the selected device
@@ -281,6 +332,7 @@ applet_change_size_or_orient (MatePanelApplet *applet,
                               NetspeedApplet  *netspeed)
 {
     int size;
+    guint i;
     MatePanelAppletOrient orient;
 
     g_assert (netspeed);
@@ -309,6 +361,13 @@ applet_change_size_or_orient (MatePanelApplet *applet,
         gtk_container_remove (GTK_CONTAINER (netspeed->sum_box), netspeed->sum_label);
         gtk_widget_destroy (netspeed->sum_box);
     }
+    for (i = 0; i < netspeed->extra_devices->len; i++) {
+        NetspeedExtraDevice *extra = g_ptr_array_index (netspeed->extra_devices, i);
+        GtkWidget *parent = gtk_widget_get_parent (extra->label);
+
+        if (parent)
+            gtk_container_remove (GTK_CONTAINER (parent), extra->label);
+    }
     if (netspeed->box) {
         gtk_container_remove (GTK_CONTAINER (netspeed->box), netspeed->pix_box);
         gtk_widget_destroy (netspeed->box);
@@ -361,6 +420,13 @@ applet_change_size_or_orient (MatePanelApplet *applet,
         gtk_box_pack_start (GTK_BOX (netspeed->speed_box), netspeed->in_box, TRUE, TRUE, 0);
         gtk_box_pack_start (GTK_BOX (netspeed->speed_box), netspeed->out_box, TRUE, TRUE, 0);
     }
+    if (!netspeed->combine_devices) {
+        for (i = 0; i < netspeed->extra_devices->len; i++) {
+            NetspeedExtraDevice *extra = g_ptr_array_index (netspeed->extra_devices, i);
+
+            gtk_box_pack_start (GTK_BOX (netspeed->speed_box), extra->label, TRUE, TRUE, 0);
+        }
+    }
     gtk_box_pack_start (GTK_BOX (netspeed->box), netspeed->speed_box, TRUE, TRUE, 0);
 
     gtk_widget_show_all (netspeed->box);
@@ -385,6 +451,8 @@ change_quality_icon (NetspeedApplet *netspeed)
     }
 }
 
+static void init_quality_surfaces (NetspeedApplet *netspeed);
+
 static void
 update_quality_icon (NetspeedApplet *netspeed)
 {
@@ -392,6 +460,10 @@ update_quality_icon (NetspeedApplet *netspeed)
         return;
     }
 
+    /* wired devices never need the icons */
+    if (!netspeed->qual_surfaces_loaded)
+        init_quality_surfaces (netspeed);
+
     unsigned int q;
 
     q = (netspeed->devinfo->qual);
@@ -410,6 +482,7 @@ init_quality_surfaces (NetspeedApplet *netspeed)
     /* FIXME: Add larger icon files. */
     gint icon_size = 24;
 
+    netspeed->qual_surfaces_loaded = TRUE;
     icon_scale = gtk_widget_get_scale_factor (GTK_WIDGET (netspeed));
 
     for (i = 0; i < 4; i++) {
@@ -443,7 +516,8 @@ static void
 icon_theme_changed_cb (GtkIconTheme   *icon_theme,
                        NetspeedApplet *netspeed)
 {
-    init_quality_surfaces (netspeed);
+    if (netspeed->qual_surfaces_loaded)
+        init_quality_surfaces (netspeed);
     if (netspeed->devinfo->type == DEV_WIRELESS && netspeed->devinfo->up)
         update_quality_icon (netspeed);
     change_icons (netspeed);
@@ -484,59 +558,77 @@ format_transfer_rate (gchar   *out,
     g_snprintf (out, MAX_FORMAT_SIZE, format, bytes, gettext (unit));
 }
 
-/* Converts a number of bytes into a human
- * readable string - in [M/k]bytes[/s]
- * The string has to be freed
+/* Gives the rate labels the width of the widest rate, or lets them follow
+ * their text
  */
-static char*
-bps_to_string (double   bytes,
-               gboolean bits)
+static void
+update_rate_label_widths (NetspeedApplet *netspeed)
 {
-    char res[MAX_FORMAT_SIZE];
-    format_transfer_rate (res, bytes, bits);
-    return g_strdup (res);
+    /* the most digits of each unit, the digits all being as wide */
+    static const double widest [] = {
+        1023.0,
+        99.9 * IEC_KIBI_DBL,
+        1023.0 * IEC_KIBI_DBL,
+        1023.9 * IEC_MEBI_DBL,
+        9999.9 * IEC_GIBI_DBL
+    };
+    char texts [G_N_ELEMENTS (widest)][MAX_FORMAT_SIZE];
+    const char *samples [G_N_ELEMENTS (widest) + 1];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (widest); i++) {
+        format_transfer_rate (texts[i], netspeed->show_bits ? widest[i] / 8.0 : widest[i],
+                              netspeed->show_bits);
+        samples[i] = texts[i];
+    }
+    samples[i] = NULL;
+
+    netspeed_rate_label_set_fixed_width (NETSPEED_RATE_LABEL (netspeed->in_label),
+                                         netspeed->fixed_width ? samples : NULL);
+    netspeed_rate_label_set_fixed_width (NETSPEED_RATE_LABEL (netspeed->out_label),
+                                         netspeed->fixed_width ? samples : NULL);
+    netspeed_rate_label_set_fixed_width (NETSPEED_RATE_LABEL (netspeed->sum_label),
+                                         netspeed->fixed_width ? samples : NULL);
 }
 
-/* Redraws the graph drawingarea
- * Some really black magic is going on in here ;-)
+/* Computes where the sample at index lies in the graph. The points are
+ * only valid for the size and scale they were computed with, and are all
+ * recomputed when either changes
  */
 static void
-redraw_graph (NetspeedApplet *netspeed,
-              cairo_t        *cr)
+graph_point_update (NetspeedApplet *netspeed,
+                    int             index)
 {
-    GtkWidget *da = GTK_WIDGET (netspeed->drawingarea);
-    GtkStyleContext *stylecontext = gtk_widget_get_style_context (da);
-    GdkWindow *real_window = gtk_widget_get_window (da);
-    GdkPoint in_points[GRAPH_VALUES], out_points[GRAPH_VALUES];
-    PangoLayout *layout;
-    PangoRectangle logical_rect;
-    char *text;
-    int i, offset, w, h;
-    double max_val;
-    double dash[2] = { 1.0, 2.0 };
+    int h = netspeed->graph_height;
 
-    w = gdk_window_get_width (real_window);
-    h = gdk_window_get_height (real_window);
+    if (h == 0)
+        return;
 
-    /* the graph hight should be: hight/2 <= netspeed->max_graph < hight */
-    for (max_val = 1; max_val < netspeed->max_graph; max_val *= 2) ;
+    netspeed->graph_in_y[index] = h - 6 - (int)((h - 8) * netspeed->in_graph[index] / netspeed->graph_points_max);
+    netspeed->graph_out_y[index] = h - 6 - (int)((h - 8) * netspeed->out_graph[index] / netspeed->graph_points_max);
+}
 
-    /* calculate the polygons (GdkPoint[]) for the graphs */
-    offset = 0;
-    for (i = (netspeed->index_graph + 1) % GRAPH_VALUES; netspeed->in_graph[i] < 0; i = (i + 1) % GRAPH_VALUES)
-        offset++;
-    for (i = offset + 1; i < GRAPH_VALUES; i++)
-    {
-        int index = (netspeed->index_graph + i) % GRAPH_VALUES;
-        out_points[i].x = in_points[i].x = ((w - 6) * i) / GRAPH_VALUES + 4;
-        in_points[i].y = h - 6 - (int)((h - 8) * netspeed->in_graph[index] / max_val);
-        out_points[i].y = h - 6 - (int)((h - 8) * netspeed->out_graph[index] / max_val);
-    }
-    in_points[offset].x = out_points[offset].x = ((w - 6) * offset) / GRAPH_VALUES + 4;
-    in_points[offset].y = in_points[(offset + 1) % GRAPH_VALUES].y;
-    out_points[offset].y = out_points[(offset + 1) % GRAPH_VALUES].y;
+/* Draws what only changes with the size: the background, the frame
+ * and the grid
+ */
+static void
+graph_frame_update (NetspeedApplet *netspeed,
+                    GdkWindow      *window,
+                    int             w,
+                    int             h)
+{
+    cairo_t *cr;
+    double dash[2] = { 1.0, 2.0 };
+    int i;
+
+    if (netspeed->graph_frame)
+        cairo_surface_destroy (netspeed->graph_frame);
+    netspeed->graph_frame = gdk_window_create_similar_surface (window, CAIRO_CONTENT_COLOR_ALPHA, w, h);
+    netspeed->graph_width = w;
+    netspeed->graph_height = h;
+
+    cr = cairo_create (netspeed->graph_frame);
 
-    /* draw the background */
     cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
     cairo_rectangle (cr, 02, 2, w - 6, h - 6);
     cairo_fill (cr);
@@ -555,39 +647,164 @@ redraw_graph (NetspeedApplet *netspeed,
     }
     cairo_stroke (cr);
 
+    cairo_destroy (cr);
+
+    for (i = 0; i < GRAPH_VALUES; i++)
+        netspeed->graph_x[i] = ((w - 6) * i) / GRAPH_VALUES + 4;
+}
+
+static PangoLayout *
+graph_layout_new (GtkWidget *da,
+                  double     bytes,
+                  gboolean   bits)
+{
+    PangoLayout *layout;
+    char rate [MAX_FORMAT_SIZE];
+    char markup [MAX_FORMAT_SIZE + 40];
+
+    format_transfer_rate (rate, bytes, bits);
+    g_snprintf (markup, sizeof markup, "<span foreground=\"black\">%s</span>", rate);
+    layout = gtk_widget_create_pango_layout (da, NULL);
+    pango_layout_set_markup (layout, markup, -1);
+
+    return layout;
+}
+
+static void
+graph_layouts_update (NetspeedApplet *netspeed,
+                      double          max_val)
+{
+    GtkWidget *da = GTK_WIDGET (netspeed->drawingarea);
+    PangoRectangle logical_rect;
+
+    if (netspeed->graph_max_layout &&
+        netspeed->graph_layout_max == max_val &&
+        netspeed->graph_layout_bits == netspeed->show_bits)
+        return;
+
+    if (!netspeed->graph_zero_layout || netspeed->graph_layout_bits != netspeed->show_bits) {
+        g_clear_object (&netspeed->graph_zero_layout);
+        netspeed->graph_zero_layout = graph_layout_new (da, 0.0, netspeed->show_bits);
+        pango_layout_get_pixel_extents (netspeed->graph_zero_layout, NULL, &logical_rect);
+        netspeed->graph_zero_height = logical_rect.height;
+    }
+
+    g_clear_object (&netspeed->graph_max_layout);
+    netspeed->graph_max_layout = graph_layout_new (da, max_val, netspeed->show_bits);
+    netspeed->graph_layout_max = max_val;
+    netspeed->graph_layout_bits = netspeed->show_bits;
+}
+
+/* Drops what redraw_graph keeps, once the details dialog is gone
+ */
+static void
+graph_cache_free (NetspeedApplet *netspeed)
+{
+    g_clear_pointer (&netspeed->graph_frame, cairo_surface_destroy);
+    g_clear_object (&netspeed->graph_max_layout);
+    g_clear_object (&netspeed->graph_zero_layout);
+    netspeed->graph_width = netspeed->graph_height = 0;
+}
+
+/* Adds the rates of a tick to the graph of the details dialog
+ */
+static void
+graph_add_sample (NetspeedApplet *netspeed,
+                  double          inrate,
+                  double          outrate)
+{
+    int i;
+
+    netspeed->in_graph[netspeed->index_graph] = inrate;
+    netspeed->out_graph[netspeed->index_graph] = outrate;
+    netspeed->max_graph = MAX (inrate, netspeed->max_graph);
+    netspeed->max_graph = MAX (outrate, netspeed->max_graph);
+
+    /* Redraw the graph of the Infodialog */
+    if (netspeed->drawingarea) {
+        graph_point_update (netspeed, netspeed->index_graph);
+        gtk_widget_queue_draw (GTK_WIDGET (netspeed->drawingarea));
+    }
+
+    /* Move the graphindex. Check if we can scale down again */
+    netspeed->index_graph = (netspeed->index_graph + 1) % GRAPH_VALUES;
+    if (netspeed->index_graph % 20 == 0) {
+        double max = 0;
+
+        for (i = 0; i < GRAPH_VALUES; i++) {
+            max = MAX (max, netspeed->in_graph[i]);
+            max = MAX (max, netspeed->out_graph[i]);
+        }
+        netspeed->max_graph = max;
+    }
+}
+
+/* Redraws the graph drawingarea
+ * Some really black magic is going on in here ;-)
+ */
+static void
+redraw_graph (NetspeedApplet *netspeed,
+              cairo_t        *cr)
+{
+    GtkWidget *da = GTK_WIDGET (netspeed->drawingarea);
+    GtkStyleContext *stylecontext = gtk_widget_get_style_context (da);
+    GdkWindow *real_window = gtk_widget_get_window (da);
+    int i, offset, w, h;
+    double max_val;
+
+    w = gdk_window_get_width (real_window);
+    h = gdk_window_get_height (real_window);
+
+    /* the graph hight should be: hight/2 <= netspeed->max_graph < hight */
+    for (max_val = 1; max_val < netspeed->max_graph; max_val *= 2) ;
+
+    if (!netspeed->graph_frame || w != netspeed->graph_width || h != netspeed->graph_height) {
+        graph_frame_update (netspeed, real_window, w, h);
+        netspeed->graph_points_max = 0;
+    }
+
+    /* update_applet adds the points of the new samples, all of them only
+     * have to be computed again when the scale changes */
+    if (max_val != netspeed->graph_points_max) {
+        netspeed->graph_points_max = max_val;
+        for (i = 0; i < GRAPH_VALUES; i++)
+            graph_point_update (netspeed, i);
+    }
+
+    offset = 0;
+    for (i = (netspeed->index_graph + 1) % GRAPH_VALUES; netspeed->in_graph[i] < 0; i = (i + 1) % GRAPH_VALUES)
+        offset++;
+
+    /* draw the background */
+    cairo_set_source_surface (cr, netspeed->graph_frame, 0, 0);
+    cairo_paint (cr);
+
     /* draw the polygons */
-    cairo_set_dash (cr, dash, 0, 1);
+    cairo_set_line_width (cr, 1.0);
     cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
     cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
 
+    /* the first point is level with the second one */
     gdk_cairo_set_source_rgba (cr, &netspeed->in_color);
-    for (i = offset; i < GRAPH_VALUES; i++) {
-        cairo_line_to (cr, in_points[i].x, in_points[i].y);
-    }
+    cairo_move_to (cr, netspeed->graph_x[offset],
+                   netspeed->graph_in_y[(netspeed->index_graph + offset + 1) % GRAPH_VALUES]);
+    for (i = offset + 1; i < GRAPH_VALUES; i++)
+        cairo_line_to (cr, netspeed->graph_x[i],
+                       netspeed->graph_in_y[(netspeed->index_graph + i) % GRAPH_VALUES]);
     cairo_stroke (cr);
 
     gdk_cairo_set_source_rgba (cr, &netspeed->out_color);
-    for (i = offset; i < GRAPH_VALUES; i++) {
-        cairo_line_to (cr, out_points[i].x, out_points[i].y);
-    }
+    cairo_move_to (cr, netspeed->graph_x[offset],
+                   netspeed->graph_out_y[(netspeed->index_graph + offset + 1) % GRAPH_VALUES]);
+    for (i = offset + 1; i < GRAPH_VALUES; i++)
+        cairo_line_to (cr, netspeed->graph_x[i],
+                       netspeed->graph_out_y[(netspeed->index_graph + i) % GRAPH_VALUES]);
     cairo_stroke (cr);
 
-    text = bps_to_string (max_val, netspeed->show_bits);
-    add_markup_fgcolor (&text, "black");
-    layout = gtk_widget_create_pango_layout (da, NULL);
-    pango_layout_set_markup (layout, text, -1);
-    g_free (text);
-    gtk_render_layout (stylecontext, cr, 3, 2, layout);
-    g_object_unref (G_OBJECT (layout));
-
-    text = bps_to_string (0.0, netspeed->show_bits);
-    add_markup_fgcolor (&text, "black");
-    layout = gtk_widget_create_pango_layout (da, NULL);
-    pango_layout_set_markup (layout, text, -1);
-    pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
-    g_free (text);
-    gtk_render_layout (stylecontext, cr, 3, h - 4 - logical_rect.height, layout);
-    g_object_unref (G_OBJECT (layout));
+    graph_layouts_update (netspeed, max_val);
+    gtk_render_layout (stylecontext, cr, 3, 2, netspeed->graph_max_layout);
+    gtk_render_layout (stylecontext, cr, 3, h - 4 - netspeed->graph_zero_height,
+                       netspeed->graph_zero_layout);
 }
 
 static gboolean
@@ -725,9 +942,9 @@ fill_details_dialog (NetspeedApplet *netspeed)
     gtk_label_set_text (GTK_LABEL (netspeed->ptpip_text), text);
 
     /* check if we got an ipv6 address */
-    GSList *ipv6_address_list = get_ip_address_list (netspeed->devinfo->name, FALSE);
+    const GSList *ipv6_address_list = get_ip_address_list (netspeed->devinfo->name, FALSE);
     if (ipv6_address_list != NULL) {
-        GSList *iterator;
+        const GSList *iterator;
         GString *string = NULL;
 
         for (iterator = ipv6_address_list; iterator; iterator = iterator->next) {
@@ -741,7 +958,6 @@ fill_details_dialog (NetspeedApplet *netspeed)
             gtk_widget_show (netspeed->ipv6_box);
         }
         g_string_free (string, TRUE);
-        g_slist_free_full (ipv6_address_list, g_free);
     } else {
         gtk_widget_hide (netspeed->ipv6_box);
     }
@@ -773,7 +989,7 @@ fill_details_dialog (NetspeedApplet *netspeed)
         }
 
         gtk_label_set_text (GTK_LABEL (netspeed->channel_text),
-                            netspeed->devinfo->channel ? netspeed->devinfo->channel : _("unknown"));
+                            netspeed->devinfo->channel[0] ? netspeed->devinfo->channel : _("unknown"));
 
         text = format_time (netspeed->devinfo->connected_time);
         gtk_label_set_text (GTK_LABEL (netspeed->connected_time_text),
@@ -790,34 +1006,260 @@ fill_details_dialog (NetspeedApplet *netspeed)
     }
 }
 
+static void
+netspeed_extra_device_free (NetspeedExtraDevice *extra)
+{
+    free_device_info (extra->devinfo);
+    rate_estimator_free (extra->in_rate);
+    rate_estimator_free (extra->out_rate);
+    g_object_unref (extra->label);
+    g_free (extra);
+}
+
+/* (Re)creates the extra devices from the settings
+ */
+static void
+load_extra_devices (NetspeedApplet *netspeed)
+{
+    gchar **devices;
+    guint i;
+
+    g_ptr_array_set_size (netspeed->extra_devices, 0);
+    g_ptr_array_set_size (netspeed->devinfos, 1);
+
+    devices = g_settings_get_strv (netspeed->settings, "extra-devices");
+    for (i = 0; devices [i] != NULL; i++) {
+        NetspeedExtraDevice *extra;
+
+        if (*devices [i] == '\0')
+            continue;
+
+        extra = g_new0 (NetspeedExtraDevice, 1);
+        get_device_info (devices [i], &extra->devinfo);
+        extra->in_rate = rate_estimator_new (OLD_VALUES, 0);
+        extra->out_rate = rate_estimator_new (OLD_VALUES, 0);
+        extra->label = g_object_ref_sink (gtk_label_new (""));
+        gtk_widget_show (extra->label);
+
+        g_ptr_array_add (netspeed->extra_devices, extra);
+        g_ptr_array_add (netspeed->devinfos, extra->devinfo);
+    }
+    g_strfreev (devices);
+}
+
+/* Feeds the counters read in this tick to the rate estimators of the
+ * extra devices */
+static void
+update_extra_devices (NetspeedApplet *netspeed)
+{
+    guint i;
+
+    for (i = 0; i < netspeed->extra_devices->len; i++) {
+        NetspeedExtraDevice *extra = g_ptr_array_index (netspeed->extra_devices, i);
+        DevInfo *devinfo = extra->devinfo;
+
+        if (!devinfo->running) {
+            rate_estimator_reset (extra->in_rate);
+            rate_estimator_reset (extra->out_rate);
+            devinfo->rx_rate[0] = devinfo->tx_rate[0] = devinfo->sum_rate[0] = '\0';
+            continue;
+        }
+
+        rate_estimator_add (extra->in_rate, devinfo->rx, devinfo->time);
+        rate_estimator_add (extra->out_rate, devinfo->tx, devinfo->time);
+
+        format_transfer_rate (devinfo->rx_rate, rate_estimator_get (extra->in_rate), netspeed->show_bits);
+        format_transfer_rate (devinfo->tx_rate, rate_estimator_get (extra->out_rate), netspeed->show_bits);
+        format_transfer_rate (devinfo->sum_rate,
+                              rate_estimator_get (extra->in_rate) + rate_estimator_get (extra->out_rate),
+                              netspeed->show_bits);
+
+        if (!netspeed->combine_devices) {
+            char text [IFNAMSIZ + 3 * MAX_FORMAT_SIZE + 16];
+
+            if (netspeed->show_sum)
+                g_snprintf (text, sizeof text, _("%s: %s"), devinfo->name, devinfo->sum_rate);
+            else
+                g_snprintf (text, sizeof text, _("%s: %s in, %s out"),
+                            devinfo->name, devinfo->rx_rate, devinfo->tx_rate);
+            set_label_text (extra->label, text);
+        }
+    }
+}
+
+static void
+add_extra_device_rates (NetspeedApplet *netspeed,
+                        double         *inrate,
+                        double         *outrate)
+{
+    guint i;
+
+    for (i = 0; i < netspeed->extra_devices->len; i++) {
+        NetspeedExtraDevice *extra = g_ptr_array_index (netspeed->extra_devices, i);
+
+        if (!extra->devinfo->running)
+            continue;
+
+        *inrate += rate_estimator_get (extra->in_rate);
+        *outrate += rate_estimator_get (extra->out_rate);
+    }
+}
+
+/* Adds the bytes transferred since the last tick to the long term history
+ * of the device
+ */
+static void
+update_history (NetspeedApplet *netspeed)
+{
+    DevInfo *devinfo = netspeed->devinfo;
+
+    if (!devinfo->running) {
+        netspeed->history_primed = FALSE;
+        return;
+    }
+
+    /* the counters start over when the device is recreated */
+    if (netspeed->history_primed &&
+        devinfo->rx >= netspeed->history_rx &&
+        devinfo->tx >= netspeed->history_tx)
+        netspeed_history_add (netspeed->history, g_get_real_time (),
+                              devinfo->rx - netspeed->history_rx,
+                              devinfo->tx - netspeed->history_tx);
+
+    netspeed->history_rx = devinfo->rx;
+    netspeed->history_tx = devinfo->tx;
+    netspeed->history_primed = TRUE;
+}
+
+static void
+set_history_text (NetspeedApplet *netspeed,
+                  GtkWidget      *label,
+                  GDateTime      *from)
+{
+    guint64 rx, tx;
+    char *in, *out, *text;
+    GFormatSizeFlags flags = G_FORMAT_SIZE_IEC_UNITS;
+
+    if (!netspeed_history_get_totals (netspeed->history,
+                                      g_date_time_to_unix (from) * G_USEC_PER_SEC,
+                                      &rx, &tx)) {
+        set_label_text (label, _("none"));
+        return;
+    }
+
+    if (netspeed->show_bits) {
+        flags |= G_FORMAT_SIZE_BITS;
+        rx *= 8;
+        tx *= 8;
+    }
+
+    in = g_format_size_full (rx, flags);
+    out = g_format_size_full (tx, flags);
+    text = g_strdup_printf (_("%s in, %s out"), in, out);
+    set_label_text (label, text);
+
+    g_free (text);
+    g_free (out);
+    g_free (in);
+}
+
+/* Shows the totals of today and of this month in the details dialog
+ */
+static void
+update_history_totals (NetspeedApplet *netspeed)
+{
+    GDateTime *now, *from;
+
+    now = g_date_time_new_now_local ();
+
+    from = g_date_time_new_local (g_date_time_get_year (now),
+                                  g_date_time_get_month (now),
+                                  g_date_time_get_day_of_month (now),
+                                  0, 0, 0);
+    set_history_text (netspeed, netspeed->today_text, from);
+    g_date_time_unref (from);
+
+    from = g_date_time_new_local (g_date_time_get_year (now),
+                                  g_date_time_get_month (now),
+                                  1, 0, 0, 0);
+    set_history_text (netspeed, netspeed->month_text, from);
+    g_date_time_unref (from);
+
+    g_date_time_unref (now);
+}
+
+/* Lists the connections moving the most bytes, while the user looks at them
+ */
+static void
+update_talkers (NetspeedApplet *netspeed)
+{
+    NetspeedTalker *top [TOP_TALKERS];
+    GString *text;
+    guint i, n;
+
+    if (!netspeed->talkers_text ||
+        !gtk_expander_get_expanded (GTK_EXPANDER (netspeed->talkers_expander)))
+        return;
+
+    if (!netspeed->talkers)
+        netspeed->talkers = netspeed_talkers_new ();
+
+    if (!netspeed_talkers_update (netspeed->talkers)) {
+        set_label_text (netspeed->talkers_text, _("The connections can not be listed"));
+        return;
+    }
+
+    n = netspeed_talkers_get_top (netspeed->talkers, top, TOP_TALKERS);
+    if (n == 0) {
+        set_label_text (netspeed->talkers_text, _("No connection is transferring data"));
+        return;
+    }
+
+    text = g_string_new (NULL);
+    for (i = 0; i < n; i++) {
+        char address [INET6_ADDRSTRLEN];
+        char rx_rate [MAX_FORMAT_SIZE], tx_rate [MAX_FORMAT_SIZE];
+
+        if (!inet_ntop (top[i]->family, top[i]->remote, address, sizeof address))
+            address[0] = '\0';
+        format_transfer_rate (rx_rate, top[i]->rx_rate, netspeed->show_bits);
+        format_transfer_rate (tx_rate, top[i]->tx_rate, netspeed->show_bits);
+
+        if (i > 0)
+            g_string_append_c (text, '\n');
+        g_string_append_printf (text,
+                                top[i]->family == AF_INET6 ? _("%s [%s]:%u: %s in, %s out")
+                                                           : _("%s %s:%u: %s in, %s out"),
+                                top[i]->process ? top[i]->process : _("unknown"),
+                                address, top[i]->remote_port, rx_rate, tx_rate);
+    }
+
+    set_label_text (netspeed->talkers_text, text->str);
+    g_string_free (text, TRUE);
+}
+
 /* Here happens the really interesting stuff */
 static void
 update_applet (NetspeedApplet *netspeed)
 {
-    guint64 indiff, outdiff;
     double inrate, outrate;
     char *inbytes, *outbytes;
     int i;
-    DevInfo *oldinfo;
 
     if (!netspeed) return;
 
     /* First we try to figure out if the device has changed */
-    oldinfo = netspeed->devinfo;
-    get_device_info (oldinfo->name, &netspeed->devinfo);
-    if (compare_device_info (netspeed->devinfo, oldinfo))
+    g_ptr_array_index (netspeed->devinfos, 0) = netspeed->devinfo;
+    if (update_devices_info ((DevInfo **) netspeed->devinfos->pdata, netspeed->devinfos->len))
         netspeed->device_has_changed = TRUE;
-    free_device_info (oldinfo);
 
     /* If the device has changed, reintialize stuff */
     if (netspeed->device_has_changed) {
         change_icons (netspeed);
         change_quality_icon (netspeed);
 
-        for (i = 0; i < OLD_VALUES; i++) {
-            netspeed->in_old[i] = netspeed->devinfo->rx;
-            netspeed->out_old[i] = netspeed->devinfo->tx;
-        }
+        rate_estimator_reset (netspeed->in_rate);
+        rate_estimator_reset (netspeed->out_rate);
 
         for (i = 0; i < GRAPH_VALUES; i++) {
             netspeed->in_graph[i] = -1;
@@ -827,6 +1269,15 @@ update_applet (NetspeedApplet *netspeed)
         netspeed->max_graph = 0;
         netspeed->index_graph = 0;
 
+        /* the long term history is kept per device */
+        if (!netspeed->history || g_strcmp0 (netspeed->history_device, netspeed->devinfo->name) != 0) {
+            netspeed_history_close (netspeed->history);
+            netspeed->history = netspeed_history_open (netspeed->devinfo->name);
+            g_free (netspeed->history_device);
+            netspeed->history_device = g_strdup (netspeed->devinfo->name);
+        }
+        netspeed->history_primed = FALSE;
+
         if (netspeed->details) {
             fill_details_dialog (netspeed);
         }
@@ -834,25 +1285,22 @@ update_applet (NetspeedApplet *netspeed)
         netspeed->device_has_changed = FALSE;
     }
 
+    update_history (netspeed);
+
+    /* the extra devices were read together with the selected one */
+    update_extra_devices (netspeed);
+
     /* create the strings for the labels and tooltips */
     if (netspeed->devinfo->running) {
-        if (netspeed->devinfo->rx < netspeed->in_old[netspeed->index_old])
-            indiff = 0;
-        else
-            indiff = netspeed->devinfo->rx - netspeed->in_old[netspeed->index_old];
+        /* the time of the reading, however late this tick runs */
+        rate_estimator_add (netspeed->in_rate, netspeed->devinfo->rx, netspeed->devinfo->time);
+        rate_estimator_add (netspeed->out_rate, netspeed->devinfo->tx, netspeed->devinfo->time);
 
-        if (netspeed->devinfo->tx < netspeed->out_old[netspeed->index_old])
-            outdiff = 0;
-        else
-            outdiff = netspeed->devinfo->tx - netspeed->out_old[netspeed->index_old];
+        inrate = rate_estimator_get (netspeed->in_rate);
+        outrate = rate_estimator_get (netspeed->out_rate);
 
-        inrate = (double)indiff / OLD_VALUES_DBL;
-        outrate = (double)outdiff / OLD_VALUES_DBL;
-
-        netspeed->in_graph[netspeed->index_graph] = inrate;
-        netspeed->out_graph[netspeed->index_graph] = outrate;
-        netspeed->max_graph = MAX (inrate, netspeed->max_graph);
-        netspeed->max_graph = MAX (outrate, netspeed->max_graph);
+        if (netspeed->combine_devices)
+            add_extra_device_rates (netspeed, &inrate, &outrate);
 
         format_transfer_rate (netspeed->devinfo->rx_rate, inrate, netspeed->show_bits);
         format_transfer_rate (netspeed->devinfo->tx_rate, outrate, netspeed->show_bits);
@@ -861,8 +1309,7 @@ update_applet (NetspeedApplet *netspeed)
         netspeed->devinfo->rx_rate[0] = '\0';
         netspeed->devinfo->tx_rate[0] = '\0';
         netspeed->devinfo->sum_rate[0] = '\0';
-        netspeed->in_graph[netspeed->index_graph] = 0;
-        netspeed->out_graph[netspeed->index_graph] = 0;
+        inrate = outrate = 0;
     }
 
     if (netspeed->devinfo->type == DEV_WIRELESS) {
@@ -899,13 +1346,13 @@ update_applet (NetspeedApplet *netspeed)
 
     /* Refresh the text of the labels */
     if (netspeed->show_sum) {
-        gtk_label_set_text (GTK_LABEL (netspeed->sum_label),
-                            netspeed->devinfo->sum_rate);
+        netspeed_rate_label_set_text (NETSPEED_RATE_LABEL (netspeed->sum_label),
+                                      netspeed->devinfo->sum_rate);
     } else {
-        gtk_label_set_text (GTK_LABEL (netspeed->in_label),
-                            netspeed->devinfo->rx_rate);
-        gtk_label_set_text (GTK_LABEL (netspeed->out_label),
-                            netspeed->devinfo->tx_rate);
+        netspeed_rate_label_set_text (NETSPEED_RATE_LABEL (netspeed->in_label),
+                                      netspeed->devinfo->rx_rate);
+        netspeed_rate_label_set_text (NETSPEED_RATE_LABEL (netspeed->out_label),
+                                      netspeed->devinfo->tx_rate);
     }
 
     /* Refresh the values of the Infodialog */
@@ -917,7 +1364,7 @@ update_applet (NetspeedApplet *netspeed)
             inbytes = g_format_size_full (netspeed->devinfo->rx,
                                           G_FORMAT_SIZE_IEC_UNITS);
 
-        gtk_label_set_text (GTK_LABEL (netspeed->inbytes_text), inbytes);
+        set_label_text (netspeed->inbytes_text, inbytes);
         g_free (inbytes);
     }
     if (netspeed->outbytes_text) {
@@ -928,30 +1375,14 @@ update_applet (NetspeedApplet *netspeed)
             outbytes = g_format_size_full (netspeed->devinfo->tx,
                                            G_FORMAT_SIZE_IEC_UNITS);
 
-        gtk_label_set_text (GTK_LABEL (netspeed->outbytes_text), outbytes);
+        set_label_text (netspeed->outbytes_text, outbytes);
         g_free (outbytes);
     }
+    if (netspeed->today_text)
+        update_history_totals (netspeed);
+    update_talkers (netspeed);
 
-    /* Redraw the graph of the Infodialog */
-    if (netspeed->drawingarea)
-        gtk_widget_queue_draw (GTK_WIDGET (netspeed->drawingarea));
-
-    /* Save old values... */
-    netspeed->in_old  [netspeed->index_old] = netspeed->devinfo->rx;
-    netspeed->out_old [netspeed->index_old] = netspeed->devinfo->tx;
-    netspeed->index_old = (netspeed->index_old + 1) % OLD_VALUES;
-
-    /* Move the graphindex. Check if we can scale down again */
-    netspeed->index_graph = (netspeed->index_graph + 1) % GRAPH_VALUES;
-    if (netspeed->index_graph % 20 == 0) {
-        double max = 0;
-
-        for (i = 0; i < GRAPH_VALUES; i++) {
-            max = MAX (max, netspeed->in_graph[i]);
-            max = MAX (max, netspeed->out_graph[i]);
-        }
-        netspeed->max_graph = max;
-    }
+    graph_add_sample (netspeed, inrate, outrate);
 
     /* Always follow the default route */
     if (netspeed->auto_change_device) {
@@ -973,12 +1404,17 @@ update_applet (NetspeedApplet *netspeed)
 static gboolean
 timeout_function (NetspeedApplet *netspeed)
 {
+    static AppletProbe *probe = NULL;
+    gint64 start;
+
     if (!netspeed)
         return FALSE;
     if (!netspeed->timeout_id)
         return FALSE;
 
+    start = applet_probe_begin (&probe, "netspeed:timeout_function");
     update_applet (netspeed);
+    applet_probe_end (probe, start);
     return TRUE;
 }
 
@@ -1099,11 +1535,48 @@ da_draw (GtkWidget      *widget,
          cairo_t        *cr,
          NetspeedApplet *netspeed)
 {
+    static AppletProbe *probe = NULL;
+    gint64 start = applet_probe_begin (&probe, "netspeed:redraw_graph");
+
     redraw_graph (netspeed, cr);
 
+    applet_probe_end (probe, start);
     return FALSE;
 }
 
+/* The graph of the details dialog on da, without the dialog, for
+ * netspeed-bench. The applet is not set up for a panel and must not be
+ * finalized.
+ */
+NetspeedApplet *
+netspeed_applet_bench_new (GtkDrawingArea *da)
+{
+    NetspeedApplet *netspeed;
+    int i;
+
+    netspeed = g_object_ref_sink (g_object_new (NETSPEED_TYPE_APPLET, NULL));
+    netspeed->drawingarea = da;
+    gdk_rgba_parse (&netspeed->in_color, "#df0028004700");
+    gdk_rgba_parse (&netspeed->out_color, "#37002800df00");
+
+    for (i = 0; i < GRAPH_VALUES; i++) {
+        netspeed->in_graph[i] = -1;
+        netspeed->out_graph[i] = -1;
+    }
+
+    g_signal_connect (da, "draw", G_CALLBACK (da_draw), netspeed);
+
+    return netspeed;
+}
+
+void
+netspeed_applet_bench_add_sample (NetspeedApplet *netspeed,
+                                  double          inrate,
+                                  double          outrate)
+{
+    graph_add_sample (netspeed, inrate, outrate);
+}
+
 static void
 incolor_changed_cb (GtkColorChooser *button,
                     NetspeedApplet  *netspeed)
@@ -1134,6 +1607,24 @@ outcolor_changed_cb (GtkColorChooser *button,
     g_free (string);
 }
 
+/* The connections are only sampled while they are shown
+ */
+static void
+talkers_expanded_cb (GtkExpander    *expander,
+                     GParamSpec     *pspec,
+                     NetspeedApplet *netspeed)
+{
+    if (gtk_expander_get_expanded (expander)) {
+        /* the rates need a second sample, taken on the next update */
+        gtk_label_set_text (GTK_LABEL (netspeed->talkers_text), _("Measuring..."));
+        if (!netspeed->talkers)
+            netspeed->talkers = netspeed_talkers_new ();
+        netspeed_talkers_update (netspeed->talkers);
+    } else {
+        g_clear_pointer (&netspeed->talkers, netspeed_talkers_free);
+    }
+}
+
 /* Handle info dialog response event
  */
 static void
@@ -1148,6 +1639,8 @@ info_response_cb (GtkDialog      *dialog,
     }
 
     gtk_widget_destroy (netspeed->details);
+    graph_cache_free (netspeed);
+    g_clear_pointer (&netspeed->talkers, netspeed_talkers_free);
 
     netspeed->details       = NULL;
     netspeed->drawingarea   = NULL;
@@ -1158,6 +1651,10 @@ info_response_cb (GtkDialog      *dialog,
     netspeed->hwaddr_text   = NULL;
     netspeed->inbytes_text  = NULL;
     netspeed->outbytes_text = NULL;
+    netspeed->today_text    = NULL;
+    netspeed->month_text    = NULL;
+    netspeed->talkers_expander = NULL;
+    netspeed->talkers_text  = NULL;
     netspeed->essid_text    = NULL;
     netspeed->signalbar     = NULL;
 #ifdef HAVE_NL
@@ -1197,6 +1694,10 @@ showinfo_cb (GtkAction      *action,
     netspeed->hwaddr_text   = GET_WIDGET ("hwaddr_text");
     netspeed->inbytes_text  = GET_WIDGET ("inbytes_text");
     netspeed->outbytes_text = GET_WIDGET ("outbytes_text");
+    netspeed->today_text    = GET_WIDGET ("today_text");
+    netspeed->month_text    = GET_WIDGET ("month_text");
+    netspeed->talkers_expander = GET_WIDGET ("talkers_expander");
+    netspeed->talkers_text  = GET_WIDGET ("talkers_text");
     netspeed->essid_text    = GET_WIDGET ("essid_text");
     netspeed->signalbar     = GET_WIDGET ("signalbar");
 #ifdef HAVE_NL
@@ -1213,12 +1714,14 @@ showinfo_cb (GtkAction      *action,
     gtk_color_chooser_set_rgba (GET_COLOR_CHOOSER ("outcolor_sel"),  &netspeed->out_color);
 
     fill_details_dialog (netspeed);
+    update_history_totals (netspeed);
 
     gtk_builder_add_callback_symbols (builder,
                                       "on_drawingarea_draw", G_CALLBACK (da_draw),
                                       "on_incolor_sel_color_set", G_CALLBACK (incolor_changed_cb),
                                       "on_outcolor_sel_color_set", G_CALLBACK (outcolor_changed_cb),
                                       "on_dialog_response", G_CALLBACK (info_response_cb),
+                                      "on_talkers_expander_expanded", G_CALLBACK (talkers_expanded_cb),
                                       NULL);
     gtk_builder_connect_signals (builder, netspeed);
 
@@ -1319,6 +1822,101 @@ netspeed_applet_button_press_event (GtkWidget      *widget,
     return GTK_WIDGET_CLASS (netspeed_applet_parent_class)->button_press_event (widget, event);
 }
 
+#define METRICS_PREFIX "mate_netspeed_"
+
+/* The counters of the devices, then the newest rates and their maxima
+ * over the graph of the details dialog, and the traffic of today from
+ * the long term history: all of it is what update_applet () keeps, so
+ * serving the metrics reads no counter of its own. */
+static void
+netspeed_metrics (GString  *out,
+                  gpointer  data)
+{
+    NetspeedApplet *netspeed = data;
+    GString *device;
+    GDateTime *now, *today;
+    double in_rate, out_rate, in_peak = -1, out_peak = -1;
+    guint64 rx, tx;
+    guint i;
+
+    if (netspeed->devinfo == NULL)
+        return;
+
+    device = g_string_new (NULL);
+
+    sampler_metrics_family (out, METRICS_PREFIX "up", "gauge",
+                            "Whether the device is running");
+    for (i = 0; i < netspeed->devinfos->len; i++) {
+        DevInfo *devinfo = g_ptr_array_index (netspeed->devinfos, i);
+
+        g_string_assign (device, "device=");
+        sampler_metrics_label_value (device, devinfo->name);
+        sampler_metrics_sample (out, METRICS_PREFIX "up", device->str, devinfo->running);
+    }
+
+    sampler_metrics_family (out, METRICS_PREFIX "receive_bytes_total", "counter",
+                            "Bytes received by the device");
+    sampler_metrics_family (out, METRICS_PREFIX "transmit_bytes_total", "counter",
+                            "Bytes sent by the device");
+    for (i = 0; i < netspeed->devinfos->len; i++) {
+        DevInfo *devinfo = g_ptr_array_index (netspeed->devinfos, i);
+
+        g_string_assign (device, "device=");
+        sampler_metrics_label_value (device, devinfo->name);
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "receive_bytes_total", device->str, devinfo->rx);
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "transmit_bytes_total", device->str, devinfo->tx);
+    }
+
+    /* the rates and the history are those of the selected device */
+    g_string_assign (device, "device=");
+    sampler_metrics_label_value (device, netspeed->devinfo->name);
+
+    i = (netspeed->index_graph + GRAPH_VALUES - 1) % GRAPH_VALUES;
+    in_rate = netspeed->in_graph [i];
+    out_rate = netspeed->out_graph [i];
+    for (i = 0; i < GRAPH_VALUES; i++) {
+        in_peak = MAX (in_peak, netspeed->in_graph [i]);
+        out_peak = MAX (out_peak, netspeed->out_graph [i]);
+    }
+
+    /* -1 marks the columns without a sample */
+    if (in_rate >= 0) {
+        sampler_metrics_family (out, METRICS_PREFIX "receive_bytes_per_second", "gauge",
+                                "Newest inbound rate, with the extra devices when they are combined");
+        sampler_metrics_sample (out, METRICS_PREFIX "receive_bytes_per_second", device->str, in_rate);
+        sampler_metrics_family (out, METRICS_PREFIX "transmit_bytes_per_second", "gauge",
+                                "Newest outbound rate, with the extra devices when they are combined");
+        sampler_metrics_sample (out, METRICS_PREFIX "transmit_bytes_per_second", device->str, out_rate);
+        sampler_metrics_family (out, METRICS_PREFIX "receive_peak_bytes_per_second", "gauge",
+                                "Highest inbound rate of the last " G_STRINGIFY (GRAPH_VALUES) " updates");
+        sampler_metrics_sample (out, METRICS_PREFIX "receive_peak_bytes_per_second", device->str, in_peak);
+        sampler_metrics_family (out, METRICS_PREFIX "transmit_peak_bytes_per_second", "gauge",
+                                "Highest outbound rate of the last " G_STRINGIFY (GRAPH_VALUES) " updates");
+        sampler_metrics_sample (out, METRICS_PREFIX "transmit_peak_bytes_per_second", device->str, out_peak);
+    }
+
+    now = g_date_time_new_now_local ();
+    today = g_date_time_new_local (g_date_time_get_year (now),
+                                   g_date_time_get_month (now),
+                                   g_date_time_get_day_of_month (now),
+                                   0, 0, 0);
+    if (netspeed->history != NULL &&
+        netspeed_history_get_totals (netspeed->history,
+                                     g_date_time_to_unix (today) * G_USEC_PER_SEC,
+                                     &rx, &tx)) {
+        sampler_metrics_family (out, METRICS_PREFIX "today_receive_bytes", "gauge",
+                                "Bytes received since midnight");
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "today_receive_bytes", device->str, rx);
+        sampler_metrics_family (out, METRICS_PREFIX "today_transmit_bytes", "gauge",
+                                "Bytes sent since midnight");
+        sampler_metrics_sample_u64 (out, METRICS_PREFIX "today_transmit_bytes", device->str, tx);
+    }
+    g_date_time_unref (today);
+    g_date_time_unref (now);
+
+    g_string_free (device, TRUE);
+}
+
 /* Frees the applet and all the data it contains
  * Removes the timeout_cb
  */
@@ -1339,14 +1937,29 @@ netspeed_applet_finalize (GObject *object)
         netspeed->timeout_id = 0;
     }
 
+    g_clear_pointer (&netspeed->metrics, sampler_metrics_free);
     g_clear_object (&netspeed->settings);
 
     g_clear_pointer (&netspeed->details, gtk_widget_destroy);
     g_clear_pointer (&netspeed->preferences, gtk_widget_destroy);
+    graph_cache_free (netspeed);
+    g_clear_pointer (&netspeed->talkers, netspeed_talkers_free);
 
     g_free (netspeed->up_cmd);
     g_free (netspeed->down_cmd);
 
+    rate_estimator_free (netspeed->in_rate);
+    rate_estimator_free (netspeed->out_rate);
+
+    netspeed_history_close (netspeed->history);
+    g_free (netspeed->history_device);
+
+    g_string_free (netspeed->tooltip, TRUE);
+    g_string_free (netspeed->tooltip_next, TRUE);
+
+    g_ptr_array_free (netspeed->extra_devices, TRUE);
+    g_ptr_array_free (netspeed->devinfos, TRUE);
+
     /* Should never be NULL */
     free_device_info (netspeed->devinfo);
 }
@@ -1355,23 +1968,26 @@ static void
 update_tooltip (NetspeedApplet *netspeed)
 {
     GString* tooltip;
+    guint i;
 
     if (!netspeed->show_tooltip)
         return;
 
-    tooltip = g_string_new ("");
+    /* built into the buffer of the previous tick but one */
+    tooltip = netspeed->tooltip_next;
+    g_string_truncate (tooltip, 0);
 
     if (!netspeed->devinfo->running)
         g_string_printf (tooltip, _("%s is down"), netspeed->devinfo->name);
     else {
-        GSList *iterator;
+        const GSList *iterator;
         GString *string = NULL;
         char ipv4_text [INET_ADDRSTRLEN];
 
         g_string_printf (tooltip, "%s: ", netspeed->devinfo->name);
 
         if (netspeed->show_all_addresses || !netspeed->devinfo->ip) {
-            GSList *ip6_address_list = get_ip6_address_list (netspeed->devinfo->name);
+            const GSList *ip6_address_list = get_ip6_address_list (netspeed->devinfo->name);
 
             /* check if we got IPv6 addresses */
             if (ip6_address_list != NULL) {
@@ -1384,8 +2000,6 @@ update_tooltip (NetspeedApplet *netspeed)
                                                 (char*) iterator->data);
                 }
             }
-
-            g_slist_free_full (ip6_address_list, g_free);
         }
 
         if (!netspeed->devinfo->ip && !string) {
@@ -1433,9 +2047,26 @@ update_tooltip (NetspeedApplet *netspeed)
 #endif /* HAVE_IW */
     }
 
+    for (i = 0; i < netspeed->extra_devices->len; i++) {
+        NetspeedExtraDevice *extra = g_ptr_array_index (netspeed->extra_devices, i);
+
+        if (!extra->devinfo->running)
+            g_string_append_printf (tooltip, _("\n%s is down"), extra->devinfo->name);
+        else
+            g_string_append_printf (tooltip, _("\n%s: in: %s out: %s"),
+                                    extra->devinfo->name,
+                                    extra->devinfo->rx_rate,
+                                    extra->devinfo->tx_rate);
+    }
+
+    if (g_string_equal (tooltip, netspeed->tooltip))
+        return;
+
     gtk_widget_set_tooltip_text (GTK_WIDGET (netspeed), tooltip->str);
     gtk_widget_trigger_tooltip_query (GTK_WIDGET (netspeed));
-    g_string_free (tooltip, TRUE);
+
+    netspeed->tooltip_next = netspeed->tooltip;
+    netspeed->tooltip = tooltip;
 }
 
 static gboolean
@@ -1510,6 +2141,16 @@ showbits_settings_changed (GSettings      *settings,
                            NetspeedApplet *netspeed)
 {
     netspeed->show_bits = g_settings_get_boolean (settings, key);
+    update_rate_label_widths (netspeed);
+}
+
+static void
+fixedwidth_settings_changed (GSettings      *settings,
+                             const gchar    *key,
+                             NetspeedApplet *netspeed)
+{
+    netspeed->fixed_width = g_settings_get_boolean (settings, key);
+    update_rate_label_widths (netspeed);
 }
 
 static void
@@ -1530,6 +2171,30 @@ showqualityicon_settings_changed (GSettings      *settings,
     change_quality_icon (netspeed);
 }
 
+static void
+metrics_settings_changed (GSettings      *settings,
+                          const gchar    *key,
+                          NetspeedApplet *netspeed)
+{
+    gchar *path;
+
+    path = g_settings_get_string (settings, "metrics-socket");
+    sampler_metrics_set_socket (netspeed->metrics, path);
+    g_free (path);
+
+    path = g_settings_get_string (settings, "metrics-textfile");
+    sampler_metrics_set_textfile (netspeed->metrics, path);
+    g_free (path);
+}
+
+static void
+netspeed_applet_start_metrics (gpointer data)
+{
+    NetspeedApplet *netspeed = data;
+
+    metrics_settings_changed (netspeed->settings, NULL, netspeed);
+}
+
 static void
 auto_change_device_settings_changed (GSettings      *settings,
                                      const gchar    *key,
@@ -1540,6 +2205,31 @@ auto_change_device_settings_changed (GSettings      *settings,
     update_applet (netspeed);
 }
 
+static void
+extra_devices_settings_changed (GSettings      *settings,
+                                const gchar    *key,
+                                NetspeedApplet *netspeed)
+{
+    netspeed->combine_devices = g_settings_get_boolean (settings, "combine-devices");
+    load_extra_devices (netspeed);
+    applet_change_size_or_orient (MATE_PANEL_APPLET (netspeed), -1, netspeed);
+}
+
+static void
+refresh_time_settings_changed (GSettings      *settings,
+                               const gchar    *key,
+                               NetspeedApplet *netspeed)
+{
+    netspeed->refresh_time = CLAMP (g_settings_get_uint (settings, key),
+                                    REFRESH_TIME_MIN, REFRESH_TIME_MAX);
+
+    if (netspeed->timeout_id > 0)
+        g_source_remove (netspeed->timeout_id);
+    netspeed->timeout_id = sampler_tick_add (netspeed->refresh_time,
+                                             (GSourceFunc)timeout_function,
+                                             netspeed);
+}
+
 static void
 device_settings_changed (GSettings      *settings,
                          const gchar    *key,
@@ -1573,6 +2263,8 @@ netspeed_applet_factory (MatePanelApplet *applet,
     if (strcmp (iid, "NetspeedApplet"))
         return FALSE;
 
+    applet_startup_mark ("netspeed factory");
+
     glibtop_init ();
 
 #ifndef ENABLE_IN_PROCESS
@@ -1590,15 +2282,30 @@ netspeed_applet_factory (MatePanelApplet *applet,
 
     netspeed->settings = mate_panel_applet_settings_new (applet, "org.mate.panel.applet.netspeed");
 
+    netspeed->in_rate = rate_estimator_new (OLD_VALUES, 0);
+    netspeed->out_rate = rate_estimator_new (OLD_VALUES, 0);
+
+    netspeed->tooltip = g_string_new (NULL);
+    netspeed->tooltip_next = g_string_new (NULL);
+
+    netspeed->extra_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) netspeed_extra_device_free);
+    netspeed->devinfos = g_ptr_array_new ();
+    g_ptr_array_add (netspeed->devinfos, NULL);
+    netspeed->combine_devices = g_settings_get_boolean (netspeed->settings, "combine-devices");
+    load_extra_devices (netspeed);
+
     /* Get stored settings from gsettings
      */
     netspeed->show_all_addresses = g_settings_get_boolean (netspeed->settings, "show-all-addresses");
     netspeed->show_sum = g_settings_get_boolean (netspeed->settings, "show-sum");
     netspeed->show_bits = g_settings_get_boolean (netspeed->settings, "show-bits");
+    netspeed->fixed_width = g_settings_get_boolean (netspeed->settings, "fixed-width");
     netspeed->show_icon = g_settings_get_boolean (netspeed->settings, "show-icon");
     netspeed->show_quality_icon = g_settings_get_boolean (netspeed->settings, "show-quality-icon");
     netspeed->change_icon = g_settings_get_boolean (netspeed->settings, "change-icon");
     netspeed->auto_change_device = g_settings_get_boolean (netspeed->settings, "auto-change-device");
+    netspeed->refresh_time = CLAMP (g_settings_get_uint (netspeed->settings, "refresh-time"),
+                                    REFRESH_TIME_MIN, REFRESH_TIME_MAX);
 
     tmp = g_settings_get_string (netspeed->settings, "device");
     if (tmp && *tmp != '\0')
@@ -1652,9 +2359,10 @@ netspeed_applet_factory (MatePanelApplet *applet,
 
     netspeed->device_has_changed = TRUE;
 
-    netspeed->in_label = gtk_label_new ("");
-    netspeed->out_label = gtk_label_new ("");
-    netspeed->sum_label = gtk_label_new ("");
+    netspeed->in_label = netspeed_rate_label_new ();
+    netspeed->out_label = netspeed_rate_label_new ();
+    netspeed->sum_label = netspeed_rate_label_new ();
+    update_rate_label_widths (netspeed);
 
     netspeed->in_pix = gtk_image_new ();
     netspeed->out_pix = gtk_image_new ();
@@ -1672,17 +2380,15 @@ netspeed_applet_factory (MatePanelApplet *applet,
     gtk_box_pack_start (GTK_BOX (spacer_box), netspeed->qual_pix, FALSE, FALSE, 0);
     gtk_box_pack_start (GTK_BOX (spacer_box), netspeed->dev_pix, FALSE, FALSE, 0);
 
-    init_quality_surfaces (netspeed);
-
     applet_change_size_or_orient (applet, -1, netspeed);
     gtk_widget_show_all (GTK_WIDGET (applet));
     update_applet (netspeed);
 
     mate_panel_applet_set_flags (applet, MATE_PANEL_APPLET_EXPAND_MINOR);
 
-    netspeed->timeout_id = g_timeout_add (REFRESH_TIME,
-                                         (GSourceFunc)timeout_function,
-                                         netspeed);
+    netspeed->timeout_id = sampler_tick_add (netspeed->refresh_time,
+                                             (GSourceFunc)timeout_function,
+                                             netspeed);
     g_signal_connect_object (applet, "change-size",
                              G_CALLBACK (applet_change_size_or_orient),
                              netspeed, 0);
@@ -1715,6 +2421,18 @@ netspeed_applet_factory (MatePanelApplet *applet,
                              G_CALLBACK (device_settings_changed),
                              netspeed, 0);
 
+    g_signal_connect_object (netspeed->settings, "changed::extra-devices",
+                             G_CALLBACK (extra_devices_settings_changed),
+                             netspeed, 0);
+
+    g_signal_connect_object (netspeed->settings, "changed::combine-devices",
+                             G_CALLBACK (extra_devices_settings_changed),
+                             netspeed, 0);
+
+    g_signal_connect_object (netspeed->settings, "changed::refresh-time",
+                             G_CALLBACK (refresh_time_settings_changed),
+                             netspeed, 0);
+
     g_signal_connect_object (netspeed->settings, "changed::show-all-addresses",
                              G_CALLBACK (showalladdresses_settings_changed),
                              netspeed, 0);
@@ -1727,6 +2445,10 @@ netspeed_applet_factory (MatePanelApplet *applet,
                              G_CALLBACK (showbits_settings_changed),
                              netspeed, 0);
 
+    g_signal_connect_object (netspeed->settings, "changed::fixed-width",
+                             G_CALLBACK (fixedwidth_settings_changed),
+                             netspeed, 0);
+
     g_signal_connect_object (netspeed->settings, "changed::change-icon",
                              G_CALLBACK (changeicon_settings_changed),
                              netspeed, 0);
@@ -1739,6 +2461,19 @@ netspeed_applet_factory (MatePanelApplet *applet,
                              G_CALLBACK (showqualityicon_settings_changed),
                              netspeed, 0);
 
+    /* nobody scrapes the metrics before the panel is up */
+    netspeed->metrics = sampler_metrics_new (netspeed_metrics, netspeed);
+    applet_startup_defer (GTK_WIDGET (applet), "netspeed",
+                          netspeed_applet_start_metrics, netspeed);
+
+    g_signal_connect_object (netspeed->settings, "changed::metrics-socket",
+                             G_CALLBACK (metrics_settings_changed),
+                             netspeed, 0);
+
+    g_signal_connect_object (netspeed->settings, "changed::metrics-textfile",
+                             G_CALLBACK (metrics_settings_changed),
+                             netspeed, 0);
+
     action_group = gtk_action_group_new ("Netspeed Applet Actions");
     gtk_action_group_set_translation_domain (action_group, GETTEXT_PACKAGE);
     gtk_action_group_add_actions (action_group,
@@ -1760,6 +2495,8 @@ netspeed_applet_factory (MatePanelApplet *applet,
 
     g_object_unref (action_group);
 
+    applet_startup_mark ("netspeed constructed");
+
     return TRUE;
 }
 
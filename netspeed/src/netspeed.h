@@ -32,4 +32,11 @@ GSettings * netspeed_applet_get_settings (NetspeedApplet *netspeed);
 const gchar * netspeed_applet_get_current_device_name (NetspeedApplet *netspeed);
 void netspeed_applet_display_help (GtkWidget *dialog, const gchar *section);
 
+/* For netspeed-bench: the graph of the details dialog on da, and a tick
+ * adding the rates of a sample to it */
+G_GNUC_INTERNAL NetspeedApplet * netspeed_applet_bench_new (GtkDrawingArea *da);
+G_GNUC_INTERNAL void netspeed_applet_bench_add_sample (NetspeedApplet *netspeed,
+                                                       double          inrate,
+                                                       double          outrate);
+
 #endif
@@ -0,0 +1,354 @@
+/*  talkers.c
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/tcp.h>
+#endif
+
+#include "talkers.h"
+
+/* the TCP states that move data: established, fin wait 1 and 2 and close
+ * wait, numbered as in the kernel's <net/tcp_states.h> */
+#define TALKERS_STATES ((1 << 1) | (1 << 4) | (1 << 5) | (1 << 8))
+
+struct _NetspeedTalkers {
+    int            fd;
+    guint32        seq;
+    GHashTable    *sockets;       /* cookie -> NetspeedTalker */
+    guint          generation;
+    gint64         time;
+};
+
+static void
+netspeed_talker_free (NetspeedTalker *talker)
+{
+    g_free (talker->process);
+    g_free (talker);
+}
+
+NetspeedTalkers *
+netspeed_talkers_new (void)
+{
+    NetspeedTalkers *talkers;
+
+    talkers = g_new0 (NetspeedTalkers, 1);
+    talkers->fd = -1;
+    talkers->sockets = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+                                              (GDestroyNotify) netspeed_talker_free);
+
+    return talkers;
+}
+
+void
+netspeed_talkers_free (NetspeedTalkers *talkers)
+{
+    if (!talkers)
+        return;
+
+    if (talkers->fd >= 0)
+        close (talkers->fd);
+
+    g_hash_table_destroy (talkers->sockets);
+    g_free (talkers);
+}
+
+#ifdef __linux__
+static void
+talkers_parse_socket (NetspeedTalkers  *talkers,
+                      struct nlmsghdr  *header,
+                      double            elapsed)
+{
+    struct inet_diag_msg *msg = NLMSG_DATA (header);
+    struct rtattr *attr;
+    struct tcp_info info;
+    NetspeedTalker *talker;
+    gboolean have_info = FALSE;
+    guint64 cookie;
+    int remaining;
+
+    if (header->nlmsg_len < NLMSG_LENGTH (sizeof *msg))
+        return;
+
+    remaining = header->nlmsg_len - NLMSG_LENGTH (sizeof *msg);
+    for (attr = (struct rtattr *) (msg + 1); RTA_OK (attr, remaining); attr = RTA_NEXT (attr, remaining)) {
+        /* the counters were added to tcp_info in Linux 4.1 */
+        if (attr->rta_type == INET_DIAG_INFO &&
+            RTA_PAYLOAD (attr) >= offsetof (struct tcp_info, tcpi_bytes_received) + sizeof info.tcpi_bytes_received) {
+            memset (&info, 0, sizeof info);
+            memcpy (&info, RTA_DATA (attr), MIN (RTA_PAYLOAD (attr), sizeof info));
+            have_info = TRUE;
+        }
+    }
+
+    if (!have_info)
+        return;
+
+    cookie = (guint64) msg->id.idiag_cookie[0] | ((guint64) msg->id.idiag_cookie[1] << 32);
+    talker = g_hash_table_lookup (talkers->sockets, &cookie);
+
+    if (!talker) {
+        /* how long the bytes so far took is not known, so the rates
+         * start with the next update */
+        talker = g_new0 (NetspeedTalker, 1);
+        talker->cookie = cookie;
+        talker->family = msg->idiag_family;
+        memcpy (talker->local, msg->id.idiag_src, sizeof talker->local);
+        memcpy (talker->remote, msg->id.idiag_dst, sizeof talker->remote);
+        talker->local_port = g_ntohs (msg->id.idiag_sport);
+        talker->remote_port = g_ntohs (msg->id.idiag_dport);
+        talker->inode = msg->idiag_inode;
+        g_hash_table_insert (talkers->sockets, &talker->cookie, talker);
+    } else if (elapsed > 0) {
+        talker->rx_rate = info.tcpi_bytes_received >= talker->rx ?
+                          (info.tcpi_bytes_received - talker->rx) / elapsed : 0;
+        talker->tx_rate = info.tcpi_bytes_acked >= talker->tx ?
+                          (info.tcpi_bytes_acked - talker->tx) / elapsed : 0;
+    }
+
+    talker->rx = info.tcpi_bytes_received;
+    talker->tx = info.tcpi_bytes_acked;
+    talker->generation = talkers->generation;
+}
+
+static gboolean
+talkers_dump (NetspeedTalkers *talkers,
+              int              family,
+              double           elapsed)
+{
+    /* large enough for the biggest dump part the kernel sends */
+    static guint32 buffer [8192];
+    struct {
+        struct nlmsghdr         header;
+        struct inet_diag_req_v2 request;
+    } request;
+
+    memset (&request, 0, sizeof request);
+    request.header.nlmsg_len = sizeof request;
+    request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++talkers->seq;
+    request.request.sdiag_family = family;
+    request.request.sdiag_protocol = IPPROTO_TCP;
+    request.request.idiag_states = TALKERS_STATES;
+    request.request.idiag_ext = 1 << (INET_DIAG_INFO - 1);
+
+    if (send (talkers->fd, &request, sizeof request, 0) < 0)
+        return FALSE;
+
+    for (;;) {
+        struct nlmsghdr *header;
+        gssize len;
+        int remaining;
+
+        len = recv (talkers->fd, buffer, sizeof buffer, MSG_TRUNC);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len <= 0 || (gsize) len > sizeof buffer)
+            return FALSE;
+
+        remaining = (int) len;
+        for (header = (struct nlmsghdr *) buffer;
+             NLMSG_OK (header, remaining);
+             header = NLMSG_NEXT (header, remaining)) {
+            /* a leftover reply to an earlier, abandoned request */
+            if (header->nlmsg_seq != talkers->seq)
+                continue;
+
+            switch (header->nlmsg_type) {
+                case NLMSG_DONE:
+                    return TRUE;
+                case NLMSG_ERROR:
+                    return FALSE;
+                case SOCK_DIAG_BY_FAMILY:
+                    talkers_parse_socket (talkers, header, elapsed);
+                    break;
+            }
+        }
+    }
+}
+
+static gboolean
+talker_is_gone (gpointer key,
+                gpointer value,
+                gpointer user_data)
+{
+    NetspeedTalker *talker = value;
+    NetspeedTalkers *talkers = user_data;
+
+    return talker->generation != talkers->generation;
+}
+#endif /* __linux__ */
+
+gboolean
+netspeed_talkers_update (NetspeedTalkers *talkers)
+{
+#ifdef __linux__
+    gint64 now = g_get_monotonic_time ();
+    double elapsed;
+    gboolean ok;
+
+    if (talkers->fd < 0) {
+        talkers->fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+        if (talkers->fd < 0) {
+            g_debug ("Failed to open a sock_diag socket: %s", g_strerror (errno));
+            return FALSE;
+        }
+    }
+
+    elapsed = talkers->time ? (double) (now - talkers->time) / G_USEC_PER_SEC : 0;
+    talkers->time = now;
+    talkers->generation++;
+
+    ok = talkers_dump (talkers, AF_INET, elapsed) &&
+         talkers_dump (talkers, AF_INET6, elapsed);
+
+    if (!ok) {
+        g_debug ("Failed to dump the TCP sockets: %s", g_strerror (errno));
+        close (talkers->fd);
+        talkers->fd = -1;
+        talkers->time = 0;
+        g_hash_table_remove_all (talkers->sockets);
+        return FALSE;
+    }
+
+    g_hash_table_foreach_remove (talkers->sockets, talker_is_gone, talkers);
+
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/* Finds the processes holding the sockets of talkers, with one walk
+ * over the file descriptors of /proc. Only processes of the same user
+ * can be looked into.
+ */
+static void
+talkers_look_up_processes (NetspeedTalker **top,
+                           guint            n)
+{
+    GHashTable *inodes;
+    GDir *proc;
+    const char *pid;
+    guint i;
+
+    inodes = g_hash_table_new (NULL, NULL);
+    for (i = 0; i < n; i++) {
+        if (!top[i]->looked_up && top[i]->inode) {
+            g_hash_table_insert (inodes, GUINT_TO_POINTER (top[i]->inode), top[i]);
+        }
+        top[i]->looked_up = TRUE;
+    }
+
+    proc = g_hash_table_size (inodes) ? g_dir_open ("/proc", 0, NULL) : NULL;
+    while (proc && g_hash_table_size (inodes) && (pid = g_dir_read_name (proc))) {
+        char path [64];
+        GDir *fds;
+        const char *fd;
+
+        if (!g_ascii_isdigit (*pid))
+            continue;
+
+        g_snprintf (path, sizeof path, "/proc/%s/fd", pid);
+        if (!(fds = g_dir_open (path, 0, NULL)))
+            continue;
+
+        while ((fd = g_dir_read_name (fds))) {
+            char link [64];
+            char fd_path [96];
+            NetspeedTalker *talker;
+            guint inode;
+            gssize len;
+
+            g_snprintf (fd_path, sizeof fd_path, "%s/%s", path, fd);
+            len = readlink (fd_path, link, sizeof link - 1);
+            if (len <= 0)
+                continue;
+            link[len] = '\0';
+
+            if (sscanf (link, "socket:[%u]", &inode) != 1)
+                continue;
+
+            talker = g_hash_table_lookup (inodes, GUINT_TO_POINTER (inode));
+            if (talker) {
+                char *comm;
+
+                g_snprintf (fd_path, sizeof fd_path, "/proc/%s/comm", pid);
+                if (g_file_get_contents (fd_path, &comm, NULL, NULL))
+                    talker->process = g_strchomp (comm);
+                g_hash_table_remove (inodes, GUINT_TO_POINTER (inode));
+            }
+        }
+        g_dir_close (fds);
+    }
+
+    if (proc)
+        g_dir_close (proc);
+    g_hash_table_destroy (inodes);
+}
+
+guint
+netspeed_talkers_get_top (NetspeedTalkers  *talkers,
+                          NetspeedTalker  **top,
+                          guint             n)
+{
+    GHashTableIter iter;
+    NetspeedTalker *talker;
+    guint count = 0;
+
+    g_hash_table_iter_init (&iter, talkers->sockets);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &talker)) {
+        double rate = talker->rx_rate + talker->tx_rate;
+        guint i;
+
+        if (rate <= 0)
+            continue;
+
+        /* insertion into the short sorted list */
+        for (i = count; i > 0 && top[i - 1]->rx_rate + top[i - 1]->tx_rate < rate; i--) {
+            if (i < n)
+                top[i] = top[i - 1];
+        }
+        if (i < n) {
+            top[i] = talker;
+            count = MIN (count + 1, n);
+        }
+    }
+
+    talkers_look_up_processes (top, count);
+
+    return count;
+}
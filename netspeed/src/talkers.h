@@ -0,0 +1,69 @@
+/*  talkers.h
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _TALKERS_H
+#define _TALKERS_H
+
+#include <glib.h>
+
+/* The TCP connections moving the most bytes, as reported by the
+ * sock_diag netlink interface.
+ *
+ * Every update dumps the TCP sockets of the host once, so it costs in
+ * proportion to the number of connections, and is meant to be called
+ * only while someone looks at the result. The byte counters of tcp_info
+ * are diffed per socket cookie against the previous update.
+ */
+
+typedef struct {
+    guint64        cookie;
+    int            family;        /* AF_INET or AF_INET6 */
+    guint8         local [16];
+    guint8         remote [16];
+    guint16        local_port;
+    guint16        remote_port;
+    guint32        inode;
+    guint64        rx;            /* tcpi_bytes_received */
+    guint64        tx;            /* tcpi_bytes_acked */
+    double         rx_rate;       /* bytes per second */
+    double         tx_rate;
+    char          *process;       /* NULL until looked up */
+    gboolean       looked_up;
+    guint          generation;
+} NetspeedTalker;
+
+typedef struct _NetspeedTalkers NetspeedTalkers;
+
+NetspeedTalkers *
+netspeed_talkers_new (void);
+
+void
+netspeed_talkers_free (NetspeedTalkers *talkers);
+
+/* Returns FALSE if the sockets can not be dumped */
+gboolean
+netspeed_talkers_update (NetspeedTalkers *talkers);
+
+/* Fills top with the n busiest connections of the last update, busiest
+ * first, and looks up the processes owning them. Returns how many were
+ * found. */
+guint
+netspeed_talkers_get_top (NetspeedTalkers  *talkers,
+                          NetspeedTalker  **top,
+                          guint             n);
+
+#endif /* _TALKERS_H */
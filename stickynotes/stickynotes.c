@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <X11/Xatom.h>
 #include <gdk/gdkx.h>
 #include <gtk/gtk.h>
@@ -29,6 +30,9 @@
 
 #include "stickynotes.h"
 #include "stickynotes_callbacks.h"
+#include "stickynotes_index.h"
+#include "stickynotes_snapshot.h"
+#include "stickynotes_style.h"
 #include "util.h"
 #include "stickynotes_applet.h"
 
@@ -36,7 +40,9 @@
 #define XML_CHAR(str) ((xmlChar *) (str))
 #define STICKYNOTES_ICON_SIZE 8
 
-static gboolean save_scheduled = FALSE;
+/* Seconds to wait for more typing, and to wait at most, before saving */
+#define STICKYNOTES_SAVE_DEBOUNCE 10
+#define STICKYNOTES_SAVE_DELAY 60
 
 static void response_cb (GtkWidget *dialog, gint id, gpointer data);
 
@@ -71,14 +77,57 @@ set_icon_geometry (GdkWindow *window,
                      (guchar *)&data, 4);
 }
 
-/* Called when a timeout occurs.  */
+static gboolean save_timeout (gpointer data);
+
+/* (Re)arms the save timer for the time the pending save is due */
+static void
+save_arm (void)
+{
+    gint64 now = g_get_monotonic_time ();
+    guint interval = 0;
+
+    if (stickynotes->save_time > now)
+        interval = (stickynotes->save_time - now) / 1000;
+
+    if (stickynotes->save_timeout_id)
+        g_source_remove (stickynotes->save_timeout_id);
+
+    stickynotes->save_timeout_id = g_timeout_add (interval, save_timeout, NULL);
+    stickynotes->save_armed = stickynotes->save_time;
+}
+
+/* Called when the save timer fires.  The save may have been put off
+   meanwhile, then the timer is armed again for it.  */
 static gboolean
-timeout_happened (gpointer data)
+save_timeout (gpointer data)
 {
-    if (GPOINTER_TO_UINT (data) == stickynotes->last_timeout_data)
-        stickynotes_save ();
+    stickynotes->save_timeout_id = 0;
 
-    return FALSE;
+    if (g_get_monotonic_time () < stickynotes->save_time)
+        save_arm ();
+    else
+        stickynotes_save_now ();
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Saves the notes once there have been no changes for a while, but no
+   later than the usual save after the first change.  */
+static void
+stickynotes_save_debounced (void)
+{
+    gint64 now = g_get_monotonic_time ();
+
+    if (!stickynotes->save_timeout_id)
+        stickynotes->save_limit = now + STICKYNOTES_SAVE_DELAY * G_USEC_PER_SEC;
+
+    stickynotes->save_time = MIN (now + STICKYNOTES_SAVE_DEBOUNCE * G_USEC_PER_SEC,
+                                  stickynotes->save_limit);
+
+    /* Putting the save off leaves the timer alone */
+    if (!stickynotes->save_timeout_id ||
+        stickynotes->save_time < stickynotes->save_armed)
+        save_arm ();
 }
 
 /* Called when a text buffer is changed.  */
@@ -90,12 +139,49 @@ buffer_changed (GtkTextBuffer *buffer,
         gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (note->w_scroller),
                                         GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
 
-    /* When a buffer is changed, we set a 10 second timer.  When
-       the timer triggers, we will save the buffer if there have
-       been no subsequent changes.  */
-    ++stickynotes->last_timeout_data;
-    g_timeout_add_seconds (10, (GSourceFunc) timeout_happened,
-                           GUINT_TO_POINTER (stickynotes->last_timeout_data));
+    /* When a buffer is changed, we save it 10 seconds later if there
+       have been no subsequent changes.  */
+    stickynotes_save_debounced ();
+
+    stickynotes_index_update (note);
+}
+
+/* Called when wnck sees the window of a note on another workspace */
+static void
+window_workspace_changed (WnckWindow *window,
+                          StickyNote *note)
+{
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+
+    /* A window on all workspaces has none */
+    note->workspace = workspace ? 1 + wnck_workspace_get_number (workspace) : 0;
+}
+
+/* Called when wnck sees a new window.  The window of a note is then
+   followed, so saving knows its workspace without asking the X server. */
+static void
+window_opened (WnckScreen *screen,
+               WnckWindow *window)
+{
+    GdkWindow *gdk_window;
+    GtkWidget *widget = NULL;
+    StickyNote *note;
+
+    gdk_window = gdk_x11_window_lookup_for_display (gdk_display_get_default (),
+                                                    wnck_window_get_xid (window));
+    if (!gdk_window)
+        return;
+
+    gdk_window_get_user_data (gdk_window, (gpointer *) &widget);
+    note = widget ? g_object_get_data (G_OBJECT (widget), "stickynote") : NULL;
+    if (!note || note->wnck_window)
+        return;
+
+    note->wnck_window = window;
+    g_object_add_weak_pointer (G_OBJECT (window), (gpointer *) &note->wnck_window);
+    g_signal_connect (window, "workspace-changed",
+                      G_CALLBACK (window_workspace_changed), note);
+    window_workspace_changed (window, note);
 }
 
 /* Create a new (empty) Sticky Note at a specific position
@@ -127,6 +213,7 @@ stickynote_new_aux (GdkScreen *screen,
     gtk_window_set_skip_taskbar_hint (GTK_WINDOW (note->w_window), TRUE);
     gtk_window_set_skip_pager_hint (GTK_WINDOW (note->w_window), TRUE);
     gtk_widget_add_events (note->w_window, GDK_BUTTON_PRESS_MASK);
+    g_object_set_data (G_OBJECT (note->w_window), "stickynote", note);
 
     note->w_title = GTK_WIDGET (gtk_builder_get_object (builder,
                                                         "title_label"));
@@ -200,6 +287,10 @@ stickynote_new_aux (GdkScreen *screen,
     note->color = NULL;
     note->font_color = NULL;
     note->font = NULL;
+    note->body_text = NULL;
+    note->body_xml = NULL;
+    note->body_pending = NULL;
+    note->wnck_window = NULL;
     note->locked = FALSE;
     note->x = x;
     note->y = y;
@@ -385,6 +476,20 @@ stickynote_new_aux (GdkScreen *screen,
                       G_CALLBACK (buffer_changed),
                       note);
 
+    stickynotes_index_update (note);
+
+#ifdef GDK_WINDOWING_X11
+    if (GDK_IS_X11_DISPLAY (gdk_screen_get_display (screen))) {
+        static gboolean watching = FALSE;
+
+        if (!watching) {
+            g_signal_connect (wnck_screen_get_default (), "window-opened",
+                              G_CALLBACK (window_opened), NULL);
+            watching = TRUE;
+        }
+    }
+#endif
+
     return note;
 }
 
@@ -398,6 +503,15 @@ stickynote_new (GdkScreen *screen)
 /* Destroy a Sticky Note */
 void stickynote_free (StickyNote *note)
 {
+    stickynotes_index_remove (note);
+    stickynotes_style_remove (note);
+
+    if (note->wnck_window) {
+        g_signal_handlers_disconnect_by_data (note->wnck_window, note);
+        g_object_remove_weak_pointer (G_OBJECT (note->wnck_window),
+                                      (gpointer *) &note->wnck_window);
+    }
+
     gtk_widget_destroy (note->w_properties);
     gtk_widget_destroy (note->w_menu);
     gtk_widget_destroy (note->w_window);
@@ -405,6 +519,9 @@ void stickynote_free (StickyNote *note)
     g_free (note->color);
     g_free (note->font_color);
     g_free (note->font);
+    g_free (note->body_text);
+    g_free (note->body_xml);
+    g_free (note->body_pending);
 
     g_free (note);
 }
@@ -478,6 +595,9 @@ response_cb (GtkWidget *dialog,
 gboolean
 stickynote_get_empty (const StickyNote *note)
 {
+    if (note->body_pending)
+        return FALSE;
+
     return gtk_text_buffer_get_char_count (gtk_text_view_get_buffer (GTK_TEXT_VIEW (note->w_body))) == 0;
 }
 
@@ -510,6 +630,8 @@ stickynote_set_title (StickyNote  *note,
         gtk_window_set_title (GTK_WINDOW (note->w_window), title);
         gtk_label_set_text (GTK_LABEL (note->w_title), title);
     }
+
+    stickynotes_index_update (note);
 }
 
 /* Set the sticky note color */
@@ -519,9 +641,6 @@ stickynote_set_color (StickyNote  *note,
                       const gchar *font_color_str,
                       gboolean     save)
 {
-    char *color_str_actual, *font_color_str_actual;
-    gboolean force_default, use_system_color;
-
     if (save) {
         if (note->color)
             g_free (note->color);
@@ -541,106 +660,7 @@ stickynote_set_color (StickyNote  *note,
                                   note->color != NULL);
     }
 
-    force_default = g_settings_get_boolean (stickynotes->settings,
-                                            "force-default");
-    use_system_color = g_settings_get_boolean (stickynotes->settings,
-                                               "use-system-color");
-
-    /* If "force_default" is enabled or color_str is NULL,
-     * then we use the default color instead of color_str. */
-    if (!color_str || force_default) {
-        if (use_system_color)
-            color_str_actual = NULL;
-        else
-            color_str_actual = g_settings_get_string (stickynotes->settings,
-                                                      "default-color");
-    } else
-        color_str_actual = g_strdup (color_str);
-
-    if (!font_color_str || force_default) {
-        if (use_system_color)
-            font_color_str_actual = NULL;
-        else
-            font_color_str_actual = g_settings_get_string (stickynotes->settings,
-                                                           "default-font-color");
-    } else
-        font_color_str_actual = g_strdup (font_color_str);
-
-    /* Do not use custom colors if "use_system_color" is enabled */
-    if (color_str_actual) {
-        GdkRGBA colors[4];
-        gint i;
-
-        for (i = 0; i <= 3; i++) {
-            gdk_rgba_parse (&colors[i], color_str_actual);
-            colors[i].red = (colors[i].red * (10 - i)) / 10;
-            colors[i].green = (colors[i].green * (10 - i)) / 10;
-            colors[i].blue = (colors[i].blue * (10 - i)) / 10;
-        }
-
-        gtk_widget_override_background_color (note->w_window,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-        gtk_widget_override_background_color (note->w_body,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-        gtk_widget_override_background_color (note->w_lock,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-        gtk_widget_override_background_color (note->w_close,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-        gtk_widget_override_background_color (note->w_resize_se,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-        gtk_widget_override_background_color (note->w_resize_sw,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              &colors[0]);
-    } else {
-        gtk_widget_override_background_color (note->w_window,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-        gtk_widget_override_background_color (note->w_body,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-        gtk_widget_override_background_color (note->w_lock,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-        gtk_widget_override_background_color (note->w_close,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-        gtk_widget_override_background_color (note->w_resize_se,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-        gtk_widget_override_background_color (note->w_resize_sw,
-                                              GTK_STATE_FLAG_NORMAL,
-                                              NULL);
-    }
-
-    if (font_color_str_actual) {
-        GdkRGBA color;
-
-        gdk_rgba_parse (&color, font_color_str_actual);
-
-        gtk_widget_override_color (note->w_window,
-                                   GTK_STATE_FLAG_NORMAL,
-                                   &color);
-        gtk_widget_override_color (note->w_body,
-                                   GTK_STATE_FLAG_NORMAL,
-                                   &color);
-    } else {
-        gtk_widget_override_color (note->w_window,
-                                   GTK_STATE_FLAG_NORMAL,
-                                   NULL);
-        gtk_widget_override_color (note->w_body,
-                                   GTK_STATE_FLAG_NORMAL,
-                                   NULL);
-    }
-
-    if (color_str_actual)
-        g_free (color_str_actual);
-    if (font_color_str_actual)
-        g_free (font_color_str_actual);
+    stickynotes_style_apply (note);
 }
 
 /* Set the sticky note font */
@@ -649,9 +669,6 @@ stickynote_set_font (StickyNote  *note,
                      const gchar *font_str,
                      gboolean     save)
 {
-    PangoFontDescription *font_desc;
-    gchar *font_str_actual;
-
     if (save) {
         g_free (note->font);
         note->font = font_str ? g_strdup (font_str) : NULL;
@@ -662,29 +679,7 @@ stickynote_set_font (StickyNote  *note,
                                   note->font != NULL);
     }
 
-    /* If "force_default" is enabled or font_str is NULL,
-     * then we use the default font instead of font_str. */
-    if (!font_str || g_settings_get_boolean (stickynotes->settings,
-                                             "force-default")) {
-        if (g_settings_get_boolean (stickynotes->settings,
-                                    "use-system-font"))
-            font_str_actual = NULL;
-        else
-            font_str_actual = g_settings_get_string (stickynotes->settings,
-                                                     "default-font");
-    } else
-        font_str_actual = g_strdup (font_str);
-
-    /* Do not use custom fonts if "use_system_font" is enabled */
-    font_desc = font_str_actual ?
-        pango_font_description_from_string (font_str_actual): NULL;
-
-    /* Apply the style to the widgets */
-    gtk_widget_override_font (note->w_window, font_desc);
-    gtk_widget_override_font (note->w_body, font_desc);
-
-    g_free (font_str_actual);
-    pango_font_description_free (font_desc);
+    stickynotes_style_apply (note);
 }
 
 /* Lock/Unlock a sticky note from editing */
@@ -730,6 +725,18 @@ stickynote_set_visible (StickyNote *note,
                         gboolean    visible)
 {
     if (visible) {
+        /* Fill the text buffer of a loaded note the first time it is shown */
+        if (note->body_pending) {
+            GtkTextIter start;
+
+            gtk_text_buffer_get_start_iter (note->buffer, &start);
+            gtk_text_buffer_insert (note->buffer, &start, note->body_pending, -1);
+            gtk_text_buffer_set_modified (note->buffer, FALSE);
+
+            g_free (note->body_pending);
+            note->body_pending = NULL;
+        }
+
         gtk_window_present (GTK_WINDOW (note->w_window));
 
         if (note->x != -1 || note->y != -1)
@@ -818,155 +825,461 @@ stickynotes_remove (StickyNote *note)
     g_object_unref (builder);
 }
 
-/* Save all sticky notes in an XML configuration file */
-gboolean
-stickynotes_save_now (void)
+static void
+append_attribute (GString     *node,
+                  const gchar *name,
+                  const gchar *value)
+{
+    gchar *escaped = g_markup_escape_text (value, -1);
+
+    g_string_append_printf (node, " %s=\"%s\"", name, escaped);
+    g_free (escaped);
+}
+
+/* Reads the body of a note again if it was changed since the last save,
+   and escapes it for the file again.  Returns the body as it is. */
+static const gchar *
+stickynote_update_body (StickyNote *note)
 {
-    const gchar *title;
     GtkTextBuffer *buffer;
     GtkTextIter start, end;
-    gchar *body;
-    gint i;
 
-    /* Create a new XML document */
-    xmlDocPtr doc = xmlNewDoc (XML_CHAR ("1.0"));
-    xmlNodePtr root = xmlNewDocNode (doc, NULL, XML_CHAR ("stickynotes"), NULL);
+    /* Not shown since it was loaded, so not changed.  A note from the
+       snapshot is escaped by the first save that needs it. */
+    if (note->body_pending) {
+        if (!note->body_xml)
+            note->body_xml = g_markup_escape_text (note->body_pending, -1);
+        return note->body_pending;
+    }
 
-    xmlDocSetRootElement (doc, root);
-    xmlNewProp (root, XML_CHAR ("version"), XML_CHAR (VERSION));
-#ifdef GDK_WINDOWING_X11
-    GdkDisplay *display = gdk_screen_get_display (gdk_screen_get_default());
-    if (GDK_IS_X11_DISPLAY (display))
-    {
-        WnckScreen *wnck_screen = wnck_screen_get_default ();
-        wnck_screen_force_update (wnck_screen);
+    buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (note->w_body));
+
+    if (note->body_text && note->body_xml && !gtk_text_buffer_get_modified (buffer))
+        return note->body_text;
+
+    gtk_text_buffer_get_bounds (buffer, &start, &end);
+
+    g_free (note->body_text);
+    note->body_text = gtk_text_iter_get_text (&start, &end);
+    g_free (note->body_xml);
+    note->body_xml = g_markup_escape_text (note->body_text, -1);
+
+    /* Now that it has been saved, reset the modified flag */
+    gtk_text_buffer_set_modified (buffer, FALSE);
+
+    return note->body_text;
+}
+
+/* The file is written by a worker thread, so a change meanwhile has
+   the next save wait for it to finish */
+static gboolean save_in_flight = FALSE;
+static gboolean save_again = FALSE;
+
+/* The snapshot of the notes being saved, written after the file */
+static GByteArray *save_snapshot = NULL;
+
+static void
+save_finished (void)
+{
+    save_in_flight = FALSE;
+
+    if (save_again) {
+        save_again = FALSE;
+        stickynotes_save_now ();
     }
-#endif
-    /* For all sticky notes */
-    for (i = 0; i < g_list_length (stickynotes->notes); i++) {
+}
 
-        /* Access the current note in the list */
-        StickyNote *note = g_list_nth_data (stickynotes->notes, i);
+static void
+snapshot_done_cb (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      data)
+{
+    GError *error = NULL;
 
-        /* Retrieve the window size of the note */
-        gchar *w_str = g_strdup_printf ("%d", note->w);
-        gchar *h_str = g_strdup_printf ("%d", note->h);
+    /* only a speedup, the next startup reads the XML file instead */
+    if (!stickynotes_snapshot_write_finish (result, &error)) {
+        g_debug ("Failed to save the snapshot of the sticky notes: %s", error->message);
+        g_error_free (error);
+    }
 
-        /* Retrieve the window position of the note */
-        gchar *x_str = g_strdup_printf ("%d", note->x);
-        gchar *y_str = g_strdup_printf ("%d", note->y);
-#ifdef GDK_WINDOWING_X11
-        if (GDK_IS_X11_DISPLAY(display))
-        {
-            gulong xid = GDK_WINDOW_XID (gtk_widget_get_window (note->w_window));
-            WnckWindow *wnck_win = wnck_window_get (xid);
-
-            if (!g_settings_get_boolean (stickynotes->settings, "sticky") && wnck_win)
-                note->workspace = 1 +
-                    wnck_workspace_get_number (wnck_window_get_workspace (wnck_win));
-            else
-                note->workspace = 0;
-        }
-#endif
-        /* Retrieve the title of the note */
-        title = gtk_label_get_text (GTK_LABEL (note->w_title));
-
-        /* Retrieve body contents of the note */
-        buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (note->w_body));
-
-        gtk_text_buffer_get_bounds (buffer, &start, &end);
-        body = gtk_text_iter_get_text (&start, &end);
-
-        /* Save the note as a node in the XML document */
-        {
-            xmlNodePtr node = xmlNewTextChild (root, NULL,
-                                               XML_CHAR ("note"),
-                                               XML_CHAR (body));
-
-            xmlNewProp (node, XML_CHAR ("title"),
-                        XML_CHAR (title));
-
-            if (note->color)
-                xmlNewProp (node, XML_CHAR ("color"),
-                            XML_CHAR (note->color));
-
-            if (note->font_color)
-                xmlNewProp (node, XML_CHAR ("font_color"),
-                            XML_CHAR (note->font_color));
-
-            if (note->font)
-                xmlNewProp (node, XML_CHAR ("font"),
-                            XML_CHAR (note->font));
-
-            if (note->locked)
-                xmlNewProp (node, XML_CHAR ("locked"),
-                            XML_CHAR ("true"));
-
-            xmlNewProp (node, XML_CHAR ("x"), XML_CHAR (x_str));
-            xmlNewProp (node, XML_CHAR ("y"), XML_CHAR (y_str));
-            xmlNewProp (node, XML_CHAR ("w"), XML_CHAR (w_str));
-            xmlNewProp (node, XML_CHAR ("h"), XML_CHAR (h_str));
-            if (note->workspace > 0) {
-                char *workspace_str;
-
-                workspace_str = g_strdup_printf ("%i", note->workspace);
-                xmlNewProp (node, XML_CHAR ("workspace"), XML_CHAR (workspace_str));
-                g_free (workspace_str);
-            }
-        }
+    save_finished ();
+}
+
+static void
+save_done_cb (GObject      *source,
+              GAsyncResult *result,
+              gpointer      data)
+{
+    GByteArray *snapshot = save_snapshot;
+    GError *error = NULL;
+
+    save_snapshot = NULL;
+
+    /* A failed save leaves the file and its snapshot as they were */
+    if (!g_file_replace_contents_finish (G_FILE (source), result, NULL, &error)) {
+        g_warning ("Failed to save the sticky notes: %s", error->message);
+        g_error_free (error);
+        g_byte_array_unref (snapshot);
+        save_finished ();
+        return;
+    }
+
+    stickynotes_snapshot_write (snapshot, G_FILE (source), snapshot_done_cb, NULL);
+}
+
+/* Save all sticky notes in an XML configuration file */
+gboolean
+stickynotes_save_now (void)
+{
+    GFile *file;
+    GString *contents;
+    GBytes *bytes;
+    gboolean sticky;
+    GList *l;
+
+    /* Saving before the file was read would drop its notes */
+    stickynotes_applet_load ();
+
+    /* This save is the pending one */
+    if (stickynotes->save_timeout_id) {
+        g_source_remove (stickynotes->save_timeout_id);
+        stickynotes->save_timeout_id = 0;
+    }
 
-        /* Now that it has been saved, reset the modified flag */
-        gtk_text_buffer_set_modified (buffer, FALSE);
+    if (save_in_flight) {
+        save_again = TRUE;
+        return FALSE;
+    }
+
+    contents = g_string_new ("<?xml version=\"1.0\"?>\n"
+                             "<stickynotes version=\"" VERSION "\">\n");
 
-        g_free (x_str);
-        g_free (y_str);
-        g_free (w_str);
-        g_free (h_str);
-        g_free (body);
+    sticky = g_settings_get_boolean (stickynotes->settings, "sticky");
+    save_snapshot = stickynotes_snapshot_new ();
+
+    /* For all sticky notes */
+    for (l = stickynotes->notes; l; l = l->next) {
+
+        /* Access the current note in the list */
+        StickyNote *note = l->data;
+        StickyNoteRecord record;
+
+        /* The workspace is followed as wnck reports it */
+        if (sticky)
+            note->workspace = 0;
+        /* Save the note as a node in the XML file.  The attributes are
+           short and written anew, only a changed body is escaped again. */
+        g_string_append (contents, "  <note");
+        append_attribute (contents, "title",
+                          gtk_label_get_text (GTK_LABEL (note->w_title)));
+        if (note->color)
+            append_attribute (contents, "color", note->color);
+        if (note->font_color)
+            append_attribute (contents, "font_color", note->font_color);
+        if (note->font)
+            append_attribute (contents, "font", note->font);
+        if (note->locked)
+            append_attribute (contents, "locked", "true");
+        g_string_append_printf (contents, " x=\"%d\" y=\"%d\" w=\"%d\" h=\"%d\"",
+                                note->x, note->y, note->w, note->h);
+        if (note->workspace > 0)
+            g_string_append_printf (contents, " workspace=\"%i\"",
+                                    note->workspace);
+        g_string_append_c (contents, '>');
+        record.body = stickynote_update_body (note);
+        g_string_append (contents, note->body_xml);
+        g_string_append (contents, "</note>\n");
+
+        /* The same note for the snapshot, the body not escaped */
+        record.x = note->x;
+        record.y = note->y;
+        record.w = note->w;
+        record.h = note->h;
+        record.workspace = note->workspace;
+        record.locked = note->locked;
+        record.title = gtk_label_get_text (GTK_LABEL (note->w_title));
+        record.color = note->color;
+        record.font_color = note->font_color;
+        record.font = note->font;
+        stickynotes_snapshot_add_note (save_snapshot, &record);
     }
 
+    g_string_append (contents, "</stickynotes>\n");
+
     /* The XML file is $HOME/.config/mate/stickynotes-applet,
        most probably */
     {
         gchar* path = g_build_filename (g_get_user_config_dir (),
                                         "mate", NULL);
-        gchar* file = g_build_filename (path, "stickynotes-applet.xml",
-                                        NULL);
+        gchar* filename = g_build_filename (path, "stickynotes-applet.xml",
+                                            NULL);
         g_mkdir_with_parents (path, S_IRWXU);
         g_free (path);
 
-        xmlSaveFormatFile (file, doc, 1);
-
-        g_free (file);
+        file = g_file_new_for_path (filename);
+        g_free (filename);
     }
 
-    xmlFreeDoc (doc);
-
-    save_scheduled = FALSE;
+    /* The snapshot is written to a temporary file in a worker thread,
+       which then replaces the old file, so a crash never leaves half a
+       file behind */
+    bytes = g_string_free_to_bytes (contents);
+    save_in_flight = TRUE;
+    g_file_replace_contents_bytes_async (file, bytes, NULL, FALSE,
+                                         G_FILE_CREATE_PRIVATE, NULL,
+                                         save_done_cb, NULL);
+    g_bytes_unref (bytes);
+    g_object_unref (file);
 
     return FALSE;
 }
 
+/* Save all sticky notes and wait until they are written */
+void
+stickynotes_save_wait (void)
+{
+    stickynotes_save_now ();
+
+    while (save_in_flight)
+        g_main_context_iteration (NULL, TRUE);
+}
+
 void
 stickynotes_save (void)
 {
     /* If a save isn't already scheduled, save everything a minute from now. */
-    if (!save_scheduled) {
-        g_timeout_add_seconds (60, (GSourceFunc) stickynotes_save_now, NULL);
-        save_scheduled = TRUE;
+    if (!stickynotes->save_timeout_id) {
+        stickynotes->save_time = g_get_monotonic_time () +
+                                 STICKYNOTES_SAVE_DELAY * G_USEC_PER_SEC;
+        stickynotes->save_limit = stickynotes->save_time;
+        save_arm ();
+    }
+}
+
+/* Load a sticky note from the note element the reader is on */
+static StickyNote *
+stickynote_load (GdkScreen        *screen,
+                 xmlTextReaderPtr  reader)
+{
+    StickyNote *note;
+    int x, y, w, h;
+
+    /* Retrieve and set the window size of the note */
+    {
+        gchar *w_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("w"));
+        gchar *h_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("h"));
+        if (w_str && h_str) {
+            w = atoi (w_str);
+            h = atoi (h_str);
+        } else {
+            w = 0;
+            h = 0;
+        }
+
+        xmlFree (w_str);
+        xmlFree (h_str);
+    }
+
+    /* Retrieve and set the window position of the note */
+    {
+        gchar *x_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("x"));
+        gchar *y_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("y"));
+
+        if (x_str && y_str) {
+            x = atoi (x_str);
+            y = atoi (y_str);
+        } else {
+            x = -1;
+            y = -1;
+        }
+
+        xmlFree (x_str);
+        xmlFree (y_str);
+    }
+
+    /* Create a new note */
+    note = stickynote_new_aux (screen, x, y, w, h);
+
+    /* Retrieve and set title of the note */
+    {
+        gchar *title = (gchar *)xmlTextReaderGetAttribute (reader,
+                                                           XML_CHAR ("title"));
+        if (title)
+            stickynote_set_title (note, title);
+
+        xmlFree (title);
+    }
+
+    /* Retrieve and set the color of the note */
+    {
+        gchar *color_str;
+        gchar *font_color_str;
+
+        color_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("color"));
+        font_color_str = (gchar *)xmlTextReaderGetAttribute (reader, XML_CHAR ("font_color"));
+
+        if (color_str || font_color_str)
+            stickynote_set_color (note,
+                                  color_str,
+                                  font_color_str,
+                                  TRUE);
+
+        xmlFree (color_str);
+        xmlFree (font_color_str);
+    }
+
+    /* Retrieve and set the font of the note */
+    {
+        gchar *font_str = (gchar *)xmlTextReaderGetAttribute (reader,
+                                                              XML_CHAR ("font"));
+        if (font_str)
+            stickynote_set_font (note, font_str, TRUE);
+
+        xmlFree (font_str);
+    }
+
+    /* Retrieve the workspace */
+    {
+        char *workspace_str;
+
+        workspace_str = (gchar *)xmlTextReaderGetAttribute (reader,
+                                                            XML_CHAR ("workspace"));
+        if (workspace_str) {
+            note->workspace = atoi (workspace_str);
+            xmlFree (workspace_str);
+        }
+    }
+
+    /* Retrieve and set the locked state of the note,
+     * by default unlocked */
+    {
+        gchar *locked = (gchar *)xmlTextReaderGetAttribute (reader,
+                                                            XML_CHAR ("locked"));
+        if (locked)
+            stickynote_set_locked (note,
+                                   !strcmp (locked,
+                                   "true"));
+        xmlFree (locked);
+    }
+
+    /* Retrieve (if any) the body contents of the note.  They only go
+     * into the text buffer once the note is shown, until then the file
+     * keeps getting them as they were read. */
+    {
+        gchar *body = NULL;
+
+        if (!xmlTextReaderIsEmptyElement (reader))
+            body = (gchar *)xmlTextReaderReadString (reader);
+
+        if (body && *body) {
+            note->body_pending = g_strdup (body);
+            note->body_xml = g_markup_escape_text (body, -1);
+        }
+        xmlFree (body);
+    }
+
+    return note;
+}
+
+/* Load a sticky note from a record of the snapshot, as from the XML
+   element it was written with */
+static StickyNote *
+stickynote_load_record (GdkScreen              *screen,
+                        const StickyNoteRecord *record)
+{
+    StickyNote *note;
+
+    note = stickynote_new_aux (screen, record->x, record->y, record->w, record->h);
+
+    if (record->title)
+        stickynote_set_title (note, record->title);
+    if (record->color || record->font_color)
+        stickynote_set_color (note, record->color, record->font_color, TRUE);
+    if (record->font)
+        stickynote_set_font (note, record->font, TRUE);
+    note->workspace = record->workspace;
+    if (record->locked)
+        stickynote_set_locked (note, TRUE);
+
+    /* Escaped for the file by the next save */
+    if (record->body && *record->body)
+        note->body_pending = g_strdup (record->body);
+
+    return note;
+}
+
+/* Load the notes from the snapshot of file, FALSE if it has none that
+   is up to date */
+static gboolean
+stickynotes_load_snapshot (GdkScreen    *screen,
+                           const gchar  *file,
+                           GList       **new_notes)
+{
+    StickyNotesSnapshot *snapshot;
+    GFile *xml_file;
+    guint i;
+
+    xml_file = g_file_new_for_path (file);
+    snapshot = stickynotes_snapshot_open (xml_file);
+    g_object_unref (xml_file);
+
+    if (!snapshot)
+        return FALSE;
+
+    for (i = 0; i < stickynotes_snapshot_get_length (snapshot); i++)
+        *new_notes = g_list_prepend (*new_notes,
+                                     stickynote_load_record (screen,
+                                                             stickynotes_snapshot_get_note (snapshot, i)));
+
+    stickynotes_snapshot_free (snapshot);
+
+    return TRUE;
+}
+
+/* Load the notes of the XML file the reader is on */
+static void
+stickynotes_load_xml (GdkScreen         *screen,
+                      xmlTextReaderPtr   reader,
+                      GList            **new_notes)
+{
+    gboolean have_root = FALSE;
+    int ret;
+
+    /* The file is read one element at a time, without building a tree.
+     * For all children of the root node (ie all sticky notes) */
+    while ((ret = xmlTextReaderRead (reader)) == 1) {
+        const xmlChar *name;
+
+        if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT)
+            continue;
+
+        name = xmlTextReaderConstName (reader);
+
+        if (xmlTextReaderDepth (reader) == 0) {
+            have_root = !xmlStrcmp (name, XML_CHAR ("stickynotes"));
+            if (!have_root)
+                break;
+        } else if (xmlTextReaderDepth (reader) == 1 &&
+                   !xmlStrcmp (name, XML_CHAR ("note"))) {
+            *new_notes = g_list_prepend (*new_notes,
+                                         stickynote_load (screen, reader));
+        }
     }
+
+    /* If the XML file is corrupted/incorrect, create a blank one, but
+     * keep the notes read before the damage */
+    if (!have_root || ret < 0)
+        stickynotes_save ();
 }
 
-/* Load all sticky notes from an XML configuration file */
+/* Load all sticky notes from an XML configuration file, or from its
+   snapshot while that is up to date */
 void
 stickynotes_load (GdkScreen *screen)
 {
-    xmlDocPtr doc = NULL;
-    xmlNodePtr root;
-    xmlNodePtr node;
+    xmlTextReaderPtr reader = NULL;
     GList *new_notes, *tmp1;  /* Lists of StickyNote*'s */
-    GList *new_nodes; /* Lists of xmlNodePtr's */
-    int x, y, w, h;
+    gboolean from_snapshot = FALSE;
 #ifdef GDK_WINDOWING_X11
     GdkDisplay *display = gdk_screen_get_display (gdk_screen_get_default());
 #endif
@@ -975,9 +1288,13 @@ stickynotes_load (GdkScreen *screen)
     gchar* file = g_build_filename (g_get_user_config_dir (),
                                     "mate", "stickynotes-applet.xml", NULL);
 
+    new_notes = NULL;
+
     if (g_file_test (file, G_FILE_TEST_EXISTS)) {
-        /* load file */
-        doc = xmlParseFile (file);
+        /* The snapshot saves parsing the file */
+        from_snapshot = stickynotes_load_snapshot (screen, file, &new_notes);
+        if (!from_snapshot)
+            reader = xmlReaderForFile (file, NULL, 0);
     } else {
         /* old one */
         g_free (file);
@@ -987,158 +1304,24 @@ stickynotes_load (GdkScreen *screen)
 
         if (g_file_test (file, G_FILE_TEST_EXISTS)) {
             /* load file */
-            doc = xmlParseFile (file);
+            reader = xmlReaderForFile (file, NULL, 0);
         }
     }
     g_free (file);
 
-    /* If the XML file does not exist, create a blank one */
-    if (!doc) {
-        stickynotes_save ();
-        return;
-    }
-
-    /* If the XML file is corrupted/incorrect, create a blank one */
-    root = xmlDocGetRootElement (doc);
-    if (!root || xmlStrcmp (root->name, XML_CHAR ("stickynotes"))) {
-        xmlFreeDoc (doc);
+    if (reader) {
+        stickynotes_load_xml (screen, reader, &new_notes);
+        xmlFreeTextReader (reader);
+    } else if (!from_snapshot) {
+        /* If the XML file does not exist, create a blank one */
         stickynotes_save ();
         return;
     }
 
-    node = root->xmlChildrenNode;
-
-    /* For all children of the root node (ie all sticky notes) */
-    new_notes = NULL;
-    new_nodes = NULL;
-    while (node) {
-        if (!xmlStrcmp (node->name, (const xmlChar *) "note")) {
-            StickyNote *note;
-
-            /* Retrieve and set the window size of the note */
-            {
-                gchar *w_str = (gchar *)xmlGetProp (node, XML_CHAR ("w"));
-                gchar *h_str = (gchar *)xmlGetProp (node, XML_CHAR ("h"));
-                if (w_str && h_str) {
-                    w = atoi (w_str);
-                    h = atoi (h_str);
-                } else {
-                    w = 0;
-                    h = 0;
-                }
-
-                g_free (w_str);
-                g_free (h_str);
-            }
-
-            /* Retrieve and set the window position of the note */
-            {
-                gchar *x_str = (gchar *)xmlGetProp (node, XML_CHAR ("x"));
-                gchar *y_str = (gchar *)xmlGetProp (node, XML_CHAR ("y"));
-
-                if (x_str && y_str) {
-                    x = atoi (x_str);
-                    y = atoi (y_str);
-                } else {
-                    x = -1;
-                    y = -1;
-                }
-
-                g_free (x_str);
-                g_free (y_str);
-            }
-
-            /* Create a new note */
-            note = stickynote_new_aux (screen, x, y, w, h);
-            stickynotes->notes = g_list_append (stickynotes->notes,
-                                                note);
-            new_notes = g_list_append (new_notes, note);
-            new_nodes = g_list_append (new_nodes, node);
-
-            /* Retrieve and set title of the note */
-            {
-                gchar *title = (gchar *)xmlGetProp (node,
-                                                    XML_CHAR ("title"));
-                if (title)
-                    stickynote_set_title (note, title);
-
-                g_free (title);
-            }
-
-            /* Retrieve and set the color of the note */
-            {
-                gchar *color_str;
-                gchar *font_color_str;
-
-                color_str = (gchar *)xmlGetProp (node, XML_CHAR ("color"));
-                font_color_str = (gchar *)xmlGetProp (node, XML_CHAR ("font_color"));
-
-                if (color_str || font_color_str)
-                    stickynote_set_color (note,
-                                          color_str,
-                                          font_color_str,
-                                          TRUE);
-
-                g_free (color_str);
-                g_free (font_color_str);
-            }
-
-            /* Retrieve and set the font of the note */
-            {
-                gchar *font_str = (gchar *)xmlGetProp (node,
-                                                       XML_CHAR ("font"));
-                if (font_str)
-                    stickynote_set_font (note, font_str, TRUE);
-
-                g_free (font_str);
-            }
-
-            /* Retrieve the workspace */
-            {
-                char *workspace_str;
-
-                workspace_str = (gchar *)xmlGetProp (node,
-                                                     XML_CHAR ("workspace"));
-                if (workspace_str) {
-                    note->workspace = atoi (workspace_str);
-                    g_free (workspace_str);
-                }
-            }
-
-            /* Retrieve and set (if any) the body contents of the
-             * note */
-            {
-                gchar *body = (gchar *)xmlNodeListGetString (doc,
-                                                             node->xmlChildrenNode,
-                                                              1);
-                if (body) {
-                    GtkTextBuffer *buffer;
-                    GtkTextIter start, end;
-
-                    buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (note->w_body));
-                    gtk_text_buffer_get_bounds (buffer,
-                                                &start, &end);
-                    gtk_text_buffer_insert (buffer,
-                                            &start, body, -1);
-                }
-                g_free (body);
-            }
-
-            /* Retrieve and set the locked state of the note,
-             * by default unlocked */
-            {
-                gchar *locked = (gchar *)xmlGetProp (node,
-                                                     XML_CHAR ("locked"));
-                if (locked)
-                    stickynote_set_locked (note,
-                                           !strcmp (locked,
-                                           "true"));
-                g_free (locked);
-            }
-        }
-
-        node = node->next;
-    }
+    /* Appending the notes one by one would walk the list each time */
+    new_notes = g_list_reverse (new_notes);
+    stickynotes->notes = g_list_concat (stickynotes->notes,
+                                        g_list_copy (new_notes));
 
     tmp1 = new_notes;
 
@@ -1157,7 +1340,4 @@ stickynotes_load (GdkScreen *screen)
     }
 
     g_list_free (new_notes);
-    g_list_free (new_nodes);
-
-    xmlFreeDoc (doc);
 }
@@ -60,6 +60,9 @@ typedef struct
     gchar *color;                         /* Note color */
     gchar *font_color;                    /* Font color */
     gchar *font;                          /* Note font */
+    gchar *body_text;                     /* Body as last saved */
+    gchar *body_xml;                      /* Body as last saved, escaped */
+    gchar *body_pending;                  /* Body loaded but not shown yet */
     gboolean locked;                      /* Note locked state */
 
     gint x;                               /* Note x-coordinate */
@@ -68,6 +71,7 @@ typedef struct
     gint h;                               /* Note height */
 
     int workspace;                        /* Workspace the note is on */
+    WnckWindow *wnck_window;              /* The note window as wnck sees it */
 
 } StickyNote;
 
@@ -96,6 +100,7 @@ void stickynotes_add (GdkScreen *screen);
 void stickynotes_remove (StickyNote *note);
 void stickynotes_save (void);
 gboolean stickynotes_save_now (void);
+void stickynotes_save_wait (void);
 void stickynotes_load (GdkScreen *screen);
 
 #endif /* __STICKYNOTES_H__ */
@@ -22,6 +22,7 @@
 #include "stickynotes_applet.h"
 #include "stickynotes_applet_callbacks.h"
 #include "stickynotes.h"
+#include "common/applet-startup.h"
 
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
@@ -34,6 +35,9 @@ static const GtkActionEntry stickynotes_applet_menu_actions[] =
     { "new_note", "document-new", N_("_New Note"),
       NULL, NULL,
       G_CALLBACK (menu_new_note_cb) },
+    { "find_note", "edit-find", N_("_Find Note..."),
+      NULL, NULL,
+      G_CALLBACK (menu_find_note_cb) },
     { "hide_notes", NULL, N_("Hi_de Notes"),
       NULL, NULL,
       G_CALLBACK (menu_hide_notes_cb) },
@@ -58,6 +62,12 @@ static const GtkToggleActionEntry stickynotes_applet_menu_toggle_actions[] =
       G_CALLBACK (menu_toggle_lock_cb), FALSE }
 };
 
+static void
+stickynotes_applet_load_cb (gpointer data)
+{
+    stickynotes_applet_load ();
+}
+
 /* Sticky Notes applet factory */
 static gboolean
 stickynotes_applet_factory (MatePanelApplet *mate_panel_applet,
@@ -65,6 +75,8 @@ stickynotes_applet_factory (MatePanelApplet *mate_panel_applet,
                             gpointer         data)
 {
     if (!strcmp (iid, "StickyNotesApplet")) {
+        applet_startup_mark ("stickynotes factory");
+
         if (!stickynotes)
             stickynotes_applet_init (mate_panel_applet);
 
@@ -77,6 +89,13 @@ stickynotes_applet_factory (MatePanelApplet *mate_panel_applet,
         stickynotes_applet_update_menus ();
         stickynotes_applet_update_tooltips ();
 
+        /* the notes are read after the first frame of any of the applets */
+        if (!stickynotes->loaded)
+            applet_startup_defer (GTK_WIDGET (mate_panel_applet), "stickynotes",
+                                  stickynotes_applet_load_cb, NULL);
+
+        applet_startup_mark ("stickynotes constructed");
+
         return TRUE;
     }
 
@@ -173,7 +192,8 @@ stickynotes_applet_init (MatePanelApplet *mate_panel_applet)
 
     stickynotes->notes = NULL;
     stickynotes->applets = NULL;
-    stickynotes->last_timeout_data = 0;
+    stickynotes->save_timeout_id = 0;
+    stickynotes->loaded = FALSE;
 
     size = mate_panel_applet_get_size (mate_panel_applet);
     scale = gtk_widget_get_scale_factor (GTK_WIDGET (mate_panel_applet));
@@ -233,12 +253,23 @@ stickynotes_applet_init (MatePanelApplet *mate_panel_applet)
 
     stickynotes->max_height = (int) (0.8 * (double) screen_height);
 
-    /* Load sticky notes */
-    stickynotes_load (screen);
-
     install_check_click_on_desktop (screen);
 }
 
+/* Load sticky notes, once */
+void
+stickynotes_applet_load (void)
+{
+    if (stickynotes->loaded)
+        return;
+
+    stickynotes->loaded = TRUE;
+    stickynotes_load (gdk_screen_get_default ());
+
+    stickynotes_applet_update_menus ();
+    stickynotes_applet_update_tooltips ();
+}
+
 void
 stickynotes_applet_init_prefs (void)
 {
@@ -384,6 +415,7 @@ stickynotes_applet_new (MatePanelApplet *mate_panel_applet)
     applet->w_applet = GTK_WIDGET (mate_panel_applet);
     applet->w_image = gtk_image_new ();
     applet->destroy_all_dialog = NULL;
+    applet->find_dialog = NULL;
     applet->prelighted = FALSE;
 
     applet->menu_tip = NULL;
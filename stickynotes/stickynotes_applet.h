@@ -60,9 +60,14 @@ typedef struct
     GSettings *settings;    /* Shared GSettings */
 
     gint max_height;
-    guint last_timeout_data;
+
+    guint save_timeout_id;  /* The one timer of the pending save */
+    gint64 save_armed;      /* When the timer fires */
+    gint64 save_time;       /* When the pending save is due */
+    gint64 save_limit;      /* The latest it may be put off to */
 
     gboolean visible;    /* Toggle show/hide notes */
+    gboolean loaded;     /* The notes of the file were read */
 } StickyNotes;
 
 /* Sticky Notes Applet */
@@ -72,6 +77,7 @@ typedef struct
     GtkWidget *w_image;     /* The applet icon */
 
     GtkWidget *destroy_all_dialog;    /* The applet it's destroy all dialog */
+    GtkWidget *find_dialog;           /* The applet it's find note dialog */
 
     gboolean prelighted;    /* Whether applet is prelighted */
 
@@ -93,6 +99,7 @@ typedef enum
 extern StickyNotes *stickynotes;
 
 void stickynotes_applet_init (MatePanelApplet *mate_panel_applet);
+void stickynotes_applet_load (void);
 void stickynotes_applet_init_prefs (void);
 
 StickyNotesApplet * stickynotes_applet_new (MatePanelApplet *mate_panel_applet);
@@ -21,6 +21,7 @@
 #include <string.h>
 #include "stickynotes_applet_callbacks.h"
 #include "stickynotes.h"
+#include "stickynotes_index.h"
 #include <gdk/gdkkeysyms.h>
 #include <X11/Xatom.h>
 #include <gdk/gdkx.h>
@@ -280,11 +281,14 @@ applet_destroy_cb (MatePanelApplet   *mate_panel_applet,
 {
     GList *notes;
 
-    stickynotes_save_now ();
+    stickynotes_save_wait ();
 
     if (applet->destroy_all_dialog != NULL)
         gtk_widget_destroy (applet->destroy_all_dialog);
 
+    if (applet->find_dialog != NULL)
+        gtk_widget_destroy (applet->find_dialog);
+
     if (applet->action_group)
         g_object_unref (applet->action_group);
 
@@ -294,11 +298,8 @@ applet_destroy_cb (MatePanelApplet   *mate_panel_applet,
 
     if (stickynotes->applets == NULL) {
         notes = stickynotes->notes;
-        while (notes) {
-            StickyNote *note = notes->data;
-            stickynote_free (note);
-            notes = g_list_next (notes);
-        }
+        stickynotes->notes = NULL;
+        g_list_free_full (notes, (GDestroyNotify) stickynote_free);
     }
 }
 
@@ -309,11 +310,9 @@ destroy_all_response_cb (GtkDialog         *dialog,
                          StickyNotesApplet *applet)
 {
     if (id == GTK_RESPONSE_OK) {
-        while (g_list_length (stickynotes->notes) > 0) {
-            StickyNote *note = g_list_nth_data (stickynotes->notes, 0);
-            stickynote_free (note);
-            stickynotes->notes = g_list_remove (stickynotes->notes, note);
-        }
+        g_list_free_full (stickynotes->notes,
+                          (GDestroyNotify) stickynote_free);
+        stickynotes->notes = NULL;
     }
 
     stickynotes_applet_update_tooltips ();
@@ -331,6 +330,105 @@ menu_new_note_cb (GtkAction         *action,
     popup_add_note (applet, NULL);
 }
 
+/* Find note Callback : Lists the notes matching the search */
+static void
+find_changed_cb (GtkSearchEntry *entry,
+                 GtkListBox     *list)
+{
+    GList *children, *notes, *l;
+
+    children = gtk_container_get_children (GTK_CONTAINER (list));
+    for (l = children; l; l = l->next)
+        gtk_widget_destroy (l->data);
+    g_list_free (children);
+
+    notes = stickynotes_index_search (gtk_entry_get_text (GTK_ENTRY (entry)));
+    for (l = notes; l; l = l->next) {
+        StickyNote *note = l->data;
+        GtkWidget *label;
+
+        label = gtk_label_new (gtk_label_get_text (GTK_LABEL (note->w_title)));
+        gtk_label_set_xalign (GTK_LABEL (label), 0.0);
+        gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_END);
+        g_object_set (label, "margin", 6, NULL);
+        g_object_set_data (G_OBJECT (label), "stickynote", note);
+
+        gtk_list_box_insert (list, label, -1);
+        gtk_widget_show (label);
+    }
+    g_list_free (notes);
+}
+
+/* Find note Callback : Shows the note of a row */
+static void
+find_row_activated_cb (GtkListBox    *list,
+                       GtkListBoxRow *row,
+                       gpointer       data)
+{
+    StickyNote *note;
+
+    note = g_object_get_data (G_OBJECT (gtk_bin_get_child (GTK_BIN (row))),
+                              "stickynote");
+
+    /* The note may have been deleted since the search */
+    if (note && g_list_find (stickynotes->notes, note))
+        stickynote_set_visible (note, TRUE);
+}
+
+/* Find note Callback : Closes the dialog */
+static void
+find_response_cb (GtkDialog         *dialog,
+                  gint               id,
+                  StickyNotesApplet *applet)
+{
+    gtk_widget_destroy (GTK_WIDGET (dialog));
+    applet->find_dialog = NULL;
+}
+
+/* Menu Callback : Find a note */
+void
+menu_find_note_cb (GtkAction         *action,
+                   StickyNotesApplet *applet)
+{
+    GtkBuilder *builder;
+    GObject *entry, *list;
+
+    if (applet->find_dialog != NULL) {
+        gtk_window_set_screen (GTK_WINDOW (applet->find_dialog),
+                               gtk_widget_get_screen (GTK_WIDGET (applet->w_applet)));
+
+        gtk_window_present (GTK_WINDOW (applet->find_dialog));
+        return;
+    }
+
+    builder = gtk_builder_new ();
+    gtk_builder_add_from_resource (builder,
+                                   GRESOURCE "sticky-notes-find.ui",
+                                   NULL);
+
+    applet->find_dialog = GTK_WIDGET (gtk_builder_get_object (builder,
+                                                              "find_dialog"));
+    entry = gtk_builder_get_object (builder, "find_entry");
+    list = gtk_builder_get_object (builder, "find_list");
+
+    g_object_unref (builder);
+
+    g_signal_connect (entry, "search-changed",
+                      G_CALLBACK (find_changed_cb),
+                      list);
+    g_signal_connect (list, "row-activated",
+                      G_CALLBACK (find_row_activated_cb),
+                      NULL);
+    g_signal_connect (applet->find_dialog, "response",
+                      G_CALLBACK (find_response_cb),
+                      applet);
+
+    gtk_window_set_screen (GTK_WINDOW (applet->find_dialog),
+                           gtk_widget_get_screen (applet->w_applet));
+
+    gtk_widget_show_all (applet->find_dialog);
+}
+
 /* Menu Callback : Hide Notes */
 void
 menu_hide_notes_cb (GtkAction         *action,
@@ -594,37 +692,7 @@ preferences_apply_cb (GSettings *settings,
         stickynotes_save ();
     }
 
-    else if (!strcmp (key, "use-system-color") ||
-        !strcmp (key, "default-color")) {
-            for (l = stickynotes->notes; l; l = l->next) {
-                note = l->data;
-                stickynote_set_color (note,
-                                      note->color,
-                                      note->font_color,
-                                      FALSE);
-            }
-    }
-
-    else if (!strcmp (key, "use-system-font") ||
-        !strcmp (key, "default-font")) {
-            for (l = stickynotes->notes; l; l = l->next) {
-                note = l->data;
-                stickynote_set_font (note, note->font, FALSE);
-            }
-    }
-
-    else if (!strcmp (key, "force-default")) {
-        for (l = stickynotes->notes; l; l = l->next) {
-            note = l->data;
-            stickynote_set_color (note,
-                                  note->color,
-                                  note->font_color,
-                                  FALSE);
-            stickynote_set_font (note,
-                                 note->font,
-                                 FALSE);
-        }
-    }
+    /* the colors and fonts follow their keys in stickynotes_style.c */
 
     stickynotes_applet_update_prefs ();
     stickynotes_applet_update_menus ();
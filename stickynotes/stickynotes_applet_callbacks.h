@@ -62,6 +62,9 @@ void
 menu_new_note_cb (GtkAction         *action,
                   StickyNotesApplet *applet);
 void
+menu_find_note_cb (GtkAction         *action,
+                   StickyNotesApplet *applet);
+void
 menu_hide_notes_cb (GtkAction         *action,
                     StickyNotesApplet *applet);
 void
@@ -0,0 +1,243 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "stickynotes.h"
+#include "stickynotes_index.h"
+
+/* folded word -> set of StickyNote*'s */
+static GHashTable *index_words = NULL;
+/* StickyNote* -> the words it was indexed with */
+static GHashTable *index_notes = NULL;
+/* set of StickyNote*'s to index again */
+static GHashTable *index_dirty = NULL;
+/* the keys of index_words in strcmp() order, so that the words starting
+   with a term are found by a binary search; NULL once a word came or
+   went, and sorted again by the next search */
+static GPtrArray *index_sorted = NULL;
+
+static void
+index_init (void)
+{
+    if (index_words)
+        return;
+
+    index_words = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free,
+                                         (GDestroyNotify) g_hash_table_destroy);
+    index_notes = g_hash_table_new_full (NULL, NULL, NULL,
+                                         (GDestroyNotify) g_strfreev);
+    index_dirty = g_hash_table_new (NULL, NULL);
+}
+
+static void
+index_add_words (StickyNote  *note,
+                 gchar      **words)
+{
+    for (; words && *words; words++) {
+        GHashTable *notes = g_hash_table_lookup (index_words, *words);
+
+        if (!notes) {
+            notes = g_hash_table_new (NULL, NULL);
+            g_hash_table_insert (index_words, g_strdup (*words), notes);
+            g_clear_pointer (&index_sorted, g_ptr_array_unref);
+        }
+        g_hash_table_add (notes, note);
+    }
+}
+
+/* Takes the words of a note out of the index */
+static void
+index_unindex (StickyNote *note)
+{
+    gchar **words = g_hash_table_lookup (index_notes, note);
+
+    for (; words && *words; words++) {
+        GHashTable *notes = g_hash_table_lookup (index_words, *words);
+
+        if (notes && g_hash_table_remove (notes, note) &&
+            g_hash_table_size (notes) == 0) {
+            g_hash_table_remove (index_words, *words);
+            g_clear_pointer (&index_sorted, g_ptr_array_unref);
+        }
+    }
+
+    g_hash_table_remove (index_notes, note);
+}
+
+/* Indexes the title and body of a note again */
+static void
+index_note (StickyNote *note)
+{
+    GString *text;
+    gchar **words, **alternates;
+    gchar **all;
+    guint n_words, n_alternates;
+
+    index_unindex (note);
+
+    text = g_string_new (gtk_label_get_text (GTK_LABEL (note->w_title)));
+    g_string_append_c (text, '\n');
+
+    if (note->body_pending) {
+        g_string_append (text, note->body_pending);
+    } else {
+        GtkTextIter start, end;
+        gchar *body;
+
+        gtk_text_buffer_get_bounds (note->buffer, &start, &end);
+        body = gtk_text_iter_get_text (&start, &end);
+        g_string_append (text, body);
+        g_free (body);
+    }
+
+    /* The ASCII alternates have "café" found by "cafe" as well */
+    words = g_str_tokenize_and_fold (text->str, NULL, &alternates);
+    g_string_free (text, TRUE);
+
+    n_words = g_strv_length (words);
+    n_alternates = g_strv_length (alternates);
+    all = g_renew (gchar *, words, n_words + n_alternates + 1);
+    memcpy (all + n_words, alternates, (n_alternates + 1) * sizeof (gchar *));
+    g_free (alternates);
+
+    index_add_words (note, all);
+    g_hash_table_insert (index_notes, note, all);
+}
+
+void
+stickynotes_index_update (StickyNote *note)
+{
+    index_init ();
+    g_hash_table_add (index_dirty, note);
+}
+
+void
+stickynotes_index_remove (StickyNote *note)
+{
+    if (!index_words)
+        return;
+
+    g_hash_table_remove (index_dirty, note);
+    index_unindex (note);
+}
+
+static gint
+index_compare_words (gconstpointer a,
+                     gconstpointer b)
+{
+    return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* The first of the sorted words that is not before term: the words
+   starting with term follow it */
+static guint
+index_lower_bound (const gchar *term)
+{
+    guint low = 0, high = index_sorted->len;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+
+        if (strcmp (g_ptr_array_index (index_sorted, mid), term) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+GList *
+stickynotes_index_search (const gchar *query)
+{
+    GHashTableIter iter;
+    GHashTable *found = NULL;
+    gchar **terms;
+    GList *result = NULL;
+    GList *l;
+    gpointer note;
+    gint i;
+
+    index_init ();
+
+    /* Index the notes changed since the last search */
+    g_hash_table_iter_init (&iter, index_dirty);
+    while (g_hash_table_iter_next (&iter, &note, NULL))
+        index_note (note);
+    g_hash_table_remove_all (index_dirty);
+
+    if (!index_sorted) {
+        GHashTableIter words_iter;
+        gpointer word;
+
+        index_sorted = g_ptr_array_sized_new (g_hash_table_size (index_words));
+        g_hash_table_iter_init (&words_iter, index_words);
+        while (g_hash_table_iter_next (&words_iter, &word, NULL))
+            g_ptr_array_add (index_sorted, word);
+        g_ptr_array_sort (index_sorted, index_compare_words);
+    }
+
+    terms = g_str_tokenize_and_fold (query, NULL, NULL);
+    if (!terms[0]) {
+        g_strfreev (terms);
+        return NULL;
+    }
+
+    /* Intersect the notes of all terms, each term matching every word
+       it is the start of */
+    for (i = 0; terms[i]; i++) {
+        GHashTable *matches = g_hash_table_new (NULL, NULL);
+        guint w;
+
+        for (w = index_lower_bound (terms[i]); w < index_sorted->len; w++) {
+            const gchar *word = g_ptr_array_index (index_sorted, w);
+            GHashTableIter notes_iter;
+            GHashTable *notes;
+
+            if (!g_str_has_prefix (word, terms[i]))
+                break;
+
+            notes = g_hash_table_lookup (index_words, word);
+            g_hash_table_iter_init (&notes_iter, notes);
+            while (g_hash_table_iter_next (&notes_iter, &note, NULL))
+                if (!found || g_hash_table_contains (found, note))
+                    g_hash_table_add (matches, note);
+        }
+
+        if (found)
+            g_hash_table_destroy (found);
+        found = matches;
+
+        if (g_hash_table_size (found) == 0)
+            break;
+    }
+
+    g_strfreev (terms);
+
+    for (l = stickynotes->notes; l; l = l->next)
+        if (g_hash_table_contains (found, l->data))
+            result = g_list_prepend (result, l->data);
+
+    g_hash_table_destroy (found);
+
+    return g_list_reverse (result);
+}
@@ -0,0 +1,35 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __STICKYNOTES_INDEX_H__
+#define __STICKYNOTES_INDEX_H__
+
+#include <stickynotes.h>
+
+/* A word index over the titles and bodies of all notes.  A note that
+   changes is only marked, and indexed again by the next search. */
+
+void stickynotes_index_update (StickyNote *note);
+void stickynotes_index_remove (StickyNote *note);
+
+/* Returns the notes with a word starting with each word of the query,
+   in the order of the notes list */
+GList * stickynotes_index_search (const gchar *query);
+
+#endif /* __STICKYNOTES_INDEX_H__ */
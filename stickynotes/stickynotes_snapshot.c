@@ -0,0 +1,397 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "stickynotes_snapshot.h"
+
+/* The file starts with a header, all numbers little endian:
+
+     magic            8 bytes, "STICKYSN"
+     version          u32
+     number of notes  u32
+     XML mtime        u64 seconds, u32 microseconds, u32 zero
+     XML size         u64
+
+   and then a record for each note, its length as a u32 and
+
+     x, y, w, h       i32
+     workspace        i32
+     flags            u32, 1 if locked
+     title, color, font color, font, body
+                      a u32 length, the UTF-8 bytes and a NUL, or
+                      only SNAPSHOT_NO_STRING for a missing one
+
+   A record may have more after the body in a later version, which this
+   one skips; a new version number is for changes it can not skip. */
+#define SNAPSHOT_MAGIC       "STICKYSN"
+#define SNAPSHOT_VERSION     1
+#define SNAPSHOT_HEADER_SIZE 40
+#define SNAPSHOT_NO_STRING   G_MAXUINT32
+
+#define SNAPSHOT_XML_ATTRIBUTES  G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+                                 G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+                                 G_FILE_ATTRIBUTE_STANDARD_SIZE
+
+struct _StickyNotesSnapshot
+{
+    GMappedFile *file;
+    GArray      *notes;  /* of StickyNoteRecord */
+};
+
+/* The cache is $HOME/.cache/mate-applets/stickynotes, most probably */
+static gchar *
+snapshot_get_path (void)
+{
+    return g_build_filename (g_get_user_cache_dir (), "mate-applets",
+                             "stickynotes", "notes.snapshot", NULL);
+}
+
+/* The modification time and size the snapshot is checked against */
+static gboolean
+snapshot_query_xml (GFile    *xml_file,
+                    guint64  *mtime,
+                    guint32  *mtime_usec,
+                    guint64  *size,
+                    GError  **error)
+{
+    GFileInfo *info;
+
+    info = g_file_query_info (xml_file, SNAPSHOT_XML_ATTRIBUTES,
+                              G_FILE_QUERY_INFO_NONE, NULL, error);
+    if (!info)
+        return FALSE;
+
+    *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    *mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    *size = (guint64) g_file_info_get_size (info);
+    g_object_unref (info);
+
+    return TRUE;
+}
+
+static guint32
+read_u32 (const gchar *p)
+{
+    guint32 value;
+
+    memcpy (&value, p, sizeof (value));
+
+    return GUINT32_FROM_LE (value);
+}
+
+static guint64
+read_u64 (const gchar *p)
+{
+    guint64 value;
+
+    memcpy (&value, p, sizeof (value));
+
+    return GUINT64_FROM_LE (value);
+}
+
+/* Reads a string at *p and moves past it, FALSE if it does not fit
+   before end */
+static gboolean
+read_string (const gchar  **p,
+             const gchar   *end,
+             const gchar  **string)
+{
+    guint32 length;
+
+    if (end - *p < 4)
+        return FALSE;
+
+    length = read_u32 (*p);
+    *p += 4;
+
+    if (length == SNAPSHOT_NO_STRING) {
+        *string = NULL;
+        return TRUE;
+    }
+
+    if ((gsize) (end - *p) <= length || (*p)[length] != '\0' ||
+        !g_utf8_validate (*p, length, NULL))
+        return FALSE;
+
+    *string = *p;
+    *p += length + 1;
+
+    return TRUE;
+}
+
+static gboolean
+read_record (const gchar      *p,
+             const gchar      *end,
+             StickyNoteRecord *record)
+{
+    if (end - p < 24)
+        return FALSE;
+
+    record->x = (gint32) read_u32 (p);
+    record->y = (gint32) read_u32 (p + 4);
+    record->w = (gint32) read_u32 (p + 8);
+    record->h = (gint32) read_u32 (p + 12);
+    record->workspace = (gint32) read_u32 (p + 16);
+    record->locked = (read_u32 (p + 20) & 1) != 0;
+    p += 24;
+
+    return read_string (&p, end, &record->title) &&
+           read_string (&p, end, &record->color) &&
+           read_string (&p, end, &record->font_color) &&
+           read_string (&p, end, &record->font) &&
+           read_string (&p, end, &record->body);
+}
+
+/* All the notes are decoded before any is used, so a damaged snapshot
+   is left for the XML file as a whole */
+StickyNotesSnapshot *
+stickynotes_snapshot_open (GFile *xml_file)
+{
+    StickyNotesSnapshot *snapshot;
+    GMappedFile *file;
+    const gchar *data, *p, *end;
+    guint64 mtime, size;
+    guint32 mtime_usec, n_notes, i;
+    gchar *path;
+
+    if (!snapshot_query_xml (xml_file, &mtime, &mtime_usec, &size, NULL))
+        return NULL;
+
+    path = snapshot_get_path ();
+    file = g_mapped_file_new (path, FALSE, NULL);
+    g_free (path);
+    if (!file)
+        return NULL;
+
+    data = g_mapped_file_get_contents (file);
+    end = data + g_mapped_file_get_length (file);
+
+    if (end - data < SNAPSHOT_HEADER_SIZE ||
+        memcmp (data, SNAPSHOT_MAGIC, 8) != 0 ||
+        read_u32 (data + 8) != SNAPSHOT_VERSION ||
+        read_u64 (data + 16) != mtime ||
+        read_u32 (data + 24) != mtime_usec ||
+        read_u64 (data + 32) != size) {
+        g_mapped_file_unref (file);
+        return NULL;
+    }
+
+    n_notes = read_u32 (data + 12);
+    snapshot = g_new0 (StickyNotesSnapshot, 1);
+    snapshot->file = file;
+    snapshot->notes = g_array_sized_new (FALSE, FALSE, sizeof (StickyNoteRecord),
+                                         MIN (n_notes, 1024));
+
+    for (i = 0, p = data + SNAPSHOT_HEADER_SIZE; i < n_notes; i++) {
+        StickyNoteRecord record;
+        guint32 length;
+
+        if (end - p < 4 || (gsize) (end - p - 4) < (length = read_u32 (p)) ||
+            !read_record (p + 4, p + 4 + length, &record))
+            break;
+
+        g_array_append_val (snapshot->notes, record);
+        p += 4 + length;
+    }
+
+    if (i < n_notes || p != end) {
+        g_warning ("The snapshot of the sticky notes is damaged, reading the notes file");
+        stickynotes_snapshot_free (snapshot);
+        return NULL;
+    }
+
+    return snapshot;
+}
+
+guint
+stickynotes_snapshot_get_length (StickyNotesSnapshot *snapshot)
+{
+    return snapshot->notes->len;
+}
+
+const StickyNoteRecord *
+stickynotes_snapshot_get_note (StickyNotesSnapshot *snapshot,
+                               guint                index)
+{
+    return &g_array_index (snapshot->notes, StickyNoteRecord, index);
+}
+
+void
+stickynotes_snapshot_free (StickyNotesSnapshot *snapshot)
+{
+    g_array_free (snapshot->notes, TRUE);
+    g_mapped_file_unref (snapshot->file);
+    g_free (snapshot);
+}
+
+static void
+append_u32 (GByteArray *contents,
+            guint32     value)
+{
+    value = GUINT32_TO_LE (value);
+    g_byte_array_append (contents, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+append_string (GByteArray  *contents,
+               const gchar *string)
+{
+    gsize length;
+
+    if (!string) {
+        append_u32 (contents, SNAPSHOT_NO_STRING);
+        return;
+    }
+
+    length = strlen (string);
+    append_u32 (contents, (guint32) length);
+    /* and the NUL, so the strings can be used in place */
+    g_byte_array_append (contents, (const guint8 *) string, (guint) length + 1);
+}
+
+static void
+write_u32 (GByteArray *contents,
+           guint       offset,
+           guint32     value)
+{
+    value = GUINT32_TO_LE (value);
+    memcpy (contents->data + offset, &value, sizeof (value));
+}
+
+static void
+write_u64 (GByteArray *contents,
+           guint       offset,
+           guint64     value)
+{
+    value = GUINT64_TO_LE (value);
+    memcpy (contents->data + offset, &value, sizeof (value));
+}
+
+/* The header is filled in once the XML file is written */
+GByteArray *
+stickynotes_snapshot_new (void)
+{
+    GByteArray *contents;
+
+    contents = g_byte_array_sized_new (4096);
+    g_byte_array_set_size (contents, SNAPSHOT_HEADER_SIZE);
+    memset (contents->data, 0, SNAPSHOT_HEADER_SIZE);
+    memcpy (contents->data, SNAPSHOT_MAGIC, 8);
+    write_u32 (contents, 8, SNAPSHOT_VERSION);
+
+    return contents;
+}
+
+void
+stickynotes_snapshot_add_note (GByteArray             *contents,
+                               const StickyNoteRecord *record)
+{
+    guint start, n_notes;
+
+    /* the length is known at the end of the record */
+    start = contents->len;
+    append_u32 (contents, 0);
+
+    append_u32 (contents, (guint32) record->x);
+    append_u32 (contents, (guint32) record->y);
+    append_u32 (contents, (guint32) record->w);
+    append_u32 (contents, (guint32) record->h);
+    append_u32 (contents, (guint32) record->workspace);
+    append_u32 (contents, record->locked ? 1 : 0);
+    append_string (contents, record->title);
+    append_string (contents, record->color);
+    append_string (contents, record->font_color);
+    append_string (contents, record->font);
+    append_string (contents, record->body);
+
+    write_u32 (contents, start, contents->len - start - 4);
+
+    n_notes = read_u32 ((const gchar *) contents->data + 12);
+    write_u32 (contents, 12, n_notes + 1);
+}
+
+static void
+snapshot_written_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+    GTask *task = data;
+    GError *error = NULL;
+
+    if (g_file_replace_contents_finish (G_FILE (source), result, NULL, &error))
+        g_task_return_boolean (task, TRUE);
+    else
+        g_task_return_error (task, error);
+
+    g_object_unref (task);
+}
+
+/* Takes contents.  Like the XML file, the snapshot is written to a
+   temporary file that then replaces the old one. */
+void
+stickynotes_snapshot_write (GByteArray          *contents,
+                            GFile               *xml_file,
+                            GAsyncReadyCallback  callback,
+                            gpointer             data)
+{
+    GTask *task;
+    GFile *file;
+    GBytes *bytes;
+    guint64 mtime, size;
+    guint32 mtime_usec;
+    gchar *path, *dir;
+    GError *error = NULL;
+
+    task = g_task_new (NULL, NULL, callback, data);
+
+    if (!snapshot_query_xml (xml_file, &mtime, &mtime_usec, &size, &error)) {
+        g_byte_array_unref (contents);
+        g_task_return_error (task, error);
+        g_object_unref (task);
+        return;
+    }
+
+    write_u64 (contents, 16, mtime);
+    write_u32 (contents, 24, mtime_usec);
+    write_u64 (contents, 32, size);
+
+    path = snapshot_get_path ();
+    dir = g_path_get_dirname (path);
+    g_mkdir_with_parents (dir, 0700);
+    file = g_file_new_for_path (path);
+    g_free (dir);
+    g_free (path);
+
+    bytes = g_byte_array_free_to_bytes (contents);
+    g_file_replace_contents_bytes_async (file, bytes, NULL, FALSE,
+                                         G_FILE_CREATE_PRIVATE, NULL,
+                                         snapshot_written_cb, task);
+    g_bytes_unref (bytes);
+    g_object_unref (file);
+}
+
+gboolean
+stickynotes_snapshot_write_finish (GAsyncResult  *result,
+                                   GError       **error)
+{
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
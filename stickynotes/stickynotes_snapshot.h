@@ -0,0 +1,66 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __STICKYNOTES_SNAPSHOT_H__
+#define __STICKYNOTES_SNAPSHOT_H__
+
+#include <gio/gio.h>
+
+/* A binary copy of the notes file, written after each save and read
+   instead of the XML at startup.  The XML file stays the one that
+   counts: the copy is only used while the file has the modification
+   time and size it was written for. */
+
+/* One note in the snapshot.  The strings are NULL when the note has
+   none, and while the snapshot is open point into it. */
+typedef struct
+{
+    gint         x, y, w, h;
+    gint         workspace;
+    gboolean     locked;
+    const gchar *title;
+    const gchar *color;
+    const gchar *font_color;
+    const gchar *font;
+    const gchar *body;
+} StickyNoteRecord;
+
+typedef struct _StickyNotesSnapshot StickyNotesSnapshot;
+
+/* Maps and checks the snapshot of xml_file, NULL unless it is complete
+   and written for the file as it is now */
+StickyNotesSnapshot *    stickynotes_snapshot_open       (GFile                  *xml_file);
+guint                    stickynotes_snapshot_get_length (StickyNotesSnapshot    *snapshot);
+const StickyNoteRecord * stickynotes_snapshot_get_note   (StickyNotesSnapshot    *snapshot,
+                                                          guint                   index);
+void                     stickynotes_snapshot_free       (StickyNotesSnapshot    *snapshot);
+
+/* Builds a snapshot while the XML file is written, and writes it once
+   the file is there */
+GByteArray *             stickynotes_snapshot_new        (void);
+void                     stickynotes_snapshot_add_note   (GByteArray             *contents,
+                                                          const StickyNoteRecord *record);
+void                     stickynotes_snapshot_write      (GByteArray             *contents,
+                                                          GFile                  *xml_file,
+                                                          GAsyncReadyCallback     callback,
+                                                          gpointer                data);
+gboolean                 stickynotes_snapshot_write_finish (GAsyncResult         *result,
+                                                            GError              **error);
+
+#endif /* __STICKYNOTES_SNAPSHOT_H__ */
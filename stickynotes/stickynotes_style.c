@@ -0,0 +1,372 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "stickynotes.h"
+#include "stickynotes_style.h"
+
+typedef enum {
+    STYLE_COLOR,
+    STYLE_FONT_COLOR,
+    STYLE_FONT,
+    STYLE_N
+} StyleKind;
+
+typedef struct {
+    gchar *value;
+    gchar *name;       /* the style class */
+    guint  refs;       /* the notes using it */
+} StyleRule;
+
+static const gchar *style_default_names[STYLE_N] = {
+    "stickynote-default-color",
+    "stickynote-default-font-color",
+    "stickynote-default-font"
+};
+
+static const gchar *style_prefixes[STYLE_N] = {
+    "stickynote-color",
+    "stickynote-font-color",
+    "stickynote-font"
+};
+
+static const gchar * const style_default_keys[STYLE_N + 1] = {
+    "default-color",
+    "default-font-color",
+    "default-font",
+    NULL
+};
+
+static GtkCssProvider *style_provider = NULL;
+/* value -> StyleRule, one table per kind */
+static GHashTable *style_rules[STYLE_N];
+/* StickyNote* -> its StyleRule*'s, NULL for the defaults */
+static GHashTable *style_notes = NULL;
+static guint style_serial = 0;
+static guint style_update_id = 0;
+
+/* the preferences, as of their last change */
+static gboolean style_force_default;
+static gboolean style_system_color;
+static gboolean style_system_font;
+static gchar *style_defaults[STYLE_N];
+
+static void
+style_rule_free (StyleRule *rule)
+{
+    g_free (rule->value);
+    g_free (rule->name);
+    g_free (rule);
+}
+
+static void
+style_append_color (GString     *css,
+                    const gchar *name,
+                    const gchar *property,
+                    const gchar *value)
+{
+    GdkRGBA color;
+    gchar *color_str;
+
+    if (!gdk_rgba_parse (&color, value))
+        return;
+
+    /* the text node of the body paints and colors it, not the view */
+    color_str = gdk_rgba_to_string (&color);
+    g_string_append_printf (css, ".%s, .%s text { %s: %s; }\n",
+                            name, name, property, color_str);
+    g_free (color_str);
+}
+
+static void
+style_append_font (GString     *css,
+                   const gchar *name,
+                   const gchar *value)
+{
+    PangoFontDescription *font_desc;
+    PangoFontMask set;
+    gchar size[G_ASCII_DTOSTR_BUF_SIZE];
+
+    font_desc = pango_font_description_from_string (value);
+    set = pango_font_description_get_set_fields (font_desc);
+
+    g_string_append_printf (css, ".%s, .%s text {", name, name);
+
+    if (set & PANGO_FONT_MASK_FAMILY)
+        g_string_append_printf (css, " font-family: \"%s\";",
+                                pango_font_description_get_family (font_desc));
+
+    if (set & PANGO_FONT_MASK_SIZE) {
+        g_ascii_dtostr (size, sizeof size,
+                        (gdouble) pango_font_description_get_size (font_desc) / PANGO_SCALE);
+        g_string_append_printf (css, " font-size: %s%s;", size,
+                                pango_font_description_get_size_is_absolute (font_desc) ? "px" : "pt");
+    }
+
+    if (set & PANGO_FONT_MASK_STYLE) {
+        PangoStyle style = pango_font_description_get_style (font_desc);
+
+        g_string_append_printf (css, " font-style: %s;",
+                                style == PANGO_STYLE_ITALIC ? "italic" :
+                                style == PANGO_STYLE_OBLIQUE ? "oblique" : "normal");
+    }
+
+    /* CSS knows the hundreds from 100 to 900 */
+    if (set & PANGO_FONT_MASK_WEIGHT)
+        g_string_append_printf (css, " font-weight: %d;",
+                                CLAMP ((pango_font_description_get_weight (font_desc) + 50) / 100, 1, 9) * 100);
+
+    if (set & PANGO_FONT_MASK_VARIANT)
+        g_string_append_printf (css, " font-variant: %s;",
+                                pango_font_description_get_variant (font_desc) == PANGO_VARIANT_SMALL_CAPS ?
+                                "small-caps" : "normal");
+
+    g_string_append (css, " }\n");
+
+    pango_font_description_free (font_desc);
+}
+
+static void
+style_append_rule (GString     *css,
+                   StyleKind    kind,
+                   const gchar *name,
+                   const gchar *value)
+{
+    if (kind == STYLE_COLOR)
+        style_append_color (css, name, "background-color", value);
+    else if (kind == STYLE_FONT_COLOR)
+        style_append_color (css, name, "color", value);
+    else
+        style_append_font (css, name, value);
+}
+
+/* Writes the whole stylesheet, once for all the changes of an iteration */
+static gboolean
+style_update_cb (gpointer data)
+{
+    GHashTableIter iter;
+    StyleRule *rule;
+    GString *css;
+    guint kind;
+
+    style_update_id = 0;
+    css = g_string_new (NULL);
+
+    for (kind = 0; kind < STYLE_N; kind++) {
+        gboolean system = kind == STYLE_FONT ? style_system_font : style_system_color;
+
+        if (!system && style_defaults[kind])
+            style_append_rule (css, kind, style_default_names[kind], style_defaults[kind]);
+
+        g_hash_table_iter_init (&iter, style_rules[kind]);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &rule))
+            style_append_rule (css, kind, rule->name, rule->value);
+    }
+
+    gtk_css_provider_load_from_data (style_provider, css->str, (gssize) css->len, NULL);
+    g_string_free (css, TRUE);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+style_queue_update (void)
+{
+    /* before the notes are laid out and drawn again */
+    if (!style_update_id)
+        style_update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                           style_update_cb, NULL, NULL);
+}
+
+static void
+style_read_settings (void)
+{
+    guint kind;
+
+    style_force_default = g_settings_get_boolean (stickynotes->settings, "force-default");
+    style_system_color = g_settings_get_boolean (stickynotes->settings, "use-system-color");
+    style_system_font = g_settings_get_boolean (stickynotes->settings, "use-system-font");
+
+    for (kind = 0; kind < STYLE_N; kind++) {
+        g_free (style_defaults[kind]);
+        style_defaults[kind] = g_settings_get_string (stickynotes->settings,
+                                                      style_default_keys[kind]);
+    }
+}
+
+static void
+style_settings_changed (GSettings   *settings,
+                        const gchar *key,
+                        gpointer     data)
+{
+    GList *l;
+
+    if (strcmp (key, "force-default") != 0 &&
+        strcmp (key, "use-system-color") != 0 &&
+        strcmp (key, "use-system-font") != 0 &&
+        !g_strv_contains (style_default_keys, key))
+        return;
+
+    style_read_settings ();
+    style_queue_update ();
+
+    /* the only change that moves notes between their own style and
+     * the default one */
+    if (strcmp (key, "force-default") == 0)
+        for (l = stickynotes->notes; l; l = l->next)
+            stickynotes_style_apply (l->data);
+}
+
+static void
+style_init (GdkScreen *screen)
+{
+    guint kind;
+
+    if (style_provider)
+        return;
+
+    style_provider = gtk_css_provider_new ();
+    gtk_style_context_add_provider_for_screen (screen,
+                                               GTK_STYLE_PROVIDER (style_provider),
+                                               GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+    for (kind = 0; kind < STYLE_N; kind++)
+        style_rules[kind] = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   NULL,
+                                                   (GDestroyNotify) style_rule_free);
+    style_notes = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+    style_read_settings ();
+    g_signal_connect (stickynotes->settings, "changed",
+                      G_CALLBACK (style_settings_changed), NULL);
+}
+
+static StyleRule *
+style_rule_ref (StyleKind    kind,
+                const gchar *value)
+{
+    StyleRule *rule;
+
+    rule = g_hash_table_lookup (style_rules[kind], value);
+    if (!rule) {
+        rule = g_new0 (StyleRule, 1);
+        rule->value = g_strdup (value);
+        rule->name = g_strdup_printf ("%s-%u", style_prefixes[kind], ++style_serial);
+        g_hash_table_insert (style_rules[kind], rule->value, rule);
+        style_queue_update ();
+    }
+
+    rule->refs++;
+
+    return rule;
+}
+
+static void
+style_rule_unref (StyleKind  kind,
+                  StyleRule *rule)
+{
+    if (!rule || --rule->refs > 0)
+        return;
+
+    g_hash_table_remove (style_rules[kind], rule->value);
+    style_queue_update ();
+}
+
+static void
+style_set_class (StickyNote  *note,
+                 StyleKind    kind,
+                 const gchar *old_name,
+                 const gchar *name)
+{
+    GtkWidget *widgets[] = {
+        note->w_window, note->w_body,
+        note->w_lock, note->w_close, note->w_resize_se, note->w_resize_sw
+    };
+    guint n, i;
+
+    /* as the colors used to be overridden: the background of all of
+     * them, the text of the window and body */
+    n = kind == STYLE_COLOR ? G_N_ELEMENTS (widgets) : 2;
+
+    for (i = 0; i < n; i++) {
+        GtkStyleContext *context = gtk_widget_get_style_context (widgets[i]);
+
+        if (old_name)
+            gtk_style_context_remove_class (context, old_name);
+        gtk_style_context_add_class (context, name);
+    }
+}
+
+/* Gives the note the classes of its colors and font */
+void
+stickynotes_style_apply (StickyNote *note)
+{
+    const gchar *values[STYLE_N];
+    StyleRule **rules;
+    gboolean added = FALSE;
+    guint kind;
+
+    style_init (gtk_widget_get_screen (note->w_window));
+
+    rules = g_hash_table_lookup (style_notes, note);
+    if (!rules) {
+        rules = g_new0 (StyleRule *, STYLE_N);
+        g_hash_table_insert (style_notes, note, rules);
+        added = TRUE;
+    }
+
+    values[STYLE_COLOR] = note->color;
+    values[STYLE_FONT_COLOR] = note->font_color;
+    values[STYLE_FONT] = note->font;
+
+    for (kind = 0; kind < STYLE_N; kind++) {
+        StyleRule *rule, *old = rules[kind];
+
+        rule = values[kind] && !style_force_default ?
+            style_rule_ref (kind, values[kind]) : NULL;
+
+        if (!added && rule == old) {
+            style_rule_unref (kind, rule);
+            continue;
+        }
+
+        style_set_class (note, kind,
+                         added ? NULL : old ? old->name : style_default_names[kind],
+                         rule ? rule->name : style_default_names[kind]);
+        style_rule_unref (kind, old);
+        rules[kind] = rule;
+    }
+}
+
+void
+stickynotes_style_remove (StickyNote *note)
+{
+    StyleRule **rules;
+    guint kind;
+
+    if (!style_notes || !(rules = g_hash_table_lookup (style_notes, note)))
+        return;
+
+    for (kind = 0; kind < STYLE_N; kind++)
+        style_rule_unref (kind, rules[kind]);
+
+    g_hash_table_remove (style_notes, note);
+}
@@ -0,0 +1,35 @@
+/* Sticky Notes
+ * Copyright (C) 2002-2003 Loban A Rahman
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __STICKYNOTES_STYLE_H__
+#define __STICKYNOTES_STYLE_H__
+
+#include <stickynotes.h>
+
+/* The colors and fonts of the notes, from one style provider of the
+   screen.  A note carries a style class for each of its color, font
+   color and font: a default one while it follows the preferences, or
+   one shared by the notes with the same value.  The preferences are
+   read when they change, and a change of the defaults rewrites the
+   stylesheet once, without touching the notes. */
+
+void stickynotes_style_apply  (StickyNote *note);
+void stickynotes_style_remove (StickyNote *note);
+
+#endif /* __STICKYNOTES_STYLE_H__ */
@@ -37,7 +37,6 @@
 
 /* Applet constants */
 #define APPLET_ICON  "mate-panel-clock"
-#define STEP         100
 
 /* GSettings constants */
 #define TIMER_SCHEMA            "org.mate.panel.applet.timer"
@@ -45,33 +44,68 @@
 #define DURATION_KEY            "duration"
 #define SHOW_NOTIFICATION_KEY   "show-notification"
 #define SHOW_DIALOG_KEY         "show-dialog"
+#define TIMERS_KEY              "timers"
 
 #define GET_WIDGET(x) (GTK_WIDGET (gtk_builder_get_object (builder, (x))))
 #define GET_DIALOG(x) (GTK_DIALOG (gtk_builder_get_object (builder, (x))))
 #define GET_SPIN_BUTTON(x) (GTK_SPIN_BUTTON (gtk_builder_get_object (builder, (x))))
 
+typedef struct _TimerApplet TimerApplet;
+
+/* queue_index of the timers not running */
+#define NOT_QUEUED   G_MAXUINT
+
 typedef struct
+{
+    TimerApplet       *applet;
+
+    gchar             *name;
+    gint               duration;
+    gchar             *tooltip;
+
+    GtkWidget         *event_box;
+    GtkLabel          *label;
+    GtkImage          *pause_image;
+
+    gboolean           active;
+    gboolean           pause;
+    gint64             elapsed;     /* in microseconds, while paused */
+    gint64             deadline;    /* in monotonic time, while running */
+
+    /* when the label changes next, while running */
+    gint64             wakeup;
+    guint              queue_index;
+} Timer;
+
+struct _TimerApplet
 {
     MatePanelApplet   *applet;
 
     GSettings         *settings;
 
     GtkActionGroup    *action_group;
-    GtkLabel          *label;
     GtkImage          *image;
-    GtkImage          *pause_image;
     GtkBox            *box;
 
     GtkSpinButton     *hours;
     GtkSpinButton     *minutes;
     GtkSpinButton     *seconds;
 
-    gboolean           active;
-    gboolean           pause;
-    gint               elapsed;
+    /* the settings, kept up to date by timer_settings_changed */
+    gboolean           show_notification;
+    gboolean           show_dialog;
 
+    /* the timer of NAME_KEY and DURATION_KEY, then those of TIMERS_KEY */
+    GPtrArray         *timers;
+    /* the timer last clicked, which the menu acts on */
+    Timer             *current;
+
+    /* the running timers, a binary min-heap on their wakeup, with a
+     * single timeout for the first of them */
+    GPtrArray         *queue;
     guint              timeout_id;
-} TimerApplet;
+    gint64             timeout_time;
+};
 
 static void timer_start_callback (GtkAction *action, TimerApplet *applet);
 static void timer_pause_callback (GtkAction *action, TimerApplet *applet);
@@ -96,6 +130,93 @@ static char *ui = "<menuitem name='Item 1' action='Start' />"
                   "<menuitem name='Item 5' action='Preferences' />"
                   "<menuitem name='Item 6' action='About' />";
 
+#define MAIN_TIMER(applet) ((Timer *) g_ptr_array_index ((applet)->timers, 0))
+#define QUEUED_TIMER(queue, i) ((Timer *) g_ptr_array_index ((queue), (i)))
+
+/* deadline queue */
+static void
+queue_swap (GPtrArray *queue, guint i, guint j)
+{
+    Timer *timer = QUEUED_TIMER (queue, i);
+
+    queue->pdata[i] = queue->pdata[j];
+    QUEUED_TIMER (queue, i)->queue_index = i;
+    queue->pdata[j] = timer;
+    timer->queue_index = j;
+}
+
+static void
+queue_sift_up (GPtrArray *queue, guint i)
+{
+    while (i > 0)
+    {
+        guint parent = (i - 1) / 2;
+
+        if (QUEUED_TIMER (queue, parent)->wakeup <= QUEUED_TIMER (queue, i)->wakeup)
+            break;
+        queue_swap (queue, i, parent);
+        i = parent;
+    }
+}
+
+static void
+queue_sift_down (GPtrArray *queue, guint i)
+{
+    for (;;)
+    {
+        guint child = 2 * i + 1;
+        guint first = i;
+
+        if (child < queue->len &&
+            QUEUED_TIMER (queue, child)->wakeup < QUEUED_TIMER (queue, first)->wakeup)
+            first = child;
+        if (child + 1 < queue->len &&
+            QUEUED_TIMER (queue, child + 1)->wakeup < QUEUED_TIMER (queue, first)->wakeup)
+            first = child + 1;
+        if (first == i)
+            break;
+        queue_swap (queue, i, first);
+        i = first;
+    }
+}
+
+static void
+queue_push (GPtrArray *queue, Timer *timer)
+{
+    timer->queue_index = queue->len;
+    g_ptr_array_add (queue, timer);
+    queue_sift_up (queue, timer->queue_index);
+}
+
+static void
+queue_remove (GPtrArray *queue, Timer *timer)
+{
+    guint i = timer->queue_index;
+
+    if (i == NOT_QUEUED)
+        return;
+
+    queue_swap (queue, i, queue->len - 1);
+    g_ptr_array_remove_index (queue, queue->len - 1);
+    timer->queue_index = NOT_QUEUED;
+
+    /* the last timer took its place */
+    if (i < queue->len)
+    {
+        queue_sift_down (queue, i);
+        queue_sift_up (queue, i);
+    }
+}
+
+static void
+timer_free (Timer *timer)
+{
+    queue_remove (timer->applet->queue, timer);
+    g_free (timer->name);
+    g_free (timer->tooltip);
+    g_free (timer);
+}
+
 static void
 timer_applet_destroy (MatePanelApplet *applet_widget, TimerApplet *applet)
 {
@@ -107,174 +228,270 @@ timer_applet_destroy (MatePanelApplet *applet_widget, TimerApplet *applet)
         applet->timeout_id = 0;
     }
 
+    g_signal_handlers_disconnect_by_data (applet->settings, applet);
     g_object_unref (applet->settings);
+    g_ptr_array_unref (applet->timers);
+    g_ptr_array_unref (applet->queue);
 
     notify_uninit ();
 }
 
 /* timer management */
-static gboolean
-timer_callback (TimerApplet *applet)
+static gboolean timer_applet_timeout (TimerApplet *applet);
+
+/* Arms the timeout for the first timer of the queue */
+static void
+timer_applet_schedule (TimerApplet *applet)
 {
-    AtkObject *atk_obj;
-    gboolean retval = TRUE;
-    gchar *label;
-    gchar *name;
-    gchar *tooltip;
-    gint hours, minutes, seconds, duration, remaining;
+    Timer *next;
+    gint64 delay;
 
-    label = NULL;
-    tooltip = NULL;
+    if (applet->queue->len == 0)
+    {
+        if (applet->timeout_id != 0)
+        {
+            g_source_remove (applet->timeout_id);
+            applet->timeout_id = 0;
+        }
+        return;
+    }
 
-    if (!GTK_IS_WIDGET (applet->label))
-        return FALSE;
+    next = QUEUED_TIMER (applet->queue, 0);
+    if (applet->timeout_id != 0)
+    {
+        if (applet->timeout_time == next->wakeup)
+            return;
+        g_source_remove (applet->timeout_id);
+    }
 
-    name = g_settings_get_string (applet->settings, NAME_KEY);
-    atk_obj = gtk_widget_get_accessible (GTK_WIDGET (applet->applet));
+    /* rounded up, so the label has changed when it fires */
+    delay = next->wakeup - g_get_monotonic_time ();
+    applet->timeout_time = next->wakeup;
+    applet->timeout_id = g_timeout_add (delay > 0 ? (delay + 999) / 1000 : 0,
+                                        (GSourceFunc) timer_applet_timeout,
+                                        applet);
+}
 
-    if (!applet->active)
-    {
-        applet->pause = FALSE;
-        applet->elapsed = 0;
+static void
+timer_applet_update_actions (TimerApplet *applet)
+{
+    Timer *timer = applet->current;
 
-        gtk_label_set_text (applet->label, name);
-        gtk_widget_set_tooltip_text (GTK_WIDGET (applet->label), "");
-        gtk_widget_hide (GTK_WIDGET (applet->pause_image));
-        atk_object_set_name (atk_obj, name);
-    }
-    else
+    /* update actions sensitiveness */
+    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Start"), !timer->active || timer->pause);
+    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Pause"), timer->active && !timer->pause);
+    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Stop"), timer->active);
+    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Reset"), !timer->active && !timer->pause && timer->elapsed);
+    /* the preferences are those of the main timer */
+    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Preferences"),
+                              !MAIN_TIMER (applet)->active && !MAIN_TIMER (applet)->pause);
+}
+
+static gint64
+timer_get_elapsed (Timer *timer)
+{
+    if (timer->active && !timer->pause)
+        return (gint64) timer->duration * G_USEC_PER_SEC - (timer->deadline - g_get_monotonic_time ());
+
+    return timer->elapsed;
+}
+
+/* The main timer names the applet, the others their own labels */
+static AtkObject *
+timer_get_accessible (Timer *timer)
+{
+    if (timer == MAIN_TIMER (timer->applet))
+        return gtk_widget_get_accessible (GTK_WIDGET (timer->applet->applet));
+
+    return gtk_widget_get_accessible (timer->event_box);
+}
+
+static void
+timer_finished (Timer *timer, AtkObject *atk_obj)
+{
+    TimerApplet *applet = timer->applet;
+    gchar *label;
+
+    timer->active = FALSE;
+
+    /* Translators: %s is a placeholder for the timer name, 'Timer' by default */
+    label = g_strdup_printf (_("Finished %s"), timer->name);
+    gtk_label_set_text (timer->label, label);
+    gtk_widget_set_tooltip_text (GTK_WIDGET (timer->label), timer->name);
+    gtk_widget_hide (GTK_WIDGET (timer->pause_image));
+    atk_object_set_name (atk_obj, label);
+    atk_object_set_description (atk_obj, "");
+    g_free (label);
+
+    if (applet->show_notification)
     {
-        if (!applet->pause)
-            applet->elapsed += STEP;
+        NotifyNotification *n;
+        n = notify_notification_new (timer->name, _("Timer finished!"), APPLET_ICON);
+        notify_notification_set_timeout (n, 30000);
+        notify_notification_show (n, NULL);
+        g_object_unref (G_OBJECT (n));
+    }
 
-        duration = g_settings_get_int (applet->settings, DURATION_KEY);
+    /* not run, the other timers go on meanwhile */
+    if (applet->show_dialog)
+    {
+        GtkWidget *dialog = gtk_message_dialog_new_with_markup (NULL,
+                                                                GTK_DIALOG_MODAL,
+                                                                GTK_MESSAGE_INFO,
+                                                                GTK_BUTTONS_OK,
+                                                                "<b>%s</b>\n\n%s", timer->name, _("Timer finished!"));
+        g_signal_connect (dialog, "response",
+                          G_CALLBACK (gtk_widget_destroy),
+                          NULL);
+        gtk_widget_show (dialog);
+    }
+}
 
-        remaining = duration - (applet->elapsed / 1000);
+/* Updates the label and, while running, queues the timer for the next
+ * second the label shows, or for the deadline. The queue is scheduled
+ * by the callers. */
+static void
+timer_update (Timer *timer)
+{
+    AtkObject *atk_obj;
+    gint64 remaining;
 
-        if (remaining <= 0)
-        {
-            applet->active = FALSE;
-            applet->timeout_id = 0;
+    queue_remove (timer->applet->queue, timer);
 
-            /* Translators: %s is a placeholder for the timer name, 'Timer' by default */
-            label = g_strdup_printf (_("Finished %s"), name);
-            gtk_label_set_text (applet->label, label);
-            gtk_widget_set_tooltip_text (GTK_WIDGET (applet->label), name);
-            gtk_widget_hide (GTK_WIDGET (applet->pause_image));
-            atk_object_set_name (atk_obj, label);
-            atk_object_set_description (atk_obj, "");
+    atk_obj = timer_get_accessible (timer);
 
-            if (g_settings_get_boolean (applet->settings, SHOW_NOTIFICATION_KEY))
-            {
-                NotifyNotification *n;
-                n = notify_notification_new (name, _("Timer finished!"), APPLET_ICON);
-                notify_notification_set_timeout (n, 30000);
-                notify_notification_show (n, NULL);
-                g_object_unref (G_OBJECT (n));
-            }
+    if (!timer->active)
+    {
+        timer->pause = FALSE;
+        timer->elapsed = 0;
 
-            if (g_settings_get_boolean (applet->settings, SHOW_DIALOG_KEY))
-            {
-                GtkWidget *dialog = gtk_message_dialog_new_with_markup (NULL,
-                                                                        GTK_DIALOG_MODAL,
-                                                                        GTK_MESSAGE_INFO,
-                                                                        GTK_BUTTONS_OK,
-                                                                        "<b>%s</b>\n\n%s", name, _("Timer finished!"));
-                gtk_dialog_run (GTK_DIALOG (dialog));
-                gtk_widget_destroy (dialog);
-            }
+        gtk_label_set_text (timer->label, timer->name);
+        gtk_widget_set_tooltip_text (GTK_WIDGET (timer->label), "");
+        gtk_widget_hide (GTK_WIDGET (timer->pause_image));
+        atk_object_set_name (atk_obj, timer->name);
+    }
+    else
+    {
+        remaining = (gint64) timer->duration * G_USEC_PER_SEC - timer_get_elapsed (timer);
 
-            /* stop further calls */
-            retval = FALSE;
+        if (remaining <= 0)
+        {
+            timer->elapsed = (gint64) timer->duration * G_USEC_PER_SEC;
+            timer_finished (timer, atk_obj);
         }
         else
         {
-            hours = remaining / 60 / 60;
-            minutes = remaining / 60 % 60;
-            seconds = remaining % 60;
+            gchar *label;
+            gint hours, minutes, seconds, shown;
+
+            /* the seconds started, as in a countdown */
+            shown = (remaining + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC;
+            hours = shown / 60 / 60;
+            minutes = shown / 60 % 60;
+            seconds = shown % 60;
 
             if (hours > 0)
                 label = g_strdup_printf ("%02d:%02d:%02d", hours, minutes, seconds);
             else
                 label = g_strdup_printf ("%02d:%02d", minutes, seconds);
 
-            hours = duration / 60 / 60;
-            minutes = duration / 60 % 60;
-            seconds = duration % 60;
-
-            if (hours > 0)
-                tooltip = g_strdup_printf ("%s (%02d:%02d:%02d)", name, hours, minutes, seconds);
-            else
-                tooltip = g_strdup_printf ("%s (%02d:%02d)", name, minutes, seconds);
-
-            gtk_label_set_text (applet->label, label);
-            gtk_widget_set_tooltip_text (GTK_WIDGET (applet->label), tooltip);
-            gtk_widget_set_visible (GTK_WIDGET (applet->pause_image), applet->pause);
+            gtk_label_set_text (timer->label, label);
+            gtk_widget_set_tooltip_text (GTK_WIDGET (timer->label), timer->tooltip);
+            gtk_widget_set_visible (GTK_WIDGET (timer->pause_image), timer->pause);
             atk_object_set_name (atk_obj, label);
-        }
+            g_free (label);
 
-        g_free (label);
-        g_free (tooltip);
+            if (!timer->pause)
+            {
+                timer->wakeup = timer->deadline - (gint64) (shown - 1) * G_USEC_PER_SEC;
+                queue_push (timer->applet->queue, timer);
+            }
+        }
     }
 
-    /* update actions sensitiveness */
-    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Start"), !applet->active || applet->pause);
-    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Pause"), applet->active && !applet->pause);
-    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Stop"), applet->active);
-    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Reset"), !applet->active && !applet->pause && applet->elapsed);
-    gtk_action_set_sensitive (gtk_action_group_get_action (applet->action_group, "Preferences"), !applet->active && !applet->pause);
+    if (timer == timer->applet->current || timer == MAIN_TIMER (timer->applet))
+        timer_applet_update_actions (timer->applet);
+}
 
-    g_free (name);
+static gboolean
+timer_applet_timeout (TimerApplet *applet)
+{
+    gint64 now = g_get_monotonic_time ();
 
-    return retval;
+    applet->timeout_id = 0;
+
+    /* each update queues the timer again for a later second */
+    while (applet->queue->len > 0 && QUEUED_TIMER (applet->queue, 0)->wakeup <= now)
+        timer_update (QUEUED_TIMER (applet->queue, 0));
+
+    timer_applet_schedule (applet);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+timer_changed (Timer *timer)
+{
+    timer_update (timer);
+    timer_applet_schedule (timer->applet);
+}
+
+static void
+timer_start (Timer *timer)
+{
+    timer->active = TRUE;
+    if (timer->pause)
+        timer->pause = FALSE;
+    else
+        timer->elapsed = 0;
+    timer->deadline = g_get_monotonic_time () + (gint64) timer->duration * G_USEC_PER_SEC - timer->elapsed;
+    timer_changed (timer);
+}
+
+static void
+timer_pause (Timer *timer)
+{
+    timer->elapsed = timer_get_elapsed (timer);
+    timer->pause = TRUE;
+    timer_changed (timer);
+}
+
+static void
+timer_reset (Timer *timer)
+{
+    timer->active = FALSE;
+    timer->pause = FALSE;
+    timer->elapsed = 0;
+    timer_changed (timer);
 }
 
 /* start action */
 static void
 timer_start_callback (GtkAction *action, TimerApplet *applet)
 {
-    applet->active = TRUE;
-    if (applet->pause)
-        applet->pause = FALSE;
-    else
-        applet->elapsed = 0;
-    applet->timeout_id = g_timeout_add (STEP, (GSourceFunc) timer_callback, applet);
+    timer_start (applet->current);
 }
 
 /* pause action */
 static void
 timer_pause_callback (GtkAction *action, TimerApplet *applet)
 {
-    applet->pause = TRUE;
-    if (applet->timeout_id != 0)
-    {
-        g_source_remove(applet->timeout_id);
-        applet->timeout_id = 0;
-    }
-    timer_callback (applet);
+    timer_pause (applet->current);
 }
 
 /* stop action */
 static void
 timer_stop_callback (GtkAction *action, TimerApplet *applet)
 {
-    applet->active = FALSE;
-    if (applet->timeout_id != 0)
-    {
-        g_source_remove(applet->timeout_id);
-        applet->timeout_id = 0;
-    }
-    timer_callback (applet);
+    applet->current->active = FALSE;
+    timer_changed (applet->current);
 }
 
 /* reset action */
 static void
 timer_reset_callback (GtkAction *action, TimerApplet *applet)
 {
-    applet->active = FALSE;
-    applet->pause = FALSE;
-    applet->elapsed = 0;
-    timer_callback (applet);
+    timer_reset (applet->current);
 }
 
 /* Show the about dialog */
@@ -323,7 +540,7 @@ timer_preferences_callback (GtkAction *action, TimerApplet *applet)
     applet->minutes = GET_SPIN_BUTTON ("minutes_spinbutton");
     applet->seconds = GET_SPIN_BUTTON ("seconds_spinbutton");
 
-    duration = g_settings_get_int (applet->settings, DURATION_KEY);
+    duration = MAIN_TIMER (applet)->duration;
     hours = duration / 60 / 60;
     minutes = duration / 60 % 60;
     seconds = duration % 60;
@@ -353,27 +570,149 @@ timer_preferences_callback (GtkAction *action, TimerApplet *applet)
     gtk_widget_show_all (GTK_WIDGET (dialog));
 }
 
+/* a press on a timer makes it the one the menu and the clicks act on */
+static gboolean
+timer_press (Timer *timer, GdkEventButton *event)
+{
+    if (timer->applet->current != timer)
+    {
+        timer->applet->current = timer;
+        timer_applet_update_actions (timer->applet);
+    }
+
+    return FALSE;
+}
+
 static gboolean
 timer_applet_click (TimerApplet *applet,  GdkEventButton *event)
 {
+    Timer *timer = applet->current;
+
     if (  event->button == 1)
     {
-        if (!applet->active && !applet->pause && applet->elapsed)
-            timer_reset_callback (NULL, applet);
-        else if (applet->active && !applet->pause)
-            timer_pause_callback (NULL, applet);
-        else if (!applet->active || applet->pause)
-            timer_start_callback (NULL, applet);
+        if (!timer->active && !timer->pause && timer->elapsed)
+            timer_reset (timer);
+        else if (timer->active && !timer->pause)
+            timer_pause (timer);
+        else if (!timer->active || timer->pause)
+            timer_start (timer);
     return TRUE;
     }
     else
         return FALSE;
 }
 
+static Timer *
+timer_new (TimerApplet *applet)
+{
+    Timer *timer;
+    GtkWidget *box;
+
+    timer = g_new0 (Timer, 1);
+    timer->applet = applet;
+    timer->queue_index = NOT_QUEUED;
+
+    timer->event_box = gtk_event_box_new ();
+    gtk_event_box_set_visible_window (GTK_EVENT_BOX (timer->event_box), FALSE);
+    box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+    timer->pause_image = GTK_IMAGE (gtk_image_new_from_icon_name ("media-playback-pause", GTK_ICON_SIZE_BUTTON));
+    timer->label = GTK_LABEL (gtk_label_new (""));
+
+    gtk_box_pack_start (GTK_BOX (box),
+                        GTK_WIDGET (timer->pause_image),
+                        TRUE, TRUE, 0);
+    gtk_box_pack_start (GTK_BOX (box),
+                        GTK_WIDGET (timer->label),
+                        TRUE, TRUE, 3);
+    gtk_container_add (GTK_CONTAINER (timer->event_box), box);
+    gtk_box_pack_start (applet->box, timer->event_box, TRUE, TRUE, 0);
+
+    gtk_widget_show_all (timer->event_box);
+    gtk_widget_hide (GTK_WIDGET (timer->pause_image));
+
+    g_signal_connect_swapped (timer->event_box, "button-press-event",
+                              G_CALLBACK (timer_press),
+                              timer);
+
+    return timer;
+}
+
+static void
+timer_set (Timer *timer, const gchar *name, gint duration)
+{
+    gint hours, minutes, seconds;
+
+    g_free (timer->name);
+    timer->name = g_strdup (name);
+    timer->duration = duration;
+
+    hours = duration / 60 / 60;
+    minutes = duration / 60 % 60;
+    seconds = duration % 60;
+
+    g_free (timer->tooltip);
+    if (hours > 0)
+        timer->tooltip = g_strdup_printf ("%s (%02d:%02d:%02d)", name, hours, minutes, seconds);
+    else
+        timer->tooltip = g_strdup_printf ("%s (%02d:%02d)", name, minutes, seconds);
+
+    /* a running timer keeps its deadline */
+    timer_update (timer);
+}
+
+/* The timers after the main one, kept by their position */
+static void
+timer_applet_load_timers (TimerApplet *applet)
+{
+    GVariant *value;
+    GVariantIter iter;
+    const gchar *name;
+    gint duration;
+    guint n = 1;
+
+    value = g_settings_get_value (applet->settings, TIMERS_KEY);
+    g_variant_iter_init (&iter, value);
+    while (g_variant_iter_next (&iter, "(&si)", &name, &duration))
+    {
+        if (n == applet->timers->len)
+            g_ptr_array_add (applet->timers, timer_new (applet));
+        timer_set (g_ptr_array_index (applet->timers, n), name, duration);
+        n++;
+    }
+    g_variant_unref (value);
+
+    while (applet->timers->len > n)
+    {
+        Timer *timer = g_ptr_array_index (applet->timers, applet->timers->len - 1);
+
+        if (applet->current == timer)
+            applet->current = MAIN_TIMER (applet);
+        gtk_widget_destroy (timer->event_box);
+        g_ptr_array_remove_index (applet->timers, applet->timers->len - 1);
+    }
+
+    timer_applet_update_actions (applet);
+}
+
 static void
 timer_settings_changed (GSettings *settings, gchar *key, TimerApplet *applet)
 {
-    timer_callback (applet);
+    if (key == NULL || g_strcmp0 (key, SHOW_NOTIFICATION_KEY) == 0)
+        applet->show_notification = g_settings_get_boolean (settings, SHOW_NOTIFICATION_KEY);
+    if (key == NULL || g_strcmp0 (key, SHOW_DIALOG_KEY) == 0)
+        applet->show_dialog = g_settings_get_boolean (settings, SHOW_DIALOG_KEY);
+
+    if (key == NULL || g_strcmp0 (key, NAME_KEY) == 0 || g_strcmp0 (key, DURATION_KEY) == 0)
+    {
+        gchar *name = g_settings_get_string (settings, NAME_KEY);
+
+        timer_set (MAIN_TIMER (applet), name, g_settings_get_int (settings, DURATION_KEY));
+        g_free (name);
+    }
+    if (key == NULL || g_strcmp0 (key, TIMERS_KEY) == 0)
+        timer_applet_load_timers (applet);
+
+    timer_applet_schedule (applet);
 }
 
 static gboolean
@@ -396,13 +735,11 @@ timer_applet_fill (MatePanelApplet* applet_widget)
     applet->applet = applet_widget;
     applet->settings = mate_panel_applet_settings_new (applet_widget,TIMER_SCHEMA);
     applet->timeout_id = 0;
-    applet->active = FALSE;
-    applet->pause = FALSE;
+    applet->timers = g_ptr_array_new_with_free_func ((GDestroyNotify) timer_free);
+    applet->queue = g_ptr_array_new ();
 
     applet->box = GTK_BOX (gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0));
     applet->image = GTK_IMAGE (gtk_image_new_from_icon_name (APPLET_ICON, GTK_ICON_SIZE_BUTTON));
-    applet->pause_image = GTK_IMAGE (gtk_image_new_from_icon_name ("media-playback-pause", GTK_ICON_SIZE_BUTTON));
-    applet->label = GTK_LABEL (gtk_label_new (""));
 
     atk_obj = gtk_widget_get_accessible (GTK_WIDGET (applet->applet));
     if (GTK_IS_ACCESSIBLE (atk_obj)) {
@@ -413,18 +750,15 @@ timer_applet_fill (MatePanelApplet* applet_widget)
     gtk_box_pack_start (applet->box,
                         GTK_WIDGET (applet->image),
                         TRUE, TRUE, 0);
-    gtk_box_pack_start (applet->box,
-                        GTK_WIDGET (applet->pause_image),
-                        TRUE, TRUE, 0);
-    gtk_box_pack_start (applet->box,
-                        GTK_WIDGET (applet->label),
-                        TRUE, TRUE, 3);
 
     gtk_container_add (GTK_CONTAINER (applet_widget),
                        GTK_WIDGET (applet->box));
 
     gtk_widget_show_all (GTK_WIDGET (applet->applet));
-    gtk_widget_hide (GTK_WIDGET (applet->pause_image));
+
+    /* the main timer, the others come with the settings */
+    g_ptr_array_add (applet->timers, timer_new (applet));
+    applet->current = MAIN_TIMER (applet);
 
     g_signal_connect (applet->applet, "destroy",
                       G_CALLBACK (timer_applet_destroy),
@@ -441,8 +775,8 @@ timer_applet_fill (MatePanelApplet* applet_widget)
                                   G_N_ELEMENTS (applet_menu_actions), applet);
     mate_panel_applet_setup_menu (applet->applet, ui, applet->action_group);
 
-    /* execute callback to set actions sensitiveness */
-    timer_callback (applet);
+    /* read the settings and set actions sensitiveness */
+    timer_settings_changed (applet->settings, NULL, applet);
 
     /* GSettings callback */
     g_signal_connect (applet->settings, "changed",
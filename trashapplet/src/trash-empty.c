@@ -22,6 +22,12 @@
 #include <gio/gio.h>
 #include <glib/gi18n.h>
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "trash-empty.h"
 #include "config.h"
 
@@ -32,37 +38,64 @@ static GtkProgressBar     *trash_empty_progress_bar;
 static GtkLabel           *trash_empty_location;
 static GtkLabel           *trash_empty_file;
 
-/* the rules:
- * 1) nothing here may be modified while trash_empty_update_pending.
- * 2) an idle may only be scheduled if trash_empty_update_pending.
- * 3) only the worker may set trash_empty_update_pending = TRUE.
- * 4) only the UI updater may set trash_empty_update_pending = FALSE.
- *
- * i -think- this is threadsafe...  ((famous last words...))
+/* The dialog is updated from a timer at a fixed rate, however fast the
+ * workers go.  They only add to the counters below, and hand over the
+ * file being removed when a frame asks for one through
+ * trash_empty_want_current.
  */
-static GFile *     volatile trash_empty_current_file;
-static gsize       volatile trash_empty_deleted_files;
-static gsize       volatile trash_empty_total_files;
-static gboolean    volatile trash_empty_update_pending;
+static GFile *     trash_empty_current_dir;
+static char *      trash_empty_current_name;
+static gint        trash_empty_want_current;
+G_LOCK_DEFINE_STATIC (trash_empty_current);
+static guint       trash_empty_update_id;
+
+/* how often the dialog is updated, in milliseconds */
+#define TRASH_EMPTY_UPDATE_INTERVAL 100
+
+/* the counters the workers add to, for the progress estimate */
+static gint        trash_empty_deleted_files;
+static gint        trash_empty_seen_entries;
+static gint        trash_empty_done_entries;
+
+/* how many top level entries of the trash are deleted at once */
+#define TRASH_EMPTY_WORKERS 4
+/* how many entries a directory enumeration fetches at once */
+#define TRASH_EMPTY_BATCH 100
 
 static gboolean
 trash_empty_update_dialog (gpointer user_data)
 {
-  gsize deleted, total;
-  GFile *file;
-
-  g_assert (trash_empty_update_pending);
-
-  deleted = trash_empty_deleted_files;
-  total = trash_empty_total_files;
-  file = trash_empty_current_file;
+  gsize deleted, total, seen, done;
+  GFile *dir;
+  char *name;
+
+  /* an entry is done only once it was seen */
+  deleted = g_atomic_int_get (&trash_empty_deleted_files);
+  done = g_atomic_int_get (&trash_empty_done_entries);
+  seen = g_atomic_int_get (&trash_empty_seen_entries);
+  G_LOCK (trash_empty_current);
+  dir = trash_empty_current_dir;
+  name = trash_empty_current_name;
+  trash_empty_current_dir = NULL;
+  trash_empty_current_name = NULL;
+  G_UNLOCK (trash_empty_current);
+
+  /* ask for the file of the next frame */
+  g_atomic_int_set (&trash_empty_want_current, TRUE);
+
+  /* nothing was removed since the last frame */
+  if (dir == NULL)
+    return G_SOURCE_CONTINUE;
+
+  /* There is no counting pass, so the entries left are assumed to hold
+   * as many files as the ones deleted so far did on average. */
+  total = deleted + (seen - done) * MAX (1, deleted / MAX (done, 1));
 
   /* maybe the done() got processed first. */
   if (trash_empty_dialog)
     {
       char *index_str, *total_str;
       char *text_tmp, *text;
-      char *tmp;
 
       /* The i18n tools can't handle a direct embedding of the
        * size format using a macro. This is a work-around. */
@@ -76,42 +109,31 @@ trash_empty_update_dialog (gpointer user_data)
       g_free (index_str);
       g_free (text);
 
-      if (deleted > total)
+      if (deleted > total || total == 0)
         gtk_progress_bar_set_fraction (trash_empty_progress_bar, 1.0);
       else
         gtk_progress_bar_set_fraction (trash_empty_progress_bar,
                                        (gdouble) deleted / (gdouble) total);
 
-      /* no g_file_get_basename? */
-      {
-        GFile *parent;
-
-        parent = g_file_get_parent (file);
-        text = g_file_get_uri (parent);
-        g_object_unref (parent);
-      }
+      text = g_file_get_uri (dir);
       gtk_label_set_text (trash_empty_location, text);
       g_free (text);
 
-      tmp = g_file_get_basename (file);
       /* Translators: %s is a file name */
-      text_tmp = g_strdup_printf (_("Removing: %s"), tmp);
+      text_tmp = g_strdup_printf (_("Removing: %s"), name);
       text = g_markup_printf_escaped ("<i>%s</i>", text_tmp);
       gtk_label_set_markup (trash_empty_file, text);
       g_free (text);
       g_free (text_tmp);
-      g_free (tmp);
 
       /* unhide the labels */
       gtk_widget_show_all (GTK_WIDGET (trash_empty_dialog));
     }
 
-  trash_empty_current_file = NULL;
-  g_object_unref (file);
-
-  trash_empty_update_pending = FALSE;
+  g_object_unref (dir);
+  g_free (name);
 
-  return FALSE;
+  return G_SOURCE_CONTINUE;
 }
 
 static void
@@ -119,36 +141,108 @@ trash_empty_done (GObject      *source_object,
                   GAsyncResult *res,
                   gpointer      user_data)
 {
+  g_source_remove (trash_empty_update_id);
+  trash_empty_update_id = 0;
+
+  g_clear_object (&trash_empty_current_dir);
+  g_clear_pointer (&trash_empty_current_name, g_free);
+
   gtk_widget_destroy (GTK_WIDGET (trash_empty_dialog));
 
   g_assert (trash_empty_dialog == NULL);
 }
 
 /* =============== worker thread code begins here =============== */
+/* Hands the file being removed to the dialog, if the next frame wants
+ * one; otherwise this is a single atomic read. */
+static void
+trash_empty_maybe_schedule_update (GFile      *dir,
+                                   const char *name)
+{
+  if (!g_atomic_int_get (&trash_empty_want_current) ||
+      !g_atomic_int_compare_and_exchange (&trash_empty_want_current, TRUE, FALSE))
+    return;
+
+  G_LOCK (trash_empty_current);
+  g_clear_object (&trash_empty_current_dir);
+  g_free (trash_empty_current_name);
+  trash_empty_current_dir = g_object_ref (dir);
+  trash_empty_current_name = g_strdup (name);
+  G_UNLOCK (trash_empty_current);
+}
+
+typedef struct
+{
+  GCancellable *cancellable;
+  const char   *trash_dir;     /* the trash directory emptied directly */
+  GFile        *local_trash;   /* for display, while it is emptied */
+  int           files_fd;      /* its files and info directories */
+  int           info_fd;
+} TrashEmptyJob;
+
+/* Deletes the contents of a directory of a local trash, and then the
+ * entry itself, with no round trip through GVfs. */
 static void
-trash_empty_maybe_schedule_update (GFile           *file,
-                                   gsize            deleted)
+trash_empty_delete_local (TrashEmptyJob *job,
+                          GFile         *parent,
+                          int            parent_fd,
+                          const char    *name,
+                          gboolean       maybe_dir)
 {
-  if (!trash_empty_update_pending)
+  int fd = -1;
+
+  if (maybe_dir)
+    fd = openat (parent_fd, name,
+                 O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+  if (fd >= 0)
     {
-      g_assert (trash_empty_current_file == NULL);
+      GFile *dir;
+      DIR *stream;
+      struct dirent *entry;
 
-      trash_empty_current_file = g_object_ref (file);
-      trash_empty_deleted_files = deleted;
+      stream = fdopendir (fd);
+      if (stream == NULL)
+        {
+          close (fd);
+          return;
+        }
+
+      dir = g_file_get_child (parent, name);
+
+      while ((entry = readdir (stream)) != NULL &&
+             !g_cancellable_is_cancelled (job->cancellable))
+        {
+          if (strcmp (entry->d_name, ".") == 0 ||
+              strcmp (entry->d_name, "..") == 0)
+            continue;
 
-      trash_empty_update_pending = TRUE;
-      g_main_context_invoke (NULL, trash_empty_update_dialog, NULL);
+          trash_empty_delete_local (job, dir, dirfd (stream), entry->d_name,
+                                    entry->d_type == DT_DIR ||
+                                    entry->d_type == DT_UNKNOWN);
+        }
+
+      closedir (stream);
+      g_object_unref (dir);
+
+      if (unlinkat (parent_fd, name, AT_REMOVEDIR) == 0)
+        g_atomic_int_inc (&trash_empty_deleted_files);
+    }
+  else
+    {
+      trash_empty_maybe_schedule_update (parent, name);
+
+      if (unlinkat (parent_fd, name, 0) == 0)
+        g_atomic_int_inc (&trash_empty_deleted_files);
     }
 }
 
 static void
 trash_empty_delete_contents (GCancellable    *cancellable,
-                             GFile           *file,
-                             gboolean         actually_delete,
-                             gsize           *deleted)
+                             GFile           *file)
 {
   GFileEnumerator *enumerator;
-  GFileInfo *info;
+  GList *infos, *l;
   GFile *child;
 
   if (g_cancellable_is_cancelled (cancellable))
@@ -161,25 +255,31 @@ trash_empty_delete_contents (GCancellable    *cancellable,
                                           cancellable, NULL);
   if (enumerator)
     {
-      while ((info = g_file_enumerator_next_file (enumerator,
-                                                  cancellable, NULL)) != NULL)
+      while ((infos = g_file_enumerator_next_files (enumerator,
+                                                    TRASH_EMPTY_BATCH,
+                                                    cancellable, NULL)) != NULL)
         {
-          child = g_file_get_child (file, g_file_info_get_name (info));
+          for (l = infos; l != NULL; l = l->next)
+            {
+              GFileInfo *info = l->data;
 
-          if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-            trash_empty_delete_contents (cancellable, child,
-                                         actually_delete, deleted);
+              if (g_cancellable_is_cancelled (cancellable))
+                break;
 
-          if (actually_delete)
-            {
-              trash_empty_maybe_schedule_update (child, *deleted);
-              g_file_delete (child, cancellable, NULL);
-            }
+              child = g_file_get_child (file, g_file_info_get_name (info));
 
-          (*deleted)++;
+              if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+                trash_empty_delete_contents (cancellable, child);
 
-          g_object_unref (child);
-          g_object_unref (info);
+              trash_empty_maybe_schedule_update (file,
+                                                 g_file_info_get_name (info));
+              if (g_file_delete (child, cancellable, NULL))
+                g_atomic_int_inc (&trash_empty_deleted_files);
+
+              g_object_unref (child);
+            }
+
+          g_list_free_full (infos, g_object_unref);
 
           if (g_cancellable_is_cancelled (cancellable))
             break;
@@ -189,25 +289,194 @@ trash_empty_delete_contents (GCancellable    *cancellable,
     }
 }
 
+/* Deletes one top level entry of the trash through GVfs, in a worker of
+ * the pool */
+static void
+trash_empty_delete_entry (gpointer data,
+                          gpointer user_data)
+{
+  TrashEmptyJob *job = user_data;
+  GFile *file = data;
+
+  if (!g_cancellable_is_cancelled (job->cancellable))
+    {
+      GFile *parent = g_file_get_parent (file);
+      char *name = g_file_get_basename (file);
+
+      trash_empty_delete_contents (job->cancellable, file);
+      trash_empty_maybe_schedule_update (parent, name);
+      if (g_file_delete (file, job->cancellable, NULL))
+        g_atomic_int_inc (&trash_empty_deleted_files);
+
+      g_object_unref (parent);
+      g_free (name);
+    }
+
+  g_atomic_int_inc (&trash_empty_done_entries);
+  g_object_unref (file);
+}
+
+/* Deletes one top level entry of a local trash and its trashinfo, in a
+ * worker of the pool */
+static void
+trash_empty_delete_local_entry (gpointer data,
+                                gpointer user_data)
+{
+  TrashEmptyJob *job = user_data;
+  char *name = data;
+
+  if (!g_cancellable_is_cancelled (job->cancellable))
+    {
+      char *trashinfo = g_strconcat (name, ".trashinfo", NULL);
+      struct stat buf;
+
+      trash_empty_delete_local (job, job->local_trash, job->files_fd,
+                                name, TRUE);
+      /* an entry that is not gone is left to GVfs */
+      if (fstatat (job->files_fd, name, &buf, AT_SYMLINK_NOFOLLOW) != 0)
+        unlinkat (job->info_fd, trashinfo, 0);
+
+      g_free (trashinfo);
+    }
+
+  g_atomic_int_inc (&trash_empty_done_entries);
+  g_free (name);
+}
+
+static GThreadPool *
+trash_empty_new_pool (GFunc          func,
+                      TrashEmptyJob *job)
+{
+  return g_thread_pool_new (func, job,
+                            MIN (TRASH_EMPTY_WORKERS, g_get_num_processors ()),
+                            TRUE, NULL);
+}
+
+/* Empties a trash directory through its files and info directories,
+ * which is much faster for large trees than GVfs. */
+static void
+trash_empty_local (TrashEmptyJob *job)
+{
+  GThreadPool *pool;
+  struct dirent *entry;
+  DIR *stream;
+  int fd;
+
+  fd = open (job->trash_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  job->files_fd = openat (fd, "files", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  job->info_fd = openat (fd, "info", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  close (fd);
+
+  if (job->files_fd < 0 || job->info_fd < 0)
+    goto out;
+
+  /* the entries are read from a descriptor of their own, the workers
+   * use files_fd */
+  fd = dup (job->files_fd);
+  stream = fd >= 0 ? fdopendir (fd) : NULL;
+  if (stream == NULL)
+    {
+      if (fd >= 0)
+        close (fd);
+      goto out;
+    }
+
+  job->local_trash = g_file_new_for_uri ("trash:///");
+  pool = trash_empty_new_pool (trash_empty_delete_local_entry, job);
+
+  while ((entry = readdir (stream)) != NULL &&
+         !g_cancellable_is_cancelled (job->cancellable))
+    {
+      if (strcmp (entry->d_name, ".") == 0 ||
+          strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      g_atomic_int_inc (&trash_empty_seen_entries);
+      g_thread_pool_push (pool, g_strdup (entry->d_name), NULL);
+    }
+
+  closedir (stream);
+
+  /* wait for the workers to finish */
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_clear_object (&job->local_trash);
+
+out:
+  if (job->files_fd >= 0)
+    close (job->files_fd);
+  if (job->info_fd >= 0)
+    close (job->info_fd);
+  job->files_fd = job->info_fd = -1;
+}
+
 static void
 trash_empty_job (GTask        *task,
                  gpointer      source_object,
                  gpointer      user_data,
                  GCancellable *cancellable)
 {
-  gsize deleted;
+  TrashEmptyJob job = { cancellable, user_data, NULL, -1, -1 };
+  GFileEnumerator *enumerator;
+  GThreadPool *pool;
+  GList *infos, *l;
   GFile *trash;
+  char *home;
+
+  g_atomic_int_set (&trash_empty_deleted_files, 0);
+  g_atomic_int_set (&trash_empty_seen_entries, 0);
+  g_atomic_int_set (&trash_empty_done_entries, 0);
+
+  /* the trash of a single volume is all local */
+  if (job.trash_dir)
+    {
+      trash_empty_local (&job);
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  /* the home trash first, directly */
+  home = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+  job.trash_dir = home;
+  trash_empty_local (&job);
+  g_free (home);
 
+  /* then whatever is left, of other volumes, through GVfs, in a single
+   * pass; the progress is estimated as the entries go */
   trash = g_file_new_for_uri ("trash:///");
+  enumerator = g_file_enumerate_children (trash,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable, NULL);
+  if (enumerator)
+    {
+      pool = trash_empty_new_pool (trash_empty_delete_entry, &job);
 
-  /* first do a dry run to count the number of files */
-  deleted = 0;
-  trash_empty_delete_contents (cancellable, trash, FALSE, &deleted);
-  trash_empty_total_files = deleted;
+      while ((infos = g_file_enumerator_next_files (enumerator,
+                                                    TRASH_EMPTY_BATCH,
+                                                    cancellable, NULL)) != NULL)
+        {
+          for (l = infos; l != NULL; l = l->next)
+            {
+              GFileInfo *info = l->data;
 
-  /* now do the real thing */
-  deleted = 0;
-  trash_empty_delete_contents (cancellable, trash, TRUE, &deleted);
+              g_atomic_int_inc (&trash_empty_seen_entries);
+              g_thread_pool_push (pool,
+                                  g_file_get_child (trash,
+                                                    g_file_info_get_name (info)),
+                                  NULL);
+            }
+
+          g_list_free_full (infos, g_object_unref);
+        }
+
+      g_object_unref (enumerator);
+
+      /* wait for the workers to finish */
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
 
   /* done */
   g_object_unref (trash);
@@ -216,7 +485,8 @@ trash_empty_job (GTask        *task,
 /* ================ worker thread code ends here ================ */
 
 static void
-trash_empty_start (GtkWidget *parent)
+trash_empty_start (GtkWidget  *parent,
+                   const char *trash_dir)
 {
   struct { const char *name; gpointer *pointer; } widgets[] =
     {
@@ -259,7 +529,12 @@ trash_empty_start (GtkWidget *parent)
                            G_CALLBACK (g_cancellable_cancel),
                            cancellable, G_CONNECT_SWAPPED);
 
+  g_atomic_int_set (&trash_empty_want_current, TRUE);
+  trash_empty_update_id = g_timeout_add (TRASH_EMPTY_UPDATE_INTERVAL,
+                                         trash_empty_update_dialog, NULL);
+
   task = g_task_new (parent, cancellable, trash_empty_done, NULL);
+  g_task_set_task_data (task, g_strdup (trash_dir), g_free);
   g_task_run_in_thread (task, trash_empty_job);
   g_object_unref (task);
   g_object_unref (cancellable);
@@ -285,8 +560,10 @@ trash_empty_confirmation_response (GtkDialog *dialog,
                                    gint       response_id,
                                    gpointer   user_data)
 {
+  const char *trash_dir = user_data;
+
   if (response_id == GTK_RESPONSE_YES)
-    trash_empty_start (GTK_WIDGET (dialog));
+    trash_empty_start (GTK_WIDGET (dialog), trash_dir);
 
   gtk_widget_destroy (GTK_WIDGET (dialog));
   g_assert (trash_empty_confirm_dialog == NULL);
@@ -298,7 +575,8 @@ trash_empty_confirmation_response (GtkDialog *dialog,
  * by Michiel Sikkes <michiel@eyesopened.nl> and adapted for the applet.
  */
 static void
-trash_empty_show_confirmation_dialog (GtkWidget *parent)
+trash_empty_show_confirmation_dialog (GtkWidget  *parent,
+                                      const char *trash_dir)
 {
   GtkWidget *dialog;
   GtkWidget *button;
@@ -306,7 +584,7 @@ trash_empty_show_confirmation_dialog (GtkWidget *parent)
 
   if (!trash_empty_require_confirmation ())
     {
-      trash_empty_start (parent);
+      trash_empty_start (parent, trash_dir);
       return;
     }
 
@@ -347,19 +625,25 @@ trash_empty_show_confirmation_dialog (GtkWidget *parent)
 
   gtk_widget_show (dialog);
 
-  g_signal_connect (dialog, "response",
-                    G_CALLBACK (trash_empty_confirmation_response), NULL);
+  g_signal_connect_data (dialog, "response",
+                         G_CALLBACK (trash_empty_confirmation_response),
+                         g_strdup (trash_dir), (GClosureNotify) g_free, 0);
 }
 
 void
 trash_empty (GtkWidget *parent)
+{
+  trash_empty_volume (parent, NULL);
+}
+
+void
+trash_empty_volume (GtkWidget  *parent,
+                    const char *trash_dir)
 {
   if (trash_empty_confirm_dialog)
     gtk_window_present (GTK_WINDOW (trash_empty_confirm_dialog));
   else if (trash_empty_dialog)
     gtk_window_present (GTK_WINDOW (trash_empty_dialog));
-
-  /* theoretically possible that an update is pending, but very unlikely. */
-  else if (!trash_empty_update_pending)
-    trash_empty_show_confirmation_dialog (parent);
+  else
+    trash_empty_show_confirmation_dialog (parent, trash_dir);
 }
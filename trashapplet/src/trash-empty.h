@@ -24,6 +24,9 @@
 
 #include <gtk/gtk.h>
 
-void trash_empty (GtkWidget *parent);
+void trash_empty        (GtkWidget  *parent);
+/* empties only the trash directory of one volume, NULL for all */
+void trash_empty_volume (GtkWidget  *parent,
+                         const char *trash_dir);
 
 #endif /* _trash_empty_h_ */
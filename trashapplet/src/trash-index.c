@@ -0,0 +1,511 @@
+/*
+ * trash-index.c: the sizes of the trash directories
+ *
+ * Copyright © 2021 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <gio/gio.h>
+#include <gio/gunixmounts.h>
+#include <glib/gi18n.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trash-index.h"
+#include "config.h"
+
+/* how long changes are collected before the new entries are sized */
+#define TRASH_INDEX_DELAY 250
+
+/* the size of an entry that is gone */
+#define TRASH_INDEX_GONE G_MAXUINT64
+
+typedef struct
+{
+  TrashIndexVolume  public;
+  TrashIndex       *index;
+  GFileMonitor     *monitor;
+  GHashTable       *entries;      /* name -> guint64 *bytes */
+  GHashTable       *pending;      /* names to size again */
+  guint             pending_id;
+  GCancellable     *cancellable;  /* while a sizing runs */
+} TrashVolume;
+
+struct _TrashIndex
+{
+  GPtrArray         *volumes;     /* the home trash first */
+  GUnixMountMonitor *mount_monitor;
+  GFunc              changed;
+  gpointer           user_data;
+};
+
+static void trash_volume_size (TrashVolume *volume,
+                               GHashTable  *names);
+
+/* =============== worker thread code begins here =============== */
+static guint64 *
+trash_index_bytes_new (guint64 bytes)
+{
+  guint64 *copy = g_new (guint64, 1);
+
+  *copy = bytes;
+
+  return copy;
+}
+
+static guint64
+trash_index_du (int         parent_fd,
+                const char *name)
+{
+  struct stat buf;
+  guint64 bytes;
+  DIR *stream;
+  struct dirent *entry;
+  int fd;
+
+  if (fstatat (parent_fd, name, &buf, AT_SYMLINK_NOFOLLOW) != 0)
+    return TRASH_INDEX_GONE;
+
+  if (!S_ISDIR (buf.st_mode))
+    return buf.st_size;
+
+  bytes = 0;
+  fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  stream = fd >= 0 ? fdopendir (fd) : NULL;
+  if (stream == NULL)
+    {
+      if (fd >= 0)
+        close (fd);
+      return bytes;
+    }
+
+  while ((entry = readdir (stream)) != NULL)
+    {
+      guint64 child;
+
+      if (strcmp (entry->d_name, ".") == 0 ||
+          strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      child = trash_index_du (dirfd (stream), entry->d_name);
+      if (child != TRASH_INDEX_GONE)
+        bytes += child;
+    }
+
+  closedir (stream);
+
+  return bytes;
+}
+
+/* Sizes the given entries of a files/ directory, or all of them if
+ * there are none given */
+static void
+trash_index_size_job (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  char *path = g_object_get_data (G_OBJECT (task), "path");
+  GHashTable *names = task_data;
+  GHashTable *sizes;
+  int fd;
+
+  sizes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      if (names == NULL)
+        {
+          int dup_fd = dup (fd);
+          DIR *stream = dup_fd >= 0 ? fdopendir (dup_fd) : NULL;
+          struct dirent *entry;
+
+          if (stream == NULL && dup_fd >= 0)
+            close (dup_fd);
+
+          while (stream && (entry = readdir (stream)) != NULL &&
+                 !g_cancellable_is_cancelled (cancellable))
+            {
+              if (strcmp (entry->d_name, ".") == 0 ||
+                  strcmp (entry->d_name, "..") == 0)
+                continue;
+
+              g_hash_table_insert (sizes, g_strdup (entry->d_name),
+                                   trash_index_bytes_new (trash_index_du (fd, entry->d_name)));
+            }
+
+          if (stream)
+            closedir (stream);
+        }
+      else
+        {
+          GHashTableIter iter;
+          gpointer name;
+
+          g_hash_table_iter_init (&iter, names);
+          while (g_hash_table_iter_next (&iter, &name, NULL) &&
+                 !g_cancellable_is_cancelled (cancellable))
+            g_hash_table_insert (sizes, g_strdup (name),
+                                 trash_index_bytes_new (trash_index_du (fd, name)));
+        }
+
+      close (fd);
+    }
+
+  g_task_return_pointer (task, sizes, (GDestroyNotify) g_hash_table_unref);
+}
+/* ================ worker thread code ends here ================ */
+
+static void
+trash_volume_set_entry (TrashVolume *volume,
+                        const char  *name,
+                        guint64      bytes)
+{
+  guint64 *old = g_hash_table_lookup (volume->entries, name);
+
+  if (old)
+    {
+      volume->public.bytes -= *old;
+      volume->public.items--;
+    }
+
+  if (bytes == TRASH_INDEX_GONE)
+    {
+      g_hash_table_remove (volume->entries, name);
+      return;
+    }
+
+  g_hash_table_insert (volume->entries, g_strdup (name),
+                       trash_index_bytes_new (bytes));
+  volume->public.bytes += bytes;
+  volume->public.items++;
+}
+
+static void
+trash_volume_size_done (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  TrashVolume *volume = user_data;
+  GHashTable *sizes;
+  GHashTableIter iter;
+  gpointer name, bytes;
+  gboolean all;
+
+  sizes = g_task_propagate_pointer (G_TASK (result), NULL);
+  all = g_task_get_task_data (G_TASK (result)) == NULL;
+
+  /* the volume is gone */
+  if (sizes == NULL || g_cancellable_is_cancelled (g_task_get_cancellable (G_TASK (result))))
+    {
+      if (sizes)
+        g_hash_table_unref (sizes);
+      return;
+    }
+
+  g_clear_object (&volume->cancellable);
+
+  if (all)
+    {
+      g_hash_table_remove_all (volume->entries);
+      volume->public.bytes = 0;
+      volume->public.items = 0;
+    }
+
+  g_hash_table_iter_init (&iter, sizes);
+  while (g_hash_table_iter_next (&iter, &name, &bytes))
+    trash_volume_set_entry (volume, name, *(guint64 *) bytes);
+  g_hash_table_unref (sizes);
+
+  /* the changes that came in meanwhile */
+  if (volume->pending && !volume->pending_id)
+    trash_volume_size (volume, g_steal_pointer (&volume->pending));
+
+  volume->index->changed (volume->index, volume->index->user_data);
+}
+
+/* Sizes the names, all entries if NULL, in a thread */
+static void
+trash_volume_size (TrashVolume *volume,
+                   GHashTable  *names)
+{
+  GTask *task;
+
+  volume->cancellable = g_cancellable_new ();
+
+  task = g_task_new (NULL, volume->cancellable, trash_volume_size_done, volume);
+  g_task_set_task_data (task, names, names ? (GDestroyNotify) g_hash_table_unref : NULL);
+  g_object_set_data_full (G_OBJECT (task), "path",
+                          g_build_filename (volume->public.path, "files", NULL),
+                          g_free);
+  g_task_run_in_thread (task, trash_index_size_job);
+  g_object_unref (task);
+}
+
+static gboolean
+trash_volume_size_pending (gpointer user_data)
+{
+  TrashVolume *volume = user_data;
+
+  volume->pending_id = 0;
+
+  /* one sizing at a time, the next one starts when it is done */
+  if (!volume->cancellable)
+    trash_volume_size (volume, g_steal_pointer (&volume->pending));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+trash_volume_changed (GFileMonitor      *monitor,
+                      GFile             *file,
+                      GFile             *other_file,
+                      GFileMonitorEvent  event,
+                      TrashVolume       *volume)
+{
+  gboolean removed = FALSE;
+  char *name;
+
+  switch (event)
+    {
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+      removed = TRUE;
+      break;
+
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      /* the old name is gone, the new one is sized */
+      name = g_file_get_basename (file);
+      trash_volume_set_entry (volume, name, TRASH_INDEX_GONE);
+      g_free (name);
+      if (other_file == NULL)
+        return;
+      file = other_file;
+      break;
+
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+      break;
+
+    default:
+      return;
+    }
+
+  name = g_file_get_basename (file);
+
+  if (removed)
+    {
+      trash_volume_set_entry (volume, name, TRASH_INDEX_GONE);
+      volume->index->changed (volume->index, volume->index->user_data);
+    }
+
+  /* a sizing in flight may still see it, so it is checked again */
+  if (!volume->pending)
+    volume->pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, NULL);
+  g_hash_table_add (volume->pending, name);
+
+  if (!volume->pending_id)
+    volume->pending_id = g_timeout_add (TRASH_INDEX_DELAY,
+                                        trash_volume_size_pending, volume);
+}
+
+static TrashVolume *
+trash_volume_new (TrashIndex *index,
+                  const char *name,
+                  const char *path)
+{
+  TrashVolume *volume;
+  GFile *files;
+  char *files_path;
+
+  volume = g_new0 (TrashVolume, 1);
+  volume->index = index;
+  volume->public.name = g_strdup (name);
+  volume->public.path = g_strdup (path);
+  volume->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, g_free);
+
+  files_path = g_build_filename (path, "files", NULL);
+  files = g_file_new_for_path (files_path);
+  g_free (files_path);
+
+  volume->monitor = g_file_monitor_directory (files, G_FILE_MONITOR_WATCH_MOVES,
+                                              NULL, NULL);
+  if (volume->monitor)
+    g_signal_connect (volume->monitor, "changed",
+                      G_CALLBACK (trash_volume_changed), volume);
+  g_object_unref (files);
+
+  trash_volume_size (volume, NULL);
+
+  return volume;
+}
+
+static void
+trash_volume_free (TrashVolume *volume)
+{
+  if (volume->cancellable)
+    {
+      /* the sizing finds it cancelled and leaves the volume alone */
+      g_cancellable_cancel (volume->cancellable);
+      g_object_unref (volume->cancellable);
+    }
+
+  if (volume->pending_id)
+    g_source_remove (volume->pending_id);
+
+  if (volume->monitor)
+    {
+      g_signal_handlers_disconnect_by_data (volume->monitor, volume);
+      g_file_monitor_cancel (volume->monitor);
+      g_object_unref (volume->monitor);
+    }
+
+  if (volume->pending)
+    g_hash_table_unref (volume->pending);
+  g_hash_table_unref (volume->entries);
+  g_free (volume->public.name);
+  g_free (volume->public.path);
+  g_free (volume);
+}
+
+/* Returns the trash directory of a mount point, if it has one */
+static char *
+trash_index_find_trash (const char *mount_path)
+{
+  char *uid, *path;
+
+  uid = g_strdup_printf ("%lu", (gulong) getuid ());
+
+  path = g_build_filename (mount_path, ".Trash", uid, NULL);
+  if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+    {
+      char *dir = g_strconcat (".Trash-", uid, NULL);
+
+      g_free (path);
+      path = g_build_filename (mount_path, dir, NULL);
+      g_free (dir);
+
+      if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+        g_clear_pointer (&path, g_free);
+    }
+
+  g_free (uid);
+
+  return path;
+}
+
+/* Adds the volumes of new mounts with a trash, and drops the ones of
+ * mounts that are gone */
+static void
+trash_index_update_mounts (TrashIndex *index)
+{
+  GHashTable *trashes;
+  GList *mounts, *l;
+  guint i;
+
+  trashes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  mounts = g_unix_mounts_get (NULL);
+  for (l = mounts; l != NULL; l = l->next)
+    {
+      GUnixMountEntry *mount = l->data;
+      char *path;
+
+      if (!g_unix_mount_is_system_internal (mount) &&
+          (path = trash_index_find_trash (g_unix_mount_get_mount_path (mount))))
+        g_hash_table_insert (trashes, path, g_unix_mount_guess_name (mount));
+    }
+  g_list_free_full (mounts, (GDestroyNotify) g_unix_mount_free);
+
+  /* the volumes that stay are kept with their sizes */
+  for (i = index->volumes->len - 1; i > 0; i--)
+    {
+      TrashVolume *volume = g_ptr_array_index (index->volumes, i);
+
+      if (!g_hash_table_remove (trashes, volume->public.path))
+        g_ptr_array_remove_index (index->volumes, i);
+    }
+
+  {
+    GHashTableIter iter;
+    gpointer path, name;
+
+    g_hash_table_iter_init (&iter, trashes);
+    while (g_hash_table_iter_next (&iter, &path, &name))
+      g_ptr_array_add (index->volumes, trash_volume_new (index, name, path));
+  }
+
+  g_hash_table_unref (trashes);
+
+  index->changed (index, index->user_data);
+}
+
+TrashIndex *
+trash_index_new (GFunc    changed,
+                 gpointer user_data)
+{
+  TrashIndex *index;
+  char *path;
+
+  index = g_new0 (TrashIndex, 1);
+  index->changed = changed;
+  index->user_data = user_data;
+  index->volumes = g_ptr_array_new_with_free_func ((GDestroyNotify) trash_volume_free);
+
+  path = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+  g_ptr_array_add (index->volumes, trash_volume_new (index, _("Home"), path));
+  g_free (path);
+
+  index->mount_monitor = g_unix_mount_monitor_get ();
+  g_signal_connect_swapped (index->mount_monitor, "mounts-changed",
+                            G_CALLBACK (trash_index_update_mounts), index);
+  trash_index_update_mounts (index);
+
+  return index;
+}
+
+void
+trash_index_free (TrashIndex *index)
+{
+  g_signal_handlers_disconnect_by_data (index->mount_monitor, index);
+  g_object_unref (index->mount_monitor);
+  g_ptr_array_unref (index->volumes);
+  g_free (index);
+}
+
+guint
+trash_index_get_n_volumes (TrashIndex *index)
+{
+  return index->volumes->len;
+}
+
+const TrashIndexVolume *
+trash_index_get_volume (TrashIndex *index,
+                        guint       i)
+{
+  TrashVolume *volume = g_ptr_array_index (index->volumes, i);
+
+  return &volume->public;
+}
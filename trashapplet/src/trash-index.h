@@ -0,0 +1,53 @@
+/*
+ * trash-index.h: the sizes of the trash directories
+ *
+ * Copyright © 2021 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _trash_index_h_
+#define _trash_index_h_
+
+#include <glib.h>
+
+/* The trash directories of the home directory and of the mounted
+ * volumes, with the bytes in each.
+ *
+ * The entries of each files/ directory are sized once, in a thread, and
+ * then kept current from a monitor of the directory, so a change only
+ * costs sizing the entries that came in.
+ */
+
+typedef struct _TrashIndex TrashIndex;
+
+typedef struct
+{
+  char    *name;      /* the volume, for display */
+  char    *path;      /* the trash directory, with files/ and info/ */
+  guint64  bytes;     /* the size of what is in files/ */
+  guint    items;
+} TrashIndexVolume;
+
+TrashIndex *trash_index_new          (GFunc       changed,
+                                      gpointer    user_data);
+void        trash_index_free         (TrashIndex *index);
+
+guint                   trash_index_get_n_volumes (TrashIndex *index);
+const TrashIndexVolume *trash_index_get_volume    (TrashIndex *index,
+                                                   guint       i);
+
+#endif /* _trash_index_h_ */
@@ -0,0 +1,375 @@
+/*
+ * trash-purge.c: remove what has been in the trash for too long
+ *
+ * Copyright © 2021 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <gio/gio.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "trash-purge.h"
+#include "config.h"
+
+#define TRASH_PURGE_SCHEMA  "org.mate.panel.applet.trash"
+#define TRASH_PURGE_AGE_KEY "purge-age"
+
+/* the first pass waits for the session to settle, in seconds, and the
+ * next ones come at this interval */
+#define TRASH_PURGE_DELAY    60
+#define TRASH_PURGE_INTERVAL 3600
+
+/* how many trashinfo files are read or files deleted between pauses,
+ * and how long a pause is, in microseconds */
+#define TRASH_PURGE_BATCH 32
+#define TRASH_PURGE_PAUSE (100 * 1000)
+
+/* from <linux/ioprio.h>, which not every libc installs */
+#define TRASH_PURGE_IOPRIO_WHO_PROCESS 1
+#define TRASH_PURGE_IOPRIO_CLASS_IDLE  3
+#define TRASH_PURGE_IOPRIO_CLASS_SHIFT 13
+
+struct _TrashPurge
+{
+  TrashIndex   *index;
+  GSettings    *settings;
+  guint         age;          /* in days, 0 while off */
+  guint         pass_id;
+  GCancellable *cancellable;  /* while a pass runs */
+};
+
+typedef struct
+{
+  TrashPurge   *purge;        /* not to be touched once cancelled */
+  GCancellable *cancellable;
+  char        **paths;        /* the trash directories */
+  gint64        cutoff;       /* what was trashed before is deleted */
+  guint         budget;       /* what is left of the batch */
+  guint         purged;
+} TrashPurgeJob;
+
+static void trash_purge_schedule (TrashPurge *purge,
+                                  guint       delay);
+
+/* =============== worker thread code begins here =============== */
+/* Only the calling thread is lowered, it is its own */
+static void
+trash_purge_set_idle_priority (void)
+{
+#if defined (__linux__) && defined (SYS_ioprio_set)
+  syscall (SYS_ioprio_set, TRASH_PURGE_IOPRIO_WHO_PROCESS, 0,
+           TRASH_PURGE_IOPRIO_CLASS_IDLE << TRASH_PURGE_IOPRIO_CLASS_SHIFT);
+#endif
+}
+
+/* Counts one unit of work, and pauses at the end of a batch */
+static void
+trash_purge_spend (TrashPurgeJob *job)
+{
+  if (--job->budget > 0)
+    return;
+
+  job->budget = TRASH_PURGE_BATCH;
+  g_usleep (TRASH_PURGE_PAUSE);
+}
+
+static void
+trash_purge_remove (TrashPurgeJob *job,
+                    int            parent_fd,
+                    const char    *name)
+{
+  int fd;
+
+  fd = openat (parent_fd, name,
+               O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      DIR *stream;
+      struct dirent *entry;
+
+      stream = fdopendir (fd);
+      if (stream == NULL)
+        {
+          close (fd);
+          return;
+        }
+
+      while ((entry = readdir (stream)) != NULL &&
+             !g_cancellable_is_cancelled (job->cancellable))
+        {
+          if (strcmp (entry->d_name, ".") == 0 ||
+              strcmp (entry->d_name, "..") == 0)
+            continue;
+
+          trash_purge_remove (job, dirfd (stream), entry->d_name);
+        }
+
+      closedir (stream);
+      unlinkat (parent_fd, name, AT_REMOVEDIR);
+    }
+  else
+    unlinkat (parent_fd, name, 0);
+
+  trash_purge_spend (job);
+}
+
+/* The DeletionDate of a trashinfo file, in local time as the
+ * specification has it, or -1 */
+static gint64
+trash_purge_read_date (int         info_fd,
+                       const char *name)
+{
+  char buffer[4096];
+  const char *line;
+  GDateTime *date;
+  gint64 seconds;
+  ssize_t len;
+  int year, month, day, hour, minute, second;
+  int fd;
+
+  fd = openat (info_fd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  len = read (fd, buffer, sizeof buffer - 1);
+  close (fd);
+  if (len <= 0)
+    return -1;
+  buffer[len] = '\0';
+
+  /* the key is never on the first line, that is the group */
+  line = strstr (buffer, "\nDeletionDate=");
+  if (line == NULL ||
+      sscanf (line + strlen ("\nDeletionDate="), "%d-%d-%dT%d:%d:%d",
+              &year, &month, &day, &hour, &minute, &second) != 6)
+    return -1;
+
+  date = g_date_time_new_local (year, month, day, hour, minute, second);
+  if (date == NULL)
+    return -1;
+
+  seconds = g_date_time_to_unix (date);
+  g_date_time_unref (date);
+
+  return seconds;
+}
+
+/* Deletes the entries of one trash directory that are too old, the one
+ * in files/ first and its trashinfo once it is gone */
+static void
+trash_purge_directory (TrashPurgeJob *job,
+                       const char    *path)
+{
+  struct dirent *entry;
+  DIR *stream;
+  int fd, files_fd, info_fd;
+
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  files_fd = openat (fd, "files", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  info_fd = openat (fd, "info", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  close (fd);
+
+  /* the entries are read from a descriptor of their own */
+  fd = info_fd >= 0 && files_fd >= 0 ? dup (info_fd) : -1;
+  stream = fd >= 0 ? fdopendir (fd) : NULL;
+  if (stream == NULL && fd >= 0)
+    close (fd);
+
+  while (stream && (entry = readdir (stream)) != NULL &&
+         !g_cancellable_is_cancelled (job->cancellable))
+    {
+      struct stat buf;
+      gint64 date;
+      char *name;
+
+      if (!g_str_has_suffix (entry->d_name, ".trashinfo"))
+        continue;
+
+      date = trash_purge_read_date (info_fd, entry->d_name);
+      trash_purge_spend (job);
+
+      if (date < 0 || date >= job->cutoff)
+        continue;
+
+      name = g_strndup (entry->d_name,
+                        strlen (entry->d_name) - strlen (".trashinfo"));
+
+      trash_purge_remove (job, files_fd, name);
+
+      /* an entry that is not gone keeps its trashinfo */
+      if (fstatat (files_fd, name, &buf, AT_SYMLINK_NOFOLLOW) != 0 &&
+          errno == ENOENT &&
+          unlinkat (info_fd, entry->d_name, 0) == 0)
+        job->purged++;
+
+      g_free (name);
+    }
+
+  if (stream)
+    closedir (stream);
+  if (files_fd >= 0)
+    close (files_fd);
+  if (info_fd >= 0)
+    close (info_fd);
+}
+
+static gboolean trash_purge_done (gpointer user_data);
+
+static gpointer
+trash_purge_thread (gpointer user_data)
+{
+  TrashPurgeJob *job = user_data;
+  guint i;
+
+  trash_purge_set_idle_priority ();
+
+  for (i = 0; job->paths[i] != NULL &&
+              !g_cancellable_is_cancelled (job->cancellable); i++)
+    trash_purge_directory (job, job->paths[i]);
+
+  g_idle_add (trash_purge_done, job);
+
+  return NULL;
+}
+/* ================ worker thread code ends here ================ */
+
+static gboolean
+trash_purge_done (gpointer user_data)
+{
+  TrashPurgeJob *job = user_data;
+
+  /* the purge is gone, or the setting changed */
+  if (!g_cancellable_is_cancelled (job->cancellable))
+    {
+      g_clear_object (&job->purge->cancellable);
+      g_debug ("Purged %u entries from the trash", job->purged);
+      trash_purge_schedule (job->purge, TRASH_PURGE_INTERVAL);
+    }
+
+  g_object_unref (job->cancellable);
+  g_strfreev (job->paths);
+  g_free (job);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+trash_purge_start (gpointer user_data)
+{
+  TrashPurge *purge = user_data;
+  TrashPurgeJob *job;
+  char **paths;
+  guint i, n;
+
+  purge->pass_id = 0;
+
+  n = trash_index_get_n_volumes (purge->index);
+  paths = g_new0 (char *, n + 1);
+  for (i = 0; i < n; i++)
+    paths[i] = g_strdup (trash_index_get_volume (purge->index, i)->path);
+
+  job = g_new0 (TrashPurgeJob, 1);
+  job->purge = purge;
+  job->cancellable = g_cancellable_new ();
+  job->paths = paths;
+  job->cutoff = g_get_real_time () / G_USEC_PER_SEC -
+                (gint64) purge->age * 24 * 60 * 60;
+  job->budget = TRASH_PURGE_BATCH;
+
+  purge->cancellable = g_object_ref (job->cancellable);
+
+  /* not a thread of the pool, which would keep the idle priority */
+  g_thread_unref (g_thread_new ("trash-purge", trash_purge_thread, job));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+trash_purge_schedule (TrashPurge *purge,
+                      guint       delay)
+{
+  if (purge->pass_id)
+    g_source_remove (purge->pass_id);
+  purge->pass_id = 0;
+
+  if (purge->age > 0 && purge->cancellable == NULL)
+    purge->pass_id = g_timeout_add_seconds (delay, trash_purge_start, purge);
+}
+
+static void
+trash_purge_stop (TrashPurge *purge)
+{
+  if (purge->cancellable)
+    {
+      /* the pass finds it cancelled and leaves the purge alone */
+      g_cancellable_cancel (purge->cancellable);
+      g_clear_object (&purge->cancellable);
+    }
+}
+
+static void
+trash_purge_age_changed (GSettings  *settings,
+                         const char *key,
+                         TrashPurge *purge)
+{
+  purge->age = g_settings_get_uint (settings, TRASH_PURGE_AGE_KEY);
+
+  /* a pass in flight has the old age, it starts over */
+  trash_purge_stop (purge);
+  trash_purge_schedule (purge, TRASH_PURGE_DELAY);
+}
+
+TrashPurge *
+trash_purge_new (TrashIndex *index)
+{
+  TrashPurge *purge;
+
+  purge = g_new0 (TrashPurge, 1);
+  purge->index = index;
+  purge->settings = g_settings_new (TRASH_PURGE_SCHEMA);
+  g_signal_connect (purge->settings, "changed::" TRASH_PURGE_AGE_KEY,
+                    G_CALLBACK (trash_purge_age_changed), purge);
+  trash_purge_age_changed (purge->settings, TRASH_PURGE_AGE_KEY, purge);
+
+  return purge;
+}
+
+void
+trash_purge_free (TrashPurge *purge)
+{
+  trash_purge_stop (purge);
+
+  if (purge->pass_id)
+    g_source_remove (purge->pass_id);
+
+  g_signal_handlers_disconnect_by_data (purge->settings, purge);
+  g_object_unref (purge->settings);
+  g_free (purge);
+}
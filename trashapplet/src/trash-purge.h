@@ -0,0 +1,42 @@
+/*
+ * trash-purge.h: remove what has been in the trash for too long
+ *
+ * Copyright © 2021 MATE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef _trash_purge_h_
+#define _trash_purge_h_
+
+#include "trash-index.h"
+
+/* While the purge-age setting is not 0, the trash directories of the
+ * index are gone through every so often, and the entries whose
+ * DeletionDate is older than that many days are deleted.
+ *
+ * A pass runs in a thread of its own with the idle I/O priority, and
+ * reads the info/ directories and deletes in small batches with pauses
+ * between them, so a full trash is cleared over a while rather than in
+ * one go.  The index and the monitor of trash:/ see the entries go.
+ */
+
+typedef struct _TrashPurge TrashPurge;
+
+TrashPurge *trash_purge_new  (TrashIndex *index);
+void        trash_purge_free (TrashPurge *purge);
+
+#endif /* _trash_purge_h_ */
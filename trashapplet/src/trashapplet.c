@@ -35,6 +35,8 @@
 #include <mate-panel-applet.h>
 
 #include "trash-empty.h"
+#include "trash-index.h"
+#include "trash-purge.h"
 
 #define TRASH_TYPE_APPLET (trash_applet_get_type ())
 
@@ -47,6 +49,11 @@ struct _TrashApplet
 
   GFileMonitor *trash_monitor;
   GFile *trash;
+  guint update_id;
+  GCancellable *query_cancellable; /* while a query is running */
+  gboolean update_again;
+  TrashIndex *index;
+  TrashPurge *purge;
 
   GtkImage *image;
   GIcon *icon;
@@ -57,6 +64,8 @@ G_DEFINE_TYPE (TrashApplet, trash_applet, PANEL_TYPE_APPLET);
 
 static void trash_applet_do_empty    (GtkAction   *action,
                                       TrashApplet *applet);
+static void trash_applet_empty_volume (GtkAction   *action,
+                                       TrashApplet *applet);
 static void trash_applet_show_about  (GtkAction   *action,
                                       TrashApplet *applet);
 static void trash_applet_open_folder (GtkAction   *action,
@@ -68,6 +77,9 @@ static const GtkActionEntry trash_applet_menu_actions [] = {
 	{ "EmptyTrash", "edit-clear", N_("_Empty Trash"),
 	  NULL, NULL,
 	  G_CALLBACK (trash_applet_do_empty) },
+	{ "EmptyVolumeTrash", "edit-clear", N_("Empty Trash on _Volume..."),
+	  NULL, NULL,
+	  G_CALLBACK (trash_applet_empty_volume) },
 	{ "OpenTrash", "document-open", N_("_Open Trash"),
 	  NULL, NULL,
 	  G_CALLBACK (trash_applet_open_folder) },
@@ -79,26 +91,98 @@ static const GtkActionEntry trash_applet_menu_actions [] = {
 	  G_CALLBACK (trash_applet_show_about) }
 };
 
+/* how long changes of the trash are collected before it is queried */
+#define TRASH_APPLET_UPDATE_DELAY 250
+
+static gboolean trash_applet_update (gpointer user_data);
+
+/* The item count of trash:/, then the bytes of each volume with
+ * something in its trash. */
 static void
-trash_applet_monitor_changed (TrashApplet *applet)
+trash_applet_update_tooltip (TrashApplet *applet)
+{
+  GString *text;
+  guint i, n;
+
+  if (applet->items < 0)
+    return;
+
+  text = g_string_new (NULL);
+
+  if (applet->items)
+    g_string_printf (text, ngettext ("%d Item in Trash",
+                                     "%d Items in Trash",
+                                     applet->items), applet->items);
+  else
+    g_string_assign (text, _("No Items in Trash"));
+
+  n = applet->index ? trash_index_get_n_volumes (applet->index) : 0;
+  for (i = 0; i < n && applet->items; i++)
+    {
+      const TrashIndexVolume *volume = trash_index_get_volume (applet->index, i);
+      char *size;
+
+      if (!volume->items)
+        continue;
+
+      size = g_format_size (volume->bytes);
+      g_string_append_c (text, '\n');
+      /* Translators: a volume name and the size of its trash */
+      g_string_append_printf (text, _("%s: %s"), volume->name, size);
+      g_free (size);
+    }
+
+  gtk_widget_set_tooltip_text (GTK_WIDGET (applet), text->str);
+  atk_object_set_description (gtk_widget_get_accessible (GTK_WIDGET (applet)),
+                              text->str);
+  g_string_free (text, TRUE);
+}
+
+static void
+trash_applet_index_changed (gpointer index,
+                            gpointer user_data)
+{
+  trash_applet_update_tooltip (TRASH_APPLET (user_data));
+}
+
+static void
+trash_applet_query_done (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
 {
+  TrashApplet *applet = user_data;
   GError *error = NULL;
   GFileInfo *info;
   GIcon *icon;
-  AtkObject *atk_obj;
   gint items;
 
-  info = g_file_query_info (applet->trash,
-                            G_FILE_ATTRIBUTE_STANDARD_ICON","
-                            G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT,
-                            0, NULL, &error);
+  info = g_file_query_info_finish (G_FILE (source), result, &error);
+
+  if (!info && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* the applet is going away */
+      g_error_free (error);
+      g_object_unref (applet);
+
+      return;
+    }
 
-  atk_obj = gtk_widget_get_accessible (GTK_WIDGET (applet));
+  g_clear_object (&applet->query_cancellable);
+
+  /* the trash changed while it was queried */
+  if (applet->update_again)
+    {
+      applet->update_again = FALSE;
+      if (!applet->update_id)
+        applet->update_id = g_timeout_add (TRASH_APPLET_UPDATE_DELAY,
+                                           trash_applet_update, applet);
+    }
 
   if (!info)
     {
       g_critical ("could not query trash:/: '%s'", error->message);
       g_error_free (error);
+      g_object_unref (applet);
 
       return;
     }
@@ -123,25 +207,48 @@ trash_applet_monitor_changed (TrashApplet *applet)
 
   if (items != applet->items)
     {
-      char *text;
+      applet->items = items;
+      trash_applet_update_tooltip (applet);
+    }
 
-      if (items)
-        {
-          text = g_strdup_printf (ngettext ("%d Item in Trash",
-                                            "%d Items in Trash",
-                                            items), items);
-        }
-      else
-        text = g_strdup (_("No Items in Trash"));
+  g_object_unref (info);
+  g_object_unref (applet);
+}
 
-      gtk_widget_set_tooltip_text (GTK_WIDGET (applet), text);
-      atk_object_set_description (atk_obj, text);
-      g_free (text);
+static gboolean
+trash_applet_update (gpointer user_data)
+{
+  TrashApplet *applet = user_data;
 
-      applet->items = items;
+  applet->update_id = 0;
+
+  /* one query at a time, the changes meanwhile bring another one */
+  if (applet->query_cancellable)
+    {
+      applet->update_again = TRUE;
+      return G_SOURCE_REMOVE;
     }
 
-  g_object_unref (info);
+  applet->query_cancellable = g_cancellable_new ();
+  g_file_query_info_async (applet->trash,
+                           G_FILE_ATTRIBUTE_STANDARD_ICON","
+                           G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT,
+                           0, G_PRIORITY_DEFAULT,
+                           applet->query_cancellable,
+                           trash_applet_query_done,
+                           g_object_ref (applet));
+
+  return G_SOURCE_REMOVE;
+}
+
+/* A bulk deletion sends a burst of changes, which are answered by a
+ * single query of the trash a moment later. */
+static void
+trash_applet_monitor_changed (TrashApplet *applet)
+{
+  if (!applet->update_id)
+    applet->update_id = g_timeout_add (TRASH_APPLET_UPDATE_DELAY,
+                                       trash_applet_update, applet);
 }
 
 static void
@@ -197,6 +304,26 @@ trash_applet_dispose (GObject *object)
     g_object_unref (applet->trash_monitor);
   applet->trash_monitor = NULL;
 
+  if (applet->update_id)
+    g_source_remove (applet->update_id);
+  applet->update_id = 0;
+
+  if (applet->query_cancellable)
+    {
+      g_cancellable_cancel (applet->query_cancellable);
+      g_object_unref (applet->query_cancellable);
+    }
+  applet->query_cancellable = NULL;
+
+  /* before the index it takes the trash directories from */
+  if (applet->purge)
+    trash_purge_free (applet->purge);
+  applet->purge = NULL;
+
+  if (applet->index)
+    trash_index_free (applet->index);
+  applet->index = NULL;
+
   if (applet->trash)
     g_object_unref (applet->trash);
   applet->trash = NULL;
@@ -233,6 +360,10 @@ trash_applet_init (TrashApplet *applet)
                             G_CALLBACK (trash_applet_monitor_changed),
                             applet);
 
+  /* the sizes of the trash directories, kept up to date on their own */
+  applet->index = trash_index_new (trash_applet_index_changed, applet);
+  applet->purge = trash_purge_new (applet->index);
+
   /* setup drag and drop */
   gtk_drag_dest_set (GTK_WIDGET (applet), GTK_DEST_DEFAULT_ALL,
                      drop_types, G_N_ELEMENTS (drop_types),
@@ -240,7 +371,7 @@ trash_applet_init (TrashApplet *applet)
 
   /* synthesise the first update */
   applet->items = -1;
-  trash_applet_monitor_changed (applet);
+  trash_applet_update (applet);
 }
 
 #define PANEL_SCHEMA "org.mate.panel"
@@ -359,6 +490,64 @@ trash_applet_do_empty (GtkAction   *action,
   trash_empty (GTK_WIDGET (applet));
 }
 
+static void
+trash_applet_empty_volume_response (GtkDialog   *dialog,
+                                    gint         response_id,
+                                    TrashApplet *applet)
+{
+  GtkComboBox *combo;
+
+  combo = g_object_get_data (G_OBJECT (dialog), "volumes");
+  if (response_id == GTK_RESPONSE_YES && gtk_combo_box_get_active_id (combo))
+    trash_empty_volume (GTK_WIDGET (applet),
+                        gtk_combo_box_get_active_id (combo));
+
+  gtk_widget_destroy (GTK_WIDGET (dialog));
+}
+
+/* Offers the trash directories of the index, the one picked is emptied
+ * without going through the others or GVfs. */
+static void
+trash_applet_empty_volume (GtkAction   *action,
+                           TrashApplet *applet)
+{
+  GtkWidget *dialog, *combo;
+  guint i;
+
+  dialog = gtk_dialog_new_with_buttons (_("Empty Trash on Volume"),
+                                        NULL, 0,
+                                        _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                        _("_Empty Trash"), GTK_RESPONSE_YES,
+                                        NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_YES);
+  gtk_window_set_resizable (GTK_WINDOW (dialog), FALSE);
+  gtk_window_set_screen (GTK_WINDOW (dialog),
+                         gtk_widget_get_screen (GTK_WIDGET (applet)));
+
+  combo = gtk_combo_box_text_new ();
+  for (i = 0; i < trash_index_get_n_volumes (applet->index); i++)
+    {
+      const TrashIndexVolume *volume = trash_index_get_volume (applet->index, i);
+      char *size, *text;
+
+      size = g_format_size (volume->bytes);
+      /* Translators: a volume name and the size of its trash */
+      text = g_strdup_printf (_("%s (%s)"), volume->name, size);
+      gtk_combo_box_text_append (GTK_COMBO_BOX_TEXT (combo), volume->path, text);
+      g_free (text);
+      g_free (size);
+    }
+  gtk_combo_box_set_active (GTK_COMBO_BOX (combo), 0);
+  gtk_container_set_border_width (GTK_CONTAINER (combo), 12);
+  gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+                      combo, FALSE, FALSE, 0);
+  g_object_set_data (G_OBJECT (dialog), "volumes", combo);
+
+  g_signal_connect (dialog, "response",
+                    G_CALLBACK (trash_applet_empty_volume_response), applet);
+  gtk_widget_show_all (dialog);
+}
+
 static void
 trash_applet_open_folder (GtkAction   *action,
                           TrashApplet *applet)
@@ -527,6 +716,205 @@ confirm_delete_immediately (GtkWidget *parent_view,
   return response == GTK_RESPONSE_YES;
 }
 
+/* how many dropped files are trashed at once */
+#define TRASH_DROP_CONCURRENCY 8
+/* how long a drop runs before its progress is shown, in milliseconds */
+#define TRASH_DROP_PROGRESS_DELAY 500
+
+/* The dropped files are handed to g_file_trash_async() a few at a time,
+ * so the panel stays responsive however many there are.  The ones that
+ * can not be trashed are offered for deletion once all are done, and
+ * go through the same queue. */
+typedef struct
+{
+  GtkWidget      *widget;
+  GCancellable   *cancellable;
+  GPtrArray      *files;
+  guint           next;         /* the first file not started */
+  guint           running;
+  guint           done;
+  gboolean        deleting;     /* the second round, after confirmation */
+  GList          *untrashable;
+  guint           progress_id;
+  GtkWidget      *dialog;
+  GtkProgressBar *progress_bar;
+} TrashDrop;
+
+static void trash_drop_run (TrashDrop *drop);
+
+static void
+trash_drop_free (TrashDrop *drop)
+{
+  if (drop->progress_id)
+    g_source_remove (drop->progress_id);
+  if (drop->dialog)
+    gtk_widget_destroy (drop->dialog);
+
+  g_list_free_full (drop->untrashable, g_object_unref);
+  g_ptr_array_unref (drop->files);
+  g_object_unref (drop->cancellable);
+  g_object_unref (drop->widget);
+  g_free (drop);
+}
+
+static void
+trash_drop_update_progress (TrashDrop *drop)
+{
+  char *text;
+
+  if (!drop->dialog)
+    return;
+
+  if (drop->deleting)
+    text = g_strdup_printf (_("Deleting item %u of %u"),
+                            MIN (drop->done + 1, drop->files->len),
+                            drop->files->len);
+  else
+    text = g_strdup_printf (_("Moving item %u of %u to the trash"),
+                            MIN (drop->done + 1, drop->files->len),
+                            drop->files->len);
+
+  gtk_progress_bar_set_text (drop->progress_bar, text);
+  gtk_progress_bar_set_fraction (drop->progress_bar,
+                                 (gdouble) drop->done / drop->files->len);
+  g_free (text);
+}
+
+static gboolean
+trash_drop_show_progress (gpointer user_data)
+{
+  TrashDrop *drop = user_data;
+  GtkWidget *content;
+
+  drop->progress_id = 0;
+
+  drop->dialog = gtk_dialog_new_with_buttons (_("Moving to the Trash"),
+                                              NULL, 0,
+                                              _("_Cancel"), GTK_RESPONSE_CANCEL,
+                                              NULL);
+  g_object_add_weak_pointer (G_OBJECT (drop->dialog),
+                             (gpointer *) &drop->dialog);
+  gtk_window_set_resizable (GTK_WINDOW (drop->dialog), FALSE);
+  gtk_window_set_screen (GTK_WINDOW (drop->dialog),
+                         gtk_widget_get_screen (drop->widget));
+
+  drop->progress_bar = GTK_PROGRESS_BAR (gtk_progress_bar_new ());
+  gtk_progress_bar_set_show_text (drop->progress_bar, TRUE);
+  content = gtk_dialog_get_content_area (GTK_DIALOG (drop->dialog));
+  gtk_container_set_border_width (GTK_CONTAINER (content), 12);
+  gtk_box_pack_start (GTK_BOX (content), GTK_WIDGET (drop->progress_bar),
+                      FALSE, FALSE, 0);
+
+  /* closing the dialog cancels too */
+  g_signal_connect_swapped (drop->dialog, "response",
+                            G_CALLBACK (g_cancellable_cancel),
+                            drop->cancellable);
+
+  trash_drop_update_progress (drop);
+  gtk_widget_show_all (drop->dialog);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* All files went through the queue */
+static void
+trash_drop_finish (TrashDrop *drop)
+{
+  if (drop->untrashable && !drop->deleting &&
+      !g_cancellable_is_cancelled (drop->cancellable))
+    {
+      guint n = g_list_length (drop->untrashable);
+
+      /* no progress over the confirmation */
+      if (drop->progress_id)
+        g_source_remove (drop->progress_id);
+      drop->progress_id = 0;
+      if (drop->dialog)
+        gtk_widget_hide (drop->dialog);
+
+      if (confirm_delete_immediately (drop->widget, n, n == drop->files->len))
+        {
+          GList *l;
+
+          g_ptr_array_set_size (drop->files, 0);
+          for (l = drop->untrashable; l; l = l->next)
+            g_ptr_array_add (drop->files, l->data);
+          g_list_free (drop->untrashable);
+          drop->untrashable = NULL;
+
+          drop->deleting = TRUE;
+          drop->next = drop->done = 0;
+          if (drop->dialog)
+            {
+              trash_drop_update_progress (drop);
+              gtk_widget_show (drop->dialog);
+            }
+          else
+            drop->progress_id = g_timeout_add (TRASH_DROP_PROGRESS_DELAY,
+                                               trash_drop_show_progress, drop);
+          trash_drop_run (drop);
+
+          return;
+        }
+    }
+
+  trash_drop_free (drop);
+}
+
+static void
+trash_drop_file_done (GObject      *source,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  TrashDrop *drop = user_data;
+  GError *error = NULL;
+  gboolean ok;
+
+  if (drop->deleting)
+    ok = g_file_delete_finish (G_FILE (source), result, &error);
+  else
+    ok = g_file_trash_finish (G_FILE (source), result, &error);
+
+  if (!ok)
+    {
+      if (!drop->deleting &&
+          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        drop->untrashable = g_list_prepend (drop->untrashable,
+                                            g_object_ref (source));
+      g_error_free (error);
+    }
+
+  drop->running--;
+  drop->done++;
+  trash_drop_update_progress (drop);
+
+  trash_drop_run (drop);
+}
+
+/* Starts files until the limit is reached, or finishes once none are
+ * left running */
+static void
+trash_drop_run (TrashDrop *drop)
+{
+  while (drop->running < TRASH_DROP_CONCURRENCY &&
+         drop->next < drop->files->len &&
+         !g_cancellable_is_cancelled (drop->cancellable))
+    {
+      GFile *file = g_ptr_array_index (drop->files, drop->next++);
+
+      drop->running++;
+      if (drop->deleting)
+        g_file_delete_async (file, G_PRIORITY_DEFAULT, drop->cancellable,
+                             trash_drop_file_done, drop);
+      else
+        g_file_trash_async (file, G_PRIORITY_DEFAULT, drop->cancellable,
+                            trash_drop_file_done, drop);
+    }
+
+  if (drop->running == 0)
+    trash_drop_finish (drop);
+}
+
 static void
 trash_applet_drag_data_received (GtkWidget        *widget,
                                  GdkDragContext   *context,
@@ -536,59 +924,27 @@ trash_applet_drag_data_received (GtkWidget        *widget,
                                  guint             info,
                                  guint             time_)
 {
+  TrashDrop *drop;
   gchar **list;
   gint i;
-  GList *trashed = NULL;
-  GList *untrashable = NULL;
-  GList *l;
-  GError *error = NULL;
 
   list = g_uri_list_extract_uris ((gchar *)gtk_selection_data_get_data (selectiondata));
 
-  for (i = 0; list[i]; i++)
-    {
-      GFile *file;
-
-      file = g_file_new_for_uri (list[i]);
-
-      if (!g_file_trash (file, NULL, NULL))
-        {
-          untrashable = g_list_prepend (untrashable, file);
-        }
-      else
-        {
-          trashed = g_list_prepend (trashed, file);
-        }
-    }
+  drop = g_new0 (TrashDrop, 1);
+  drop->widget = g_object_ref (widget);
+  drop->cancellable = g_cancellable_new ();
+  drop->files = g_ptr_array_new_with_free_func (g_object_unref);
 
-  if (untrashable)
-    {
-      if (confirm_delete_immediately (widget,
-                                      g_list_length (untrashable),
-                                      trashed == NULL))
-        {
-          for (l = untrashable; l; l = l->next)
-            {
-              if (!g_file_delete (l->data, NULL, &error))
-                {
-/*
-* FIXME: uncomment me after branched (we're string frozen)
-                  error_dialog (applet,
-                                _("Unable to delete '%s': %s"),
-                                g_file_get_uri (l->data),
-                                error->message);
-*/
-                                g_clear_error (&error);
-                }
-            }
-        }
-    }
-
-  g_list_free_full (untrashable, g_object_unref);
-  g_list_free_full (trashed, g_object_unref);
+  for (i = 0; list[i]; i++)
+    g_ptr_array_add (drop->files, g_file_new_for_uri (list[i]));
 
   g_strfreev (list);
 
+  /* small drops are done before a dialog would be seen */
+  drop->progress_id = g_timeout_add (TRASH_DROP_PROGRESS_DELAY,
+                                     trash_drop_show_progress, drop);
+  trash_drop_run (drop);
+
   gtk_drag_finish (context, TRUE, FALSE, time_);
 }
 